@@ -0,0 +1,367 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_ARRAY_EXPRESSION_H_
+#define LIBCUA_ARRAY_EXPRESSION_H_
+
+#include <type_traits>
+
+#include "functional.h"
+#include "util.h"
+
+namespace cua {
+
+/**
+ * @class ArrayExpression
+ * @brief Base class for lazily evaluated element-wise array expressions.
+ *
+ * Arithmetic between arrays, and between arrays and scalars, does not compute
+ * anything by itself. Instead, it builds a small expression tree that holds
+ * shallow copies of its array operands. Assigning the expression to an array
+ * evaluates the whole tree in a single pass, i.e., one kernel launch with one
+ * read per input element and one write per output element:
+ *
+ *     // CudaArray2D<float> a, b, c, out (all of the same size)
+ *     out = a * 0.5f + b * c - 1.0f;  // one fused kernel
+ *     out += a / b;                   // reads out, a, and b once
+ *
+ * For host arrays (e.g., CudaHostArray2D), the same expression is evaluated on
+ * the CPU thread pool instead.
+ *
+ * All arrays in an expression must have the same size, scalar type, and device
+ * as the destination array. Scalars are converted to the scalar type of the
+ * arrays. Expression nodes are function objects `(x, y[, z]) -> Scalar` and
+ * can therefore also be passed directly to ApplyOp().
+ */
+template <typename Derived>
+class ArrayExpression {
+ public:
+  /**
+   * @returns a reference to the object cast to its dervied class type
+   */
+  __host__ __device__ const Derived &derived() const {
+    return *static_cast<const Derived *>(this);
+  }
+};
+
+namespace internal {
+
+//------------------------------------------------------------------------------
+//
+// type traits
+//
+//------------------------------------------------------------------------------
+
+// True for any array type with a CudaArrayTraits specialization.
+template <typename T, typename Enable = void>
+struct IsArray : std::false_type {};
+
+template <typename T>
+struct IsArray<T, typename VoidType<typename CudaArrayTraits<T>::Scalar>::type>
+    : std::true_type {};
+
+// True for array expressions.
+template <typename T>
+struct IsArrayExpression : std::is_base_of<ArrayExpression<T>, T> {};
+
+// True for types that can be used as array operands in an expression.
+template <typename T>
+struct IsArrayOperand
+    : std::integral_constant<bool, IsArray<T>::value ||
+                                       IsArrayExpression<T>::value> {};
+
+//------------------------------------------------------------------------------
+//
+// expression nodes
+//
+//------------------------------------------------------------------------------
+
+/**
+ * Leaf node that reads from an array.
+ */
+template <typename ArrayType>
+class ArrayTerminal : public ArrayExpression<ArrayTerminal<ArrayType>> {
+ public:
+  typedef typename CudaArrayTraits<ArrayType>::Scalar Scalar;
+
+  explicit ArrayTerminal(const ArrayType &array) : array_(array) {}
+
+  LIBCUA_EXEC_CHECK_DISABLE
+  template <typename... Index>
+  __host__ __device__ inline Scalar operator()(Index... index) const {
+    return array_.get(index...);
+  }
+
+  template <typename OutputArrayType>
+  inline void CheckCompatible2D(const OutputArrayType &out) const {
+    CheckSameDevice(array_, out);
+    CheckSizeEqual2D(array_, out);
+  }
+
+  template <typename OutputArrayType>
+  inline void CheckCompatible3D(const OutputArrayType &out) const {
+    CheckSameDevice(array_, out);
+    CheckSizeEqual3D(array_, out);
+  }
+
+ private:
+  ArrayType array_;  // shallow copy
+};
+
+/**
+ * Leaf node for a constant.
+ */
+template <typename T>
+class ScalarTerminal : public ArrayExpression<ScalarTerminal<T>> {
+ public:
+  typedef T Scalar;
+
+  explicit ScalarTerminal(const Scalar &value) : value_(value) {}
+
+  template <typename... Index>
+  __host__ __device__ inline Scalar operator()(Index...) const {
+    return value_;
+  }
+
+  template <typename OutputArrayType>
+  inline void CheckCompatible2D(const OutputArrayType &) const {}
+
+  template <typename OutputArrayType>
+  inline void CheckCompatible3D(const OutputArrayType &) const {}
+
+ private:
+  Scalar value_;
+};
+
+/**
+ * Node that applies an element-wise unary function to its operand.
+ */
+template <class UnaryFunction, typename Operand>
+class UnaryExpression
+    : public ArrayExpression<UnaryExpression<UnaryFunction, Operand>> {
+ public:
+  typedef typename Operand::Scalar Scalar;
+
+  explicit UnaryExpression(const Operand &operand) : operand_(operand) {}
+
+  LIBCUA_EXEC_CHECK_DISABLE
+  template <typename... Index>
+  __host__ __device__ inline Scalar operator()(Index... index) const {
+    return UnaryFunction()(operand_(index...));
+  }
+
+  template <typename OutputArrayType>
+  inline void CheckCompatible2D(const OutputArrayType &out) const {
+    operand_.CheckCompatible2D(out);
+  }
+
+  template <typename OutputArrayType>
+  inline void CheckCompatible3D(const OutputArrayType &out) const {
+    operand_.CheckCompatible3D(out);
+  }
+
+ private:
+  Operand operand_;
+};
+
+/**
+ * Node that applies an element-wise binary function to its operands.
+ */
+template <class BinaryFunction, typename Lhs, typename Rhs>
+class BinaryExpression
+    : public ArrayExpression<BinaryExpression<BinaryFunction, Lhs, Rhs>> {
+ public:
+  typedef typename Lhs::Scalar Scalar;
+
+  static_assert(std::is_same<Scalar, typename Rhs::Scalar>::value,
+                "Arrays have different scalar types.");
+
+  BinaryExpression(const Lhs &lhs, const Rhs &rhs) : lhs_(lhs), rhs_(rhs) {}
+
+  LIBCUA_EXEC_CHECK_DISABLE
+  template <typename... Index>
+  __host__ __device__ inline Scalar operator()(Index... index) const {
+    return BinaryFunction()(lhs_(index...), rhs_(index...));
+  }
+
+  template <typename OutputArrayType>
+  inline void CheckCompatible2D(const OutputArrayType &out) const {
+    lhs_.CheckCompatible2D(out);
+    rhs_.CheckCompatible2D(out);
+  }
+
+  template <typename OutputArrayType>
+  inline void CheckCompatible3D(const OutputArrayType &out) const {
+    lhs_.CheckCompatible3D(out);
+    rhs_.CheckCompatible3D(out);
+  }
+
+ private:
+  Lhs lhs_;
+  Rhs rhs_;
+};
+
+//------------------------------------------------------------------------------
+//
+// operand wrapping
+//
+//------------------------------------------------------------------------------
+
+// Maps an operand to its expression node type: expressions are used as-is,
+// arrays become ArrayTerminals, and anything else is taken to be a scalar of
+// the given type.
+template <typename T, typename Scalar, typename Enable = void>
+struct ExpressionOperand {
+  typedef ScalarTerminal<Scalar> type;
+  static inline type Wrap(const T &value) {
+    return type(static_cast<Scalar>(value));
+  }
+};
+
+template <typename T, typename Scalar>
+struct ExpressionOperand<
+    T, Scalar, typename std::enable_if<IsArrayExpression<T>::value>::type> {
+  typedef T type;
+  static inline const type &Wrap(const T &expression) { return expression; }
+};
+
+template <typename T, typename Scalar>
+struct ExpressionOperand<T, Scalar,
+                         typename std::enable_if<IsArray<T>::value>::type> {
+  typedef ArrayTerminal<T> type;
+  static inline type Wrap(const T &array) { return type(array); }
+};
+
+// Scalar type of an array or expression.
+template <typename T, typename Enable = void>
+struct OperandScalar {
+  typedef typename CudaArrayTraits<T>::Scalar type;
+};
+
+template <typename T>
+struct OperandScalar<
+    T, typename std::enable_if<IsArrayExpression<T>::value>::type> {
+  typedef typename T::Scalar type;
+};
+
+// Result type of a binary operation; only defined if at least one of the
+// operands is an array or expression. The scalar type is taken from the first
+// such operand.
+template <class BinaryFunction, typename Lhs, typename Rhs,
+          typename Enable = void>
+struct BinaryExpressionType {};
+
+template <class BinaryFunction, typename Lhs, typename Rhs>
+struct BinaryExpressionType<
+    BinaryFunction, Lhs, Rhs,
+    typename std::enable_if<IsArrayOperand<Lhs>::value>::type> {
+  typedef typename OperandScalar<Lhs>::type Scalar;
+  typedef ExpressionOperand<Lhs, Scalar> LhsOperand;
+  typedef ExpressionOperand<Rhs, Scalar> RhsOperand;
+  typedef BinaryExpression<BinaryFunction, typename LhsOperand::type,
+                           typename RhsOperand::type>
+      type;
+};
+
+template <class BinaryFunction, typename Lhs, typename Rhs>
+struct BinaryExpressionType<
+    BinaryFunction, Lhs, Rhs,
+    typename std::enable_if<!IsArrayOperand<Lhs>::value &&
+                            IsArrayOperand<Rhs>::value>::type> {
+  typedef typename OperandScalar<Rhs>::type Scalar;
+  typedef ExpressionOperand<Lhs, Scalar> LhsOperand;
+  typedef ExpressionOperand<Rhs, Scalar> RhsOperand;
+  typedef BinaryExpression<BinaryFunction, typename LhsOperand::type,
+                           typename RhsOperand::type>
+      type;
+};
+
+template <class BinaryFunction, typename Lhs, typename Rhs>
+inline typename BinaryExpressionType<BinaryFunction, Lhs, Rhs>::type
+MakeBinaryExpression(const Lhs &lhs, const Rhs &rhs) {
+  typedef BinaryExpressionType<BinaryFunction, Lhs, Rhs> ResultType;
+  return typename ResultType::type(ResultType::LhsOperand::Wrap(lhs),
+                                   ResultType::RhsOperand::Wrap(rhs));
+}
+
+}  // namespace internal
+
+//------------------------------------------------------------------------------
+//
+// operators
+//
+//------------------------------------------------------------------------------
+
+template <typename Lhs, typename Rhs>
+inline typename internal::BinaryExpressionType<Plus, Lhs, Rhs>::type operator+(
+    const Lhs &lhs, const Rhs &rhs) {
+  return internal::MakeBinaryExpression<Plus>(lhs, rhs);
+}
+
+template <typename Lhs, typename Rhs>
+inline typename internal::BinaryExpressionType<Minus, Lhs, Rhs>::type
+operator-(const Lhs &lhs, const Rhs &rhs) {
+  return internal::MakeBinaryExpression<Minus>(lhs, rhs);
+}
+
+template <typename Lhs, typename Rhs>
+inline typename internal::BinaryExpressionType<Multiplies, Lhs, Rhs>::type
+operator*(const Lhs &lhs, const Rhs &rhs) {
+  return internal::MakeBinaryExpression<Multiplies>(lhs, rhs);
+}
+
+template <typename Lhs, typename Rhs>
+inline typename internal::BinaryExpressionType<Divides, Lhs, Rhs>::type
+operator/(const Lhs &lhs, const Rhs &rhs) {
+  return internal::MakeBinaryExpression<Divides>(lhs, rhs);
+}
+
+template <typename Operand,
+          typename std::enable_if<internal::IsArrayOperand<Operand>::value,
+                                  int>::type = 0>
+inline internal::UnaryExpression<
+    Negate, typename internal::ExpressionOperand<
+                Operand, typename internal::OperandScalar<Operand>::type>::type>
+operator-(const Operand &operand) {
+  typedef internal::ExpressionOperand<
+      Operand, typename internal::OperandScalar<Operand>::type>
+      WrappedOperand;
+  return internal::UnaryExpression<Negate, typename WrappedOperand::type>(
+      WrappedOperand::Wrap(operand));
+}
+
+}  // namespace cua
+
+#endif  // LIBCUA_ARRAY_EXPRESSION_H_
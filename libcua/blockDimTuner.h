@@ -0,0 +1,491 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef LIBCUA_BLOCK_DIM_TUNER_H_
+#define LIBCUA_BLOCK_DIM_TUNER_H_
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "util.h"
+
+namespace cua {
+
+namespace internal {
+
+/**
+ * @class CudaTuningBackend
+ * @brief Default BlockDimTuner backend, which names devices and times kernel
+ * launches with the CUDA runtime API.
+ *
+ * A backend must provide the two methods below. Tests substitute a mock
+ * backend so that the caching and selection logic can be exercised without a
+ * GPU.
+ */
+class CudaTuningBackend {
+ public:
+  /// number of timed launches per candidate, after one warm-up launch
+  static const int kNumRepetitions = 5;
+
+  /**
+   * @return the name of the given device, e.g., "NVIDIA GeForce RTX 3090"
+   */
+  inline std::string DeviceName(int device) const {
+    cudaDeviceProp properties;
+    if (cudaGetDeviceProperties(&properties, device) != cudaSuccess) {
+      return "unknown";
+    }
+    return properties.name;
+  }
+
+  /**
+   * @param launch function that queues the kernel on the stream with the given
+   *   block dimensions
+   * @param block_dim candidate block dimensions
+   * @param device GPU on which the kernel runs
+   * @param stream stream on which the kernel runs
+   * @return the mean run time of one launch, in milliseconds
+   */
+  inline double Time(const std::function<void(const dim3 &)> &launch,
+                     const dim3 &block_dim, int device,
+                     cudaStream_t stream) const {
+    SetDevice(device);
+
+    // leave an error raised by earlier work for the caller to see
+    if (cudaPeekAtLastError() != cudaSuccess) {
+      return std::numeric_limits<double>::infinity();
+    }
+
+    launch(block_dim);  // warm-up
+
+    cudaEvent_t start, stop;
+    cudaEventCreate(&start);
+    cudaEventCreate(&stop);
+    cudaEventRecord(start, stream);
+    for (int i = 0; i < kNumRepetitions; ++i) {
+      launch(block_dim);
+    }
+    cudaEventRecord(stop, stream);
+    cudaEventSynchronize(stop);
+
+    float elapsed_ms = 0.f;
+    const bool success =
+        (cudaEventElapsedTime(&elapsed_ms, start, stop) == cudaSuccess);
+    cudaEventDestroy(start);
+    cudaEventDestroy(stop);
+
+    // a candidate that fails to launch, e.g., because it uses too many
+    // registers per block, is never selected; its launch error is cleared so
+    // that the remaining candidates can still be timed
+    if (!success || cudaPeekAtLastError() != cudaSuccess) {
+      cudaGetLastError();
+      return std::numeric_limits<double>::infinity();
+    }
+    return elapsed_ms / kNumRepetitions;
+  }
+};
+
+//------------------------------------------------------------------------------
+
+/**
+ * Coarse size class of an array, used to key tuning results: each dimension is
+ * bucketed by powers of four, so that, e.g., 1024x1024 and 1920x1080 arrays
+ * share their tuned block dimensions.
+ * @return a string such as "w5h5d0"
+ */
+inline std::string ShapeClass(size_t width, size_t height, size_t depth = 1) {
+  const auto bucket = [](size_t extent) {
+    unsigned int log4 = 0;
+    for (; extent >= 4; extent /= 4) {
+      ++log4;
+    }
+    return log4;
+  };
+  std::ostringstream shape;
+  shape << "w" << bucket(width) << "h" << bucket(height) << "d"
+        << bucket(depth);
+  return shape.str();
+}
+
+// storage of an array type: arrays with a Pitch() live in linear memory, and
+// the others are backed by CUDA arrays
+template <typename ArrayClass>
+inline auto StorageName(const ArrayClass *array, int)
+    -> decltype(array->Pitch(), std::string()) {
+  return "linear";
+}
+
+template <typename ArrayClass>
+inline std::string StorageName(const ArrayClass *, long) {
+  return "cudaArray";
+}
+
+/**
+ * Name of an array type used to key tuning results. Unlike typeid().name(),
+ * which differs between compilers, it is stable across builds, so that results
+ * in the cache file stay valid; arrays that share their storage and element
+ * size share their tuned block dimensions.
+ * @return a string such as "linear4"
+ */
+template <typename ArrayClass>
+inline std::string TuningTypeName() {
+  std::ostringstream type_name;
+  type_name << StorageName(static_cast<const ArrayClass *>(nullptr), 0)
+            << sizeof(typename ArrayClass::Scalar);
+  return type_name.str();
+}
+
+/**
+ * @return candidate block dimensions for 2D element-wise kernels
+ */
+inline const std::vector<dim3> &BlockDimCandidates2D() {
+  static const std::vector<dim3> candidates = {
+      dim3(32, 32), dim3(32, 16), dim3(32, 8),  dim3(32, 4),  dim3(64, 16),
+      dim3(64, 8),  dim3(64, 4),  dim3(128, 8), dim3(128, 4), dim3(128, 2),
+      dim3(256, 4), dim3(256, 1), dim3(16, 16), dim3(16, 8)};
+  return candidates;
+}
+
+/**
+ * @return candidate block dimensions for 3D element-wise kernels
+ */
+inline const std::vector<dim3> &BlockDimCandidates3D() {
+  static const std::vector<dim3> candidates = {
+      dim3(32, 8, 4),  dim3(32, 4, 4), dim3(32, 4, 2), dim3(32, 8, 1),
+      dim3(32, 16, 1), dim3(64, 4, 2), dim3(64, 4, 1), dim3(128, 2, 1),
+      dim3(16, 8, 8),  dim3(16, 4, 4), dim3(8, 8, 8)};
+  return candidates;
+}
+
+}  // namespace internal
+
+//------------------------------------------------------------------------------
+
+/**
+ * @class BlockDimTuner
+ * @brief Selects block dimensions for kernels by benchmarking a set of
+ * candidates on first use, and remembers the winners across runs.
+ *
+ * Results are keyed by (device name, kernel name, array type, shape class; see
+ * internal::ShapeClass()) and written to a plain-text cache file, one result
+ * per line, so that later runs on the same kind of GPU use the winners without
+ * benchmarking again.
+ *
+ * The process-wide tuner returned by `BlockDimTuner<>::Instance()` is disabled
+ * by default. When enabled, either with SetEnabled() or by setting the
+ * LIBCUA_AUTOTUNE environment variable to a nonzero value, the element-wise
+ * kernels that can be safely repeated (Fill() and CopyTo()) of every GPU array
+ * use tuned block dimensions instead of the array's own BlockDim(). The cache
+ * file is given by the LIBCUA_TUNING_CACHE environment variable, or defaults to
+ * `$HOME/.libcua_tuning_cache`.
+ *
+ * All methods are thread-safe.
+ *
+ * @tparam Backend class providing `std::string DeviceName(int device)` and
+ *   `double Time(launch, block_dim, device, stream)`; see
+ *   internal::CudaTuningBackend
+ */
+template <typename Backend = internal::CudaTuningBackend>
+class BlockDimTuner {
+ public:
+  /**
+   * Constructor. Previously tuned results are loaded from the cache file on
+   * first use.
+   * @param cache_path file in which tuned results are stored; if empty,
+   *   results are only kept in memory
+   * @param backend object used to name devices and time launches
+   */
+  explicit BlockDimTuner(const std::string &cache_path,
+                         const Backend &backend = Backend())
+      : backend_(backend),
+        cache_path_(cache_path),
+        enabled_(true),
+        loaded_(false) {}
+
+  BlockDimTuner(const BlockDimTuner &) = delete;
+  BlockDimTuner &operator=(const BlockDimTuner &) = delete;
+
+  /**
+   * @return the process-wide tuner used by the array classes; this object is
+   *   intentionally never destroyed
+   */
+  static BlockDimTuner &Instance() {
+    static BlockDimTuner *tuner = [] {
+      BlockDimTuner *instance = new BlockDimTuner(DefaultCachePath());
+      const char *autotune = std::getenv("LIBCUA_AUTOTUNE");
+      instance->SetEnabled(autotune != nullptr &&
+                           std::string(autotune) != "0");
+      return instance;
+    }();
+    return *tuner;
+  }
+
+  /**
+   * @return the cache file given by LIBCUA_TUNING_CACHE, or
+   *   `$HOME/.libcua_tuning_cache`; empty if neither variable is set
+   */
+  static std::string DefaultCachePath();
+
+  //----------------------------------------------------------------------------
+
+  inline bool Enabled() const { return enabled_; }
+  inline void SetEnabled(bool enabled) { enabled_ = enabled; }
+
+  inline const std::string &CachePath() const { return cache_path_; }
+
+  /**
+   * Get the tuned block dimensions for a kernel, benchmarking each candidate
+   * first if no result is known for this device, kernel, type, and shape.
+   * @param kernel_name name of the kernel
+   * @param type_name name of the array type the kernel runs on
+   * @param shape_class shape class of the array; see internal::ShapeClass()
+   * @param candidates block dimensions to try
+   * @param launch function that queues the kernel with the given block
+   *   dimensions; it is called repeatedly while benchmarking, so the kernel
+   *   must give the same result when run more than once
+   * @param device GPU on which the kernel runs
+   * @param stream stream on which the kernel runs
+   * @return the fastest candidate
+   */
+  dim3 Tune(const std::string &kernel_name, const std::string &type_name,
+            const std::string &shape_class, const std::vector<dim3> &candidates,
+            const std::function<void(const dim3 &)> &launch, int device,
+            cudaStream_t stream = 0);
+
+  /**
+   * Look up a tuned result without benchmarking.
+   * @param block_dim output block dimensions, if found
+   * @return true if a result is known
+   */
+  bool Lookup(const std::string &device_name, const std::string &kernel_name,
+              const std::string &type_name, const std::string &shape_class,
+              dim3 *block_dim);
+
+  /**
+   * @return the number of known results
+   */
+  size_t NumEntries();
+
+  /**
+   * Forget all results held in memory; the cache file is left untouched.
+   */
+  void Clear();
+
+ private:
+  typedef std::tuple<std::string, std::string, std::string, std::string> Key;
+
+  void Load_();
+  void Save_() const;
+
+  Backend backend_;
+  const std::string cache_path_;
+  std::atomic<bool> enabled_;
+
+  std::mutex mutex_;
+  bool loaded_;
+  std::map<Key, dim3> entries_;
+  std::map<int, std::string> device_names_;
+};
+
+//------------------------------------------------------------------------------
+//
+// public method implementations
+//
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+std::string BlockDimTuner<Backend>::DefaultCachePath() {
+  const char *path = std::getenv("LIBCUA_TUNING_CACHE");
+  if (path != nullptr) {
+    return path;
+  }
+  const char *home = std::getenv("HOME");
+  return (home != nullptr) ? std::string(home) + "/.libcua_tuning_cache" : "";
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+dim3 BlockDimTuner<Backend>::Tune(
+    const std::string &kernel_name, const std::string &type_name,
+    const std::string &shape_class, const std::vector<dim3> &candidates,
+    const std::function<void(const dim3 &)> &launch, int device,
+    cudaStream_t stream) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Load_();
+
+  auto name = device_names_.find(device);
+  if (name == device_names_.end()) {
+    name = device_names_.emplace(device, backend_.DeviceName(device)).first;
+  }
+
+  const Key key(name->second, kernel_name, type_name, shape_class);
+  const auto entry = entries_.find(key);
+  if (entry != entries_.end()) {
+    return entry->second;
+  }
+
+  dim3 best_block_dim = candidates.front();
+  double best_time = std::numeric_limits<double>::infinity();
+  for (const dim3 &block_dim : candidates) {
+    const double time = backend_.Time(launch, block_dim, device, stream);
+    if (time < best_time) {
+      best_time = time;
+      best_block_dim = block_dim;
+    }
+  }
+
+  entries_[key] = best_block_dim;
+  Save_();
+
+  return best_block_dim;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+bool BlockDimTuner<Backend>::Lookup(const std::string &device_name,
+                                    const std::string &kernel_name,
+                                    const std::string &type_name,
+                                    const std::string &shape_class,
+                                    dim3 *block_dim) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Load_();
+
+  const auto entry =
+      entries_.find(Key(device_name, kernel_name, type_name, shape_class));
+  if (entry == entries_.end()) {
+    return false;
+  }
+  *block_dim = entry->second;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+size_t BlockDimTuner<Backend>::NumEntries() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Load_();
+  return entries_.size();
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+void BlockDimTuner<Backend>::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  loaded_ = true;  // don't reload the file
+}
+
+//------------------------------------------------------------------------------
+//
+// private method implementations
+//
+//------------------------------------------------------------------------------
+
+// Each line of the cache file holds one result as tab-separated fields:
+//   device name, kernel name, type name, shape class, "x y z"
+// Lines that do not parse are ignored.
+template <typename Backend>
+void BlockDimTuner<Backend>::Load_() {
+  if (loaded_) {
+    return;
+  }
+  loaded_ = true;
+
+  if (cache_path_.empty()) {
+    return;
+  }
+
+  std::ifstream file(cache_path_);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    std::string device_name, kernel_name, type_name, shape_class, block_dims;
+    if (!std::getline(fields, device_name, '\t') ||
+        !std::getline(fields, kernel_name, '\t') ||
+        !std::getline(fields, type_name, '\t') ||
+        !std::getline(fields, shape_class, '\t') ||
+        !std::getline(fields, block_dims)) {
+      continue;
+    }
+
+    std::istringstream dims(block_dims);
+    unsigned int x = 0, y = 0, z = 0;
+    if (!(dims >> x >> y >> z) || x == 0 || y == 0 || z == 0) {
+      continue;
+    }
+
+    entries_[Key(device_name, kernel_name, type_name, shape_class)] =
+        dim3(x, y, z);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// The cache is only an optimization, so a file that cannot be written is
+// silently ignored.
+template <typename Backend>
+void BlockDimTuner<Backend>::Save_() const {
+  if (cache_path_.empty()) {
+    return;
+  }
+
+  std::ofstream file(cache_path_, std::ios::trunc);
+  for (const auto &entry : entries_) {
+    file << std::get<0>(entry.first) << "\t" << std::get<1>(entry.first)
+         << "\t" << std::get<2>(entry.first) << "\t"
+         << std::get<3>(entry.first) << "\t" << entry.second.x << " "
+         << entry.second.y << " " << entry.second.z << "\n";
+  }
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace cua
+
+#endif  // LIBCUA_BLOCK_DIM_TUNER_H_
@@ -0,0 +1,581 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_CACHING_ALLOCATOR_H_
+#define LIBCUA_CACHING_ALLOCATOR_H_
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "util.h"
+
+namespace cua {
+
+namespace internal {
+
+/**
+ * @class CudaDeviceMemoryBackend
+ * @brief Default CachingAllocator backend, which allocates linear GPU memory
+ * with the CUDA runtime API.
+ *
+ * A backend must provide the methods below. Tests substitute a mock backend so
+ * that the caching logic can be exercised without a GPU. None of the methods
+ * change the caller's current device.
+ */
+struct CudaDeviceMemoryBackend {
+  typedef cudaEvent_t Event;
+
+  /**
+   * @return a new allocation of the given size on the given device, or nullptr
+   *   if the allocation failed
+   */
+  inline void *Malloc(size_t size_in_bytes, int device) const {
+    const int current_device = GetDevice();
+    SetDevice(device);
+    void *ptr = nullptr;
+    if (cudaMalloc(&ptr, size_in_bytes) != cudaSuccess) {
+      cudaGetLastError();  // clear the error; the caller will retry or throw
+      ptr = nullptr;
+    }
+    SetDevice(current_device);
+    return ptr;
+  }
+
+  inline void Free(void *ptr, int device) const {
+    const int current_device = GetDevice();
+    SetDevice(device);
+    cudaFree(ptr);
+    SetDevice(current_device);
+  }
+
+  /**
+   * @return a new event, recorded on the given stream of the given device
+   */
+  inline Event RecordEvent(cudaStream_t stream, int device) const {
+    const int current_device = GetDevice();
+    SetDevice(device);
+    Event event;
+    cudaEventCreateWithFlags(&event, cudaEventDisableTiming);
+    cudaEventRecord(event, stream);
+    SetDevice(current_device);
+    return event;
+  }
+
+  /**
+   * @return true if all work captured by the event has completed
+   */
+  inline bool QueryEvent(Event event) const {
+    return cudaEventQuery(event) != cudaErrorNotReady;
+  }
+
+  inline void DestroyEvent(Event event) const { cudaEventDestroy(event); }
+
+  /**
+   * @return the row alignment, in bytes, required for pitched memory on the
+   *   given device, i.e., the texture pitch alignment, so that the rows can be
+   *   bound to pitched textures
+   */
+  inline size_t PitchAlignment(int device) const {
+    int alignment = 0;
+    cudaDeviceGetAttribute(&alignment, cudaDevAttrTexturePitchAlignment,
+                           device);
+    return (alignment > 0) ? alignment : 512;
+  }
+};
+
+}  // namespace internal
+
+/**
+ * @class CachingAllocator
+ * @brief Size-bucketed cache of GPU allocations, kept per device and stream.
+ *
+ * CudaArray2D and CudaArray3D obtain their memory from
+ * `CachingAllocator<>::Instance()`. Freed blocks are not returned to the
+ * driver; instead, they are kept in a bin keyed by (device, stream, bin size)
+ * and handed out again for the next request that falls into the same bin. This
+ * avoids the implicit device synchronization of cudaMalloc/cudaFree when arrays
+ * are repeatedly created and destroyed, e.g., by Copy(), Transpose(), or
+ * EmptyCopy().
+ *
+ * A freed block is cached under the stream it was allocated on and only handed
+ * out again for that stream, so work queued there before the free completes
+ * before the block's next user runs. If the block was also used on other
+ * streams, as announced with RecordStream() (e.g., by CudaArray2D::SetStream()
+ * or by a copy queued on another array's stream), Free() records an event on
+ * each of them, and the block is not reused until all of these events have
+ * completed.
+ *
+ * Requests of up to kSmallBlockBytes are rounded up to the next power of two
+ * (at least kMinBlockBytes); larger requests are rounded up to a multiple of
+ * kLargeBlockGranularity. If caching a freed block would exceed
+ * MaxCachedBytes(), cached blocks are released to the driver first. Set the cap
+ * to zero to disable caching entirely. If an allocation fails, the cache for
+ * that device is trimmed and the allocation is retried once.
+ *
+ * All methods are thread-safe.
+ *
+ * @tparam Backend class providing `void *Malloc(size_t bytes, int device)`,
+ *   `void Free(void *ptr, int device)`, `size_t PitchAlignment(int device)`,
+ *   and the event functions of internal::CudaDeviceMemoryBackend
+ */
+template <typename Backend = internal::CudaDeviceMemoryBackend>
+class CachingAllocator {
+ public:
+  /// smallest bin size, in bytes
+  static const size_t kMinBlockBytes;
+
+  /// requests larger than this are rounded to kLargeBlockGranularity
+  static const size_t kSmallBlockBytes;
+
+  /// rounding granularity for large requests, in bytes
+  static const size_t kLargeBlockGranularity;
+
+  //----------------------------------------------------------------------------
+
+  /**
+   * Constructor.
+   * @param backend object used to allocate and free the underlying memory
+   */
+  explicit CachingAllocator(const Backend &backend = Backend())
+      : backend_(backend),
+        max_cached_bytes_(std::numeric_limits<size_t>::max()),
+        cached_bytes_(0),
+        allocated_bytes_(0) {}
+
+  /**
+   * Destructor. Releases all cached blocks; blocks still in use are not freed.
+   */
+  ~CachingAllocator() { Trim(); }
+
+  CachingAllocator(const CachingAllocator &) = delete;
+  CachingAllocator &operator=(const CachingAllocator &) = delete;
+
+  /**
+   * @return the process-wide allocator used by the array classes; this object
+   *   is intentionally never destroyed, so that arrays with static storage
+   *   duration can still release their memory at program exit
+   */
+  static CachingAllocator &Instance() {
+    static CachingAllocator *allocator = new CachingAllocator();
+    return *allocator;
+  }
+
+  //----------------------------------------------------------------------------
+
+  /**
+   * @param size_in_bytes requested allocation size
+   * @return the number of bytes actually reserved for a request of the given
+   *   size
+   */
+  static size_t BinSize(size_t size_in_bytes);
+
+  /**
+   * Allocate a block of device memory.
+   * @param size_in_bytes number of bytes to allocate
+   * @param device GPU on which to allocate the memory
+   * @param stream stream on which the memory will be used
+   * @return pointer to the allocated memory
+   */
+  void *Allocate(size_t size_in_bytes, int device, cudaStream_t stream = 0);
+
+  /**
+   * Allocate a block of pitched device memory whose rows are aligned as they
+   * would be for cudaMallocPitch.
+   * @param width_in_bytes number of bytes in a row
+   * @param num_rows total number of rows, e.g., height * depth for a 3D array
+   * @param device GPU on which to allocate the memory
+   * @param stream stream on which the memory will be used
+   * @param pitch output pitch (number of bytes between the start of each row)
+   * @return pointer to the allocated memory
+   */
+  void *AllocatePitched(size_t width_in_bytes, size_t num_rows, int device,
+                        cudaStream_t stream, size_t *pitch);
+
+  /**
+   * Return a block obtained from Allocate() to the cache. Passing nullptr is a
+   * no-op.
+   * @param ptr allocated block
+   */
+  void Free(void *ptr);
+
+  /**
+   * Mark a block obtained from Allocate() as used on another stream than the
+   * one it was allocated for. Once the block is freed, it is not reused until
+   * all work queued on that stream before the Free() call has completed.
+   * Passing nullptr, or the block's own stream, is a no-op.
+   * @param ptr allocated block
+   * @param stream additional stream on which the block is used
+   */
+  void RecordStream(void *ptr, cudaStream_t stream);
+
+  /**
+   * Release all cached (i.e., unused) blocks back to the driver.
+   */
+  void Trim();
+
+  /**
+   * Release all cached blocks on the given device back to the driver.
+   * @param device GPU whose cached blocks should be released
+   */
+  void Trim(int device);
+
+  //----------------------------------------------------------------------------
+  // getters/setters
+
+  /**
+   * Set the maximum number of bytes kept in the cache; cached blocks are
+   * released immediately if the cache is currently larger.
+   * @param max_cached_bytes new cap; zero disables caching
+   */
+  void SetMaxCachedBytes(size_t max_cached_bytes);
+
+  inline size_t MaxCachedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return max_cached_bytes_;
+  }
+
+  /**
+   * @return the total size of the blocks currently held in the cache
+   */
+  inline size_t CachedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cached_bytes_;
+  }
+
+  /**
+   * @return the total size of the blocks currently handed out to callers
+   */
+  inline size_t AllocatedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return allocated_bytes_;
+  }
+
+  //----------------------------------------------------------------------------
+  // private class methods and fields
+
+ private:
+  // (device, stream, bin size)
+  typedef std::tuple<int, cudaStream_t, size_t> BinKey;
+
+  typedef typename Backend::Event Event;
+
+  struct Block {
+    int device;
+    cudaStream_t stream;
+    size_t size_in_bytes;
+    std::vector<cudaStream_t> other_streams;  // see RecordStream()
+  };
+
+  struct CachedBlock {
+    void *ptr;
+    std::vector<Event> events;  // recorded on the block's other streams
+  };
+
+  // release cached blocks (on the given device, or on all devices if -1) until
+  // at most target_bytes remain cached; mutex_ must be held
+  void ReleaseCached_(size_t target_bytes, int device = -1);
+
+  Backend backend_;
+
+  mutable std::mutex mutex_;
+  std::map<BinKey, std::vector<CachedBlock>> cached_blocks_;
+  std::unordered_map<void *, Block> allocated_blocks_;
+  std::map<int, size_t> pitch_alignment_;  // per-device cache
+
+  size_t max_cached_bytes_;
+  size_t cached_bytes_;
+  size_t allocated_bytes_;
+};
+
+//------------------------------------------------------------------------------
+//
+// static member initialization
+//
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+const size_t CachingAllocator<Backend>::kMinBlockBytes = 512;
+
+template <typename Backend>
+const size_t CachingAllocator<Backend>::kSmallBlockBytes = 1 << 20;
+
+template <typename Backend>
+const size_t CachingAllocator<Backend>::kLargeBlockGranularity = 2 << 20;
+
+//------------------------------------------------------------------------------
+//
+// public method implementations
+//
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+inline size_t CachingAllocator<Backend>::BinSize(size_t size_in_bytes) {
+  if (size_in_bytes > kSmallBlockBytes) {
+    return (size_in_bytes + kLargeBlockGranularity - 1) /
+           kLargeBlockGranularity * kLargeBlockGranularity;
+  }
+
+  size_t bin_size = kMinBlockBytes;
+  while (bin_size < size_in_bytes) {
+    bin_size <<= 1;
+  }
+  return bin_size;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+inline void *CachingAllocator<Backend>::Allocate(size_t size_in_bytes,
+                                                 int device,
+                                                 cudaStream_t stream) {
+  const size_t bin_size = BinSize(size_in_bytes);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // reuse a cached block that is no longer in use on other streams, if
+  // possible
+  auto bin = cached_blocks_.find(BinKey(device, stream, bin_size));
+  if (bin != cached_blocks_.end()) {
+    std::vector<CachedBlock> &blocks = bin->second;
+    for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+      bool is_ready = true;
+      for (const Event &event : it->events) {
+        is_ready = is_ready && backend_.QueryEvent(event);
+      }
+      if (!is_ready) {
+        continue;
+      }
+
+      void *ptr = it->ptr;
+      for (const Event &event : it->events) {
+        backend_.DestroyEvent(event);
+      }
+      blocks.erase(std::next(it).base());
+      cached_bytes_ -= bin_size;
+      allocated_bytes_ += bin_size;
+      allocated_blocks_[ptr] = {device, stream, bin_size, {}};
+      return ptr;
+    }
+  }
+
+  // otherwise, allocate a new block, freeing cached memory on failure
+  void *ptr = backend_.Malloc(bin_size, device);
+  if (ptr == nullptr) {
+    ReleaseCached_(0, device);
+    ptr = backend_.Malloc(bin_size, device);
+  }
+
+  if (ptr == nullptr) {
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+    throw std::runtime_error("CachingAllocator: failed to allocate " +
+                             std::to_string(bin_size) + " bytes on device " +
+                             std::to_string(device) + ".");
+#endif
+    return nullptr;
+  }
+
+  allocated_bytes_ += bin_size;
+  allocated_blocks_[ptr] = {device, stream, bin_size, {}};
+  return ptr;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+inline void *CachingAllocator<Backend>::AllocatePitched(size_t width_in_bytes,
+                                                        size_t num_rows,
+                                                        int device,
+                                                        cudaStream_t stream,
+                                                        size_t *pitch) {
+  size_t alignment;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry = pitch_alignment_.find(device);
+    if (entry == pitch_alignment_.end()) {
+      entry = pitch_alignment_
+                  .insert(std::make_pair(device,
+                                         backend_.PitchAlignment(device)))
+                  .first;
+    }
+    alignment = entry->second;
+  }
+
+  *pitch = (width_in_bytes + alignment - 1) / alignment * alignment;
+  return Allocate(*pitch * num_rows, device, stream);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+inline void CachingAllocator<Backend>::Free(void *ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto entry = allocated_blocks_.find(ptr);
+  if (entry == allocated_blocks_.end()) {
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+    throw std::runtime_error(
+        "CachingAllocator: freed pointer was not allocated by this object.");
+#endif
+    return;
+  }
+
+  const Block block = entry->second;
+  allocated_blocks_.erase(entry);
+  allocated_bytes_ -= block.size_in_bytes;
+
+  if (block.size_in_bytes > max_cached_bytes_) {
+    backend_.Free(ptr, block.device);
+    return;
+  }
+
+  // make room in the cache, if necessary
+  if (cached_bytes_ + block.size_in_bytes > max_cached_bytes_) {
+    ReleaseCached_(max_cached_bytes_ - block.size_in_bytes);
+  }
+
+  CachedBlock cached_block = {ptr, {}};
+  for (cudaStream_t stream : block.other_streams) {
+    cached_block.events.push_back(backend_.RecordEvent(stream, block.device));
+  }
+
+  cached_blocks_[BinKey(block.device, block.stream, block.size_in_bytes)]
+      .push_back(cached_block);
+  cached_bytes_ += block.size_in_bytes;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+inline void CachingAllocator<Backend>::RecordStream(void *ptr,
+                                                    cudaStream_t stream) {
+  if (ptr == nullptr) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto entry = allocated_blocks_.find(ptr);
+  if (entry == allocated_blocks_.end()) {
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+    throw std::runtime_error(
+        "CachingAllocator: recorded pointer was not allocated by this object.");
+#endif
+    return;
+  }
+
+  Block &block = entry->second;
+  if (stream != block.stream &&
+      std::find(block.other_streams.begin(), block.other_streams.end(),
+                stream) == block.other_streams.end()) {
+    block.other_streams.push_back(stream);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+inline void CachingAllocator<Backend>::Trim() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ReleaseCached_(0);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+inline void CachingAllocator<Backend>::Trim(int device) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ReleaseCached_(0, device);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+inline void CachingAllocator<Backend>::SetMaxCachedBytes(
+    size_t max_cached_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_cached_bytes_ = max_cached_bytes;
+  if (cached_bytes_ > max_cached_bytes_) {
+    ReleaseCached_(max_cached_bytes_);
+  }
+}
+
+//------------------------------------------------------------------------------
+//
+// private method implementations
+//
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+inline void CachingAllocator<Backend>::ReleaseCached_(size_t target_bytes,
+                                                      int device) {
+  for (auto bin = cached_blocks_.rbegin();
+       bin != cached_blocks_.rend() && cached_bytes_ > target_bytes; ++bin) {
+    const int bin_device = std::get<0>(bin->first);
+    const size_t bin_size = std::get<2>(bin->first);
+    if (device != -1 && bin_device != device) {
+      continue;
+    }
+
+    // cudaFree() waits for all outstanding work on the device, so blocks can
+    // be released even if their events have not completed yet
+    std::vector<CachedBlock> &blocks = bin->second;
+    while (!blocks.empty() && cached_bytes_ > target_bytes) {
+      for (const Event &event : blocks.back().events) {
+        backend_.DestroyEvent(event);
+      }
+      backend_.Free(blocks.back().ptr, bin_device);
+      blocks.pop_back();
+      cached_bytes_ -= bin_size;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace cua
+
+#endif  // LIBCUA_CACHING_ALLOCATOR_H_
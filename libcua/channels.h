@@ -0,0 +1,140 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_CHANNELS_H_
+#define LIBCUA_CHANNELS_H_
+
+#include <cmath>
+#include <type_traits>
+
+namespace cua {
+
+namespace internal {
+
+//------------------------------------------------------------------------------
+
+// Filtering operations (mipmap generation, convolution, etc.) process the
+// elements of vector types, e.g., uchar4, channel by channel, with float
+// accumulation. ChannelTraits describes the channels of an element type.
+template <typename T>
+struct ChannelTraits {
+  typedef T Component;
+  static const int kNumChannels = 1;
+};
+
+#define LIBCUA_CHANNEL_TRAITS(TYPE, COMPONENT_TYPE, NUM_CHANNELS) \
+  template <>                                                     \
+  struct ChannelTraits<TYPE> {                                    \
+    typedef COMPONENT_TYPE Component;                             \
+    static const int kNumChannels = NUM_CHANNELS;                 \
+  };
+
+LIBCUA_CHANNEL_TRAITS(char2, signed char, 2)
+LIBCUA_CHANNEL_TRAITS(char4, signed char, 4)
+LIBCUA_CHANNEL_TRAITS(uchar2, unsigned char, 2)
+LIBCUA_CHANNEL_TRAITS(uchar4, unsigned char, 4)
+LIBCUA_CHANNEL_TRAITS(short2, short, 2)
+LIBCUA_CHANNEL_TRAITS(short4, short, 4)
+LIBCUA_CHANNEL_TRAITS(ushort2, unsigned short, 2)
+LIBCUA_CHANNEL_TRAITS(ushort4, unsigned short, 4)
+LIBCUA_CHANNEL_TRAITS(int2, int, 2)
+LIBCUA_CHANNEL_TRAITS(int4, int, 4)
+LIBCUA_CHANNEL_TRAITS(uint2, unsigned int, 2)
+LIBCUA_CHANNEL_TRAITS(uint4, unsigned int, 4)
+LIBCUA_CHANNEL_TRAITS(float2, float, 2)
+LIBCUA_CHANNEL_TRAITS(float4, float, 4)
+
+#undef LIBCUA_CHANNEL_TRAITS
+
+// Integer channels are rounded to the nearest value.
+template <typename Component>
+__host__ __device__ inline Component RoundToComponent(const float value) {
+  return static_cast<Component>(
+      std::is_integral<Component>::value ? floorf(value + 0.5f) : value);
+}
+
+//------------------------------------------------------------------------------
+
+// Element with NumChannels float channels; this is the intermediate type of
+// multi-pass filters. FloatChannels is itself a valid element type, so that
+// conversions to and from it are identities.
+template <int NumChannels>
+struct FloatChannels {
+  float value[NumChannels];
+};
+
+template <int NumChannels>
+struct ChannelTraits<FloatChannels<NumChannels>> {
+  typedef float Component;
+  static const int kNumChannels = NumChannels;
+};
+
+// FloatChannels type with the same number of channels as T
+template <typename T>
+struct FloatChannelsOf {
+  typedef FloatChannels<ChannelTraits<T>::kNumChannels> type;
+};
+
+template <typename T>
+__host__ __device__ inline typename FloatChannelsOf<T>::type ToFloatChannels(
+    const T &value) {
+  typedef typename ChannelTraits<T>::Component Component;
+  const Component *components = reinterpret_cast<const Component *>(&value);
+  typename FloatChannelsOf<T>::type result;
+  for (int c = 0; c < ChannelTraits<T>::kNumChannels; ++c) {
+    result.value[c] = static_cast<float>(components[c]);
+  }
+  return result;
+}
+
+template <typename T>
+__host__ __device__ inline T FromFloatChannels(
+    const typename FloatChannelsOf<T>::type &value) {
+  typedef typename ChannelTraits<T>::Component Component;
+  T result;
+  Component *components = reinterpret_cast<Component *>(&result);
+  for (int c = 0; c < ChannelTraits<T>::kNumChannels; ++c) {
+    components[c] = RoundToComponent<Component>(value.value[c]);
+  }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace internal
+
+}  // namespace cua
+
+#endif  // LIBCUA_CHANNELS_H_
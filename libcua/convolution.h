@@ -0,0 +1,725 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_CONVOLUTION_H_
+#define LIBCUA_CONVOLUTION_H_
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "cachingAllocator.h"
+#include "channels.h"
+#include "deviceView.h"
+#include "hostThreadPool.h"
+#include "util.h"
+
+namespace cua {
+
+/**
+ * Handling of the elements outside of the source array in a convolution, e.g.,
+ * CudaArray2DBase::SeparableConvolve(). For a size-n axis, the element read at
+ * position i < 0 or i >= n is
+ */
+enum class ConvolutionBorder {
+  /// as given by the boundary mode of the source array: kZero for surfaces with
+  /// cudaBoundaryModeZero, and kClamp for all other arrays (default)
+  kFromArray,
+  /// the nearest edge element
+  kClamp,
+  /// zero
+  kZero,
+  /// the element mirrored about the edge element, e.g., element 1 for i = -1
+  /// and element n - 2 for i = n
+  kMirror,
+  /// element i mod n
+  kWrap
+};
+
+/// largest supported radius of a convolution kernel; this bounds the size of
+/// the shared-memory tiles of the convolution kernels
+const unsigned int kMaxConvolutionRadius = 16;
+
+/**
+ * @struct ConvolutionTaps
+ * @brief Weights of a one-dimensional convolution kernel with 2 * Radius + 1
+ * taps.
+ *
+ * The taps are applied as a correlation: output element x is the sum over k of
+ * value[k] times input element x + k - Radius. For example,
+ *
+ *     const cua::ConvolutionTaps<1> derivative = {{-0.5f, 0.f, 0.5f}};
+ *
+ * Every radius has its own kernel instantiation with a fully unrolled tap loop.
+ * The taps are passed to the kernels by value, so the GPU reads them from
+ * constant memory, where all threads of a warp receive the same tap in one
+ * broadcast.
+ */
+template <unsigned int Radius>
+struct ConvolutionTaps {
+  static const unsigned int kRadius = Radius;
+  static const unsigned int kNumTaps = 2 * Radius + 1;
+
+  float value[kNumTaps];
+};
+
+/**
+ * @param sigma standard deviation of the Gaussian, in elements
+ * @return sampled Gaussian taps, normalized to sum to one
+ */
+template <unsigned int Radius>
+inline ConvolutionTaps<Radius> GaussianTaps(const float sigma) {
+  ConvolutionTaps<Radius> taps;
+  float sum = 0.f;
+  for (unsigned int k = 0; k < taps.kNumTaps; ++k) {
+    const float x = static_cast<float>(k) - static_cast<float>(Radius);
+    taps.value[k] = std::exp(-0.5f * x * x / (sigma * sigma));
+    sum += taps.value[k];
+  }
+  for (unsigned int k = 0; k < taps.kNumTaps; ++k) {
+    taps.value[k] /= sum;
+  }
+  return taps;
+}
+
+/**
+ * @return box filter taps, i.e., all taps equal to 1 / (2 * Radius + 1)
+ */
+template <unsigned int Radius>
+inline ConvolutionTaps<Radius> BoxTaps() {
+  ConvolutionTaps<Radius> taps;
+  for (unsigned int k = 0; k < taps.kNumTaps; ++k) {
+    taps.value[k] = 1.f / taps.kNumTaps;
+  }
+  return taps;
+}
+
+namespace internal {
+
+//------------------------------------------------------------------------------
+
+//
+// border handling
+//
+
+// Index of element i of a size-n axis under the given border policy, which
+// must not be kFromArray; -1 stands for a zero element.
+__host__ __device__ inline int ConvolutionIndex(
+    int i, const int n, const ConvolutionBorder border) {
+  if (i >= 0 && i < n) {
+    return i;
+  }
+
+  switch (border) {
+    case ConvolutionBorder::kZero:
+      return -1;
+    case ConvolutionBorder::kMirror: {
+      if (n == 1) {
+        return 0;
+      }
+      const int period = 2 * (n - 1);
+      i %= period;
+      i = (i < 0) ? i + period : i;
+      return (i < n) ? i : period - i;
+    }
+    case ConvolutionBorder::kWrap:
+      i %= n;
+      return (i < 0) ? i + n : i;
+    default:
+      return (i < 0) ? 0 : n - 1;
+  }
+}
+
+// border policy of arrays with a BoundaryMode(), i.e., surfaces
+template <typename CudaArrayClass>
+inline auto ArrayConvolutionBorder(const CudaArrayClass &array, int)
+    -> decltype(array.BoundaryMode(), ConvolutionBorder()) {
+  return (array.BoundaryMode() == cudaBoundaryModeZero)
+             ? ConvolutionBorder::kZero
+             : ConvolutionBorder::kClamp;
+}
+
+template <typename CudaArrayClass>
+inline ConvolutionBorder ArrayConvolutionBorder(const CudaArrayClass &, long) {
+  return ConvolutionBorder::kClamp;
+}
+
+// replaces kFromArray with the policy of the given source array
+template <typename CudaArrayClass>
+inline ConvolutionBorder ResolveConvolutionBorder(
+    const CudaArrayClass &array, const ConvolutionBorder border) {
+  return (border == ConvolutionBorder::kFromArray)
+             ? ArrayConvolutionBorder(array, 0)
+             : border;
+}
+
+//------------------------------------------------------------------------------
+
+//
+// Presents a 2D array (or device view) as a 3D array of depth one, so that all
+// passes of 2D and 3D convolutions share the same implementation.
+//
+template <typename CudaArrayClass>
+class ConvolutionSlice {
+ public:
+  typedef typename CudaArrayClass::Scalar Scalar;
+
+  __host__ __device__ explicit ConvolutionSlice(const CudaArrayClass &array)
+      : array_(array) {}
+
+  LIBCUA_EXEC_CHECK_DISABLE
+  __host__ __device__ inline Scalar get(const int x, const int y,
+                                        const int) const {
+    return array_.get(x, y);
+  }
+
+  LIBCUA_EXEC_CHECK_DISABLE
+  __host__ __device__ inline void set(const int x, const int y, const int,
+                                      const Scalar &value) {
+    array_.set(x, y, value);
+  }
+
+  __host__ __device__ inline int Width() const { return array_.Width(); }
+  __host__ __device__ inline int Height() const { return array_.Height(); }
+  __host__ __device__ inline int Depth() const { return 1; }
+
+ private:
+  CudaArrayClass array_;
+};
+
+// host passes use a reference to the array, rather than a copy
+template <typename CudaArrayClass>
+class ConvolutionSlice<CudaArrayClass &> {
+ public:
+  typedef typename CudaArrayClass::Scalar Scalar;
+
+  explicit ConvolutionSlice(CudaArrayClass &array) : array_(array) {}
+
+  inline Scalar get(const int x, const int y, const int) const {
+    return array_.get(x, y);
+  }
+
+  inline void set(const int x, const int y, const int, const Scalar &value) {
+    array_.set(x, y, value);
+  }
+
+  inline int Width() const { return array_.Width(); }
+  inline int Height() const { return array_.Height(); }
+  inline int Depth() const { return 1; }
+
+ private:
+  CudaArrayClass &array_;
+};
+
+//------------------------------------------------------------------------------
+
+//
+// Block and shared-memory tile shape of the convolution kernel along an axis
+// (0, 1, or 2 for x, y, or z). Each thread computes kSteps outputs spaced one
+// block apart along the axis, so that the 2 * Radius halo elements loaded by a
+// block are amortized over kSteps times as many outputs. Warps always span x,
+// so that reads and writes are coalesced.
+//
+template <int Axis, unsigned int Radius>
+struct ConvolutionTile {
+  static const int kSteps = 4;
+  static const int kHalo = 2 * static_cast<int>(Radius);
+
+  static const int kBlockX = 32;
+  static const int kBlockY = (Axis == 2) ? 1 : 8;
+  static const int kBlockZ = (Axis == 2) ? 8 : 1;
+
+  // outputs per block
+  static const int kSizeX = kBlockX * ((Axis == 0) ? kSteps : 1);
+  static const int kSizeY = kBlockY * ((Axis == 1) ? kSteps : 1);
+  static const int kSizeZ = kBlockZ * ((Axis == 2) ? kSteps : 1);
+
+  // inputs per block, including the halo
+  static const int kTileX = kSizeX + ((Axis == 0) ? kHalo : 0);
+  static const int kTileY = kSizeY + ((Axis == 1) ? kHalo : 0);
+  static const int kTileZ = kSizeZ + ((Axis == 2) ? kHalo : 0);
+};
+
+//------------------------------------------------------------------------------
+
+template <typename T1, typename T2>
+inline void CheckConvolutionSize2D(const T1 &src, const T2 &dst) {
+  static_assert(ChannelTraits<typename T1::Scalar>::kNumChannels ==
+                    ChannelTraits<typename T2::Scalar>::kNumChannels,
+                "Arrays have different numbers of channels.");
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (src.Width() != dst.Width() || src.Height() != dst.Height()) {
+    throw std::runtime_error("Arrays have different sizes (" +
+                             ArraySizeToString2D(src) + " vs " +
+                             ArraySizeToString2D(dst) + ").");
+  }
+#endif
+}
+
+template <typename T1, typename T2>
+inline void CheckConvolutionSize3D(const T1 &src, const T2 &dst) {
+  static_assert(ChannelTraits<typename T1::Scalar>::kNumChannels ==
+                    ChannelTraits<typename T2::Scalar>::kNumChannels,
+                "Arrays have different numbers of channels.");
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (src.Width() != dst.Width() || src.Height() != dst.Height() ||
+      src.Depth() != dst.Depth()) {
+    throw std::runtime_error("Arrays have different sizes (" +
+                             ArraySizeToString3D(src) + " vs " +
+                             ArraySizeToString3D(dst) + ").");
+  }
+#endif
+}
+
+}  // namespace internal
+
+//------------------------------------------------------------------------------
+//
+// kernel definitions
+//
+//------------------------------------------------------------------------------
+
+namespace kernel {
+
+//
+// dst = src convolved with taps along the given axis; src and dst present a 3D
+// interface (see internal::ConvolutionSlice)
+//
+template <int Axis, unsigned int Radius, typename SrcCls, typename DstCls>
+__global__ void SeparableConvolve(const SrcCls src, DstCls dst,
+                                  const ConvolutionTaps<Radius> taps,
+                                  const ConvolutionBorder border) {
+  typedef internal::ConvolutionTile<Axis, Radius> Tile;
+  typedef typename internal::FloatChannelsOf<typename SrcCls::Scalar>::type
+      Accumulator;
+  const int kNumChannels =
+      internal::ChannelTraits<typename SrcCls::Scalar>::kNumChannels;
+
+  __shared__ Accumulator tile[Tile::kTileZ][Tile::kTileY][Tile::kTileX];
+
+  const int w = src.Width(), h = src.Height(), d = src.Depth();
+  const int x0 = blockIdx.x * Tile::kSizeX;
+  const int y0 = blockIdx.y * Tile::kSizeY;
+  const int z0 = blockIdx.z * Tile::kSizeZ;
+
+  // load the tile, with its halo along the axis of convolution
+  const int r = static_cast<int>(Radius);
+  const int tile_x0 = x0 - ((Axis == 0) ? r : 0);
+  const int tile_y0 = y0 - ((Axis == 1) ? r : 0);
+  const int tile_z0 = z0 - ((Axis == 2) ? r : 0);
+
+  for (int k = threadIdx.z; k < Tile::kTileZ; k += Tile::kBlockZ) {
+    const int z = internal::ConvolutionIndex(tile_z0 + k, d, border);
+    for (int j = threadIdx.y; j < Tile::kTileY; j += Tile::kBlockY) {
+      const int y = internal::ConvolutionIndex(tile_y0 + j, h, border);
+      for (int i = threadIdx.x; i < Tile::kTileX; i += Tile::kBlockX) {
+        const int x = internal::ConvolutionIndex(tile_x0 + i, w, border);
+        if (x >= 0 && y >= 0 && z >= 0) {
+          tile[k][j][i] = internal::ToFloatChannels(src.get(x, y, z));
+        } else {
+          for (int c = 0; c < kNumChannels; ++c) {
+            tile[k][j][i].value[c] = 0.f;
+          }
+        }
+      }
+    }
+  }
+
+  __syncthreads();
+
+  for (int k = threadIdx.z; k < Tile::kSizeZ; k += Tile::kBlockZ) {
+    for (int j = threadIdx.y; j < Tile::kSizeY; j += Tile::kBlockY) {
+      for (int i = threadIdx.x; i < Tile::kSizeX; i += Tile::kBlockX) {
+        const int x = x0 + i, y = y0 + j, z = z0 + k;
+        if (x >= w || y >= h || z >= d) {
+          continue;
+        }
+
+        Accumulator sum;
+        for (int c = 0; c < kNumChannels; ++c) {
+          sum.value[c] = 0.f;
+        }
+
+#pragma unroll
+        for (int t = 0; t < static_cast<int>(taps.kNumTaps); ++t) {
+          const Accumulator &value =
+              tile[k + ((Axis == 2) ? t : 0)][j + ((Axis == 1) ? t : 0)]
+                  [i + ((Axis == 0) ? t : 0)];
+          for (int c = 0; c < kNumChannels; ++c) {
+            sum.value[c] += taps.value[t] * value.value[c];
+          }
+        }
+
+        dst.set(x, y, z,
+                internal::FromFloatChannels<typename DstCls::Scalar>(sum));
+      }
+    }
+  }
+}
+
+}  // namespace kernel
+
+//------------------------------------------------------------------------------
+//
+// host implementations
+//
+//------------------------------------------------------------------------------
+
+namespace internal {
+
+//
+// The host passes work on planes of float channels, stored row by row with
+// interleaved channels. Each output row is a sum of whole input rows weighted
+// by the taps, accumulated in the same tap order as the kernels; the inner
+// loops run over contiguous floats without branches, so that the compiler
+// vectorizes them.
+//
+
+// out[j] += weight * in[j], j = 0, ..., n - 1
+inline void AccumulateRow(const float weight, const float *in, const size_t n,
+                          float *out) {
+  for (size_t j = 0; j < n; ++j) {
+    out[j] += weight * in[j];
+  }
+}
+
+//
+// out = src convolved with taps along x, for all rows of src
+//
+template <unsigned int Radius, typename SrcCls>
+inline void HostConvolveX(const SrcCls &src,
+                          const ConvolutionTaps<Radius> &taps,
+                          const ConvolutionBorder border,
+                          std::vector<float> *out) {
+  typedef typename SrcCls::Scalar Scalar;
+  const int kNumChannels = ChannelTraits<Scalar>::kNumChannels;
+  const int r = static_cast<int>(Radius);
+  const int w = src.Width(), h = src.Height();
+  const size_t row_size = static_cast<size_t>(w) * kNumChannels;
+
+  out->resize(row_size * h * src.Depth());
+  ParallelForRows(h * src.Depth(), w, [&](size_t i0, size_t i1) {
+    // one source row, including the border
+    std::vector<float> line((w + 2 * r) * kNumChannels);
+    for (size_t i = i0; i < i1; ++i) {
+      const int y = i % h, z = i / h;
+      for (int j = 0; j < w + 2 * r; ++j) {
+        const int x = ConvolutionIndex(j - r, w, border);
+        float *element = line.data() + j * kNumChannels;
+        if (x >= 0) {
+          const typename FloatChannelsOf<Scalar>::type value =
+              ToFloatChannels(src.get(x, y, z));
+          std::copy(value.value, value.value + kNumChannels, element);
+        } else {
+          std::fill(element, element + kNumChannels, 0.f);
+        }
+      }
+
+      float *out_row = out->data() + i * row_size;
+      std::fill(out_row, out_row + row_size, 0.f);
+      for (unsigned int t = 0; t < taps.kNumTaps; ++t) {
+        AccumulateRow(taps.value[t], line.data() + t * kNumChannels, row_size,
+                      out_row);
+      }
+    }
+  });
+}
+
+//
+// convolve a plane from HostConvolveX() with taps along y (Axis = 1) or z
+// (Axis = 2), and pass each output row i = z * height + y to
+// sink(i, const float *row)
+//
+template <int Axis, unsigned int Radius, typename Sink>
+inline void HostConvolveRows(const std::vector<float> &in, const int width,
+                             const int height, const int depth,
+                             const int num_channels,
+                             const ConvolutionTaps<Radius> &taps,
+                             const ConvolutionBorder border, const Sink &sink) {
+  const int r = static_cast<int>(Radius);
+  const size_t row_size = static_cast<size_t>(width) * num_channels;
+
+  ParallelForRows(height * depth, width, [&](size_t i0, size_t i1) {
+    std::vector<float> out_row(row_size);
+    for (size_t i = i0; i < i1; ++i) {
+      const int y = i % height, z = i / height;
+      std::fill(out_row.begin(), out_row.end(), 0.f);
+      for (unsigned int t = 0; t < taps.kNumTaps; ++t) {
+        const int offset = static_cast<int>(t) - r;
+        const int src_y =
+            (Axis == 1) ? ConvolutionIndex(y + offset, height, border) : y;
+        const int src_z =
+            (Axis == 2) ? ConvolutionIndex(z + offset, depth, border) : z;
+        if (src_y >= 0 && src_z >= 0) {
+          AccumulateRow(taps.value[t],
+                        in.data() + (src_z * height + src_y) * row_size,
+                        row_size, out_row.data());
+        }
+      }
+      sink(i, out_row.data());
+    }
+  });
+}
+
+//
+// sinks for HostConvolveRows()
+//
+
+// copy each row into a plane
+class ConvolutionPlaneSink {
+ public:
+  ConvolutionPlaneSink(std::vector<float> *plane, size_t row_size)
+      : plane_(plane), row_size_(row_size) {}
+
+  inline void operator()(size_t i, const float *row) const {
+    std::copy(row, row + row_size_, plane_->data() + i * row_size_);
+  }
+
+ private:
+  std::vector<float> *plane_;
+  size_t row_size_;
+};
+
+// convert each row to the scalar type of a destination array
+template <typename DstCls>
+class ConvolutionArraySink {
+ public:
+  typedef typename DstCls::Scalar Scalar;
+  typedef typename FloatChannelsOf<Scalar>::type Accumulator;
+
+  explicit ConvolutionArraySink(DstCls &dst) : dst_(dst) {}
+
+  inline void operator()(size_t i, const float *row) const {
+    const int kNumChannels = ChannelTraits<Scalar>::kNumChannels;
+    const int w = dst_.Width(), h = dst_.Height();
+    const int y = i % h, z = i / h;
+    for (int x = 0; x < w; ++x) {
+      Accumulator value;
+      for (int c = 0; c < kNumChannels; ++c) {
+        value.value[c] = row[x * kNumChannels + c];
+      }
+      dst_.set(x, y, z, FromFloatChannels<Scalar>(value));
+    }
+  }
+
+ private:
+  DstCls &dst_;
+};
+
+}  // namespace internal
+
+namespace host {
+
+/**
+ * Host implementation of CudaArray2DBase::SeparableConvolve(), e.g., for
+ * CudaHostArray2D objects. This computes the same values as the kernels, up to
+ * floating-point rounding; it is also a reference for testing them.
+ * @param src source array
+ * @param dst destination array of the same size as src; this may be src itself
+ * @param taps_x taps along x
+ * @param taps_y taps along y
+ * @param border handling of elements outside of src
+ */
+template <unsigned int RadiusX, unsigned int RadiusY, typename SrcCls,
+          typename DstCls>
+inline void SeparableConvolve2D(const SrcCls &src, DstCls &dst,
+                                const ConvolutionTaps<RadiusX> &taps_x,
+                                const ConvolutionTaps<RadiusY> &taps_y,
+                                ConvolutionBorder border) {
+  internal::CheckConvolutionSize2D(src, dst);
+  border = internal::ResolveConvolutionBorder(src, border);
+  const int kNumChannels =
+      internal::ChannelTraits<typename SrcCls::Scalar>::kNumChannels;
+
+  std::vector<float> plane;
+  internal::HostConvolveX(internal::ConvolutionSlice<const SrcCls &>(src),
+                          taps_x, border, &plane);
+
+  internal::ConvolutionSlice<DstCls &> dst_slice(dst);
+  internal::HostConvolveRows<1>(
+      plane, src.Width(), src.Height(), 1, kNumChannels, taps_y, border,
+      internal::ConvolutionArraySink<internal::ConvolutionSlice<DstCls &>>(
+          dst_slice));
+}
+
+/**
+ * Host implementation of CudaArray3DBase::SeparableConvolve(); see
+ * SeparableConvolve2D().
+ * @param src source array
+ * @param dst destination array of the same size as src; this may be src itself
+ * @param taps_x taps along x
+ * @param taps_y taps along y
+ * @param taps_z taps along z
+ * @param border handling of elements outside of src
+ */
+template <unsigned int RadiusX, unsigned int RadiusY, unsigned int RadiusZ,
+          typename SrcCls, typename DstCls>
+inline void SeparableConvolve3D(const SrcCls &src, DstCls &dst,
+                                const ConvolutionTaps<RadiusX> &taps_x,
+                                const ConvolutionTaps<RadiusY> &taps_y,
+                                const ConvolutionTaps<RadiusZ> &taps_z,
+                                ConvolutionBorder border) {
+  internal::CheckConvolutionSize3D(src, dst);
+  border = internal::ResolveConvolutionBorder(src, border);
+  const int kNumChannels =
+      internal::ChannelTraits<typename SrcCls::Scalar>::kNumChannels;
+  const int w = src.Width(), h = src.Height(), d = src.Depth();
+
+  std::vector<float> plane_x, plane_y;
+  internal::HostConvolveX(src, taps_x, border, &plane_x);
+  plane_y.resize(plane_x.size());
+  internal::HostConvolveRows<1>(
+      plane_x, w, h, d, kNumChannels, taps_y, border,
+      internal::ConvolutionPlaneSink(&plane_y,
+                                     static_cast<size_t>(w) * kNumChannels));
+  internal::HostConvolveRows<2>(plane_y, w, h, d, kNumChannels, taps_z,
+                                border,
+                                internal::ConvolutionArraySink<DstCls>(dst));
+}
+
+}  // namespace host
+
+//------------------------------------------------------------------------------
+//
+// device implementations
+//
+//------------------------------------------------------------------------------
+
+namespace internal {
+
+//
+// Pitched device memory for the intermediate passes of a convolution. As for
+// GatherScatterScratch, the block goes back to the caching allocator once the
+// passes have been queued and is only reused by later work on the same stream.
+//
+template <typename T>
+class ConvolutionScratch {
+ public:
+  ConvolutionScratch(size_t width, size_t height, size_t depth, int device,
+                     cudaStream_t stream)
+      : width_(width), height_(height), depth_(depth) {
+    data_ = static_cast<T *>(CachingAllocator<>::Instance().AllocatePitched(
+        width * sizeof(T), height * depth, device, stream, &pitch_));
+  }
+
+  ~ConvolutionScratch() { CachingAllocator<>::Instance().Free(data_); }
+
+  inline CudaArray3DDeviceView<T> View() const {
+    return CudaArray3DDeviceView<T>(data_, pitch_, height_, width_, height_,
+                                    depth_);
+  }
+
+ private:
+  ConvolutionScratch(const ConvolutionScratch &) = delete;
+  ConvolutionScratch &operator=(const ConvolutionScratch &) = delete;
+
+  size_t width_, height_, depth_;
+  size_t pitch_;
+  T *data_;
+};
+
+//
+// queue one pass of a separable convolution on the given stream
+//
+template <int Axis, unsigned int Radius, typename SrcCls, typename DstCls>
+inline void SeparableConvolvePass(const SrcCls &src, const DstCls &dst,
+                                  const ConvolutionTaps<Radius> &taps,
+                                  const ConvolutionBorder border,
+                                  cudaStream_t stream) {
+  static_assert(Radius <= kMaxConvolutionRadius,
+                "The convolution radius exceeds kMaxConvolutionRadius.");
+  typedef ConvolutionTile<Axis, Radius> Tile;
+  const dim3 block_dim(Tile::kBlockX, Tile::kBlockY, Tile::kBlockZ);
+  const dim3 grid_dim((dst.Width() + Tile::kSizeX - 1) / Tile::kSizeX,
+                      (dst.Height() + Tile::kSizeY - 1) / Tile::kSizeY,
+                      (dst.Depth() + Tile::kSizeZ - 1) / Tile::kSizeZ);
+  kernel::SeparableConvolve<Axis><<<grid_dim, block_dim, 0, stream>>>(
+      src, dst, taps, border);
+}
+
+//
+// Queue a 2D separable convolution: a pass along x into float scratch memory,
+// followed by a pass along y into dst. The border policy must be resolved.
+//
+template <unsigned int RadiusX, unsigned int RadiusY, typename SrcCls,
+          typename DstCls>
+inline void SeparableConvolve2D(const SrcCls &src, const DstCls &dst,
+                                const ConvolutionTaps<RadiusX> &taps_x,
+                                const ConvolutionTaps<RadiusY> &taps_y,
+                                const ConvolutionBorder border, int device,
+                                cudaStream_t stream) {
+  typedef typename FloatChannelsOf<typename SrcCls::Scalar>::type Accumulator;
+
+  SetDevice(device);
+  ConvolutionScratch<Accumulator> scratch(src.Width(), src.Height(), 1, device,
+                                          stream);
+  SeparableConvolvePass<0>(ConvolutionSlice<SrcCls>(src), scratch.View(),
+                           taps_x, border, stream);
+  SeparableConvolvePass<1>(scratch.View(), ConvolutionSlice<DstCls>(dst),
+                           taps_y, border, stream);
+}
+
+//
+// Queue a 3D separable convolution: passes along x and y into float scratch
+// memory, followed by a pass along z into dst.
+//
+template <unsigned int RadiusX, unsigned int RadiusY, unsigned int RadiusZ,
+          typename SrcCls, typename DstCls>
+inline void SeparableConvolve3D(const SrcCls &src, const DstCls &dst,
+                                const ConvolutionTaps<RadiusX> &taps_x,
+                                const ConvolutionTaps<RadiusY> &taps_y,
+                                const ConvolutionTaps<RadiusZ> &taps_z,
+                                const ConvolutionBorder border, int device,
+                                cudaStream_t stream) {
+  typedef typename FloatChannelsOf<typename SrcCls::Scalar>::type Accumulator;
+
+  SetDevice(device);
+  ConvolutionScratch<Accumulator> scratch_x(src.Width(), src.Height(),
+                                            src.Depth(), device, stream);
+  ConvolutionScratch<Accumulator> scratch_y(src.Width(), src.Height(),
+                                            src.Depth(), device, stream);
+  SeparableConvolvePass<0>(src, scratch_x.View(), taps_x, border, stream);
+  SeparableConvolvePass<1>(scratch_x.View(), scratch_y.View(), taps_y, border,
+                           stream);
+  SeparableConvolvePass<2>(scratch_y.View(), dst, taps_z, border, stream);
+}
+
+}  // namespace internal
+
+}  // namespace cua
+
+#endif  // LIBCUA_CONVOLUTION_H_
@@ -39,8 +39,14 @@
 #include "cudaArray2DBase.h"
 
 #include <memory>  // for shared_ptr
+#include <utility>
 
+#include "cachingAllocator.h"
 #include "cudaArray_fwd.h"
+#include "cudaEvent.h"
+#include "deviceView.h"
+#include "stagingBufferPool.h"
+#include "transpose.h"
 #include "util.h"
 
 namespace cua {
@@ -54,14 +60,23 @@ namespace cua {
  * arrays is a shallow operation. Use `Copy()` or `CopyTo(other)` to perform a
  * deep copy.
  *
- * The arrays can be directly passed into device-level code, i.e., you can write
- * kernels that have CudaArray2D objects in their parameter lists:
+ * Device memory is obtained from `CachingAllocator<>::Instance()`, so creating
+ * and destroying arrays of similar sizes does not synchronize the device. Call
+ * `CachingAllocator<>::Instance().Trim()` to release unused memory.
  *
- *     __global__ void device_kernel(CudaArray2D<float> arr) {
+ * To access the array in your own kernels, pass its DeviceView() (a pointer,
+ * pitch, and extents) as the kernel parameter:
+ *
+ *     __global__ void device_kernel(CudaArray2DDeviceView<float> arr) {
  *       const int x = blockIdx.x * blockDim.x + threadIdx.x;
  *       const int y = blockIdx.y * blockDim.y + threadIdx.y;
  *       arr.set(x, y, 0.0f);
  *     }
+ *
+ *     device_kernel<<<grid_dim, block_dim>>>(array.DeviceView());
+ *
+ * CudaArray2D objects themselves can also still be passed into device-level
+ * code, at the cost of a larger parameter list and of host reference counting.
  */
 template <typename T>
 class CudaArray2D : public CudaArray2DBase<CudaArray2D<T>> {
@@ -139,6 +154,24 @@ class CudaArray2D : public CudaArray2DBase<CudaArray2D<T>> {
    */
   CudaArray2D<T> EmptyFlippedCopy() const;
 
+  /**
+   * Transpose the array in place, swapping its width and height. Square arrays
+   * use CudaArray2DBase::TransposeInPlace(). Otherwise, the pitched rows are
+   * transposed as one matrix whose columns include the padding at the end of
+   * each row; this only needs a few rows of scratch memory, but makes more
+   * passes over the array than Transpose(). Afterwards, the rows are densely
+   * packed, i.e., Pitch() == Height() * sizeof(T). This pitch is generally not
+   * a multiple of the texture pitch alignment, so the array can then no longer
+   * be bound to a CudaPitchedTexture2D; use Transpose() instead if that is
+   * needed. Element types whose size does not divide the pitch fall back to
+   * Transpose() and a new allocation.
+   *
+   * Non-square views, including views at (0, 0) that are narrower or shorter
+   * than the full array, cannot be transposed in place, and any other arrays
+   * that share the memory of a non-square array are invalidated.
+   */
+  void TransposeInPlace();
+
   /**
    * Shallow re-assignment of the given array to share the contents of another.
    * @param other a separate array whose contents will now also be referenced by
@@ -155,6 +188,19 @@ class CudaArray2D : public CudaArray2DBase<CudaArray2D<T>> {
    */
   CudaArray2D<T> &operator=(const T *host_array);
 
+  /**
+   * Evaluate an element-wise array expression into the current array; see
+   * Assign().
+   * @param expression expression over arrays of the same size as this array
+   * @return *this
+   */
+  template <typename Expression>
+  inline CudaArray2D<T> &operator=(
+      const ArrayExpression<Expression> &expression) {
+    Base::Assign(expression);
+    return *this;
+  }
+
   /**
    * Copy the contents of the current array to a CPU-bound memory array. This
    * function assumes that the CPU array has the correct size!
@@ -168,6 +214,12 @@ class CudaArray2D : public CudaArray2DBase<CudaArray2D<T>> {
    */
   void CopyTo(CudaArray2D<T> *other) const;
 
+  /**
+   * Download to a host array (requires cudaHostArray2D.h).
+   * @param other destination array
+   */
+  void CopyTo(CudaHostArray2D<T> *other) const;
+
   /**
    * Copy to a surface.
    * @param other destination surface
@@ -175,11 +227,65 @@ class CudaArray2D : public CudaArray2DBase<CudaArray2D<T>> {
   void CopyTo(CudaSurface2D<T> *other) const;
 
   /**
-   * Copy to a texture.
+   * Copy to a texture. To sample the array through a texture without copying
+   * it, bind a CudaPitchedTexture2D to the array instead.
    * @param other destination texture
    */
   void CopyTo(CudaTexture2D<T> *other) const;
 
+  //----------------------------------------------------------------------------
+  // asynchronous copies
+  //
+  // These functions enqueue the copy on the array's stream and return an event
+  // recorded right after it. Host memory must remain valid until the event has
+  // completed, and it must be page-locked (e.g., a CudaHostArray2D with
+  // HostMemoryType::kPinned) for the copy to overlap with other work.
+
+  /**
+   * Asynchronously copy the contents of a densely packed CPU array to the
+   * current array. This function assumes that the CPU array has the correct
+   * size!
+   * @param host_array the CPU-bound array
+   * @return event that completes with the copy
+   */
+  CudaEvent AssignAsync(const T *host_array);
+
+  /**
+   * Asynchronously copy the contents of the current array to a densely packed
+   * CPU array. This function assumes that the CPU array has the correct size!
+   * @param host_array the CPU-bound array
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(T *host_array) const;
+
+  /**
+   * Asynchronously copy to an array, which may be on another device.
+   * @param other destination array
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(CudaArray2D<T> *other) const;
+
+  /**
+   * Asynchronously download to a host array (requires cudaHostArray2D.h).
+   * @param other destination array
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(CudaHostArray2D<T> *other) const;
+
+  /**
+   * Asynchronously copy to a surface, which may be on another device.
+   * @param other destination surface
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(CudaSurface2D<T> *other) const;
+
+  /**
+   * Asynchronously copy to a texture, which may be on another device.
+   * @param other destination texture
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(CudaTexture2D<T> *other) const;
+
   //----------------------------------------------------------------------------
 
   /**
@@ -200,6 +306,30 @@ class CudaArray2D : public CudaArray2DBase<CudaArray2D<T>> {
   //----------------------------------------------------------------------------
   // getters/setters
 
+  /**
+   * Set the stream used by the array's operations. Since the memory of the
+   * array was allocated for its original stream, the stream is also passed to
+   * RecordStream().
+   * @param stream CUDA stream on the array's device
+   */
+  inline void SetStream(const cudaStream_t stream) {
+    Base::SetStream(stream);
+    RecordStream(stream);
+  }
+
+  /**
+   * Mark the memory of the array as used on the given stream: once the last
+   * array sharing the memory is destroyed, CachingAllocator does not hand the
+   * memory out again until the work queued on the stream by then has
+   * completed. SetStream() and CopyToAsync() call this as needed; call it
+   * directly for other work that accesses the array on a stream other than its
+   * own.
+   * @param stream CUDA stream on the array's device
+   */
+  inline void RecordStream(const cudaStream_t stream) const {
+    CachingAllocator<>::Instance().RecordStream(dev_array_.get(), stream);
+  }
+
   /**
    * Device-level function for getting the address of an element in an array
    * @param x first coordinate, i.e., the column index in a row-major array
@@ -242,6 +372,13 @@ class CudaArray2D : public CudaArray2DBase<CudaArray2D<T>> {
    */
   __host__ __device__ inline size_t Pitch() const { return pitch_; }
 
+  /**
+   * @return trivially copyable view of the array for kernel parameter lists
+   */
+  __host__ __device__ inline CudaArray2DDeviceView<T> DeviceView() const {
+    return CudaArray2DDeviceView<T>(dev_array_ref_, pitch_, width_, height_);
+  }
+
   /**
    * Return a cudaPitchedPtr representation for the underlying allocated memory.
    */
@@ -268,6 +405,10 @@ class CudaArray2D : public CudaArray2DBase<CudaArray2D<T>> {
   std::shared_ptr<T> dev_array_;
   T *dev_array_ref_;  // equivalent to dev_array_.get(); necessary because that
                       // function is not available on the device
+
+  // extents of the full array that owns the allocation; views and copies share
+  // these with the array they were created from
+  SizeType allocation_width_, allocation_height_;
 };
 
 //------------------------------------------------------------------------------
@@ -277,6 +418,7 @@ template <typename T>
 struct CudaArrayTraits<CudaArray2D<T>> {
   typedef T Scalar;
   typedef bool Mutable;
+  typedef CudaArray2DDeviceView<T> DeviceView;
 };
 
 //------------------------------------------------------------------------------
@@ -288,11 +430,17 @@ struct CudaArrayTraits<CudaArray2D<T>> {
 template <typename T>
 CudaArray2D<T>::CudaArray2D<T>(SizeType width, SizeType height, int device,
                                const dim3 block_dim, const cudaStream_t stream)
-    : Base(width, height, device, block_dim, stream), dev_array_(nullptr) {
-  cudaMallocPitch(&dev_array_ref_, &pitch_, sizeof(T) * width_, height_);
+    : Base(width, height, device, block_dim, stream),
+      dev_array_(nullptr),
+      allocation_width_(width),
+      allocation_height_(height) {
+  dev_array_ref_ =
+      reinterpret_cast<T *>(CachingAllocator<>::Instance().AllocatePitched(
+          sizeof(T) * width_, height_, device_, stream_, &pitch_));
 #ifdef __CUDA_ARCH__
 #else
-  dev_array_ = std::shared_ptr<T>(dev_array_ref_, cudaFree);
+  dev_array_ = std::shared_ptr<T>(
+      dev_array_ref_, [](T *ptr) { CachingAllocator<>::Instance().Free(ptr); });
 #endif
 }
 
@@ -308,7 +456,9 @@ __host__ __device__ CudaArray2D<T>::CudaArray2D<T>(const CudaArray2D<T> &other)
 #else
       dev_array_(other.dev_array_),
 #endif
-      dev_array_ref_(other.dev_array_ref_) {
+      dev_array_ref_(other.dev_array_ref_),
+      allocation_width_(other.allocation_width_),
+      allocation_height_(other.allocation_height_) {
 }
 
 //------------------------------------------------------------------------------
@@ -324,7 +474,9 @@ CudaArray2D<T>::CudaArray2D<T>(IndexType x, IndexType y, SizeType width,
 #else
       dev_array_(other.dev_array_),
 #endif
-      dev_array_ref_(const_cast<T *>(other.ptr(x, y))) {
+      dev_array_ref_(const_cast<T *>(other.ptr(x, y))),
+      allocation_width_(other.allocation_width_),
+      allocation_height_(other.allocation_height_) {
 }
 
 //------------------------------------------------------------------------------
@@ -359,6 +511,37 @@ inline CudaArray2D<T> CudaArray2D<T>::EmptyFlippedCopy() const {
 
 //------------------------------------------------------------------------------
 
+template <typename T>
+inline void CudaArray2D<T>::TransposeInPlace() {
+  if (width_ == height_) {
+    Base::TransposeInPlace();
+    return;
+  }
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (dev_array_ref_ != dev_array_.get() || width_ != allocation_width_ ||
+      height_ != allocation_height_) {
+    throw std::runtime_error(
+        "Non-square views cannot be transposed in place.");
+  }
+#endif
+  if (pitch_ % sizeof(T) != 0) {
+    *this = Base::Transpose();
+    return;
+  }
+
+  LIBCUA_INSTRUMENT("CudaArray2D::TransposeInPlace", 2 * height_ * pitch_,
+                    device_, stream_, false);
+  internal::TransposeInPlace(dev_array_ref_, height_, pitch_ / sizeof(T),
+                             device_, stream_);
+  // the former padding columns are now unused rows past the new height
+  pitch_ = height_ * sizeof(T);
+  std::swap(width_, height_);
+  std::swap(allocation_width_, allocation_height_);
+  Base::SetBlockDim(dim3(block_dim_.y, block_dim_.x));
+}
+
+//------------------------------------------------------------------------------
+
 template <typename T>
 inline CudaArray2D<T> &CudaArray2D<T>::operator=(const CudaArray2D<T> &other) {
   if (this == &other) {
@@ -373,6 +556,8 @@ inline CudaArray2D<T> &CudaArray2D<T>::operator=(const CudaArray2D<T> &other) {
   dev_array_ = other.dev_array_;
 #endif
   dev_array_ref_ = other.dev_array_ref_;
+  allocation_width_ = other.allocation_width_;
+  allocation_height_ = other.allocation_height_;
 
   return *this;
 }
@@ -382,10 +567,17 @@ inline CudaArray2D<T> &CudaArray2D<T>::operator=(const CudaArray2D<T> &other) {
 template <typename T>
 inline CudaArray2D<T> &CudaArray2D<T>::operator=(const T *host_array) {
   internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaArray2D::Upload", 2 * sizeof(T) * width_ * height_,
+                    device_, stream_, false);
   const SizeType width_in_bytes = width_ * sizeof(T);
   internal::SetDevice(device_);
-  cudaMemcpy2D(dev_array_ref_, pitch_, host_array, width_in_bytes,
-               width_in_bytes, height_, cudaMemcpyHostToDevice);
+  StagingBufferPool<>::Instance().Upload(
+      host_array, width_in_bytes, height_, stream_,
+      [&](const void *src, size_t y, size_t num_rows, cudaStream_t stream) {
+        cudaMemcpy2DAsync(ptr(0, y), pitch_, src, width_in_bytes,
+                          width_in_bytes, num_rows, cudaMemcpyHostToDevice,
+                          stream);
+      });
 
   return *this;
 }
@@ -395,11 +587,17 @@ inline CudaArray2D<T> &CudaArray2D<T>::operator=(const T *host_array) {
 template <typename T>
 inline void CudaArray2D<T>::CopyTo(T *host_array) const {
   internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaArray2D::Download", 2 * sizeof(T) * width_ * height_,
+                    device_, stream_, false);
   const SizeType width_in_bytes = width_ * sizeof(T);
   internal::SetDevice(device_);
-  const cudaError_t status = cudaPeekAtLastError();
-  cudaMemcpy2D(host_array, width_in_bytes, dev_array_ref_, pitch_,
-               width_in_bytes, height_, cudaMemcpyDeviceToHost);
+  StagingBufferPool<>::Instance().Download(
+      host_array, width_in_bytes, height_, stream_,
+      [&](void *dst, size_t y, size_t num_rows, cudaStream_t stream) {
+        cudaMemcpy2DAsync(dst, width_in_bytes, ptr(0, y), pitch_,
+                          width_in_bytes, num_rows, cudaMemcpyDeviceToHost,
+                          stream);
+      });
 }
 
 //------------------------------------------------------------------------------
@@ -411,6 +609,8 @@ inline void CudaArray2D<T>::CopyTo(CudaArray2D<T> *other) const {
   }
   internal::CheckNotNull(other);
   internal::CheckSizeEqual2D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaArray2D::CopyTo", 2 * sizeof(T) * width_ * height_,
+                    device_, 0, false);
   if (device_ == other->Device()) {
     internal::SetDevice(device_);
     cudaMemcpy2D(other->dev_array_ref_, other->pitch_, dev_array_ref_, pitch_,
@@ -421,13 +621,26 @@ inline void CudaArray2D<T>::CopyTo(CudaArray2D<T> *other) const {
     params.dstPtr = other->GetPitchedPtr();
     params.srcDevice = device_;
     params.srcPtr = GetPitchedPtr();
-    params.extent = make_cudaExtent(width_, height_, 1);
+    params.extent = make_cudaExtent(width_ * sizeof(T), height_, 1);
     cudaMemcpy3DPeer(&params);
   }
 }
 
 //------------------------------------------------------------------------------
 
+template <typename T>
+inline void CudaArray2D<T>::CopyTo(CudaHostArray2D<T> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual2D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaArray2D::Download", 2 * sizeof(T) * width_ * height_,
+                    device_, 0, false);
+  internal::SetDevice(device_);
+  cudaMemcpy2D(other->ptr(), other->Pitch(), dev_array_ref_, pitch_,
+               width_ * sizeof(T), height_, cudaMemcpyDeviceToHost);
+}
+
+//------------------------------------------------------------------------------
+
 template <typename T>
 inline void CudaArray2D<T>::CopyTo(CudaSurface2D<T> *other) const {
   internal::CheckNotNull(other);
@@ -473,6 +686,135 @@ inline void CudaArray2D<T>::CopyTo(CudaTexture2D<T> *other) const {
 
 //------------------------------------------------------------------------------
 
+template <typename T>
+inline CudaEvent CudaArray2D<T>::AssignAsync(const T *host_array) {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaArray2D::UploadAsync",
+                    2 * sizeof(T) * width_ * height_, device_, stream_, false);
+  const SizeType width_in_bytes = width_ * sizeof(T);
+  internal::SetDevice(device_);
+  cudaMemcpy2DAsync(dev_array_ref_, pitch_, host_array, width_in_bytes,
+                    width_in_bytes, height_, cudaMemcpyHostToDevice, stream_);
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaArray2D<T>::CopyToAsync(T *host_array) const {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaArray2D::DownloadAsync",
+                    2 * sizeof(T) * width_ * height_, device_, stream_, false);
+  const SizeType width_in_bytes = width_ * sizeof(T);
+  internal::SetDevice(device_);
+  cudaMemcpy2DAsync(host_array, width_in_bytes, dev_array_ref_, pitch_,
+                    width_in_bytes, height_, cudaMemcpyDeviceToHost, stream_);
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaArray2D<T>::CopyToAsync(CudaArray2D<T> *other) const {
+  if (this == other) {
+    return CudaEvent();
+  }
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual2D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaArray2D::CopyToAsync",
+                    2 * sizeof(T) * width_ * height_, device_, stream_, false);
+  internal::SetDevice(device_);
+  if (device_ == other->Device()) {
+    other->RecordStream(stream_);  // the copy writes other on our stream
+    cudaMemcpy2DAsync(other->dev_array_ref_, other->pitch_, dev_array_ref_,
+                      pitch_, width_ * sizeof(T), height_,
+                      cudaMemcpyDeviceToDevice, stream_);
+  } else {
+    cudaMemcpy3DPeerParms params = {0};
+    params.dstDevice = other->Device();
+    params.dstPtr = other->GetPitchedPtr();
+    params.srcDevice = device_;
+    params.srcPtr = GetPitchedPtr();
+    params.extent = make_cudaExtent(width_ * sizeof(T), height_, 1);
+    cudaMemcpy3DPeerAsync(&params, stream_);
+
+    // the copy writes other from our device, where CachingAllocator cannot
+    // track it; instead, other's stream waits for the copy, so that the memory
+    // of other is not handed out again before the copy has finished
+    const CudaEvent copied = CudaEvent::Record(stream_);
+    internal::SetDevice(other->Device());
+    copied.Wait(other->Stream());
+    return copied;
+  }
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaArray2D<T>::CopyToAsync(CudaHostArray2D<T> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual2D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaArray2D::DownloadAsync",
+                    2 * sizeof(T) * width_ * height_, device_, stream_, false);
+  internal::SetDevice(device_);
+  cudaMemcpy2DAsync(other->ptr(), other->Pitch(), dev_array_ref_, pitch_,
+                    width_ * sizeof(T), height_, cudaMemcpyDeviceToHost,
+                    stream_);
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaArray2D<T>::CopyToAsync(CudaSurface2D<T> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual2D(*this, *other);
+  internal::SetDevice(device_);
+  if (device_ == other->Device()) {
+    cudaMemcpy2DToArrayAsync(other->DeviceArray(),
+                             other->XOffset() * sizeof(T), other->YOffset(),
+                             dev_array_ref_, pitch_, width_ * sizeof(T),
+                             height_, cudaMemcpyDeviceToDevice, stream_);
+  } else {
+    cudaMemcpy3DPeerParms params = {0};
+    params.dstDevice = other->Device();
+    params.dstArray = other->DeviceArray();
+    params.dstPos = make_cudaPos(other->XOffset(), other->YOffset(), 0);
+    params.srcDevice = device_;
+    params.srcPtr = GetPitchedPtr();
+    params.extent = make_cudaExtent(width_, height_, 1);
+    cudaMemcpy3DPeerAsync(&params, stream_);
+  }
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaArray2D<T>::CopyToAsync(CudaTexture2D<T> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual2D(*this, *other);
+  internal::SetDevice(device_);
+  if (device_ == other->Device()) {
+    cudaMemcpy2DToArrayAsync(other->DeviceArray(), 0, 0, dev_array_ref_,
+                             pitch_, width_ * sizeof(T), height_,
+                             cudaMemcpyDeviceToDevice, stream_);
+  } else {
+    cudaMemcpy3DPeerParms params = {0};
+    params.dstDevice = other->Device();
+    params.dstArray = other->DeviceArray();
+    params.dstPos = make_cudaPos(0, 0, 0);
+    params.srcDevice = device_;
+    params.srcPtr = GetPitchedPtr();
+    params.extent = make_cudaExtent(width_, height_, 1);
+    cudaMemcpy3DPeerAsync(&params, stream_);
+  }
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
 }  // namespace cua
 
 #endif  // LIBCUA_CUDA_ARRAY2D_H_
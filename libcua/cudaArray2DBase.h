@@ -37,14 +37,30 @@
 #define LIBCUA_CUDA_ARRAY2D_BASE_H_
 
 #include "cudaArray2DBase_kernels.h"
+#include "cudaArray2DBase_host.h"
 
 #include <memory>  // for shared_ptr
+#include <type_traits>
 
 #include <curand.h>
 #include <curand_kernel.h>
 
+#include "arrayExpression.h"
+#include "blockDimTuner.h"
+#include "convolution.h"
+#include "deviceView.h"
+#include "functional.h"
+#include "gatherScatter.h"
+#include "histogram.h"
+#include "instrumentation.h"
+#include "launchConfig.h"
+#include "philox.h"
+#include "reduction.h"
+#include "scan.h"
+#include "stencil.h"
 #include "types.h"
 #include "util.h"
+#include "zip.h"
 
 namespace cua {
 
@@ -99,7 +115,20 @@ struct CudaArrayTraits;  // forward declaration
  *     struct CudaArrayTraits<Derived<T>> {
  *       typedef T Scalar;
  *       typedef bool Mutable;  // defined for read-write derived classes
+ *       typedef std::true_type IsHost;  // optional; see below
+ *       typedef DerivedDeviceView<T> DeviceView;  // optional; see below
  *     };
+ *
+ * Derived classes that declare `DeviceView` in their traits also implement
+ * `DeviceView DeviceView() const`, which returns a trivially copyable view of
+ * the array (see deviceView.h). Kernels are then launched with the view instead
+ * of a copy of the array object itself.
+ *
+ * Derived classes whose data lives in host memory (e.g., CudaHostArray2D)
+ * declare `IsHost` as std::true_type in their traits. For these classes, all
+ * of the operations below run on a pool of CPU threads instead of launching
+ * kernels, and get() and set() must be callable from host code. Functions
+ * passed to ApplyOp() must then be callable on the host, as well.
  */
 template <typename Derived>
 class CudaArray2DBase {
@@ -116,6 +145,19 @@ class CudaArray2DBase {
   /// index type of the array
   typedef LIBCUA_DEFAULT_INDEX_TYPE IndexType;
 
+  /// element position used by GetValues() and SetValues()
+  typedef Coordinate2D<IndexType> Coordinate;
+
+  /// std::true_type if the array operations run on the host, rather than on
+  /// the GPU
+  typedef typename internal::IsHostArray<Derived>::type IsHost;
+
+  /// type that represents the array in the parameter lists of kernels
+  typedef typename internal::DeviceViewOf<Derived>::type DeviceViewType;
+
+  /// type returned by Sum(); wider than Scalar for integral types
+  typedef typename internal::SumTraits<Scalar>::type SumType;
+
   /// default block dimensions for general operations
   static const dim3 kBlockDim;
 
@@ -152,6 +194,7 @@ class CudaArray2DBase {
         height_(other.height_),
         block_dim_(other.block_dim_),
         grid_dim_(other.grid_dim_),
+        launch_mode_(other.launch_mode_),
         device_(other.device_),
         stream_(other.stream_) {}
 
@@ -230,7 +273,7 @@ class CudaArray2DBase {
    */
   ENABLE_IF_MUTABLE
   inline Derived Rot90_CCW() const {
-    Derived result = derived().EmptyFlippedCopy(device_);
+    Derived result = derived().EmptyFlippedCopy();
     Rot90_CCW(&result);
     return result;
   }
@@ -240,7 +283,7 @@ class CudaArray2DBase {
    */
   ENABLE_IF_MUTABLE
   inline Derived Rot90_CW() const {
-    Derived result = derived().EmptyFlippedCopy(device_);
+    Derived result = derived().EmptyFlippedCopy();
     Rot90_CW(&result);
     return result;
   }
@@ -250,7 +293,7 @@ class CudaArray2DBase {
    */
   ENABLE_IF_MUTABLE
   inline Derived Transpose() const {
-    Derived result = derived().EmptyFlippedCopy(device_);
+    Derived result = derived().EmptyFlippedCopy();
     Transpose(&result);
     return result;
   }
@@ -308,15 +351,38 @@ class CudaArray2DBase {
   ENABLE_IF_MUTABLE
   void Transpose(Derived *other) const;
 
+  /**
+   * Rotate the current array 90 degrees counterclockwise in place; see
+   * TransposeInPlace() for the supported sizes.
+   */
+  ENABLE_IF_MUTABLE
+  void Rot90_CCWInPlace();
+
+  /**
+   * Rotate the current array 90 degrees clockwise in place; see
+   * TransposeInPlace() for the supported sizes.
+   */
+  ENABLE_IF_MUTABLE
+  void Rot90_CWInPlace();
+
+  /**
+   * Transpose the current array in place, without the second array needed by
+   * Transpose(). The array must be square, in which case mirrored pairs of
+   * tiles are swapped through shared memory; CudaArray2D additionally supports
+   * other sizes (see CudaArray2D::TransposeInPlace()).
+   */
+  ENABLE_IF_MUTABLE
+  void TransposeInPlace();
+
   /**
    * Fill the array with a constant value.
    * @param value every element in the array is set to value
    */
   ENABLE_IF_MUTABLE
   inline void Fill(const Scalar value) {
-    internal::SetDevice(device_);
-    kernel::CudaArray2DBaseFill<<<grid_dim_, block_dim_, 0, stream_>>>(
-        derived(), value);
+    LIBCUA_INSTRUMENT("CudaArray2DBase::Fill", Size() * sizeof(Scalar), device_,
+                      stream_, IsHost::value);
+    Fill_(value, IsHost());
   }
 
   /**
@@ -327,23 +393,69 @@ class CudaArray2DBase {
    */
   template <typename CurandStateArrayType, typename RandomFunction,
             class C = CudaArrayTraits<Derived>,
-            typename C::Mutable is_mutable = true>
+            typename C::Mutable is_mutable = true,
+            typename std::enable_if<
+                !std::is_arithmetic<CurandStateArrayType>::value, bool>::type
+                is_state_array = true>
   void FillRandom(CurandStateArrayType &rand_state, RandomFunction func);
 
+  /**
+   * Fill the array with counter-based (Philox4x32-10) random values, without
+   * any generator state; see philox.h. The values depend only on seed,
+   * counter, and the element position, not on the block dimensions, and host
+   * arrays produce the same values bit for bit. Use a different counter, e.g.,
+   * an incrementing call index, for each independent fill with the same seed.
+   * @param seed 64-bit generator key
+   * @param counter 64-bit position in the random stream
+   * @param func `__host__ __device__` function with signature
+   *   `T func(unsigned int)` mapping 32 random bits to a value, such as
+   *   UniformRandom (the default), UniformRandomDouble, or RandomBits
+   */
+  template <typename RandomFunction = UniformRandom,
+            class C = CudaArrayTraits<Derived>,
+            typename C::Mutable is_mutable = true>
+  inline void FillRandom(unsigned long long seed, unsigned long long counter,
+                         RandomFunction func = RandomFunction()) {
+    LIBCUA_INSTRUMENT("CudaArray2DBase::FillRandom", Size() * sizeof(Scalar),
+                      device_, stream_, IsHost::value);
+    FillRandom_(internal::MakePhiloxKey(seed), counter, func, IsHost());
+  }
+
   //----------------------------------------------------------------------------
   // getters/setters
 
   __host__ __device__ inline SizeType Width() const { return width_; }
   __host__ __device__ inline SizeType Height() const { return height_; }
-  __host__ __device__ inline SizeType Size() const { return width_ * height_; }
+  /**
+   * @return total number of elements, computed in 64 bits (see types.h)
+   */
+  __host__ __device__ inline size_t Size() const {
+    return static_cast<size_t>(width_) * height_;
+  }
 
   __host__ __device__ inline dim3 BlockDim() const { return block_dim_; }
   __host__ __device__ inline dim3 GridDim() const { return grid_dim_; }
 
+  /**
+   * Set the block size for the kernels of this array. GridDim() is then the
+   * grid for one thread per element; the element-wise kernels may launch fewer
+   * blocks (see SetLaunchMode()).
+   */
   inline void SetBlockDim(const dim3 block_dim) {
     block_dim_ = block_dim;
     grid_dim_ = dim3((width_ + block_dim.x - 1) / block_dim_.x,
-                     (width_ + block_dim.y - 1) / block_dim_.y, 1);
+                     (height_ + block_dim.y - 1) / block_dim_.y, 1);
+  }
+
+  inline LaunchMode GetLaunchMode() const { return launch_mode_; }
+
+  /**
+   * Set how the element-wise kernels (Fill, ApplyOp, CopyTo, and the scalar
+   * operators) size their grids; see LaunchMode. The default is
+   * LaunchMode::kOccupancy.
+   */
+  inline void SetLaunchMode(const LaunchMode launch_mode) {
+    launch_mode_ = launch_mode;
   }
 
   inline int Device() const { return device_; }
@@ -363,8 +475,7 @@ class CudaArray2DBase {
       throw "Error: CudaArray2DBase Address out of bounds in SetValue().";
     }
 
-    internal::SetDevice(device_);
-    kernel::CudaArray2DBaseSet<<<1, 1, 0, stream_>>>(derived(), value, x, y);
+    SetValue_(x, y, value, IsHost());
   }
 
   /**
@@ -378,14 +489,71 @@ class CudaArray2DBase {
       throw "Error: CudaArray2DBase Address out of bounds in GetValue().";
     }
 
-    internal::SetDevice(device_);
-    Scalar value, *dev_value;
-    cudaMalloc(&dev_value, sizeof(Scalar));
-    kernel::CudaArray2DBaseGet<<<1, 1, 0, stream_>>>(derived(), dev_value, x,
-                                                     y);
-    cudaMemcpy(&value, dev_value, sizeof(Scalar), cudaMemcpyDeviceToHost);
-    cudaFree(dev_value);
-    return value;
+    return GetValue_(x, y, IsHost());
+  }
+
+  /**
+   * Host-level function for setting many array elements at once. All values
+   * are uploaded in one transfer and written by one kernel. If a coordinate
+   * appears more than once, which of its values is written is unspecified.
+   * @param coordinates host array of num_values element positions
+   * @param values host array of num_values new values
+   * @param num_values number of elements to set
+   */
+  ENABLE_IF_MUTABLE
+  inline void SetValues(const Coordinate *coordinates, const Scalar *values,
+                        size_t num_values) {
+    SetValuesAsync(coordinates, values, num_values).Synchronize();
+  }
+
+  /**
+   * Asynchronous version of SetValues(), queued on the array's stream. The
+   * coordinates and values must stay valid until the returned event has
+   * completed; use pinned host memory for the copies to overlap other work.
+   * @param coordinates host array of num_values element positions
+   * @param values host array of num_values new values
+   * @param num_values number of elements to set
+   * @return event marking the completion of the update
+   */
+  ENABLE_IF_MUTABLE
+  inline CudaEvent SetValuesAsync(const Coordinate *coordinates,
+                                  const Scalar *values, size_t num_values) {
+    internal::CheckCoordinates(derived(), coordinates, num_values);
+    LIBCUA_INSTRUMENT("CudaArray2DBase::SetValues",
+                      num_values * (sizeof(Coordinate) + sizeof(Scalar)),
+                      device_, stream_, IsHost::value);
+    return SetValues_(coordinates, values, num_values, IsHost());
+  }
+
+  /**
+   * Host-level function for getting many array elements at once. All values
+   * are read by one kernel and downloaded in one transfer.
+   * @param coordinates host array of num_values element positions
+   * @param num_values number of elements to get
+   * @param values output host array of num_values values
+   */
+  inline void GetValues(const Coordinate *coordinates, size_t num_values,
+                        Scalar *values) const {
+    GetValuesAsync(coordinates, num_values, values).Synchronize();
+  }
+
+  /**
+   * Asynchronous version of GetValues(), queued on the array's stream. The
+   * coordinates and output values must stay valid until the returned event
+   * has completed; use pinned host memory for the copies to overlap other
+   * work.
+   * @param coordinates host array of num_values element positions
+   * @param num_values number of elements to get
+   * @param values output host array of num_values values
+   * @return event marking the arrival of the values on the host
+   */
+  inline CudaEvent GetValuesAsync(const Coordinate *coordinates,
+                                  size_t num_values, Scalar *values) const {
+    internal::CheckCoordinates(derived(), coordinates, num_values);
+    LIBCUA_INSTRUMENT("CudaArray2DBase::GetValues",
+                      num_values * (sizeof(Coordinate) + sizeof(Scalar)),
+                      device_, stream_, IsHost::value);
+    return GetValues_(coordinates, num_values, values, IsHost());
   }
 
   //----------------------------------------------------------------------------
@@ -404,14 +572,17 @@ class CudaArray2DBase {
    *
    * @param op `__device__` function mapping `(x,y) -> CudaArrayClass::Scalar`
    * @param shared_mem_bytes if `op()` uses shared memory, the size of the
-   *   shared memory space required
+   *   shared memory space required; in this case, the kernel is launched with
+   *   one thread per element regardless of the launch mode, so each thread
+   *   calls `op()` at most once and can own the shared memory slot of its
+   *   threadIdx
    */
   template <class Function, class C = CudaArrayTraits<Derived>,
             typename C::Mutable is_mutable = true>
   inline void ApplyOp(Function op, const unsigned int shared_mem_bytes = 0) {
-    internal::SetDevice(device_);
-    kernel::CudaArray2DBaseApplyOp<<<grid_dim_, block_dim_, shared_mem_bytes,
-                                     stream_>>>(derived(), op);
+    LIBCUA_INSTRUMENT("CudaArray2DBase::ApplyOp", Size() * sizeof(Scalar),
+                      device_, stream_, IsHost::value);
+    ApplyOp_(op, shared_mem_bytes, IsHost());
   }
 
   /**
@@ -420,12 +591,10 @@ class CudaArray2DBase {
    */
   ENABLE_IF_MUTABLE
   inline void operator+=(const Scalar value) {
-    Derived &tmp = derived();
-    internal::SetDevice(device_);
-    kernel::CudaArray2DBaseApplyOp<<<grid_dim_, block_dim_, 0, stream_>>>(
-        tmp, [tmp, value] __device__(IndexType x, IndexType y) {
-          return tmp.get(x, y) + value;
-        });
+    LIBCUA_INSTRUMENT("CudaArray2DBase::ApplyScalarOp",
+                      2 * Size() * sizeof(Scalar), device_, stream_,
+                      IsHost::value);
+    ApplyScalarOp_(value, Plus(), IsHost());
   }
 
   /**
@@ -434,12 +603,10 @@ class CudaArray2DBase {
    */
   ENABLE_IF_MUTABLE
   inline void operator-=(const Scalar value) {
-    Derived &tmp = derived();
-    internal::SetDevice(device_);
-    kernel::CudaArray2DBaseApplyOp<<<grid_dim_, block_dim_, 0, stream_>>>(
-        tmp, [tmp, value] __device__(IndexType x, IndexType y) {
-          return tmp.get(x, y) - value;
-        });
+    LIBCUA_INSTRUMENT("CudaArray2DBase::ApplyScalarOp",
+                      2 * Size() * sizeof(Scalar), device_, stream_,
+                      IsHost::value);
+    ApplyScalarOp_(value, Minus(), IsHost());
   }
 
   /**
@@ -448,12 +615,10 @@ class CudaArray2DBase {
    */
   ENABLE_IF_MUTABLE
   inline void operator*=(const Scalar value) {
-    Derived &tmp = derived();
-    internal::SetDevice(device_);
-    kernel::CudaArray2DBaseApplyOp<<<grid_dim_, block_dim_, 0, stream_>>>(
-        tmp, [tmp, value] __device__(IndexType x, IndexType y) {
-          return tmp.get(x, y) * value;
-        });
+    LIBCUA_INSTRUMENT("CudaArray2DBase::ApplyScalarOp",
+                      2 * Size() * sizeof(Scalar), device_, stream_,
+                      IsHost::value);
+    ApplyScalarOp_(value, Multiplies(), IsHost());
   }
 
   /**
@@ -462,12 +627,355 @@ class CudaArray2DBase {
    */
   ENABLE_IF_MUTABLE
   inline void operator/=(const Scalar value) {
-    Derived &tmp = derived();
-    internal::SetDevice(device_);
-    kernel::CudaArray2DBaseApplyOp<<<grid_dim_, block_dim_, 0, stream_>>>(
-        tmp, [tmp, value] __device__(IndexType x, IndexType y) {
-          return tmp.get(x, y) / value;
-        });
+    LIBCUA_INSTRUMENT("CudaArray2DBase::ApplyScalarOp",
+                      2 * Size() * sizeof(Scalar), device_, stream_,
+                      IsHost::value);
+    ApplyScalarOp_(value, Divides(), IsHost());
+  }
+
+  /**
+   * Evaluate an element-wise array expression, e.g., `a * 0.5f + b`, and store
+   * the result in the current array. The whole expression is computed in a
+   * single pass over the data; see ArrayExpression.
+   * @param expression expression over arrays of the same size as this array
+   */
+  template <typename Expression, class C = CudaArrayTraits<Derived>,
+            typename C::Mutable is_mutable = true>
+  inline void Assign(const ArrayExpression<Expression> &expression) {
+    expression.derived().CheckCompatible2D(derived());
+    LIBCUA_INSTRUMENT("CudaArray2DBase::Assign", Size() * sizeof(Scalar),
+                      device_, stream_, IsHost::value);
+    ApplyOp_(expression.derived(), 0, IsHost());
+  }
+
+  /**
+   * Element-wise addition.
+   * @param other array or array expression to add to this array
+   */
+  template <typename Other, class C = CudaArrayTraits<Derived>,
+            typename C::Mutable is_mutable = true,
+            typename std::enable_if<internal::IsArrayOperand<Other>::value,
+                                    int>::type = 0>
+  inline void operator+=(const Other &other) {
+    Assign(derived() + other);
+  }
+
+  /**
+   * Element-wise subtraction.
+   * @param other array or array expression to subtract from this array
+   */
+  template <typename Other, class C = CudaArrayTraits<Derived>,
+            typename C::Mutable is_mutable = true,
+            typename std::enable_if<internal::IsArrayOperand<Other>::value,
+                                    int>::type = 0>
+  inline void operator-=(const Other &other) {
+    Assign(derived() - other);
+  }
+
+  /**
+   * Element-wise multiplication.
+   * @param other array or array expression by which to multiply this array
+   */
+  template <typename Other, class C = CudaArrayTraits<Derived>,
+            typename C::Mutable is_mutable = true,
+            typename std::enable_if<internal::IsArrayOperand<Other>::value,
+                                    int>::type = 0>
+  inline void operator*=(const Other &other) {
+    Assign(derived() * other);
+  }
+
+  /**
+   * Element-wise division.
+   * @param other array or array expression by which to divide this array
+   */
+  template <typename Other, class C = CudaArrayTraits<Derived>,
+            typename C::Mutable is_mutable = true,
+            typename std::enable_if<internal::IsArrayOperand<Other>::value,
+                                    int>::type = 0>
+  inline void operator/=(const Other &other) {
+    Assign(derived() / other);
+  }
+
+  /**
+   * Compute `this(x, y) = op(inputs(x, y)...)` in a single pass. Unlike
+   * array expressions, the inputs can be any mix of array kinds and scalar
+   * types, as long as they have the same size and device as this array:
+   *
+   *      // CudaArray2D<float> a; CudaTexture2D<float2> b;
+   *      // CudaSurface2D<uchar4> c
+   *      out.Zip([] __device__(float a, float2 b, uchar4 c) {
+   *        return a * b.x + c.w;  // stored in out(x, y)
+   *      }, a, b, c);
+   *
+   * Sizes and devices are checked once, before the launch. See cua::Zip() for
+   * the form with several outputs.
+   * @param op `__device__` function mapping `(inputs...) -> Scalar`
+   * @param inputs the input arrays
+   */
+  template <class Function, class C = CudaArrayTraits<Derived>,
+            typename C::Mutable is_mutable = true, typename... Inputs>
+  inline void Zip(Function op, const Inputs &... inputs) {
+    LIBCUA_INSTRUMENT(
+        "CudaArray2DBase::Zip",
+        Size() * (internal::ZipElementBytes<Derived, Inputs...>::value),
+        device_, stream_, IsHost::value);
+    internal::ZipInto(op, derived(), inputs...);
+  }
+
+  //----------------------------------------------------------------------------
+  // reductions
+  //
+  // Each reduction has a blocking form and an asynchronous form. The latter
+  // queues the reduction on the array's stream and returns a CudaAsyncValue
+  // without waiting for the result. Reductions work for every array type,
+  // including textures and surfaces; host arrays compute the result on the
+  // CPU thread pool.
+
+  /**
+   * Reduce the array with a user-defined binary operator, e.g., cua::Maximum.
+   * @param op associative and commutative `__host__ __device__` function
+   *   object mapping `(Scalar, Scalar) -> Scalar`
+   * @param identity identity element of op, e.g., zero for addition
+   * @return the reduced value
+   */
+  template <class BinaryFunction>
+  inline CudaAsyncValue<Scalar> ReduceAsync(BinaryFunction op,
+                                            const Scalar identity) const {
+    return Reduce_<Scalar>(internal::Identity(), op, internal::Identity(),
+                           identity, IsHost());
+  }
+
+  template <class BinaryFunction>
+  inline Scalar Reduce(BinaryFunction op, const Scalar identity) const {
+    return ReduceAsync(op, identity).Get();
+  }
+
+  /**
+   * @return the sum of all elements, accumulated in 64-bit integers for
+   *   integral scalar types
+   */
+  inline CudaAsyncValue<SumType> SumAsync() const {
+    return Reduce_<SumType>(internal::ConvertTo<SumType>(), Plus(),
+                            internal::Identity(), SumType(), IsHost());
+  }
+
+  inline SumType Sum() const { return SumAsync().Get(); }
+
+  /**
+   * @return the smallest element
+   */
+  inline CudaAsyncValue<Scalar> MinAsync() const {
+    return ReduceAsync(Minimum(), internal::HighestValue<Scalar>());
+  }
+
+  inline Scalar Min() const { return MinAsync().Get(); }
+
+  /**
+   * @return the largest element
+   */
+  inline CudaAsyncValue<Scalar> MaxAsync() const {
+    return ReduceAsync(Maximum(), internal::LowestValue<Scalar>());
+  }
+
+  inline Scalar Max() const { return MaxAsync().Get(); }
+
+  /**
+   * @return the smallest and largest elements, computed in a single pass
+   */
+  inline CudaAsyncValue<MinMaxValue<Scalar>> MinMaxAsync() const {
+    const MinMaxValue<Scalar> identity = {internal::HighestValue<Scalar>(),
+                                          internal::LowestValue<Scalar>()};
+    return Reduce_<MinMaxValue<Scalar>>(internal::MakeMinMax(),
+                                        internal::CombineMinMax(),
+                                        internal::Identity(), identity,
+                                        IsHost());
+  }
+
+  inline MinMaxValue<Scalar> MinMax() const { return MinMaxAsync().Get(); }
+
+  /**
+   * @return the mean of all elements
+   */
+  inline CudaAsyncValue<double> MeanAsync() const {
+    const internal::DivideBy finalize = {static_cast<double>(Size())};
+    return Reduce_<double>(internal::ConvertTo<SumType>(), Plus(), finalize,
+                           SumType(), IsHost());
+  }
+
+  inline double Mean() const { return MeanAsync().Get(); }
+
+  /**
+   * @return the L2 norm of the array, i.e., the square root of the sum of
+   *   squared elements
+   */
+  inline CudaAsyncValue<double> NormAsync() const {
+    return Reduce_<double>(internal::SquareAs<SumType>(), Plus(),
+                           internal::SquareRoot(), SumType(), IsHost());
+  }
+
+  inline double Norm() const { return NormAsync().Get(); }
+
+  //----------------------------------------------------------------------------
+  // histograms
+
+  /**
+   * Count the array values in equal-width bins; see HistogramBins. Vector
+   * types, e.g., uchar4, get one histogram per channel. Each GPU block counts
+   * in shared memory and merges its bins into the result with atomics; host
+   * arrays count on the CPU thread pool. The call waits for the result.
+   * @param bins number and value range of the bins
+   * @return the counts, one channel after the other: element
+   *   `c * bins.num_bins + b` is the number of values of channel c in bin b
+   */
+  inline std::vector<unsigned long long> Histogram(
+      const HistogramBins &bins) const {
+    return Histogram_(bins, internal::HistogramNoMask(), IsHost());
+  }
+
+  /**
+   * Histogram of the elements selected by a mask, i.e., whose corresponding
+   * mask element is nonzero.
+   * @param bins number and value range of the bins
+   * @param mask array of the same size with an arithmetic scalar type, e.g.,
+   *   a uchar or bool array, on the same device
+   * @return the counts, in the same layout as Histogram(bins)
+   */
+  template <typename MaskDerived>
+  inline std::vector<unsigned long long> Histogram(
+      const HistogramBins &bins, const MaskDerived &mask) const {
+    static_assert(internal::IsHostArray<MaskDerived>::value == IsHost::value,
+                  "Masks must live in the same memory space as the array.");
+    internal::CheckHistogramMask2D(derived(), mask);
+    return Histogram_(bins, mask, IsHost());
+  }
+
+  //----------------------------------------------------------------------------
+  // filtering
+
+  /**
+   * Separable convolution: convolve the array with one set of taps per axis,
+   * along x and then along y, and store the result in another array. Each pass
+   * stages shared-memory tiles with a halo of Radius elements along its axis.
+   * All channels are accumulated in float, and the intermediate pass is stored
+   * in float, as well; integer results are rounded to the nearest value. Host
+   * arrays run the same passes on the CPU thread pool. See ConvolutionTaps and
+   * ConvolutionBorder.
+   * @param taps_x taps along x
+   * @param taps_y taps along y
+   * @param other output array of the same size, with the same number of
+   *   channels; its scalar type may differ, e.g., a float array for the
+   *   derivatives of a uchar array. This may be the current array.
+   * @param border handling of elements outside of the array
+   */
+  template <unsigned int RadiusX, unsigned int RadiusY, typename OtherDerived,
+            typename CudaArrayTraits<OtherDerived>::Mutable is_mutable = true>
+  void SeparableConvolve(
+      const ConvolutionTaps<RadiusX> &taps_x,
+      const ConvolutionTaps<RadiusY> &taps_y, OtherDerived *other,
+      const ConvolutionBorder border = ConvolutionBorder::kFromArray) const;
+
+  /**
+   * Separable convolution with the same taps along every axis; see above.
+   */
+  template <unsigned int Radius, typename OtherDerived,
+            typename CudaArrayTraits<OtherDerived>::Mutable is_mutable = true>
+  inline void SeparableConvolve(
+      const ConvolutionTaps<Radius> &taps, OtherDerived *other,
+      const ConvolutionBorder border = ConvolutionBorder::kFromArray) const {
+    SeparableConvolve(taps, taps, other, border);
+  }
+
+  /**
+   * Apply a stencil operation, i.e., compute each element of another array
+   * from a neighborhood of the corresponding element of this array. Each block
+   * stages a tile of the array, plus a halo of Radius elements on every side,
+   * in shared memory, and op reads the neighborhood from there through a
+   * StencilAccessor2D. For example, a Laplacian:
+   *
+   *      // Array2DType in, out
+   *      in.ApplyStencil<1>(
+   *          [] __device__(const cua::StencilAccessor2D<float, 1> &a,
+   *                        unsigned int x, unsigned int y) {
+   *            return a(-1, 0) + a(1, 0) + a(0, -1) + a(0, 1) - 4.f * a(0, 0);
+   *          },
+   *          &out);
+   *
+   * Host arrays stage the same tiles on the CPU thread pool; op must then be
+   * callable on the host, as well.
+   * @param op `__device__` function mapping
+   *   `(const StencilAccessor2D<Scalar, Radius> &, x, y)
+   *   -> OtherDerived::Scalar`
+   * @param other output array of the same size; this must not share memory
+   *   with the current array, which is checked for shallow copies and views in
+   *   linear memory and for surfaces on the same CUDA array
+   * @param border handling of elements outside of the array; see
+   *   ConvolutionBorder
+   */
+  template <unsigned int Radius, class Function, typename OtherDerived,
+            typename CudaArrayTraits<OtherDerived>::Mutable is_mutable = true>
+  void ApplyStencil(
+      Function op, OtherDerived *other,
+      const ConvolutionBorder border = ConvolutionBorder::kFromArray) const;
+
+  //----------------------------------------------------------------------------
+  // scans
+  //
+  // Prefix sums along one or more axes, stored in another array. The scalar
+  // type of the output array is the accumulator type, so it may be wider than
+  // Scalar, e.g., unsigned int sums of a uchar array. The output may be the
+  // current array. Each pass reads and writes every element once, carrying
+  // running totals from one shared-memory tile to the next.
+
+  /**
+   * Prefix sums along x, i.e., within each row.
+   * @param other output array of the same size
+   * @param mode inclusive or exclusive sums; see ScanMode
+   */
+  template <typename OtherDerived,
+            typename CudaArrayTraits<OtherDerived>::Mutable is_mutable = true>
+  inline void ScanX(OtherDerived *other,
+                    const ScanMode mode = ScanMode::kInclusive) const {
+    ScanAxes_(other, internal::kScanX, mode);
+  }
+
+  /**
+   * Prefix sums along y, i.e., within each column.
+   * @param other output array of the same size
+   * @param mode inclusive or exclusive sums; see ScanMode
+   */
+  template <typename OtherDerived,
+            typename CudaArrayTraits<OtherDerived>::Mutable is_mutable = true>
+  inline void ScanY(OtherDerived *other,
+                    const ScanMode mode = ScanMode::kInclusive) const {
+    ScanAxes_(other, internal::kScanY, mode);
+  }
+
+  /**
+   * 2D prefix sums: other(x, y) is the sum of this(i, j) over i <= x and
+   * j <= y, or over i < x and j < y for exclusive sums. This scans along x
+   * and then along y, in place in the output array.
+   * @param other output array of the same size
+   * @param mode inclusive or exclusive sums; see ScanMode
+   */
+  template <typename OtherDerived,
+            typename CudaArrayTraits<OtherDerived>::Mutable is_mutable = true>
+  inline void ScanXY(OtherDerived *other,
+                     const ScanMode mode = ScanMode::kInclusive) const {
+    ScanAxes_(other, internal::kScanX | internal::kScanY, mode);
+  }
+
+  /**
+   * Build the summed-area table (integral image) of the array, i.e., its
+   * inclusive 2D prefix sums; the sum over any box then takes four lookups
+   * (see SummedAreaBoxSum()). Use a table type that cannot overflow, e.g.,
+   * CudaArray2D<unsigned int> for uchar images, or CudaArray2D<double> for
+   * large float images.
+   * @param table output array of the same size
+   */
+  template <typename OtherDerived,
+            typename CudaArrayTraits<OtherDerived>::Mutable is_mutable = true>
+  inline void SummedAreaTable(OtherDerived *table) const {
+    ScanXY(table, ScanMode::kInclusive);
   }
 
   //----------------------------------------------------------------------------
@@ -478,9 +986,354 @@ class CudaArray2DBase {
 
   dim3 block_dim_, grid_dim_;  // for calling kernels
 
+  LaunchMode launch_mode_;  // grid sizing for the element-wise kernels
+
   int device_;  // the GPU where the data for this array is stored
 
   cudaStream_t stream_;  // the stream on the GPU in which the class kernels run
+
+  //----------------------------------------------------------------------------
+  // private class methods
+
+ private:
+  // Each operation has one implementation that launches the kernels in
+  // cudaArray2DBase_kernels.h (std::false_type) and one that runs the
+  // functions in cudaArray2DBase_host.h (std::true_type); IsHost selects
+  // between them. Only the selected overload is ever instantiated.
+
+  // argument that represents this array in kernel launches
+  inline DeviceViewType DeviceView_() const {
+    return internal::DeviceViewOf<Derived>::Get(derived());
+  }
+
+  // launch grid for the grid-stride element-wise kernels; a kernel that uses
+  // dynamic shared memory (i.e., ApplyOp() with shared_mem_bytes > 0) always
+  // gets one thread per element, since its op may index shared memory by
+  // thread and would be called repeatedly by the same thread in a grid-stride
+  // loop
+  template <typename Kernel>
+  inline dim3 LaunchGridDim_(Kernel kernel, const dim3 &block_dim,
+                             const size_t shared_mem_bytes) const {
+    const dim3 num_tiles((width_ + block_dim.x - 1) / block_dim.x,
+                         (height_ + block_dim.y - 1) / block_dim.y);
+    return internal::GridStrideGridDim(kernel, num_tiles, block_dim,
+                                       shared_mem_bytes, device_,
+                                       (shared_mem_bytes > 0)
+                                           ? LaunchMode::kOneThreadPerElement
+                                           : launch_mode_);
+  }
+
+  // block dimensions for a kernel that gives the same result when repeated;
+  // these come from the BlockDimTuner if it is enabled, and from BlockDim()
+  // otherwise
+  template <typename Launch>
+  inline dim3 TunedBlockDim_(const char *kernel_name,
+                             const std::string &type_name,
+                             const Launch &launch, cudaStream_t stream) const {
+    BlockDimTuner<> &tuner = BlockDimTuner<>::Instance();
+    if (!tuner.Enabled()) {
+      return block_dim_;
+    }
+    return tuner.Tune(kernel_name, type_name,
+                      internal::ShapeClass(width_, height_),
+                      internal::BlockDimCandidates2D(), launch, device_,
+                      stream);
+  }
+
+  inline void Fill_(const Scalar value, std::false_type) {
+    internal::SetDevice(device_);
+    const auto launch = [&](const dim3 &block_dim) {
+      const dim3 grid_dim = LaunchGridDim_(
+          kernel::CudaArray2DBaseFill<DeviceViewType, Scalar>, block_dim, 0);
+      kernel::CudaArray2DBaseFill<<<grid_dim, block_dim, 0, stream_>>>(
+          DeviceView_(), value);
+    };
+    launch(TunedBlockDim_("CudaArray2DBase::Fill",
+                          internal::TuningTypeName<Derived>(), launch,
+                          stream_));
+  }
+
+  inline void Fill_(const Scalar value, std::true_type) {
+    host::CudaArray2DBaseFill(derived(), value);
+  }
+
+  // each thread fills four consecutive elements of a row
+  template <typename RandomFunction>
+  inline void FillRandom_(const PhiloxKey key, const unsigned long long counter,
+                          RandomFunction func, std::false_type) {
+    const dim3 grid_dim(((width_ + 3) / 4 + block_dim_.x - 1) / block_dim_.x,
+                        (height_ + block_dim_.y - 1) / block_dim_.y);
+
+    internal::SetDevice(device_);
+    kernel::CudaArray2DBaseFillRandomPhilox<<<grid_dim, block_dim_, 0,
+                                              stream_>>>(DeviceView_(), key,
+                                                         counter, func);
+  }
+
+  template <typename RandomFunction>
+  inline void FillRandom_(const PhiloxKey key, const unsigned long long counter,
+                          RandomFunction func, std::true_type) {
+    host::CudaArray2DBaseFillRandomPhilox(derived(), key, counter, func);
+  }
+
+  inline void SetValue_(IndexType x, IndexType y, const Scalar value,
+                        std::false_type) {
+    internal::SetDevice(device_);
+    kernel::CudaArray2DBaseSet<<<1, 1, 0, stream_>>>(DeviceView_(), value, x,
+                                                     y);
+  }
+
+  inline void SetValue_(IndexType x, IndexType y, const Scalar value,
+                        std::true_type) {
+    derived().set(x, y, value);
+  }
+
+  inline Scalar GetValue_(IndexType x, IndexType y, std::false_type) const {
+    const Coordinate coordinate = {x, y};
+    Scalar value;
+    GetValues_(&coordinate, 1, &value, std::false_type()).Synchronize();
+    return value;
+  }
+
+  inline Scalar GetValue_(IndexType x, IndexType y, std::true_type) const {
+    return derived().get(x, y);
+  }
+
+  inline CudaEvent SetValues_(const Coordinate *coordinates,
+                              const Scalar *values, size_t num_values,
+                              std::false_type) {
+    return internal::ScatterValuesAsync(DeviceView_(), coordinates, num_values,
+                                        values, device_, stream_);
+  }
+
+  inline CudaEvent SetValues_(const Coordinate *coordinates,
+                              const Scalar *values, size_t num_values,
+                              std::true_type) {
+    host::ScatterValues(derived(), coordinates, num_values, values);
+    return CudaEvent();
+  }
+
+  inline CudaEvent GetValues_(const Coordinate *coordinates, size_t num_values,
+                              Scalar *values, std::false_type) const {
+    return internal::GatherValuesAsync(DeviceView_(), coordinates, num_values,
+                                       values, device_, stream_);
+  }
+
+  inline CudaEvent GetValues_(const Coordinate *coordinates, size_t num_values,
+                              Scalar *values, std::true_type) const {
+    host::GatherValues(derived(), coordinates, num_values, values);
+    return CudaEvent();
+  }
+
+  template <class Function>
+  inline void ApplyOp_(Function op, const unsigned int shared_mem_bytes,
+                       std::false_type) {
+    internal::SetDevice(device_);
+    const dim3 grid_dim = LaunchGridDim_(
+        kernel::CudaArray2DBaseApplyOp<DeviceViewType, Function>, block_dim_,
+        shared_mem_bytes);
+    kernel::CudaArray2DBaseApplyOp<<<grid_dim, block_dim_, shared_mem_bytes,
+                                     stream_>>>(DeviceView_(), op);
+  }
+
+  template <class Function>
+  inline void ApplyOp_(Function op, const unsigned int shared_mem_bytes,
+                       std::true_type) {
+    host::CudaArray2DBaseApplyOp(derived(), op);
+  }
+
+  template <class BinaryFunction>
+  inline void ApplyScalarOp_(const Scalar value, BinaryFunction op,
+                             std::false_type) {
+    internal::SetDevice(device_);
+    const dim3 grid_dim = LaunchGridDim_(
+        kernel::CudaArray2DBaseApplyScalarOp<DeviceViewType, Scalar,
+                                             BinaryFunction>,
+        block_dim_, 0);
+    kernel::CudaArray2DBaseApplyScalarOp<<<grid_dim, block_dim_, 0, stream_>>>(
+        DeviceView_(), value, op);
+  }
+
+  template <class BinaryFunction>
+  inline void ApplyScalarOp_(const Scalar value, BinaryFunction op,
+                             std::true_type) {
+    host::CudaArray2DBaseApplyScalarOp(derived(), value, op);
+  }
+
+  template <typename ResultType, class Transform, class BinaryFunction,
+            class Finalize, typename AccumulatorType>
+  inline CudaAsyncValue<ResultType> Reduce_(Transform transform,
+                                            BinaryFunction op,
+                                            Finalize finalize,
+                                            const AccumulatorType &identity,
+                                            std::false_type) const {
+    LIBCUA_INSTRUMENT("CudaArray2DBase::Reduce", Size() * sizeof(Scalar),
+                      device_, stream_, false);
+    typedef internal::LinearReader2D<DeviceViewType, unsigned int> Reader;
+    typedef internal::LinearReader2D<DeviceViewType, unsigned long long>
+        WideReader;
+
+    // only widen the kernel's linear indices when the array requires it
+    if (internal::Needs64BitIndexing(Size())) {
+      return internal::ReduceAsync<ResultType>(
+          WideReader(DeviceView_()), Size(), transform, op, finalize, identity,
+          device_, stream_);
+    }
+    return internal::ReduceAsync<ResultType>(Reader(DeviceView_()), Size(),
+                                             transform, op, finalize, identity,
+                                             device_, stream_);
+  }
+
+  template <typename ResultType, class Transform, class BinaryFunction,
+            class Finalize, typename AccumulatorType>
+  inline CudaAsyncValue<ResultType> Reduce_(Transform transform,
+                                            BinaryFunction op,
+                                            Finalize finalize,
+                                            const AccumulatorType &identity,
+                                            std::true_type) const {
+    LIBCUA_INSTRUMENT("CudaArray2DBase::Reduce", Size() * sizeof(Scalar),
+                      device_, stream_, true);
+    return CudaAsyncValue<ResultType>(finalize(
+        host::Reduce(internal::LinearReader2D<Derived, size_t>(derived()),
+                     Size(), transform, op, identity)));
+  }
+
+  template <typename MaskDerived>
+  inline std::vector<unsigned long long> Histogram_(const HistogramBins &bins,
+                                                    const MaskDerived &mask,
+                                                    std::false_type) const {
+    internal::CheckHistogramBins(bins);
+    LIBCUA_INSTRUMENT("CudaArray2DBase::Histogram", Size() * sizeof(Scalar),
+                      device_, stream_, false);
+    return internal::Histogram2D(
+        DeviceView_(), internal::DeviceViewOf<MaskDerived>::Get(mask), Size(),
+        bins, device_, stream_);
+  }
+
+  inline std::vector<unsigned long long> Histogram_(
+      const HistogramBins &bins, const internal::HistogramNoMask &mask,
+      std::false_type) const {
+    internal::CheckHistogramBins(bins);
+    LIBCUA_INSTRUMENT("CudaArray2DBase::Histogram", Size() * sizeof(Scalar),
+                      device_, stream_, false);
+    return internal::Histogram2D(DeviceView_(), mask, Size(), bins, device_,
+                                 stream_);
+  }
+
+  template <typename MaskDerived>
+  inline std::vector<unsigned long long> Histogram_(const HistogramBins &bins,
+                                                    const MaskDerived &mask,
+                                                    std::true_type) const {
+    internal::CheckHistogramBins(bins);
+    LIBCUA_INSTRUMENT("CudaArray2DBase::Histogram", Size() * sizeof(Scalar),
+                      device_, stream_, true);
+    return host::Histogram2D(derived(), mask, bins);
+  }
+
+  template <typename OtherDerived>
+  void CopyTo_(OtherDerived *other, std::false_type) const;
+  template <typename OtherDerived>
+  void CopyTo_(OtherDerived *other, std::true_type) const {
+    host::CudaArray2DBaseCopyTo(derived(), *other);
+  }
+
+  template <unsigned int RadiusX, unsigned int RadiusY, typename OtherDerived>
+  inline void SeparableConvolve_(
+      const ConvolutionTaps<RadiusX> &taps_x,
+      const ConvolutionTaps<RadiusY> &taps_y, OtherDerived *other,
+      const ConvolutionBorder border, std::false_type) const {
+    internal::SeparableConvolve2D(
+        DeviceView_(), internal::DeviceViewOf<OtherDerived>::Get(*other),
+        taps_x, taps_y, border, device_, stream_);
+  }
+
+  template <unsigned int RadiusX, unsigned int RadiusY, typename OtherDerived>
+  inline void SeparableConvolve_(
+      const ConvolutionTaps<RadiusX> &taps_x,
+      const ConvolutionTaps<RadiusY> &taps_y, OtherDerived *other,
+      const ConvolutionBorder border, std::true_type) const {
+    host::SeparableConvolve2D(derived(), *other, taps_x, taps_y, border);
+  }
+
+  template <unsigned int Radius, class Function, typename OtherDerived>
+  inline void ApplyStencil_(Function op, OtherDerived *other,
+                            const ConvolutionBorder border,
+                            std::false_type) const {
+    internal::ApplyStencil2D<Radius>(
+        DeviceView_(), internal::DeviceViewOf<OtherDerived>::Get(*other), op,
+        border, device_, stream_);
+  }
+
+  template <unsigned int Radius, class Function, typename OtherDerived>
+  inline void ApplyStencil_(Function op, OtherDerived *other,
+                            const ConvolutionBorder border,
+                            std::true_type) const {
+    host::ApplyStencil2D<Radius>(derived(), *other, op, border);
+  }
+
+  // checks and instrumentation shared by all scans
+  template <typename OtherDerived>
+  void ScanAxes_(OtherDerived *other, const unsigned int axes,
+                 const ScanMode mode) const;
+
+  template <typename OtherDerived>
+  inline void Scan_(OtherDerived *other, const unsigned int axes,
+                    const ScanMode mode, std::false_type) const {
+    internal::Scan2D(DeviceView_(),
+                     internal::DeviceViewOf<OtherDerived>::Get(*other), axes,
+                     mode, device_, stream_);
+  }
+
+  template <typename OtherDerived>
+  inline void Scan_(OtherDerived *other, const unsigned int axes,
+                    const ScanMode mode, std::true_type) const {
+    host::Scan2D(derived(), *other, axes, mode);
+  }
+
+  void FlipLR_(Derived *other, std::false_type) const;
+  void FlipLR_(Derived *other, std::true_type) const {
+    host::CudaArray2DBaseFlipLR(derived(), *other);
+  }
+
+  void FlipUD_(Derived *other, std::false_type) const;
+  void FlipUD_(Derived *other, std::true_type) const {
+    host::CudaArray2DBaseFlipUD(derived(), *other);
+  }
+
+  void Rot180_(Derived *other, std::false_type) const;
+  void Rot180_(Derived *other, std::true_type) const {
+    host::CudaArray2DBaseRot180(derived(), *other);
+  }
+
+  void Rot90_CCW_(Derived *other, std::false_type) const;
+  void Rot90_CCW_(Derived *other, std::true_type) const {
+    host::CudaArray2DBaseRot90_CCW(derived(), *other);
+  }
+
+  void Rot90_CW_(Derived *other, std::false_type) const;
+  void Rot90_CW_(Derived *other, std::true_type) const {
+    host::CudaArray2DBaseRot90_CW(derived(), *other);
+  }
+
+  void Transpose_(Derived *other, std::false_type) const;
+  void Transpose_(Derived *other, std::true_type) const {
+    host::CudaArray2DBaseTranspose(derived(), *other);
+  }
+
+  void TransposeInPlace_(std::false_type);
+  void TransposeInPlace_(std::true_type) {
+    host::CudaArray2DBaseTransposeInPlace(derived());
+  }
+
+  void FlipLRInPlace_(std::false_type);
+  void FlipLRInPlace_(std::true_type) {
+    host::CudaArray2DBaseFlipLRInPlace(derived());
+  }
+
+  void FlipUDInPlace_(std::false_type);
+  void FlipUDInPlace_(std::true_type) {
+    host::CudaArray2DBaseFlipUDInPlace(derived());
+  }
 };
 
 //------------------------------------------------------------------------------
@@ -494,11 +1347,11 @@ const dim3 CudaArray2DBase<Derived>::kBlockDim = dim3(32, 32);
 
 template <typename Derived>
 const typename CudaArray2DBase<Derived>::SizeType
-    CudaArray2DBase<Derived>::kTileSize = 32;
+    CudaArray2DBase<Derived>::kTileSize = internal::kTransposeTileSize;
 
 template <typename Derived>
 const typename CudaArray2DBase<Derived>::SizeType
-    CudaArray2DBase<Derived>::kBlockRows = 4;
+    CudaArray2DBase<Derived>::kBlockRows = internal::kTransposeBlockRows;
 
 //------------------------------------------------------------------------------
 //
@@ -511,9 +1364,16 @@ CudaArray2DBase<Derived>::CudaArray2DBase<Derived>(SizeType width,
                                                    SizeType height, int device,
                                                    const dim3 block_dim,
                                                    const cudaStream_t stream)
-    : width_(width), height_(height), device_(device), stream_(stream) {
+    : width_(width),
+      height_(height),
+      launch_mode_(LaunchMode::kOccupancy),
+      device_(device),
+      stream_(stream) {
   SetBlockDim(block_dim);
-  internal::SetDevice(device_);  // useful for subsequent subclass constructors
+  if (!IsHost::value) {
+    // useful for subsequent subclass constructors
+    internal::SetDevice(device_);
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -530,6 +1390,7 @@ inline CudaArray2DBase<Derived> &CudaArray2DBase<Derived>::operator=(
 
   block_dim_ = other.block_dim_;
   grid_dim_ = other.grid_dim_;
+  launch_mode_ = other.launch_mode_;
   device_ = other.device_;
   stream_ = other.stream_;
 
@@ -542,32 +1403,133 @@ template <typename Derived>
 template <typename OtherDerived,
           typename CudaArrayTraits<OtherDerived>::Mutable is_mutable>
 inline void CudaArray2DBase<Derived>::CopyTo(OtherDerived *other) const {
-  if (this == other) {
+  if (static_cast<const void *>(this) == static_cast<const void *>(other)) {
     return;
   }
 
+  static_assert(internal::IsHostArray<OtherDerived>::value == IsHost::value,
+                "CopyTo() requires both arrays to be host arrays, or both "
+                "arrays to be device arrays.");
   internal::CheckNotNull(other);
   internal::CheckSameDevice(*this, *other);
   internal::CheckSizeEqual2D(*this, *other);
+  LIBCUA_INSTRUMENT(
+      "CudaArray2DBase::CopyTo",
+      Size() * (sizeof(Scalar) + sizeof(typename OtherDerived::Scalar)),
+      device_, stream_, IsHost::value);
+  CopyTo_(other, IsHost());
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Derived>
+template <unsigned int RadiusX, unsigned int RadiusY, typename OtherDerived,
+          typename CudaArrayTraits<OtherDerived>::Mutable is_mutable>
+inline void CudaArray2DBase<Derived>::SeparableConvolve(
+    const ConvolutionTaps<RadiusX> &taps_x,
+    const ConvolutionTaps<RadiusY> &taps_y, OtherDerived *other,
+    const ConvolutionBorder border) const {
+  static_assert(internal::IsHostArray<OtherDerived>::value == IsHost::value,
+                "SeparableConvolve() requires both arrays to be host arrays, "
+                "or both arrays to be device arrays.");
+  internal::CheckNotNull(other);
+  internal::CheckSameDevice(*this, *other);
+  internal::CheckConvolutionSize2D(*this, *other);
+  LIBCUA_INSTRUMENT(
+      "CudaArray2DBase::SeparableConvolve",
+      Size() * (sizeof(Scalar) + sizeof(typename OtherDerived::Scalar)),
+      device_, stream_, IsHost::value);
+  SeparableConvolve_(taps_x, taps_y, other,
+                     internal::ResolveConvolutionBorder(derived(), border),
+                     IsHost());
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Derived>
+template <unsigned int Radius, class Function, typename OtherDerived,
+          typename CudaArrayTraits<OtherDerived>::Mutable is_mutable>
+inline void CudaArray2DBase<Derived>::ApplyStencil(
+    Function op, OtherDerived *other, const ConvolutionBorder border) const {
+  static_assert(internal::IsHostArray<OtherDerived>::value == IsHost::value,
+                "ApplyStencil() requires both arrays to be host arrays, or "
+                "both arrays to be device arrays.");
+  internal::CheckNotNull(other);
+  internal::CheckSameDevice(*this, *other);
+  internal::CheckStencilArrays2D(derived(), *other);
+  LIBCUA_INSTRUMENT(
+      "CudaArray2DBase::ApplyStencil",
+      Size() * (sizeof(Scalar) + sizeof(typename OtherDerived::Scalar)),
+      device_, stream_, IsHost::value);
+  ApplyStencil_<Radius>(op, other,
+                        internal::ResolveConvolutionBorder(derived(), border),
+                        IsHost());
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Derived>
+template <typename OtherDerived>
+inline void CudaArray2DBase<Derived>::ScanAxes_(OtherDerived *other,
+                                                const unsigned int axes,
+                                                const ScanMode mode) const {
+  static_assert(internal::IsHostArray<OtherDerived>::value == IsHost::value,
+                "Scans require both arrays to be host arrays, or both arrays "
+                "to be device arrays.");
+  internal::CheckNotNull(other);
+  internal::CheckSameDevice(*this, *other);
+  internal::CheckScanArrays(derived(), *other, std::false_type());
+  LIBCUA_INSTRUMENT(
+      "CudaArray2DBase::Scan",
+      Size() * internal::ScanBytesPerElement(
+                   axes, sizeof(Scalar), sizeof(typename OtherDerived::Scalar)),
+      device_, stream_, IsHost::value);
+  Scan_(other, axes, mode, IsHost());
+}
+
+template <typename Derived>
+template <typename OtherDerived>
+inline void CudaArray2DBase<Derived>::CopyTo_(OtherDerived *other,
+                                              std::false_type) const {
   internal::SetDevice(device_);
-  kernel::CudaArray2DBaseCopyTo<<<grid_dim_, block_dim_>>>(derived(), *other);
+  typedef internal::DeviceViewOf<OtherDerived> OtherDeviceView;
+  const auto launch = [&](const dim3 &block_dim) {
+    const dim3 grid_dim = LaunchGridDim_(
+        kernel::CudaArray2DBaseCopyTo<DeviceViewType,
+                                      typename OtherDeviceView::type>,
+        block_dim, 0);
+    kernel::CudaArray2DBaseCopyTo<<<grid_dim, block_dim, 0, stream_>>>(
+        DeviceView_(), OtherDeviceView::Get(*other));
+  };
+  launch(TunedBlockDim_("CudaArray2DBase::CopyTo",
+                          internal::TuningTypeName<Derived>() + "->" +
+                              internal::TuningTypeName<OtherDerived>(),
+                          launch, stream_));
 }
 
 //------------------------------------------------------------------------------
 
 template <typename Derived>
 template <typename CurandStateArrayType, typename RandomFunction, class C,
-          typename C::Mutable is_mutable>
+          typename C::Mutable is_mutable,
+          typename std::enable_if<
+              !std::is_arithmetic<CurandStateArrayType>::value, bool>::type
+              is_state_array>
 inline void CudaArray2DBase<Derived>::FillRandom(
     CurandStateArrayType &rand_state, RandomFunction func) {
+  static_assert(!IsHost::value,
+                "FillRandom() uses the cuRAND device API and is not available "
+                "for host arrays.");
   internal::CheckSameDevice(*this, rand_state);
   const dim3 block_dim(kTileSize, kBlockRows);
   const dim3 grid_dim((width_ + kTileSize - 1) / kTileSize,
                       (height_ + kTileSize - 1) / kTileSize);
 
+  LIBCUA_INSTRUMENT("CudaArray2DBase::FillRandom", Size() * sizeof(Scalar),
+                    device_, stream_, false);
   internal::SetDevice(device_);
   kernel::CudaArray2DBaseFillRandom<<<grid_dim, block_dim, 0, stream_>>>(
-      rand_state, derived(), func);
+      rand_state.DeviceView(), DeviceView_(), func);
 }
 
 //------------------------------------------------------------------------------
@@ -582,13 +1544,21 @@ ENABLE_IF_MUTABLE_IMPL inline void CudaArray2DBase<Derived>::FlipLR(
   internal::CheckNotNull(other);
   internal::CheckSameDevice(*this, *other);
   internal::CheckSizeEqual2D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaArray2DBase::FlipLR", 2 * Size() * sizeof(Scalar),
+                    device_, stream_, IsHost::value);
+  FlipLR_(other, IsHost());
+}
+
+template <typename Derived>
+inline void CudaArray2DBase<Derived>::FlipLR_(Derived *other,
+                                              std::false_type) const {
   const dim3 block_dim(kTileSize, kBlockRows);
   const dim3 grid_dim((width_ + kTileSize - 1) / kTileSize,
                       (height_ + kTileSize - 1) / kTileSize);
 
   internal::SetDevice(device_);
-  kernel::CudaArray2DBaseFlipLR<<<grid_dim, block_dim, 0, stream_>>>(derived(),
-                                                                     *other);
+  kernel::CudaArray2DBaseFlipLR<<<grid_dim, block_dim, 0, stream_>>>(
+      DeviceView_(), other->DeviceView_());
 }
 
 //------------------------------------------------------------------------------
@@ -599,13 +1569,21 @@ ENABLE_IF_MUTABLE_IMPL inline void CudaArray2DBase<Derived>::FlipUD(
   internal::CheckNotNull(other);
   internal::CheckSameDevice(*this, *other);
   internal::CheckSizeEqual2D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaArray2DBase::FlipUD", 2 * Size() * sizeof(Scalar),
+                    device_, stream_, IsHost::value);
+  FlipUD_(other, IsHost());
+}
+
+template <typename Derived>
+inline void CudaArray2DBase<Derived>::FlipUD_(Derived *other,
+                                              std::false_type) const {
   const dim3 block_dim(kTileSize, kBlockRows);
   const dim3 grid_dim((width_ + kTileSize - 1) / kTileSize,
                       (height_ + kTileSize - 1) / kTileSize);
 
   internal::SetDevice(device_);
-  kernel::CudaArray2DBaseFlipUD<<<grid_dim, block_dim, 0, stream_>>>(derived(),
-                                                                     *other);
+  kernel::CudaArray2DBaseFlipUD<<<grid_dim, block_dim, 0, stream_>>>(
+      DeviceView_(), other->DeviceView_());
 }
 
 //------------------------------------------------------------------------------
@@ -616,6 +1594,14 @@ ENABLE_IF_MUTABLE_IMPL inline void CudaArray2DBase<Derived>::Rot180(
   internal::CheckNotNull(other);
   internal::CheckSameDevice(*this, *other);
   internal::CheckSizeEqual2D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaArray2DBase::Rot180", 2 * Size() * sizeof(Scalar),
+                    device_, stream_, IsHost::value);
+  Rot180_(other, IsHost());
+}
+
+template <typename Derived>
+inline void CudaArray2DBase<Derived>::Rot180_(Derived *other,
+                                              std::false_type) const {
   // compute down columns; the width should be equal to the width of a CUDA
   // thread warp; the number of rows that each block covers is equal to
   // CudaArray2DBase<Derived>::kBlockRows
@@ -624,8 +1610,8 @@ ENABLE_IF_MUTABLE_IMPL inline void CudaArray2DBase<Derived>::Rot180(
                       (height_ + kTileSize - 1) / kTileSize);
 
   internal::SetDevice(device_);
-  kernel::CudaArray2DBaseRot180<<<grid_dim, block_dim, 0, stream_>>>(derived(),
-                                                                     *other);
+  kernel::CudaArray2DBaseRot180<<<grid_dim, block_dim, 0, stream_>>>(
+      DeviceView_(), other->DeviceView_());
 }
 
 //------------------------------------------------------------------------------
@@ -636,6 +1622,14 @@ ENABLE_IF_MUTABLE_IMPL inline void CudaArray2DBase<Derived>::Rot90_CCW(
   internal::CheckNotNull(other);
   internal::CheckSameDevice(*this, *other);
   internal::CheckFlippedSizeEqual2D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaArray2DBase::Rot90_CCW", 2 * Size() * sizeof(Scalar),
+                    device_, stream_, IsHost::value);
+  Rot90_CCW_(other, IsHost());
+}
+
+template <typename Derived>
+inline void CudaArray2DBase<Derived>::Rot90_CCW_(Derived *other,
+                                                 std::false_type) const {
   // compute down columns; the width should be equal to the width of a CUDA
   // thread warp; the number of rows that each block covers is equal to
   // CudaArray2DBase<Derived>::kBlockRows
@@ -646,7 +1640,7 @@ ENABLE_IF_MUTABLE_IMPL inline void CudaArray2DBase<Derived>::Rot90_CCW(
 
   internal::SetDevice(device_);
   kernel::CudaArray2DBaseRot90_CCW<<<grid_dim, block_dim, shm_size, stream_>>>(
-      derived(), *other);
+      DeviceView_(), other->DeviceView_());
 }
 
 //------------------------------------------------------------------------------
@@ -657,6 +1651,14 @@ ENABLE_IF_MUTABLE_IMPL inline void CudaArray2DBase<Derived>::Rot90_CW(
   internal::CheckNotNull(other);
   internal::CheckSameDevice(*this, *other);
   internal::CheckFlippedSizeEqual2D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaArray2DBase::Rot90_CW", 2 * Size() * sizeof(Scalar),
+                    device_, stream_, IsHost::value);
+  Rot90_CW_(other, IsHost());
+}
+
+template <typename Derived>
+inline void CudaArray2DBase<Derived>::Rot90_CW_(Derived *other,
+                                                std::false_type) const {
   // compute down columns; the width should be equal to the width of a CUDA
   // thread warp; the number of rows that each block covers is equal to
   // CudaArray2DBase<Derived>::kBlockRows
@@ -667,7 +1669,7 @@ ENABLE_IF_MUTABLE_IMPL inline void CudaArray2DBase<Derived>::Rot90_CW(
 
   internal::SetDevice(device_);
   kernel::CudaArray2DBaseRot90_CW<<<grid_dim, block_dim, shm_size, stream_>>>(
-      derived(), *other);
+      DeviceView_(), other->DeviceView_());
 }
 
 //------------------------------------------------------------------------------
@@ -678,6 +1680,14 @@ ENABLE_IF_MUTABLE_IMPL inline void CudaArray2DBase<Derived>::Transpose(
   internal::CheckNotNull(other);
   internal::CheckSameDevice(*this, *other);
   internal::CheckFlippedSizeEqual2D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaArray2DBase::Transpose", 2 * Size() * sizeof(Scalar),
+                    device_, stream_, IsHost::value);
+  Transpose_(other, IsHost());
+}
+
+template <typename Derived>
+inline void CudaArray2DBase<Derived>::Transpose_(Derived *other,
+                                                 std::false_type) const {
   // compute down columns; the width should be equal to the width of a CUDA
   // thread warp; the number of rows that each block covers is equal to
   // CudaArray2DBase<Derived>::kBlockRows
@@ -688,7 +1698,98 @@ ENABLE_IF_MUTABLE_IMPL inline void CudaArray2DBase<Derived>::Transpose(
 
   internal::SetDevice(device_);
   kernel::CudaArray2DBaseTranspose<<<grid_dim, block_dim, shm_size, stream_>>>(
-      derived(), *other);
+      DeviceView_(), other->DeviceView_());
+}
+
+//------------------------------------------------------------------------------
+
+// The rotations transpose the array and then flip it along the new x or y axis.
+template <typename Derived>
+ENABLE_IF_MUTABLE_IMPL inline void
+CudaArray2DBase<Derived>::Rot90_CCWInPlace() {
+  derived().TransposeInPlace();
+  LIBCUA_INSTRUMENT("CudaArray2DBase::Rot90_CCWInPlace",
+                    2 * Size() * sizeof(Scalar), device_, stream_,
+                    IsHost::value);
+  FlipUDInPlace_(IsHost());
+}
+
+template <typename Derived>
+ENABLE_IF_MUTABLE_IMPL inline void
+CudaArray2DBase<Derived>::Rot90_CWInPlace() {
+  derived().TransposeInPlace();
+  LIBCUA_INSTRUMENT("CudaArray2DBase::Rot90_CWInPlace",
+                    2 * Size() * sizeof(Scalar), device_, stream_,
+                    IsHost::value);
+  FlipLRInPlace_(IsHost());
+}
+
+template <typename Derived>
+inline void CudaArray2DBase<Derived>::FlipLRInPlace_(std::false_type) {
+  if (width_ < 2) {
+    return;
+  }
+
+  const dim3 block_dim(kTileSize, kBlockRows);
+  const dim3 grid_dim((width_ / 2 + kTileSize - 1) / kTileSize,
+                      (height_ + kTileSize - 1) / kTileSize);
+
+  internal::SetDevice(device_);
+  kernel::CudaArray2DBaseFlipLRInPlace<<<grid_dim, block_dim, 0, stream_>>>(
+      DeviceView_());
+}
+
+template <typename Derived>
+inline void CudaArray2DBase<Derived>::FlipUDInPlace_(std::false_type) {
+  if (height_ < 2) {
+    return;
+  }
+
+  const dim3 block_dim(kTileSize, kBlockRows);
+  const dim3 grid_dim((width_ + kTileSize - 1) / kTileSize,
+                      (height_ / 2 + kTileSize - 1) / kTileSize);
+
+  internal::SetDevice(device_);
+  kernel::CudaArray2DBaseFlipUDInPlace<<<grid_dim, block_dim, 0, stream_>>>(
+      DeviceView_());
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Derived>
+ENABLE_IF_MUTABLE_IMPL inline void
+CudaArray2DBase<Derived>::TransposeInPlace() {
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (width_ != height_) {
+    throw std::runtime_error(
+        "In-place transposition requires a square array, but the size is " +
+        internal::ArraySizeToString2D(*this) + ".");
+  }
+#endif
+  LIBCUA_INSTRUMENT("CudaArray2DBase::TransposeInPlace",
+                    2 * Size() * sizeof(Scalar), device_, stream_,
+                    IsHost::value);
+  TransposeInPlace_(IsHost());
+}
+
+template <typename Derived>
+inline void CudaArray2DBase<Derived>::TransposeInPlace_(std::false_type) {
+  // the kernel swaps two tiles through shared memory
+  static_assert(2 * sizeof(Scalar) * internal::kTransposeTileSize *
+                        (internal::kTransposeTileSize + 1) <=
+                    internal::kMaxTransposeSharedBytes,
+                "The scalar type is too large for the two shared-memory tiles "
+                "of the in-place transposition.");
+
+  // one block per tile, although only the blocks on and below the diagonal
+  // have any work
+  const dim3 block_dim(kTileSize, kBlockRows);
+  const dim3 grid_dim((width_ + kTileSize - 1) / kTileSize,
+                      (height_ + kTileSize - 1) / kTileSize);
+
+  internal::SetDevice(device_);
+  kernel::CudaArray2DBaseTransposeInPlace<<<grid_dim, block_dim, 0, stream_>>>(
+      DeviceView_());
 }
 
 //------------------------------------------------------------------------------
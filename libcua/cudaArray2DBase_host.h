@@ -0,0 +1,311 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_CUDA_ARRAY2D_BASE_HOST_H_
+#define LIBCUA_CUDA_ARRAY2D_BASE_HOST_H_
+
+#include "hostThreadPool.h"
+#include "philox.h"
+
+namespace cua {
+
+namespace host {
+
+//------------------------------------------------------------------------------
+//
+// Host (CPU) counterparts of the kernels in cudaArray2DBase_kernels.h. These
+// are used by CudaArray2DBase for array types whose CudaArrayTraits declare
+// IsHost, and they produce the same results as the corresponding kernels.
+//
+// Element-wise operations split the array into bands of whole rows, so each
+// thread streams through contiguous memory. Operations that swap the x and y
+// axes instead work on kTileSize x kTileSize tiles, so that both the rows read
+// from the source and the rows written to the destination stay in cache.
+//
+//------------------------------------------------------------------------------
+
+//
+// copy values of one array to another, possibly with different datatypes
+//
+template <typename SrcCls, typename DstCls>
+inline void CudaArray2DBaseCopyTo(const SrcCls &src, DstCls &dst) {
+  const size_t w = src.Width();
+  internal::ParallelForRows(src.Height(), w, [&](size_t y0, size_t y1) {
+    for (size_t y = y0; y < y1; ++y) {
+      for (size_t x = 0; x < w; ++x) {
+        dst.set(x, y, static_cast<typename DstCls::Scalar>(src.get(x, y)));
+      }
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+
+//
+// fill an array with a value
+//
+template <typename CudaArrayClass, typename T>
+inline void CudaArray2DBaseFill(CudaArrayClass &array, const T value) {
+  const size_t w = array.Width();
+  internal::ParallelForRows(array.Height(), w, [&](size_t y0, size_t y1) {
+    for (size_t y = y0; y < y1; ++y) {
+      for (size_t x = 0; x < w; ++x) {
+        array.set(x, y, value);
+      }
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+
+//
+// fill an array with counter-based random values, bit-identical to
+// kernel::CudaArray2DBaseFillRandomPhilox
+//
+template <typename CudaArrayClass, typename RandomFunction>
+inline void CudaArray2DBaseFillRandomPhilox(CudaArrayClass &array,
+                                            const PhiloxKey key,
+                                            const unsigned long long counter,
+                                            RandomFunction func) {
+  const size_t w = array.Width();
+  internal::ParallelForRows(array.Height(), w, [&](size_t y0, size_t y1) {
+    for (size_t y = y0; y < y1; ++y) {
+      for (size_t x = 0; x < w; x += 4) {
+        const PhiloxCounter bits = Philox4x32_10(
+            internal::MakePhiloxCounter(x / 4, y, counter), key);
+        for (unsigned int i = 0; i < 4 && x + i < w; ++i) {
+          array.set(x + i, y, func(internal::PhiloxWord(bits, i)));
+        }
+      }
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+
+//
+// general element-wise array operations
+// op: function mapping (x,y) -> CudaArrayClass::Scalar
+//
+template <typename CudaArrayClass, class Function>
+inline void CudaArray2DBaseApplyOp(CudaArrayClass &array, Function op) {
+  const size_t w = array.Width();
+  internal::ParallelForRows(array.Height(), w, [&](size_t y0, size_t y1) {
+    for (size_t y = y0; y < y1; ++y) {
+      for (size_t x = 0; x < w; ++x) {
+        array.set(x, y, op(x, y));
+      }
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+
+//
+// array(x,y) = op(array(x,y), value)
+//
+template <typename CudaArrayClass, typename T, class BinaryFunction>
+inline void CudaArray2DBaseApplyScalarOp(CudaArrayClass &array, const T value,
+                                         BinaryFunction op) {
+  const size_t w = array.Width();
+  internal::ParallelForRows(array.Height(), w, [&](size_t y0, size_t y1) {
+    for (size_t y = y0; y < y1; ++y) {
+      for (size_t x = 0; x < w; ++x) {
+        array.set(x, y, op(array.get(x, y), value));
+      }
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+//
+// array operations
+//
+//------------------------------------------------------------------------------
+
+template <typename SrcCls, typename DstCls>
+inline void CudaArray2DBaseFlipLR(const SrcCls &src, DstCls &dst) {
+  const size_t w = src.Width();
+  internal::ParallelForRows(src.Height(), w, [&](size_t y0, size_t y1) {
+    for (size_t y = y0; y < y1; ++y) {
+      for (size_t x = 0; x < w; ++x) {
+        dst.set(w - x - 1, y, src.get(x, y));
+      }
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+
+template <typename SrcCls, typename DstCls>
+inline void CudaArray2DBaseFlipUD(const SrcCls &src, DstCls &dst) {
+  const size_t w = src.Width();
+  const size_t h = src.Height();
+  internal::ParallelForRows(h, w, [&](size_t y0, size_t y1) {
+    for (size_t y = y0; y < y1; ++y) {
+      for (size_t x = 0; x < w; ++x) {
+        dst.set(x, h - y - 1, src.get(x, y));
+      }
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+
+template <typename SrcCls, typename DstCls>
+inline void CudaArray2DBaseRot180(const SrcCls &src, DstCls &dst) {
+  const size_t w = src.Width();
+  const size_t h = src.Height();
+  internal::ParallelForRows(h, w, [&](size_t y0, size_t y1) {
+    for (size_t y = y0; y < y1; ++y) {
+      for (size_t x = 0; x < w; ++x) {
+        dst.set(w - x - 1, h - y - 1, src.get(x, y));
+      }
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+
+template <typename SrcCls, typename DstCls>
+inline void CudaArray2DBaseRot90_CCW(const SrcCls &src, DstCls &dst) {
+  const size_t w = src.Width();
+  const size_t h = src.Height();
+  internal::ParallelForTiles(
+      w, h, SrcCls::kTileSize, [&](size_t x0, size_t x1, size_t y0, size_t y1) {
+        for (size_t y = y0; y < y1; ++y) {
+          for (size_t x = x0; x < x1; ++x) {
+            dst.set(y, w - 1 - x, src.get(x, y));
+          }
+        }
+      });
+}
+
+//------------------------------------------------------------------------------
+
+template <typename SrcCls, typename DstCls>
+inline void CudaArray2DBaseRot90_CW(const SrcCls &src, DstCls &dst) {
+  const size_t w = src.Width();
+  const size_t h = src.Height();
+  internal::ParallelForTiles(
+      w, h, SrcCls::kTileSize, [&](size_t x0, size_t x1, size_t y0, size_t y1) {
+        for (size_t y = y0; y < y1; ++y) {
+          for (size_t x = x0; x < x1; ++x) {
+            dst.set(h - 1 - y, x, src.get(x, y));
+          }
+        }
+      });
+}
+
+//------------------------------------------------------------------------------
+
+template <typename SrcCls, typename DstCls>
+inline void CudaArray2DBaseTranspose(const SrcCls &src, DstCls &dst) {
+  const size_t w = src.Width();
+  const size_t h = src.Height();
+  internal::ParallelForTiles(
+      w, h, SrcCls::kTileSize, [&](size_t x0, size_t x1, size_t y0, size_t y1) {
+        for (size_t y = y0; y < y1; ++y) {
+          for (size_t x = x0; x < x1; ++x) {
+            dst.set(y, x, src.get(x, y));
+          }
+        }
+      });
+}
+
+//------------------------------------------------------------------------------
+
+// square arrays only; each pair of mirrored tiles is swapped by the task of the
+// tile below the diagonal
+template <typename CudaArrayClass>
+inline void CudaArray2DBaseTransposeInPlace(CudaArrayClass &array) {
+  const size_t n = array.Width();
+  internal::ParallelForTiles(
+      n, n, CudaArrayClass::kTileSize,
+      [&](size_t x0, size_t x1, size_t y0, size_t y1) {
+        if (x0 > y0) {
+          return;
+        }
+        for (size_t y = y0; y < y1; ++y) {
+          const size_t max_x = (x0 == y0) ? y : x1;
+          for (size_t x = x0; x < max_x; ++x) {
+            const typename CudaArrayClass::Scalar value = array.get(x, y);
+            array.set(x, y, array.get(y, x));
+            array.set(y, x, value);
+          }
+        }
+      });
+}
+
+//------------------------------------------------------------------------------
+
+template <typename CudaArrayClass>
+inline void CudaArray2DBaseFlipLRInPlace(CudaArrayClass &array) {
+  const size_t w = array.Width();
+  internal::ParallelForRows(array.Height(), w, [&](size_t y0, size_t y1) {
+    for (size_t y = y0; y < y1; ++y) {
+      for (size_t x = 0; x < w / 2; ++x) {
+        const typename CudaArrayClass::Scalar value = array.get(x, y);
+        array.set(x, y, array.get(w - x - 1, y));
+        array.set(w - x - 1, y, value);
+      }
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+
+template <typename CudaArrayClass>
+inline void CudaArray2DBaseFlipUDInPlace(CudaArrayClass &array) {
+  const size_t w = array.Width();
+  const size_t h = array.Height();
+  internal::ParallelForRows(h / 2, w, [&](size_t y0, size_t y1) {
+    for (size_t y = y0; y < y1; ++y) {
+      for (size_t x = 0; x < w; ++x) {
+        const typename CudaArrayClass::Scalar value = array.get(x, y);
+        array.set(x, y, array.get(x, h - y - 1));
+        array.set(x, h - y - 1, value);
+      }
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace host
+
+}  // namespace cua
+
+#endif  // LIBCUA_CUDA_ARRAY2D_BASE_HOST_H_
@@ -39,6 +39,8 @@
 #include <curand.h>
 #include <curand_kernel.h>
 
+#include "philox.h"
+
 namespace cua {
 
 namespace kernel {
@@ -48,6 +50,10 @@ namespace kernel {
 // class-specific kernel functions for the CudaArray2DBase class
 // TODO (True): provide proper documentation for these kernel functions
 //
+// The element-wise kernels (CopyTo, Fill, ApplyOp, ApplyScalarOp) are
+// grid-stride loops, so they cover the whole array for any launch grid; see
+// LaunchMode in launchConfig.h.
+//
 //------------------------------------------------------------------------------
 
 //
@@ -55,11 +61,14 @@ namespace kernel {
 //
 template <typename SrcCls, typename DstCls>
 __global__ void CudaArray2DBaseCopyTo(const SrcCls src, DstCls dst) {
-  const typename SrcCls::IndexType x = blockIdx.x * blockDim.x + threadIdx.x;
-  const typename SrcCls::IndexType y = blockIdx.y * blockDim.y + threadIdx.y;
+  typedef typename SrcCls::IndexType IndexType;
 
-  if (x < src.Width() && y < src.Height()) {
-    dst.set(x, y, static_cast<typename DstCls::Scalar>(src.get(x, y)));
+  for (IndexType y = blockIdx.y * blockDim.y + threadIdx.y; y < src.Height();
+       y += gridDim.y * blockDim.y) {
+    for (IndexType x = blockIdx.x * blockDim.x + threadIdx.x; x < src.Width();
+         x += gridDim.x * blockDim.x) {
+      dst.set(x, y, static_cast<typename DstCls::Scalar>(src.get(x, y)));
+    }
   }
 }
 
@@ -70,13 +79,14 @@ __global__ void CudaArray2DBaseCopyTo(const SrcCls src, DstCls dst) {
 //
 template <typename CudaArrayClass, typename T>
 __global__ void CudaArray2DBaseFill(CudaArrayClass array, const T value) {
-  const typename CudaArrayClass::IndexType x =
-      blockIdx.x * blockDim.x + threadIdx.x;
-  const typename CudaArrayClass::IndexType y =
-      blockIdx.y * blockDim.y + threadIdx.y;
+  typedef typename CudaArrayClass::IndexType IndexType;
 
-  if (x < array.Width() && y < array.Height()) {
-    array.set(x, y, value);
+  for (IndexType y = blockIdx.y * blockDim.y + threadIdx.y; y < array.Height();
+       y += gridDim.y * blockDim.y) {
+    for (IndexType x = blockIdx.x * blockDim.x + threadIdx.x;
+         x < array.Width(); x += gridDim.x * blockDim.x) {
+      array.set(x, y, value);
+    }
   }
 }
 
@@ -119,24 +129,36 @@ __global__ void CudaArray2DBaseFillRandom(CudaRandomStateArrayClass rand_state,
 //------------------------------------------------------------------------------
 
 //
-// set a single value in a CudaArray2DBase object
+// fill CudaArray2DBase with counter-based random values; each thread fills
+// four consecutive elements of a row from one Philox4x32 block (see philox.h)
 //
-template <typename CudaArrayClass, typename T>
-__global__ void CudaArray2DBaseSet(CudaArrayClass array, const T value,
-                                   const int x, const int y) {
-  array.set(x, y, value);
+template <typename CudaArrayClass, typename RandomFunction>
+__global__ void CudaArray2DBaseFillRandomPhilox(
+    CudaArrayClass array, const PhiloxKey key,
+    const unsigned long long counter, RandomFunction func) {
+  const unsigned int x4 = blockIdx.x * blockDim.x + threadIdx.x;
+  const unsigned int x = 4 * x4;
+  const unsigned int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+  if (x < array.Width() && y < array.Height()) {
+    const PhiloxCounter bits =
+        Philox4x32_10(internal::MakePhiloxCounter(x4, y, counter), key);
+    array.set(x, y, func(bits.x));
+    if (x + 1 < array.Width()) array.set(x + 1, y, func(bits.y));
+    if (x + 2 < array.Width()) array.set(x + 2, y, func(bits.z));
+    if (x + 3 < array.Width()) array.set(x + 3, y, func(bits.w));
+  }
 }
 
 //------------------------------------------------------------------------------
 
 //
-// get a single value in a CudaArray2DBase object
-// NOTE: we assume array bounds have been checked prior to calling this kernel
+// set a single value in a CudaArray2DBase object
 //
 template <typename CudaArrayClass, typename T>
-__global__ void CudaArray2DBaseGet(CudaArrayClass array, const T *value,
+__global__ void CudaArray2DBaseSet(CudaArrayClass array, const T value,
                                    const int x, const int y) {
-  *value = array.get(x, y);
+  array.set(x, y, value);
 }
 
 //------------------------------------------------------------------------------
@@ -176,6 +198,60 @@ __global__ void CudaArray2DBaseTranspose(const SrcCls src, DstCls dst) {
   }
 }
 
+//------------------------------------------------------------------------------
+
+//
+// transpose a square array in place: each block swaps the pair of tiles at
+// (blockIdx.x, blockIdx.y) and (blockIdx.y, blockIdx.x), transposing both
+// through shared memory; tiles on the diagonal are transposed onto themselves
+//
+template <typename CudaArrayClass>
+__global__ void CudaArray2DBaseTransposeInPlace(CudaArrayClass array) {
+  typedef typename CudaArrayClass::Scalar Scalar;
+  typedef typename CudaArrayClass::IndexType IndexType;
+
+  // each pair of tiles is handled by the block below the diagonal
+  if (blockIdx.x > blockIdx.y) {
+    return;
+  }
+
+  __shared__ Scalar tile_a[CudaArrayClass::kTileSize]
+                          [CudaArrayClass::kTileSize + 1];
+  __shared__ Scalar tile_b[CudaArrayClass::kTileSize]
+                          [CudaArrayClass::kTileSize + 1];
+
+  const typename CudaArrayClass::SizeType n = array.Width();
+  const bool diagonal = (blockIdx.x == blockIdx.y);
+
+  const IndexType x_a = blockIdx.x * CudaArrayClass::kTileSize + threadIdx.x;
+  const IndexType y_a = blockIdx.y * CudaArrayClass::kTileSize + threadIdx.y;
+  const IndexType x_b = blockIdx.y * CudaArrayClass::kTileSize + threadIdx.x;
+  const IndexType y_b = blockIdx.x * CudaArrayClass::kTileSize + threadIdx.y;
+
+  for (IndexType j = 0; j < CudaArrayClass::kTileSize;
+       j += CudaArrayClass::kBlockRows) {
+    if (x_a < n && y_a + j < n) {
+      tile_a[threadIdx.y + j][threadIdx.x] = array.get(x_a, y_a + j);
+    }
+    if (!diagonal && x_b < n && y_b + j < n) {
+      tile_b[threadIdx.y + j][threadIdx.x] = array.get(x_b, y_b + j);
+    }
+  }
+
+  __syncthreads();
+
+  for (IndexType j = 0; j < CudaArrayClass::kTileSize;
+       j += CudaArrayClass::kBlockRows) {
+    if (x_a < n && y_a + j < n) {
+      array.set(x_a, y_a + j, diagonal ? tile_a[threadIdx.x][threadIdx.y + j]
+                                       : tile_b[threadIdx.x][threadIdx.y + j]);
+    }
+    if (!diagonal && x_b < n && y_b + j < n) {
+      array.set(x_b, y_b + j, tile_a[threadIdx.x][threadIdx.y + j]);
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 //
 // array operations
@@ -251,6 +327,61 @@ __global__ void CudaArray2DBaseRot180(const SrcCls src, DstCls dst) {
 
 //------------------------------------------------------------------------------
 
+//
+// in-place flips swap each element with its mirror image; only the threads for
+// the left (top) half of the array are active
+//
+
+template <typename CudaArrayClass>
+__global__ void CudaArray2DBaseFlipLRInPlace(CudaArrayClass array) {
+  const typename CudaArrayClass::IndexType x =
+      blockIdx.x * CudaArrayClass::kTileSize + threadIdx.x;
+
+  const typename CudaArrayClass::SizeType w = array.Width();
+
+  if (x < w / 2) {
+    const typename CudaArrayClass::IndexType y =
+        blockIdx.y * CudaArrayClass::kTileSize + threadIdx.y;
+    const typename CudaArrayClass::SizeType h = array.Height();
+    const typename CudaArrayClass::SizeType max_y =
+        min(y + CudaArrayClass::kTileSize, h);
+
+    for (typename CudaArrayClass::IndexType j = y; j < max_y;
+         j += CudaArrayClass::kBlockRows) {
+      const typename CudaArrayClass::Scalar value = array.get(x, j);
+      array.set(x, j, array.get(w - x - 1, j));
+      array.set(w - x - 1, j, value);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <typename CudaArrayClass>
+__global__ void CudaArray2DBaseFlipUDInPlace(CudaArrayClass array) {
+  const typename CudaArrayClass::IndexType x =
+      blockIdx.x * CudaArrayClass::kTileSize + threadIdx.x;
+
+  const typename CudaArrayClass::SizeType w = array.Width();
+
+  if (x < w) {
+    const typename CudaArrayClass::IndexType y =
+        blockIdx.y * CudaArrayClass::kTileSize + threadIdx.y;
+    const typename CudaArrayClass::SizeType h = array.Height();
+    const typename CudaArrayClass::SizeType max_y =
+        min(y + CudaArrayClass::kTileSize, h / 2);
+
+    for (typename CudaArrayClass::IndexType j = y; j < max_y;
+         j += CudaArrayClass::kBlockRows) {
+      const typename CudaArrayClass::Scalar value = array.get(x, j);
+      array.set(x, j, array.get(x, h - j - 1));
+      array.set(x, h - j - 1, value);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
 template <typename SrcCls, typename DstCls>
 __global__ void CudaArray2DBaseRot90_CCW(const SrcCls src, DstCls dst) {
   __shared__ typename SrcCls::Scalar tile[SrcCls::kTileSize][SrcCls::kTileSize];
@@ -328,13 +459,35 @@ __global__ void CudaArray2DBaseRot90_CW(const SrcCls src, DstCls dst) {
 //
 template <typename CudaArrayClass, class Function>
 __global__ void CudaArray2DBaseApplyOp(CudaArrayClass array, Function op) {
-  const typename CudaArrayClass::IndexType x =
-      blockIdx.x * blockDim.x + threadIdx.x;
-  const typename CudaArrayClass::IndexType y =
-      blockIdx.y * blockDim.y + threadIdx.y;
+  typedef typename CudaArrayClass::IndexType IndexType;
 
-  if (x < array.Width() && y < array.Height()) {
-    array.set(x, y, op(x, y));
+  for (IndexType y = blockIdx.y * blockDim.y + threadIdx.y; y < array.Height();
+       y += gridDim.y * blockDim.y) {
+    for (IndexType x = blockIdx.x * blockDim.x + threadIdx.x;
+         x < array.Width(); x += gridDim.x * blockDim.x) {
+      array.set(x, y, op(x, y));
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+//
+// kernel for element-wise operations with a scalar, e.g., array += value
+// op: __host__ __device__ function mapping (array(x,y), value) -> Scalar
+//
+template <typename CudaArrayClass, typename T, class BinaryFunction>
+__global__ void CudaArray2DBaseApplyScalarOp(CudaArrayClass array,
+                                             const T value,
+                                             BinaryFunction op) {
+  typedef typename CudaArrayClass::IndexType IndexType;
+
+  for (IndexType y = blockIdx.y * blockDim.y + threadIdx.y; y < array.Height();
+       y += gridDim.y * blockDim.y) {
+    for (IndexType x = blockIdx.x * blockDim.x + threadIdx.x;
+         x < array.Width(); x += gridDim.x * blockDim.x) {
+      array.set(x, y, op(array.get(x, y), value));
+    }
   }
 }
 
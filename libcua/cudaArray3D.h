@@ -40,7 +40,11 @@
 
 #include <memory>  // for shared_ptr
 
+#include "cachingAllocator.h"
 #include "cudaArray_fwd.h"
+#include "cudaEvent.h"
+#include "deviceView.h"
+#include "stagingBufferPool.h"
 #include "util.h"
 
 namespace cua {
@@ -54,10 +58,14 @@ namespace cua {
  * arrays is a shallow operation. Use `Copy()` or `CopyTo(other)` to perform a
  * deep copy.
  *
- * The arrays can be directly passed into device-level code, i.e., you can write
- * kernels that have CudaArray3D objects in their parameter lists:
+ * Device memory is obtained from `CachingAllocator<>::Instance()`, so creating
+ * and destroying arrays of similar sizes does not synchronize the device. Call
+ * `CachingAllocator<>::Instance().Trim()` to release unused memory.
  *
- *     __global__ void device_kernel(CudaArray3D<float> arr) {
+ * To access the array in your own kernels, pass its DeviceView() as the kernel
+ * parameter (see CudaArray2D):
+ *
+ *     __global__ void device_kernel(CudaArray3DDeviceView<float> arr) {
  *       const int x = blockIdx.x * blockDim.x + threadIdx.x;
  *       const int y = blockIdx.y * blockDim.y + threadIdx.y;
  *       const int z = blockIdx.z * blockDim.z + threadIdx.z;
@@ -139,6 +147,13 @@ class CudaArray3D : public CudaArray3DBase<CudaArray3D<T>> {
    */
   CudaArray3D<T> EmptyCopy(int device = -1) const;
 
+  /**
+   * Create an empty array with the axes of the current array reordered, e.g.,
+   * a depth x width x height array for AxisPermutation::kZXY.
+   * @param permutation new order of the axes; see AxisPermutation
+   */
+  CudaArray3D<T> EmptyPermutedCopy(AxisPermutation permutation) const;
+
   /**
    * Shallow re-assignment of the given array to share the contents of another.
    * @param other a separate array whose contents will now also be referenced by
@@ -155,6 +170,19 @@ class CudaArray3D : public CudaArray3DBase<CudaArray3D<T>> {
    */
   CudaArray3D<T> &operator=(const T *host_array);
 
+  /**
+   * Evaluate an element-wise array expression into the current array; see
+   * Assign().
+   * @param expression expression over arrays of the same size as this array
+   * @return *this
+   */
+  template <typename Expression>
+  inline CudaArray3D<T> &operator=(
+      const ArrayExpression<Expression> &expression) {
+    Base::Assign(expression);
+    return *this;
+  }
+
   /**
    * Copy the contents of the current array to a CPU-bound memory array. This
    * function assumes that the CPU array has the correct size!
@@ -168,6 +196,12 @@ class CudaArray3D : public CudaArray3DBase<CudaArray3D<T>> {
    */
   void CopyTo(CudaArray3D<T> *other) const;
 
+  /**
+   * Download to a host array (requires cudaHostArray3D.h).
+   * @param other destination array
+   */
+  void CopyTo(CudaHostArray3D<T> *other) const;
+
   /**
    * Copy to a surface.
    * @param other destination surface
@@ -182,6 +216,59 @@ class CudaArray3D : public CudaArray3DBase<CudaArray3D<T>> {
   template <typename OtherDerived>
   void CopyTo(CudaTexture3DBase<OtherDerived> *other) const;
 
+  //----------------------------------------------------------------------------
+  // asynchronous copies
+  //
+  // These functions enqueue the copy on the array's stream and return an event
+  // recorded right after it; see CudaArray2D.
+
+  /**
+   * Asynchronously copy the contents of a densely packed CPU array to the
+   * current array. This function assumes that the CPU array has the correct
+   * size!
+   * @param host_array the CPU-bound array
+   * @return event that completes with the copy
+   */
+  CudaEvent AssignAsync(const T *host_array);
+
+  /**
+   * Asynchronously copy the contents of the current array to a densely packed
+   * CPU array. This function assumes that the CPU array has the correct size!
+   * @param host_array the CPU-bound array
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(T *host_array) const;
+
+  /**
+   * Asynchronously copy to an array, which may be on another device.
+   * @param other destination array
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(CudaArray3D<T> *other) const;
+
+  /**
+   * Asynchronously download to a host array (requires cudaHostArray3D.h).
+   * @param other destination array
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(CudaHostArray3D<T> *other) const;
+
+  /**
+   * Asynchronously copy to a surface, which may be on another device.
+   * @param other destination surface
+   * @return event that completes with the copy
+   */
+  template <typename OtherDerived>
+  CudaEvent CopyToAsync(CudaSurface3DBase<OtherDerived> *other) const;
+
+  /**
+   * Asynchronously copy to a texture, which may be on another device.
+   * @param other destination texture
+   * @return event that completes with the copy
+   */
+  template <typename OtherDerived>
+  CudaEvent CopyToAsync(CudaTexture3DBase<OtherDerived> *other) const;
+
   //----------------------------------------------------------------------------
 
   /**
@@ -205,6 +292,30 @@ class CudaArray3D : public CudaArray3DBase<CudaArray3D<T>> {
   //----------------------------------------------------------------------------
   // getters/setters
 
+  /**
+   * Set the stream used by the array's operations. Since the memory of the
+   * array was allocated for its original stream, the stream is also passed to
+   * RecordStream().
+   * @param stream CUDA stream on the array's device
+   */
+  inline void SetStream(const cudaStream_t stream) {
+    Base::SetStream(stream);
+    RecordStream(stream);
+  }
+
+  /**
+   * Mark the memory of the array as used on the given stream: once the last
+   * array sharing the memory is destroyed, CachingAllocator does not hand the
+   * memory out again until the work queued on the stream by then has
+   * completed. SetStream() and CopyToAsync() call this as needed; call it
+   * directly for other work that accesses the array on a stream other than its
+   * own.
+   * @param stream CUDA stream on the array's device
+   */
+  inline void RecordStream(const cudaStream_t stream) const {
+    CachingAllocator<>::Instance().RecordStream(dev_array_.get(), stream);
+  }
+
   /**
    * Device-level function for getting the address of element in an array
    * @param x first coordinate
@@ -253,6 +364,14 @@ class CudaArray3D : public CudaArray3DBase<CudaArray3D<T>> {
    */
   __host__ __device__ inline size_t Pitch() const { return pitch_; }
 
+  /**
+   * @return trivially copyable view of the array for kernel parameter lists
+   */
+  __host__ __device__ inline CudaArray3DDeviceView<T> DeviceView() const {
+    return CudaArray3DDeviceView<T>(dev_array_ref_, pitch_, y_pitch_, width_,
+                                    height_, depth_);
+  }
+
   /**
    * Return a cudaPitchedPtr representation for the underlying allocated memory.
    */
@@ -296,15 +415,14 @@ CudaArray3D<T>::CudaArray3D<T>(SizeType width, SizeType height, SizeType depth,
     : Base(width, height, depth, device, block_dim, stream),
       dev_array_(nullptr),
       y_pitch_(height) {
-  cudaPitchedPtr dev_pitched_ptr;
-  cudaMalloc3D(&dev_pitched_ptr,
-               make_cudaExtent(sizeof(T) * width_, height_, depth_));
-
-  pitch_ = dev_pitched_ptr.pitch;
-  dev_array_ref_ = reinterpret_cast<T *>(dev_pitched_ptr.ptr);
+  dev_array_ref_ =
+      reinterpret_cast<T *>(CachingAllocator<>::Instance().AllocatePitched(
+          sizeof(T) * width_, static_cast<size_t>(height_) * depth_, device_,
+          stream_, &pitch_));
 #ifdef __CUDA_ARCH__
 #else
-  dev_array_ = std::shared_ptr<T>(dev_array_ref_, cudaFree);
+  dev_array_ = std::shared_ptr<T>(
+      dev_array_ref_, [](T *ptr) { CachingAllocator<>::Instance().Free(ptr); });
 #endif
 }
 
@@ -369,20 +487,42 @@ inline CudaArray3D<T> CudaArray3D<T>::EmptyCopy(int device) const {
 
 //------------------------------------------------------------------------------
 
+template <typename T>
+inline CudaArray3D<T> CudaArray3D<T>::EmptyPermutedCopy(
+    AxisPermutation permutation) const {
+  const SizeType sizes[3] = {width_, height_, depth_};
+  return CudaArray3D<T>(sizes[internal::PermutedAxis(permutation, 0)],
+                        sizes[internal::PermutedAxis(permutation, 1)],
+                        sizes[internal::PermutedAxis(permutation, 2)], device_,
+                        block_dim_, stream_);
+}
+
+//------------------------------------------------------------------------------
+
 template <typename T>
 inline CudaArray3D<T> &CudaArray3D<T>::operator=(const T *host_array) {
   internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaArray3D::Upload",
+                    2 * sizeof(T) * width_ * height_ * depth_, device_, stream_,
+                    false);
   internal::SetDevice(device_);
 
-  size_t width_in_bytes = width_ * sizeof(T);
-  cudaMemcpy3DParms params = {0};
-  params.srcPtr = make_cudaPitchedPtr(const_cast<T *>(host_array),
-                                      width_in_bytes, width_in_bytes, height_);
-  params.dstPtr = GetPitchedPtr();
-  params.extent = make_cudaExtent(width_in_bytes, height_, depth_);
-  params.kind = cudaMemcpyHostToDevice;
-
-  cudaMemcpy3D(&params);  // last copy is synchronous
+  const size_t width_in_bytes = width_ * sizeof(T);
+  StagingBufferPool<>::Instance().Upload(
+      host_array, width_in_bytes, static_cast<size_t>(height_) * depth_,
+      stream_,
+      [&](const void *src, size_t first_row, size_t num_rows,
+          cudaStream_t stream) {
+        internal::ForEachSliceRun(
+            first_row, num_rows, height_,
+            [&](size_t y, size_t z, size_t n, size_t offset) {
+              cudaMemcpy2DAsync(
+                  ptr(0, y, z), pitch_,
+                  reinterpret_cast<const char *>(src) + offset * width_in_bytes,
+                  width_in_bytes, width_in_bytes, n, cudaMemcpyHostToDevice,
+                  stream);
+            });
+      });
 
   return *this;
 }
@@ -414,17 +554,25 @@ inline CudaArray3D<T> &CudaArray3D<T>::operator=(const CudaArray3D<T> &other) {
 template <typename T>
 inline void CudaArray3D<T>::CopyTo(T *host_array) const {
   internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaArray3D::Download",
+                    2 * sizeof(T) * width_ * height_ * depth_, device_, stream_,
+                    false);
   internal::SetDevice(device_);
 
-  size_t width_in_bytes = width_ * sizeof(T);
-  cudaMemcpy3DParms params = {0};
-  params.srcPtr = GetPitchedPtr();
-  params.dstPtr =
-      make_cudaPitchedPtr(host_array, width_in_bytes, width_in_bytes, height_);
-  params.extent = make_cudaExtent(width_in_bytes, height_, depth_);
-  params.kind = cudaMemcpyDeviceToHost;
-
-  cudaMemcpy3D(&params);
+  const size_t width_in_bytes = width_ * sizeof(T);
+  StagingBufferPool<>::Instance().Download(
+      host_array, width_in_bytes, static_cast<size_t>(height_) * depth_,
+      stream_,
+      [&](void *dst, size_t first_row, size_t num_rows, cudaStream_t stream) {
+        internal::ForEachSliceRun(
+            first_row, num_rows, height_,
+            [&](size_t y, size_t z, size_t n, size_t offset) {
+              cudaMemcpy2DAsync(
+                  reinterpret_cast<char *>(dst) + offset * width_in_bytes,
+                  width_in_bytes, ptr(0, y, z), pitch_, width_in_bytes, n,
+                  cudaMemcpyDeviceToHost, stream);
+            });
+      });
 }
 
 //------------------------------------------------------------------------------
@@ -436,6 +584,9 @@ inline void CudaArray3D<T>::CopyTo(CudaArray3D<T> *other) const {
   }
   internal::CheckNotNull(other);
   internal::CheckSizeEqual3D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaArray3D::CopyTo",
+                    2 * sizeof(T) * width_ * height_ * depth_, device_, 0,
+                    false);
   internal::SetDevice(device_);
 
   if (device_ == other->Device()) {
@@ -460,6 +611,26 @@ inline void CudaArray3D<T>::CopyTo(CudaArray3D<T> *other) const {
 
 //------------------------------------------------------------------------------
 
+template <typename T>
+inline void CudaArray3D<T>::CopyTo(CudaHostArray3D<T> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual3D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaArray3D::Download",
+                    2 * sizeof(T) * width_ * height_ * depth_, device_, 0,
+                    false);
+  internal::SetDevice(device_);
+
+  cudaMemcpy3DParms params = {0};
+  params.srcPtr = GetPitchedPtr();
+  params.dstPtr = other->GetPitchedPtr();
+  params.extent = make_cudaExtent(width_ * sizeof(T), height_, depth_);
+  params.kind = cudaMemcpyDeviceToHost;
+
+  cudaMemcpy3D(&params);
+}
+
+//------------------------------------------------------------------------------
+
 template <typename T>
 template <typename OtherDerived>
 inline void CudaArray3D<T>::CopyTo(
@@ -526,6 +697,182 @@ inline void CudaArray3D<T>::CopyTo(
 
 //------------------------------------------------------------------------------
 
+template <typename T>
+inline CudaEvent CudaArray3D<T>::AssignAsync(const T *host_array) {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaArray3D::UploadAsync",
+                    2 * sizeof(T) * width_ * height_ * depth_, device_, stream_,
+                    false);
+  internal::SetDevice(device_);
+
+  const size_t width_in_bytes = width_ * sizeof(T);
+  cudaMemcpy3DParms params = {0};
+  params.srcPtr = make_cudaPitchedPtr(const_cast<T *>(host_array),
+                                      width_in_bytes, width_in_bytes, height_);
+  params.dstPtr = GetPitchedPtr();
+  params.extent = make_cudaExtent(width_in_bytes, height_, depth_);
+  params.kind = cudaMemcpyHostToDevice;
+
+  cudaMemcpy3DAsync(&params, stream_);
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaArray3D<T>::CopyToAsync(T *host_array) const {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaArray3D::DownloadAsync",
+                    2 * sizeof(T) * width_ * height_ * depth_, device_, stream_,
+                    false);
+  internal::SetDevice(device_);
+
+  const size_t width_in_bytes = width_ * sizeof(T);
+  cudaMemcpy3DParms params = {0};
+  params.srcPtr = GetPitchedPtr();
+  params.dstPtr =
+      make_cudaPitchedPtr(host_array, width_in_bytes, width_in_bytes, height_);
+  params.extent = make_cudaExtent(width_in_bytes, height_, depth_);
+  params.kind = cudaMemcpyDeviceToHost;
+
+  cudaMemcpy3DAsync(&params, stream_);
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaArray3D<T>::CopyToAsync(CudaArray3D<T> *other) const {
+  if (this == other) {
+    return CudaEvent();
+  }
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual3D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaArray3D::CopyToAsync",
+                    2 * sizeof(T) * width_ * height_ * depth_, device_, stream_,
+                    false);
+  internal::SetDevice(device_);
+
+  if (device_ == other->Device()) {
+    other->RecordStream(stream_);  // the copy writes other on our stream
+    cudaMemcpy3DParms params = {0};
+    params.srcPtr = GetPitchedPtr();
+    params.dstPtr = other->GetPitchedPtr();
+    params.extent = make_cudaExtent(width_ * sizeof(T), height_, depth_);
+    params.kind = cudaMemcpyDeviceToDevice;
+
+    cudaMemcpy3DAsync(&params, stream_);
+  } else {
+    cudaMemcpy3DPeerParms params = {0};
+    params.srcDevice = device_;
+    params.dstDevice = other->Device();
+    params.srcPtr = GetPitchedPtr();
+    params.dstPtr = other->GetPitchedPtr();
+    params.extent = make_cudaExtent(width_ * sizeof(T), height_, depth_);
+
+    cudaMemcpy3DPeerAsync(&params, stream_);
+
+    // as in CudaArray2D::CopyToAsync(), other's stream waits for the peer
+    // copy before the memory of other can be handed out again
+    const CudaEvent copied = CudaEvent::Record(stream_);
+    internal::SetDevice(other->Device());
+    copied.Wait(other->Stream());
+    return copied;
+  }
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaArray3D<T>::CopyToAsync(CudaHostArray3D<T> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual3D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaArray3D::DownloadAsync",
+                    2 * sizeof(T) * width_ * height_ * depth_, device_, stream_,
+                    false);
+  internal::SetDevice(device_);
+
+  cudaMemcpy3DParms params = {0};
+  params.srcPtr = GetPitchedPtr();
+  params.dstPtr = other->GetPitchedPtr();
+  params.extent = make_cudaExtent(width_ * sizeof(T), height_, depth_);
+  params.kind = cudaMemcpyDeviceToHost;
+
+  cudaMemcpy3DAsync(&params, stream_);
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+template <typename OtherDerived>
+inline CudaEvent CudaArray3D<T>::CopyToAsync(
+    CudaSurface3DBase<OtherDerived> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual3D(*this, *other);
+  internal::SetDevice(device_);
+
+  if (device_ == other->Device()) {
+    cudaMemcpy3DParms params = {0};
+    params.srcPtr = GetPitchedPtr();
+    params.dstArray = other->DeviceArray();
+    params.dstPos =
+        make_cudaPos(other->XOffset(), other->YOffset(), other->ZOffset());
+    params.extent = make_cudaExtent(width_, height_, depth_);
+    params.kind = cudaMemcpyDeviceToDevice;
+
+    cudaMemcpy3DAsync(&params, stream_);
+  } else {
+    cudaMemcpy3DPeerParms params = {0};
+    params.srcDevice = device_;
+    params.dstDevice = other->Device();
+    params.srcPtr = GetPitchedPtr();
+    params.dstArray = other->DeviceArray();
+    params.dstPos =
+        make_cudaPos(other->XOffset(), other->YOffset(), other->ZOffset());
+    params.extent = make_cudaExtent(width_, height_, depth_);
+
+    cudaMemcpy3DPeerAsync(&params, stream_);
+  }
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+template <typename OtherDerived>
+inline CudaEvent CudaArray3D<T>::CopyToAsync(
+    CudaTexture3DBase<OtherDerived> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual3D(*this, *other);
+  internal::SetDevice(device_);
+
+  if (device_ == other->Device()) {
+    cudaMemcpy3DParms params = {0};
+    params.srcPtr = GetPitchedPtr();
+    params.dstArray = other->DeviceArray();
+    params.dstPos = make_cudaPos(0, 0, 0);
+    params.extent = make_cudaExtent(width_, height_, depth_);
+    params.kind = cudaMemcpyDeviceToDevice;
+
+    cudaMemcpy3DAsync(&params, stream_);
+  } else {
+    cudaMemcpy3DPeerParms params = {0};
+    params.srcDevice = device_;
+    params.dstDevice = other->Device();
+    params.srcPtr = GetPitchedPtr();
+    params.dstArray = other->DeviceArray();
+    params.dstPos = make_cudaPos(0, 0, 0);
+    params.extent = make_cudaExtent(width_, height_, depth_);
+
+    cudaMemcpy3DPeerAsync(&params, stream_);
+  }
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
 //
 // template typedef for CRTP model, a la Eigen
 //
@@ -533,6 +880,7 @@ template <typename T>
 struct CudaArrayTraits<CudaArray3D<T>> {
   typedef T Scalar;
   typedef bool Mutable;
+  typedef CudaArray3DDeviceView<T> DeviceView;
 };
 
 }  // namespace cua
@@ -36,11 +36,30 @@
 #ifndef LIBCUA_CUDA_ARRAY3D_BASE_H_
 #define LIBCUA_CUDA_ARRAY3D_BASE_H_
 
+#include "cudaArray3DBase_host.h"
+
+#include <algorithm>
+#include <type_traits>
+
 #include <curand.h>
 #include <curand_kernel.h>
 
+#include "arrayExpression.h"
+#include "blockDimTuner.h"
+#include "convolution.h"
+#include "deviceView.h"
+#include "functional.h"
+#include "gatherScatter.h"
+#include "histogram.h"
+#include "instrumentation.h"
+#include "launchConfig.h"
+#include "philox.h"
+#include "reduction.h"
+#include "scan.h"
+#include "stencil.h"
 #include "types.h"
 #include "util.h"
+#include "zip.h"
 
 namespace cua {
 
@@ -53,24 +72,45 @@ namespace cua {
 #define ENABLE_IF_MUTABLE_IMPL \
   template <class C, typename C::Mutable is_mutable>
 
+namespace internal {
+
+// index i along an axis of the given size, counted from the other end if flip
+// is set
+template <typename IndexType, typename SizeType>
+__host__ __device__ inline IndexType FlipIndex(const IndexType i,
+                                               const SizeType size,
+                                               const bool flip) {
+  return flip ? size - 1 - i : i;
+}
+
+}  // namespace internal
+
 namespace kernel {
 
 //
 // kernel definitions
 // TODO: once we have more kernel functions, move them to a separate file
 //
+// The element-wise kernels (CopyTo, Fill, ApplyOp, ApplyScalarOp) are
+// grid-stride loops, so they cover the whole array for any launch grid; see
+// LaunchMode in launchConfig.h.
+//
 
 //
 // copy values of one surface to another, possibly with different datatypes
 //
 template <typename SrcCls, typename DstCls>
 __global__ void CudaArray3DBaseCopyTo(const SrcCls src, DstCls dst) {
-  const unsigned int x = blockIdx.x * blockDim.x + threadIdx.x;
-  const unsigned int y = blockIdx.y * blockDim.y + threadIdx.y;
-  const unsigned int z = blockIdx.z * blockDim.z + threadIdx.z;
-
-  if (x < src.Width() && y < src.Height() && z < src.Depth()) {
-    dst.set(x, y, z, static_cast<typename DstCls::Scalar>(src.get(x, y, z)));
+  for (unsigned int z = blockIdx.z * blockDim.z + threadIdx.z; z < src.Depth();
+       z += gridDim.z * blockDim.z) {
+    for (unsigned int y = blockIdx.y * blockDim.y + threadIdx.y;
+         y < src.Height(); y += gridDim.y * blockDim.y) {
+      for (unsigned int x = blockIdx.x * blockDim.x + threadIdx.x;
+           x < src.Width(); x += gridDim.x * blockDim.x) {
+        dst.set(x, y, z,
+                static_cast<typename DstCls::Scalar>(src.get(x, y, z)));
+      }
+    }
   }
 }
 
@@ -80,12 +120,35 @@ __global__ void CudaArray3DBaseCopyTo(const SrcCls src, DstCls dst) {
 //
 template <typename CudaArrayClass, class Function>
 __global__ void CudaArray3DBaseApplyOp(CudaArrayClass array, Function op) {
-  const unsigned int x = blockIdx.x * blockDim.x + threadIdx.x;
-  const unsigned int y = blockIdx.y * blockDim.y + threadIdx.y;
-  const unsigned int z = blockIdx.z * blockDim.z + threadIdx.z;
+  for (unsigned int z = blockIdx.z * blockDim.z + threadIdx.z;
+       z < array.Depth(); z += gridDim.z * blockDim.z) {
+    for (unsigned int y = blockIdx.y * blockDim.y + threadIdx.y;
+         y < array.Height(); y += gridDim.y * blockDim.y) {
+      for (unsigned int x = blockIdx.x * blockDim.x + threadIdx.x;
+           x < array.Width(); x += gridDim.x * blockDim.x) {
+        array.set(x, y, z, op(x, y, z));
+      }
+    }
+  }
+}
 
-  if (x < array.Width() && y < array.Height() && z < array.Depth()) {
-    array.set(x, y, z, op(x, y, z));
+//
+// element-wise operations with a scalar, e.g., array += value
+// op: __host__ __device__ function mapping (array(x,y,z), value) -> Scalar
+//
+template <typename CudaArrayClass, typename T, class BinaryFunction>
+__global__ void CudaArray3DBaseApplyScalarOp(CudaArrayClass array,
+                                             const T value,
+                                             BinaryFunction op) {
+  for (unsigned int z = blockIdx.z * blockDim.z + threadIdx.z;
+       z < array.Depth(); z += gridDim.z * blockDim.z) {
+    for (unsigned int y = blockIdx.y * blockDim.y + threadIdx.y;
+         y < array.Height(); y += gridDim.y * blockDim.y) {
+      for (unsigned int x = blockIdx.x * blockDim.x + threadIdx.x;
+           x < array.Width(); x += gridDim.x * blockDim.x) {
+        array.set(x, y, z, op(array.get(x, y, z), value));
+      }
+    }
   }
 }
 
@@ -96,12 +159,15 @@ __global__ void CudaArray3DBaseApplyOp(CudaArrayClass array, Function op) {
 //
 template <typename CudaArrayClass, typename T>
 __global__ void CudaArray3DBaseFill(CudaArrayClass array, const T value) {
-  const unsigned int x = blockIdx.x * blockDim.x + threadIdx.x;
-  const unsigned int y = blockIdx.y * blockDim.y + threadIdx.y;
-  const unsigned int z = blockIdx.z * blockDim.z + threadIdx.z;
-
-  if (x < array.Width() && y < array.Height() && z < array.Depth()) {
-    array.set(x, y, z, value);
+  for (unsigned int z = blockIdx.z * blockDim.z + threadIdx.z;
+       z < array.Depth(); z += gridDim.z * blockDim.z) {
+    for (unsigned int y = blockIdx.y * blockDim.y + threadIdx.y;
+         y < array.Height(); y += gridDim.y * blockDim.y) {
+      for (unsigned int x = blockIdx.x * blockDim.x + threadIdx.x;
+           x < array.Width(); x += gridDim.x * blockDim.x) {
+        array.set(x, y, z, value);
+      }
+    }
   }
 }
 
@@ -149,6 +215,127 @@ __global__ void CudaArray3DBaseFillRandom(CudaRandomStateArrayClass rand_state,
   }
 }
 
+//------------------------------------------------------------------------------
+
+//
+// fill with counter-based random values; each thread fills four consecutive
+// elements of a row from one Philox4x32 block (see philox.h)
+//
+template <typename CudaArrayClass, typename RandomFunction>
+__global__ void CudaArray3DBaseFillRandomPhilox(
+    CudaArrayClass array, const PhiloxKey key,
+    const unsigned long long counter, RandomFunction func) {
+  const unsigned int x4 = blockIdx.x * blockDim.x + threadIdx.x;
+  const unsigned int x = 4 * x4;
+  const unsigned int y = blockIdx.y * blockDim.y + threadIdx.y;
+  const unsigned int z = blockIdx.z * blockDim.z + threadIdx.z;
+
+  if (x < array.Width() && y < array.Height() && z < array.Depth()) {
+    const unsigned int row = z * array.Height() + y;
+    const PhiloxCounter bits =
+        Philox4x32_10(internal::MakePhiloxCounter(x4, row, counter), key);
+    array.set(x, y, z, func(bits.x));
+    if (x + 1 < array.Width()) array.set(x + 1, y, z, func(bits.y));
+    if (x + 2 < array.Width()) array.set(x + 2, y, z, func(bits.z));
+    if (x + 3 < array.Width()) array.set(x + 3, y, z, func(bits.w));
+  }
+}
+
+//------------------------------------------------------------------------------
+
+//
+// Axis permutations (see AxisPermutation): AxisX, AxisY, and AxisZ are the axes
+// of src (0 = x, 1 = y, 2 = z) that become the x, y, and z axes of dst. The
+// flips (see internal::kFlipX) then reverse axes of dst, which together with
+// the permutations gives the flips and rotations of the array.
+//
+// If the x axis stays in place, rows of src map to rows of dst, and the copy
+// needs no staging.
+//
+template <int AxisY, int AxisZ, typename SrcCls, typename DstCls>
+__global__ void CudaArray3DBasePermuteRows(const SrcCls src, DstCls dst,
+                                           const int flips) {
+  typedef typename SrcCls::IndexType IndexType;
+  typedef typename SrcCls::SizeType SizeType;
+
+  const SizeType sizes[3] = {src.Width(), src.Height(), src.Depth()};
+  for (IndexType z = blockIdx.z * blockDim.z + threadIdx.z; z < sizes[2];
+       z += gridDim.z * blockDim.z) {
+    for (IndexType y = blockIdx.y * blockDim.y + threadIdx.y; y < sizes[1];
+         y += gridDim.y * blockDim.y) {
+      const IndexType coords[3] = {0, y, z};
+      const IndexType dst_y = internal::FlipIndex(
+          coords[AxisY], sizes[AxisY], flips & internal::kFlipY);
+      const IndexType dst_z = internal::FlipIndex(
+          coords[AxisZ], sizes[AxisZ], flips & internal::kFlipZ);
+      for (IndexType x = blockIdx.x * blockDim.x + threadIdx.x; x < sizes[0];
+           x += gridDim.x * blockDim.x) {
+        dst.set(internal::FlipIndex(x, sizes[0], flips & internal::kFlipX),
+                dst_y, dst_z, src.get(x, y, z));
+      }
+    }
+  }
+}
+
+//
+// Otherwise, each block transposes kTileSize x kTileSize tiles spanning the x
+// axis of src and its AxisX axis through shared memory, so that warps read
+// along the rows of src and write along the rows of dst. The tile rows are
+// padded to avoid bank conflicts on the transposed reads. Blocks step through
+// the remaining axis of src in a grid-stride loop.
+//
+template <int AxisX, int AxisY, int AxisZ, typename SrcCls, typename DstCls>
+__global__ void CudaArray3DBasePermuteTiles(const SrcCls src, DstCls dst,
+                                            const int flips) {
+  typedef typename SrcCls::IndexType IndexType;
+  typedef typename SrcCls::SizeType SizeType;
+  static const int kOtherAxis = 3 - AxisX;  // since AxisX != 0
+
+  __shared__ typename SrcCls::Scalar
+      tile[SrcCls::kTileSize][SrcCls::kTileSize + 1];
+
+  const SizeType sizes[3] = {src.Width(), src.Height(), src.Depth()};
+  const IndexType x0 = blockIdx.x * SrcCls::kTileSize;
+  const IndexType v0 = blockIdx.y * SrcCls::kTileSize;
+
+  IndexType coords[3];
+  for (coords[kOtherAxis] = blockIdx.z; coords[kOtherAxis] < sizes[kOtherAxis];
+       coords[kOtherAxis] += gridDim.z) {
+    coords[0] = x0 + threadIdx.x;
+    if (coords[0] < sizes[0]) {
+      for (IndexType j = threadIdx.y;
+           j < SrcCls::kTileSize && v0 + j < sizes[AxisX];
+           j += SrcCls::kBlockRows) {
+        coords[AxisX] = v0 + j;
+        tile[j][threadIdx.x] = src.get(coords[0], coords[1], coords[2]);
+      }
+    }
+
+    __syncthreads();
+
+    // consecutive threads now write consecutive elements along AxisX of src,
+    // i.e., along x in dst
+    coords[AxisX] = v0 + threadIdx.x;
+    if (coords[AxisX] < sizes[AxisX]) {
+      for (IndexType j = threadIdx.y;
+           j < SrcCls::kTileSize && x0 + j < sizes[0];
+           j += SrcCls::kBlockRows) {
+        coords[0] = x0 + j;
+        dst.set(internal::FlipIndex(coords[AxisX], sizes[AxisX],
+                                    flips & internal::kFlipX),
+                internal::FlipIndex(coords[AxisY], sizes[AxisY],
+                                    flips & internal::kFlipY),
+                internal::FlipIndex(coords[AxisZ], sizes[AxisZ],
+                                    flips & internal::kFlipZ),
+                tile[threadIdx.x][j]);
+      }
+    }
+
+    // the tile is overwritten in the next iteration
+    __syncthreads();
+  }
+}
+
 }  // namespace kernel
 
 //------------------------------------------------------------------------------
@@ -167,7 +354,7 @@ struct CudaArrayTraits;  // forward declaration
  * @class CudaArray3DBase
  * @brief Base class for all 3D CudaArray-type objects.
  *
- * This class includes implementations for Copy, etc.
+ * This class includes implementations for Copy, Permute, Flip, etc.
  * All derived classes need to define the following methods:
  *
  * -  copy constructor on host *and* device; use `#ifndef __CUDA_ARCH__` to
@@ -190,6 +377,8 @@ struct CudaArrayTraits;  // forward declaration
  *
  * -  EmptyCopy(device): to create a new array of the same size on the given GPU
  *    - `Derived EmptyCopy(int device = -1) const;`
+ * -  EmptyPermutedCopy(): create a new array with reordered width/height/depth
+ *    - `Derived EmptyPermutedCopy(AxisPermutation permutation) const;`
  * -  set(): write to array position (optional for readonly subclasses)
  *    - `__device__ inline void set(unsigned int x, unsigned int y,
  *                                  unsigned int z, Scalar value);`
@@ -201,7 +390,15 @@ struct CudaArrayTraits;  // forward declaration
  *     struct CudaArrayTraits<Derived<T>> {
  *       typedef T Scalar;
  *       typedef bool Mutable;  // defined for read-write derived classes
+ *       typedef std::true_type IsHost;  // optional; see CudaArray2DBase
+ *       typedef DerivedDeviceView<T> DeviceView;  // optional; see below
  *     };
+ *
+ * As for CudaArray2DBase, kernels are launched with the array's DeviceView()
+ * for derived classes that declare `DeviceView` in their traits.
+ *
+ * As for CudaArray2DBase, the operations of derived classes that declare
+ * `IsHost` (e.g., CudaHostArray3D) run on a pool of CPU threads.
  */
 template <typename Derived>
 class CudaArray3DBase {
@@ -218,6 +415,19 @@ class CudaArray3DBase {
   /// index type of the array
   typedef LIBCUA_DEFAULT_INDEX_TYPE IndexType;
 
+  /// element position used by GetValues() and SetValues()
+  typedef Coordinate3D<IndexType> Coordinate;
+
+  /// std::true_type if the array operations run on the host, rather than on
+  /// the GPU
+  typedef typename internal::IsHostArray<Derived>::type IsHost;
+
+  /// type that represents the array in the parameter lists of kernels
+  typedef typename internal::DeviceViewOf<Derived>::type DeviceViewType;
+
+  /// type returned by Sum(); wider than Scalar for integral types
+  typedef typename internal::SumTraits<Scalar>::type SumType;
+
   /// default block dimensions for general operations
   static const dim3 kBlockDim;
 
@@ -255,6 +465,7 @@ class CudaArray3DBase {
         depth_(other.depth_),
         block_dim_(other.block_dim_),
         grid_dim_(other.grid_dim_),
+        launch_mode_(other.launch_mode_),
         device_(other.device_),
         stream_(other.stream_) {}
 
@@ -293,7 +504,86 @@ class CudaArray3DBase {
     Derived result = derived().EmptyCopy(device);
     // The specialized CopyTo implementation in the subclass should handle the
     // case where the output is on a different device.
-    Copy(result);
+    CopyTo(&result);
+    return result;
+  }
+
+  /**
+   * @param permutation new order of the axes; see AxisPermutation
+   * @return a new copy of the current array with reordered axes
+   */
+  ENABLE_IF_MUTABLE
+  inline Derived Permute(AxisPermutation permutation) const {
+    Derived result = derived().EmptyPermutedCopy(permutation);
+    Permute(permutation, &result);
+    return result;
+  }
+
+  /**
+   * @return a new copy of the current array, flipped along the x axis.
+   */
+  ENABLE_IF_MUTABLE
+  inline Derived FlipX() const {
+    Derived result = derived().EmptyCopy(device_);
+    FlipX(&result);
+    return result;
+  }
+
+  /**
+   * @return a new copy of the current array, flipped along the y axis.
+   */
+  ENABLE_IF_MUTABLE
+  inline Derived FlipY() const {
+    Derived result = derived().EmptyCopy(device_);
+    FlipY(&result);
+    return result;
+  }
+
+  /**
+   * @return a new copy of the current array, flipped along the z axis.
+   */
+  ENABLE_IF_MUTABLE
+  inline Derived FlipZ() const {
+    Derived result = derived().EmptyCopy(device_);
+    FlipZ(&result);
+    return result;
+  }
+
+  /**
+   * @param axis axis of rotation
+   * @return a new copy of the current array, rotated 180 degrees about the
+   *   given axis.
+   */
+  ENABLE_IF_MUTABLE
+  inline Derived Rot180(Axis axis) const {
+    Derived result = derived().EmptyCopy(device_);
+    Rot180(axis, &result);
+    return result;
+  }
+
+  /**
+   * @param axis axis of rotation
+   * @return a new copy of the current array, rotated 90 degrees
+   *   counterclockwise about the given axis; see Rot90_CW(Axis, Derived *).
+   */
+  ENABLE_IF_MUTABLE
+  inline Derived Rot90_CCW(Axis axis) const {
+    Derived result =
+        derived().EmptyPermutedCopy(internal::Rot90Permutation(axis));
+    Rot90_CCW(axis, &result);
+    return result;
+  }
+
+  /**
+   * @param axis axis of rotation
+   * @return a new copy of the current array, rotated 90 degrees clockwise
+   *   about the given axis; see Rot90_CW(Axis, Derived *).
+   */
+  ENABLE_IF_MUTABLE
+  inline Derived Rot90_CW(Axis axis) const {
+    Derived result =
+        derived().EmptyPermutedCopy(internal::Rot90Permutation(axis));
+    Rot90_CW(axis, &result);
     return result;
   }
 
@@ -305,18 +595,79 @@ class CudaArray3DBase {
    * @ param other output array
    */
   template <typename OtherDerived,
-            typename CudaArrayTraits<OtherDerived>::Mutable is_mutable>
+            typename CudaArrayTraits<OtherDerived>::Mutable is_mutable = true>
   void CopyTo(OtherDerived *other) const;
 
+  /**
+   * Reorder the axes of the current array and store in another array, e.g.,
+   * `other(z, x, y) = (*this)(x, y, z)` for AxisPermutation::kZXY.
+   * @param permutation new order of the axes
+   * @param other output array with correspondingly reordered dimensions, e.g.,
+   *   from EmptyPermutedCopy()
+   */
+  ENABLE_IF_MUTABLE
+  void Permute(AxisPermutation permutation, Derived *other) const;
+
+  /**
+   * Flip the current array along the x axis and store in another array.
+   * @param other output array
+   */
+  ENABLE_IF_MUTABLE
+  void FlipX(Derived *other) const;
+
+  /**
+   * Flip the current array along the y axis and store in another array.
+   * @param other output array
+   */
+  ENABLE_IF_MUTABLE
+  void FlipY(Derived *other) const;
+
+  /**
+   * Flip the current array along the z axis and store in another array.
+   * @param other output array
+   */
+  ENABLE_IF_MUTABLE
+  void FlipZ(Derived *other) const;
+
+  /**
+   * Rotate the current array 180 degrees about the given axis and store in
+   * another array.
+   * @param axis axis of rotation
+   * @param other output array
+   */
+  ENABLE_IF_MUTABLE
+  void Rot180(Axis axis, Derived *other) const;
+
+  /**
+   * Rotate the current array 90 degrees counterclockwise about the given axis
+   * and store in another array; this undoes Rot90_CW(axis, other).
+   * @param axis axis of rotation
+   * @param other output array with the other two dimensions swapped
+   */
+  ENABLE_IF_MUTABLE
+  void Rot90_CCW(Axis axis, Derived *other) const;
+
+  /**
+   * Rotate the current array 90 degrees clockwise about the given axis and
+   * store in another array. Each rotation turns the plane of the other two
+   * axes in cyclic order (y-z, z-x, or x-y) as CudaArray2DBase::Rot90_CW()
+   * turns an image; e.g., about the z axis, element (x, y, z) moves to
+   * (height - 1 - y, x, z) in every z slice.
+   * @param axis axis of rotation
+   * @param other output array with the other two dimensions swapped
+   */
+  ENABLE_IF_MUTABLE
+  void Rot90_CW(Axis axis, Derived *other) const;
+
   /**
    * Fill the array with a constant value.
    * @param value every element in the array is set to value
    */
   ENABLE_IF_MUTABLE
   inline void Fill(const Scalar value) {
-    internal::SetDevice(device_);
-    kernel::CudaArray3DBaseFill<<<grid_dim_, block_dim_, 0, stream_>>>(
-        derived(), value);
+    LIBCUA_INSTRUMENT("CudaArray3DBase::Fill", Size() * sizeof(Scalar), device_,
+                      stream_, IsHost::value);
+    Fill_(value, IsHost());
   }
 
   /**
@@ -327,22 +678,55 @@ class CudaArray3DBase {
    */
   template <typename CurandStateArrayType, typename RandomFunction,
             class C = CudaArrayTraits<Derived>,
-            typename C::Mutable is_mutable = true>
+            typename C::Mutable is_mutable = true,
+            typename std::enable_if<
+                !std::is_arithmetic<CurandStateArrayType>::value, bool>::type
+                is_state_array = true>
   void FillRandom(CurandStateArrayType &rand_state, RandomFunction func);
 
+  /**
+   * Fill the array with counter-based (Philox4x32-10) random values, without
+   * any generator state; see philox.h. The values depend only on seed,
+   * counter, and the element position, not on the block dimensions, and host
+   * arrays produce the same values bit for bit. Use a different counter, e.g.,
+   * an incrementing call index, for each independent fill with the same seed.
+   * @param seed 64-bit generator key
+   * @param counter 64-bit position in the random stream
+   * @param func `__host__ __device__` function with signature
+   *   `T func(unsigned int)` mapping 32 random bits to a value, such as
+   *   UniformRandom (the default), UniformRandomDouble, or RandomBits
+   */
+  template <typename RandomFunction = UniformRandom,
+            class C = CudaArrayTraits<Derived>,
+            typename C::Mutable is_mutable = true>
+  inline void FillRandom(unsigned long long seed, unsigned long long counter,
+                         RandomFunction func = RandomFunction()) {
+    LIBCUA_INSTRUMENT("CudaArray3DBase::FillRandom", Size() * sizeof(Scalar),
+                      device_, stream_, IsHost::value);
+    FillRandom_(internal::MakePhiloxKey(seed), counter, func, IsHost());
+  }
+
   //----------------------------------------------------------------------------
   // getters/setters
 
   __host__ __device__ inline SizeType Width() const { return width_; }
   __host__ __device__ inline SizeType Height() const { return height_; }
   __host__ __device__ inline SizeType Depth() const { return depth_; }
-  __host__ __device__ inline SizeType Size() const {
-    return width_ * height_ * depth_;
+  /**
+   * @return total number of elements, computed in 64 bits (see types.h)
+   */
+  __host__ __device__ inline size_t Size() const {
+    return static_cast<size_t>(width_) * height_ * depth_;
   }
 
   __host__ __device__ inline dim3 BlockDim() const { return block_dim_; }
   __host__ __device__ inline dim3 GridDim() const { return grid_dim_; }
 
+  /**
+   * Set the block size for the kernels of this array. GridDim() is then the
+   * grid for one thread per element; the element-wise kernels may launch fewer
+   * blocks (see SetLaunchMode()).
+   */
   inline void SetBlockDim(const dim3 block_dim) {
     block_dim_ = block_dim;
     grid_dim_ = dim3((width_ + block_dim.x - 1) / block_dim_.x,
@@ -350,11 +734,113 @@ class CudaArray3DBase {
                      (depth_ + block_dim.z - 1) / block_dim_.z);
   }
 
+  inline LaunchMode GetLaunchMode() const { return launch_mode_; }
+
+  /**
+   * Set how the element-wise kernels (Fill, ApplyOp, CopyTo, and the scalar
+   * operators) size their grids; see LaunchMode. The default is
+   * LaunchMode::kOccupancy.
+   */
+  inline void SetLaunchMode(const LaunchMode launch_mode) {
+    launch_mode_ = launch_mode;
+  }
+
   inline int Device() const { return device_; }
 
   inline cudaStream_t Stream() const { return stream_; }
   inline void SetStream(const cudaStream_t stream) { stream_ = stream; }
 
+  /**
+   * Host-level function for setting the value of a single array element.
+   * @param x first coordinate, i.e., the column index in a row-major array
+   * @param y second coordinate, i.e., the row index in a row-major array
+   * @param z third coordinate, i.e., the slice index in a row-major array
+   * @param value the new value to assign to array(x, y, z)
+   */
+  ENABLE_IF_MUTABLE
+  inline void SetValue(IndexType x, IndexType y, IndexType z,
+                       const Scalar value) {
+    const Coordinate coordinate = {x, y, z};
+    SetValues(&coordinate, &value, 1);
+  }
+
+  /**
+   * Host-level function for getting the value of a single array element.
+   * @param x first coordinate, i.e., the column index in a row-major array
+   * @param y second coordinate, i.e., the row index in a row-major array
+   * @param z third coordinate, i.e., the slice index in a row-major array
+   * @return the value at array(x, y, z)
+   */
+  inline Scalar GetValue(IndexType x, IndexType y, IndexType z) const {
+    const Coordinate coordinate = {x, y, z};
+    Scalar value;
+    GetValues(&coordinate, 1, &value);
+    return value;
+  }
+
+  /**
+   * Host-level function for setting many array elements at once. All values
+   * are uploaded in one transfer and written by one kernel. If a coordinate
+   * appears more than once, which of its values is written is unspecified.
+   * @param coordinates host array of num_values element positions
+   * @param values host array of num_values new values
+   * @param num_values number of elements to set
+   */
+  ENABLE_IF_MUTABLE
+  inline void SetValues(const Coordinate *coordinates, const Scalar *values,
+                        size_t num_values) {
+    SetValuesAsync(coordinates, values, num_values).Synchronize();
+  }
+
+  /**
+   * Asynchronous version of SetValues(), queued on the array's stream. The
+   * coordinates and values must stay valid until the returned event has
+   * completed.
+   * @param coordinates host array of num_values element positions
+   * @param values host array of num_values new values
+   * @param num_values number of elements to set
+   * @return event marking the completion of the update
+   */
+  ENABLE_IF_MUTABLE
+  inline CudaEvent SetValuesAsync(const Coordinate *coordinates,
+                                  const Scalar *values, size_t num_values) {
+    internal::CheckCoordinates(derived(), coordinates, num_values);
+    LIBCUA_INSTRUMENT("CudaArray3DBase::SetValues",
+                      num_values * (sizeof(Coordinate) + sizeof(Scalar)),
+                      device_, stream_, IsHost::value);
+    return SetValues_(coordinates, values, num_values, IsHost());
+  }
+
+  /**
+   * Host-level function for getting many array elements at once. All values
+   * are read by one kernel and downloaded in one transfer.
+   * @param coordinates host array of num_values element positions
+   * @param num_values number of elements to get
+   * @param values output host array of num_values values
+   */
+  inline void GetValues(const Coordinate *coordinates, size_t num_values,
+                        Scalar *values) const {
+    GetValuesAsync(coordinates, num_values, values).Synchronize();
+  }
+
+  /**
+   * Asynchronous version of GetValues(), queued on the array's stream. The
+   * coordinates and output values must stay valid until the returned event
+   * has completed.
+   * @param coordinates host array of num_values element positions
+   * @param num_values number of elements to get
+   * @param values output host array of num_values values
+   * @return event marking the arrival of the values on the host
+   */
+  inline CudaEvent GetValuesAsync(const Coordinate *coordinates,
+                                  size_t num_values, Scalar *values) const {
+    internal::CheckCoordinates(derived(), coordinates, num_values);
+    LIBCUA_INSTRUMENT("CudaArray3DBase::GetValues",
+                      num_values * (sizeof(Coordinate) + sizeof(Scalar)),
+                      device_, stream_, IsHost::value);
+    return GetValues_(coordinates, num_values, values, IsHost());
+  }
+
   //----------------------------------------------------------------------------
   // general array operations
 
@@ -372,14 +858,17 @@ class CudaArray3DBase {
    *
    * @param op `__device__` function mapping `(x,y,z) -> CudaArrayClass::Scalar`
    * @param shared_mem_bytes if `op()` uses shared memory, the size of the
-   *   shared memory space required
+   *   shared memory space required; in this case, the kernel is launched with
+   *   one thread per element regardless of the launch mode, so each thread
+   *   calls `op()` at most once and can own the shared memory slot of its
+   *   threadIdx
    */
   template <class Function, class C = CudaArrayTraits<Derived>,
             typename C::Mutable is_mutable = true>
   void ApplyOp(Function op, const unsigned int shared_mem_bytes = 0) {
-    internal::SetDevice(device_);
-    kernel::CudaArray3DBaseApplyOp<<<grid_dim_, block_dim_, shared_mem_bytes,
-                                     stream_>>>(derived(), op);
+    LIBCUA_INSTRUMENT("CudaArray3DBase::ApplyOp", Size() * sizeof(Scalar),
+                      device_, stream_, IsHost::value);
+    ApplyOp_(op, shared_mem_bytes, IsHost());
   }
 
   /**
@@ -388,12 +877,10 @@ class CudaArray3DBase {
    */
   ENABLE_IF_MUTABLE
   inline void operator+=(const Scalar value) {
-    Derived &tmp = derived();
-    internal::SetDevice(device_);
-    kernel::CudaArray3DBaseApplyOp<<<grid_dim_, block_dim_, 0, stream_>>>(
-        tmp, [tmp, value] __device__(IndexType x, IndexType y, IndexType z) {
-          return tmp.get(x, y, z) + value;
-        });
+    LIBCUA_INSTRUMENT("CudaArray3DBase::ApplyScalarOp",
+                      2 * Size() * sizeof(Scalar), device_, stream_,
+                      IsHost::value);
+    ApplyScalarOp_(value, Plus(), IsHost());
   }
 
   /**
@@ -402,12 +889,10 @@ class CudaArray3DBase {
    */
   ENABLE_IF_MUTABLE
   inline void operator-=(const Scalar value) {
-    Derived &tmp = derived();
-    internal::SetDevice(device_);
-    kernel::CudaArray3DBaseApplyOp<<<grid_dim_, block_dim_, 0, stream_>>>(
-        tmp, [tmp, value] __device__(IndexType x, IndexType y, IndexType z) {
-          return tmp.get(x, y, z) - value;
-        });
+    LIBCUA_INSTRUMENT("CudaArray3DBase::ApplyScalarOp",
+                      2 * Size() * sizeof(Scalar), device_, stream_,
+                      IsHost::value);
+    ApplyScalarOp_(value, Minus(), IsHost());
   }
 
   /**
@@ -416,12 +901,10 @@ class CudaArray3DBase {
    */
   ENABLE_IF_MUTABLE
   inline void operator*=(const Scalar value) {
-    Derived &tmp = derived();
-    internal::SetDevice(device_);
-    kernel::CudaArray3DBaseApplyOp<<<grid_dim_, block_dim_, 0, stream_>>>(
-        tmp, [tmp, value] __device__(IndexType x, IndexType y, IndexType z) {
-          return tmp.get(x, y, z) * value;
-        });
+    LIBCUA_INSTRUMENT("CudaArray3DBase::ApplyScalarOp",
+                      2 * Size() * sizeof(Scalar), device_, stream_,
+                      IsHost::value);
+    ApplyScalarOp_(value, Multiplies(), IsHost());
   }
 
   /**
@@ -430,12 +913,346 @@ class CudaArray3DBase {
    */
   ENABLE_IF_MUTABLE
   inline void operator/=(const Scalar value) {
-    Derived &tmp = derived();
-    internal::SetDevice(device_);
-    kernel::CudaArray3DBaseApplyOp<<<grid_dim_, block_dim_, 0, stream_>>>(
-        tmp, [tmp, value] __device__(IndexType x, IndexType y, IndexType z) {
-          return tmp.get(x, y, z) / value;
-        });
+    LIBCUA_INSTRUMENT("CudaArray3DBase::ApplyScalarOp",
+                      2 * Size() * sizeof(Scalar), device_, stream_,
+                      IsHost::value);
+    ApplyScalarOp_(value, Divides(), IsHost());
+  }
+
+  /**
+   * Evaluate an element-wise array expression, e.g., `a * 0.5f + b`, and store
+   * the result in the current array. The whole expression is computed in a
+   * single pass over the data; see ArrayExpression.
+   * @param expression expression over arrays of the same size as this array
+   */
+  template <typename Expression, class C = CudaArrayTraits<Derived>,
+            typename C::Mutable is_mutable = true>
+  inline void Assign(const ArrayExpression<Expression> &expression) {
+    expression.derived().CheckCompatible3D(derived());
+    LIBCUA_INSTRUMENT("CudaArray3DBase::Assign", Size() * sizeof(Scalar),
+                      device_, stream_, IsHost::value);
+    ApplyOp_(expression.derived(), 0, IsHost());
+  }
+
+  /**
+   * Element-wise addition.
+   * @param other array or array expression to add to this array
+   */
+  template <typename Other, class C = CudaArrayTraits<Derived>,
+            typename C::Mutable is_mutable = true,
+            typename std::enable_if<internal::IsArrayOperand<Other>::value,
+                                    int>::type = 0>
+  inline void operator+=(const Other &other) {
+    Assign(derived() + other);
+  }
+
+  /**
+   * Element-wise subtraction.
+   * @param other array or array expression to subtract from this array
+   */
+  template <typename Other, class C = CudaArrayTraits<Derived>,
+            typename C::Mutable is_mutable = true,
+            typename std::enable_if<internal::IsArrayOperand<Other>::value,
+                                    int>::type = 0>
+  inline void operator-=(const Other &other) {
+    Assign(derived() - other);
+  }
+
+  /**
+   * Element-wise multiplication.
+   * @param other array or array expression by which to multiply this array
+   */
+  template <typename Other, class C = CudaArrayTraits<Derived>,
+            typename C::Mutable is_mutable = true,
+            typename std::enable_if<internal::IsArrayOperand<Other>::value,
+                                    int>::type = 0>
+  inline void operator*=(const Other &other) {
+    Assign(derived() * other);
+  }
+
+  /**
+   * Element-wise division.
+   * @param other array or array expression by which to divide this array
+   */
+  template <typename Other, class C = CudaArrayTraits<Derived>,
+            typename C::Mutable is_mutable = true,
+            typename std::enable_if<internal::IsArrayOperand<Other>::value,
+                                    int>::type = 0>
+  inline void operator/=(const Other &other) {
+    Assign(derived() / other);
+  }
+
+  /**
+   * Compute `this(x, y, z) = op(inputs(x, y, z)...)` in a single pass. Unlike
+   * array expressions, the inputs can be any mix of array kinds and scalar
+   * types, as long as they have the same size and device as this array:
+   *
+   *      // CudaArray3D<float> a; CudaTexture3D<float2> b;
+   *      // CudaSurface3D<uchar4> c
+   *      out.Zip([] __device__(float a, float2 b, uchar4 c) {
+   *        return a * b.x + c.w;  // stored in out(x, y, z)
+   *      }, a, b, c);
+   *
+   * Sizes and devices are checked once, before the launch. See cua::Zip() for
+   * the form with several outputs.
+   * @param op `__device__` function mapping `(inputs...) -> Scalar`
+   * @param inputs the input arrays
+   */
+  template <class Function, class C = CudaArrayTraits<Derived>,
+            typename C::Mutable is_mutable = true, typename... Inputs>
+  inline void Zip(Function op, const Inputs &... inputs) {
+    LIBCUA_INSTRUMENT(
+        "CudaArray3DBase::Zip",
+        Size() * (internal::ZipElementBytes<Derived, Inputs...>::value),
+        device_, stream_, IsHost::value);
+    internal::ZipInto(op, derived(), inputs...);
+  }
+
+  //----------------------------------------------------------------------------
+  // reductions
+  //
+  // Each reduction has a blocking form and an asynchronous form. The latter
+  // queues the reduction on the array's stream and returns a CudaAsyncValue
+  // without waiting for the result. Reductions work for every array type,
+  // including textures and surfaces; host arrays compute the result on the
+  // CPU thread pool.
+
+  /**
+   * Reduce the array with a user-defined binary operator, e.g., cua::Maximum.
+   * @param op associative and commutative `__host__ __device__` function
+   *   object mapping `(Scalar, Scalar) -> Scalar`
+   * @param identity identity element of op, e.g., zero for addition
+   * @return the reduced value
+   */
+  template <class BinaryFunction>
+  inline CudaAsyncValue<Scalar> ReduceAsync(BinaryFunction op,
+                                            const Scalar identity) const {
+    return Reduce_<Scalar>(internal::Identity(), op, internal::Identity(),
+                           identity, IsHost());
+  }
+
+  template <class BinaryFunction>
+  inline Scalar Reduce(BinaryFunction op, const Scalar identity) const {
+    return ReduceAsync(op, identity).Get();
+  }
+
+  /**
+   * @return the sum of all elements, accumulated in 64-bit integers for
+   *   integral scalar types
+   */
+  inline CudaAsyncValue<SumType> SumAsync() const {
+    return Reduce_<SumType>(internal::ConvertTo<SumType>(), Plus(),
+                            internal::Identity(), SumType(), IsHost());
+  }
+
+  inline SumType Sum() const { return SumAsync().Get(); }
+
+  /**
+   * @return the smallest element
+   */
+  inline CudaAsyncValue<Scalar> MinAsync() const {
+    return ReduceAsync(Minimum(), internal::HighestValue<Scalar>());
+  }
+
+  inline Scalar Min() const { return MinAsync().Get(); }
+
+  /**
+   * @return the largest element
+   */
+  inline CudaAsyncValue<Scalar> MaxAsync() const {
+    return ReduceAsync(Maximum(), internal::LowestValue<Scalar>());
+  }
+
+  inline Scalar Max() const { return MaxAsync().Get(); }
+
+  /**
+   * @return the smallest and largest elements, computed in a single pass
+   */
+  inline CudaAsyncValue<MinMaxValue<Scalar>> MinMaxAsync() const {
+    const MinMaxValue<Scalar> identity = {internal::HighestValue<Scalar>(),
+                                          internal::LowestValue<Scalar>()};
+    return Reduce_<MinMaxValue<Scalar>>(internal::MakeMinMax(),
+                                        internal::CombineMinMax(),
+                                        internal::Identity(), identity,
+                                        IsHost());
+  }
+
+  inline MinMaxValue<Scalar> MinMax() const { return MinMaxAsync().Get(); }
+
+  /**
+   * @return the mean of all elements
+   */
+  inline CudaAsyncValue<double> MeanAsync() const {
+    const internal::DivideBy finalize = {static_cast<double>(Size())};
+    return Reduce_<double>(internal::ConvertTo<SumType>(), Plus(), finalize,
+                           SumType(), IsHost());
+  }
+
+  inline double Mean() const { return MeanAsync().Get(); }
+
+  /**
+   * @return the L2 norm of the array, i.e., the square root of the sum of
+   *   squared elements
+   */
+  inline CudaAsyncValue<double> NormAsync() const {
+    return Reduce_<double>(internal::SquareAs<SumType>(), Plus(),
+                           internal::SquareRoot(), SumType(), IsHost());
+  }
+
+  inline double Norm() const { return NormAsync().Get(); }
+
+  //----------------------------------------------------------------------------
+  // histograms
+
+  /**
+   * Count the array values in equal-width bins; see HistogramBins. Vector
+   * types, e.g., uchar4, get one histogram per channel. Each GPU block counts
+   * in shared memory and merges its bins into the result with atomics; host
+   * arrays count on the CPU thread pool. The call waits for the result.
+   * @param bins number and value range of the bins
+   * @return the counts, one channel after the other: element
+   *   `c * bins.num_bins + b` is the number of values of channel c in bin b
+   */
+  inline std::vector<unsigned long long> Histogram(
+      const HistogramBins &bins) const {
+    return Histogram_(bins, internal::HistogramNoMask(), IsHost());
+  }
+
+  /**
+   * Histogram of the elements selected by a mask, i.e., whose corresponding
+   * mask element is nonzero.
+   * @param bins number and value range of the bins
+   * @param mask array of the same size with an arithmetic scalar type, e.g.,
+   *   a uchar or bool array, on the same device
+   * @return the counts, in the same layout as Histogram(bins)
+   */
+  template <typename MaskDerived>
+  inline std::vector<unsigned long long> Histogram(
+      const HistogramBins &bins, const MaskDerived &mask) const {
+    static_assert(internal::IsHostArray<MaskDerived>::value == IsHost::value,
+                  "Masks must live in the same memory space as the array.");
+    internal::CheckHistogramMask3D(derived(), mask);
+    return Histogram_(bins, mask, IsHost());
+  }
+
+  //----------------------------------------------------------------------------
+  // filtering
+
+  /**
+   * Separable convolution: convolve the array with one set of taps per axis,
+   * along x, y, and z, in that order, and store the result in another array;
+   * see CudaArray2DBase::SeparableConvolve().
+   * @param taps_x taps along x
+   * @param taps_y taps along y
+   * @param taps_z taps along z
+   * @param other output array of the same size, with the same number of
+   *   channels; its scalar type may differ, e.g., a float array for the
+   *   derivatives of a uchar array. This may be the current array.
+   * @param border handling of elements outside of the array
+   */
+  template <unsigned int RadiusX, unsigned int RadiusY, unsigned int RadiusZ,
+            typename OtherDerived,
+            typename CudaArrayTraits<OtherDerived>::Mutable is_mutable = true>
+  void SeparableConvolve(
+      const ConvolutionTaps<RadiusX> &taps_x,
+      const ConvolutionTaps<RadiusY> &taps_y,
+      const ConvolutionTaps<RadiusZ> &taps_z, OtherDerived *other,
+      const ConvolutionBorder border = ConvolutionBorder::kFromArray) const;
+
+  /**
+   * Separable convolution with the same taps along every axis; see above.
+   */
+  template <unsigned int Radius, typename OtherDerived,
+            typename CudaArrayTraits<OtherDerived>::Mutable is_mutable = true>
+  inline void SeparableConvolve(
+      const ConvolutionTaps<Radius> &taps, OtherDerived *other,
+      const ConvolutionBorder border = ConvolutionBorder::kFromArray) const {
+    SeparableConvolve(taps, taps, taps, other, border);
+  }
+
+  /**
+   * Apply a stencil operation; see CudaArray2DBase::ApplyStencil().
+   * @param op `__device__` function mapping
+   *   `(const StencilAccessor3D<Scalar, Radius> &, x, y, z)
+   *   -> OtherDerived::Scalar`
+   * @param other output array of the same size; this must not share memory
+   *   with the current array, which is checked for shallow copies and views in
+   *   linear memory and for surfaces on the same CUDA array
+   * @param border handling of elements outside of the array; see
+   *   ConvolutionBorder
+   */
+  template <unsigned int Radius, class Function, typename OtherDerived,
+            typename CudaArrayTraits<OtherDerived>::Mutable is_mutable = true>
+  void ApplyStencil(
+      Function op, OtherDerived *other,
+      const ConvolutionBorder border = ConvolutionBorder::kFromArray) const;
+
+  //----------------------------------------------------------------------------
+  // scans
+  //
+  // Prefix sums along one or more axes; see the scans of CudaArray2DBase.
+
+  /**
+   * Prefix sums along x.
+   * @param other output array of the same size
+   * @param mode inclusive or exclusive sums; see ScanMode
+   */
+  template <typename OtherDerived,
+            typename CudaArrayTraits<OtherDerived>::Mutable is_mutable = true>
+  inline void ScanX(OtherDerived *other,
+                    const ScanMode mode = ScanMode::kInclusive) const {
+    ScanAxes_(other, internal::kScanX, mode);
+  }
+
+  /**
+   * Prefix sums along y.
+   * @param other output array of the same size
+   * @param mode inclusive or exclusive sums; see ScanMode
+   */
+  template <typename OtherDerived,
+            typename CudaArrayTraits<OtherDerived>::Mutable is_mutable = true>
+  inline void ScanY(OtherDerived *other,
+                    const ScanMode mode = ScanMode::kInclusive) const {
+    ScanAxes_(other, internal::kScanY, mode);
+  }
+
+  /**
+   * Prefix sums along z; each thread scans one line along z.
+   * @param other output array of the same size
+   * @param mode inclusive or exclusive sums; see ScanMode
+   */
+  template <typename OtherDerived,
+            typename CudaArrayTraits<OtherDerived>::Mutable is_mutable = true>
+  inline void ScanZ(OtherDerived *other,
+                    const ScanMode mode = ScanMode::kInclusive) const {
+    ScanAxes_(other, internal::kScanZ, mode);
+  }
+
+  /**
+   * 3D prefix sums: other(x, y, z) is the sum of this(i, j, k) over i <= x,
+   * j <= y, and k <= z, or over i < x, j < y, and k < z for exclusive sums.
+   * @param other output array of the same size
+   * @param mode inclusive or exclusive sums; see ScanMode
+   */
+  template <typename OtherDerived,
+            typename CudaArrayTraits<OtherDerived>::Mutable is_mutable = true>
+  inline void ScanXYZ(OtherDerived *other,
+                      const ScanMode mode = ScanMode::kInclusive) const {
+    ScanAxes_(other, internal::kScanX | internal::kScanY | internal::kScanZ,
+              mode);
+  }
+
+  /**
+   * Build the summed-volume table of the array, i.e., its inclusive 3D prefix
+   * sums; the sum over any box then takes eight lookups (see
+   * SummedAreaBoxSum()). As in 2D, the scalar type of the table is the
+   * accumulator type.
+   * @param table output array of the same size
+   */
+  template <typename OtherDerived,
+            typename CudaArrayTraits<OtherDerived>::Mutable is_mutable = true>
+  inline void SummedAreaTable(OtherDerived *table) const {
+    ScanXYZ(table, ScanMode::kInclusive);
   }
 
   //----------------------------------------------------------------------------
@@ -446,9 +1263,323 @@ class CudaArray3DBase {
 
   dim3 block_dim_, grid_dim_;  // for calling kernels
 
+  LaunchMode launch_mode_;  // grid sizing for the element-wise kernels
+
   int device_;  // the GPU where the data for this array is stored
 
   cudaStream_t stream_;  // the stream on the GPU in which the class kernels run
+
+  //----------------------------------------------------------------------------
+  // private class methods
+
+ private:
+  // Device (std::false_type) and host (std::true_type) implementations of the
+  // operations above; see CudaArray2DBase.
+
+  // argument that represents this array in kernel launches
+  inline DeviceViewType DeviceView_() const {
+    return internal::DeviceViewOf<Derived>::Get(derived());
+  }
+
+  // launch grid for the grid-stride element-wise kernels; a kernel that uses
+  // dynamic shared memory (i.e., ApplyOp() with shared_mem_bytes > 0) always
+  // gets one thread per element, since its op may index shared memory by
+  // thread and would be called repeatedly by the same thread in a grid-stride
+  // loop
+  template <typename Kernel>
+  inline dim3 LaunchGridDim_(Kernel kernel, const dim3 &block_dim,
+                             const size_t shared_mem_bytes) const {
+    const dim3 num_tiles((width_ + block_dim.x - 1) / block_dim.x,
+                         (height_ + block_dim.y - 1) / block_dim.y,
+                         (depth_ + block_dim.z - 1) / block_dim.z);
+    return internal::GridStrideGridDim(kernel, num_tiles, block_dim,
+                                       shared_mem_bytes, device_,
+                                       (shared_mem_bytes > 0)
+                                           ? LaunchMode::kOneThreadPerElement
+                                           : launch_mode_);
+  }
+
+  // block dimensions for a kernel that gives the same result when repeated;
+  // these come from the BlockDimTuner if it is enabled, and from BlockDim()
+  // otherwise
+  template <typename Launch>
+  inline dim3 TunedBlockDim_(const char *kernel_name,
+                             const std::string &type_name,
+                             const Launch &launch, cudaStream_t stream) const {
+    BlockDimTuner<> &tuner = BlockDimTuner<>::Instance();
+    if (!tuner.Enabled()) {
+      return block_dim_;
+    }
+    return tuner.Tune(kernel_name, type_name,
+                      internal::ShapeClass(width_, height_, depth_),
+                      internal::BlockDimCandidates3D(), launch, device_,
+                      stream);
+  }
+
+  inline void Fill_(const Scalar value, std::false_type) {
+    internal::SetDevice(device_);
+    const auto launch = [&](const dim3 &block_dim) {
+      const dim3 grid_dim = LaunchGridDim_(
+          kernel::CudaArray3DBaseFill<DeviceViewType, Scalar>, block_dim, 0);
+      kernel::CudaArray3DBaseFill<<<grid_dim, block_dim, 0, stream_>>>(
+          DeviceView_(), value);
+    };
+    launch(TunedBlockDim_("CudaArray3DBase::Fill",
+                          internal::TuningTypeName<Derived>(), launch,
+                          stream_));
+  }
+
+  inline void Fill_(const Scalar value, std::true_type) {
+    host::CudaArray3DBaseFill(derived(), value);
+  }
+
+  // each thread fills four consecutive elements of a row
+  template <typename RandomFunction>
+  inline void FillRandom_(const PhiloxKey key, const unsigned long long counter,
+                          RandomFunction func, std::false_type) {
+    const dim3 grid_dim(((width_ + 3) / 4 + block_dim_.x - 1) / block_dim_.x,
+                        (height_ + block_dim_.y - 1) / block_dim_.y,
+                        (depth_ + block_dim_.z - 1) / block_dim_.z);
+
+    internal::SetDevice(device_);
+    kernel::CudaArray3DBaseFillRandomPhilox<<<grid_dim, block_dim_, 0,
+                                              stream_>>>(DeviceView_(), key,
+                                                         counter, func);
+  }
+
+  template <typename RandomFunction>
+  inline void FillRandom_(const PhiloxKey key, const unsigned long long counter,
+                          RandomFunction func, std::true_type) {
+    host::CudaArray3DBaseFillRandomPhilox(derived(), key, counter, func);
+  }
+
+  inline CudaEvent SetValues_(const Coordinate *coordinates,
+                              const Scalar *values, size_t num_values,
+                              std::false_type) {
+    return internal::ScatterValuesAsync(DeviceView_(), coordinates, num_values,
+                                        values, device_, stream_);
+  }
+
+  inline CudaEvent SetValues_(const Coordinate *coordinates,
+                              const Scalar *values, size_t num_values,
+                              std::true_type) {
+    host::ScatterValues(derived(), coordinates, num_values, values);
+    return CudaEvent();
+  }
+
+  inline CudaEvent GetValues_(const Coordinate *coordinates, size_t num_values,
+                              Scalar *values, std::false_type) const {
+    return internal::GatherValuesAsync(DeviceView_(), coordinates, num_values,
+                                       values, device_, stream_);
+  }
+
+  inline CudaEvent GetValues_(const Coordinate *coordinates, size_t num_values,
+                              Scalar *values, std::true_type) const {
+    host::GatherValues(derived(), coordinates, num_values, values);
+    return CudaEvent();
+  }
+
+  template <class Function>
+  inline void ApplyOp_(Function op, const unsigned int shared_mem_bytes,
+                       std::false_type) {
+    internal::SetDevice(device_);
+    const dim3 grid_dim = LaunchGridDim_(
+        kernel::CudaArray3DBaseApplyOp<DeviceViewType, Function>, block_dim_,
+        shared_mem_bytes);
+    kernel::CudaArray3DBaseApplyOp<<<grid_dim, block_dim_, shared_mem_bytes,
+                                     stream_>>>(DeviceView_(), op);
+  }
+
+  template <class Function>
+  inline void ApplyOp_(Function op, const unsigned int shared_mem_bytes,
+                       std::true_type) {
+    host::CudaArray3DBaseApplyOp(derived(), op);
+  }
+
+  template <class BinaryFunction>
+  inline void ApplyScalarOp_(const Scalar value, BinaryFunction op,
+                             std::false_type) {
+    internal::SetDevice(device_);
+    const dim3 grid_dim = LaunchGridDim_(
+        kernel::CudaArray3DBaseApplyScalarOp<DeviceViewType, Scalar,
+                                             BinaryFunction>,
+        block_dim_, 0);
+    kernel::CudaArray3DBaseApplyScalarOp<<<grid_dim, block_dim_, 0, stream_>>>(
+        DeviceView_(), value, op);
+  }
+
+  template <class BinaryFunction>
+  inline void ApplyScalarOp_(const Scalar value, BinaryFunction op,
+                             std::true_type) {
+    host::CudaArray3DBaseApplyScalarOp(derived(), value, op);
+  }
+
+  template <typename ResultType, class Transform, class BinaryFunction,
+            class Finalize, typename AccumulatorType>
+  inline CudaAsyncValue<ResultType> Reduce_(Transform transform,
+                                            BinaryFunction op,
+                                            Finalize finalize,
+                                            const AccumulatorType &identity,
+                                            std::false_type) const {
+    LIBCUA_INSTRUMENT("CudaArray3DBase::Reduce", Size() * sizeof(Scalar),
+                      device_, stream_, false);
+    typedef internal::LinearReader3D<DeviceViewType, unsigned int> Reader;
+    typedef internal::LinearReader3D<DeviceViewType, unsigned long long>
+        WideReader;
+
+    // only widen the kernel's linear indices when the array requires it
+    if (internal::Needs64BitIndexing(Size())) {
+      return internal::ReduceAsync<ResultType>(
+          WideReader(DeviceView_()), Size(), transform, op, finalize, identity,
+          device_, stream_);
+    }
+    return internal::ReduceAsync<ResultType>(Reader(DeviceView_()), Size(),
+                                             transform, op, finalize, identity,
+                                             device_, stream_);
+  }
+
+  template <typename ResultType, class Transform, class BinaryFunction,
+            class Finalize, typename AccumulatorType>
+  inline CudaAsyncValue<ResultType> Reduce_(Transform transform,
+                                            BinaryFunction op,
+                                            Finalize finalize,
+                                            const AccumulatorType &identity,
+                                            std::true_type) const {
+    LIBCUA_INSTRUMENT("CudaArray3DBase::Reduce", Size() * sizeof(Scalar),
+                      device_, stream_, true);
+    return CudaAsyncValue<ResultType>(finalize(
+        host::Reduce(internal::LinearReader3D<Derived, size_t>(derived()),
+                     Size(), transform, op, identity)));
+  }
+
+  template <typename MaskDerived>
+  inline std::vector<unsigned long long> Histogram_(const HistogramBins &bins,
+                                                    const MaskDerived &mask,
+                                                    std::false_type) const {
+    internal::CheckHistogramBins(bins);
+    LIBCUA_INSTRUMENT("CudaArray3DBase::Histogram", Size() * sizeof(Scalar),
+                      device_, stream_, false);
+    return internal::Histogram3D(
+        DeviceView_(), internal::DeviceViewOf<MaskDerived>::Get(mask), Size(),
+        bins, device_, stream_);
+  }
+
+  inline std::vector<unsigned long long> Histogram_(
+      const HistogramBins &bins, const internal::HistogramNoMask &mask,
+      std::false_type) const {
+    internal::CheckHistogramBins(bins);
+    LIBCUA_INSTRUMENT("CudaArray3DBase::Histogram", Size() * sizeof(Scalar),
+                      device_, stream_, false);
+    return internal::Histogram3D(DeviceView_(), mask, Size(), bins, device_,
+                                 stream_);
+  }
+
+  template <typename MaskDerived>
+  inline std::vector<unsigned long long> Histogram_(const HistogramBins &bins,
+                                                    const MaskDerived &mask,
+                                                    std::true_type) const {
+    internal::CheckHistogramBins(bins);
+    LIBCUA_INSTRUMENT("CudaArray3DBase::Histogram", Size() * sizeof(Scalar),
+                      device_, stream_, true);
+    return host::Histogram3D(derived(), mask, bins);
+  }
+
+  template <typename OtherDerived>
+  inline void CopyTo_(OtherDerived *other, std::false_type) const {
+    internal::SetDevice(device_);
+    typedef internal::DeviceViewOf<OtherDerived> OtherDeviceView;
+    const auto launch = [&](const dim3 &block_dim) {
+      const dim3 grid_dim = LaunchGridDim_(
+          kernel::CudaArray3DBaseCopyTo<DeviceViewType,
+                                        typename OtherDeviceView::type>,
+          block_dim, 0);
+      kernel::CudaArray3DBaseCopyTo<<<grid_dim, block_dim, 0, stream_>>>(
+          DeviceView_(), OtherDeviceView::Get(*other));
+    };
+    launch(TunedBlockDim_("CudaArray3DBase::CopyTo",
+                          internal::TuningTypeName<Derived>() + "->" +
+                              internal::TuningTypeName<OtherDerived>(),
+                          launch, stream_));
+  }
+
+  template <typename OtherDerived>
+  inline void CopyTo_(OtherDerived *other, std::true_type) const {
+    host::CudaArray3DBaseCopyTo(derived(), *other);
+  }
+
+  // permutation of the axes followed by the given flips (see
+  // internal::kFlipX); this implements Permute(), the flips, and the rotations
+  void Permute_(AxisPermutation permutation, int flips, Derived *other,
+                std::false_type) const;
+  void Permute_(AxisPermutation permutation, int flips, Derived *other,
+                std::true_type) const {
+    host::CudaArray3DBasePermute(derived(), *other, permutation, flips);
+  }
+
+  // device launches for the permutations that keep the x axis in place, and
+  // for those that move it; see the kernels
+  template <int AxisY, int AxisZ>
+  void PermuteRows_(int flips, Derived *other) const;
+  template <int AxisX, int AxisY, int AxisZ>
+  void PermuteTiles_(int flips, Derived *other) const;
+
+  template <unsigned int RadiusX, unsigned int RadiusY, unsigned int RadiusZ,
+            typename OtherDerived>
+  inline void SeparableConvolve_(
+      const ConvolutionTaps<RadiusX> &taps_x,
+      const ConvolutionTaps<RadiusY> &taps_y,
+      const ConvolutionTaps<RadiusZ> &taps_z, OtherDerived *other,
+      const ConvolutionBorder border, std::false_type) const {
+    internal::SeparableConvolve3D(
+        DeviceView_(), internal::DeviceViewOf<OtherDerived>::Get(*other),
+        taps_x, taps_y, taps_z, border, device_, stream_);
+  }
+
+  template <unsigned int RadiusX, unsigned int RadiusY, unsigned int RadiusZ,
+            typename OtherDerived>
+  inline void SeparableConvolve_(
+      const ConvolutionTaps<RadiusX> &taps_x,
+      const ConvolutionTaps<RadiusY> &taps_y,
+      const ConvolutionTaps<RadiusZ> &taps_z, OtherDerived *other,
+      const ConvolutionBorder border, std::true_type) const {
+    host::SeparableConvolve3D(derived(), *other, taps_x, taps_y, taps_z,
+                              border);
+  }
+
+  template <unsigned int Radius, class Function, typename OtherDerived>
+  inline void ApplyStencil_(Function op, OtherDerived *other,
+                            const ConvolutionBorder border,
+                            std::false_type) const {
+    internal::ApplyStencil3D<Radius>(
+        DeviceView_(), internal::DeviceViewOf<OtherDerived>::Get(*other), op,
+        border, device_, stream_);
+  }
+
+  template <unsigned int Radius, class Function, typename OtherDerived>
+  inline void ApplyStencil_(Function op, OtherDerived *other,
+                            const ConvolutionBorder border,
+                            std::true_type) const {
+    host::ApplyStencil3D<Radius>(derived(), *other, op, border);
+  }
+
+  // checks and instrumentation shared by all scans
+  template <typename OtherDerived>
+  void ScanAxes_(OtherDerived *other, const unsigned int axes,
+                 const ScanMode mode) const;
+
+  template <typename OtherDerived>
+  inline void Scan_(OtherDerived *other, const unsigned int axes,
+                    const ScanMode mode, std::false_type) const {
+    internal::Scan3D(DeviceView_(),
+                     internal::DeviceViewOf<OtherDerived>::Get(*other), axes,
+                     mode, device_, stream_);
+  }
+
+  template <typename OtherDerived>
+  inline void Scan_(OtherDerived *other, const unsigned int axes,
+                    const ScanMode mode, std::true_type) const {
+    host::Scan3D(derived(), *other, axes, mode);
+  }
 };
 
 //------------------------------------------------------------------------------
@@ -462,11 +1593,11 @@ const dim3 CudaArray3DBase<Derived>::kBlockDim = dim3(32, 8, 4);
 
 template <typename Derived>
 const typename CudaArray3DBase<Derived>::SizeType
-    CudaArray3DBase<Derived>::kTileSize = 32;
+    CudaArray3DBase<Derived>::kTileSize = internal::kTransposeTileSize;
 
 template <typename Derived>
 const typename CudaArray3DBase<Derived>::SizeType
-    CudaArray3DBase<Derived>::kBlockRows = 4;
+    CudaArray3DBase<Derived>::kBlockRows = internal::kTransposeBlockRows;
 
 //------------------------------------------------------------------------------
 //
@@ -481,6 +1612,7 @@ CudaArray3DBase<Derived>::CudaArray3DBase<Derived>(
     : width_(width),
       height_(height),
       depth_(depth),
+      launch_mode_(LaunchMode::kOccupancy),
       device_(device),
       stream_(stream) {
   SetBlockDim(block_dim);
@@ -501,6 +1633,7 @@ inline CudaArray3DBase<Derived> &CudaArray3DBase<Derived>::operator=(
 
   block_dim_ = other.block_dim_;
   grid_dim_ = other.grid_dim_;
+  launch_mode_ = other.launch_mode_;
   device_ = other.device_;
   stream_ = other.stream_;
 
@@ -513,33 +1646,257 @@ template <typename Derived>
 template <typename OtherDerived,
           typename CudaArrayTraits<OtherDerived>::Mutable is_mutable>
 inline void CudaArray3DBase<Derived>::CopyTo(OtherDerived *other) const {
-  if (this == other) {
+  if (static_cast<const void *>(this) == static_cast<const void *>(other)) {
     return;
   }
 
+  static_assert(internal::IsHostArray<OtherDerived>::value == IsHost::value,
+                "CopyTo() requires both arrays to be host arrays, or both "
+                "arrays to be device arrays.");
+  internal::CheckNotNull(other);
+  internal::CheckSameDevice(*this, *other);
+  internal::CheckSizeEqual3D(*this, *other);
+  LIBCUA_INSTRUMENT(
+      "CudaArray3DBase::CopyTo",
+      Size() * (sizeof(Scalar) + sizeof(typename OtherDerived::Scalar)),
+      device_, stream_, IsHost::value);
+  CopyTo_(other, IsHost());
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Derived>
+template <unsigned int RadiusX, unsigned int RadiusY, unsigned int RadiusZ,
+          typename OtherDerived,
+          typename CudaArrayTraits<OtherDerived>::Mutable is_mutable>
+inline void CudaArray3DBase<Derived>::SeparableConvolve(
+    const ConvolutionTaps<RadiusX> &taps_x,
+    const ConvolutionTaps<RadiusY> &taps_y,
+    const ConvolutionTaps<RadiusZ> &taps_z, OtherDerived *other,
+    const ConvolutionBorder border) const {
+  static_assert(internal::IsHostArray<OtherDerived>::value == IsHost::value,
+                "SeparableConvolve() requires both arrays to be host arrays, "
+                "or both arrays to be device arrays.");
+  internal::CheckNotNull(other);
+  internal::CheckSameDevice(*this, *other);
+  internal::CheckConvolutionSize3D(*this, *other);
+  LIBCUA_INSTRUMENT(
+      "CudaArray3DBase::SeparableConvolve",
+      Size() * (sizeof(Scalar) + sizeof(typename OtherDerived::Scalar)),
+      device_, stream_, IsHost::value);
+  SeparableConvolve_(taps_x, taps_y, taps_z, other,
+                     internal::ResolveConvolutionBorder(derived(), border),
+                     IsHost());
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Derived>
+template <unsigned int Radius, class Function, typename OtherDerived,
+          typename CudaArrayTraits<OtherDerived>::Mutable is_mutable>
+inline void CudaArray3DBase<Derived>::ApplyStencil(
+    Function op, OtherDerived *other, const ConvolutionBorder border) const {
+  static_assert(internal::IsHostArray<OtherDerived>::value == IsHost::value,
+                "ApplyStencil() requires both arrays to be host arrays, or "
+                "both arrays to be device arrays.");
   internal::CheckNotNull(other);
   internal::CheckSameDevice(*this, *other);
-  internal::CheckSizeEqual2D(*this, *other);
+  internal::CheckStencilArrays3D(derived(), *other);
+  LIBCUA_INSTRUMENT(
+      "CudaArray3DBase::ApplyStencil",
+      Size() * (sizeof(Scalar) + sizeof(typename OtherDerived::Scalar)),
+      device_, stream_, IsHost::value);
+  ApplyStencil_<Radius>(op, other,
+                        internal::ResolveConvolutionBorder(derived(), border),
+                        IsHost());
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Derived>
+template <typename OtherDerived>
+inline void CudaArray3DBase<Derived>::ScanAxes_(OtherDerived *other,
+                                                const unsigned int axes,
+                                                const ScanMode mode) const {
+  static_assert(internal::IsHostArray<OtherDerived>::value == IsHost::value,
+                "Scans require both arrays to be host arrays, or both arrays "
+                "to be device arrays.");
+  internal::CheckNotNull(other);
+  internal::CheckSameDevice(*this, *other);
+  internal::CheckScanArrays(derived(), *other, std::true_type());
+  LIBCUA_INSTRUMENT(
+      "CudaArray3DBase::Scan",
+      Size() * internal::ScanBytesPerElement(
+                   axes, sizeof(Scalar), sizeof(typename OtherDerived::Scalar)),
+      device_, stream_, IsHost::value);
+  Scan_(other, axes, mode, IsHost());
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Derived>
+ENABLE_IF_MUTABLE_IMPL inline void CudaArray3DBase<Derived>::Permute(
+    AxisPermutation permutation, Derived *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSameDevice(*this, *other);
+  internal::CheckPermutedSizeEqual3D(*this, *other, permutation);
+  LIBCUA_INSTRUMENT("CudaArray3DBase::Permute", 2 * Size() * sizeof(Scalar),
+                    device_, stream_, IsHost::value);
+  Permute_(permutation, 0, other, IsHost());
+}
+
+template <typename Derived>
+ENABLE_IF_MUTABLE_IMPL inline void CudaArray3DBase<Derived>::FlipX(
+    Derived *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSameDevice(*this, *other);
+  internal::CheckSizeEqual3D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaArray3DBase::FlipX", 2 * Size() * sizeof(Scalar),
+                    device_, stream_, IsHost::value);
+  Permute_(AxisPermutation::kXYZ, internal::kFlipX, other, IsHost());
+}
+
+template <typename Derived>
+ENABLE_IF_MUTABLE_IMPL inline void CudaArray3DBase<Derived>::FlipY(
+    Derived *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSameDevice(*this, *other);
+  internal::CheckSizeEqual3D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaArray3DBase::FlipY", 2 * Size() * sizeof(Scalar),
+                    device_, stream_, IsHost::value);
+  Permute_(AxisPermutation::kXYZ, internal::kFlipY, other, IsHost());
+}
+
+template <typename Derived>
+ENABLE_IF_MUTABLE_IMPL inline void CudaArray3DBase<Derived>::FlipZ(
+    Derived *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSameDevice(*this, *other);
+  internal::CheckSizeEqual3D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaArray3DBase::FlipZ", 2 * Size() * sizeof(Scalar),
+                    device_, stream_, IsHost::value);
+  Permute_(AxisPermutation::kXYZ, internal::kFlipZ, other, IsHost());
+}
+
+template <typename Derived>
+ENABLE_IF_MUTABLE_IMPL inline void CudaArray3DBase<Derived>::Rot180(
+    Axis axis, Derived *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSameDevice(*this, *other);
+  internal::CheckSizeEqual3D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaArray3DBase::Rot180", 2 * Size() * sizeof(Scalar),
+                    device_, stream_, IsHost::value);
+  Permute_(AxisPermutation::kXYZ, internal::Rot180Flips(axis), other,
+           IsHost());
+}
+
+template <typename Derived>
+ENABLE_IF_MUTABLE_IMPL inline void CudaArray3DBase<Derived>::Rot90_CCW(
+    Axis axis, Derived *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSameDevice(*this, *other);
+  internal::CheckPermutedSizeEqual3D(*this, *other,
+                                     internal::Rot90Permutation(axis));
+  LIBCUA_INSTRUMENT("CudaArray3DBase::Rot90_CCW", 2 * Size() * sizeof(Scalar),
+                    device_, stream_, IsHost::value);
+  Permute_(internal::Rot90Permutation(axis), internal::Rot90Flips(axis, false),
+           other, IsHost());
+}
+
+template <typename Derived>
+ENABLE_IF_MUTABLE_IMPL inline void CudaArray3DBase<Derived>::Rot90_CW(
+    Axis axis, Derived *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSameDevice(*this, *other);
+  internal::CheckPermutedSizeEqual3D(*this, *other,
+                                     internal::Rot90Permutation(axis));
+  LIBCUA_INSTRUMENT("CudaArray3DBase::Rot90_CW", 2 * Size() * sizeof(Scalar),
+                    device_, stream_, IsHost::value);
+  Permute_(internal::Rot90Permutation(axis), internal::Rot90Flips(axis, true),
+           other, IsHost());
+}
+
+template <typename Derived>
+inline void CudaArray3DBase<Derived>::Permute_(AxisPermutation permutation,
+                                               int flips, Derived *other,
+                                               std::false_type) const {
   internal::SetDevice(device_);
-  kernel::CudaArray3DBaseCopyTo<<<grid_dim_, block_dim_>>>(derived(), *other);
+  switch (permutation) {
+    case AxisPermutation::kXYZ:
+      PermuteRows_<1, 2>(flips, other);
+      break;
+    case AxisPermutation::kXZY:
+      PermuteRows_<2, 1>(flips, other);
+      break;
+    case AxisPermutation::kYXZ:
+      PermuteTiles_<1, 0, 2>(flips, other);
+      break;
+    case AxisPermutation::kYZX:
+      PermuteTiles_<1, 2, 0>(flips, other);
+      break;
+    case AxisPermutation::kZXY:
+      PermuteTiles_<2, 0, 1>(flips, other);
+      break;
+    case AxisPermutation::kZYX:
+      PermuteTiles_<2, 1, 0>(flips, other);
+      break;
+  }
+}
+
+template <typename Derived>
+template <int AxisY, int AxisZ>
+inline void CudaArray3DBase<Derived>::PermuteRows_(int flips,
+                                                   Derived *other) const {
+  const dim3 grid_dim = LaunchGridDim_(
+      kernel::CudaArray3DBasePermuteRows<AxisY, AxisZ, DeviceViewType,
+                                         DeviceViewType>,
+      block_dim_, 0);
+  kernel::CudaArray3DBasePermuteRows<AxisY, AxisZ>
+      <<<grid_dim, block_dim_, 0, stream_>>>(DeviceView_(),
+                                             other->DeviceView_(), flips);
+}
+
+template <typename Derived>
+template <int AxisX, int AxisY, int AxisZ>
+inline void CudaArray3DBase<Derived>::PermuteTiles_(int flips,
+                                                    Derived *other) const {
+  // tiles span x and AxisX; blocks loop over the remaining axis, whose extent
+  // may exceed the grid limit
+  const SizeType sizes[3] = {width_, height_, depth_};
+  const dim3 block_dim(kTileSize, kBlockRows);
+  const dim3 grid_dim((width_ + kTileSize - 1) / kTileSize,
+                      (sizes[AxisX] + kTileSize - 1) / kTileSize,
+                      std::min<SizeType>(sizes[3 - AxisX], 65535));
+
+  kernel::CudaArray3DBasePermuteTiles<AxisX, AxisY, AxisZ>
+      <<<grid_dim, block_dim, 0, stream_>>>(DeviceView_(),
+                                            other->DeviceView_(), flips);
 }
 
 //------------------------------------------------------------------------------
 
 template <typename Derived>
 template <typename CurandStateArrayType, typename RandomFunction, class C,
-          typename C::Mutable is_mutable>
+          typename C::Mutable is_mutable,
+          typename std::enable_if<
+              !std::is_arithmetic<CurandStateArrayType>::value, bool>::type
+              is_state_array>
 inline void CudaArray3DBase<Derived>::FillRandom(
     CurandStateArrayType &rand_state, RandomFunction func) {
+  static_assert(!IsHost::value,
+                "FillRandom() uses the cuRAND device API and is not available "
+                "for host arrays.");
   internal::CheckSameDevice(*this, rand_state);
   const dim3 block_dim(kTileSize, kBlockRows, kBlockRows);
   const dim3 grid_dim((width_ + kTileSize - 1) / kTileSize,
                       (height_ + kTileSize - 1) / kTileSize,
                       (depth_ + kTileSize - 1) / kTileSize);
 
+  LIBCUA_INSTRUMENT("CudaArray3DBase::FillRandom", Size() * sizeof(Scalar),
+                    device_, stream_, false);
   internal::SetDevice(device_);
   kernel::CudaArray3DBaseFillRandom<<<grid_dim, block_dim, 0, stream_>>>(
-      rand_state, derived(), func);
+      rand_state.DeviceView(), DeviceView_(), func);
 }
 
 //------------------------------------------------------------------------------
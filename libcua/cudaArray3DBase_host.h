@@ -0,0 +1,222 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_CUDA_ARRAY3D_BASE_HOST_H_
+#define LIBCUA_CUDA_ARRAY3D_BASE_HOST_H_
+
+#include "hostThreadPool.h"
+#include "philox.h"
+#include "types.h"
+
+namespace cua {
+
+namespace host {
+
+//------------------------------------------------------------------------------
+//
+// Host (CPU) counterparts of the kernels in cudaArray3DBase.h; see
+// cudaArray2DBase_host.h. Each task processes a band of whole (y, z) rows.
+//
+//------------------------------------------------------------------------------
+
+//
+// copy values of one array to another, possibly with different datatypes
+//
+template <typename SrcCls, typename DstCls>
+inline void CudaArray3DBaseCopyTo(const SrcCls &src, DstCls &dst) {
+  const size_t w = src.Width();
+  const size_t h = src.Height();
+  internal::ParallelForRows(h * src.Depth(), w, [&](size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; ++i) {
+      const size_t y = i % h, z = i / h;
+      for (size_t x = 0; x < w; ++x) {
+        dst.set(x, y, z,
+                static_cast<typename DstCls::Scalar>(src.get(x, y, z)));
+      }
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+
+//
+// reorder the axes of src into dst (see AxisPermutation), and then reverse the
+// axes of dst given by flips (see internal::kFlipX)
+//
+template <typename SrcCls, typename DstCls>
+inline void CudaArray3DBasePermute(const SrcCls &src, DstCls &dst,
+                                   AxisPermutation permutation, int flips) {
+  const size_t sizes[3] = {src.Width(), src.Height(), src.Depth()};
+  const int axes[3] = {internal::PermutedAxis(permutation, 0),
+                       internal::PermutedAxis(permutation, 1),
+                       internal::PermutedAxis(permutation, 2)};
+
+  // coordinate along axis i of dst for the given coordinates in src
+  const auto dst_index = [&](const size_t coords[3], int i) {
+    const size_t index = coords[axes[i]];
+    return (flips & (1 << i)) ? sizes[axes[i]] - 1 - index : index;
+  };
+
+  if (axes[0] == 0) {
+    // rows of src map to rows of dst
+    const size_t w = sizes[0], h = sizes[1];
+    internal::ParallelForRows(h * sizes[2], w, [&](size_t i0, size_t i1) {
+      for (size_t i = i0; i < i1; ++i) {
+        size_t coords[3] = {0, i % h, i / h};
+        const size_t dst_y = dst_index(coords, 1), dst_z = dst_index(coords, 2);
+        for (coords[0] = 0; coords[0] < w; ++coords[0]) {
+          dst.set(dst_index(coords, 0), dst_y, dst_z,
+                  src.get(coords[0], coords[1], coords[2]));
+        }
+      }
+    });
+    return;
+  }
+
+  // Otherwise, go through tiles spanning the x axis of src and the axis that
+  // becomes x in dst, so that both the rows read from src and the rows written
+  // to dst stay in cache for the whole tile.
+  const int other_axis = 3 - axes[0];
+  internal::ParallelForTiles(
+      sizes[0], sizes[axes[0]], SrcCls::kTileSize,
+      [&](size_t x0, size_t x1, size_t v0, size_t v1) {
+        size_t coords[3];
+        for (coords[other_axis] = 0; coords[other_axis] < sizes[other_axis];
+             ++coords[other_axis]) {
+          for (coords[axes[0]] = v0; coords[axes[0]] < v1;
+               ++coords[axes[0]]) {
+            for (coords[0] = x0; coords[0] < x1; ++coords[0]) {
+              dst.set(dst_index(coords, 0), dst_index(coords, 1),
+                      dst_index(coords, 2),
+                      src.get(coords[0], coords[1], coords[2]));
+            }
+          }
+        }
+      });
+}
+
+//------------------------------------------------------------------------------
+
+//
+// general element-wise array operations
+// op: function mapping (x,y,z) -> CudaArrayClass::Scalar
+//
+template <typename CudaArrayClass, class Function>
+inline void CudaArray3DBaseApplyOp(CudaArrayClass &array, Function op) {
+  const size_t w = array.Width();
+  const size_t h = array.Height();
+  internal::ParallelForRows(h * array.Depth(), w, [&](size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; ++i) {
+      const size_t y = i % h, z = i / h;
+      for (size_t x = 0; x < w; ++x) {
+        array.set(x, y, z, op(x, y, z));
+      }
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+
+//
+// array(x,y,z) = op(array(x,y,z), value)
+//
+template <typename CudaArrayClass, typename T, class BinaryFunction>
+inline void CudaArray3DBaseApplyScalarOp(CudaArrayClass &array, const T value,
+                                         BinaryFunction op) {
+  const size_t w = array.Width();
+  const size_t h = array.Height();
+  internal::ParallelForRows(h * array.Depth(), w, [&](size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; ++i) {
+      const size_t y = i % h, z = i / h;
+      for (size_t x = 0; x < w; ++x) {
+        array.set(x, y, z, op(array.get(x, y, z), value));
+      }
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+
+//
+// fill an array with a value
+//
+template <typename CudaArrayClass, typename T>
+inline void CudaArray3DBaseFill(CudaArrayClass &array, const T value) {
+  const size_t w = array.Width();
+  const size_t h = array.Height();
+  internal::ParallelForRows(h * array.Depth(), w, [&](size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; ++i) {
+      const size_t y = i % h, z = i / h;
+      for (size_t x = 0; x < w; ++x) {
+        array.set(x, y, z, value);
+      }
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+
+//
+// fill an array with counter-based random values, bit-identical to
+// kernel::CudaArray3DBaseFillRandomPhilox
+//
+template <typename CudaArrayClass, typename RandomFunction>
+inline void CudaArray3DBaseFillRandomPhilox(CudaArrayClass &array,
+                                            const PhiloxKey key,
+                                            const unsigned long long counter,
+                                            RandomFunction func) {
+  const size_t w = array.Width();
+  const size_t h = array.Height();
+  internal::ParallelForRows(h * array.Depth(), w, [&](size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; ++i) {
+      const size_t y = i % h, z = i / h;
+      for (size_t x = 0; x < w; x += 4) {
+        const PhiloxCounter bits = Philox4x32_10(
+            internal::MakePhiloxCounter(x / 4, i, counter), key);
+        for (unsigned int k = 0; k < 4 && x + k < w; ++k) {
+          array.set(x + k, y, z, func(internal::PhiloxWord(bits, k)));
+        }
+      }
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace host
+
+}  // namespace cua
+
+#endif  // LIBCUA_CUDA_ARRAY3D_BASE_HOST_H_
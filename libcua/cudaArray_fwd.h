@@ -48,6 +48,12 @@ class CudaArray2D;
 template <typename T>
 class CudaArray3D;
 
+template <typename T>
+class CudaHostArray2D;
+
+template <typename T>
+class CudaHostArray3D;
+
 class CudaRandomStateArray2D;
 
 class CudaRandomStateArray3D;
@@ -64,9 +70,21 @@ class CudaSurface2DArray;
 template <typename T>
 class CudaSurface3D;
 
+template <typename T>
+class CudaSurfaceTexture2D;
+
+template <typename T>
+class CudaSurfaceTexture3D;
+
 template <typename T>
 class CudaTexture2D;
 
+template <typename T>
+class CudaPitchedTexture2D;
+
+template <typename T>
+class CudaMipmappedTexture2D;
+
 template <typename T>
 class CudaTexture3DBase;
 
@@ -76,6 +94,9 @@ class CudaTexture2DArray;
 template <typename T>
 class CudaTexture3D;
 
+template <typename T>
+class CudaMipmappedTexture3D;
+
 }  // namespace cua
 
 #endif  // LIBCUA_CUDA_ARRAY_FWD_H_
@@ -0,0 +1,107 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_CUDA_ASYNC_VALUE_H_
+#define LIBCUA_CUDA_ASYNC_VALUE_H_
+
+#include <memory>  // for shared_ptr
+
+#include "cudaEvent.h"
+
+namespace cua {
+
+/**
+ * @class CudaAsyncValue
+ * @brief A value that is computed asynchronously on the GPU, e.g., the result
+ * of a reduction.
+ *
+ * The value is written into host memory by work on a CUDA stream; Get() waits
+ * for that work and returns it. Until then, the host is free to queue more
+ * work or to do something else:
+ *
+ *     CudaAsyncValue<float> sum = array.SumAsync();
+ *     // ... other work ...
+ *     const float value = sum.Get();
+ *
+ * Copies are shallow and refer to the same value.
+ */
+template <typename T>
+class CudaAsyncValue {
+ public:
+  /**
+   * Constructor for a value that is already available, e.g., one that was
+   * computed on the host.
+   * @param value the value
+   */
+  explicit CudaAsyncValue(const T &value)
+      : value_(std::make_shared<T>(value)) {}
+
+  /**
+   * Constructor for a value that becomes available once the given event has
+   * completed.
+   * @param value host memory that the GPU will write the value into; this
+   *   should be pinned for the copy to be asynchronous
+   * @param event event recorded after the work that writes the value
+   */
+  CudaAsyncValue(const std::shared_ptr<T> &value, const CudaEvent &event)
+      : value_(value), event_(event) {}
+
+  /**
+   * Wait for the value to be available.
+   * @return the value
+   */
+  inline const T &Get() const {
+    event_.Synchronize();
+    return *value_;
+  }
+
+  /**
+   * @return true if the value is available, i.e., Get() will not block
+   */
+  inline bool Ready() const { return event_.Query(); }
+
+  /**
+   * @return the event that completes once the value is available
+   */
+  inline const CudaEvent &Event() const { return event_; }
+
+ private:
+  std::shared_ptr<T> value_;
+  CudaEvent event_;
+};
+
+}  // namespace cua
+
+#endif  // LIBCUA_CUDA_ASYNC_VALUE_H_
@@ -0,0 +1,135 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_CUDA_EVENT_H_
+#define LIBCUA_CUDA_EVENT_H_
+
+#include <memory>  // for shared_ptr
+
+namespace cua {
+
+/**
+ * @class CudaEvent
+ * @brief Completion handle for asynchronous operations.
+ *
+ * The asynchronous copy functions of the array classes (AssignAsync() and
+ * CopyToAsync()) enqueue their work on the array's stream and return a
+ * CudaEvent recorded right after it. The event can be used to wait on the host,
+ * to poll for completion, or to make another stream wait for the copy, e.g., to
+ * pipeline upload, processing, and download for consecutive frames:
+ *
+ *     CudaEvent uploaded = input.AssignAsync(pinned_frame);
+ *     uploaded.Wait(process_stream);  // kernels on process_stream run after
+ *
+ * Copies are shallow; all copies refer to the same underlying event, which is
+ * destroyed with the last copy. A default-constructed event is considered to
+ * be already complete.
+ */
+class CudaEvent {
+ public:
+  //----------------------------------------------------------------------------
+  // constructors
+
+  /**
+   * Constructor for an empty (already completed) event.
+   */
+  CudaEvent() {}
+
+  /**
+   * Create a new event on the current device and record it on the given
+   * stream.
+   * @param stream stream on which to record the event; it must belong to the
+   *   current device
+   * @return the recorded event
+   */
+  static inline CudaEvent Record(cudaStream_t stream) {
+    cudaEvent_t event;
+    cudaEventCreateWithFlags(&event, cudaEventDisableTiming);
+    cudaEventRecord(event, stream);
+    return CudaEvent(event);
+  }
+
+  //----------------------------------------------------------------------------
+  // event operations
+
+  /**
+   * Block the calling thread until all work captured by the event has
+   * completed.
+   */
+  inline void Synchronize() const {
+    if (event_) {
+      cudaEventSynchronize(event_.get());
+    }
+  }
+
+  /**
+   * @return true if all work captured by the event has completed
+   */
+  inline bool Query() const {
+    return !event_ || cudaEventQuery(event_.get()) != cudaErrorNotReady;
+  }
+
+  /**
+   * Make all future work submitted to the given stream wait for the event. This
+   * call returns immediately.
+   * @param stream stream that should wait; it may belong to any device
+   */
+  inline void Wait(cudaStream_t stream) const {
+    if (event_) {
+      cudaStreamWaitEvent(stream, event_.get(), 0);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // getters
+
+  /**
+   * @return the underlying CUDA event, or nullptr for an empty event
+   */
+  inline cudaEvent_t Get() const { return event_.get(); }
+
+  //----------------------------------------------------------------------------
+  // private class methods and fields
+
+ private:
+  explicit CudaEvent(cudaEvent_t event)
+      : event_(event, [](cudaEvent_t e) { cudaEventDestroy(e); }) {}
+
+  std::shared_ptr<CUevent_st> event_;
+};
+
+}  // namespace cua
+
+#endif  // LIBCUA_CUDA_EVENT_H_
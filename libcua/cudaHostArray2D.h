@@ -0,0 +1,485 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_CUDA_HOST_ARRAY2D_H_
+#define LIBCUA_CUDA_HOST_ARRAY2D_H_
+
+#include "cudaArray2DBase.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>  // for shared_ptr
+#include <new>     // for bad_alloc
+#include <stdexcept>
+
+#include "cudaArray2D.h"
+#include "cudaArray_fwd.h"
+#include "cudaEvent.h"
+#include "types.h"
+#include "util.h"
+
+namespace cua {
+
+/**
+ * @class CudaHostArray2D
+ * @brief Host-memory 2D array whose operations run on the CPU.
+ *
+ * This class stores a pitched 2D array in either pageable or page-locked host
+ * memory and exposes the same interface as CudaArray2D. All CudaArray2DBase
+ * operations (Fill, ApplyOp, CopyTo, FlipLR/FlipUD, Rot180, Rot90_CW/CCW,
+ * Transpose, and the arithmetic operators) run on a pool of CPU threads and
+ * give the same results as their GPU counterparts, so the class can be used on
+ * machines without a GPU. Copy/assignment is a shallow operation; use `Copy()`
+ * or `CopyTo(other)` to perform a deep copy.
+ *
+ * Functions passed to ApplyOp() must be callable on the host, e.g.,
+ *
+ *     CudaHostArray2D<float> arr(640, 480);
+ *     arr.ApplyOp([] __host__ __device__(unsigned int x, unsigned int y) {
+ *       return static_cast<float>(x + y);
+ *     });
+ *
+ * Host arrays report a Device() of -1.
+ */
+template <typename T>
+class CudaHostArray2D : public CudaArray2DBase<CudaHostArray2D<T>> {
+ public:
+  friend class CudaArray2DBase<CudaHostArray2D<T>>;
+
+  /// datatype of the array
+  typedef T Scalar;
+
+  typedef CudaArray2DBase<CudaHostArray2D<T>> Base;
+  typedef typename Base::SizeType SizeType;
+  typedef typename Base::IndexType IndexType;
+
+  /// rows are padded to a multiple of this many bytes
+  static const size_t kPitchAlignment = 64;
+
+ protected:
+  // for convenience, reference protected base class members directly (they are
+  // otherwise not in the current scope because CudaArray2DBase is templated)
+  using Base::width_;
+  using Base::height_;
+  using Base::block_dim_;
+  using Base::grid_dim_;
+  using Base::device_;
+  using Base::stream_;
+
+ public:
+  //----------------------------------------------------------------------------
+  // constructors and destructor
+
+  /**
+   * Constructor.
+   * @param width number of columns in the array, assuming a row-major array
+   * @param height number of rows in the array, assuming a row-major array
+   * @param memory_type whether to allocate pageable or page-locked memory;
+   *   page-locked memory speeds up transfers to and from the GPU, but it
+   *   requires a CUDA-capable device
+   */
+  CudaHostArray2D(SizeType width, SizeType height,
+                  HostMemoryType memory_type = HostMemoryType::kPageable);
+
+  /**
+   * Copy constructor. This is a shallow-copy operation, meaning that the
+   * underlying memory is the same for both arrays.
+   */
+  CudaHostArray2D(const CudaHostArray2D<T> &other);
+
+  ~CudaHostArray2D();
+
+  //----------------------------------------------------------------------------
+  // array operations
+
+  /**
+   * Create an empty array of the same size and memory type as the current
+   * array.
+   * @param device unused; present for interface compatibility with CudaArray2D
+   */
+  CudaHostArray2D<T> EmptyCopy(int device = -1) const;
+
+  /**
+   * Create a new empty array with transposed dimensions (flipped height/width).
+   */
+  CudaHostArray2D<T> EmptyFlippedCopy() const;
+
+  /**
+   * Shallow re-assignment of the given array to share the contents of another.
+   * @param other a separate array whose contents will now also be referenced by
+   *   the current array
+   * @return *this
+   */
+  CudaHostArray2D<T> &operator=(const CudaHostArray2D<T> &other);
+
+  /**
+   * Copy the contents of a densely packed CPU array to the current array. This
+   * function assumes that the CPU array has the correct size!
+   * @param host_array the CPU-bound array
+   * @return *this
+   */
+  CudaHostArray2D<T> &operator=(const T *host_array);
+
+  /**
+   * Evaluate an element-wise array expression into the current array; see
+   * Assign().
+   * @param expression expression over arrays of the same size as this array
+   * @return *this
+   */
+  template <typename Expression>
+  inline CudaHostArray2D<T> &operator=(
+      const ArrayExpression<Expression> &expression) {
+    Base::Assign(expression);
+    return *this;
+  }
+
+  /**
+   * Copy the contents of the current array to a densely packed CPU array. This
+   * function assumes that the CPU array has the correct size!
+   * @param host_array the CPU-bound array
+   */
+  void CopyTo(T *host_array) const;
+
+  /**
+   * Copy to another host array.
+   * @param other destination array
+   */
+  void CopyTo(CudaHostArray2D<T> *other) const;
+
+  /**
+   * Upload to a linear-memory GPU array.
+   * @param other destination array
+   */
+  void CopyTo(CudaArray2D<T> *other) const;
+
+  /**
+   * Asynchronously upload to a linear-memory GPU array on the destination's
+   * stream. Pinned host memory is required for the copy to actually overlap
+   * with other work.
+   * @param other destination array
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(CudaArray2D<T> *other) const;
+
+  //----------------------------------------------------------------------------
+
+  /**
+   * Create a view onto the underlying memory. This function assumes that the
+   * cropped view region is valid!
+   * @param x x-coordinate for the top left of the view
+   * @param y y-coordinate for the top left of the view
+   * @param width width of the view
+   * @param height height of the view
+   * @return new CudaHostArray2D object whose underlying pointer and size is
+   * aligned with the view
+   */
+  inline CudaHostArray2D<T> View(IndexType x, IndexType y, SizeType width,
+                                 SizeType height) const {
+    return CudaHostArray2D<T>(x, y, width, height, *this);
+  }
+
+  //----------------------------------------------------------------------------
+  // getters/setters
+
+  /**
+   * Get the address of an element in the array.
+   * @param x first coordinate, i.e., the column index in a row-major array
+   * @param y second coordinate, i.e., the row index in a row-major array
+   * @return pointer to the value at array(x, y)
+   */
+  __host__ __device__ inline T *ptr(IndexType x = 0, IndexType y = 0) {
+    return reinterpret_cast<T *>(reinterpret_cast<char *>(data_ref_) +
+                                 y * pitch_ + x * sizeof(T));
+  }
+
+  __host__ __device__ inline const T *ptr(IndexType x = 0,
+                                          IndexType y = 0) const {
+    return reinterpret_cast<const T *>(
+        reinterpret_cast<const char *>(data_ref_) + y * pitch_ +
+        x * sizeof(T));
+  }
+
+  /**
+   * Set an element in the array.
+   * @param x first coordinate, i.e., the column index in a row-major array
+   * @param y second coordinate, i.e., the row index in a row-major array
+   * @param v the new value to assign to array(x, y)
+   */
+  __host__ __device__ inline void set(IndexType x, IndexType y, const T v) {
+    *ptr(x, y) = v;
+  }
+
+  /**
+   * Get an element in the array.
+   * @param x first coordinate, i.e., the column index in a row-major array
+   * @param y second coordinate, i.e., the row index in a row-major array
+   * @return the value at array(x, y)
+   */
+  __host__ __device__ inline T get(IndexType x, IndexType y) const {
+    return *ptr(x, y);
+  }
+
+  /**
+   * Get the pitch of the array (the number of bytes in a row for a row-major
+   * array).
+   */
+  __host__ __device__ inline size_t Pitch() const { return pitch_; }
+
+  /**
+   * Return a cudaPitchedPtr representation for the underlying allocated memory.
+   */
+  inline cudaPitchedPtr GetPitchedPtr() const {
+    return make_cudaPitchedPtr(data_ref_, pitch_, width_ * sizeof(T), height_);
+  }
+
+  /**
+   * @return the kind of memory backing this array
+   */
+  inline HostMemoryType MemoryType() const { return memory_type_; }
+
+  //----------------------------------------------------------------------------
+  // private class methods and fields
+
+ private:
+  /**
+   * Internal constructor used for creating views.
+   * @param x x-coordinate for the top left of the view
+   * @param y y-coordinate for the top left of the view
+   * @param width width of the view
+   * @param height height of the view
+   */
+  CudaHostArray2D(IndexType x, IndexType y, SizeType width, SizeType height,
+                  const CudaHostArray2D<T> &other);
+
+  HostMemoryType memory_type_;
+  size_t pitch_;
+  std::shared_ptr<T> data_;
+  T *data_ref_;  // start of the (possibly cropped) array
+};
+
+//------------------------------------------------------------------------------
+// template typedef for CRTP model, a la Eigen
+
+template <typename T>
+struct CudaArrayTraits<CudaHostArray2D<T>> {
+  typedef T Scalar;
+  typedef bool Mutable;
+  typedef std::true_type IsHost;
+};
+
+//------------------------------------------------------------------------------
+//
+// public method implementations
+//
+//------------------------------------------------------------------------------
+
+template <typename T>
+CudaHostArray2D<T>::CudaHostArray2D<T>(SizeType width, SizeType height,
+                                       HostMemoryType memory_type)
+    : Base(width, height, -1), memory_type_(memory_type) {
+  pitch_ = (width_ * sizeof(T) + kPitchAlignment - 1) / kPitchAlignment *
+           kPitchAlignment;
+  const size_t size_in_bytes = pitch_ * height_;
+
+  if (memory_type_ == HostMemoryType::kPinned) {
+    void *ptr = nullptr;
+    if (cudaHostAlloc(&ptr, size_in_bytes, cudaHostAllocPortable) !=
+        cudaSuccess) {
+      throw std::runtime_error("Failed to allocate page-locked memory.");
+    }
+    data_ref_ = reinterpret_cast<T *>(ptr);
+    data_ = std::shared_ptr<T>(data_ref_, cudaFreeHost);
+  } else {
+    data_ref_ = reinterpret_cast<T *>(std::malloc(size_in_bytes));
+    if (data_ref_ == nullptr && size_in_bytes > 0) {
+      throw std::bad_alloc();
+    }
+    data_ = std::shared_ptr<T>(data_ref_, std::free);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+CudaHostArray2D<T>::CudaHostArray2D<T>(const CudaHostArray2D<T> &other)
+    : Base(other),
+      memory_type_(other.memory_type_),
+      pitch_(other.pitch_),
+      data_(other.data_),
+      data_ref_(other.data_ref_) {}
+
+//------------------------------------------------------------------------------
+
+// private constructor for creating views
+template <typename T>
+CudaHostArray2D<T>::CudaHostArray2D<T>(IndexType x, IndexType y,
+                                       SizeType width, SizeType height,
+                                       const CudaHostArray2D<T> &other)
+    : Base(width, height, -1, other.block_dim_, other.stream_),
+      memory_type_(other.memory_type_),
+      pitch_(other.pitch_),
+      data_(other.data_),
+      data_ref_(const_cast<T *>(other.ptr(x, y))) {}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+CudaHostArray2D<T>::~CudaHostArray2D<T>() {
+  data_.reset();
+  data_ref_ = nullptr;
+
+  width_ = 0;
+  height_ = 0;
+  pitch_ = 0;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaHostArray2D<T> CudaHostArray2D<T>::EmptyCopy(int device) const {
+  return CudaHostArray2D<T>(width_, height_, memory_type_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaHostArray2D<T> CudaHostArray2D<T>::EmptyFlippedCopy() const {
+  return CudaHostArray2D<T>(height_, width_, memory_type_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaHostArray2D<T> &CudaHostArray2D<T>::operator=(
+    const CudaHostArray2D<T> &other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  Base::operator=(other);
+
+  memory_type_ = other.memory_type_;
+  pitch_ = other.pitch_;
+  data_ = other.data_;
+  data_ref_ = other.data_ref_;
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaHostArray2D<T> &CudaHostArray2D<T>::operator=(const T *host_array) {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaHostArray2D::Assign", 2 * sizeof(T) * width_ * height_,
+                    device_, stream_, true);
+  const size_t width_in_bytes = width_ * sizeof(T);
+  internal::ParallelForRows(height_, width_, [&](size_t y0, size_t y1) {
+    for (size_t y = y0; y < y1; ++y) {
+      std::memcpy(ptr(0, y), host_array + y * width_, width_in_bytes);
+    }
+  });
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaHostArray2D<T>::CopyTo(T *host_array) const {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaHostArray2D::CopyTo", 2 * sizeof(T) * width_ * height_,
+                    device_, stream_, true);
+  const size_t width_in_bytes = width_ * sizeof(T);
+  internal::ParallelForRows(height_, width_, [&](size_t y0, size_t y1) {
+    for (size_t y = y0; y < y1; ++y) {
+      std::memcpy(host_array + y * width_, ptr(0, y), width_in_bytes);
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaHostArray2D<T>::CopyTo(CudaHostArray2D<T> *other) const {
+  if (this == other) {
+    return;
+  }
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual2D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaHostArray2D::CopyTo", 2 * sizeof(T) * width_ * height_,
+                    device_, stream_, true);
+  const size_t width_in_bytes = width_ * sizeof(T);
+  internal::ParallelForRows(height_, width_, [&](size_t y0, size_t y1) {
+    for (size_t y = y0; y < y1; ++y) {
+      std::memcpy(other->ptr(0, y), ptr(0, y), width_in_bytes);
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaHostArray2D<T>::CopyTo(CudaArray2D<T> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual2D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaHostArray2D::Upload", 2 * sizeof(T) * width_ * height_,
+                    other->Device(), 0, false);
+  internal::SetDevice(other->Device());
+  cudaMemcpy2D(other->ptr(), other->Pitch(), data_ref_, pitch_,
+               width_ * sizeof(T), height_, cudaMemcpyHostToDevice);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaHostArray2D<T>::CopyToAsync(CudaArray2D<T> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual2D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaHostArray2D::UploadAsync",
+                    2 * sizeof(T) * width_ * height_, other->Device(),
+                    other->Stream(), false);
+  internal::SetDevice(other->Device());
+  cudaMemcpy2DAsync(other->ptr(), other->Pitch(), data_ref_, pitch_,
+                    width_ * sizeof(T), height_, cudaMemcpyHostToDevice,
+                    other->Stream());
+  return CudaEvent::Record(other->Stream());
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace cua
+
+#endif  // LIBCUA_CUDA_HOST_ARRAY2D_H_
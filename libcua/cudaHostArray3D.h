@@ -0,0 +1,539 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_CUDA_HOST_ARRAY3D_H_
+#define LIBCUA_CUDA_HOST_ARRAY3D_H_
+
+#include "cudaArray3DBase.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>  // for shared_ptr
+#include <new>     // for bad_alloc
+#include <stdexcept>
+
+#include "cudaArray3D.h"
+#include "cudaArray_fwd.h"
+#include "cudaEvent.h"
+#include "types.h"
+#include "util.h"
+
+namespace cua {
+
+/**
+ * @class CudaHostArray3D
+ * @brief Host-memory 3D array whose operations run on the CPU.
+ *
+ * This is the 3D analog of CudaHostArray2D: a pitched 3D array stored in
+ * pageable or page-locked host memory. All CudaArray3DBase operations run on a
+ * pool of CPU threads, and copy/assignment is a shallow operation. Host arrays
+ * report a Device() of -1.
+ */
+template <typename T>
+class CudaHostArray3D : public CudaArray3DBase<CudaHostArray3D<T>> {
+ public:
+  friend class CudaArray3DBase<CudaHostArray3D<T>>;
+
+  /// datatype of the array
+  typedef T Scalar;
+
+  typedef CudaArray3DBase<CudaHostArray3D<T>> Base;
+  typedef typename Base::SizeType SizeType;
+  typedef typename Base::IndexType IndexType;
+
+  /// rows are padded to a multiple of this many bytes
+  static const size_t kPitchAlignment = 64;
+
+ protected:
+  // for convenience, reference protected base class members directly (they are
+  // otherwise not in the current scope because CudaArray3DBase is templated)
+  using Base::width_;
+  using Base::height_;
+  using Base::depth_;
+  using Base::block_dim_;
+  using Base::grid_dim_;
+  using Base::device_;
+  using Base::stream_;
+
+ public:
+  //----------------------------------------------------------------------------
+  // constructors and destructor
+
+  /**
+   * Constructor.
+   * @param width number of elements in the first dimension of the array
+   * @param height number of elements in the second dimension of the array
+   * @param depth number of elements in the third dimension of the array
+   * @param memory_type whether to allocate pageable or page-locked memory;
+   *   page-locked memory speeds up transfers to and from the GPU, but it
+   *   requires a CUDA-capable device
+   */
+  CudaHostArray3D(SizeType width, SizeType height, SizeType depth,
+                  HostMemoryType memory_type = HostMemoryType::kPageable);
+
+  /**
+   * Copy constructor. This is a shallow-copy operation, meaning that the
+   * underlying memory is the same for both arrays.
+   */
+  CudaHostArray3D(const CudaHostArray3D<T> &other);
+
+  ~CudaHostArray3D();
+
+  //----------------------------------------------------------------------------
+  // array operations
+
+  /**
+   * Create an empty array of the same size and memory type as the current
+   * array.
+   * @param device unused; present for interface compatibility with CudaArray3D
+   */
+  CudaHostArray3D<T> EmptyCopy(int device = -1) const;
+
+  /**
+   * Create an empty array of the same memory type with the axes of the current
+   * array reordered, e.g., a depth x width x height array for
+   * AxisPermutation::kZXY.
+   * @param permutation new order of the axes; see AxisPermutation
+   */
+  CudaHostArray3D<T> EmptyPermutedCopy(AxisPermutation permutation) const;
+
+  /**
+   * Shallow re-assignment of the given array to share the contents of another.
+   * @param other a separate array whose contents will now also be referenced by
+   *   the current array
+   * @return *this
+   */
+  CudaHostArray3D<T> &operator=(const CudaHostArray3D<T> &other);
+
+  /**
+   * Copy the contents of a densely packed CPU array to the current array. This
+   * function assumes that the CPU array has the correct size!
+   * @param host_array the CPU-bound array
+   * @return *this
+   */
+  CudaHostArray3D<T> &operator=(const T *host_array);
+
+  /**
+   * Evaluate an element-wise array expression into the current array; see
+   * Assign().
+   * @param expression expression over arrays of the same size as this array
+   * @return *this
+   */
+  template <typename Expression>
+  inline CudaHostArray3D<T> &operator=(
+      const ArrayExpression<Expression> &expression) {
+    Base::Assign(expression);
+    return *this;
+  }
+
+  /**
+   * Copy the contents of the current array to a densely packed CPU array. This
+   * function assumes that the CPU array has the correct size!
+   * @param host_array the CPU-bound array
+   */
+  void CopyTo(T *host_array) const;
+
+  /**
+   * Copy to another host array.
+   * @param other destination array
+   */
+  void CopyTo(CudaHostArray3D<T> *other) const;
+
+  /**
+   * Upload to a linear-memory GPU array.
+   * @param other destination array
+   */
+  void CopyTo(CudaArray3D<T> *other) const;
+
+  /**
+   * Asynchronously upload to a linear-memory GPU array on the destination's
+   * stream. Pinned host memory is required for the copy to actually overlap
+   * with other work.
+   * @param other destination array
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(CudaArray3D<T> *other) const;
+
+  //----------------------------------------------------------------------------
+
+  /**
+   * Create a view onto the underlying memory. This function assumes that the
+   * cropped view region is valid!
+   * @param x x-coordinate for the top left of the view
+   * @param y y-coordinate for the top left of the view
+   * @param z z-coordinate for the top left of the view
+   * @param width width of the view
+   * @param height height of the view
+   * @param depth depth of the view
+   * @return new CudaHostArray3D object whose underlying pointer and size is
+   * aligned with the view
+   */
+  inline CudaHostArray3D<T> View(IndexType x, IndexType y, IndexType z,
+                                 SizeType width, SizeType height,
+                                 SizeType depth) const {
+    return CudaHostArray3D<T>(x, y, z, width, height, depth, *this);
+  }
+
+  //----------------------------------------------------------------------------
+  // getters/setters
+
+  /**
+   * Get the address of an element in the array.
+   * @param x first coordinate
+   * @param y second coordinate
+   * @param z third coordinate
+   * @return pointer to the value at array(x, y, z)
+   */
+  __host__ __device__ inline T *ptr(IndexType x = 0, IndexType y = 0,
+                                    IndexType z = 0) {
+    return reinterpret_cast<T *>(reinterpret_cast<char *>(data_ref_) +
+                                 (z * y_pitch_ + y) * pitch_ + x * sizeof(T));
+  }
+
+  __host__ __device__ inline const T *ptr(IndexType x = 0, IndexType y = 0,
+                                          IndexType z = 0) const {
+    return reinterpret_cast<const T *>(
+        reinterpret_cast<const char *>(data_ref_) +
+        (z * y_pitch_ + y) * pitch_ + x * sizeof(T));
+  }
+
+  /**
+   * Set an element in the array.
+   * @param x first coordinate
+   * @param y second coordinate
+   * @param z third coordinate
+   * @param v the new value to assign to array(x, y, z)
+   */
+  __host__ __device__ inline void set(IndexType x, IndexType y, IndexType z,
+                                      const T v) {
+    *ptr(x, y, z) = v;
+  }
+
+  /**
+   * Get an element in the array.
+   * @param x first coordinate
+   * @param y second coordinate
+   * @param z third coordinate
+   * @return the value at array(x, y, z)
+   */
+  __host__ __device__ inline T get(IndexType x, IndexType y,
+                                   IndexType z) const {
+    return *ptr(x, y, z);
+  }
+
+  /**
+   * Get the pitch of the array (the number of bytes in a row for a row-major
+   * array).
+   */
+  __host__ __device__ inline size_t Pitch() const { return pitch_; }
+
+  /**
+   * Return a cudaPitchedPtr representation for the underlying allocated memory.
+   */
+  inline cudaPitchedPtr GetPitchedPtr() const {
+    return make_cudaPitchedPtr(data_ref_, pitch_, width_ * sizeof(T),
+                               y_pitch_);
+  }
+
+  /**
+   * @return the kind of memory backing this array
+   */
+  inline HostMemoryType MemoryType() const { return memory_type_; }
+
+  //----------------------------------------------------------------------------
+  // private class methods and fields
+
+ private:
+  /**
+   * Internal constructor used for creating views.
+   * @param x x-coordinate for the top left of the view
+   * @param y y-coordinate for the top left of the view
+   * @param z z-coordinate for the top left of the view
+   * @param width width of the view
+   * @param height height of the view
+   * @param depth height of the view
+   */
+  CudaHostArray3D(IndexType x, IndexType y, IndexType z, SizeType width,
+                  SizeType height, SizeType depth,
+                  const CudaHostArray3D<T> &other);
+
+  // call func(y, z) for each row of the array, in parallel
+  template <typename RowFunction>
+  inline void ForEachRow_(RowFunction func) const;
+
+  HostMemoryType memory_type_;
+  size_t pitch_;
+  size_t y_pitch_;  // offset when using a view (always equals original height)
+  std::shared_ptr<T> data_;
+  T *data_ref_;  // start of the (possibly cropped) array
+};
+
+//------------------------------------------------------------------------------
+// template typedef for CRTP model, a la Eigen
+
+template <typename T>
+struct CudaArrayTraits<CudaHostArray3D<T>> {
+  typedef T Scalar;
+  typedef bool Mutable;
+  typedef std::true_type IsHost;
+};
+
+//------------------------------------------------------------------------------
+//
+// public method implementations
+//
+//------------------------------------------------------------------------------
+
+template <typename T>
+CudaHostArray3D<T>::CudaHostArray3D<T>(SizeType width, SizeType height,
+                                       SizeType depth,
+                                       HostMemoryType memory_type)
+    : Base(width, height, depth, -1),
+      memory_type_(memory_type),
+      y_pitch_(height) {
+  pitch_ = (width_ * sizeof(T) + kPitchAlignment - 1) / kPitchAlignment *
+           kPitchAlignment;
+  const size_t size_in_bytes = pitch_ * height_ * depth_;
+
+  if (memory_type_ == HostMemoryType::kPinned) {
+    void *ptr = nullptr;
+    if (cudaHostAlloc(&ptr, size_in_bytes, cudaHostAllocPortable) !=
+        cudaSuccess) {
+      throw std::runtime_error("Failed to allocate page-locked memory.");
+    }
+    data_ref_ = reinterpret_cast<T *>(ptr);
+    data_ = std::shared_ptr<T>(data_ref_, cudaFreeHost);
+  } else {
+    data_ref_ = reinterpret_cast<T *>(std::malloc(size_in_bytes));
+    if (data_ref_ == nullptr && size_in_bytes > 0) {
+      throw std::bad_alloc();
+    }
+    data_ = std::shared_ptr<T>(data_ref_, std::free);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+CudaHostArray3D<T>::CudaHostArray3D<T>(const CudaHostArray3D<T> &other)
+    : Base(other),
+      memory_type_(other.memory_type_),
+      pitch_(other.pitch_),
+      y_pitch_(other.y_pitch_),
+      data_(other.data_),
+      data_ref_(other.data_ref_) {}
+
+//------------------------------------------------------------------------------
+
+// private constructor for creating views
+template <typename T>
+CudaHostArray3D<T>::CudaHostArray3D<T>(IndexType x, IndexType y, IndexType z,
+                                       SizeType width, SizeType height,
+                                       SizeType depth,
+                                       const CudaHostArray3D<T> &other)
+    : Base(width, height, depth, -1, other.block_dim_, other.stream_),
+      memory_type_(other.memory_type_),
+      pitch_(other.pitch_),
+      y_pitch_(other.y_pitch_),
+      data_(other.data_),
+      data_ref_(const_cast<T *>(other.ptr(x, y, z))) {}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+CudaHostArray3D<T>::~CudaHostArray3D<T>() {
+  data_.reset();
+  data_ref_ = nullptr;
+  pitch_ = 0;
+  y_pitch_ = 0;
+
+  width_ = 0;
+  height_ = 0;
+  depth_ = 0;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaHostArray3D<T> CudaHostArray3D<T>::EmptyCopy(int device) const {
+  return CudaHostArray3D<T>(width_, height_, depth_, memory_type_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaHostArray3D<T> CudaHostArray3D<T>::EmptyPermutedCopy(
+    AxisPermutation permutation) const {
+  const SizeType sizes[3] = {width_, height_, depth_};
+  return CudaHostArray3D<T>(sizes[internal::PermutedAxis(permutation, 0)],
+                            sizes[internal::PermutedAxis(permutation, 1)],
+                            sizes[internal::PermutedAxis(permutation, 2)],
+                            memory_type_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaHostArray3D<T> &CudaHostArray3D<T>::operator=(
+    const CudaHostArray3D<T> &other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  Base::operator=(other);
+
+  memory_type_ = other.memory_type_;
+  pitch_ = other.pitch_;
+  y_pitch_ = other.y_pitch_;
+  data_ = other.data_;
+  data_ref_ = other.data_ref_;
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaHostArray3D<T> &CudaHostArray3D<T>::operator=(const T *host_array) {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaHostArray3D::Assign",
+                    2 * sizeof(T) * width_ * height_ * depth_, device_, stream_,
+                    true);
+  const size_t width_in_bytes = width_ * sizeof(T);
+  ForEachRow_([&](size_t y, size_t z) {
+    std::memcpy(ptr(0, y, z), host_array + (z * height_ + y) * width_,
+                width_in_bytes);
+  });
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaHostArray3D<T>::CopyTo(T *host_array) const {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaHostArray3D::CopyTo",
+                    2 * sizeof(T) * width_ * height_ * depth_, device_, stream_,
+                    true);
+  const size_t width_in_bytes = width_ * sizeof(T);
+  ForEachRow_([&](size_t y, size_t z) {
+    std::memcpy(host_array + (z * height_ + y) * width_, ptr(0, y, z),
+                width_in_bytes);
+  });
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaHostArray3D<T>::CopyTo(CudaHostArray3D<T> *other) const {
+  if (this == other) {
+    return;
+  }
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual3D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaHostArray3D::CopyTo",
+                    2 * sizeof(T) * width_ * height_ * depth_, device_, stream_,
+                    true);
+  const size_t width_in_bytes = width_ * sizeof(T);
+  ForEachRow_([&](size_t y, size_t z) {
+    std::memcpy(other->ptr(0, y, z), ptr(0, y, z), width_in_bytes);
+  });
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaHostArray3D<T>::CopyTo(CudaArray3D<T> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual3D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaHostArray3D::Upload",
+                    2 * sizeof(T) * width_ * height_ * depth_, other->Device(),
+                    0, false);
+  internal::SetDevice(other->Device());
+
+  cudaMemcpy3DParms params = {0};
+  params.srcPtr = GetPitchedPtr();
+  params.dstPtr = other->GetPitchedPtr();
+  params.extent = make_cudaExtent(width_ * sizeof(T), height_, depth_);
+  params.kind = cudaMemcpyHostToDevice;
+
+  cudaMemcpy3D(&params);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaHostArray3D<T>::CopyToAsync(CudaArray3D<T> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual3D(*this, *other);
+  LIBCUA_INSTRUMENT("CudaHostArray3D::UploadAsync",
+                    2 * sizeof(T) * width_ * height_ * depth_, other->Device(),
+                    other->Stream(), false);
+  internal::SetDevice(other->Device());
+
+  cudaMemcpy3DParms params = {0};
+  params.srcPtr = GetPitchedPtr();
+  params.dstPtr = other->GetPitchedPtr();
+  params.extent = make_cudaExtent(width_ * sizeof(T), height_, depth_);
+  params.kind = cudaMemcpyHostToDevice;
+
+  cudaMemcpy3DAsync(&params, other->Stream());
+
+  return CudaEvent::Record(other->Stream());
+}
+
+//------------------------------------------------------------------------------
+//
+// private method implementations
+//
+//------------------------------------------------------------------------------
+
+template <typename T>
+template <typename RowFunction>
+inline void CudaHostArray3D<T>::ForEachRow_(RowFunction func) const {
+  const size_t h = height_;
+  internal::ParallelForRows(h * depth_, width_, [&](size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; ++i) {
+      func(i % h, i / h);
+    }
+  });
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace cua
+
+#endif  // LIBCUA_CUDA_HOST_ARRAY3D_H_
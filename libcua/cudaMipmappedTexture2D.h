@@ -0,0 +1,564 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_CUDA_MIPMAPPED_TEXTURE2D_H_
+#define LIBCUA_CUDA_MIPMAPPED_TEXTURE2D_H_
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "cudaArray2DBase.h"
+#include "cudaSharedArrayObject.h"
+
+#include "cudaArray_fwd.h"
+#include "deviceView.h"
+#include "mipmap.h"
+#include "stagingBufferPool.h"
+#include "util.h"
+
+namespace cua {
+
+/**
+ * @class CudaMipmappedTexture2D
+ * @brief Mipmapped texture-memory 2D array.
+ *
+ * This class allocates a cudaMipmappedArray, i.e., a pyramid of 2D levels in
+ * which each level is half the size of the previous one, and creates a single
+ * texture object over all of its levels. Level 0 is the array itself: it has
+ * the extents returned by Width() and Height(), and it is the level that is
+ * read and written by the array operations of CudaArray2DBase. The coarser
+ * levels are filled either from the host with AssignLevel(), or on the device
+ * with GenerateMipmaps().
+ *
+ * In device code, lod() samples the pyramid at an explicit level of detail, and
+ * grad() lets the texture unit choose the level from the derivatives of the
+ * sample position. Multi-scale lookups thus become single texture fetches. All
+ * coordinates are given in elements of level 0 (as for CudaTexture2D) and are
+ * converted to the normalized coordinates that mipmapped textures require.
+ *
+ * The array is read-only on the device, and copy for CudaMipmappedTexture2D
+ * objects is a shallow operation. To access the array in your own kernels,
+ * pass its DeviceView() as the kernel parameter:
+ *
+ *     __global__ void device_kernel(
+ *         const CudaMipmappedTexture2DDeviceView<float> in,
+ *         CudaSurface2DDeviceView<float> out, const float level) {
+ *       const int x = blockIdx.x * blockDim.x + threadIdx.x;
+ *       const int y = blockIdx.y * blockDim.y + threadIdx.y;
+ *       out.set(x, y, in.lod(x + 0.5f, y + 0.5f, level));
+ *     }
+ */
+template <typename T>
+class CudaMipmappedTexture2D
+    : public CudaArray2DBase<CudaMipmappedTexture2D<T>> {
+ public:
+  friend class CudaArray2DBase<CudaMipmappedTexture2D<T>>;
+
+  /// datatype of the array
+  typedef T Scalar;
+
+  typedef CudaArray2DBase<CudaMipmappedTexture2D<T>> Base;
+  typedef typename Base::SizeType SizeType;
+  typedef typename Base::IndexType IndexType;
+
+ protected:
+  // for convenience, reference base class members directly (they are otherwise
+  // not in the current scope because CudaArray2DBase is templated)
+  using Base::width_;
+  using Base::height_;
+  using Base::block_dim_;
+  using Base::grid_dim_;
+  using Base::device_;
+  using Base::stream_;
+
+ public:
+  //----------------------------------------------------------------------------
+  // constructors and destructor
+
+  /**
+   * Constructor for a full pyramid, down to a 1x1 level.
+   * @param width number of columns in level 0, assuming a row-major array
+   * @param height number of rows in level 0, assuming a row-major array
+   * @param filter_mode use cudaFilterModeLinear to allow for interpolation
+   *   within a level
+   * @param address_mode specifies how to read values outside of 2D extent of
+   *   the texture
+   * @param read_mode can also optionally specify this as
+   *   cudaReadModeNormalizedFloat
+   * @param mipmap_filter_mode use cudaFilterModeLinear to allow for
+   *   interpolation between levels
+   * @param block_dim default block size for CUDA kernel calls involving this
+   *   object, i.e., the values for blockDim.x/y/z; note that the default grid
+   *   dimension is computed automatically based on the array size
+   * @param stream CUDA stream for this array object
+   */
+  CudaMipmappedTexture2D(
+      SizeType width, SizeType height,
+      const cudaTextureFilterMode filter_mode = cudaFilterModePoint,
+      const cudaTextureAddressMode address_mode = cudaAddressModeBorder,
+      const cudaTextureReadMode read_mode = cudaReadModeElementType,
+      const cudaTextureFilterMode mipmap_filter_mode = cudaFilterModePoint,
+      const dim3 block_dim = CudaMipmappedTexture2D<T>::kBlockDim,
+      const cudaStream_t stream = 0)  // default stream
+      : CudaMipmappedTexture2D(width, height, internal::GetDevice(), 0,
+                               filter_mode, address_mode, read_mode,
+                               mipmap_filter_mode, block_dim, stream) {}
+
+  /**
+   * Constructor.
+   * @param width number of columns in level 0, assuming a row-major array
+   * @param height number of rows in level 0, assuming a row-major array
+   * @param device GPU on which this array is stored, or -1 for the current GPU
+   * @param num_levels number of levels in the pyramid, including level 0, or
+   *   zero for a full pyramid
+   * @param filter_mode use cudaFilterModeLinear to allow for interpolation
+   *   within a level
+   * @param address_mode specifies how to read values outside of 2D extent of
+   *   the texture
+   * @param read_mode can also optionally specify this as
+   *   cudaReadModeNormalizedFloat
+   * @param mipmap_filter_mode use cudaFilterModeLinear to allow for
+   *   interpolation between levels
+   * @param block_dim default block size for CUDA kernel calls involving this
+   *   object, i.e., the values for blockDim.x/y/z; note that the default grid
+   *   dimension is computed automatically based on the array size
+   * @param stream CUDA stream for this array object
+   */
+  CudaMipmappedTexture2D(
+      SizeType width, SizeType height, int device,
+      const unsigned int num_levels = 0,
+      const cudaTextureFilterMode filter_mode = cudaFilterModePoint,
+      const cudaTextureAddressMode address_mode = cudaAddressModeBorder,
+      const cudaTextureReadMode read_mode = cudaReadModeElementType,
+      const cudaTextureFilterMode mipmap_filter_mode = cudaFilterModePoint,
+      const dim3 block_dim = CudaMipmappedTexture2D<T>::kBlockDim,
+      const cudaStream_t stream = 0);  // default stream
+
+  /**
+   * Host and device-level copy constructor. This is a shallow-copy operation,
+   * meaning that the underlying CUDA memory is the same for both arrays.
+   */
+  __host__ __device__
+  CudaMipmappedTexture2D(const CudaMipmappedTexture2D<T> &other);
+
+  /**
+   * Host-level move constructor. The underlying CUDA memory is handed over to
+   * the new array without updating its reference count, and other is left
+   * empty.
+   */
+  CudaMipmappedTexture2D(CudaMipmappedTexture2D<T> &&other);
+
+  ~CudaMipmappedTexture2D() {}
+
+  //----------------------------------------------------------------------------
+  // array operations
+
+  /**
+   * Shallow re-assignment of the given array to share the contents of another.
+   * @param other a separate array whose contents will now also be referenced by
+   *   the current array
+   * @return *this
+   */
+  CudaMipmappedTexture2D<T> &operator=(const CudaMipmappedTexture2D<T> &other);
+
+  /**
+   * Move assignment; as for the move constructor, other is left empty.
+   * @param other array whose contents will be referenced by the current array
+   * @return *this
+   */
+  CudaMipmappedTexture2D<T> &operator=(CudaMipmappedTexture2D<T> &&other);
+
+  /**
+   * Copy the contents of a CPU-bound memory array to level 0. This function
+   * assumes that the CPU array has the correct size! The other levels are not
+   * updated; see GenerateMipmaps().
+   * @param host_array the CPU-bound array
+   * @return *this
+   */
+  CudaMipmappedTexture2D<T> &operator=(const T *host_array);
+
+  // copies into other arrays (see CudaArray2DBase)
+  using Base::CopyTo;
+
+  /**
+   * Copy the contents of level 0 to a CPU-bound memory array. This function
+   * assumes that the CPU array has the correct size!
+   * @param host_array the CPU-bound array
+   */
+  void CopyTo(T *host_array) const;
+
+  /**
+   * Copy the contents of a CPU-bound memory array to one level of the pyramid.
+   * This function assumes that the CPU array has the correct size, i.e.,
+   * LevelWidth(level) x LevelHeight(level)!
+   * @param level pyramid level, with 0 being the finest
+   * @param host_array the CPU-bound array
+   */
+  void AssignLevel(unsigned int level, const T *host_array);
+
+  /**
+   * Copy the contents of one level of the pyramid to a CPU-bound memory array.
+   * This function assumes that the CPU array has the correct size, i.e.,
+   * LevelWidth(level) x LevelHeight(level)!
+   * @param level pyramid level, with 0 being the finest
+   * @param host_array the CPU-bound array
+   */
+  void CopyLevelTo(unsigned int level, T *host_array) const;
+
+  /**
+   * Compute levels 1 through NumLevels() - 1 from level 0 on the device. Each
+   * level is downsampled from the previous one by one kernel launch on the
+   * array's stream; host::MipmapDownsample2D() is the CPU reference for these
+   * kernels. Like the other array operations, this function is asynchronous
+   * with respect to the host.
+   * @param filter downsampling filter; see MipmapFilter
+   */
+  void GenerateMipmaps(const MipmapFilter filter = MipmapFilter::kBox);
+
+  //----------------------------------------------------------------------------
+  // getters
+
+  /**
+   * Device-level function for getting a pixel value of level 0. Note, if you
+   * use cudaReadModeNormalizedFloat as the texture read mode, you'll need to
+   * specify the appropriate return type (i.e., float) in the template argument.
+   * @param x first coordinate, i.e., the column index in a row-major array
+   * @param y second coordinate, i.e., the row index in a row-major array
+   * @return the value at array(x, y)
+   */
+  template <typename ReturnType = T>
+  __device__ inline ReturnType get(const int x, const int y) const {
+    return DeviceView().template get<ReturnType>(x, y);
+  }
+
+  /**
+   * Device-level function for getting an interpolated pixel value of level 0,
+   * which is enabled by specifying filter_mode as cudaFilterModeLinear in the
+   * constructor.
+   * @param x first coordinate, i.e., the column index in a row-major array
+   * @param y second coordinate, i.e., the row index in a row-major array
+   * @return the interpolated value at array(x, y)
+   */
+  template <typename ReturnType = T>
+  __device__ inline ReturnType interp(const float x, const float y) const {
+    return DeviceView().template interp<ReturnType>(x, y);
+  }
+
+  /**
+   * Device-level function for sampling the pyramid at an explicit level of
+   * detail. Fractional levels blend two levels if mipmap_filter_mode is
+   * cudaFilterModeLinear.
+   * @param x first coordinate, in elements of level 0
+   * @param y second coordinate, in elements of level 0
+   * @param level level of detail, with 0 being the finest
+   * @return the sampled value
+   */
+  template <typename ReturnType = T>
+  __device__ inline ReturnType lod(const float x, const float y,
+                                   const float level) const {
+    return DeviceView().template lod<ReturnType>(x, y, level);
+  }
+
+  /**
+   * Device-level function for sampling the pyramid at the level of detail
+   * that the texture unit derives from the screen-space derivatives of the
+   * sample position, e.g., the distance between the samples of neighboring
+   * threads.
+   * @param x first coordinate, in elements of level 0
+   * @param y second coordinate, in elements of level 0
+   * @param dx derivative of (x, y) along the first output axis, in elements of
+   *   level 0
+   * @param dy derivative of (x, y) along the second output axis, in elements of
+   *   level 0
+   * @return the sampled value
+   */
+  template <typename ReturnType = T>
+  __device__ inline ReturnType grad(const float x, const float y,
+                                    const float2 dx, const float2 dy) const {
+    return DeviceView().template grad<ReturnType>(x, y, dx, dy);
+  }
+
+  /**
+   * @return the number of levels in the pyramid, including level 0
+   */
+  __host__ __device__ inline unsigned int NumLevels() const {
+    return num_levels_;
+  }
+
+  /**
+   * @param level pyramid level, with 0 being the finest
+   * @return the width of the given level
+   */
+  __host__ __device__ inline SizeType LevelWidth(unsigned int level) const {
+    return internal::MipmapLevelSize(width_, level);
+  }
+
+  /**
+   * @param level pyramid level, with 0 being the finest
+   * @return the height of the given level
+   */
+  __host__ __device__ inline SizeType LevelHeight(unsigned int level) const {
+    return internal::MipmapLevelSize(height_, level);
+  }
+
+  /**
+   * @return the underlying cudaMipmappedArray object for this texture
+   */
+  inline cudaMipmappedArray_t MipmappedArray() const {
+    return shared_texture_.MipmappedArray();
+  }
+
+  /**
+   * @param level pyramid level, with 0 being the finest
+   * @return the cudaArray of the given level, which is owned by the mipmapped
+   *   array
+   */
+  inline cudaArray *LevelArray(unsigned int level) const {
+    return shared_texture_.LevelArray(level);
+  }
+
+  /**
+   * @return trivially copyable view of the array for kernel parameter lists
+   */
+  __host__ __device__ inline CudaMipmappedTexture2DDeviceView<T> DeviceView()
+      const {
+    return CudaMipmappedTexture2DDeviceView<T>(shared_texture_.TextureObject(),
+                                               width_, height_);
+  }
+
+  //----------------------------------------------------------------------------
+  // private class methods and fields
+
+ private:
+  void CheckLevel_(unsigned int level) const;
+
+  unsigned int num_levels_;
+  CudaSharedMipmappedTextureObject<T> shared_texture_;
+};
+
+//------------------------------------------------------------------------------
+// template typedef for CRTP model, a la Eigen
+
+template <typename T>
+struct CudaArrayTraits<CudaMipmappedTexture2D<T>> {
+  typedef T Scalar;
+  typedef CudaMipmappedTexture2DDeviceView<T> DeviceView;
+};
+
+//------------------------------------------------------------------------------
+//
+// public method implementations
+//
+//------------------------------------------------------------------------------
+
+template <typename T>
+CudaMipmappedTexture2D<T>::CudaMipmappedTexture2D<T>(
+    SizeType width, SizeType height, int device, const unsigned int num_levels,
+    const cudaTextureFilterMode filter_mode,
+    const cudaTextureAddressMode address_mode,
+    const cudaTextureReadMode read_mode,
+    const cudaTextureFilterMode mipmap_filter_mode, const dim3 block_dim,
+    const cudaStream_t stream)
+    : Base(width, height, device, block_dim, stream),
+      num_levels_(internal::CheckedMipmapLevels(num_levels, width, height)),
+      shared_texture_(width, height, 1, num_levels_, false, filter_mode,
+                      address_mode, read_mode, mipmap_filter_mode) {}
+
+//------------------------------------------------------------------------------
+
+// host- and device-level copy constructor
+template <typename T>
+__host__ __device__ CudaMipmappedTexture2D<T>::CudaMipmappedTexture2D<T>(
+    const CudaMipmappedTexture2D<T> &other)
+    : Base(other),
+      num_levels_(other.num_levels_),
+      shared_texture_(other.shared_texture_) {}
+
+//------------------------------------------------------------------------------
+
+// host-level move constructor
+template <typename T>
+CudaMipmappedTexture2D<T>::CudaMipmappedTexture2D<T>(
+    CudaMipmappedTexture2D<T> &&other)
+    : Base(other),
+      num_levels_(other.num_levels_),
+      shared_texture_(std::move(other.shared_texture_)) {}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaMipmappedTexture2D<T> &CudaMipmappedTexture2D<T>::operator=(
+    const CudaMipmappedTexture2D<T> &other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  Base::operator=(other);
+
+  num_levels_ = other.num_levels_;
+  shared_texture_ = other.shared_texture_;
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaMipmappedTexture2D<T> &CudaMipmappedTexture2D<T>::operator=(
+    CudaMipmappedTexture2D<T> &&other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  Base::operator=(other);
+
+  num_levels_ = other.num_levels_;
+  shared_texture_ = std::move(other.shared_texture_);
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaMipmappedTexture2D<T> &CudaMipmappedTexture2D<T>::operator=(
+    const T *host_array) {
+  AssignLevel(0, host_array);
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaMipmappedTexture2D<T>::CopyTo(T *host_array) const {
+  CopyLevelTo(0, host_array);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaMipmappedTexture2D<T>::AssignLevel(unsigned int level,
+                                                   const T *host_array) {
+  internal::CheckNotNull(host_array);
+  CheckLevel_(level);
+  const SizeType width_in_bytes = LevelWidth(level) * sizeof(T);
+  const SizeType height = LevelHeight(level);
+  LIBCUA_INSTRUMENT("CudaMipmappedTexture2D::Upload",
+                    2 * width_in_bytes * height, device_, stream_, false);
+  cudaArray *level_array = LevelArray(level);
+  internal::SetDevice(device_);
+  StagingBufferPool<>::Instance().Upload(
+      host_array, width_in_bytes, height, stream_,
+      [&](const void *src, size_t y, size_t num_rows, cudaStream_t stream) {
+        cudaMemcpy2DToArrayAsync(level_array, 0, y, src, width_in_bytes,
+                                 width_in_bytes, num_rows,
+                                 cudaMemcpyHostToDevice, stream);
+      });
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaMipmappedTexture2D<T>::CopyLevelTo(unsigned int level,
+                                                   T *host_array) const {
+  internal::CheckNotNull(host_array);
+  CheckLevel_(level);
+  const SizeType width_in_bytes = LevelWidth(level) * sizeof(T);
+  const SizeType height = LevelHeight(level);
+  LIBCUA_INSTRUMENT("CudaMipmappedTexture2D::Download",
+                    2 * width_in_bytes * height, device_, stream_, false);
+  cudaArray *level_array = LevelArray(level);
+  internal::SetDevice(device_);
+  StagingBufferPool<>::Instance().Download(
+      host_array, width_in_bytes, height, stream_,
+      [&](void *dst, size_t y, size_t num_rows, cudaStream_t stream) {
+        cudaMemcpy2DFromArrayAsync(dst, width_in_bytes, level_array, 0, y,
+                                   width_in_bytes, num_rows,
+                                   cudaMemcpyDeviceToHost, stream);
+      });
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaMipmappedTexture2D<T>::GenerateMipmaps(
+    const MipmapFilter filter) {
+  size_t num_bytes = 0;
+  for (unsigned int level = 1; level < num_levels_; ++level) {
+    num_bytes += sizeof(T) * (LevelWidth(level - 1) * LevelHeight(level - 1) +
+                              LevelWidth(level) * LevelHeight(level));
+  }
+  LIBCUA_INSTRUMENT("CudaMipmappedTexture2D::GenerateMipmaps", num_bytes,
+                    device_, stream_, false);
+
+  internal::SetDevice(device_);
+
+  // the levels are read and written through the texture's cached surface
+  // objects, which live as long as the levels themselves
+  for (unsigned int level = 1; level < num_levels_; ++level) {
+    const CudaSurface2DDeviceView<T> src(
+        shared_texture_.LevelSurface(level - 1), LevelWidth(level - 1),
+        LevelHeight(level - 1), 0, 0, cudaBoundaryModeZero);
+    const CudaSurface2DDeviceView<T> dst(
+        shared_texture_.LevelSurface(level), LevelWidth(level),
+        LevelHeight(level), 0, 0, cudaBoundaryModeZero);
+    const dim3 grid_dim((dst.Width() + block_dim_.x - 1) / block_dim_.x,
+                        (dst.Height() + block_dim_.y - 1) / block_dim_.y);
+    kernel::MipmapDownsample2D<<<grid_dim, block_dim_, 0, stream_>>>(src, dst,
+                                                                     filter);
+  }
+}
+
+//------------------------------------------------------------------------------
+//
+// private method implementations
+//
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaMipmappedTexture2D<T>::CheckLevel_(unsigned int level) const {
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (level >= num_levels_) {
+    throw std::runtime_error("Invalid mipmap level " + std::to_string(level) +
+                             " (the texture has " +
+                             std::to_string(num_levels_) + " levels).");
+  }
+#endif
+}
+
+}  // namespace cua
+
+#endif  // LIBCUA_CUDA_MIPMAPPED_TEXTURE2D_H_
@@ -0,0 +1,612 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_CUDA_MIPMAPPED_TEXTURE3D_H_
+#define LIBCUA_CUDA_MIPMAPPED_TEXTURE3D_H_
+
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "cudaArray3DBase.h"
+#include "cudaSharedArrayObject.h"
+
+#include "cudaArray_fwd.h"
+#include "deviceView.h"
+#include "mipmap.h"
+#include "stagingBufferPool.h"
+#include "util.h"
+
+namespace cua {
+
+/**
+ * @class CudaMipmappedTexture3D
+ * @brief Mipmapped texture-memory 3D array.
+ *
+ * This is the 3D counterpart of CudaMipmappedTexture2D: each level of the
+ * pyramid is half the size of the previous one along all three axes, level 0
+ * has the extents returned by Width(), Height(), and Depth(), and the coarser
+ * levels are filled with AssignLevel() or GenerateMipmaps(). In device code,
+ * lod() and grad() sample the pyramid with coordinates given in elements of
+ * level 0.
+ *
+ * The array is read-only on the device, and copy for CudaMipmappedTexture3D
+ * objects is a shallow operation. To access the array in your own kernels,
+ * pass its DeviceView() as the kernel parameter:
+ *
+ *     __global__ void device_kernel(
+ *         const CudaMipmappedTexture3DDeviceView<float> in,
+ *         CudaSurface3DDeviceView<float, std::false_type> out,
+ *         const float level) {
+ *       const int x = blockIdx.x * blockDim.x + threadIdx.x;
+ *       const int y = blockIdx.y * blockDim.y + threadIdx.y;
+ *       const int z = blockIdx.z * blockDim.z + threadIdx.z;
+ *       out.set(x, y, z, in.lod(x + 0.5f, y + 0.5f, z + 0.5f, level));
+ *     }
+ */
+template <typename T>
+class CudaMipmappedTexture3D
+    : public CudaArray3DBase<CudaMipmappedTexture3D<T>> {
+ public:
+  friend class CudaArray3DBase<CudaMipmappedTexture3D<T>>;
+
+  /// datatype of the array
+  typedef T Scalar;
+
+  typedef CudaArray3DBase<CudaMipmappedTexture3D<T>> Base;
+  typedef typename Base::SizeType SizeType;
+  typedef typename Base::IndexType IndexType;
+
+ protected:
+  // for convenience, reference base class members directly (they are otherwise
+  // not in the current scope because CudaArray3DBase is templated)
+  using Base::width_;
+  using Base::height_;
+  using Base::depth_;
+  using Base::block_dim_;
+  using Base::grid_dim_;
+  using Base::device_;
+  using Base::stream_;
+
+ public:
+  //----------------------------------------------------------------------------
+  // constructors and destructor
+
+  /**
+   * Constructor for a full pyramid, down to a 1x1x1 level.
+   * @param width number of elements in the first dimension of level 0
+   * @param height number of elements in the second dimension of level 0
+   * @param depth number of elements in the third dimension of level 0
+   * @param filter_mode use cudaFilterModeLinear to allow for interpolation
+   *   within a level
+   * @param address_mode specifies how to read values outside of 3D extent of
+   *   the texture
+   * @param read_mode can also optionally specify this as
+   *   cudaReadModeNormalizedFloat
+   * @param mipmap_filter_mode use cudaFilterModeLinear to allow for
+   *   interpolation between levels
+   * @param block_dim default block size for CUDA kernel calls involving this
+   *   object, i.e., the values for blockDim.x/y/z; note that the default grid
+   *   dimension is computed automatically based on the array size
+   * @param stream CUDA stream for this array object
+   */
+  CudaMipmappedTexture3D(
+      SizeType width, SizeType height, SizeType depth,
+      const cudaTextureFilterMode filter_mode = cudaFilterModePoint,
+      const cudaTextureAddressMode address_mode = cudaAddressModeClamp,
+      const cudaTextureReadMode read_mode = cudaReadModeElementType,
+      const cudaTextureFilterMode mipmap_filter_mode = cudaFilterModePoint,
+      const dim3 block_dim = CudaMipmappedTexture3D<T>::kBlockDim,
+      const cudaStream_t stream = 0)  // default stream
+      : CudaMipmappedTexture3D(width, height, depth, internal::GetDevice(), 0,
+                               filter_mode, address_mode, read_mode,
+                               mipmap_filter_mode, block_dim, stream) {}
+
+  /**
+   * Constructor.
+   * @param width number of elements in the first dimension of level 0
+   * @param height number of elements in the second dimension of level 0
+   * @param depth number of elements in the third dimension of level 0
+   * @param device GPU on which this array is stored, or -1 for the current GPU
+   * @param num_levels number of levels in the pyramid, including level 0, or
+   *   zero for a full pyramid
+   * @param filter_mode use cudaFilterModeLinear to allow for interpolation
+   *   within a level
+   * @param address_mode specifies how to read values outside of 3D extent of
+   *   the texture
+   * @param read_mode can also optionally specify this as
+   *   cudaReadModeNormalizedFloat
+   * @param mipmap_filter_mode use cudaFilterModeLinear to allow for
+   *   interpolation between levels
+   * @param block_dim default block size for CUDA kernel calls involving this
+   *   object, i.e., the values for blockDim.x/y/z; note that the default grid
+   *   dimension is computed automatically based on the array size
+   * @param stream CUDA stream for this array object
+   */
+  CudaMipmappedTexture3D(
+      SizeType width, SizeType height, SizeType depth, int device,
+      const unsigned int num_levels = 0,
+      const cudaTextureFilterMode filter_mode = cudaFilterModePoint,
+      const cudaTextureAddressMode address_mode = cudaAddressModeClamp,
+      const cudaTextureReadMode read_mode = cudaReadModeElementType,
+      const cudaTextureFilterMode mipmap_filter_mode = cudaFilterModePoint,
+      const dim3 block_dim = CudaMipmappedTexture3D<T>::kBlockDim,
+      const cudaStream_t stream = 0);  // default stream
+
+  /**
+   * Host and device-level copy constructor. This is a shallow-copy operation,
+   * meaning that the underlying CUDA memory is the same for both arrays.
+   */
+  __host__ __device__
+  CudaMipmappedTexture3D(const CudaMipmappedTexture3D<T> &other);
+
+  /**
+   * Host-level move constructor. The underlying CUDA memory is handed over to
+   * the new array without updating its reference count, and other is left
+   * empty.
+   */
+  CudaMipmappedTexture3D(CudaMipmappedTexture3D<T> &&other);
+
+  ~CudaMipmappedTexture3D() {}
+
+  //----------------------------------------------------------------------------
+  // array operations
+
+  /**
+   * Shallow re-assignment of the given array to share the contents of another.
+   * @param other a separate array whose contents will now also be referenced by
+   *   the current array
+   * @return *this
+   */
+  CudaMipmappedTexture3D<T> &operator=(const CudaMipmappedTexture3D<T> &other);
+
+  /**
+   * Move assignment; as for the move constructor, other is left empty.
+   * @param other array whose contents will be referenced by the current array
+   * @return *this
+   */
+  CudaMipmappedTexture3D<T> &operator=(CudaMipmappedTexture3D<T> &&other);
+
+  /**
+   * Copy the contents of a CPU-bound memory array to level 0. This function
+   * assumes that the CPU array has the correct size! The other levels are not
+   * updated; see GenerateMipmaps().
+   * @param host_array the CPU-bound array
+   * @return *this
+   */
+  CudaMipmappedTexture3D<T> &operator=(const T *host_array);
+
+  // copies into other arrays (see CudaArray3DBase)
+  using Base::CopyTo;
+
+  /**
+   * Copy the contents of level 0 to a CPU-bound memory array. This function
+   * assumes that the CPU array has the correct size!
+   * @param host_array the CPU-bound array
+   */
+  void CopyTo(T *host_array) const;
+
+  /**
+   * Copy the contents of a CPU-bound memory array to one level of the pyramid.
+   * This function assumes that the CPU array has the correct size, i.e.,
+   * LevelWidth(level) x LevelHeight(level) x LevelDepth(level)!
+   * @param level pyramid level, with 0 being the finest
+   * @param host_array the CPU-bound array
+   */
+  void AssignLevel(unsigned int level, const T *host_array);
+
+  /**
+   * Copy the contents of one level of the pyramid to a CPU-bound memory array.
+   * This function assumes that the CPU array has the correct size, i.e.,
+   * LevelWidth(level) x LevelHeight(level) x LevelDepth(level)!
+   * @param level pyramid level, with 0 being the finest
+   * @param host_array the CPU-bound array
+   */
+  void CopyLevelTo(unsigned int level, T *host_array) const;
+
+  /**
+   * Compute levels 1 through NumLevels() - 1 from level 0 on the device; see
+   * CudaMipmappedTexture2D::GenerateMipmaps(). host::MipmapDownsample3D() is
+   * the CPU reference for the kernels. Like the other array operations, this
+   * function is asynchronous with respect to the host.
+   * @param filter downsampling filter; see MipmapFilter
+   */
+  void GenerateMipmaps(const MipmapFilter filter = MipmapFilter::kBox);
+
+  //----------------------------------------------------------------------------
+  // getters
+
+  /**
+   * Device-level function for getting a pixel value of level 0. Note, if you
+   * use cudaReadModeNormalizedFloat as the texture read mode, you'll need to
+   * specify the appropriate return type (i.e., float) in the template argument.
+   * @param x first coordinate
+   * @param y second coordinate
+   * @param z third coordinate
+   * @return the value at array(x, y, z)
+   */
+  template <typename ReturnType = T>
+  __device__ inline ReturnType get(const int x, const int y,
+                                   const int z) const {
+    return DeviceView().template get<ReturnType>(x, y, z);
+  }
+
+  /**
+   * Device-level function for getting an interpolated pixel value of level 0,
+   * which is enabled by specifying filter_mode as cudaFilterModeLinear in the
+   * constructor.
+   * @param x first coordinate
+   * @param y second coordinate
+   * @param z third coordinate
+   * @return the interpolated value at array(x, y, z)
+   */
+  template <typename ReturnType = T>
+  __device__ inline ReturnType interp(const float x, const float y,
+                                      const float z) const {
+    return DeviceView().template interp<ReturnType>(x, y, z);
+  }
+
+  /**
+   * Device-level function for sampling the pyramid at an explicit level of
+   * detail. Fractional levels blend two levels if mipmap_filter_mode is
+   * cudaFilterModeLinear.
+   * @param x first coordinate, in elements of level 0
+   * @param y second coordinate, in elements of level 0
+   * @param z third coordinate, in elements of level 0
+   * @param level level of detail, with 0 being the finest
+   * @return the sampled value
+   */
+  template <typename ReturnType = T>
+  __device__ inline ReturnType lod(const float x, const float y, const float z,
+                                   const float level) const {
+    return DeviceView().template lod<ReturnType>(x, y, z, level);
+  }
+
+  /**
+   * Device-level function for sampling the pyramid at the level of detail
+   * that the texture unit derives from the screen-space derivatives of the
+   * sample position, e.g., the distance between the samples of neighboring
+   * threads.
+   * @param x first coordinate, in elements of level 0
+   * @param y second coordinate, in elements of level 0
+   * @param z third coordinate, in elements of level 0
+   * @param dx derivative of (x, y, z) along the first output axis, in elements
+   *   of level 0; the w component is ignored
+   * @param dy derivative of (x, y, z) along the second output axis, in
+   *   elements of level 0; the w component is ignored
+   * @return the sampled value
+   */
+  template <typename ReturnType = T>
+  __device__ inline ReturnType grad(const float x, const float y, const float z,
+                                    const float4 dx, const float4 dy) const {
+    return DeviceView().template grad<ReturnType>(x, y, z, dx, dy);
+  }
+
+  /**
+   * @return the number of levels in the pyramid, including level 0
+   */
+  __host__ __device__ inline unsigned int NumLevels() const {
+    return num_levels_;
+  }
+
+  /**
+   * @param level pyramid level, with 0 being the finest
+   * @return the width of the given level
+   */
+  __host__ __device__ inline SizeType LevelWidth(unsigned int level) const {
+    return internal::MipmapLevelSize(width_, level);
+  }
+
+  /**
+   * @param level pyramid level, with 0 being the finest
+   * @return the height of the given level
+   */
+  __host__ __device__ inline SizeType LevelHeight(unsigned int level) const {
+    return internal::MipmapLevelSize(height_, level);
+  }
+
+  /**
+   * @param level pyramid level, with 0 being the finest
+   * @return the depth of the given level
+   */
+  __host__ __device__ inline SizeType LevelDepth(unsigned int level) const {
+    return internal::MipmapLevelSize(depth_, level);
+  }
+
+  /**
+   * @return the underlying cudaMipmappedArray object for this texture
+   */
+  inline cudaMipmappedArray_t MipmappedArray() const {
+    return shared_texture_.MipmappedArray();
+  }
+
+  /**
+   * @param level pyramid level, with 0 being the finest
+   * @return the cudaArray of the given level, which is owned by the mipmapped
+   *   array
+   */
+  inline cudaArray *LevelArray(unsigned int level) const {
+    return shared_texture_.LevelArray(level);
+  }
+
+  /**
+   * @return trivially copyable view of the array for kernel parameter lists
+   */
+  __host__ __device__ inline CudaMipmappedTexture3DDeviceView<T> DeviceView()
+      const {
+    return CudaMipmappedTexture3DDeviceView<T>(shared_texture_.TextureObject(),
+                                               width_, height_, depth_);
+  }
+
+  //----------------------------------------------------------------------------
+  // private class methods and fields
+
+ private:
+  void CheckLevel_(unsigned int level) const;
+
+  // number of elements in the given level
+  inline size_t LevelSize_(unsigned int level) const {
+    return static_cast<size_t>(LevelWidth(level)) * LevelHeight(level) *
+           LevelDepth(level);
+  }
+
+  unsigned int num_levels_;
+  CudaSharedMipmappedTextureObject<T> shared_texture_;
+};
+
+//------------------------------------------------------------------------------
+// template typedef for CRTP model, a la Eigen
+
+template <typename T>
+struct CudaArrayTraits<CudaMipmappedTexture3D<T>> {
+  typedef T Scalar;
+  typedef CudaMipmappedTexture3DDeviceView<T> DeviceView;
+};
+
+//------------------------------------------------------------------------------
+//
+// public method implementations
+//
+//------------------------------------------------------------------------------
+
+template <typename T>
+CudaMipmappedTexture3D<T>::CudaMipmappedTexture3D<T>(
+    SizeType width, SizeType height, SizeType depth, int device,
+    const unsigned int num_levels, const cudaTextureFilterMode filter_mode,
+    const cudaTextureAddressMode address_mode,
+    const cudaTextureReadMode read_mode,
+    const cudaTextureFilterMode mipmap_filter_mode, const dim3 block_dim,
+    const cudaStream_t stream)
+    : Base(width, height, depth, device, block_dim, stream),
+      num_levels_(
+          internal::CheckedMipmapLevels(num_levels, width, height, depth)),
+      shared_texture_(width, height, depth, num_levels_, true, filter_mode,
+                      address_mode, read_mode, mipmap_filter_mode) {}
+
+//------------------------------------------------------------------------------
+
+// host- and device-level copy constructor
+template <typename T>
+__host__ __device__ CudaMipmappedTexture3D<T>::CudaMipmappedTexture3D<T>(
+    const CudaMipmappedTexture3D<T> &other)
+    : Base(other),
+      num_levels_(other.num_levels_),
+      shared_texture_(other.shared_texture_) {}
+
+//------------------------------------------------------------------------------
+
+// host-level move constructor
+template <typename T>
+CudaMipmappedTexture3D<T>::CudaMipmappedTexture3D<T>(
+    CudaMipmappedTexture3D<T> &&other)
+    : Base(other),
+      num_levels_(other.num_levels_),
+      shared_texture_(std::move(other.shared_texture_)) {}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaMipmappedTexture3D<T> &CudaMipmappedTexture3D<T>::operator=(
+    const CudaMipmappedTexture3D<T> &other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  Base::operator=(other);
+
+  num_levels_ = other.num_levels_;
+  shared_texture_ = other.shared_texture_;
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaMipmappedTexture3D<T> &CudaMipmappedTexture3D<T>::operator=(
+    CudaMipmappedTexture3D<T> &&other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  Base::operator=(other);
+
+  num_levels_ = other.num_levels_;
+  shared_texture_ = std::move(other.shared_texture_);
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaMipmappedTexture3D<T> &CudaMipmappedTexture3D<T>::operator=(
+    const T *host_array) {
+  AssignLevel(0, host_array);
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaMipmappedTexture3D<T>::CopyTo(T *host_array) const {
+  CopyLevelTo(0, host_array);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaMipmappedTexture3D<T>::AssignLevel(unsigned int level,
+                                                   const T *host_array) {
+  internal::CheckNotNull(host_array);
+  CheckLevel_(level);
+  const SizeType width = LevelWidth(level);
+  const SizeType height = LevelHeight(level);
+  const size_t width_in_bytes = width * sizeof(T);
+  const size_t num_rows_total = static_cast<size_t>(height) * LevelDepth(level);
+  LIBCUA_INSTRUMENT("CudaMipmappedTexture3D::Upload",
+                    2 * width_in_bytes * num_rows_total, device_, stream_,
+                    false);
+  cudaArray *level_array = LevelArray(level);
+  internal::SetDevice(device_);
+  StagingBufferPool<>::Instance().Upload(
+      host_array, width_in_bytes, num_rows_total, stream_,
+      [&](const void *src, size_t first_row, size_t num_rows,
+          cudaStream_t stream) {
+        internal::ForEachSliceRun(
+            first_row, num_rows, height,
+            [&](size_t y, size_t z, size_t n, size_t offset) {
+              cudaMemcpy3DParms params = {0};
+              params.srcPtr = make_cudaPitchedPtr(
+                  const_cast<char *>(reinterpret_cast<const char *>(src)) +
+                      offset * width_in_bytes,
+                  width_in_bytes, width, n);
+              params.dstArray = level_array;
+              params.dstPos = make_cudaPos(0, y, z);
+              params.extent = make_cudaExtent(width, n, 1);
+              params.kind = cudaMemcpyHostToDevice;
+              cudaMemcpy3DAsync(&params, stream);
+            });
+      });
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaMipmappedTexture3D<T>::CopyLevelTo(unsigned int level,
+                                                   T *host_array) const {
+  internal::CheckNotNull(host_array);
+  CheckLevel_(level);
+  const SizeType width = LevelWidth(level);
+  const SizeType height = LevelHeight(level);
+  const size_t width_in_bytes = width * sizeof(T);
+  const size_t num_rows_total = static_cast<size_t>(height) * LevelDepth(level);
+  LIBCUA_INSTRUMENT("CudaMipmappedTexture3D::Download",
+                    2 * width_in_bytes * num_rows_total, device_, stream_,
+                    false);
+  cudaArray *level_array = LevelArray(level);
+  internal::SetDevice(device_);
+  StagingBufferPool<>::Instance().Download(
+      host_array, width_in_bytes, num_rows_total, stream_,
+      [&](void *dst, size_t first_row, size_t num_rows, cudaStream_t stream) {
+        internal::ForEachSliceRun(
+            first_row, num_rows, height,
+            [&](size_t y, size_t z, size_t n, size_t offset) {
+              cudaMemcpy3DParms params = {0};
+              params.srcArray = level_array;
+              params.srcPos = make_cudaPos(0, y, z);
+              params.dstPtr = make_cudaPitchedPtr(
+                  reinterpret_cast<char *>(dst) + offset * width_in_bytes,
+                  width_in_bytes, width, n);
+              params.extent = make_cudaExtent(width, n, 1);
+              params.kind = cudaMemcpyDeviceToHost;
+              cudaMemcpy3DAsync(&params, stream);
+            });
+      });
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaMipmappedTexture3D<T>::GenerateMipmaps(
+    const MipmapFilter filter) {
+  size_t num_bytes = 0;
+  for (unsigned int level = 1; level < num_levels_; ++level) {
+    num_bytes += sizeof(T) * (LevelSize_(level - 1) + LevelSize_(level));
+  }
+  LIBCUA_INSTRUMENT("CudaMipmappedTexture3D::GenerateMipmaps", num_bytes,
+                    device_, stream_, false);
+
+  internal::SetDevice(device_);
+
+  // the levels are read and written through the texture's cached surface
+  // objects, which live as long as the levels themselves
+  for (unsigned int level = 1; level < num_levels_; ++level) {
+    const CudaSurface3DDeviceView<T, std::false_type> src(
+        shared_texture_.LevelSurface(level - 1), LevelWidth(level - 1),
+        LevelHeight(level - 1), LevelDepth(level - 1), 0, 0, 0,
+        cudaBoundaryModeZero);
+    const CudaSurface3DDeviceView<T, std::false_type> dst(
+        shared_texture_.LevelSurface(level), LevelWidth(level),
+        LevelHeight(level), LevelDepth(level), 0, 0, 0, cudaBoundaryModeZero);
+    const dim3 grid_dim((dst.Width() + block_dim_.x - 1) / block_dim_.x,
+                        (dst.Height() + block_dim_.y - 1) / block_dim_.y,
+                        (dst.Depth() + block_dim_.z - 1) / block_dim_.z);
+    kernel::MipmapDownsample3D<<<grid_dim, block_dim_, 0, stream_>>>(src, dst,
+                                                                     filter);
+  }
+}
+
+//------------------------------------------------------------------------------
+//
+// private method implementations
+//
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaMipmappedTexture3D<T>::CheckLevel_(unsigned int level) const {
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (level >= num_levels_) {
+    throw std::runtime_error("Invalid mipmap level " + std::to_string(level) +
+                             " (the texture has " +
+                             std::to_string(num_levels_) + " levels).");
+  }
+#endif
+}
+
+}  // namespace cua
+
+#endif  // LIBCUA_CUDA_MIPMAPPED_TEXTURE3D_H_
@@ -0,0 +1,351 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef LIBCUA_CUDA_PITCHED_TEXTURE2D_H_
+#define LIBCUA_CUDA_PITCHED_TEXTURE2D_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "cudaArray2D.h"
+#include "cudaArray2DBase.h"
+#include "cudaEvent.h"
+#include "cudaSharedArrayObject.h"
+#include "deviceView.h"
+#include "util.h"
+
+namespace cua {
+
+/**
+ * @class CudaPitchedTexture2D
+ * @brief Texture-memory view of the pitched linear memory of a CudaArray2D.
+ *
+ * This class binds a texture object directly to an existing CudaArray2D
+ * allocation (cudaResourceTypePitch2D), so the array can be sampled with
+ * hardware filtering and address modes without first copying it into a
+ * cudaArray, as CudaArray2D::CopyTo(CudaTexture2D<T> *) does. The texture
+ * shares the array's memory, and keeps it alive, for as long as it exists;
+ * writes to the array are visible to any kernel launched after them. Within a
+ * single kernel, however, the texture cache is not kept coherent with writes
+ * to the underlying array.
+ *
+ * The get() and interp() functions and the device view match those of
+ * CudaTexture2D:
+ *
+ *     CudaArray2D<float> image(width, height);
+ *     CudaPitchedTexture2D<float> texture(image, cudaFilterModeLinear);
+ *     device_kernel<<<grid_dim, block_dim>>>(texture.DeviceView(), ...);
+ *
+ * The array's data pointer must satisfy the device's texture alignment
+ * (typically 512 bytes). This is only guaranteed for full arrays: the rows of
+ * a view start at multiples of the pitch, which is aligned to the smaller
+ * texture pitch alignment, so even a view at x = 0 is only usable if its first
+ * row happens to fall on an aligned address. Its pitch must be a multiple of
+ * the device's texture pitch alignment, which holds for arrays from the
+ * allocator but generally not after a non-square
+ * CudaArray2D::TransposeInPlace(), which packs the rows densely. Both are
+ * checked by the constructor. The array's extents must also be within the
+ * device's limits for 2D textures bound to pitched memory.
+ */
+template <typename T>
+class CudaPitchedTexture2D : public CudaArray2DBase<CudaPitchedTexture2D<T>> {
+ public:
+  friend class CudaArray2DBase<CudaPitchedTexture2D<T>>;
+
+  /// datatype of the array
+  typedef T Scalar;
+
+  typedef CudaArray2DBase<CudaPitchedTexture2D<T>> Base;
+  typedef typename Base::SizeType SizeType;
+  typedef typename Base::IndexType IndexType;
+
+ protected:
+  // for convenience, reference base class members directly (they are otherwise
+  // not in the current scope because CudaArray2DBase is templated)
+  using Base::width_;
+  using Base::height_;
+  using Base::block_dim_;
+  using Base::grid_dim_;
+  using Base::device_;
+  using Base::stream_;
+
+ public:
+  //----------------------------------------------------------------------------
+  // constructors and destructor
+
+  /**
+   * Constructor. The texture uses the same size, GPU, block dimension, and
+   * stream as the given array.
+   * @param array linear array whose memory will be read through the texture
+   * @param filter_mode use cudaFilterModeLinear to allow for interpolation
+   * @param address_mode specifies how to read values outside of 2D extent of
+   *   the texture
+   * @param read_mode can also optionally specify this as
+   *   cudaReadModeNormalizedFloat
+   */
+  explicit CudaPitchedTexture2D(
+      const CudaArray2D<T> &array,
+      const cudaTextureFilterMode filter_mode = cudaFilterModePoint,
+      const cudaTextureAddressMode address_mode = cudaAddressModeBorder,
+      const cudaTextureReadMode read_mode = cudaReadModeElementType);
+
+  /**
+   * Host and device-level copy constructor. This is a shallow-copy operation,
+   * meaning that the underlying CUDA memory is the same for both arrays.
+   */
+  __host__ __device__
+  CudaPitchedTexture2D(const CudaPitchedTexture2D<T> &other);
+
+  /**
+   * Host-level move constructor. The texture object is handed over to the new
+   * array without updating its reference count, and other is left empty.
+   */
+  CudaPitchedTexture2D(CudaPitchedTexture2D<T> &&other);
+
+  ~CudaPitchedTexture2D() {}
+
+  //----------------------------------------------------------------------------
+  // array operations
+
+  /**
+   * Shallow re-assignment of the given array to share the contents of another.
+   * @param other a separate array whose contents will now also be referenced by
+   *   the current array
+   * @return *this
+   */
+  CudaPitchedTexture2D<T> &operator=(const CudaPitchedTexture2D<T> &other);
+
+  /**
+   * Move assignment; as for the move constructor, other is left empty.
+   * @param other array whose contents will be referenced by the current array
+   * @return *this
+   */
+  CudaPitchedTexture2D<T> &operator=(CudaPitchedTexture2D<T> &&other);
+
+  // copies into other arrays go through the texture (see CudaArray2DBase)
+  using Base::CopyTo;
+
+  /**
+   * Copy the contents of the current array to a CPU-bound memory array. This
+   * function assumes that the CPU array has the correct size!
+   * @param host_array the CPU-bound array
+   */
+  inline void CopyTo(T *host_array) const { array_.CopyTo(host_array); }
+
+  /**
+   * Asynchronously copy the contents of the current array to a densely packed
+   * CPU array on the array's stream. This function assumes that the CPU array
+   * has the correct size!
+   * @param host_array the CPU-bound array
+   * @return event that completes with the copy
+   */
+  inline CudaEvent CopyToAsync(T *host_array) const {
+    return array_.CopyToAsync(host_array);
+  }
+
+  //----------------------------------------------------------------------------
+  // getters
+
+  /**
+   * Device-level function for getting a texture pixel value. Note, if you use
+   * cudaReadModeNormalizedFloat as the texture read mode, you'll need to
+   * specify the appropriate return type (i.e., float) in the template argument.
+   * @param x first coordinate, i.e., the column index in a row-major array
+   * @param y second coordinate, i.e., the row index in a row-major array
+   * @return the value at array(x, y)
+   */
+  template <typename ReturnType = T>
+  __device__ inline ReturnType get(const int x, const int y) const {
+    return tex2D<ReturnType>(shared_texture_.CudaApiObject(), x + 0.5f,
+                             y + 0.5f);
+  }
+
+  /**
+   * Device-level function for getting an interpolated texture pixel value,
+   * which is enabled by specifying filter_mode as cudaFilterModeLinear in the
+   * constructor. Note, if you use cudaReadModeNormalizedFloat as the texture
+   * read mode, you'll need to specify the appropriate return type (i.e., float)
+   * in the template argument.
+   * @param x first coordinate, i.e., the column index in a row-major array
+   * @param y second coordinate, i.e., the row index in a row-major array
+   * @return the interpolated value at array(x, y)
+   */
+  template <typename ReturnType = T>
+  __device__ inline ReturnType interp(const float x, const float y) const {
+    return tex2D<ReturnType>(shared_texture_.CudaApiObject(), x, y);
+  }
+
+  /**
+   * @return the linear array whose memory backs this texture
+   */
+  inline const CudaArray2D<T> &Array() const { return array_; }
+
+  /**
+   * @return trivially copyable view of the array for kernel parameter lists
+   */
+  __host__ __device__ inline CudaTexture2DDeviceView<T> DeviceView() const {
+    return CudaTexture2DDeviceView<T>(shared_texture_.CudaApiObject(), width_,
+                                      height_);
+  }
+
+ private:
+  // returns the array's data pointer after checking that a texture can be
+  // bound to it
+  static const T *CheckedPtr_(const CudaArray2D<T> &array);
+
+  CudaArray2D<T> array_;  // keeps the underlying memory alive
+  CudaSharedPitchedTextureObject<T> shared_texture_;
+};
+
+//------------------------------------------------------------------------------
+// template typedef for CRTP model, a la Eigen
+
+template <typename T>
+struct CudaArrayTraits<CudaPitchedTexture2D<T>> {
+  typedef T Scalar;
+  typedef CudaTexture2DDeviceView<T> DeviceView;
+};
+
+//------------------------------------------------------------------------------
+//
+// public method implementations
+//
+//------------------------------------------------------------------------------
+
+template <typename T>
+CudaPitchedTexture2D<T>::CudaPitchedTexture2D<T>(
+    const CudaArray2D<T> &array, const cudaTextureFilterMode filter_mode,
+    const cudaTextureAddressMode address_mode,
+    const cudaTextureReadMode read_mode)
+    : Base(array.Width(), array.Height(), array.Device(), array.BlockDim(),
+           array.Stream()),
+      array_(array),
+      shared_texture_(CheckedPtr_(array), array.Pitch(), array.Width(),
+                      array.Height(), filter_mode, address_mode, read_mode) {}
+
+//------------------------------------------------------------------------------
+
+// host- and device-level copy constructor
+template <typename T>
+__host__ __device__ CudaPitchedTexture2D<T>::CudaPitchedTexture2D<T>(
+    const CudaPitchedTexture2D<T> &other)
+    : Base(other),
+      array_(other.array_),
+      shared_texture_(other.shared_texture_) {}
+
+//------------------------------------------------------------------------------
+
+// host-level move constructor
+template <typename T>
+CudaPitchedTexture2D<T>::CudaPitchedTexture2D<T>(
+    CudaPitchedTexture2D<T> &&other)
+    : Base(other),
+      array_(other.array_),
+      shared_texture_(std::move(other.shared_texture_)) {}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaPitchedTexture2D<T> &CudaPitchedTexture2D<T>::operator=(
+    const CudaPitchedTexture2D<T> &other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  Base::operator=(other);
+
+  array_ = other.array_;
+  shared_texture_ = other.shared_texture_;
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaPitchedTexture2D<T> &CudaPitchedTexture2D<T>::operator=(
+    CudaPitchedTexture2D<T> &&other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  Base::operator=(other);
+
+  array_ = other.array_;
+  shared_texture_ = std::move(other.shared_texture_);
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+//
+// private method implementations
+//
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline const T *CudaPitchedTexture2D<T>::CheckedPtr_(
+    const CudaArray2D<T> &array) {
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  int alignment = 0;
+  cudaDeviceGetAttribute(&alignment, cudaDevAttrTextureAlignment,
+                         array.Device());
+  if (alignment > 0 &&
+      reinterpret_cast<uintptr_t>(array.ptr()) % alignment != 0) {
+    throw std::runtime_error(
+        "CudaPitchedTexture2D: array data is not aligned to " +
+        std::to_string(alignment) +
+        " bytes; copy the view into a separate array first.");
+  }
+
+  int pitch_alignment = 0;
+  cudaDeviceGetAttribute(&pitch_alignment, cudaDevAttrTexturePitchAlignment,
+                         array.Device());
+  if (pitch_alignment > 0 && array.Pitch() % pitch_alignment != 0) {
+    throw std::runtime_error(
+        "CudaPitchedTexture2D: array pitch is not a multiple of " +
+        std::to_string(pitch_alignment) +
+        " bytes, e.g., after a non-square TransposeInPlace(); copy the array "
+        "into a separate array first.");
+  }
+#endif
+  return array.ptr();
+}
+
+}  // namespace cua
+
+#endif  // LIBCUA_CUDA_PITCHED_TEXTURE2D_H_
@@ -50,8 +50,8 @@ class CudaRandomStateArray2D;  // forward declaration
 
 namespace kernel {
 
-__global__ void CudaRandomStateArray2DInit(CudaRandomStateArray2D array,
-                                           size_t seed);
+__global__ void CudaRandomStateArray2DInit(
+    CudaArray2DDeviceView<curandState_t> array, size_t seed);
 
 }  // namespace kernel
 
@@ -95,7 +95,8 @@ CudaRandomStateArray2D::CudaRandomStateArray2D(SizeType width, SizeType height,
 CudaRandomStateArray2D::CudaRandomStateArray2D(SizeType width, SizeType height,
                                                int device, size_t seed)
     : CudaArray2D<curandState_t>::CudaArray2D(width, height, device) {
-  kernel::CudaRandomStateArray2DInit<<<grid_dim_, block_dim_>>>(*this, seed);
+  kernel::CudaRandomStateArray2DInit<<<grid_dim_, block_dim_>>>(DeviceView(),
+                                                              seed);
 }
 
 //------------------------------------------------------------------------------
@@ -109,8 +110,8 @@ namespace kernel {
 //
 // initialize an array of random generators
 //
-__global__ void CudaRandomStateArray2DInit(CudaRandomStateArray2D array,
-                                           size_t seed) {
+__global__ void CudaRandomStateArray2DInit(
+    CudaArray2DDeviceView<curandState_t> array, size_t seed) {
   const CudaRandomStateArray2D::IndexType x =
       blockIdx.x * blockDim.x + threadIdx.x;
   const CudaRandomStateArray2D::IndexType y =
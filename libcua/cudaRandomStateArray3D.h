@@ -50,8 +50,8 @@ class CudaRandomStateArray3D;  // forward declaration
 
 namespace kernel {
 
-__global__ void CudaRandomStateArray3DInit(CudaRandomStateArray3D array,
-                                           size_t seed);
+__global__ void CudaRandomStateArray3DInit(
+    CudaArray3DDeviceView<curandState_t> array, size_t seed);
 
 }  // namespace kernel
 
@@ -99,7 +99,8 @@ CudaRandomStateArray3D::CudaRandomStateArray3D(SizeType width, SizeType height,
                                                SizeType depth, int device,
                                                size_t seed)
     : CudaArray3D<curandState_t>::CudaArray3D(width, height, depth, device) {
-  kernel::CudaRandomStateArray3DInit<<<grid_dim_, block_dim_>>>(*this, seed);
+  kernel::CudaRandomStateArray3DInit<<<grid_dim_, block_dim_>>>(DeviceView(),
+                                                              seed);
 }
 
 //------------------------------------------------------------------------------
@@ -113,8 +114,8 @@ namespace kernel {
 //
 // initialize an array of random generators
 //
-__global__ void CudaRandomStateArray3DInit(CudaRandomStateArray3D array,
-                                           size_t seed) {
+__global__ void CudaRandomStateArray3DInit(
+    CudaArray3DDeviceView<curandState_t> array, size_t seed) {
   const CudaRandomStateArray3D::IndexType x =
       blockIdx.x * blockDim.x + threadIdx.x;
   const CudaRandomStateArray3D::IndexType y =
@@ -36,7 +36,8 @@
 #ifndef LIBCUA_CUDA_SHARED_ARRAY_OBJECT_H_
 #define LIBCUA_CUDA_SHARED_ARRAY_OBJECT_H_
 
-#include <memory>
+#include <atomic>
+#include <vector>
 
 namespace cua {
 
@@ -48,6 +49,13 @@ namespace cua {
  * CUDA_API_ObjType: cudaTextureObject_t or cudaSurfaceObject_t
  * CUDA_API_DestroyObj: function for destroying an object of type
  *   CUDA_API_ObjType
+ *
+ * All instances that share a CUDA object hold a pointer to one heap-allocated
+ * atomic reference count, and the last instance to be destroyed releases the
+ * object. Copies may be created and destroyed concurrently from any number of
+ * host threads. Moving an instance transfers its reference without touching
+ * the count; the moved-from instance is left empty. Device-side copies (e.g.,
+ * in kernel parameters) do not take part in reference counting.
  */
 template <typename T, typename CUDA_API_ObjType,
           cudaError_t CUDA_API_DestroyObj(CUDA_API_ObjType)>
@@ -55,7 +63,10 @@ class CudaSharedArrayObject {
  public:
   //----------------------------------------------------------------------------
 
-  CudaSharedArrayObject() : count(std::shared_ptr<int>(new int(1))) {}
+  CudaSharedArrayObject()
+      : dev_array(nullptr),
+        cuda_api_obj(),
+        count(new std::atomic<int>(1)) {}
 
   //------------------------------------------------------------------------------
 
@@ -66,12 +77,21 @@ class CudaSharedArrayObject {
 #ifdef __CUDA_ARCH__
 #else
     count = other.count;
-    ++(*count);
+    increment_();
 #endif
   }
 
   //------------------------------------------------------------------------------
 
+  CudaSharedArrayObject(CudaSharedArrayObject &&other) noexcept
+      : dev_array(other.dev_array),
+        cuda_api_obj(other.cuda_api_obj),
+        count(other.count) {
+    other.release_();
+  }
+
+  //------------------------------------------------------------------------------
+
   ~CudaSharedArrayObject() {  // host function only
     decrement_();
   }
@@ -79,12 +99,38 @@ class CudaSharedArrayObject {
   //------------------------------------------------------------------------------
 
   CudaSharedArrayObject &operator=(const CudaSharedArrayObject &other) {
+    if (this == &other) {
+      return *this;
+    }
+
+    // take the new reference before dropping the old one, in case both refer
+    // to the same object
+    std::atomic<int> *other_count = other.count;
+    if (other_count != nullptr) {
+      other_count->fetch_add(1, std::memory_order_relaxed);
+    }
+    decrement_();
+
+    dev_array = other.dev_array;
+    cuda_api_obj = other.cuda_api_obj;
+    count = other_count;
+
+    return *this;
+  }
+
+  //------------------------------------------------------------------------------
+
+  CudaSharedArrayObject &operator=(CudaSharedArrayObject &&other) noexcept {
+    if (this == &other) {
+      return *this;
+    }
+
     decrement_();
 
     dev_array = other.dev_array;
     cuda_api_obj = other.cuda_api_obj;
     count = other.count;
-    ++(*count);
+    other.release_();
 
     return *this;
   }
@@ -95,25 +141,55 @@ class CudaSharedArrayObject {
 
   //------------------------------------------------------------------------------
 
-  __device__ inline const CUDA_API_ObjType &CudaApiObject() const {
+  __host__ __device__ inline const CUDA_API_ObjType &CudaApiObject() const {
     return cuda_api_obj;
   }
 
   //------------------------------------------------------------------------------
 
+  /**
+   * @return the number of host instances sharing the CUDA object, or zero for
+   *   an empty (moved-from) instance
+   */
+  inline int UseCount() const {
+    return (count != nullptr) ? count->load(std::memory_order_relaxed) : 0;
+  }
+
+  //------------------------------------------------------------------------------
+
  protected:
+  inline void increment_() {
+    if (count != nullptr) {
+      count->fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  // drop this instance's reference; the acquire/release ordering makes all
+  // prior uses of the object by other threads happen before its destruction
   inline void decrement_() {
-    if (--(*count) == 0) {
+    if (count != nullptr &&
+        count->fetch_sub(1, std::memory_order_acq_rel) == 1) {
       CUDA_API_DestroyObj(cuda_api_obj);
-      cudaFreeArray(dev_array);
+      if (dev_array != nullptr) {
+        cudaFreeArray(dev_array);
+      }
+      delete count;
     }
+    count = nullptr;
+  }
+
+  // leave this instance empty without touching the reference count
+  inline void release_() {
+    dev_array = nullptr;
+    cuda_api_obj = CUDA_API_ObjType();
+    count = nullptr;
   }
 
   //------------------------------------------------------------------------------
 
   cudaArray *dev_array;
   CUDA_API_ObjType cuda_api_obj;
-  std::shared_ptr<int> count;  // monitor the number of instances
+  std::atomic<int> *count;  // shared by all instances; null if empty
 };
 
 //------------------------------------------------------------------------------
@@ -156,8 +232,6 @@ class CudaSharedSurfaceObject
 
     cudaCreateSurfaceObject(&this->cuda_api_obj, &res_desc);
   }
-
-  ~CudaSharedSurfaceObject() {}
 };
 
 //------------------------------------------------------------------------------
@@ -211,6 +285,268 @@ class CudaSharedTextureObject
   }
 };
 
+//------------------------------------------------------------------------------
+
+// shared texture bound to existing pitched linear memory; the memory itself is
+// owned elsewhere, so only the texture object is released by the last instance
+template <typename T>
+class CudaSharedPitchedTextureObject
+    : public CudaSharedArrayObject<T, cudaTextureObject_t,
+                                   cudaDestroyTextureObject> {
+ public:
+  CudaSharedPitchedTextureObject(
+      const T *dev_ptr, const size_t pitch, const size_t width,
+      const size_t height,
+      const cudaTextureFilterMode filterMode = cudaFilterModePoint,
+      const cudaTextureAddressMode addressMode = cudaAddressModeBorder,
+      const cudaTextureReadMode readMode = cudaReadModeElementType)
+      : CudaSharedArrayObject<T, cudaTextureObject_t,
+                              cudaDestroyTextureObject>() {
+    cudaResourceDesc res_desc;
+    memset(&res_desc, 0, sizeof(res_desc));
+    res_desc.resType = cudaResourceTypePitch2D;
+    res_desc.res.pitch2D.devPtr = const_cast<T *>(dev_ptr);
+    res_desc.res.pitch2D.desc = cudaCreateChannelDesc<T>();
+    res_desc.res.pitch2D.width = width;
+    res_desc.res.pitch2D.height = height;
+    res_desc.res.pitch2D.pitchInBytes = pitch;
+
+    cudaTextureDesc texDesc;
+    memset(&texDesc, 0, sizeof(texDesc));
+    texDesc.addressMode[0] = addressMode;
+    texDesc.addressMode[1] = addressMode;
+    texDesc.filterMode = filterMode;
+    texDesc.readMode = readMode;
+
+    cudaCreateTextureObject(&this->cuda_api_obj, &res_desc, &texDesc, nullptr);
+  }
+};
+
+//------------------------------------------------------------------------------
+
+// shared texture over a cudaArray that is owned by another shared object; only
+// the texture object is released by the last instance
+template <typename T>
+class CudaSharedAliasedTextureObject
+    : public CudaSharedArrayObject<T, cudaTextureObject_t,
+                                   cudaDestroyTextureObject> {
+ public:
+  // is_3d: if true, the array is a (non-layered) 3D array
+  CudaSharedAliasedTextureObject(
+      cudaArray *array, const bool is_3d = false,
+      const cudaTextureFilterMode filterMode = cudaFilterModePoint,
+      const cudaTextureAddressMode addressMode = cudaAddressModeBorder,
+      const cudaTextureReadMode readMode = cudaReadModeElementType)
+      : CudaSharedArrayObject<T, cudaTextureObject_t,
+                              cudaDestroyTextureObject>() {
+    cudaResourceDesc res_desc;
+    memset(&res_desc, 0, sizeof(res_desc));
+    res_desc.resType = cudaResourceTypeArray;
+    res_desc.res.array.array = array;
+
+    cudaTextureDesc texDesc;
+    memset(&texDesc, 0, sizeof(texDesc));
+    texDesc.addressMode[0] = addressMode;
+    texDesc.addressMode[1] = addressMode;
+    if (is_3d) {
+      texDesc.addressMode[2] = addressMode;
+    }
+    texDesc.filterMode = filterMode;
+    texDesc.readMode = readMode;
+
+    cudaCreateTextureObject(&this->cuda_api_obj, &res_desc, &texDesc, nullptr);
+  }
+
+  // texture over all levels of a mipmapped array, which is sampled with
+  // normalized coordinates
+  CudaSharedAliasedTextureObject(
+      cudaMipmappedArray_t array, const bool is_3d,
+      const unsigned int num_levels,
+      const cudaTextureFilterMode filterMode = cudaFilterModePoint,
+      const cudaTextureAddressMode addressMode = cudaAddressModeBorder,
+      const cudaTextureReadMode readMode = cudaReadModeElementType,
+      const cudaTextureFilterMode mipmapFilterMode = cudaFilterModePoint)
+      : CudaSharedArrayObject<T, cudaTextureObject_t,
+                              cudaDestroyTextureObject>() {
+    cudaResourceDesc res_desc;
+    memset(&res_desc, 0, sizeof(res_desc));
+    res_desc.resType = cudaResourceTypeMipmappedArray;
+    res_desc.res.mipmap.mipmap = array;
+
+    cudaTextureDesc texDesc;
+    memset(&texDesc, 0, sizeof(texDesc));
+    texDesc.addressMode[0] = addressMode;
+    texDesc.addressMode[1] = addressMode;
+    if (is_3d) {
+      texDesc.addressMode[2] = addressMode;
+    }
+    texDesc.filterMode = filterMode;
+    texDesc.readMode = readMode;
+    texDesc.normalizedCoords = 1;
+    texDesc.mipmapFilterMode = mipmapFilterMode;
+    texDesc.minMipmapLevelClamp = 0.f;
+    texDesc.maxMipmapLevelClamp = static_cast<float>(num_levels - 1);
+
+    cudaCreateTextureObject(&this->cuda_api_obj, &res_desc, &texDesc, nullptr);
+  }
+};
+
+//------------------------------------------------------------------------------
+
+// shared mipmapped array; its levels are allocated with surface load/store
+// support, so that they can be generated on the device
+template <typename T>
+class CudaSharedMipmappedArrayObject
+    : public CudaSharedArrayObject<T, cudaMipmappedArray_t,
+                                   cudaFreeMipmappedArray> {
+ public:
+  // is_3d: if true, creates a 3D array, rather than a 2D array
+  CudaSharedMipmappedArrayObject(const size_t width, const size_t height,
+                                 const size_t depth,
+                                 const unsigned int num_levels,
+                                 const bool is_3d = false)
+      : CudaSharedArrayObject<T, cudaMipmappedArray_t,
+                              cudaFreeMipmappedArray>() {
+    cudaChannelFormatDesc channel_desc = cudaCreateChannelDesc<T>();
+    const cudaExtent dims = make_cudaExtent(width, height, is_3d ? depth : 0);
+    cudaMallocMipmappedArray(&this->cuda_api_obj, &channel_desc, dims,
+                             num_levels, cudaArraySurfaceLoadStore);
+  }
+
+  // the cudaArray of a single level; it is owned by the mipmapped array
+  inline cudaArray *LevelArray(const unsigned int level) const {
+    cudaArray_t level_array = nullptr;
+    cudaGetMipmappedArrayLevel(&level_array, this->cuda_api_obj, level);
+    return level_array;
+  }
+};
+
+//------------------------------------------------------------------------------
+
+namespace internal {
+
+// destroys a set of surface objects; see CudaSharedLevelSurfaceObjects
+inline cudaError_t DestroySurfaceObjects(
+    std::vector<cudaSurfaceObject_t> *surfaces) {
+  for (const cudaSurfaceObject_t surface : *surfaces) {
+    cudaDestroySurfaceObject(surface);
+  }
+  delete surfaces;
+  return cudaSuccess;
+}
+
+}  // namespace internal
+
+// shared surface objects over every level of a mipmapped array that is owned
+// by another shared object, for writing the levels on the device; only the
+// surface objects are released by the last instance
+template <typename T>
+class CudaSharedLevelSurfaceObjects
+    : public CudaSharedArrayObject<T, std::vector<cudaSurfaceObject_t> *,
+                                   internal::DestroySurfaceObjects> {
+ public:
+  CudaSharedLevelSurfaceObjects(const CudaSharedMipmappedArrayObject<T> &array,
+                                const unsigned int num_levels)
+      : CudaSharedArrayObject<T, std::vector<cudaSurfaceObject_t> *,
+                              internal::DestroySurfaceObjects>() {
+    this->cuda_api_obj = new std::vector<cudaSurfaceObject_t>(num_levels);
+    for (unsigned int level = 0; level < num_levels; ++level) {
+      cudaResourceDesc res_desc;
+      memset(&res_desc, 0, sizeof(res_desc));
+      res_desc.resType = cudaResourceTypeArray;
+      res_desc.res.array.array = array.LevelArray(level);
+      cudaCreateSurfaceObject(&(*this->cuda_api_obj)[level], &res_desc);
+    }
+  }
+
+  inline cudaSurfaceObject_t LevelSurface(const unsigned int level) const {
+    return (*this->cuda_api_obj)[level];
+  }
+};
+
+//------------------------------------------------------------------------------
+
+// shared mipmapped array, a texture object over all of its levels, and a
+// surface object per level; as for CudaSharedSurfaceTextureObject, the texture
+// and surfaces are released before the array
+template <typename T>
+class CudaSharedMipmappedTextureObject {
+ public:
+  CudaSharedMipmappedTextureObject(
+      const size_t width, const size_t height, const size_t depth,
+      const unsigned int num_levels, const bool is_3d = false,
+      const cudaTextureFilterMode filterMode = cudaFilterModePoint,
+      const cudaTextureAddressMode addressMode = cudaAddressModeBorder,
+      const cudaTextureReadMode readMode = cudaReadModeElementType,
+      const cudaTextureFilterMode mipmapFilterMode = cudaFilterModePoint)
+      : array(width, height, depth, num_levels, is_3d),
+        texture(array.CudaApiObject(), is_3d, num_levels, filterMode,
+                addressMode, readMode, mipmapFilterMode),
+        level_surfaces(array, num_levels) {}
+
+  inline cudaMipmappedArray_t MipmappedArray() const {
+    return array.CudaApiObject();
+  }
+
+  inline cudaArray *LevelArray(const unsigned int level) const {
+    return array.LevelArray(level);
+  }
+
+  __host__ __device__ inline cudaTextureObject_t TextureObject() const {
+    return texture.CudaApiObject();
+  }
+
+  // the surface object of a single level, which lives as long as the array
+  inline cudaSurfaceObject_t LevelSurface(const unsigned int level) const {
+    return level_surfaces.LevelSurface(level);
+  }
+
+  inline int UseCount() const { return array.UseCount(); }
+
+ private:
+  // members are destroyed in reverse order, so the surfaces and the texture go
+  // first
+  CudaSharedMipmappedArrayObject<T> array;
+  CudaSharedAliasedTextureObject<T> texture;
+  CudaSharedLevelSurfaceObjects<T> level_surfaces;
+};
+
+//------------------------------------------------------------------------------
+
+// shared surface and texture objects over a single cudaArray, which is
+// allocated with surface load/store support; the texture object holds no
+// reference to the array, but the two are always copied together, and the
+// texture is released first
+template <typename T>
+class CudaSharedSurfaceTextureObject {
+ public:
+  CudaSharedSurfaceTextureObject(
+      const size_t width, const size_t height, const size_t depth = 1,
+      const cudaTextureFilterMode filterMode = cudaFilterModePoint,
+      const cudaTextureAddressMode addressMode = cudaAddressModeBorder,
+      const cudaTextureReadMode readMode = cudaReadModeElementType)
+      : surface(width, height, depth),
+        texture(surface.DeviceArray(), depth > 1, filterMode, addressMode,
+                readMode) {}
+
+  inline cudaArray *DeviceArray() const { return surface.DeviceArray(); }
+
+  __host__ __device__ inline cudaSurfaceObject_t SurfaceObject() const {
+    return surface.CudaApiObject();
+  }
+
+  __host__ __device__ inline cudaTextureObject_t TextureObject() const {
+    return texture.CudaApiObject();
+  }
+
+  inline int UseCount() const { return surface.UseCount(); }
+
+ private:
+  // members are destroyed in reverse order, so the texture goes first
+  CudaSharedSurfaceObject<T> surface;
+  CudaSharedAliasedTextureObject<T> texture;
+};
+
 }  // namespace cua
 
 #endif  // LIBCUA_CUDA_SHARED_ARRAY_OBJECT_H_
@@ -36,10 +36,15 @@
 #ifndef LIBCUA_CUDA_SURFACE2D_H_
 #define LIBCUA_CUDA_SURFACE2D_H_
 
+#include <utility>
+
 #include "cudaArray2DBase.h"
 #include "cudaSharedArrayObject.h"
 
 #include "cudaArray_fwd.h"
+#include "cudaEvent.h"
+#include "deviceView.h"
+#include "stagingBufferPool.h"
 #include "util.h"
 
 namespace cua {
@@ -54,10 +59,10 @@ namespace cua {
  * 2D neighborhood. Copy/assignment for CudaSurface2D objects is a shallow
  * operation; use `Copy()` or `CopyTo(other)` to perform a deep copy.
  *
- * The arrays can be directly passed into device-level code, i.e., you can write
- * kernels that have CudaSurface2D objects in their parameter lists:
+ * To access the array in your own kernels, pass its DeviceView() (the surface
+ * object handle, offsets, and extents) as the kernel parameter:
  *
- *     __global__ void device_kernel(CudaSurface2D<float> arr) {
+ *     __global__ void device_kernel(CudaSurface2DDeviceView<float> arr) {
  *       const int x = blockIdx.x * blockDim.x + threadIdx.x;
  *       const int y = blockIdx.y * blockDim.y + threadIdx.y;
  *       arr.set(x, y, 0.0f);
@@ -132,6 +137,13 @@ class CudaSurface2D : public CudaArray2DBase<CudaSurface2D<T>> {
    */
   __host__ __device__ CudaSurface2D(const CudaSurface2D<T> &other);
 
+  /**
+   * Host-level move constructor. The underlying CUDA memory is handed over to
+   * the new array without updating its reference count, and other is left
+   * empty.
+   */
+  CudaSurface2D(CudaSurface2D<T> &&other);
+
   ~CudaSurface2D() {}
 
   /**
@@ -171,6 +183,13 @@ class CudaSurface2D : public CudaArray2DBase<CudaSurface2D<T>> {
    */
   CudaSurface2D<T> &operator=(const CudaSurface2D<T> &other);
 
+  /**
+   * Move assignment; as for the move constructor, other is left empty.
+   * @param other array whose contents will be referenced by the current array
+   * @return *this
+   */
+  CudaSurface2D<T> &operator=(CudaSurface2D<T> &&other);
+
   /**
    * Copy the contents of a CPU-bound memory array to the current array. This
    * function assumes that the CPU array has the correct size!
@@ -179,6 +198,19 @@ class CudaSurface2D : public CudaArray2DBase<CudaSurface2D<T>> {
    */
   CudaSurface2D<T> &operator=(const T *host_array);
 
+  /**
+   * Evaluate an element-wise array expression into the current array; see
+   * Assign().
+   * @param expression expression over arrays of the same size as this array
+   * @return *this
+   */
+  template <typename Expression>
+  inline CudaSurface2D<T> &operator=(
+      const ArrayExpression<Expression> &expression) {
+    Base::Assign(expression);
+    return *this;
+  }
+
   /**
    * Copy the contents of the current array to a CPU-bound memory array. This
    * function assumes that the CPU array has the correct size!
@@ -204,6 +236,51 @@ class CudaSurface2D : public CudaArray2DBase<CudaSurface2D<T>> {
    */
   void CopyTo(CudaTexture2D<T> *other) const;
 
+  //----------------------------------------------------------------------------
+  // asynchronous copies
+  //
+  // These functions enqueue the copy on the surface's stream and return an
+  // event recorded right after it; see CudaArray2D.
+
+  /**
+   * Asynchronously copy the contents of a densely packed CPU array to the
+   * current surface. This function assumes that the CPU array has the correct
+   * size!
+   * @param host_array the CPU-bound array
+   * @return event that completes with the copy
+   */
+  CudaEvent AssignAsync(const T *host_array);
+
+  /**
+   * Asynchronously copy the contents of the current surface to a densely
+   * packed CPU array. This function assumes that the CPU array has the correct
+   * size!
+   * @param host_array the CPU-bound array
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(T *host_array) const;
+
+  /**
+   * Asynchronously copy to an array, which may be on another device.
+   * @param other destination array
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(CudaArray2D<T> *other) const;
+
+  /**
+   * Asynchronously copy to a surface, which may be on another device.
+   * @param other destination surface
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(CudaSurface2D<T> *other) const;
+
+  /**
+   * Asynchronously copy to a texture, which may be on another device.
+   * @param other destination texture
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(CudaTexture2D<T> *other) const;
+
   //----------------------------------------------------------------------------
   // getters/setters
 
@@ -264,6 +341,15 @@ class CudaSurface2D : public CudaArray2DBase<CudaSurface2D<T>> {
    */
   __host__ __device__ inline IndexType YOffset() const { return y_offset_; }
 
+  /**
+   * @return trivially copyable view of the array for kernel parameter lists
+   */
+  __host__ __device__ inline CudaSurface2DDeviceView<T> DeviceView() const {
+    return CudaSurface2DDeviceView<T>(shared_surface_.CudaApiObject(), width_,
+                                      height_, x_offset_, y_offset_,
+                                      boundary_mode_);
+  }
+
   //----------------------------------------------------------------------------
   // private class methods and fields
 
@@ -292,6 +378,7 @@ template <typename T>
 struct CudaArrayTraits<CudaSurface2D<T>> {
   typedef T Scalar;
   typedef bool Mutable;
+  typedef CudaSurface2DDeviceView<T> DeviceView;
 };
 
 //------------------------------------------------------------------------------
@@ -325,6 +412,17 @@ CudaSurface2D<T>::CudaSurface2D<T>(const CudaSurface2D<T> &other)
 
 //------------------------------------------------------------------------------
 
+// host-level move constructor
+template <typename T>
+CudaSurface2D<T>::CudaSurface2D<T>(CudaSurface2D<T> &&other)
+    : Base(other),
+      boundary_mode_(other.boundary_mode_),
+      shared_surface_(std::move(other.shared_surface_)),
+      x_offset_(other.x_offset_),
+      y_offset_(other.y_offset_) {}
+
+//------------------------------------------------------------------------------
+
 // host-level private constructor for creating views
 template <typename T>
 CudaSurface2D<T>::CudaSurface2D<T>(IndexType x, IndexType y, SizeType width,
@@ -362,11 +460,18 @@ inline CudaSurface2D<T> CudaSurface2D<T>::EmptyFlippedCopy() const {
 template <typename T>
 inline CudaSurface2D<T> &CudaSurface2D<T>::operator=(const T *host_array) {
   internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaSurface2D::Upload", 2 * sizeof(T) * width_ * height_,
+                    device_, stream_, false);
   const SizeType width_in_bytes = width_ * sizeof(T);
   internal::SetDevice(device_);
-  cudaMemcpy2DToArray(DeviceArray(), x_offset_ * sizeof(T), y_offset_,
-                      host_array, width_in_bytes, width_in_bytes, height_,
-                      cudaMemcpyHostToDevice);
+  StagingBufferPool<>::Instance().Upload(
+      host_array, width_in_bytes, height_, stream_,
+      [&](const void *src, size_t y, size_t num_rows, cudaStream_t stream) {
+        cudaMemcpy2DToArrayAsync(DeviceArray(), x_offset_ * sizeof(T),
+                                 y_offset_ + y, src, width_in_bytes,
+                                 width_in_bytes, num_rows,
+                                 cudaMemcpyHostToDevice, stream);
+      });
 
   return *this;
 }
@@ -394,14 +499,41 @@ inline CudaSurface2D<T> &CudaSurface2D<T>::operator=(
 
 //------------------------------------------------------------------------------
 
+template <typename T>
+inline CudaSurface2D<T> &CudaSurface2D<T>::operator=(CudaSurface2D<T> &&other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  Base::operator=(other);
+
+  shared_surface_ = std::move(other.shared_surface_);
+
+  boundary_mode_ = other.boundary_mode_;
+
+  x_offset_ = other.x_offset_;
+  y_offset_ = other.y_offset_;
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
 template <typename T>
 inline void CudaSurface2D<T>::CopyTo(T *host_array) const {
   internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaSurface2D::Download", 2 * sizeof(T) * width_ * height_,
+                    device_, stream_, false);
   const SizeType width_in_bytes = width_ * sizeof(T);
   internal::SetDevice(device_);
-  cudaMemcpy2DFromArray(host_array, width_in_bytes, DeviceArray(),
-                        x_offset_ * sizeof(T), y_offset_, width_in_bytes,
-                        height_, cudaMemcpyDeviceToHost);
+  StagingBufferPool<>::Instance().Download(
+      host_array, width_in_bytes, height_, stream_,
+      [&](void *dst, size_t y, size_t num_rows, cudaStream_t stream) {
+        cudaMemcpy2DFromArrayAsync(dst, width_in_bytes, DeviceArray(),
+                                   x_offset_ * sizeof(T), y_offset_ + y,
+                                   width_in_bytes, num_rows,
+                                   cudaMemcpyDeviceToHost, stream);
+      });
 }
 
 //------------------------------------------------------------------------------
@@ -481,6 +613,125 @@ inline void CudaSurface2D<T>::CopyTo(CudaTexture2D<T> *other) const {
 
 //-------------------------------------------------------------------------------
 
+template <typename T>
+inline CudaEvent CudaSurface2D<T>::AssignAsync(const T *host_array) {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaSurface2D::UploadAsync",
+                    2 * sizeof(T) * width_ * height_, device_, stream_, false);
+  const SizeType width_in_bytes = width_ * sizeof(T);
+  internal::SetDevice(device_);
+  cudaMemcpy2DToArrayAsync(DeviceArray(), x_offset_ * sizeof(T), y_offset_,
+                           host_array, width_in_bytes, width_in_bytes, height_,
+                           cudaMemcpyHostToDevice, stream_);
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaSurface2D<T>::CopyToAsync(T *host_array) const {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaSurface2D::DownloadAsync",
+                    2 * sizeof(T) * width_ * height_, device_, stream_, false);
+  const SizeType width_in_bytes = width_ * sizeof(T);
+  internal::SetDevice(device_);
+  cudaMemcpy2DFromArrayAsync(host_array, width_in_bytes, DeviceArray(),
+                             x_offset_ * sizeof(T), y_offset_, width_in_bytes,
+                             height_, cudaMemcpyDeviceToHost, stream_);
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaSurface2D<T>::CopyToAsync(CudaArray2D<T> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual2D(*this, *other);
+  internal::SetDevice(device_);
+  if (device_ == other->Device()) {
+    cudaMemcpy2DFromArrayAsync(other->ptr(), other->Pitch(), DeviceArray(),
+                               x_offset_ * sizeof(T), y_offset_,
+                               width_ * sizeof(T), height_,
+                               cudaMemcpyDeviceToDevice, stream_);
+  } else {
+    cudaMemcpy3DPeerParms params = {0};
+    params.dstDevice = other->Device();
+    params.dstPtr = other->GetPitchedPtr();
+    params.srcDevice = device_;
+    params.srcArray = DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, 0);
+    params.extent = make_cudaExtent(width_, height_, 1);
+    cudaMemcpy3DPeerAsync(&params, stream_);
+  }
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaSurface2D<T>::CopyToAsync(CudaSurface2D<T> *other) const {
+  if (this == other) {
+    return CudaEvent();
+  }
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual2D(*this, *other);
+  internal::SetDevice(device_);
+  if (device_ == other->Device()) {
+    // there is no asynchronous variant of cudaMemcpy2DArrayToArray
+    cudaMemcpy3DParms params = {0};
+    params.dstArray = other->DeviceArray();
+    params.dstPos = make_cudaPos(other->XOffset(), other->YOffset(), 0);
+    params.srcArray = DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, 0);
+    params.extent = make_cudaExtent(width_, height_, 1);
+    params.kind = cudaMemcpyDeviceToDevice;
+    cudaMemcpy3DAsync(&params, stream_);
+  } else {
+    cudaMemcpy3DPeerParms params = {0};
+    params.dstDevice = other->Device();
+    params.dstArray = other->DeviceArray();
+    params.dstPos = make_cudaPos(other->XOffset(), other->YOffset(), 0);
+    params.srcDevice = device_;
+    params.srcArray = DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, 0);
+    params.extent = make_cudaExtent(width_, height_, 1);
+    cudaMemcpy3DPeerAsync(&params, stream_);
+  }
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaSurface2D<T>::CopyToAsync(CudaTexture2D<T> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual2D(*this, *other);
+  internal::SetDevice(device_);
+  if (device_ == other->Device()) {
+    cudaMemcpy3DParms params = {0};
+    params.dstArray = other->DeviceArray();
+    params.dstPos = make_cudaPos(0, 0, 0);
+    params.srcArray = DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, 0);
+    params.extent = make_cudaExtent(width_, height_, 1);
+    params.kind = cudaMemcpyDeviceToDevice;
+    cudaMemcpy3DAsync(&params, stream_);
+  } else {
+    cudaMemcpy3DPeerParms params = {0};
+    params.dstDevice = other->Device();
+    params.dstArray = other->DeviceArray();
+    params.dstPos = make_cudaPos(0, 0, 0);
+    params.srcDevice = device_;
+    params.srcArray = DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, 0);
+    params.extent = make_cudaExtent(width_, height_, 1);
+    cudaMemcpy3DPeerAsync(&params, stream_);
+  }
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
 }  // namespace cua
 
 #endif  // LIBCUA_CUDA_SURFACE2D_H_
@@ -36,10 +36,15 @@
 #ifndef LIBCUA_CUDA_SURFACE3D_H_
 #define LIBCUA_CUDA_SURFACE3D_H_
 
+#include <utility>
+
 #include "cudaArray3DBase.h"
 #include "cudaSharedArrayObject.h"
 
 #include "cudaArray_fwd.h"
+#include "cudaEvent.h"
+#include "deviceView.h"
+#include "stagingBufferPool.h"
 #include "util.h"
 
 namespace cua {
@@ -57,10 +62,12 @@ namespace cua {
  * Derived classes implement array access for both layered 2D (that is, an array
  * of 2D arrays) and 3D surface-memory arrays.
  *
- * The arrays can be directly passed into device-level code, i.e., you can write
- * kernels that have CudaSurface3D objects in their parameter lists:
+ * To access the array in your own kernels, pass its DeviceView() as the kernel
+ * parameter; the view type is CudaSurface3DDeviceView<T, IsLayered>, with
+ * IsLayered = std::true_type for CudaSurface2DArray:
  *
- *     __global__ void device_kernel(CudaSurface3D<float> arr) {
+ *     __global__ void device_kernel(
+ *         CudaSurface3DDeviceView<float, std::false_type> arr) {
  *       const int x = blockIdx.x * blockDim.x + threadIdx.x;
  *       const int y = blockIdx.y * blockDim.y + threadIdx.y;
  *       const int z = blockIdx.z * blockDim.z + threadIdx.z;
@@ -143,6 +150,13 @@ class CudaSurface3DBase : public CudaArray3DBase<Derived> {
   __host__ __device__
   CudaSurface3DBase(const CudaSurface3DBase<Derived> &other);
 
+  /**
+   * Host-level move constructor. The underlying CUDA memory is handed over to
+   * the new array without updating its reference count, and other is left
+   * empty.
+   */
+  CudaSurface3DBase(CudaSurface3DBase<Derived> &&other);
+
   /**
    * Create a view onto the underlying CUDA memory. This function assumes that
    * the cropped view region is valid!
@@ -168,7 +182,14 @@ class CudaSurface3DBase : public CudaArray3DBase<Derived> {
    * Create an empty array of the same size as the current array.
    * @param device GPU on which this array is stored, or -1 for the current GPU
    */
-  CudaSurface3DBase<Derived> EmptyCopy(int device = -1) const;
+  Derived EmptyCopy(int device = -1) const;
+
+  /**
+   * Create an empty array with the axes of the current array reordered, e.g.,
+   * a depth x width x height array for AxisPermutation::kZXY.
+   * @param permutation new order of the axes; see AxisPermutation
+   */
+  Derived EmptyPermutedCopy(AxisPermutation permutation) const;
 
   /**
    * Shallow re-assignment of the given array to share the contents of another.
@@ -179,6 +200,13 @@ class CudaSurface3DBase : public CudaArray3DBase<Derived> {
   CudaSurface3DBase<Derived> &operator=(
       const CudaSurface3DBase<Derived> &other);
 
+  /**
+   * Move assignment; as for the move constructor, other is left empty.
+   * @param other array whose contents will be referenced by the current array
+   * @return *this
+   */
+  CudaSurface3DBase<Derived> &operator=(CudaSurface3DBase<Derived> &&other);
+
   /**
    * Copy the contents of a CPU-bound memory array to the current array. This
    * function assumes that the CPU array has the correct size!
@@ -187,6 +215,19 @@ class CudaSurface3DBase : public CudaArray3DBase<Derived> {
    */
   CudaSurface3DBase<Derived> &operator=(const Scalar *host_array);
 
+  /**
+   * Evaluate an element-wise array expression into the current array; see
+   * Assign().
+   * @param expression expression over arrays of the same size as this array
+   * @return *this
+   */
+  template <typename Expression>
+  inline CudaSurface3DBase<Derived> &operator=(
+      const ArrayExpression<Expression> &expression) {
+    Base::Assign(expression);
+    return *this;
+  }
+
   /**
    * Copy the contents of the current array to a CPU-bound memory array. This
    * function assumes that the CPU array has the correct size!
@@ -214,6 +255,53 @@ class CudaSurface3DBase : public CudaArray3DBase<Derived> {
   template <typename OtherDerived>
   void CopyTo(CudaTexture3DBase<OtherDerived> *other) const;
 
+  //----------------------------------------------------------------------------
+  // asynchronous copies
+  //
+  // These functions enqueue the copy on the surface's stream and return an
+  // event recorded right after it; see CudaArray3D.
+
+  /**
+   * Asynchronously copy the contents of a densely packed CPU array to the
+   * current surface. This function assumes that the CPU array has the correct
+   * size!
+   * @param host_array the CPU-bound array
+   * @return event that completes with the copy
+   */
+  CudaEvent AssignAsync(const Scalar *host_array);
+
+  /**
+   * Asynchronously copy the contents of the current surface to a densely
+   * packed CPU array. This function assumes that the CPU array has the correct
+   * size!
+   * @param host_array the CPU-bound array
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(Scalar *host_array) const;
+
+  /**
+   * Asynchronously copy to an array, which may be on another device.
+   * @param other destination array
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(CudaArray3D<Scalar> *other) const;
+
+  /**
+   * Asynchronously copy to a surface, which may be on another device.
+   * @param other destination surface
+   * @return event that completes with the copy
+   */
+  template <typename OtherDerived>
+  CudaEvent CopyToAsync(CudaSurface3DBase<OtherDerived> *other) const;
+
+  /**
+   * Asynchronously copy to a texture, which may be on another device.
+   * @param other destination texture
+   * @return event that completes with the copy
+   */
+  template <typename OtherDerived>
+  CudaEvent CopyToAsync(CudaTexture3DBase<OtherDerived> *other) const;
+
   //----------------------------------------------------------------------------
   // getters/setters
 
@@ -257,6 +345,15 @@ class CudaSurface3DBase : public CudaArray3DBase<Derived> {
    */
   __host__ __device__ inline IndexType ZOffset() const { return z_offset_; }
 
+  /**
+   * @return trivially copyable view of the array for kernel parameter lists
+   */
+  __host__ __device__ inline typename Base::DeviceViewType DeviceView() const {
+    return typename Base::DeviceViewType(
+        shared_surface_.CudaApiObject(), width_, height_, depth_, x_offset_,
+        y_offset_, z_offset_, boundary_mode_);
+  }
+
  protected:
   //
   // protected class fields
@@ -317,6 +414,19 @@ __host__ __device__ CudaSurface3DBase<Derived>::CudaSurface3DBase<Derived>(
 
 //------------------------------------------------------------------------------
 
+// host-level move constructor
+template <typename Derived>
+CudaSurface3DBase<Derived>::CudaSurface3DBase<Derived>(
+    CudaSurface3DBase<Derived> &&other)
+    : Base(other),
+      boundary_mode_(other.boundary_mode_),
+      shared_surface_(std::move(other.shared_surface_)),
+      x_offset_(other.x_offset_),
+      y_offset_(other.y_offset_),
+      z_offset_(other.z_offset_) {}
+
+//------------------------------------------------------------------------------
+
 // host-level private constructor for creating views
 template <typename Derived>
 CudaSurface3DBase<Derived>::CudaSurface3DBase<Derived>(
@@ -333,13 +443,24 @@ CudaSurface3DBase<Derived>::CudaSurface3DBase<Derived>(
 //------------------------------------------------------------------------------
 
 template <typename Derived>
-inline CudaSurface3DBase<Derived> CudaSurface3DBase<Derived>::EmptyCopy(
-    int device) const {
+inline Derived CudaSurface3DBase<Derived>::EmptyCopy(int device) const {
   if (device == -1) {
     device = device_;
   }
-  return CudaSurface3DBase<Derived>(width_, height_, depth_, device, block_dim_,
-                                    stream_, boundary_mode_);
+  return Derived(width_, height_, depth_, device, block_dim_, stream_,
+                 boundary_mode_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Derived>
+inline Derived CudaSurface3DBase<Derived>::EmptyPermutedCopy(
+    AxisPermutation permutation) const {
+  const SizeType sizes[3] = {width_, height_, depth_};
+  return Derived(sizes[internal::PermutedAxis(permutation, 0)],
+                 sizes[internal::PermutedAxis(permutation, 1)],
+                 sizes[internal::PermutedAxis(permutation, 2)], device_,
+                 block_dim_, stream_, boundary_mode_);
 }
 
 //------------------------------------------------------------------------------
@@ -348,17 +469,33 @@ template <typename Derived>
 inline CudaSurface3DBase<Derived> &CudaSurface3DBase<Derived>::operator=(
     const Scalar *host_array) {
   internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaSurface3D::Upload",
+                    2 * sizeof(Scalar) * width_ * height_ * depth_, device_,
+                    stream_, false);
   internal::SetDevice(device_);
 
-  cudaMemcpy3DParms params = {0};
-  params.srcPtr = make_cudaPitchedPtr(const_cast<Scalar *>(host_array),
-                                      width_ * sizeof(Scalar), width_, height_);
-  params.dstArray = shared_surface_.DeviceArray();
-  params.dstPos = make_cudaPos(x_offset_, y_offset_, z_offset_);
-  params.extent = make_cudaExtent(width_, height_, depth_);
-  params.kind = cudaMemcpyHostToDevice;
-
-  cudaMemcpy3D(&params);  // last copy is synchronous
+  const size_t width_in_bytes = width_ * sizeof(Scalar);
+  StagingBufferPool<>::Instance().Upload(
+      host_array, width_in_bytes, static_cast<size_t>(height_) * depth_,
+      stream_,
+      [&](const void *src, size_t first_row, size_t num_rows,
+          cudaStream_t stream) {
+        internal::ForEachSliceRun(
+            first_row, num_rows, height_,
+            [&](size_t y, size_t z, size_t n, size_t offset) {
+              cudaMemcpy3DParms params = {0};
+              params.srcPtr = make_cudaPitchedPtr(
+                  const_cast<char *>(reinterpret_cast<const char *>(src)) +
+                      offset * width_in_bytes,
+                  width_in_bytes, width_, n);
+              params.dstArray = shared_surface_.DeviceArray();
+              params.dstPos =
+                  make_cudaPos(x_offset_, y_offset_ + y, z_offset_ + z);
+              params.extent = make_cudaExtent(width_, n, 1);
+              params.kind = cudaMemcpyHostToDevice;
+              cudaMemcpy3DAsync(&params, stream);
+            });
+      });
 
   return *this;
 }
@@ -387,21 +524,57 @@ inline CudaSurface3DBase<Derived> &CudaSurface3DBase<Derived>::operator=(
 
 //------------------------------------------------------------------------------
 
+template <typename Derived>
+inline CudaSurface3DBase<Derived> &CudaSurface3DBase<Derived>::operator=(
+    CudaSurface3DBase<Derived> &&other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  Base::operator=(other);
+
+  shared_surface_ = std::move(other.shared_surface_);
+
+  boundary_mode_ = other.boundary_mode_;
+
+  x_offset_ = other.x_offset_;
+  y_offset_ = other.y_offset_;
+  z_offset_ = other.z_offset_;
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
 template <typename Derived>
 inline void CudaSurface3DBase<Derived>::CopyTo(
     CudaSurface3DBase<Derived>::Scalar *host_array) const {
   internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaSurface3D::Download",
+                    2 * sizeof(Scalar) * width_ * height_ * depth_, device_,
+                    stream_, false);
   internal::SetDevice(device_);
 
-  cudaMemcpy3DParms params = {0};
-  params.srcArray = shared_surface_.DeviceArray();
-  params.srcPos = make_cudaPos(x_offset_, y_offset_, z_offset_);
-  params.dstPtr = make_cudaPitchedPtr(const_cast<Scalar *>(host_array),
-                                      width_ * sizeof(Scalar), width_, height_);
-  params.extent = make_cudaExtent(width_, height_, depth_);
-  params.kind = cudaMemcpyDeviceToHost;
-
-  cudaMemcpy3D(&params);
+  const size_t width_in_bytes = width_ * sizeof(Scalar);
+  StagingBufferPool<>::Instance().Download(
+      host_array, width_in_bytes, static_cast<size_t>(height_) * depth_,
+      stream_,
+      [&](void *dst, size_t first_row, size_t num_rows, cudaStream_t stream) {
+        internal::ForEachSliceRun(
+            first_row, num_rows, height_,
+            [&](size_t y, size_t z, size_t n, size_t offset) {
+              cudaMemcpy3DParms params = {0};
+              params.srcArray = shared_surface_.DeviceArray();
+              params.srcPos =
+                  make_cudaPos(x_offset_, y_offset_ + y, z_offset_ + z);
+              params.dstPtr = make_cudaPitchedPtr(
+                  reinterpret_cast<char *>(dst) + offset * width_in_bytes,
+                  width_in_bytes, width_, n);
+              params.extent = make_cudaExtent(width_, n, 1);
+              params.kind = cudaMemcpyDeviceToHost;
+              cudaMemcpy3DAsync(&params, stream);
+            });
+      });
 }
 
 //------------------------------------------------------------------------------
@@ -510,6 +683,169 @@ inline void CudaSurface3DBase<Derived>::CopyTo(
   }
 }
 
+//------------------------------------------------------------------------------
+
+template <typename Derived>
+inline CudaEvent CudaSurface3DBase<Derived>::AssignAsync(
+    const Scalar *host_array) {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaSurface3D::UploadAsync",
+                    2 * sizeof(Scalar) * width_ * height_ * depth_, device_,
+                    stream_, false);
+  internal::SetDevice(device_);
+
+  const size_t width_in_bytes = width_ * sizeof(Scalar);
+  cudaMemcpy3DParms params = {0};
+  params.srcPtr =
+      make_cudaPitchedPtr(const_cast<Scalar *>(host_array), width_in_bytes,
+                          width_, height_);
+  params.dstArray = shared_surface_.DeviceArray();
+  params.dstPos = make_cudaPos(x_offset_, y_offset_, z_offset_);
+  params.extent = make_cudaExtent(width_, height_, depth_);
+  params.kind = cudaMemcpyHostToDevice;
+
+  cudaMemcpy3DAsync(&params, stream_);
+
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Derived>
+inline CudaEvent CudaSurface3DBase<Derived>::CopyToAsync(
+    Scalar *host_array) const {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaSurface3D::DownloadAsync",
+                    2 * sizeof(Scalar) * width_ * height_ * depth_, device_,
+                    stream_, false);
+  internal::SetDevice(device_);
+
+  const size_t width_in_bytes = width_ * sizeof(Scalar);
+  cudaMemcpy3DParms params = {0};
+  params.srcArray = shared_surface_.DeviceArray();
+  params.srcPos = make_cudaPos(x_offset_, y_offset_, z_offset_);
+  params.dstPtr =
+      make_cudaPitchedPtr(host_array, width_in_bytes, width_, height_);
+  params.extent = make_cudaExtent(width_, height_, depth_);
+  params.kind = cudaMemcpyDeviceToHost;
+
+  cudaMemcpy3DAsync(&params, stream_);
+
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Derived>
+inline CudaEvent CudaSurface3DBase<Derived>::CopyToAsync(
+    CudaArray3D<Scalar> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual3D(*this, *other);
+  internal::SetDevice(device_);
+
+  if (device_ == other->Device()) {
+    cudaMemcpy3DParms params = {0};
+    params.srcArray = shared_surface_.DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, z_offset_);
+    params.dstPtr = other->GetPitchedPtr();
+    params.extent = make_cudaExtent(width_, height_, depth_);
+    params.kind = cudaMemcpyDeviceToDevice;
+
+    cudaMemcpy3DAsync(&params, stream_);
+  } else {
+    cudaMemcpy3DPeerParms params = {0};
+    params.srcDevice = device_;
+    params.dstDevice = other->Device();
+    params.srcArray = shared_surface_.DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, z_offset_);
+    params.dstPtr = other->GetPitchedPtr();
+    params.extent = make_cudaExtent(width_, height_, depth_);
+
+    cudaMemcpy3DPeerAsync(&params, stream_);
+  }
+
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Derived>
+template <typename OtherDerived>
+inline CudaEvent CudaSurface3DBase<Derived>::CopyToAsync(
+    CudaSurface3DBase<OtherDerived> *other) const {
+  if (std::is_same<Derived, OtherDerived>::value) {
+    if (this == reinterpret_cast<CudaSurface3DBase<Derived> *>(other)) {
+      return CudaEvent();
+    }
+  }
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual3D(*this, *other);
+  internal::SetDevice(device_);
+
+  if (device_ == other->Device()) {
+    cudaMemcpy3DParms params = {0};
+    params.srcArray = shared_surface_.DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, z_offset_);
+    params.dstArray = other->DeviceArray();
+    params.dstPos =
+        make_cudaPos(other->XOffset(), other->YOffset(), other->ZOffset());
+    params.extent = make_cudaExtent(width_, height_, depth_);
+    params.kind = cudaMemcpyDeviceToDevice;
+
+    cudaMemcpy3DAsync(&params, stream_);
+  } else {
+    cudaMemcpy3DPeerParms params = {0};
+    params.srcDevice = device_;
+    params.dstDevice = other->Device();
+    params.srcArray = shared_surface_.DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, z_offset_);
+    params.dstArray = other->DeviceArray();
+    params.dstPos =
+        make_cudaPos(other->XOffset(), other->YOffset(), other->ZOffset());
+    params.extent = make_cudaExtent(width_, height_, depth_);
+
+    cudaMemcpy3DPeerAsync(&params, stream_);
+  }
+
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Derived>
+template <typename OtherDerived>
+inline CudaEvent CudaSurface3DBase<Derived>::CopyToAsync(
+    CudaTexture3DBase<OtherDerived> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual3D(*this, *other);
+  internal::SetDevice(device_);
+
+  if (device_ == other->Device()) {
+    cudaMemcpy3DParms params = {0};
+    params.srcArray = shared_surface_.DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, z_offset_);
+    params.dstArray = other->DeviceArray();
+    params.dstPos = make_cudaPos(0, 0, 0);
+    params.extent = make_cudaExtent(width_, height_, depth_);
+    params.kind = cudaMemcpyDeviceToDevice;
+
+    cudaMemcpy3DAsync(&params, stream_);
+  } else {
+    cudaMemcpy3DPeerParms params = {0};
+    params.srcDevice = device_;
+    params.dstDevice = other->Device();
+    params.srcArray = shared_surface_.DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, z_offset_);
+    params.dstArray = other->DeviceArray();
+    params.dstPos = make_cudaPos(0, 0, 0);
+    params.extent = make_cudaExtent(width_, height_, depth_);
+
+    cudaMemcpy3DPeerAsync(&params, stream_);
+  }
+
+  return CudaEvent::Record(stream_);
+}
+
 //------------------------------------------------------------------------------
 //
 // Sub-class implementations (layered 2D arrays and pure 3D arrays)
@@ -528,8 +864,6 @@ class CudaSurface2DArray : public CudaSurface3DBase<CudaSurface2DArray<T>> {
   using CudaSurface3DBase<CudaSurface2DArray<T>>::CudaSurface3DBase;
   using CudaSurface3DBase<CudaSurface2DArray<T>>::operator=;
 
-  ~CudaSurface2DArray() {}
-
   /**
    * Device-level function for setting an element in an array
    * @param x first coordinate
@@ -572,8 +906,6 @@ class CudaSurface3D : public CudaSurface3DBase<CudaSurface3D<T>> {
   using CudaSurface3DBase<CudaSurface3D<T>>::CudaSurface3DBase;
   using CudaSurface3DBase<CudaSurface3D<T>>::operator=;
 
-  ~CudaSurface3D() {}
-
   /**
    * Device-level function for setting an element in an array
    * @param x first coordinate
@@ -612,6 +944,7 @@ struct CudaArrayTraits<CudaSurface2DArray<T>> {
   typedef T Scalar;
   typedef bool Mutable;
   typedef std::true_type IsLayered;
+  typedef CudaSurface3DDeviceView<T, IsLayered> DeviceView;
 };
 
 template <typename T>
@@ -619,6 +952,7 @@ struct CudaArrayTraits<CudaSurface3D<T>> {
   typedef T Scalar;
   typedef bool Mutable;
   typedef std::false_type IsLayered;
+  typedef CudaSurface3DDeviceView<T, IsLayered> DeviceView;
 };
 
 }  // namespace cua
@@ -0,0 +1,696 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef LIBCUA_CUDA_SURFACE_TEXTURE2D_H_
+#define LIBCUA_CUDA_SURFACE_TEXTURE2D_H_
+
+#include <utility>
+
+#include "cudaArray2DBase.h"
+#include "cudaSharedArrayObject.h"
+
+#include "cudaArray_fwd.h"
+#include "cudaEvent.h"
+#include "deviceView.h"
+#include "stagingBufferPool.h"
+#include "util.h"
+
+namespace cua {
+
+/**
+ * @class CudaSurfaceTexture2D
+ * @brief 2D array that is both a writable surface and a sampled texture.
+ *
+ * This class allocates a single cudaArray with surface load/store support and
+ * creates both a surface object and a texture object over it. Elements are
+ * read and written exactly through the surface, as with CudaSurface2D, while
+ * interp() samples the same memory through the texture unit, as with
+ * CudaTexture2D. Write-then-sample workflows thus need no intermediate
+ * CudaSurface2D::CopyTo(CudaTexture2D<T> *).
+ *
+ * The texture cache is not kept coherent with surface writes during a kernel:
+ * values written through set() are visible to interp() only in subsequently
+ * launched kernels. Copy/assignment for CudaSurfaceTexture2D objects is a
+ * shallow operation, and both CUDA objects and the array are released together
+ * when the last copy is destroyed.
+ *
+ * To access the array in your own kernels, pass its DeviceView() as the kernel
+ * parameter:
+ *
+ *     __global__ void device_kernel(
+ *         const CudaSurfaceTexture2DDeviceView<float> in,
+ *         CudaSurface2DDeviceView<float> out) {
+ *       const int x = blockIdx.x * blockDim.x + threadIdx.x;
+ *       const int y = blockIdx.y * blockDim.y + threadIdx.y;
+ *       out.set(x, y, in.interp(0.5f * x, 0.5f * y));
+ *     }
+ */
+template <typename T>
+class CudaSurfaceTexture2D : public CudaArray2DBase<CudaSurfaceTexture2D<T>> {
+ public:
+  friend class CudaArray2DBase<CudaSurfaceTexture2D<T>>;
+
+  /// datatype of the array
+  typedef T Scalar;
+
+  typedef CudaArray2DBase<CudaSurfaceTexture2D<T>> Base;
+  typedef typename Base::SizeType SizeType;
+  typedef typename Base::IndexType IndexType;
+
+ protected:
+  // for convenience, reference base class members directly (they are otherwise
+  // not in the current scope because CudaArray2DBase is templated)
+  using Base::width_;
+  using Base::height_;
+  using Base::block_dim_;
+  using Base::grid_dim_;
+  using Base::device_;
+  using Base::stream_;
+
+ public:
+  //----------------------------------------------------------------------------
+  // constructors and destructor
+
+  /**
+   * Constructor.
+   * @param width number of columns in the array, assuming a row-major array
+   * @param height number of rows in the array, assuming a row-major array
+   * @param filter_mode use cudaFilterModeLinear to allow for interpolation
+   * @param address_mode specifies how texture reads outside of the 2D extent
+   *   of the array are handled
+   * @param read_mode can also optionally specify this as
+   *   cudaReadModeNormalizedFloat
+   * @param block_dim default block size for CUDA kernel calls involving this
+   *   object, i.e., the values for blockDim.x/y/z; note that the default grid
+   *   dimension is computed automatically based on the array size
+   * @param stream CUDA stream for this array object
+   * @param boundary_mode boundary mode to use for surface reads that go
+   *   outside the 2D extents of the array
+   */
+  CudaSurfaceTexture2D(
+      SizeType width, SizeType height,
+      const cudaTextureFilterMode filter_mode = cudaFilterModePoint,
+      const cudaTextureAddressMode address_mode = cudaAddressModeBorder,
+      const cudaTextureReadMode read_mode = cudaReadModeElementType,
+      const dim3 block_dim = CudaSurfaceTexture2D<T>::kBlockDim,
+      const cudaStream_t stream = 0,  // default stream
+      const cudaSurfaceBoundaryMode boundary_mode = cudaBoundaryModeZero)
+      : CudaSurfaceTexture2D(width, height, internal::GetDevice(), filter_mode,
+                             address_mode, read_mode, block_dim, stream,
+                             boundary_mode) {}
+
+  /**
+   * Constructor.
+   * @param width number of columns in the array, assuming a row-major array
+   * @param height number of rows in the array, assuming a row-major array
+   * @param device GPU on which this array is stored, or -1 for the current GPU
+   * @param filter_mode use cudaFilterModeLinear to allow for interpolation
+   * @param address_mode specifies how texture reads outside of the 2D extent
+   *   of the array are handled
+   * @param read_mode can also optionally specify this as
+   *   cudaReadModeNormalizedFloat
+   * @param block_dim default block size for CUDA kernel calls involving this
+   *   object, i.e., the values for blockDim.x/y/z; note that the default grid
+   *   dimension is computed automatically based on the array size
+   * @param stream CUDA stream for this array object
+   * @param boundary_mode boundary mode to use for surface reads that go
+   *   outside the 2D extents of the array
+   */
+  CudaSurfaceTexture2D(
+      SizeType width, SizeType height, int device,
+      const cudaTextureFilterMode filter_mode = cudaFilterModePoint,
+      const cudaTextureAddressMode address_mode = cudaAddressModeBorder,
+      const cudaTextureReadMode read_mode = cudaReadModeElementType,
+      const dim3 block_dim = CudaSurfaceTexture2D<T>::kBlockDim,
+      const cudaStream_t stream = 0,  // default stream
+      const cudaSurfaceBoundaryMode boundary_mode = cudaBoundaryModeZero);
+
+  /**
+   * Host and device-level copy constructor. This is a shallow-copy operation,
+   * meaning that the underlying CUDA memory is the same for both arrays.
+   */
+  __host__ __device__
+  CudaSurfaceTexture2D(const CudaSurfaceTexture2D<T> &other);
+
+  /**
+   * Host-level move constructor. The underlying CUDA memory is handed over to
+   * the new array without updating its reference count, and other is left
+   * empty.
+   */
+  CudaSurfaceTexture2D(CudaSurfaceTexture2D<T> &&other);
+
+  ~CudaSurfaceTexture2D() {}
+
+  /**
+   * Create a view onto the underlying CUDA memory. This function assumes that
+   * the cropped view region is valid! Texture coordinates in the view are
+   * relative to its top left, as well.
+   * @param x x-coordinate for the top left of the view
+   * @param y y-coordinate for the top left of the view
+   * @param width width of the view
+   * @param height height of the view
+   * @return new CudaSurfaceTexture2D view onto the same memory
+   */
+  inline CudaSurfaceTexture2D<T> View(IndexType x, IndexType y, SizeType width,
+                                      SizeType height) const {
+    return CudaSurfaceTexture2D<T>(x, y, width, height, *this);
+  }
+
+  //----------------------------------------------------------------------------
+  // array operations
+
+  /**
+   * Create an empty array of the same size, and with the same texture
+   * settings, as the current array.
+   * @param device GPU on which this array is stored, or -1 for the current GPU
+   */
+  CudaSurfaceTexture2D<T> EmptyCopy(int device = -1) const;
+
+  /**
+   * Create a new empty array with transposed dimensions (flipped height/width).
+   */
+  CudaSurfaceTexture2D<T> EmptyFlippedCopy() const;
+
+  /**
+   * Shallow re-assignment of the given array to share the contents of another.
+   * @param other a separate array whose contents will now also be referenced by
+   *   the current array
+   * @return *this
+   */
+  CudaSurfaceTexture2D<T> &operator=(const CudaSurfaceTexture2D<T> &other);
+
+  /**
+   * Move assignment; as for the move constructor, other is left empty.
+   * @param other array whose contents will be referenced by the current array
+   * @return *this
+   */
+  CudaSurfaceTexture2D<T> &operator=(CudaSurfaceTexture2D<T> &&other);
+
+  /**
+   * Copy the contents of a CPU-bound memory array to the current array. This
+   * function assumes that the CPU array has the correct size!
+   * @param host_array the CPU-bound array
+   * @return *this
+   */
+  CudaSurfaceTexture2D<T> &operator=(const T *host_array);
+
+  /**
+   * Evaluate an element-wise array expression into the current array; see
+   * Assign().
+   * @param expression expression over arrays of the same size as this array
+   * @return *this
+   */
+  template <typename Expression>
+  inline CudaSurfaceTexture2D<T> &operator=(
+      const ArrayExpression<Expression> &expression) {
+    Base::Assign(expression);
+    return *this;
+  }
+
+  // copies into other arrays (see CudaArray2DBase)
+  using Base::CopyTo;
+
+  /**
+   * Copy the contents of the current array to a CPU-bound memory array. This
+   * function assumes that the CPU array has the correct size!
+   * @param host_array the CPU-bound array
+   */
+  void CopyTo(T *host_array) const;
+
+  /**
+   * Copy to an array.
+   * @param other destination array
+   */
+  void CopyTo(CudaArray2D<T> *other) const;
+
+  /**
+   * Copy to a surface.
+   * @param other destination surface
+   */
+  void CopyTo(CudaSurface2D<T> *other) const;
+
+  /**
+   * Copy to a texture.
+   * @param other destination texture
+   */
+  void CopyTo(CudaTexture2D<T> *other) const;
+
+  /**
+   * Asynchronously copy the contents of a densely packed CPU array to the
+   * current array on the array's stream. This function assumes that the CPU
+   * array has the correct size!
+   * @param host_array the CPU-bound array
+   * @return event that completes with the copy
+   */
+  CudaEvent AssignAsync(const T *host_array);
+
+  /**
+   * Asynchronously copy the contents of the current array to a densely packed
+   * CPU array on the array's stream. This function assumes that the CPU array
+   * has the correct size!
+   * @param host_array the CPU-bound array
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(T *host_array) const;
+
+  //----------------------------------------------------------------------------
+  // getters/setters
+
+  /**
+   * Device-level function for setting an element in an array through the
+   * surface object
+   * @param x first coordinate, i.e., the column index in a row-major array
+   * @param y second coordinate, i.e., the row index in a row-major array
+   * @param v the new value to assign to array(x, y)
+   */
+  __device__ inline void set(const int x, const int y, const T v) {
+    surf2Dwrite(v, shared_object_.SurfaceObject(), sizeof(T) * (x + x_offset_),
+                y + y_offset_, boundary_mode_);
+  }
+
+  /**
+   * Device-level function for getting an element in an array through the
+   * surface object
+   * @param x first coordinate, i.e., the column index in a row-major array
+   * @param y second coordinate, i.e., the row index in a row-major array
+   * @return the value at array(x, y)
+   */
+  __device__ inline T get(const int x, const int y) const {
+    return surf2Dread<T>(shared_object_.SurfaceObject(),
+                         sizeof(T) * (x + x_offset_), y + y_offset_,
+                         boundary_mode_);
+  }
+
+  /**
+   * Device-level function for sampling the array through the texture object;
+   * see CudaTexture2D::interp().
+   * @param x first coordinate, i.e., the column index in a row-major array
+   * @param y second coordinate, i.e., the row index in a row-major array
+   * @return the interpolated value at array(x, y)
+   */
+  template <typename ReturnType = T>
+  __device__ inline ReturnType interp(const float x, const float y) const {
+    return tex2D<ReturnType>(shared_object_.TextureObject(), x + x_offset_,
+                             y + y_offset_);
+  }
+
+  /**
+   * @return the underlying cudaArray object shared by the surface and texture
+   */
+  inline cudaArray *DeviceArray() const {
+    return shared_object_.DeviceArray();
+  }
+
+  /**
+   * @return the boundary mode for the underlying CUDA Surface object
+   */
+  __host__ __device__ inline cudaSurfaceBoundaryMode BoundaryMode() const {
+    return boundary_mode_;
+  }
+
+  /**
+   * set the boundary mode for the underlying CUDA Surface object
+   */
+  __host__ __device__ inline void SetBoundaryMode(
+      const cudaSurfaceBoundaryMode boundary_mode) {
+    boundary_mode_ = boundary_mode;
+  }
+
+  /**
+   * @return the x offset for the underlying memory, or zero if the object is
+   *   not a view
+   */
+  __host__ __device__ inline IndexType XOffset() const { return x_offset_; }
+
+  /**
+   * @return the y offset for the underlying memory, or zero if the object is
+   *   not a view
+   */
+  __host__ __device__ inline IndexType YOffset() const { return y_offset_; }
+
+  /**
+   * @return trivially copyable view of the array for kernel parameter lists
+   */
+  __host__ __device__ inline CudaSurfaceTexture2DDeviceView<T> DeviceView()
+      const {
+    return CudaSurfaceTexture2DDeviceView<T>(
+        shared_object_.SurfaceObject(), shared_object_.TextureObject(), width_,
+        height_, x_offset_, y_offset_, boundary_mode_);
+  }
+
+  //----------------------------------------------------------------------------
+  // private class methods and fields
+
+ private:
+  /**
+   * Internal constructor used for creating views.
+   * @param x x-coordinate for the top left of the view
+   * @param y y-coordinate for the top left of the view
+   * @param width width of the view
+   * @param height height of the view
+   */
+  CudaSurfaceTexture2D(IndexType x, IndexType y, SizeType width,
+                       SizeType height, const CudaSurfaceTexture2D<T> &other);
+
+  CudaSharedSurfaceTextureObject<T> shared_object_;
+
+  cudaTextureFilterMode filter_mode_;
+  cudaTextureAddressMode address_mode_;
+  cudaTextureReadMode read_mode_;
+
+  cudaSurfaceBoundaryMode boundary_mode_;
+
+  IndexType x_offset_, y_offset_;  // = 0 if not using a view
+};
+
+//------------------------------------------------------------------------------
+// template typedef for CRTP model, a la Eigen
+
+template <typename T>
+struct CudaArrayTraits<CudaSurfaceTexture2D<T>> {
+  typedef T Scalar;
+  typedef bool Mutable;
+  typedef CudaSurfaceTexture2DDeviceView<T> DeviceView;
+};
+
+//------------------------------------------------------------------------------
+//
+// public method implementations
+//
+//------------------------------------------------------------------------------
+
+template <typename T>
+CudaSurfaceTexture2D<T>::CudaSurfaceTexture2D<T>(
+    SizeType width, SizeType height, int device,
+    const cudaTextureFilterMode filter_mode,
+    const cudaTextureAddressMode address_mode,
+    const cudaTextureReadMode read_mode, const dim3 block_dim,
+    const cudaStream_t stream, const cudaSurfaceBoundaryMode boundary_mode)
+    : Base(width, height, device, block_dim, stream),
+      shared_object_(width, height, 1, filter_mode, address_mode, read_mode),
+      filter_mode_(filter_mode),
+      address_mode_(address_mode),
+      read_mode_(read_mode),
+      boundary_mode_(boundary_mode),
+      x_offset_(0),
+      y_offset_(0) {}
+
+//------------------------------------------------------------------------------
+
+// host- and device-level copy constructor
+template <typename T>
+__host__ __device__ CudaSurfaceTexture2D<T>::CudaSurfaceTexture2D<T>(
+    const CudaSurfaceTexture2D<T> &other)
+    : Base(other),
+      shared_object_(other.shared_object_),
+      filter_mode_(other.filter_mode_),
+      address_mode_(other.address_mode_),
+      read_mode_(other.read_mode_),
+      boundary_mode_(other.boundary_mode_),
+      x_offset_(other.x_offset_),
+      y_offset_(other.y_offset_) {}
+
+//------------------------------------------------------------------------------
+
+// host-level move constructor
+template <typename T>
+CudaSurfaceTexture2D<T>::CudaSurfaceTexture2D<T>(
+    CudaSurfaceTexture2D<T> &&other)
+    : Base(other),
+      shared_object_(std::move(other.shared_object_)),
+      filter_mode_(other.filter_mode_),
+      address_mode_(other.address_mode_),
+      read_mode_(other.read_mode_),
+      boundary_mode_(other.boundary_mode_),
+      x_offset_(other.x_offset_),
+      y_offset_(other.y_offset_) {}
+
+//------------------------------------------------------------------------------
+
+// host-level private constructor for creating views
+template <typename T>
+CudaSurfaceTexture2D<T>::CudaSurfaceTexture2D<T>(
+    IndexType x, IndexType y, SizeType width, SizeType height,
+    const CudaSurfaceTexture2D<T> &other)
+    : Base(width, height, other.device_, other.block_dim_, other.stream_),
+      shared_object_(other.shared_object_),
+      filter_mode_(other.filter_mode_),
+      address_mode_(other.address_mode_),
+      read_mode_(other.read_mode_),
+      boundary_mode_(other.boundary_mode_),
+      x_offset_(x + other.x_offset_),
+      y_offset_(y + other.y_offset_) {}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaSurfaceTexture2D<T> CudaSurfaceTexture2D<T>::EmptyCopy(
+    int device) const {
+  if (device == -1) {
+    device = device_;
+  }
+  return CudaSurfaceTexture2D<T>(width_, height_, device, filter_mode_,
+                                 address_mode_, read_mode_, block_dim_,
+                                 stream_, boundary_mode_);
+}
+
+//------------------------------------------------------------------------------
+
+// create a transposed version (flipped height/width) of the given matrix
+template <typename T>
+inline CudaSurfaceTexture2D<T> CudaSurfaceTexture2D<T>::EmptyFlippedCopy()
+    const {
+  return CudaSurfaceTexture2D<T>(height_, width_, device_, filter_mode_,
+                                 address_mode_, read_mode_,
+                                 dim3(block_dim_.y, block_dim_.x), stream_,
+                                 boundary_mode_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaSurfaceTexture2D<T> &CudaSurfaceTexture2D<T>::operator=(
+    const CudaSurfaceTexture2D<T> &other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  Base::operator=(other);
+
+  shared_object_ = other.shared_object_;
+
+  filter_mode_ = other.filter_mode_;
+  address_mode_ = other.address_mode_;
+  read_mode_ = other.read_mode_;
+  boundary_mode_ = other.boundary_mode_;
+
+  x_offset_ = other.x_offset_;
+  y_offset_ = other.y_offset_;
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaSurfaceTexture2D<T> &CudaSurfaceTexture2D<T>::operator=(
+    CudaSurfaceTexture2D<T> &&other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  Base::operator=(other);
+
+  shared_object_ = std::move(other.shared_object_);
+
+  filter_mode_ = other.filter_mode_;
+  address_mode_ = other.address_mode_;
+  read_mode_ = other.read_mode_;
+  boundary_mode_ = other.boundary_mode_;
+
+  x_offset_ = other.x_offset_;
+  y_offset_ = other.y_offset_;
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaSurfaceTexture2D<T> &CudaSurfaceTexture2D<T>::operator=(
+    const T *host_array) {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaSurfaceTexture2D::Upload",
+                    2 * sizeof(T) * width_ * height_, device_, stream_, false);
+  const SizeType width_in_bytes = width_ * sizeof(T);
+  internal::SetDevice(device_);
+  StagingBufferPool<>::Instance().Upload(
+      host_array, width_in_bytes, height_, stream_,
+      [&](const void *src, size_t y, size_t num_rows, cudaStream_t stream) {
+        cudaMemcpy2DToArrayAsync(DeviceArray(), x_offset_ * sizeof(T),
+                                 y_offset_ + y, src, width_in_bytes,
+                                 width_in_bytes, num_rows,
+                                 cudaMemcpyHostToDevice, stream);
+      });
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaSurfaceTexture2D<T>::CopyTo(T *host_array) const {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaSurfaceTexture2D::Download",
+                    2 * sizeof(T) * width_ * height_, device_, stream_, false);
+  const SizeType width_in_bytes = width_ * sizeof(T);
+  internal::SetDevice(device_);
+  StagingBufferPool<>::Instance().Download(
+      host_array, width_in_bytes, height_, stream_,
+      [&](void *dst, size_t y, size_t num_rows, cudaStream_t stream) {
+        cudaMemcpy2DFromArrayAsync(dst, width_in_bytes, DeviceArray(),
+                                   x_offset_ * sizeof(T), y_offset_ + y,
+                                   width_in_bytes, num_rows,
+                                   cudaMemcpyDeviceToHost, stream);
+      });
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaSurfaceTexture2D<T>::CopyTo(CudaArray2D<T> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual2D(*this, *other);
+  if (device_ == other->Device()) {
+    internal::SetDevice(device_);
+    cudaMemcpy2DFromArray(other->ptr(), other->Pitch(), DeviceArray(),
+                          x_offset_ * sizeof(T), y_offset_, width_ * sizeof(T),
+                          height_, cudaMemcpyDeviceToDevice);
+  } else {
+    cudaMemcpy3DPeerParms params = {0};
+    params.dstDevice = other->Device();
+    params.dstPtr = other->GetPitchedPtr();
+    params.srcDevice = device_;
+    params.srcArray = DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, 0);
+    params.extent = make_cudaExtent(width_, height_, 1);
+    cudaMemcpy3DPeer(&params);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaSurfaceTexture2D<T>::CopyTo(CudaSurface2D<T> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual2D(*this, *other);
+  if (device_ == other->Device()) {
+    internal::SetDevice(device_);
+    cudaMemcpy2DArrayToArray(
+        other->DeviceArray(), other->XOffset() * sizeof(T), other->YOffset(),
+        DeviceArray(), x_offset_ * sizeof(T), y_offset_, width_ * sizeof(T),
+        height_, cudaMemcpyDeviceToDevice);
+  } else {
+    cudaMemcpy3DPeerParms params = {0};
+    params.dstDevice = other->Device();
+    params.dstArray = other->DeviceArray();
+    params.dstPos = make_cudaPos(other->XOffset(), other->YOffset(), 0);
+    params.srcDevice = device_;
+    params.srcArray = DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, 0);
+    params.extent = make_cudaExtent(width_, height_, 1);
+    cudaMemcpy3DPeer(&params);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaSurfaceTexture2D<T>::CopyTo(CudaTexture2D<T> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual2D(*this, *other);
+  if (device_ == other->Device()) {
+    internal::SetDevice(device_);
+    cudaMemcpy2DArrayToArray(other->DeviceArray(), 0, 0, DeviceArray(),
+                             x_offset_ * sizeof(T), y_offset_,
+                             width_ * sizeof(T), height_,
+                             cudaMemcpyDeviceToDevice);
+  } else {
+    cudaMemcpy3DPeerParms params = {0};
+    params.dstDevice = other->Device();
+    params.dstArray = other->DeviceArray();
+    params.dstPos = make_cudaPos(0, 0, 0);
+    params.srcDevice = device_;
+    params.srcArray = DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, 0);
+    params.extent = make_cudaExtent(width_, height_, 1);
+    cudaMemcpy3DPeer(&params);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaSurfaceTexture2D<T>::AssignAsync(const T *host_array) {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaSurfaceTexture2D::UploadAsync",
+                    2 * sizeof(T) * width_ * height_, device_, stream_, false);
+  const SizeType width_in_bytes = width_ * sizeof(T);
+  internal::SetDevice(device_);
+  cudaMemcpy2DToArrayAsync(DeviceArray(), x_offset_ * sizeof(T), y_offset_,
+                           host_array, width_in_bytes, width_in_bytes, height_,
+                           cudaMemcpyHostToDevice, stream_);
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaSurfaceTexture2D<T>::CopyToAsync(T *host_array) const {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaSurfaceTexture2D::DownloadAsync",
+                    2 * sizeof(T) * width_ * height_, device_, stream_, false);
+  const SizeType width_in_bytes = width_ * sizeof(T);
+  internal::SetDevice(device_);
+  cudaMemcpy2DFromArrayAsync(host_array, width_in_bytes, DeviceArray(),
+                             x_offset_ * sizeof(T), y_offset_, width_in_bytes,
+                             height_, cudaMemcpyDeviceToHost, stream_);
+  return CudaEvent::Record(stream_);
+}
+
+}  // namespace cua
+
+#endif  // LIBCUA_CUDA_SURFACE_TEXTURE2D_H_
@@ -0,0 +1,797 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef LIBCUA_CUDA_SURFACE_TEXTURE3D_H_
+#define LIBCUA_CUDA_SURFACE_TEXTURE3D_H_
+
+#include <utility>
+
+#include "cudaArray3DBase.h"
+#include "cudaSharedArrayObject.h"
+
+#include "cudaArray_fwd.h"
+#include "cudaEvent.h"
+#include "deviceView.h"
+#include "stagingBufferPool.h"
+#include "util.h"
+
+namespace cua {
+
+/**
+ * @class CudaSurfaceTexture3D
+ * @brief 3D array that is both a writable surface and a sampled texture.
+ *
+ * This is the 3D counterpart of CudaSurfaceTexture2D: a single cudaArray with
+ * surface load/store support, with a surface object for exact reads and
+ * writes (as with CudaSurface3D) and a texture object for sampling the same
+ * memory with interp() (as with CudaTexture3D). Values written through set()
+ * are visible to interp() only in subsequently launched kernels, and
+ * copy/assignment for CudaSurfaceTexture3D objects is a shallow operation.
+ *
+ * To access the array in your own kernels, pass its DeviceView() as the kernel
+ * parameter:
+ *
+ *     __global__ void device_kernel(
+ *         const CudaSurfaceTexture3DDeviceView<float> in,
+ *         CudaSurface3DDeviceView<float, std::false_type> out) {
+ *       const int x = blockIdx.x * blockDim.x + threadIdx.x;
+ *       const int y = blockIdx.y * blockDim.y + threadIdx.y;
+ *       const int z = blockIdx.z * blockDim.z + threadIdx.z;
+ *       out.set(x, y, z, in.interp(0.5f * x, 0.5f * y, 0.5f * z));
+ *     }
+ */
+template <typename T>
+class CudaSurfaceTexture3D : public CudaArray3DBase<CudaSurfaceTexture3D<T>> {
+ public:
+  friend class CudaArray3DBase<CudaSurfaceTexture3D<T>>;
+
+  /// datatype of the array
+  typedef T Scalar;
+
+  typedef CudaArray3DBase<CudaSurfaceTexture3D<T>> Base;
+  typedef typename Base::SizeType SizeType;
+  typedef typename Base::IndexType IndexType;
+
+ protected:
+  // for convenience, reference base class members directly (they are otherwise
+  // not in the current scope because CudaArray3DBase is templated)
+  using Base::width_;
+  using Base::height_;
+  using Base::depth_;
+  using Base::block_dim_;
+  using Base::grid_dim_;
+  using Base::device_;
+  using Base::stream_;
+
+ public:
+  //----------------------------------------------------------------------------
+  // constructors and destructor
+
+  /**
+   * Constructor.
+   * @param width number of elements in the first dimension of the array
+   * @param height number of elements in the second dimension of the array
+   * @param depth number of elements in the third dimension of the array
+   * @param filter_mode use cudaFilterModeLinear to allow for interpolation
+   * @param address_mode specifies how texture reads outside of the 3D extent
+   *   of the array are handled
+   * @param read_mode can also optionally specify this as
+   *   cudaReadModeNormalizedFloat
+   * @param block_dim default block size for CUDA kernel calls involving this
+   *   object, i.e., the values for blockDim.x/y/z; note that the default grid
+   *   dimension is computed automatically based on the array size
+   * @param stream CUDA stream for this array object
+   * @param boundary_mode boundary mode to use for surface reads that go
+   *   outside the 3D extents of the array
+   */
+  CudaSurfaceTexture3D(
+      SizeType width, SizeType height, SizeType depth,
+      const cudaTextureFilterMode filter_mode = cudaFilterModePoint,
+      const cudaTextureAddressMode address_mode = cudaAddressModeBorder,
+      const cudaTextureReadMode read_mode = cudaReadModeElementType,
+      const dim3 block_dim = CudaSurfaceTexture3D<T>::kBlockDim,
+      const cudaStream_t stream = 0,  // default stream
+      const cudaSurfaceBoundaryMode boundary_mode = cudaBoundaryModeZero)
+      : CudaSurfaceTexture3D(width, height, depth, internal::GetDevice(),
+                             filter_mode, address_mode, read_mode, block_dim,
+                             stream, boundary_mode) {}
+
+  /**
+   * Constructor.
+   * @param width number of elements in the first dimension of the array
+   * @param height number of elements in the second dimension of the array
+   * @param depth number of elements in the third dimension of the array
+   * @param device GPU on which this array is stored, or -1 for the current GPU
+   * @param filter_mode use cudaFilterModeLinear to allow for interpolation
+   * @param address_mode specifies how texture reads outside of the 3D extent
+   *   of the array are handled
+   * @param read_mode can also optionally specify this as
+   *   cudaReadModeNormalizedFloat
+   * @param block_dim default block size for CUDA kernel calls involving this
+   *   object, i.e., the values for blockDim.x/y/z; note that the default grid
+   *   dimension is computed automatically based on the array size
+   * @param stream CUDA stream for this array object
+   * @param boundary_mode boundary mode to use for surface reads that go
+   *   outside the 3D extents of the array
+   */
+  CudaSurfaceTexture3D(
+      SizeType width, SizeType height, SizeType depth, int device,
+      const cudaTextureFilterMode filter_mode = cudaFilterModePoint,
+      const cudaTextureAddressMode address_mode = cudaAddressModeBorder,
+      const cudaTextureReadMode read_mode = cudaReadModeElementType,
+      const dim3 block_dim = CudaSurfaceTexture3D<T>::kBlockDim,
+      const cudaStream_t stream = 0,  // default stream
+      const cudaSurfaceBoundaryMode boundary_mode = cudaBoundaryModeZero);
+
+  /**
+   * Host and device-level copy constructor. This is a shallow-copy operation,
+   * meaning that the underlying CUDA memory is the same for both arrays.
+   */
+  __host__ __device__
+  CudaSurfaceTexture3D(const CudaSurfaceTexture3D<T> &other);
+
+  /**
+   * Host-level move constructor. The underlying CUDA memory is handed over to
+   * the new array without updating its reference count, and other is left
+   * empty.
+   */
+  CudaSurfaceTexture3D(CudaSurfaceTexture3D<T> &&other);
+
+  ~CudaSurfaceTexture3D() {}
+
+  /**
+   * Create a view onto the underlying CUDA memory. This function assumes that
+   * the cropped view region is valid! Texture coordinates in the view are
+   * relative to its corner, as well.
+   * @param x x-coordinate for the top left of the view
+   * @param y y-coordinate for the top left of the view
+   * @param z z-coordinate for the top left of the view
+   * @param width width of the view
+   * @param height height of the view
+   * @param depth depth of the view
+   * @return new CudaSurfaceTexture3D view onto the same memory
+   */
+  inline CudaSurfaceTexture3D<T> View(IndexType x, IndexType y, IndexType z,
+                                      SizeType width, SizeType height,
+                                      SizeType depth) const {
+    return CudaSurfaceTexture3D<T>(x, y, z, width, height, depth, *this);
+  }
+
+  //----------------------------------------------------------------------------
+  // array operations
+
+  /**
+   * Create an empty array of the same size, and with the same texture
+   * settings, as the current array.
+   * @param device GPU on which this array is stored, or -1 for the current GPU
+   */
+  CudaSurfaceTexture3D<T> EmptyCopy(int device = -1) const;
+
+  /**
+   * Create an empty array with the same texture settings and with the axes of
+   * the current array reordered, e.g., a depth x width x height array for
+   * AxisPermutation::kZXY.
+   * @param permutation new order of the axes; see AxisPermutation
+   */
+  CudaSurfaceTexture3D<T> EmptyPermutedCopy(AxisPermutation permutation) const;
+
+  /**
+   * Shallow re-assignment of the given array to share the contents of another.
+   * @param other a separate array whose contents will now also be referenced by
+   *   the current array
+   * @return *this
+   */
+  CudaSurfaceTexture3D<T> &operator=(const CudaSurfaceTexture3D<T> &other);
+
+  /**
+   * Move assignment; as for the move constructor, other is left empty.
+   * @param other array whose contents will be referenced by the current array
+   * @return *this
+   */
+  CudaSurfaceTexture3D<T> &operator=(CudaSurfaceTexture3D<T> &&other);
+
+  /**
+   * Copy the contents of a CPU-bound memory array to the current array. This
+   * function assumes that the CPU array has the correct size!
+   * @param host_array the CPU-bound array
+   * @return *this
+   */
+  CudaSurfaceTexture3D<T> &operator=(const T *host_array);
+
+  /**
+   * Evaluate an element-wise array expression into the current array; see
+   * Assign().
+   * @param expression expression over arrays of the same size as this array
+   * @return *this
+   */
+  template <typename Expression>
+  inline CudaSurfaceTexture3D<T> &operator=(
+      const ArrayExpression<Expression> &expression) {
+    Base::Assign(expression);
+    return *this;
+  }
+
+  // copies into other arrays (see CudaArray3DBase)
+  using Base::CopyTo;
+
+  /**
+   * Copy the contents of the current array to a CPU-bound memory array. This
+   * function assumes that the CPU array has the correct size!
+   * @param host_array the CPU-bound array
+   */
+  void CopyTo(T *host_array) const;
+
+  /**
+   * Copy to an array.
+   * @param other destination array
+   */
+  void CopyTo(CudaArray3D<T> *other) const;
+
+  /**
+   * Copy to a surface.
+   * @param other destination surface
+   */
+  template <typename OtherDerived>
+  void CopyTo(CudaSurface3DBase<OtherDerived> *other) const;
+
+  /**
+   * Copy to a texture.
+   * @param other destination texture
+   */
+  template <typename OtherDerived>
+  void CopyTo(CudaTexture3DBase<OtherDerived> *other) const;
+
+  /**
+   * Asynchronously copy the contents of a densely packed CPU array to the
+   * current array on the array's stream. This function assumes that the CPU
+   * array has the correct size!
+   * @param host_array the CPU-bound array
+   * @return event that completes with the copy
+   */
+  CudaEvent AssignAsync(const T *host_array);
+
+  /**
+   * Asynchronously copy the contents of the current array to a densely packed
+   * CPU array on the array's stream. This function assumes that the CPU array
+   * has the correct size!
+   * @param host_array the CPU-bound array
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(T *host_array) const;
+
+  //----------------------------------------------------------------------------
+  // getters/setters
+
+  /**
+   * Device-level function for setting an element in an array through the
+   * surface object
+   * @param x first coordinate
+   * @param y second coordinate
+   * @param z third coordinate
+   * @param v the new value to assign to array(x, y, z)
+   */
+  __device__ inline void set(const int x, const int y, const int z, const T v) {
+    surf3Dwrite(v, shared_object_.SurfaceObject(), sizeof(T) * (x + x_offset_),
+                y + y_offset_, z + z_offset_, boundary_mode_);
+  }
+
+  /**
+   * Device-level function for getting an element in an array through the
+   * surface object
+   * @param x first coordinate
+   * @param y second coordinate
+   * @param z third coordinate
+   * @return the value at array(x, y, z)
+   */
+  __device__ inline T get(const int x, const int y, const int z) const {
+    return surf3Dread<T>(shared_object_.SurfaceObject(),
+                         sizeof(T) * (x + x_offset_), y + y_offset_,
+                         z + z_offset_, boundary_mode_);
+  }
+
+  /**
+   * Device-level function for sampling the array through the texture object;
+   * see CudaTexture3D::interp().
+   * @param x first coordinate
+   * @param y second coordinate
+   * @param z third coordinate
+   * @return the interpolated value at array(x, y, z)
+   */
+  template <typename ReturnType = T>
+  __device__ inline ReturnType interp(const float x, const float y,
+                                      const float z) const {
+    return tex3D<ReturnType>(shared_object_.TextureObject(), x + x_offset_,
+                             y + y_offset_, z + z_offset_);
+  }
+
+  /**
+   * @return the underlying cudaArray object shared by the surface and texture
+   */
+  inline cudaArray *DeviceArray() const {
+    return shared_object_.DeviceArray();
+  }
+
+  /**
+   * @return the boundary mode for the underlying CUDA Surface object
+   */
+  __host__ __device__ inline cudaSurfaceBoundaryMode BoundaryMode() const {
+    return boundary_mode_;
+  }
+
+  /**
+   * set the boundary mode for the underlying CUDA Surface object
+   */
+  __host__ __device__ inline void SetBoundaryMode(
+      const cudaSurfaceBoundaryMode boundary_mode) {
+    boundary_mode_ = boundary_mode;
+  }
+
+  /**
+   * @return the x offset for the underlying memory, or zero if the object is
+   *   not a view
+   */
+  __host__ __device__ inline IndexType XOffset() const { return x_offset_; }
+
+  /**
+   * @return the y offset for the underlying memory, or zero if the object is
+   *   not a view
+   */
+  __host__ __device__ inline IndexType YOffset() const { return y_offset_; }
+
+  /**
+   * @return the z offset for the underlying memory, or zero if the object is
+   *   not a view
+   */
+  __host__ __device__ inline IndexType ZOffset() const { return z_offset_; }
+
+  /**
+   * @return trivially copyable view of the array for kernel parameter lists
+   */
+  __host__ __device__ inline CudaSurfaceTexture3DDeviceView<T> DeviceView()
+      const {
+    return CudaSurfaceTexture3DDeviceView<T>(
+        shared_object_.SurfaceObject(), shared_object_.TextureObject(), width_,
+        height_, depth_, x_offset_, y_offset_, z_offset_, boundary_mode_);
+  }
+
+  //----------------------------------------------------------------------------
+  // private class methods and fields
+
+ private:
+  /**
+   * Internal constructor used for creating views.
+   * @param x x-coordinate for the top left of the view
+   * @param y y-coordinate for the top left of the view
+   * @param z z-coordinate for the top left of the view
+   * @param width width of the view
+   * @param height height of the view
+   * @param depth depth of the view
+   */
+  CudaSurfaceTexture3D(IndexType x, IndexType y, IndexType z, SizeType width,
+                       SizeType height, SizeType depth,
+                       const CudaSurfaceTexture3D<T> &other);
+
+  CudaSharedSurfaceTextureObject<T> shared_object_;
+
+  cudaTextureFilterMode filter_mode_;
+  cudaTextureAddressMode address_mode_;
+  cudaTextureReadMode read_mode_;
+
+  cudaSurfaceBoundaryMode boundary_mode_;
+
+  IndexType x_offset_, y_offset_, z_offset_;  // = 0 if not using a view
+};
+
+//------------------------------------------------------------------------------
+// template typedef for CRTP model, a la Eigen
+
+template <typename T>
+struct CudaArrayTraits<CudaSurfaceTexture3D<T>> {
+  typedef T Scalar;
+  typedef bool Mutable;
+  typedef CudaSurfaceTexture3DDeviceView<T> DeviceView;
+};
+
+//------------------------------------------------------------------------------
+//
+// public method implementations
+//
+//------------------------------------------------------------------------------
+
+template <typename T>
+CudaSurfaceTexture3D<T>::CudaSurfaceTexture3D<T>(
+    SizeType width, SizeType height, SizeType depth, int device,
+    const cudaTextureFilterMode filter_mode,
+    const cudaTextureAddressMode address_mode,
+    const cudaTextureReadMode read_mode, const dim3 block_dim,
+    const cudaStream_t stream, const cudaSurfaceBoundaryMode boundary_mode)
+    : Base(width, height, depth, device, block_dim, stream),
+      shared_object_(width, height, depth, filter_mode, address_mode,
+                     read_mode),
+      filter_mode_(filter_mode),
+      address_mode_(address_mode),
+      read_mode_(read_mode),
+      boundary_mode_(boundary_mode),
+      x_offset_(0),
+      y_offset_(0),
+      z_offset_(0) {}
+
+//------------------------------------------------------------------------------
+
+// host- and device-level copy constructor
+template <typename T>
+__host__ __device__ CudaSurfaceTexture3D<T>::CudaSurfaceTexture3D<T>(
+    const CudaSurfaceTexture3D<T> &other)
+    : Base(other),
+      shared_object_(other.shared_object_),
+      filter_mode_(other.filter_mode_),
+      address_mode_(other.address_mode_),
+      read_mode_(other.read_mode_),
+      boundary_mode_(other.boundary_mode_),
+      x_offset_(other.x_offset_),
+      y_offset_(other.y_offset_),
+      z_offset_(other.z_offset_) {}
+
+//------------------------------------------------------------------------------
+
+// host-level move constructor
+template <typename T>
+CudaSurfaceTexture3D<T>::CudaSurfaceTexture3D<T>(
+    CudaSurfaceTexture3D<T> &&other)
+    : Base(other),
+      shared_object_(std::move(other.shared_object_)),
+      filter_mode_(other.filter_mode_),
+      address_mode_(other.address_mode_),
+      read_mode_(other.read_mode_),
+      boundary_mode_(other.boundary_mode_),
+      x_offset_(other.x_offset_),
+      y_offset_(other.y_offset_),
+      z_offset_(other.z_offset_) {}
+
+//------------------------------------------------------------------------------
+
+// host-level private constructor for creating views
+template <typename T>
+CudaSurfaceTexture3D<T>::CudaSurfaceTexture3D<T>(
+    IndexType x, IndexType y, IndexType z, SizeType width, SizeType height,
+    SizeType depth, const CudaSurfaceTexture3D<T> &other)
+    : Base(width, height, depth, other.device_, other.block_dim_,
+           other.stream_),
+      shared_object_(other.shared_object_),
+      filter_mode_(other.filter_mode_),
+      address_mode_(other.address_mode_),
+      read_mode_(other.read_mode_),
+      boundary_mode_(other.boundary_mode_),
+      x_offset_(x + other.x_offset_),
+      y_offset_(y + other.y_offset_),
+      z_offset_(z + other.z_offset_) {}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaSurfaceTexture3D<T> CudaSurfaceTexture3D<T>::EmptyCopy(
+    int device) const {
+  if (device == -1) {
+    device = device_;
+  }
+  return CudaSurfaceTexture3D<T>(width_, height_, depth_, device,
+                                 filter_mode_, address_mode_, read_mode_,
+                                 block_dim_, stream_, boundary_mode_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaSurfaceTexture3D<T> CudaSurfaceTexture3D<T>::EmptyPermutedCopy(
+    AxisPermutation permutation) const {
+  const SizeType sizes[3] = {width_, height_, depth_};
+  return CudaSurfaceTexture3D<T>(
+      sizes[internal::PermutedAxis(permutation, 0)],
+      sizes[internal::PermutedAxis(permutation, 1)],
+      sizes[internal::PermutedAxis(permutation, 2)], device_, filter_mode_,
+      address_mode_, read_mode_, block_dim_, stream_, boundary_mode_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaSurfaceTexture3D<T> &CudaSurfaceTexture3D<T>::operator=(
+    const CudaSurfaceTexture3D<T> &other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  Base::operator=(other);
+
+  shared_object_ = other.shared_object_;
+
+  filter_mode_ = other.filter_mode_;
+  address_mode_ = other.address_mode_;
+  read_mode_ = other.read_mode_;
+  boundary_mode_ = other.boundary_mode_;
+
+  x_offset_ = other.x_offset_;
+  y_offset_ = other.y_offset_;
+  z_offset_ = other.z_offset_;
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaSurfaceTexture3D<T> &CudaSurfaceTexture3D<T>::operator=(
+    CudaSurfaceTexture3D<T> &&other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  Base::operator=(other);
+
+  shared_object_ = std::move(other.shared_object_);
+
+  filter_mode_ = other.filter_mode_;
+  address_mode_ = other.address_mode_;
+  read_mode_ = other.read_mode_;
+  boundary_mode_ = other.boundary_mode_;
+
+  x_offset_ = other.x_offset_;
+  y_offset_ = other.y_offset_;
+  z_offset_ = other.z_offset_;
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaSurfaceTexture3D<T> &CudaSurfaceTexture3D<T>::operator=(
+    const T *host_array) {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaSurfaceTexture3D::Upload",
+                    2 * sizeof(T) * width_ * height_ * depth_, device_,
+                    stream_, false);
+  internal::SetDevice(device_);
+
+  const size_t width_in_bytes = width_ * sizeof(T);
+  StagingBufferPool<>::Instance().Upload(
+      host_array, width_in_bytes, static_cast<size_t>(height_) * depth_,
+      stream_,
+      [&](const void *src, size_t first_row, size_t num_rows,
+          cudaStream_t stream) {
+        internal::ForEachSliceRun(
+            first_row, num_rows, height_,
+            [&](size_t y, size_t z, size_t n, size_t offset) {
+              cudaMemcpy3DParms params = {0};
+              params.srcPtr = make_cudaPitchedPtr(
+                  const_cast<char *>(reinterpret_cast<const char *>(src)) +
+                      offset * width_in_bytes,
+                  width_in_bytes, width_, n);
+              params.dstArray = DeviceArray();
+              params.dstPos =
+                  make_cudaPos(x_offset_, y_offset_ + y, z_offset_ + z);
+              params.extent = make_cudaExtent(width_, n, 1);
+              params.kind = cudaMemcpyHostToDevice;
+              cudaMemcpy3DAsync(&params, stream);
+            });
+      });
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaSurfaceTexture3D<T>::CopyTo(T *host_array) const {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaSurfaceTexture3D::Download",
+                    2 * sizeof(T) * width_ * height_ * depth_, device_,
+                    stream_, false);
+  internal::SetDevice(device_);
+
+  const size_t width_in_bytes = width_ * sizeof(T);
+  StagingBufferPool<>::Instance().Download(
+      host_array, width_in_bytes, static_cast<size_t>(height_) * depth_,
+      stream_,
+      [&](void *dst, size_t first_row, size_t num_rows, cudaStream_t stream) {
+        internal::ForEachSliceRun(
+            first_row, num_rows, height_,
+            [&](size_t y, size_t z, size_t n, size_t offset) {
+              cudaMemcpy3DParms params = {0};
+              params.srcArray = DeviceArray();
+              params.srcPos =
+                  make_cudaPos(x_offset_, y_offset_ + y, z_offset_ + z);
+              params.dstPtr = make_cudaPitchedPtr(
+                  reinterpret_cast<char *>(dst) + offset * width_in_bytes,
+                  width_in_bytes, width_, n);
+              params.extent = make_cudaExtent(width_, n, 1);
+              params.kind = cudaMemcpyDeviceToHost;
+              cudaMemcpy3DAsync(&params, stream);
+            });
+      });
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline void CudaSurfaceTexture3D<T>::CopyTo(CudaArray3D<T> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual3D(*this, *other);
+  internal::SetDevice(device_);
+
+  if (device_ == other->Device()) {
+    cudaMemcpy3DParms params = {0};
+    params.srcArray = DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, z_offset_);
+    params.dstPtr = other->GetPitchedPtr();
+    params.extent = make_cudaExtent(width_, height_, depth_);
+    params.kind = cudaMemcpyDeviceToDevice;
+
+    cudaMemcpy3D(&params);
+  } else {
+    cudaMemcpy3DPeerParms params = {0};
+    params.srcDevice = device_;
+    params.dstDevice = other->Device();
+    params.srcArray = DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, z_offset_);
+    params.dstPtr = other->GetPitchedPtr();
+    params.extent = make_cudaExtent(width_, height_, depth_);
+
+    cudaMemcpy3DPeer(&params);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+template <typename OtherDerived>
+inline void CudaSurfaceTexture3D<T>::CopyTo(
+    CudaSurface3DBase<OtherDerived> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual3D(*this, *other);
+  internal::SetDevice(device_);
+
+  if (device_ == other->Device()) {
+    cudaMemcpy3DParms params = {0};
+    params.srcArray = DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, z_offset_);
+    params.dstArray = other->DeviceArray();
+    params.dstPos =
+        make_cudaPos(other->XOffset(), other->YOffset(), other->ZOffset());
+    params.extent = make_cudaExtent(width_, height_, depth_);
+    params.kind = cudaMemcpyDeviceToDevice;
+
+    cudaMemcpy3D(&params);
+  } else {
+    cudaMemcpy3DPeerParms params = {0};
+    params.srcDevice = device_;
+    params.dstDevice = other->Device();
+    params.srcArray = DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, z_offset_);
+    params.dstArray = other->DeviceArray();
+    params.dstPos =
+        make_cudaPos(other->XOffset(), other->YOffset(), other->ZOffset());
+    params.extent = make_cudaExtent(width_, height_, depth_);
+
+    cudaMemcpy3DPeer(&params);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+template <typename OtherDerived>
+inline void CudaSurfaceTexture3D<T>::CopyTo(
+    CudaTexture3DBase<OtherDerived> *other) const {
+  internal::CheckNotNull(other);
+  internal::CheckSizeEqual3D(*this, *other);
+  internal::SetDevice(device_);
+
+  if (device_ == other->Device()) {
+    cudaMemcpy3DParms params = {0};
+    params.srcArray = DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, z_offset_);
+    params.dstArray = other->DeviceArray();
+    params.dstPos = make_cudaPos(0, 0, 0);
+    params.extent = make_cudaExtent(width_, height_, depth_);
+    params.kind = cudaMemcpyDeviceToDevice;
+
+    cudaMemcpy3D(&params);
+  } else {
+    cudaMemcpy3DPeerParms params = {0};
+    params.srcDevice = device_;
+    params.dstDevice = other->Device();
+    params.srcArray = DeviceArray();
+    params.srcPos = make_cudaPos(x_offset_, y_offset_, z_offset_);
+    params.dstArray = other->DeviceArray();
+    params.dstPos = make_cudaPos(0, 0, 0);
+    params.extent = make_cudaExtent(width_, height_, depth_);
+
+    cudaMemcpy3DPeer(&params);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaSurfaceTexture3D<T>::AssignAsync(const T *host_array) {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaSurfaceTexture3D::UploadAsync",
+                    2 * sizeof(T) * width_ * height_ * depth_, device_,
+                    stream_, false);
+  internal::SetDevice(device_);
+
+  const size_t width_in_bytes = width_ * sizeof(T);
+  cudaMemcpy3DParms params = {0};
+  params.srcPtr = make_cudaPitchedPtr(const_cast<T *>(host_array),
+                                      width_in_bytes, width_, height_);
+  params.dstArray = DeviceArray();
+  params.dstPos = make_cudaPos(x_offset_, y_offset_, z_offset_);
+  params.extent = make_cudaExtent(width_, height_, depth_);
+  params.kind = cudaMemcpyHostToDevice;
+
+  cudaMemcpy3DAsync(&params, stream_);
+
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaSurfaceTexture3D<T>::CopyToAsync(T *host_array) const {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaSurfaceTexture3D::DownloadAsync",
+                    2 * sizeof(T) * width_ * height_ * depth_, device_,
+                    stream_, false);
+  internal::SetDevice(device_);
+
+  const size_t width_in_bytes = width_ * sizeof(T);
+  cudaMemcpy3DParms params = {0};
+  params.srcArray = DeviceArray();
+  params.srcPos = make_cudaPos(x_offset_, y_offset_, z_offset_);
+  params.dstPtr =
+      make_cudaPitchedPtr(host_array, width_in_bytes, width_, height_);
+  params.extent = make_cudaExtent(width_, height_, depth_);
+  params.kind = cudaMemcpyDeviceToHost;
+
+  cudaMemcpy3DAsync(&params, stream_);
+
+  return CudaEvent::Record(stream_);
+}
+
+}  // namespace cua
+
+#endif  // LIBCUA_CUDA_SURFACE_TEXTURE3D_H_
@@ -36,8 +36,13 @@
 #ifndef LIBCUA_CUDA_TEXTURE2D_H_
 #define LIBCUA_CUDA_TEXTURE2D_H_
 
+#include <utility>
+
 #include "cudaArray2DBase.h"
+#include "cudaEvent.h"
+#include "deviceView.h"
 #include "cudaSharedArrayObject.h"
+#include "stagingBufferPool.h"
 #include "util.h"
 
 namespace cua {
@@ -50,18 +55,19 @@ namespace cua {
  * These arrays are read-only, and copy for CudaTexture2D objects is a shallow
  * operation.
  *
- * The arrays can be directly passed into device-level code, i.e., you can write
- * kernels that have CudaTexture2D objects in their parameter lists:
+ * To access the array in your own kernels, pass its DeviceView() (the texture
+ * object handle and extents) as the kernel parameter:
  *
- *     __global__ void device_kernel(const CudaTexture2D<float> in,
- *                                   CudaSurface2D<float> out) {
+ *     __global__ void device_kernel(const CudaTexture2DDeviceView<float> in,
+ *                                   CudaSurface2DDeviceView<float> out) {
  *       const int x = blockIdx.x * blockDim.x + threadIdx.x;
  *       const int y = blockIdx.y * blockDim.y + threadIdx.y;
  *       out.set(x, y, in.get(x, y));
  *     }
  *
- * TODO (True): mipmaps, etc. would be useful, as well as texture-coordinate
- *   lookups, etc.
+ * For mipmapped textures, see CudaMipmappedTexture2D.
+ *
+ * TODO (True): texture-coordinate lookups, etc. would be useful.
  */
 template <typename T>
 class CudaTexture2D : public CudaArray2DBase<CudaTexture2D<T>> {
@@ -146,6 +152,13 @@ class CudaTexture2D : public CudaArray2DBase<CudaTexture2D<T>> {
    */
   __host__ __device__ CudaTexture2D(const CudaTexture2D<T> &other);
 
+  /**
+   * Host-level move constructor. The underlying CUDA memory is handed over to
+   * the new array without updating its reference count, and other is left
+   * empty.
+   */
+  CudaTexture2D(CudaTexture2D<T> &&other);
+
   ~CudaTexture2D() {}
 
   //----------------------------------------------------------------------------
@@ -159,6 +172,13 @@ class CudaTexture2D : public CudaArray2DBase<CudaTexture2D<T>> {
    */
   CudaTexture2D<T> &operator=(const CudaTexture2D<T> &other);
 
+  /**
+   * Move assignment; as for the move constructor, other is left empty.
+   * @param other array whose contents will be referenced by the current array
+   * @return *this
+   */
+  CudaTexture2D<T> &operator=(CudaTexture2D<T> &&other);
+
   /**
    * Copy the contents of a CPU-bound memory array to the current array. This
    * function assumes that the CPU array has the correct size!
@@ -174,6 +194,24 @@ class CudaTexture2D : public CudaArray2DBase<CudaTexture2D<T>> {
    */
   void CopyTo(T *host_array) const;
 
+  /**
+   * Asynchronously copy the contents of a densely packed CPU array to the
+   * current array on the array's stream. This function assumes that the CPU
+   * array has the correct size!
+   * @param host_array the CPU-bound array
+   * @return event that completes with the copy
+   */
+  CudaEvent AssignAsync(const T *host_array);
+
+  /**
+   * Asynchronously copy the contents of the current array to a densely packed
+   * CPU array on the array's stream. This function assumes that the CPU array
+   * has the correct size!
+   * @param host_array the CPU-bound array
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(T *host_array) const;
+
   //----------------------------------------------------------------------------
   // getters
 
@@ -213,6 +251,14 @@ class CudaTexture2D : public CudaArray2DBase<CudaTexture2D<T>> {
     return shared_texture_.DeviceArray();
   }
 
+  /**
+   * @return trivially copyable view of the array for kernel parameter lists
+   */
+  __host__ __device__ inline CudaTexture2DDeviceView<T> DeviceView() const {
+    return CudaTexture2DDeviceView<T>(shared_texture_.CudaApiObject(), width_,
+                                      height_);
+  }
+
  private:
   CudaSharedTextureObject<T> shared_texture_;
 };
@@ -223,6 +269,7 @@ class CudaTexture2D : public CudaArray2DBase<CudaTexture2D<T>> {
 template <typename T>
 struct CudaArrayTraits<CudaTexture2D<T>> {
   typedef T Scalar;
+  typedef CudaTexture2DDeviceView<T> DeviceView;
 };
 
 //------------------------------------------------------------------------------
@@ -251,6 +298,13 @@ CudaTexture2D<T>::CudaTexture2D<T>(const CudaTexture2D<T> &other)
 
 //------------------------------------------------------------------------------
 
+// host-level move constructor
+template <typename T>
+CudaTexture2D<T>::CudaTexture2D<T>(CudaTexture2D<T> &&other)
+    : Base(other), shared_texture_(std::move(other.shared_texture_)) {}
+
+//------------------------------------------------------------------------------
+
 template <typename T>
 inline CudaTexture2D<T> &CudaTexture2D<T>::operator=(
     const CudaTexture2D<T> &other) {
@@ -267,13 +321,35 @@ inline CudaTexture2D<T> &CudaTexture2D<T>::operator=(
 
 //------------------------------------------------------------------------------
 
+template <typename T>
+inline CudaTexture2D<T> &CudaTexture2D<T>::operator=(CudaTexture2D<T> &&other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  Base::operator=(other);
+
+  shared_texture_ = std::move(other.shared_texture_);
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
 template <typename T>
 inline CudaTexture2D<T> &CudaTexture2D<T>::operator=(const T *host_array) {
   internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaTexture2D::Upload", 2 * sizeof(T) * width_ * height_,
+                    device_, stream_, false);
   const SizeType width_in_bytes = width_ * sizeof(T);
   internal::SetDevice(device_);
-  cudaMemcpy2DToArray(DeviceArray(), 0, 0, host_array, width_in_bytes,
-                      width_in_bytes, height_, cudaMemcpyHostToDevice);
+  StagingBufferPool<>::Instance().Upload(
+      host_array, width_in_bytes, height_, stream_,
+      [&](const void *src, size_t y, size_t num_rows, cudaStream_t stream) {
+        cudaMemcpy2DToArrayAsync(DeviceArray(), 0, y, src, width_in_bytes,
+                                 width_in_bytes, num_rows,
+                                 cudaMemcpyHostToDevice, stream);
+      });
 
   return *this;
 }
@@ -283,10 +359,47 @@ inline CudaTexture2D<T> &CudaTexture2D<T>::operator=(const T *host_array) {
 template <typename T>
 inline void CudaTexture2D<T>::CopyTo(T *host_array) const {
   internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaTexture2D::Download", 2 * sizeof(T) * width_ * height_,
+                    device_, stream_, false);
+  const SizeType width_in_bytes = width_ * sizeof(T);
+  internal::SetDevice(device_);
+  StagingBufferPool<>::Instance().Download(
+      host_array, width_in_bytes, height_, stream_,
+      [&](void *dst, size_t y, size_t num_rows, cudaStream_t stream) {
+        cudaMemcpy2DFromArrayAsync(dst, width_in_bytes, DeviceArray(), 0, y,
+                                   width_in_bytes, num_rows,
+                                   cudaMemcpyDeviceToHost, stream);
+      });
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaTexture2D<T>::AssignAsync(const T *host_array) {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaTexture2D::UploadAsync",
+                    2 * sizeof(T) * width_ * height_, device_, stream_, false);
+  const SizeType width_in_bytes = width_ * sizeof(T);
+  internal::SetDevice(device_);
+  cudaMemcpy2DToArrayAsync(DeviceArray(), 0, 0, host_array, width_in_bytes,
+                           width_in_bytes, height_, cudaMemcpyHostToDevice,
+                           stream_);
+  return CudaEvent::Record(stream_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+inline CudaEvent CudaTexture2D<T>::CopyToAsync(T *host_array) const {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaTexture2D::DownloadAsync",
+                    2 * sizeof(T) * width_ * height_, device_, stream_, false);
   const SizeType width_in_bytes = width_ * sizeof(T);
   internal::SetDevice(device_);
-  cudaMemcpy2DFromArray(host_array, width_in_bytes, DeviceArray(), 0, 0,
-                        width_in_bytes, height_, cudaMemcpyDeviceToHost);
+  cudaMemcpy2DFromArrayAsync(host_array, width_in_bytes, DeviceArray(), 0, 0,
+                             width_in_bytes, height_, cudaMemcpyDeviceToHost,
+                             stream_);
+  return CudaEvent::Record(stream_);
 }
 
 }  // namespace cua
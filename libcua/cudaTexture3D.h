@@ -36,8 +36,14 @@
 #ifndef LIBCUA_CUDA_TEXTURE3D_H_
 #define LIBCUA_CUDA_TEXTURE3D_H_
 
+#include <utility>
+
 #include "cudaArray3DBase.h"
+#include "cudaEvent.h"
 #include "cudaSharedArrayObject.h"
+#include "deviceView.h"
+
+#include "stagingBufferPool.h"
 
 namespace cua {
 
@@ -52,19 +58,22 @@ namespace cua {
  * Derived classes implement array access for both layered 2D (that is, an array
  * of 2D arrays) and 3D texture-memory arrays.
  *
- * The arrays can be directly passed into device-level code, i.e., you can write
- * kernels that have CudaTexture2D objects in their parameter lists:
+ * To access the array in your own kernels, pass its DeviceView() as the kernel
+ * parameter; the view type is CudaTexture3DDeviceView<T, IsLayered>, with
+ * IsLayered = std::true_type for CudaTexture2DArray:
  *
- *     __global__ void device_kernel(const CudaTexture3D<float> in,
- *                                   CudaSurface3D<float> out) {
+ *     __global__ void device_kernel(
+ *         const CudaTexture3DDeviceView<float, std::false_type> in,
+ *         CudaSurface3DDeviceView<float, std::false_type> out) {
  *       const int x = blockIdx.x * blockDim.x + threadIdx.x;
  *       const int y = blockIdx.y * blockDim.y + threadIdx.y;
  *       const int z = blockIdx.z * blockDim.z + threadIdx.z;
  *       out.set(x, y, z, in.get(x, y, z));
  *     }
  *
- * TODO (True): mipmaps, etc. would be useful, as well as texture-coordinate
- *   lookups, etc.
+ * For mipmapped textures, see CudaMipmappedTexture3D.
+ *
+ * TODO (True): texture-coordinate lookups, etc. would be useful.
  */
 template <typename Derived>
 class CudaTexture3DBase : public CudaArray3DBase<Derived> {
@@ -152,6 +161,13 @@ class CudaTexture3DBase : public CudaArray3DBase<Derived> {
   __host__ __device__
   CudaTexture3DBase(const CudaTexture3DBase<Derived> &other);
 
+  /**
+   * Host-level move constructor. The underlying CUDA memory is handed over to
+   * the new array without updating its reference count, and other is left
+   * empty.
+   */
+  CudaTexture3DBase(CudaTexture3DBase<Derived> &&other);
+
   //----------------------------------------------------------------------------
   // array operations
 
@@ -164,6 +180,13 @@ class CudaTexture3DBase : public CudaArray3DBase<Derived> {
   CudaTexture3DBase<Derived> &operator=(
       const CudaTexture3DBase<Derived> &other);
 
+  /**
+   * Move assignment; as for the move constructor, other is left empty.
+   * @param other array whose contents will be referenced by the current array
+   * @return *this
+   */
+  CudaTexture3DBase<Derived> &operator=(CudaTexture3DBase<Derived> &&other);
+
   /**
    * Copy the contents of a CPU-bound memory array to the current array. This
    * function assumes that the CPU array has the correct size!
@@ -179,6 +202,24 @@ class CudaTexture3DBase : public CudaArray3DBase<Derived> {
    */
   void CopyTo(Scalar *host_array) const;
 
+  /**
+   * Asynchronously copy the contents of a densely packed CPU array to the
+   * current array on the array's stream. This function assumes that the CPU
+   * array has the correct size!
+   * @param host_array the CPU-bound array
+   * @return event that completes with the copy
+   */
+  CudaEvent AssignAsync(const Scalar *host_array);
+
+  /**
+   * Asynchronously copy the contents of the current array to a densely packed
+   * CPU array on the array's stream. This function assumes that the CPU array
+   * has the correct size!
+   * @param host_array the CPU-bound array
+   * @return event that completes with the copy
+   */
+  CudaEvent CopyToAsync(Scalar *host_array) const;
+
   /**
    * @return the underlying cudaArray object for this texture
    */
@@ -186,6 +227,14 @@ class CudaTexture3DBase : public CudaArray3DBase<Derived> {
     return shared_texture_.DeviceArray();
   }
 
+  /**
+   * @return trivially copyable view of the array for kernel parameter lists
+   */
+  __host__ __device__ inline typename Base::DeviceViewType DeviceView() const {
+    return typename Base::DeviceViewType(shared_texture_.CudaApiObject(),
+                                         width_, height_, depth_);
+  }
+
  protected:
   //
   // protected class fields
@@ -221,6 +270,14 @@ __host__ __device__ CudaTexture3DBase<Derived>::CudaTexture3DBase<Derived>(
 
 //------------------------------------------------------------------------------
 
+// host-level move constructor
+template <typename Derived>
+CudaTexture3DBase<Derived>::CudaTexture3DBase<Derived>(
+    CudaTexture3DBase<Derived> &&other)
+    : Base(other), shared_texture_(std::move(other.shared_texture_)) {}
+
+//------------------------------------------------------------------------------
+
 template <typename Derived>
 inline CudaTexture3DBase<Derived> &CudaTexture3DBase<Derived>::operator=(
     const CudaTexture3DBase<Derived> &other) {
@@ -237,38 +294,131 @@ inline CudaTexture3DBase<Derived> &CudaTexture3DBase<Derived>::operator=(
 
 //------------------------------------------------------------------------------
 
+template <typename Derived>
+inline CudaTexture3DBase<Derived> &CudaTexture3DBase<Derived>::operator=(
+    CudaTexture3DBase<Derived> &&other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  Base::operator=(other);
+
+  shared_texture_ = std::move(other.shared_texture_);
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
 template <typename Derived>
 inline CudaTexture3DBase<Derived> &CudaTexture3DBase<Derived>::operator=(
     const Scalar *host_array) {
   internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaTexture3D::Upload",
+                    2 * sizeof(Scalar) * width_ * height_ * depth_, device_,
+                    stream_, false);
   internal::SetDevice(device_);
+  const size_t width_in_bytes = width_ * sizeof(Scalar);
+  StagingBufferPool<>::Instance().Upload(
+      host_array, width_in_bytes, static_cast<size_t>(height_) * depth_,
+      stream_,
+      [&](const void *src, size_t first_row, size_t num_rows,
+          cudaStream_t stream) {
+        internal::ForEachSliceRun(
+            first_row, num_rows, height_,
+            [&](size_t y, size_t z, size_t n, size_t offset) {
+              cudaMemcpy3DParms params = {0};
+              params.srcPtr = make_cudaPitchedPtr(
+                  const_cast<char *>(reinterpret_cast<const char *>(src)) +
+                      offset * width_in_bytes,
+                  width_in_bytes, width_, n);
+              params.dstArray = shared_texture_.DeviceArray();
+              params.dstPos = make_cudaPos(0, y, z);
+              params.extent = make_cudaExtent(width_, n, 1);
+              params.kind = cudaMemcpyHostToDevice;
+              cudaMemcpy3DAsync(&params, stream);
+            });
+      });
+
+  return *this;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Derived>
+inline void CudaTexture3DBase<Derived>::CopyTo(
+    CudaTexture3DBase<Derived>::Scalar *host_array) const {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaTexture3D::Download",
+                    2 * sizeof(Scalar) * width_ * height_ * depth_, device_,
+                    stream_, false);
+  internal::SetDevice(device_);
+  const size_t width_in_bytes = width_ * sizeof(Scalar);
+  StagingBufferPool<>::Instance().Download(
+      host_array, width_in_bytes, static_cast<size_t>(height_) * depth_,
+      stream_,
+      [&](void *dst, size_t first_row, size_t num_rows, cudaStream_t stream) {
+        internal::ForEachSliceRun(
+            first_row, num_rows, height_,
+            [&](size_t y, size_t z, size_t n, size_t offset) {
+              cudaMemcpy3DParms params = {0};
+              params.srcArray = shared_texture_.DeviceArray();
+              params.srcPos = make_cudaPos(0, y, z);
+              params.dstPtr = make_cudaPitchedPtr(
+                  reinterpret_cast<char *>(dst) + offset * width_in_bytes,
+                  width_in_bytes, width_, n);
+              params.extent = make_cudaExtent(width_, n, 1);
+              params.kind = cudaMemcpyDeviceToHost;
+              cudaMemcpy3DAsync(&params, stream);
+            });
+      });
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Derived>
+inline CudaEvent CudaTexture3DBase<Derived>::AssignAsync(
+    const Scalar *host_array) {
+  internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaTexture3D::UploadAsync",
+                    2 * sizeof(Scalar) * width_ * height_ * depth_, device_,
+                    stream_, false);
+  internal::SetDevice(device_);
+  const size_t width_in_bytes = width_ * sizeof(Scalar);
   cudaMemcpy3DParms params = {0};
-  params.srcPtr = make_cudaPitchedPtr(const_cast<Scalar *>(host_array),
-                                      width_ * sizeof(Scalar), width_, height_);
+  params.srcPtr =
+      make_cudaPitchedPtr(const_cast<Scalar *>(host_array), width_in_bytes,
+                          width_, height_);
   params.dstArray = shared_texture_.DeviceArray();
+  params.dstPos = make_cudaPos(0, 0, 0);
   params.extent = make_cudaExtent(width_, height_, depth_);
   params.kind = cudaMemcpyHostToDevice;
+  cudaMemcpy3DAsync(&params, stream_);
 
-  cudaMemcpy3D(&params);
-
-  return *this;
+  return CudaEvent::Record(stream_);
 }
 
 //------------------------------------------------------------------------------
 
 template <typename Derived>
-inline void CudaTexture3DBase<Derived>::CopyTo(
-    CudaTexture3DBase<Derived>::Scalar *host_array) const {
+inline CudaEvent CudaTexture3DBase<Derived>::CopyToAsync(
+    Scalar *host_array) const {
   internal::CheckNotNull(host_array);
+  LIBCUA_INSTRUMENT("CudaTexture3D::DownloadAsync",
+                    2 * sizeof(Scalar) * width_ * height_ * depth_, device_,
+                    stream_, false);
   internal::SetDevice(device_);
+  const size_t width_in_bytes = width_ * sizeof(Scalar);
   cudaMemcpy3DParms params = {0};
   params.srcArray = shared_texture_.DeviceArray();
-  params.dstPtr = make_cudaPitchedPtr(const_cast<Scalar *>(host_array),
-                                      width_ * sizeof(Scalar), width_, height_);
+  params.srcPos = make_cudaPos(0, 0, 0);
+  params.dstPtr =
+      make_cudaPitchedPtr(host_array, width_in_bytes, width_, height_);
   params.extent = make_cudaExtent(width_, height_, depth_);
   params.kind = cudaMemcpyDeviceToHost;
+  cudaMemcpy3DAsync(&params, stream_);
 
-  cudaMemcpy3D(&params);
+  return CudaEvent::Record(stream_);
 }
 
 //------------------------------------------------------------------------------
@@ -289,8 +439,6 @@ class CudaTexture2DArray : public CudaTexture3DBase<CudaTexture2DArray<T>> {
   using CudaTexture3DBase<CudaTexture2DArray<T>>::CudaTexture3DBase;
   using CudaTexture3DBase<CudaTexture2DArray<T>>::operator=;
 
-  ~CudaTexture2DArray() {}
-
   /**
    * Device-level function for getting a texture pixel value. Note, if you use
    * cudaReadModeNormalizedFloat as the texture read mode, you'll need to
@@ -342,8 +490,6 @@ class CudaTexture3D : public CudaTexture3DBase<CudaTexture3D<T>> {
   using CudaTexture3DBase<CudaTexture3D<T>>::CudaTexture3DBase;
   using CudaTexture3DBase<CudaTexture3D<T>>::operator=;
 
-  ~CudaTexture3D() {}
-
   /**
    * Device-level function for getting a texture pixel value. Note, if you use
    * cudaReadModeNormalizedFloat as the texture read mode, you'll need to
@@ -390,12 +536,14 @@ template <typename T>
 struct CudaArrayTraits<CudaTexture2DArray<T>> {
   typedef T Scalar;
   typedef std::true_type IsLayered;
+  typedef CudaTexture3DDeviceView<T, IsLayered> DeviceView;
 };
 
 template <typename T>
 struct CudaArrayTraits<CudaTexture3D<T>> {
   typedef T Scalar;
   typedef std::false_type IsLayered;
+  typedef CudaTexture3DDeviceView<T, IsLayered> DeviceView;
 };
 
 }  // namespace cua
@@ -0,0 +1,618 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_DEVICE_VIEW_H_
+#define LIBCUA_DEVICE_VIEW_H_
+
+#include <cstddef>
+#include <type_traits>
+
+#include "types.h"
+
+namespace cua {
+
+//------------------------------------------------------------------------------
+//
+// Device views are the kernel-parameter form of the array classes. A view is a
+// trivially copyable struct that only holds what device code needs to access
+// the elements of an array: the pointer, pitch, and extents of linear memory,
+// or the CUDA object handle and offsets of a surface or texture. Unlike the
+// array classes, a view does not own its memory, so copying it into a kernel's
+// parameter space costs a few bytes and never touches a host reference count.
+//
+// Every array class returns its view from DeviceView(), and all kernels of the
+// library are launched with views. Views are equally the preferred way of
+// passing arrays to your own kernels:
+//
+//     __global__ void device_kernel(CudaArray2DDeviceView<float> arr) {
+//       const int x = blockIdx.x * blockDim.x + threadIdx.x;
+//       const int y = blockIdx.y * blockDim.y + threadIdx.y;
+//       if (x < arr.Width() && y < arr.Height()) {
+//         arr.set(x, y, 0.0f);
+//       }
+//     }
+//
+//     device_kernel<<<grid_dim, block_dim>>>(array.DeviceView());
+//
+// A view is only valid for as long as the array (or any of its shallow copies)
+// that created it is alive. Because views behave like pointers, set() is a
+// const method, and views may also be captured by value in device lambdas that
+// write to the array.
+//
+//------------------------------------------------------------------------------
+
+namespace internal {
+
+// tile dimensions used by the tiled kernels (e.g., transpose) of the array
+// classes and of their device views
+static const unsigned int kTransposeTileSize = 32;
+static const unsigned int kTransposeBlockRows = 4;
+
+// largest static shared-memory allocation of a kernel
+static const size_t kMaxTransposeSharedBytes = 48 * 1024;
+
+}  // namespace internal
+
+//------------------------------------------------------------------------------
+
+/**
+ * @class CudaArray2DDeviceView
+ * @brief Kernel-parameter view of a CudaArray2D.
+ */
+template <typename T>
+class CudaArray2DDeviceView {
+ public:
+  typedef T Scalar;
+  typedef LIBCUA_DEFAULT_SIZE_TYPE SizeType;
+  typedef LIBCUA_DEFAULT_INDEX_TYPE IndexType;
+
+  static const SizeType kTileSize = internal::kTransposeTileSize;
+  static const SizeType kBlockRows = internal::kTransposeBlockRows;
+
+  __host__ __device__ CudaArray2DDeviceView(T *data, size_t pitch,
+                                            SizeType width, SizeType height)
+      : data_(data), pitch_(pitch), width_(width), height_(height) {}
+
+  __host__ __device__ inline T *ptr(IndexType x = 0, IndexType y = 0) const {
+    return reinterpret_cast<T *>(reinterpret_cast<char *>(data_) +
+                                 y * pitch_ + x * sizeof(T));
+  }
+
+  __device__ inline void set(IndexType x, IndexType y, const T v) const {
+    *ptr(x, y) = v;
+  }
+
+  __device__ inline T get(IndexType x, IndexType y) const { return *ptr(x, y); }
+
+  __host__ __device__ inline SizeType Width() const { return width_; }
+  __host__ __device__ inline SizeType Height() const { return height_; }
+  __host__ __device__ inline size_t Pitch() const { return pitch_; }
+
+ private:
+  T *data_;
+  size_t pitch_;
+  SizeType width_, height_;
+};
+
+//------------------------------------------------------------------------------
+
+/**
+ * @class CudaArray3DDeviceView
+ * @brief Kernel-parameter view of a CudaArray3D.
+ */
+template <typename T>
+class CudaArray3DDeviceView {
+ public:
+  typedef T Scalar;
+  typedef LIBCUA_DEFAULT_SIZE_TYPE SizeType;
+  typedef LIBCUA_DEFAULT_INDEX_TYPE IndexType;
+
+  static const SizeType kTileSize = internal::kTransposeTileSize;
+  static const SizeType kBlockRows = internal::kTransposeBlockRows;
+
+  /**
+   * @param y_pitch number of rows between consecutive slices in memory
+   */
+  __host__ __device__ CudaArray3DDeviceView(T *data, size_t pitch,
+                                            size_t y_pitch, SizeType width,
+                                            SizeType height, SizeType depth)
+      : data_(data),
+        pitch_(pitch),
+        y_pitch_(y_pitch),
+        width_(width),
+        height_(height),
+        depth_(depth) {}
+
+  __host__ __device__ inline T *ptr(IndexType x = 0, IndexType y = 0,
+                                    IndexType z = 0) const {
+    return reinterpret_cast<T *>(reinterpret_cast<char *>(data_) +
+                                 (z * y_pitch_ + y) * pitch_ + x * sizeof(T));
+  }
+
+  __device__ inline void set(IndexType x, IndexType y, IndexType z,
+                             const T v) const {
+    *ptr(x, y, z) = v;
+  }
+
+  __device__ inline T get(IndexType x, IndexType y, IndexType z) const {
+    return *ptr(x, y, z);
+  }
+
+  __host__ __device__ inline SizeType Width() const { return width_; }
+  __host__ __device__ inline SizeType Height() const { return height_; }
+  __host__ __device__ inline SizeType Depth() const { return depth_; }
+  __host__ __device__ inline size_t Pitch() const { return pitch_; }
+
+ private:
+  T *data_;
+  size_t pitch_;
+  size_t y_pitch_;
+  SizeType width_, height_, depth_;
+};
+
+//------------------------------------------------------------------------------
+
+/**
+ * @class CudaSurface2DDeviceView
+ * @brief Kernel-parameter view of a CudaSurface2D.
+ */
+template <typename T>
+class CudaSurface2DDeviceView {
+ public:
+  typedef T Scalar;
+  typedef LIBCUA_DEFAULT_SIZE_TYPE SizeType;
+  typedef LIBCUA_DEFAULT_INDEX_TYPE IndexType;
+
+  static const SizeType kTileSize = internal::kTransposeTileSize;
+  static const SizeType kBlockRows = internal::kTransposeBlockRows;
+
+  __host__ __device__ CudaSurface2DDeviceView(
+      cudaSurfaceObject_t surface, SizeType width, SizeType height,
+      IndexType x_offset, IndexType y_offset,
+      cudaSurfaceBoundaryMode boundary_mode)
+      : surface_(surface),
+        width_(width),
+        height_(height),
+        x_offset_(x_offset),
+        y_offset_(y_offset),
+        boundary_mode_(boundary_mode) {}
+
+  __device__ inline void set(const int x, const int y, const T v) const {
+    surf2Dwrite(v, surface_, sizeof(T) * (x + x_offset_), y + y_offset_,
+                boundary_mode_);
+  }
+
+  __device__ inline T get(const int x, const int y) const {
+    return surf2Dread<T>(surface_, sizeof(T) * (x + x_offset_), y + y_offset_,
+                         boundary_mode_);
+  }
+
+  __host__ __device__ inline SizeType Width() const { return width_; }
+  __host__ __device__ inline SizeType Height() const { return height_; }
+
+ private:
+  cudaSurfaceObject_t surface_;
+  SizeType width_, height_;
+  IndexType x_offset_, y_offset_;
+  cudaSurfaceBoundaryMode boundary_mode_;
+};
+
+//------------------------------------------------------------------------------
+
+/**
+ * @class CudaSurface3DDeviceView
+ * @brief Kernel-parameter view of a CudaSurface3D or, if IsLayered is
+ *   std::true_type, of a CudaSurface2DArray.
+ */
+template <typename T, typename IsLayered>
+class CudaSurface3DDeviceView {
+ public:
+  typedef T Scalar;
+  typedef LIBCUA_DEFAULT_SIZE_TYPE SizeType;
+  typedef LIBCUA_DEFAULT_INDEX_TYPE IndexType;
+
+  static const SizeType kTileSize = internal::kTransposeTileSize;
+  static const SizeType kBlockRows = internal::kTransposeBlockRows;
+
+  __host__ __device__ CudaSurface3DDeviceView(
+      cudaSurfaceObject_t surface, SizeType width, SizeType height,
+      SizeType depth, IndexType x_offset, IndexType y_offset,
+      IndexType z_offset, cudaSurfaceBoundaryMode boundary_mode)
+      : surface_(surface),
+        width_(width),
+        height_(height),
+        depth_(depth),
+        x_offset_(x_offset),
+        y_offset_(y_offset),
+        z_offset_(z_offset),
+        boundary_mode_(boundary_mode) {}
+
+  __device__ inline void set(const int x, const int y, const int z,
+                             const T v) const {
+    set_(x, y, z, v, IsLayered());
+  }
+
+  __device__ inline T get(const int x, const int y, const int z) const {
+    return get_(x, y, z, IsLayered());
+  }
+
+  __host__ __device__ inline SizeType Width() const { return width_; }
+  __host__ __device__ inline SizeType Height() const { return height_; }
+  __host__ __device__ inline SizeType Depth() const { return depth_; }
+
+ private:
+  __device__ inline void set_(const int x, const int y, const int z, const T v,
+                              std::true_type) const {
+    surf2DLayeredwrite(v, surface_, sizeof(T) * (x + x_offset_), y + y_offset_,
+                       z + z_offset_, boundary_mode_);
+  }
+
+  __device__ inline void set_(const int x, const int y, const int z, const T v,
+                              std::false_type) const {
+    surf3Dwrite(v, surface_, sizeof(T) * (x + x_offset_), y + y_offset_,
+                z + z_offset_, boundary_mode_);
+  }
+
+  __device__ inline T get_(const int x, const int y, const int z,
+                           std::true_type) const {
+    return surf2DLayeredread<T>(surface_, sizeof(T) * (x + x_offset_),
+                                y + y_offset_, z + z_offset_, boundary_mode_);
+  }
+
+  __device__ inline T get_(const int x, const int y, const int z,
+                           std::false_type) const {
+    return surf3Dread<T>(surface_, sizeof(T) * (x + x_offset_), y + y_offset_,
+                         z + z_offset_, boundary_mode_);
+  }
+
+  cudaSurfaceObject_t surface_;
+  SizeType width_, height_, depth_;
+  IndexType x_offset_, y_offset_, z_offset_;
+  cudaSurfaceBoundaryMode boundary_mode_;
+};
+
+//------------------------------------------------------------------------------
+
+/**
+ * @class CudaTexture2DDeviceView
+ * @brief Kernel-parameter view of a CudaTexture2D.
+ */
+template <typename T>
+class CudaTexture2DDeviceView {
+ public:
+  typedef T Scalar;
+  typedef LIBCUA_DEFAULT_SIZE_TYPE SizeType;
+  typedef LIBCUA_DEFAULT_INDEX_TYPE IndexType;
+
+  static const SizeType kTileSize = internal::kTransposeTileSize;
+  static const SizeType kBlockRows = internal::kTransposeBlockRows;
+
+  __host__ __device__ CudaTexture2DDeviceView(cudaTextureObject_t texture,
+                                              SizeType width, SizeType height)
+      : texture_(texture), width_(width), height_(height) {}
+
+  // see CudaTexture2D::get()
+  template <typename ReturnType = T>
+  __device__ inline ReturnType get(const int x, const int y) const {
+    return tex2D<ReturnType>(texture_, x + 0.5f, y + 0.5f);
+  }
+
+  // see CudaTexture2D::interp()
+  template <typename ReturnType = T>
+  __device__ inline ReturnType interp(const float x, const float y) const {
+    return tex2D<ReturnType>(texture_, x, y);
+  }
+
+  __host__ __device__ inline SizeType Width() const { return width_; }
+  __host__ __device__ inline SizeType Height() const { return height_; }
+
+ private:
+  cudaTextureObject_t texture_;
+  SizeType width_, height_;
+};
+
+//------------------------------------------------------------------------------
+
+/**
+ * @class CudaTexture3DDeviceView
+ * @brief Kernel-parameter view of a CudaTexture3D or, if IsLayered is
+ *   std::true_type, of a CudaTexture2DArray.
+ */
+template <typename T, typename IsLayered>
+class CudaTexture3DDeviceView {
+ public:
+  typedef T Scalar;
+  typedef LIBCUA_DEFAULT_SIZE_TYPE SizeType;
+  typedef LIBCUA_DEFAULT_INDEX_TYPE IndexType;
+
+  static const SizeType kTileSize = internal::kTransposeTileSize;
+  static const SizeType kBlockRows = internal::kTransposeBlockRows;
+
+  __host__ __device__ CudaTexture3DDeviceView(cudaTextureObject_t texture,
+                                              SizeType width, SizeType height,
+                                              SizeType depth)
+      : texture_(texture), width_(width), height_(height), depth_(depth) {}
+
+  // see CudaTexture3D::get() and CudaTexture2DArray::get()
+  template <typename ReturnType = T>
+  __device__ inline ReturnType get(const int x, const int y,
+                                   const int z) const {
+    return interp<ReturnType>(x + 0.5f, y + 0.5f, z + 0.5f);
+  }
+
+  // see CudaTexture3D::interp() and CudaTexture2DArray::interp()
+  template <typename ReturnType = T>
+  __device__ inline ReturnType interp(const float x, const float y,
+                                      const float z) const {
+    return interp_<ReturnType>(x, y, z, IsLayered());
+  }
+
+  __host__ __device__ inline SizeType Width() const { return width_; }
+  __host__ __device__ inline SizeType Height() const { return height_; }
+  __host__ __device__ inline SizeType Depth() const { return depth_; }
+
+ private:
+  template <typename ReturnType>
+  __device__ inline ReturnType interp_(const float x, const float y,
+                                       const float z, std::true_type) const {
+    return tex2DLayered<ReturnType>(texture_, x, y, z);
+  }
+
+  template <typename ReturnType>
+  __device__ inline ReturnType interp_(const float x, const float y,
+                                       const float z, std::false_type) const {
+    return tex3D<ReturnType>(texture_, x, y, z);
+  }
+
+  cudaTextureObject_t texture_;
+  SizeType width_, height_, depth_;
+};
+
+//------------------------------------------------------------------------------
+
+/**
+ * @class CudaMipmappedTexture2DDeviceView
+ * @brief Kernel-parameter view of a CudaMipmappedTexture2D. Coordinates are
+ *   given in elements of level 0 and normalized for the texture unit.
+ */
+template <typename T>
+class CudaMipmappedTexture2DDeviceView {
+ public:
+  typedef T Scalar;
+  typedef LIBCUA_DEFAULT_SIZE_TYPE SizeType;
+  typedef LIBCUA_DEFAULT_INDEX_TYPE IndexType;
+
+  static const SizeType kTileSize = internal::kTransposeTileSize;
+  static const SizeType kBlockRows = internal::kTransposeBlockRows;
+
+  __host__ __device__ CudaMipmappedTexture2DDeviceView(
+      cudaTextureObject_t texture, SizeType width, SizeType height)
+      : texture_(texture),
+        width_(width),
+        height_(height),
+        inv_width_(1.f / width),
+        inv_height_(1.f / height) {}
+
+  // see CudaMipmappedTexture2D::get()
+  template <typename ReturnType = T>
+  __device__ inline ReturnType get(const int x, const int y) const {
+    return lod<ReturnType>(x + 0.5f, y + 0.5f, 0.f);
+  }
+
+  // see CudaMipmappedTexture2D::interp()
+  template <typename ReturnType = T>
+  __device__ inline ReturnType interp(const float x, const float y) const {
+    return lod<ReturnType>(x, y, 0.f);
+  }
+
+  // see CudaMipmappedTexture2D::lod()
+  template <typename ReturnType = T>
+  __device__ inline ReturnType lod(const float x, const float y,
+                                   const float level) const {
+    return tex2DLod<ReturnType>(texture_, x * inv_width_, y * inv_height_,
+                                level);
+  }
+
+  // see CudaMipmappedTexture2D::grad()
+  template <typename ReturnType = T>
+  __device__ inline ReturnType grad(const float x, const float y,
+                                    const float2 dx, const float2 dy) const {
+    return tex2DGrad<ReturnType>(
+        texture_, x * inv_width_, y * inv_height_,
+        make_float2(dx.x * inv_width_, dx.y * inv_height_),
+        make_float2(dy.x * inv_width_, dy.y * inv_height_));
+  }
+
+  __host__ __device__ inline SizeType Width() const { return width_; }
+  __host__ __device__ inline SizeType Height() const { return height_; }
+
+ private:
+  cudaTextureObject_t texture_;
+  SizeType width_, height_;
+  float inv_width_, inv_height_;
+};
+
+//------------------------------------------------------------------------------
+
+/**
+ * @class CudaMipmappedTexture3DDeviceView
+ * @brief Kernel-parameter view of a CudaMipmappedTexture3D. Coordinates are
+ *   given in elements of level 0 and normalized for the texture unit.
+ */
+template <typename T>
+class CudaMipmappedTexture3DDeviceView {
+ public:
+  typedef T Scalar;
+  typedef LIBCUA_DEFAULT_SIZE_TYPE SizeType;
+  typedef LIBCUA_DEFAULT_INDEX_TYPE IndexType;
+
+  static const SizeType kTileSize = internal::kTransposeTileSize;
+  static const SizeType kBlockRows = internal::kTransposeBlockRows;
+
+  __host__ __device__ CudaMipmappedTexture3DDeviceView(
+      cudaTextureObject_t texture, SizeType width, SizeType height,
+      SizeType depth)
+      : texture_(texture),
+        width_(width),
+        height_(height),
+        depth_(depth),
+        inv_width_(1.f / width),
+        inv_height_(1.f / height),
+        inv_depth_(1.f / depth) {}
+
+  // see CudaMipmappedTexture3D::get()
+  template <typename ReturnType = T>
+  __device__ inline ReturnType get(const int x, const int y,
+                                   const int z) const {
+    return lod<ReturnType>(x + 0.5f, y + 0.5f, z + 0.5f, 0.f);
+  }
+
+  // see CudaMipmappedTexture3D::interp()
+  template <typename ReturnType = T>
+  __device__ inline ReturnType interp(const float x, const float y,
+                                      const float z) const {
+    return lod<ReturnType>(x, y, z, 0.f);
+  }
+
+  // see CudaMipmappedTexture3D::lod()
+  template <typename ReturnType = T>
+  __device__ inline ReturnType lod(const float x, const float y, const float z,
+                                   const float level) const {
+    return tex3DLod<ReturnType>(texture_, x * inv_width_, y * inv_height_,
+                                z * inv_depth_, level);
+  }
+
+  // see CudaMipmappedTexture3D::grad()
+  template <typename ReturnType = T>
+  __device__ inline ReturnType grad(const float x, const float y, const float z,
+                                    const float4 dx, const float4 dy) const {
+    return tex3DGrad<ReturnType>(
+        texture_, x * inv_width_, y * inv_height_, z * inv_depth_,
+        make_float4(dx.x * inv_width_, dx.y * inv_height_, dx.z * inv_depth_,
+                    0.f),
+        make_float4(dy.x * inv_width_, dy.y * inv_height_, dy.z * inv_depth_,
+                    0.f));
+  }
+
+  __host__ __device__ inline SizeType Width() const { return width_; }
+  __host__ __device__ inline SizeType Height() const { return height_; }
+  __host__ __device__ inline SizeType Depth() const { return depth_; }
+
+ private:
+  cudaTextureObject_t texture_;
+  SizeType width_, height_, depth_;
+  float inv_width_, inv_height_, inv_depth_;
+};
+
+//------------------------------------------------------------------------------
+
+/**
+ * @class CudaSurfaceTexture2DDeviceView
+ * @brief Kernel-parameter view of a CudaSurfaceTexture2D: a surface view with
+ *   texture sampling of the same memory.
+ */
+template <typename T>
+class CudaSurfaceTexture2DDeviceView : public CudaSurface2DDeviceView<T> {
+ public:
+  typedef typename CudaSurface2DDeviceView<T>::SizeType SizeType;
+
+  typedef typename CudaSurface2DDeviceView<T>::IndexType IndexType;
+
+  __host__ __device__ CudaSurfaceTexture2DDeviceView(
+      cudaSurfaceObject_t surface, cudaTextureObject_t texture, SizeType width,
+      SizeType height, IndexType x_offset, IndexType y_offset,
+      cudaSurfaceBoundaryMode boundary_mode)
+      : CudaSurface2DDeviceView<T>(surface, width, height, x_offset, y_offset,
+                                   boundary_mode),
+        texture_(texture),
+        x_offset_(x_offset),
+        y_offset_(y_offset) {}
+
+  // see CudaSurfaceTexture2D::interp()
+  template <typename ReturnType = T>
+  __device__ inline ReturnType interp(const float x, const float y) const {
+    return tex2D<ReturnType>(texture_, x + x_offset_, y + y_offset_);
+  }
+
+ private:
+  cudaTextureObject_t texture_;
+  IndexType x_offset_, y_offset_;
+};
+
+//------------------------------------------------------------------------------
+
+/**
+ * @class CudaSurfaceTexture3DDeviceView
+ * @brief Kernel-parameter view of a CudaSurfaceTexture3D: a surface view with
+ *   texture sampling of the same memory.
+ */
+template <typename T>
+class CudaSurfaceTexture3DDeviceView
+    : public CudaSurface3DDeviceView<T, std::false_type> {
+ public:
+  typedef typename CudaSurface3DDeviceView<T, std::false_type>::SizeType
+      SizeType;
+
+  typedef typename CudaSurface3DDeviceView<T, std::false_type>::IndexType
+      IndexType;
+
+  __host__ __device__ CudaSurfaceTexture3DDeviceView(
+      cudaSurfaceObject_t surface, cudaTextureObject_t texture, SizeType width,
+      SizeType height, SizeType depth, IndexType x_offset, IndexType y_offset,
+      IndexType z_offset, cudaSurfaceBoundaryMode boundary_mode)
+      : CudaSurface3DDeviceView<T, std::false_type>(
+            surface, width, height, depth, x_offset, y_offset, z_offset,
+            boundary_mode),
+        texture_(texture),
+        x_offset_(x_offset),
+        y_offset_(y_offset),
+        z_offset_(z_offset) {}
+
+  // see CudaSurfaceTexture3D::interp()
+  template <typename ReturnType = T>
+  __device__ inline ReturnType interp(const float x, const float y,
+                                      const float z) const {
+    return tex3D<ReturnType>(texture_, x + x_offset_, y + y_offset_,
+                             z + z_offset_);
+  }
+
+ private:
+  cudaTextureObject_t texture_;
+  IndexType x_offset_, y_offset_, z_offset_;
+};
+
+}  // namespace cua
+
+#endif  // LIBCUA_DEVICE_VIEW_H_
@@ -0,0 +1,107 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_FUNCTIONAL_H_
+#define LIBCUA_FUNCTIONAL_H_
+
+namespace cua {
+
+//------------------------------------------------------------------------------
+//
+// Element-wise binary function objects, usable on both the host and the device.
+// Plus through Divides, and Negate below, mirror the corresponding classes in
+// <functional>.
+//
+//------------------------------------------------------------------------------
+
+struct Plus {
+  template <typename T>
+  __host__ __device__ inline T operator()(const T &a, const T &b) const {
+    return a + b;
+  }
+};
+
+struct Minus {
+  template <typename T>
+  __host__ __device__ inline T operator()(const T &a, const T &b) const {
+    return a - b;
+  }
+};
+
+struct Multiplies {
+  template <typename T>
+  __host__ __device__ inline T operator()(const T &a, const T &b) const {
+    return a * b;
+  }
+};
+
+struct Divides {
+  template <typename T>
+  __host__ __device__ inline T operator()(const T &a, const T &b) const {
+    return a / b;
+  }
+};
+
+// Minimum and maximum as binary function objects, e.g., for reductions.
+struct Minimum {
+  template <typename T>
+  __host__ __device__ inline T operator()(const T &a, const T &b) const {
+    return (b < a) ? b : a;
+  }
+};
+
+struct Maximum {
+  template <typename T>
+  __host__ __device__ inline T operator()(const T &a, const T &b) const {
+    return (a < b) ? b : a;
+  }
+};
+
+//------------------------------------------------------------------------------
+//
+// Element-wise unary function objects.
+//
+//------------------------------------------------------------------------------
+
+struct Negate {
+  template <typename T>
+  __host__ __device__ inline T operator()(const T &a) const {
+    return -a;
+  }
+};
+
+}  // namespace cua
+
+#endif  // LIBCUA_FUNCTIONAL_H_
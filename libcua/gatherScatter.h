@@ -0,0 +1,318 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_GATHER_SCATTER_H_
+#define LIBCUA_GATHER_SCATTER_H_
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "cachingAllocator.h"
+#include "cudaEvent.h"
+#include "hostThreadPool.h"
+#include "util.h"
+
+namespace cua {
+
+/**
+ * @struct Coordinate2D
+ * @brief (x, y) position of an array element, e.g., for
+ * CudaArray2DBase::GetValues().
+ */
+template <typename IndexType>
+struct Coordinate2D {
+  IndexType x, y;
+};
+
+/**
+ * @struct Coordinate3D
+ * @brief (x, y, z) position of an array element, e.g., for
+ * CudaArray3DBase::GetValues().
+ */
+template <typename IndexType>
+struct Coordinate3D {
+  IndexType x, y, z;
+};
+
+namespace internal {
+
+//
+// element access by coordinate
+//
+
+LIBCUA_EXEC_CHECK_DISABLE
+template <typename CudaArrayClass, typename IndexType>
+__host__ __device__ inline typename CudaArrayClass::Scalar GetAt(
+    const CudaArrayClass &array, const Coordinate2D<IndexType> &coordinate) {
+  return array.get(coordinate.x, coordinate.y);
+}
+
+LIBCUA_EXEC_CHECK_DISABLE
+template <typename CudaArrayClass, typename IndexType>
+__host__ __device__ inline typename CudaArrayClass::Scalar GetAt(
+    const CudaArrayClass &array, const Coordinate3D<IndexType> &coordinate) {
+  return array.get(coordinate.x, coordinate.y, coordinate.z);
+}
+
+LIBCUA_EXEC_CHECK_DISABLE
+template <typename CudaArrayClass, typename IndexType>
+__host__ __device__ inline void SetAt(
+    CudaArrayClass &array, const Coordinate2D<IndexType> &coordinate,
+    const typename CudaArrayClass::Scalar &value) {
+  array.set(coordinate.x, coordinate.y, value);
+}
+
+LIBCUA_EXEC_CHECK_DISABLE
+template <typename CudaArrayClass, typename IndexType>
+__host__ __device__ inline void SetAt(
+    CudaArrayClass &array, const Coordinate3D<IndexType> &coordinate,
+    const typename CudaArrayClass::Scalar &value) {
+  array.set(coordinate.x, coordinate.y, coordinate.z, value);
+}
+
+//
+// bounds checks
+//
+
+template <typename CudaArrayClass, typename IndexType>
+inline bool IsInBounds(const CudaArrayClass &array,
+                       const Coordinate2D<IndexType> &coordinate) {
+  return coordinate.x < array.Width() && coordinate.y < array.Height();
+}
+
+template <typename CudaArrayClass, typename IndexType>
+inline bool IsInBounds(const CudaArrayClass &array,
+                       const Coordinate3D<IndexType> &coordinate) {
+  return coordinate.x < array.Width() && coordinate.y < array.Height() &&
+         coordinate.z < array.Depth();
+}
+
+template <typename CudaArrayClass, typename Coordinate>
+inline void CheckCoordinates(const CudaArrayClass &array,
+                             const Coordinate *coordinates, size_t num_values) {
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  for (size_t i = 0; i < num_values; ++i) {
+    if (!IsInBounds(array, coordinates[i])) {
+      throw std::runtime_error("Coordinate " + std::to_string(i) +
+                               " is out of bounds.");
+    }
+  }
+#endif
+}
+
+}  // namespace internal
+
+//------------------------------------------------------------------------------
+//
+// kernel definitions
+//
+//------------------------------------------------------------------------------
+
+namespace kernel {
+
+//
+// values[i] = array(coordinates[i])
+//
+template <typename CudaArrayClass, typename Coordinate>
+__global__ void GatherValues(const CudaArrayClass array,
+                             const Coordinate *coordinates,
+                             const size_t num_values,
+                             typename CudaArrayClass::Scalar *values) {
+  const size_t i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < num_values) {
+    values[i] = internal::GetAt(array, coordinates[i]);
+  }
+}
+
+//
+// array(coordinates[i]) = values[i]
+//
+template <typename CudaArrayClass, typename Coordinate>
+__global__ void ScatterValues(CudaArrayClass array,
+                              const Coordinate *coordinates,
+                              const size_t num_values,
+                              const typename CudaArrayClass::Scalar *values) {
+  const size_t i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < num_values) {
+    internal::SetAt(array, coordinates[i], values[i]);
+  }
+}
+
+}  // namespace kernel
+
+//------------------------------------------------------------------------------
+//
+// host implementations
+//
+//------------------------------------------------------------------------------
+
+namespace host {
+
+template <typename CudaArrayClass, typename Coordinate>
+inline void GatherValues(const CudaArrayClass &array,
+                         const Coordinate *coordinates, size_t num_values,
+                         typename CudaArrayClass::Scalar *values) {
+  internal::ParallelForRows(num_values, 1, [&](size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; ++i) {
+      values[i] = internal::GetAt(array, coordinates[i]);
+    }
+  });
+}
+
+// scattering is serial, so that the last of several values given for the same
+// coordinate wins
+template <typename CudaArrayClass, typename Coordinate>
+inline void ScatterValues(CudaArrayClass &array, const Coordinate *coordinates,
+                          size_t num_values,
+                          const typename CudaArrayClass::Scalar *values) {
+  for (size_t i = 0; i < num_values; ++i) {
+    internal::SetAt(array, coordinates[i], values[i]);
+  }
+}
+
+}  // namespace host
+
+//------------------------------------------------------------------------------
+//
+// device implementations
+//
+//------------------------------------------------------------------------------
+
+namespace internal {
+
+// number of threads per block for gathering and scattering
+static const unsigned int kGatherScatterBlockSize = 256;
+
+//
+// Scratch space on the GPU for one batch: the coordinates, followed by the
+// values. The block comes from the caching allocator and is returned to it
+// once the batch has been queued; since the allocator only hands the block out
+// again for later work on the same stream, the same memory is reused batch
+// after batch without any allocation or synchronization.
+//
+template <typename Coordinate, typename Scalar>
+class GatherScatterScratch {
+ public:
+  GatherScatterScratch(size_t num_values, int device, cudaStream_t stream)
+      : values_offset_(RoundUp_(num_values * sizeof(Coordinate))),
+        scratch_(static_cast<char *>(CachingAllocator<>::Instance().Allocate(
+            values_offset_ + num_values * sizeof(Scalar), device, stream))) {}
+
+  ~GatherScatterScratch() { CachingAllocator<>::Instance().Free(scratch_); }
+
+  inline Coordinate *Coordinates() const {
+    return reinterpret_cast<Coordinate *>(scratch_);
+  }
+
+  inline Scalar *Values() const {
+    return reinterpret_cast<Scalar *>(scratch_ + values_offset_);
+  }
+
+ private:
+  GatherScatterScratch(const GatherScatterScratch &) = delete;
+  GatherScatterScratch &operator=(const GatherScatterScratch &) = delete;
+
+  static inline size_t RoundUp_(size_t size_in_bytes) {
+    const size_t kAlignment = 256;
+    return (size_in_bytes + kAlignment - 1) / kAlignment * kAlignment;
+  }
+
+  const size_t values_offset_;
+  char *const scratch_;
+};
+
+//
+// Gather the values at the given coordinates with one kernel, and copy them
+// back to the host with one transfer. All work is queued on the given stream.
+//
+template <typename CudaArrayClass, typename Coordinate>
+inline CudaEvent GatherValuesAsync(const CudaArrayClass &array,
+                                   const Coordinate *coordinates,
+                                   size_t num_values,
+                                   typename CudaArrayClass::Scalar *values,
+                                   int device, cudaStream_t stream) {
+  typedef typename CudaArrayClass::Scalar Scalar;
+  if (num_values == 0) {
+    return CudaEvent();
+  }
+
+  internal::SetDevice(device);
+  GatherScatterScratch<Coordinate, Scalar> scratch(num_values, device, stream);
+  cudaMemcpyAsync(scratch.Coordinates(), coordinates,
+                  num_values * sizeof(Coordinate), cudaMemcpyHostToDevice,
+                  stream);
+  const size_t num_blocks =
+      (num_values + kGatherScatterBlockSize - 1) / kGatherScatterBlockSize;
+  kernel::GatherValues<<<num_blocks, kGatherScatterBlockSize, 0, stream>>>(
+      array, scratch.Coordinates(), num_values, scratch.Values());
+  cudaMemcpyAsync(values, scratch.Values(), num_values * sizeof(Scalar),
+                  cudaMemcpyDeviceToHost, stream);
+  return CudaEvent::Record(stream);
+}
+
+//
+// Scatter the given values to the given coordinates with one kernel. All work
+// is queued on the given stream.
+//
+template <typename CudaArrayClass, typename Coordinate>
+inline CudaEvent ScatterValuesAsync(
+    const CudaArrayClass &array, const Coordinate *coordinates,
+    size_t num_values, const typename CudaArrayClass::Scalar *values,
+    int device, cudaStream_t stream) {
+  typedef typename CudaArrayClass::Scalar Scalar;
+  if (num_values == 0) {
+    return CudaEvent();
+  }
+
+  internal::SetDevice(device);
+  GatherScatterScratch<Coordinate, Scalar> scratch(num_values, device, stream);
+  cudaMemcpyAsync(scratch.Coordinates(), coordinates,
+                  num_values * sizeof(Coordinate), cudaMemcpyHostToDevice,
+                  stream);
+  cudaMemcpyAsync(scratch.Values(), values, num_values * sizeof(Scalar),
+                  cudaMemcpyHostToDevice, stream);
+  const size_t num_blocks =
+      (num_values + kGatherScatterBlockSize - 1) / kGatherScatterBlockSize;
+  kernel::ScatterValues<<<num_blocks, kGatherScatterBlockSize, 0, stream>>>(
+      array, scratch.Coordinates(), num_values, scratch.Values());
+  return CudaEvent::Record(stream);
+}
+
+}  // namespace internal
+
+}  // namespace cua
+
+#endif  // LIBCUA_GATHER_SCATTER_H_
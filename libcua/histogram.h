@@ -0,0 +1,481 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_HISTOGRAM_H_
+#define LIBCUA_HISTOGRAM_H_
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "cachingAllocator.h"
+#include "channels.h"
+#include "hostThreadPool.h"
+#include "launchConfig.h"
+#include "reduction.h"
+#include "types.h"
+#include "util.h"
+
+namespace cua {
+
+/**
+ * @struct HistogramBins
+ * @brief Equal-width histogram bins over the value range [lower, upper).
+ *
+ * A value v falls into bin floor((v - lower) * num_bins / (upper - lower));
+ * values outside of the range, and NaNs, are not counted. For example,
+ * `HistogramBins(256, 0.f, 256.f)` has one bin per value of an unsigned char
+ * array, and `HistogramBins(64, 0.f, 1.f)` splits [0, 1) into 64 bins.
+ */
+struct HistogramBins {
+  /**
+   * @param num_bins_ number of bins, at least one
+   * @param lower_ lower end of the range of the first bin
+   * @param upper_ upper end of the range of the last bin (exclusive)
+   */
+  HistogramBins(unsigned int num_bins_, float lower_, float upper_)
+      : num_bins(num_bins_), lower(lower_), upper(upper_) {}
+
+  unsigned int num_bins;
+  float lower, upper;
+};
+
+namespace internal {
+
+//------------------------------------------------------------------------------
+//
+// histogram helpers
+//
+//------------------------------------------------------------------------------
+
+// number of threads per block of the histogram kernel; a multiple of the warp
+// size
+static const unsigned int kHistogramBlockSize = 256;
+
+// blocks per multiprocessor; each block merges its bins into the global
+// histogram once, so more blocks only add merge traffic
+static const unsigned int kHistogramBlocksPerMultiprocessor = 4;
+
+// Per-block bins are kept in shared memory if all channels fit into this many
+// bytes; otherwise, the kernel counts directly in global memory.
+static const size_t kMaxHistogramSharedBytes = 48 * 1024;
+
+// upper bound on the number of tasks, and thus of partial histograms, on the
+// host
+static const size_t kMaxHistogramHostTasks = 64;
+
+//
+// maps a value to its bin, or to -1 if it is outside of the range
+//
+class HistogramBinner {
+ public:
+  explicit HistogramBinner(const HistogramBins &bins)
+      : lower_(bins.lower),
+        scale_(bins.num_bins / (bins.upper - bins.lower)),
+        num_bins_(bins.num_bins) {}
+
+  __host__ __device__ inline int operator()(const float value) const {
+    const float bin = (value - lower_) * scale_;
+    // also false for NaNs
+    return (bin >= 0.f && bin < num_bins_) ? static_cast<int>(bin) : -1;
+  }
+
+  __host__ __device__ inline unsigned int NumBins() const { return num_bins_; }
+
+ private:
+  float lower_, scale_;
+  unsigned int num_bins_;
+};
+
+//
+// Mask readers return whether element i of the array is counted. Any nonzero
+// mask element selects the corresponding array element.
+//
+
+struct HistogramNoMask {
+  template <typename IndexType>
+  __host__ __device__ inline bool operator()(IndexType) const {
+    return true;
+  }
+};
+
+template <typename Reader>
+class HistogramMask {
+ public:
+  explicit HistogramMask(const Reader &reader) : reader_(reader) {}
+
+  LIBCUA_EXEC_CHECK_DISABLE
+  template <typename IndexType>
+  __host__ __device__ inline bool operator()(IndexType i) const {
+    return reader_(i) != typename Reader::Scalar();
+  }
+
+ private:
+  Reader reader_;
+};
+
+// HistogramMaskOf<LinearReader, Mask, IndexT>::type reads a mask array
+// through the given linear reader type (see LinearReader2D), with the same
+// index type as the reader for the array; HistogramNoMask stands for itself.
+template <template <typename, typename> class LinearReader, typename Mask,
+          typename IndexT>
+struct HistogramMaskOf {
+  typedef HistogramMask<LinearReader<Mask, IndexT>> type;
+
+  static inline type Get(const Mask &mask) {
+    return type(LinearReader<Mask, IndexT>(mask));
+  }
+};
+
+template <template <typename, typename> class LinearReader, typename IndexT>
+struct HistogramMaskOf<LinearReader, HistogramNoMask, IndexT> {
+  typedef HistogramNoMask type;
+
+  static inline type Get(const HistogramNoMask &mask) { return mask; }
+};
+
+template <typename ArrayType, typename MaskType>
+inline void CheckHistogramMask2D(const ArrayType &array,
+                                 const MaskType &mask) {
+  static_assert(std::is_arithmetic<typename MaskType::Scalar>::value,
+                "Histogram masks must have an arithmetic scalar type.");
+  CheckSameDevice(array, mask);
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (array.Width() != mask.Width() || array.Height() != mask.Height()) {
+    throw std::runtime_error("Arrays have different sizes (" +
+                             ArraySizeToString2D(array) + " vs " +
+                             ArraySizeToString2D(mask) + ").");
+  }
+#endif
+}
+
+template <typename ArrayType, typename MaskType>
+inline void CheckHistogramMask3D(const ArrayType &array,
+                                 const MaskType &mask) {
+  static_assert(std::is_arithmetic<typename MaskType::Scalar>::value,
+                "Histogram masks must have an arithmetic scalar type.");
+  CheckSameDevice(array, mask);
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (array.Width() != mask.Width() || array.Height() != mask.Height() ||
+      array.Depth() != mask.Depth()) {
+    throw std::runtime_error("Arrays have different sizes (" +
+                             ArraySizeToString3D(array) + " vs " +
+                             ArraySizeToString3D(mask) + ").");
+  }
+#endif
+}
+
+inline void CheckHistogramBins(const HistogramBins &bins) {
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (bins.num_bins == 0 || !(bins.lower < bins.upper)) {
+    throw std::runtime_error(
+        "Histograms need at least one bin and a non-empty range.");
+  }
+#endif
+}
+
+}  // namespace internal
+
+//------------------------------------------------------------------------------
+//
+// kernel definitions
+//
+//------------------------------------------------------------------------------
+
+namespace kernel {
+
+//
+// Add one to the given bin (if it is not -1). Lanes of a warp that hit the
+// same bin are aggregated first, so that a single atomic adds their count;
+// this keeps atomics on popular bins, e.g., the background of an image, from
+// being serialized. All lanes of the warp must call this together.
+//
+template <typename CountType>
+__device__ inline void AddToHistogramBin(CountType *bins, const int bin) {
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ >= 700
+  const unsigned int peers = __match_any_sync(0xffffffff, bin);
+  const unsigned int lane = threadIdx.x % warpSize;
+  if (bin >= 0 && lane == __ffs(peers) - 1) {
+    atomicAdd(bins + bin, static_cast<CountType>(__popc(peers)));
+  }
+#else
+  if (bin >= 0) {
+    atomicAdd(bins + bin, static_cast<CountType>(1));
+  }
+#endif
+}
+
+//
+// Histogram of elements [0, size) of the reader, with one set of bins per
+// channel. If privatized, each block counts in shared memory and then merges
+// its non-empty bins into the global counts; otherwise, it counts in global
+// memory directly.
+//
+template <typename Reader, typename MaskReader>
+__global__ void Histogram(const Reader reader, const MaskReader mask,
+                          const typename Reader::IndexType size,
+                          const internal::HistogramBinner binner,
+                          const bool privatized, unsigned long long *counts) {
+  typedef typename Reader::IndexType IndexType;
+  typedef typename Reader::Scalar Scalar;
+  const int kNumChannels = internal::ChannelTraits<Scalar>::kNumChannels;
+
+  extern __shared__ unsigned int shared_bins[];
+
+  const unsigned int num_bins = binner.NumBins();
+  const unsigned int num_counts = kNumChannels * num_bins;
+  if (privatized) {
+    for (unsigned int i = threadIdx.x; i < num_counts; i += blockDim.x) {
+      shared_bins[i] = 0;
+    }
+    __syncthreads();
+  }
+
+  // the loop runs while any lane of the warp has elements left, so that every
+  // lane reaches the warp-wide match in AddToHistogramBin(); lanes past the end
+  // add to no bin (kHistogramBlockSize is a multiple of the warp size)
+  const IndexType stride = blockDim.x * gridDim.x;
+  IndexType i = blockIdx.x * blockDim.x + threadIdx.x;
+  bool in_range = (i < size);
+  while (__ballot_sync(0xffffffff, in_range) != 0) {
+    const bool counted = in_range && mask(i);
+    typename internal::FloatChannelsOf<Scalar>::type value;
+    if (counted) {
+      value = internal::ToFloatChannels(reader(i));
+    }
+    for (int c = 0; c < kNumChannels; ++c) {
+      const int bin = counted ? binner(value.value[c]) : -1;
+      if (privatized) {
+        AddToHistogramBin(shared_bins + c * num_bins, bin);
+      } else {
+        AddToHistogramBin(counts + c * num_bins, bin);
+      }
+    }
+    // stop before i + stride can wrap around near the top of IndexType
+    in_range = in_range && (size - i > stride);
+    i += stride;
+  }
+
+  if (privatized) {
+    __syncthreads();
+    for (unsigned int i = threadIdx.x; i < num_counts; i += blockDim.x) {
+      if (shared_bins[i] > 0) {
+        atomicAdd(counts + i, static_cast<unsigned long long>(shared_bins[i]));
+      }
+    }
+  }
+}
+
+}  // namespace kernel
+
+//------------------------------------------------------------------------------
+//
+// host implementations
+//
+//------------------------------------------------------------------------------
+
+namespace host {
+
+//
+// Histogram of elements [0, size) of the reader on the CPU thread pool; each
+// task counts a contiguous range of elements into its own bins, which are
+// summed at the end.
+//
+template <typename Reader, typename MaskReader>
+inline std::vector<unsigned long long> Histogram(const Reader &reader,
+                                                 const MaskReader &mask,
+                                                 size_t size,
+                                                 const HistogramBins &bins) {
+  typedef typename Reader::Scalar Scalar;
+  const int kNumChannels = internal::ChannelTraits<Scalar>::kNumChannels;
+  const internal::HistogramBinner binner(bins);
+  const size_t num_counts = kNumChannels * bins.num_bins;
+
+  const size_t num_tasks = std::max<size_t>(
+      1, std::min(internal::kMaxHistogramHostTasks,
+                  size / internal::kMinElementsPerTask));
+  std::vector<std::vector<unsigned long long>> task_counts(
+      num_tasks, std::vector<unsigned long long>(num_counts, 0));
+
+  internal::HostThreadPool::Instance().ParallelFor(
+      num_tasks, [&](size_t task) {
+        unsigned long long *counts = task_counts[task].data();
+        const size_t end = size * (task + 1) / num_tasks;
+        for (size_t i = size * task / num_tasks; i < end; ++i) {
+          if (!mask(i)) {
+            continue;
+          }
+          const typename internal::FloatChannelsOf<Scalar>::type value =
+              internal::ToFloatChannels(reader(i));
+          for (int c = 0; c < kNumChannels; ++c) {
+            const int bin = binner(value.value[c]);
+            if (bin >= 0) {
+              ++counts[c * bins.num_bins + bin];
+            }
+          }
+        }
+      });
+
+  std::vector<unsigned long long> counts(num_counts, 0);
+  for (const std::vector<unsigned long long> &partial_counts : task_counts) {
+    for (size_t i = 0; i < num_counts; ++i) {
+      counts[i] += partial_counts[i];
+    }
+  }
+  return counts;
+}
+
+//
+// host entry points for CudaArray2DBase::Histogram() and
+// CudaArray3DBase::Histogram(); mask is a host array or HistogramNoMask
+//
+template <typename ArrayType, typename MaskType>
+inline std::vector<unsigned long long> Histogram2D(const ArrayType &array,
+                                                   const MaskType &mask,
+                                                   const HistogramBins &bins) {
+  typedef internal::HistogramMaskOf<internal::LinearReader2D, MaskType, size_t>
+      Mask;
+  return Histogram(internal::LinearReader2D<ArrayType, size_t>(array),
+                   Mask::Get(mask), array.Size(), bins);
+}
+
+template <typename ArrayType, typename MaskType>
+inline std::vector<unsigned long long> Histogram3D(const ArrayType &array,
+                                                   const MaskType &mask,
+                                                   const HistogramBins &bins) {
+  typedef internal::HistogramMaskOf<internal::LinearReader3D, MaskType, size_t>
+      Mask;
+  return Histogram(internal::LinearReader3D<ArrayType, size_t>(array),
+                   Mask::Get(mask), array.Size(), bins);
+}
+
+}  // namespace host
+
+//------------------------------------------------------------------------------
+//
+// device implementations
+//
+//------------------------------------------------------------------------------
+
+namespace internal {
+
+//
+// Compute the histogram of elements [0, size) of the reader on the given
+// stream and wait for the result.
+//
+template <typename Reader, typename MaskReader>
+inline std::vector<unsigned long long> Histogram(const Reader &reader,
+                                                 const MaskReader &mask,
+                                                 size_t size,
+                                                 const HistogramBins &bins,
+                                                 int device,
+                                                 cudaStream_t stream) {
+  const int kNumChannels =
+      ChannelTraits<typename Reader::Scalar>::kNumChannels;
+  const size_t num_counts = kNumChannels * bins.num_bins;
+  const size_t shared_mem_bytes = num_counts * sizeof(unsigned int);
+  const bool privatized = (shared_mem_bytes <= kMaxHistogramSharedBytes);
+
+  SetDevice(device);
+  const unsigned int num_blocks = static_cast<unsigned int>(std::min<size_t>(
+      kHistogramBlocksPerMultiprocessor * NumMultiprocessors(device),
+      std::max<size_t>(1, (size + kHistogramBlockSize - 1) /
+                              kHistogramBlockSize)));
+
+  CachingAllocator<> &allocator = CachingAllocator<>::Instance();
+  unsigned long long *device_counts = static_cast<unsigned long long *>(
+      allocator.Allocate(num_counts * sizeof(unsigned long long), device,
+                         stream));
+  cudaMemsetAsync(device_counts, 0, num_counts * sizeof(unsigned long long),
+                  stream);
+  kernel::Histogram<<<num_blocks, kHistogramBlockSize,
+                      privatized ? shared_mem_bytes : 0, stream>>>(
+      reader, mask, size, HistogramBinner(bins), privatized, device_counts);
+
+  std::vector<unsigned long long> counts(num_counts);
+  cudaMemcpyAsync(counts.data(), device_counts,
+                  num_counts * sizeof(unsigned long long),
+                  cudaMemcpyDeviceToHost, stream);
+  allocator.Free(device_counts);
+  cudaStreamSynchronize(stream);
+
+  return counts;
+}
+
+//
+// device entry points for CudaArray2DBase::Histogram() and
+// CudaArray3DBase::Histogram(); mask is a device view or HistogramNoMask.
+// Linear indices are only widened when the array requires it.
+//
+template <typename ArrayType, typename MaskType>
+inline std::vector<unsigned long long> Histogram2D(
+    const ArrayType &array, const MaskType &mask, size_t size,
+    const HistogramBins &bins, int device, cudaStream_t stream) {
+  if (Needs64BitIndexing(size)) {
+    return Histogram(
+        LinearReader2D<ArrayType, unsigned long long>(array),
+        HistogramMaskOf<LinearReader2D, MaskType, unsigned long long>::Get(
+            mask),
+        size, bins, device, stream);
+  }
+  return Histogram(LinearReader2D<ArrayType, unsigned int>(array),
+                   HistogramMaskOf<LinearReader2D, MaskType, unsigned int>::Get(
+                       mask),
+                   size, bins, device, stream);
+}
+
+template <typename ArrayType, typename MaskType>
+inline std::vector<unsigned long long> Histogram3D(
+    const ArrayType &array, const MaskType &mask, size_t size,
+    const HistogramBins &bins, int device, cudaStream_t stream) {
+  if (Needs64BitIndexing(size)) {
+    return Histogram(
+        LinearReader3D<ArrayType, unsigned long long>(array),
+        HistogramMaskOf<LinearReader3D, MaskType, unsigned long long>::Get(
+            mask),
+        size, bins, device, stream);
+  }
+  return Histogram(LinearReader3D<ArrayType, unsigned int>(array),
+                   HistogramMaskOf<LinearReader3D, MaskType, unsigned int>::Get(
+                       mask),
+                   size, bins, device, stream);
+}
+
+}  // namespace internal
+
+}  // namespace cua
+
+#endif  // LIBCUA_HISTOGRAM_H_
@@ -0,0 +1,291 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_HOST_THREAD_POOL_H_
+#define LIBCUA_HOST_THREAD_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cua {
+
+namespace internal {
+
+/**
+ * @class HostThreadPool
+ * @brief Fixed-size pool of worker threads used by host-side array operations.
+ *
+ * The pool executes one ParallelFor() at a time; the calling thread also
+ * participates in the work. Calls made from inside a running task (i.e.,
+ * nested ParallelFor() calls) are executed serially on the calling thread.
+ */
+class HostThreadPool {
+ public:
+  /**
+   * Constructor.
+   * @param num_threads total number of threads used for each ParallelFor(),
+   *   including the calling thread
+   */
+  explicit HostThreadPool(
+      unsigned int num_threads = std::thread::hardware_concurrency());
+
+  ~HostThreadPool();
+
+  HostThreadPool(const HostThreadPool &) = delete;
+  HostThreadPool &operator=(const HostThreadPool &) = delete;
+
+  /**
+   * @return the process-wide pool used by the host array operations
+   */
+  static HostThreadPool &Instance() {
+    static HostThreadPool pool;
+    return pool;
+  }
+
+  /**
+   * @return the number of threads that take part in each ParallelFor()
+   */
+  inline unsigned int NumThreads() const { return workers_.size() + 1; }
+
+  /**
+   * Call `func(i)` for every i in [0, num_tasks), distributing the tasks over
+   * the pool, and block until all tasks have finished. If any task throws, the
+   * first exception is rethrown on the calling thread.
+   * @param num_tasks number of tasks to run
+   * @param func function with signature `void func(size_t task_index)`
+   */
+  template <typename Function>
+  void ParallelFor(size_t num_tasks, const Function &func);
+
+ private:
+  static inline bool &InTask() {
+    static thread_local bool in_task = false;
+    return in_task;
+  }
+
+  void WorkerLoop_();
+  void RunTasks_();
+
+  std::vector<std::thread> workers_;
+
+  std::mutex launch_mutex_;  // serializes ParallelFor() calls
+  std::mutex mutex_;         // guards the fields below
+  std::condition_variable work_cv_, done_cv_;
+
+  std::function<void(size_t)> task_;
+  size_t num_tasks_;
+  std::atomic<size_t> next_task_;
+  unsigned int num_active_workers_;
+  unsigned long long generation_;  // incremented once per ParallelFor()
+  std::exception_ptr exception_;
+  bool shutdown_;
+};
+
+//------------------------------------------------------------------------------
+//
+// class method implementations
+//
+//------------------------------------------------------------------------------
+
+inline HostThreadPool::HostThreadPool(unsigned int num_threads)
+    : num_tasks_(0),
+      next_task_(0),
+      num_active_workers_(0),
+      generation_(0),
+      shutdown_(false) {
+  num_threads = std::max(num_threads, 1u);
+  workers_.reserve(num_threads - 1);
+  for (unsigned int i = 1; i < num_threads; ++i) {
+    workers_.emplace_back(&HostThreadPool::WorkerLoop_, this);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+inline HostThreadPool::~HostThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Function>
+inline void HostThreadPool::ParallelFor(size_t num_tasks,
+                                        const Function &func) {
+  if (num_tasks == 0) {
+    return;
+  }
+
+  // run serially if there is nothing to gain from the pool, or if we're
+  // already inside one of its tasks
+  if (workers_.empty() || num_tasks == 1 || InTask()) {
+    for (size_t i = 0; i < num_tasks; ++i) {
+      func(i);
+    }
+    return;
+  }
+
+  std::lock_guard<std::mutex> launch_lock(launch_mutex_);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = [&func](size_t i) { func(i); };
+    num_tasks_ = num_tasks;
+    next_task_ = 0;
+    num_active_workers_ = workers_.size();
+    exception_ = nullptr;
+    ++generation_;
+  }
+  work_cv_.notify_all();
+
+  RunTasks_();
+
+  std::exception_ptr exception;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return num_active_workers_ == 0; });
+    task_ = nullptr;
+    exception = exception_;
+  }
+
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+inline void HostThreadPool::WorkerLoop_() {
+  unsigned long long generation = 0;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock,
+                  [&] { return shutdown_ || generation_ != generation; });
+    if (shutdown_) {
+      return;
+    }
+    generation = generation_;
+
+    lock.unlock();
+    RunTasks_();
+    lock.lock();
+
+    if (--num_active_workers_ == 0) {
+      done_cv_.notify_all();
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+inline void HostThreadPool::RunTasks_() {
+  InTask() = true;
+  for (size_t i = next_task_++; i < num_tasks_; i = next_task_++) {
+    try {
+      task_(i);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!exception_) {
+        exception_ = std::current_exception();
+      }
+      next_task_ = num_tasks_;  // skip the remaining tasks
+    }
+  }
+  InTask() = false;
+}
+
+//------------------------------------------------------------------------------
+//
+// convenience loops over the process-wide pool
+//
+//------------------------------------------------------------------------------
+
+// minimum number of elements handled by one thread-pool task
+static const size_t kMinElementsPerTask = 1 << 14;
+
+//
+// call func(y_begin, y_end) over bands of rows covering [0, height)
+//
+template <typename Function>
+inline void ParallelForRows(size_t height, size_t width, const Function &func) {
+  const size_t rows_per_task =
+      std::max<size_t>(1, kMinElementsPerTask / std::max<size_t>(width, 1));
+  const size_t num_tasks = (height + rows_per_task - 1) / rows_per_task;
+
+  HostThreadPool::Instance().ParallelFor(num_tasks, [&](size_t task) {
+    const size_t y_begin = task * rows_per_task;
+    func(y_begin, std::min(y_begin + rows_per_task, height));
+  });
+}
+
+//
+// call func(x_begin, x_end, y_begin, y_end) for each tile_size x tile_size tile
+// covering a width x height array
+//
+template <typename Function>
+inline void ParallelForTiles(size_t width, size_t height, size_t tile_size,
+                             const Function &func) {
+  const size_t num_tiles_x = (width + tile_size - 1) / tile_size;
+  const size_t num_tiles_y = (height + tile_size - 1) / tile_size;
+
+  HostThreadPool::Instance().ParallelFor(
+      num_tiles_x * num_tiles_y, [&](size_t tile) {
+        const size_t x_begin = (tile % num_tiles_x) * tile_size;
+        const size_t y_begin = (tile / num_tiles_x) * tile_size;
+        func(x_begin, std::min(x_begin + tile_size, width), y_begin,
+             std::min(y_begin + tile_size, height));
+      });
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace internal
+
+}  // namespace cua
+
+#endif  // LIBCUA_HOST_THREAD_POOL_H_
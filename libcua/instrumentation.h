@@ -0,0 +1,442 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_INSTRUMENTATION_H_
+#define LIBCUA_INSTRUMENTATION_H_
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "util.h"
+
+//------------------------------------------------------------------------------
+//
+// Opt-in timing of library operations. Define LIBCUA_ENABLE_INSTRUMENTATION
+// before including any libcua header (or add it to the compile definitions) to
+// have every instrumented operation record its call count, latency, and the
+// number of bytes it moved into InstrumentationRegistry::Instance(). Without
+// the definition, LIBCUA_INSTRUMENT expands to nothing and no timing code is
+// compiled in.
+//
+// GPU operations are timed with a pair of CUDA events around the work on the
+// array's stream; this measures GPU execution time, and the calling thread is
+// never blocked. Pending event pairs are resolved when the registry is
+// queried, and are then reused by later operations. Host-array operations are
+// timed with a wall clock.
+//
+//     #define LIBCUA_ENABLE_INSTRUMENTATION
+//     #include "cudaArray2D.h"
+//     ...
+//     array.Transpose(&transposed);
+//     cua::InstrumentationRegistry::Instance().DumpJson("timings.json");
+//
+//------------------------------------------------------------------------------
+
+#ifdef LIBCUA_ENABLE_INSTRUMENTATION
+#define LIBCUA_INSTRUMENT(name, bytes, device, stream, is_host) \
+  ::cua::internal::ScopedOperationTimer libcua_operation_timer_( \
+      (name), (bytes), (device), (stream), (is_host))
+#else
+#define LIBCUA_INSTRUMENT(name, bytes, device, stream, is_host)
+#endif  // LIBCUA_ENABLE_INSTRUMENTATION
+
+namespace cua {
+
+/**
+ * @struct OperationStats
+ * @brief Accumulated timings of one operation.
+ */
+struct OperationStats {
+  /// number of latency histogram bins; bin i counts calls that took
+  /// [2^i, 2^(i+1)) microseconds, with bin 0 also counting faster calls and
+  /// the last bin also counting slower calls
+  static const int kNumHistogramBins = 24;
+
+  OperationStats()
+      : count(0), total_ms(0.), min_ms(0.), max_ms(0.), bytes(0),
+        histogram() {}
+
+  /**
+   * @return mean latency of the operation, in milliseconds
+   */
+  inline double MeanMs() const { return (count > 0) ? total_ms / count : 0.; }
+
+  /**
+   * @return effective throughput, i.e., total bytes read and written divided
+   *   by total time, in GB/s (1e9 bytes per second)
+   */
+  inline double GigabytesPerSecond() const {
+    return (total_ms > 0.) ? bytes / (total_ms * 1e6) : 0.;
+  }
+
+  unsigned long long count;  // number of calls
+  double total_ms, min_ms, max_ms;
+  unsigned long long bytes;  // total bytes read and written
+  unsigned long long histogram[kNumHistogramBins];
+};
+
+/**
+ * @class InstrumentationRegistry
+ * @brief Process-wide record of operation timings; see LIBCUA_INSTRUMENT.
+ *
+ * All member functions are thread-safe.
+ */
+class InstrumentationRegistry {
+ public:
+  /**
+   * @return the process-wide registry
+   */
+  static InstrumentationRegistry &Instance() {
+    // intentionally leaked so that it can be used during static destruction
+    static InstrumentationRegistry *instance = new InstrumentationRegistry();
+    return *instance;
+  }
+
+  /**
+   * Add one timed call of an operation.
+   * @param name operation name
+   * @param elapsed_ms latency of the call, in milliseconds
+   * @param bytes number of bytes read and written by the call
+   */
+  void Record(const std::string &name, double elapsed_ms, size_t bytes);
+
+  /**
+   * Get a pair of events for timing an operation on the GPU, reusing the
+   * events of resolved timings if possible; hand them back with
+   * RecordEvents().
+   * @param device GPU on which the events are recorded; it must be the current
+   *   device
+   * @param start output event to record before the operation's work
+   * @param stop output event to record after the operation's work
+   */
+  void AcquireEvents(int device, cudaEvent_t *start, cudaEvent_t *stop);
+
+  /**
+   * Add one call of an operation that was timed on the GPU. The events, from
+   * AcquireEvents(), are owned by the registry from now on, and the call is
+   * counted once the stop event has completed.
+   * @param name operation name
+   * @param device GPU on which the events were recorded
+   * @param start event recorded before the operation's work
+   * @param stop event recorded after the operation's work
+   * @param bytes number of bytes read and written by the call
+   */
+  void RecordEvents(const std::string &name, int device, cudaEvent_t start,
+                    cudaEvent_t stop, size_t bytes);
+
+  /**
+   * Wait for all pending GPU timings and return the accumulated statistics.
+   * @return statistics for each operation, by name
+   */
+  std::map<std::string, OperationStats> Stats();
+
+  /**
+   * @param name operation name
+   * @return statistics of the given operation; all zero if it was never called
+   */
+  OperationStats Stats(const std::string &name);
+
+  /**
+   * Discard all statistics, including pending GPU timings.
+   */
+  void Reset();
+
+  /**
+   * @return the statistics of all operations as a JSON object
+   */
+  std::string ToJson();
+
+  /**
+   * Write ToJson() to a file.
+   * @param path output file
+   */
+  void DumpJson(const std::string &path);
+
+ private:
+  struct EventPair {
+    cudaEvent_t start, stop;
+  };
+
+  struct PendingTiming {
+    std::string name;
+    int device;
+    EventPair events;
+    size_t bytes;
+  };
+
+  // pending GPU timings are resolved without blocking once this many queue up
+  static const size_t kMaxPending = 256;
+
+  InstrumentationRegistry() {}
+  InstrumentationRegistry(const InstrumentationRegistry &) = delete;
+  InstrumentationRegistry &operator=(const InstrumentationRegistry &) = delete;
+
+  // assumes mutex_ is held
+  void Record_(const std::string &name, double elapsed_ms, size_t bytes);
+
+  // Resolve pending GPU timings; if wait is false, only those that have
+  // already completed. Assumes mutex_ is held.
+  void ResolvePending_(bool wait);
+
+  std::mutex mutex_;
+  std::map<std::string, OperationStats> stats_;
+  std::vector<PendingTiming> pending_;
+  std::map<int, std::vector<EventPair>> free_events_;  // by device
+};
+
+//------------------------------------------------------------------------------
+//
+// class method implementations
+//
+//------------------------------------------------------------------------------
+
+inline void InstrumentationRegistry::Record(const std::string &name,
+                                            double elapsed_ms, size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Record_(name, elapsed_ms, bytes);
+}
+
+//------------------------------------------------------------------------------
+
+inline void InstrumentationRegistry::AcquireEvents(int device,
+                                                   cudaEvent_t *start,
+                                                   cudaEvent_t *stop) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<EventPair> &free_events = free_events_[device];
+    if (!free_events.empty()) {
+      *start = free_events.back().start;
+      *stop = free_events.back().stop;
+      free_events.pop_back();
+      return;
+    }
+  }
+  cudaEventCreate(start);
+  cudaEventCreate(stop);
+}
+
+//------------------------------------------------------------------------------
+
+inline void InstrumentationRegistry::RecordEvents(const std::string &name,
+                                                  int device,
+                                                  cudaEvent_t start,
+                                                  cudaEvent_t stop,
+                                                  size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_.push_back({name, device, {start, stop}, bytes});
+  if (pending_.size() >= kMaxPending) {
+    ResolvePending_(false);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+inline std::map<std::string, OperationStats> InstrumentationRegistry::Stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ResolvePending_(true);
+  return stats_;
+}
+
+inline OperationStats InstrumentationRegistry::Stats(const std::string &name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ResolvePending_(true);
+  auto it = stats_.find(name);
+  return (it != stats_.end()) ? it->second : OperationStats();
+}
+
+//------------------------------------------------------------------------------
+
+inline void InstrumentationRegistry::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const PendingTiming &timing : pending_) {
+    free_events_[timing.device].push_back(timing.events);
+  }
+  pending_.clear();
+  stats_.clear();
+}
+
+//------------------------------------------------------------------------------
+
+inline std::string InstrumentationRegistry::ToJson() {
+  const std::map<std::string, OperationStats> stats = Stats();
+
+  std::ostringstream json;
+  json.precision(6);
+  json << "{\n  \"operations\": {";
+  bool first = true;
+  for (const auto &entry : stats) {
+    const OperationStats &op = entry.second;
+    json << (first ? "\n" : ",\n") << "    \"";
+    for (const char c : entry.first) {
+      if (c == '"' || c == '\\') {
+        json << '\\';
+      }
+      json << c;
+    }
+    json << "\": {\"count\": " << op.count << ", \"total_ms\": " << op.total_ms
+         << ", \"mean_ms\": " << op.MeanMs() << ", \"min_ms\": " << op.min_ms
+         << ", \"max_ms\": " << op.max_ms << ", \"bytes\": " << op.bytes
+         << ", \"gb_per_s\": " << op.GigabytesPerSecond()
+         << ", \"histogram_log2_us\": [";
+    for (int i = 0; i < OperationStats::kNumHistogramBins; ++i) {
+      json << (i > 0 ? ", " : "") << op.histogram[i];
+    }
+    json << "]}";
+    first = false;
+  }
+  json << (first ? "}\n}\n" : "\n  }\n}\n");
+  return json.str();
+}
+
+inline void InstrumentationRegistry::DumpJson(const std::string &path) {
+  const std::string json = ToJson();
+  std::ofstream file(path);
+  file << json;
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (!file) {
+    throw std::runtime_error("Could not write " + path);
+  }
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+inline void InstrumentationRegistry::Record_(const std::string &name,
+                                             double elapsed_ms, size_t bytes) {
+  OperationStats &op = stats_[name];
+  op.min_ms = (op.count == 0) ? elapsed_ms : std::min(op.min_ms, elapsed_ms);
+  op.max_ms = (op.count == 0) ? elapsed_ms : std::max(op.max_ms, elapsed_ms);
+  ++op.count;
+  op.total_ms += elapsed_ms;
+  op.bytes += bytes;
+
+  // log2 bin of the latency in microseconds
+  int bin = 0;
+  double us = elapsed_ms * 1e3;
+  while (us >= 2. && bin < OperationStats::kNumHistogramBins - 1) {
+    us *= 0.5;
+    ++bin;
+  }
+  ++op.histogram[bin];
+}
+
+//------------------------------------------------------------------------------
+
+inline void InstrumentationRegistry::ResolvePending_(bool wait) {
+  size_t num_pending = 0;
+  for (PendingTiming &timing : pending_) {
+    if (wait) {
+      cudaEventSynchronize(timing.events.stop);
+    } else if (cudaEventQuery(timing.events.stop) == cudaErrorNotReady) {
+      pending_[num_pending++] = timing;
+      continue;
+    }
+
+    float elapsed_ms = 0.f;
+    cudaEventElapsedTime(&elapsed_ms, timing.events.start, timing.events.stop);
+    Record_(timing.name, elapsed_ms, timing.bytes);
+    free_events_[timing.device].push_back(timing.events);
+  }
+  pending_.resize(num_pending);
+}
+
+//------------------------------------------------------------------------------
+
+namespace internal {
+
+/**
+ * @class ScopedOperationTimer
+ * @brief Times the enclosing scope; use through LIBCUA_INSTRUMENT.
+ *
+ * For device operations, the events are recorded on the given stream, so the
+ * measured time covers all work enqueued on it within the scope.
+ */
+class ScopedOperationTimer {
+ public:
+  ScopedOperationTimer(const char *name, size_t bytes, int device,
+                       cudaStream_t stream, bool is_host)
+      : name_(name),
+        bytes_(bytes),
+        device_(device),
+        stream_(stream),
+        is_host_(is_host) {
+    if (is_host_) {
+      start_time_ = std::chrono::steady_clock::now();
+    } else {
+      SetDevice(device_);
+      InstrumentationRegistry::Instance().AcquireEvents(device_, &start_,
+                                                        &stop_);
+      cudaEventRecord(start_, stream_);
+    }
+  }
+
+  ~ScopedOperationTimer() {
+    if (is_host_) {
+      const std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start_time_;
+      InstrumentationRegistry::Instance().Record(name_, elapsed.count(),
+                                                 bytes_);
+    } else {
+      cudaEventRecord(stop_, stream_);
+      InstrumentationRegistry::Instance().RecordEvents(name_, device_, start_,
+                                                       stop_, bytes_);
+    }
+  }
+
+ private:
+  ScopedOperationTimer(const ScopedOperationTimer &) = delete;
+  ScopedOperationTimer &operator=(const ScopedOperationTimer &) = delete;
+
+  const char *name_;
+  const size_t bytes_;
+  const int device_;
+  const cudaStream_t stream_;
+  const bool is_host_;
+  std::chrono::steady_clock::time_point start_time_;
+  cudaEvent_t start_, stop_;
+};
+
+}  // namespace internal
+
+}  // namespace cua
+
+#endif  // LIBCUA_INSTRUMENTATION_H_
@@ -0,0 +1,165 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef LIBCUA_LAUNCH_CONFIG_H_
+#define LIBCUA_LAUNCH_CONFIG_H_
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include "util.h"
+
+namespace cua {
+
+/**
+ * Grid sizing for the element-wise kernels of an array (Fill, ApplyOp,
+ * ApplyScalarOp, and CopyTo). These kernels are grid-stride loops, so every
+ * mode covers the whole array for any block dimension; the modes only differ in
+ * how many blocks are launched.
+ */
+enum class LaunchMode {
+  /// one thread per element, up to the device's maximum grid dimensions
+  kOneThreadPerElement,
+  /// no more blocks than can be resident on the device at once, as reported by
+  /// the CUDA occupancy calculator (default)
+  kOccupancy,
+  /// persistent threads: at most one block per multiprocessor, each of which
+  /// loops over many elements; this minimizes the launch footprint of small
+  /// arrays and leaves room for concurrent kernels on other streams
+  kPersistent
+};
+
+namespace internal {
+
+//------------------------------------------------------------------------------
+
+/**
+ * @return the number of multiprocessors on the given device; queried once per
+ *   device
+ */
+inline unsigned int NumMultiprocessors(int device) {
+  static std::mutex mutex;
+  static std::map<int, unsigned int> num_multiprocessors;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = num_multiprocessors.find(device);
+  if (it == num_multiprocessors.end()) {
+    int count = 0;
+    cudaDeviceGetAttribute(&count, cudaDevAttrMultiProcessorCount, device);
+    it = num_multiprocessors
+             .emplace(device, static_cast<unsigned int>(std::max(count, 1)))
+             .first;
+  }
+  return it->second;
+}
+
+/**
+ * @return the number of blocks of the kernel that can be resident on one
+ *   multiprocessor of the current device; queried once per device, block size,
+ *   and shared memory size
+ */
+template <typename Kernel>
+inline unsigned int MaxActiveBlocksPerMultiprocessor(Kernel kernel, int device,
+                                                     unsigned int block_size,
+                                                     size_t shared_mem_bytes) {
+  // one cache per kernel instantiation
+  static std::mutex mutex;
+  static std::map<std::tuple<int, unsigned int, size_t>, unsigned int>
+      num_blocks;
+
+  const auto key = std::make_tuple(device, block_size, shared_mem_bytes);
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = num_blocks.find(key);
+  if (it == num_blocks.end()) {
+    int count = 0;
+    cudaOccupancyMaxActiveBlocksPerMultiprocessor(&count, kernel, block_size,
+                                                  shared_mem_bytes);
+    it = num_blocks.emplace(key, static_cast<unsigned int>(std::max(count, 1)))
+             .first;
+  }
+  return it->second;
+}
+
+/**
+ * Compute the launch grid for a grid-stride kernel. The device must already be
+ * current.
+ * @param kernel the kernel function to be launched
+ * @param num_tiles number of block-sized tiles needed to cover the array, i.e.,
+ *   the grid for one thread per element
+ * @param block_dim block dimensions of the launch
+ * @param shared_mem_bytes dynamic shared memory per block
+ * @param device GPU on which the kernel runs
+ * @param mode how to size the grid
+ * @return a grid no larger than num_tiles (or the device limits) along any
+ *   dimension
+ */
+template <typename Kernel>
+inline dim3 GridStrideGridDim(Kernel kernel, const dim3 &num_tiles,
+                              const dim3 &block_dim, size_t shared_mem_bytes,
+                              int device, LaunchMode mode) {
+  // maximum grid dimensions for all compute capabilities >= 3.0
+  dim3 grid_dim(std::min(num_tiles.x, 2147483647u),
+                std::min(num_tiles.y, 65535u), std::min(num_tiles.z, 65535u));
+  if (mode == LaunchMode::kOneThreadPerElement) {
+    return grid_dim;
+  }
+
+  unsigned int max_blocks = NumMultiprocessors(device);
+  if (mode == LaunchMode::kOccupancy) {
+    max_blocks *= MaxActiveBlocksPerMultiprocessor(
+        kernel, device, block_dim.x * block_dim.y * block_dim.z,
+        shared_mem_bytes);
+  }
+
+  // spend the block budget along x first, so that the blocks of one wave read
+  // contiguous memory
+  grid_dim.x = std::min(grid_dim.x, max_blocks);
+  grid_dim.y = std::min(grid_dim.y, std::max(1u, max_blocks / grid_dim.x));
+  grid_dim.z = std::min(
+      grid_dim.z, std::max(1u, max_blocks / (grid_dim.x * grid_dim.y)));
+
+  return grid_dim;
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace internal
+
+}  // namespace cua
+
+#endif  // LIBCUA_LAUNCH_CONFIG_H_
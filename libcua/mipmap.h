@@ -0,0 +1,350 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_MIPMAP_H_
+#define LIBCUA_MIPMAP_H_
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "channels.h"
+#include "hostThreadPool.h"
+#include "util.h"
+
+namespace cua {
+
+/**
+ * Downsampling filters for generating the levels of a mipmap pyramid; see
+ * CudaMipmappedTexture2D::GenerateMipmaps().
+ *
+ * Level l + 1 is half the size of level l in each dimension (rounded down, and
+ * at least one), and element x of level l + 1 is centered between elements 2x
+ * and 2x + 1 of level l. kBox averages these two elements along each axis.
+ * kGaussian applies the binomial filter [1 3 3 1] / 8 to elements 2x - 1
+ * through 2x + 2, which suppresses more aliasing at the cost of some blur.
+ * Reads outside of level l are clamped to its edge.
+ */
+enum class MipmapFilter { kBox, kGaussian };
+
+namespace internal {
+
+//------------------------------------------------------------------------------
+
+// Number of levels in a full mipmap pyramid, i.e., down to a 1x1(x1) level.
+inline unsigned int MaxMipmapLevels(size_t width, size_t height,
+                                    size_t depth = 1) {
+  size_t size = std::max(width, std::max(height, depth));
+  unsigned int num_levels = 1;
+  while (size > 1) {
+    size >>= 1;
+    ++num_levels;
+  }
+  return num_levels;
+}
+
+// Number of levels to allocate for a requested num_levels, where zero selects
+// a full pyramid.
+inline unsigned int CheckedMipmapLevels(unsigned int num_levels, size_t width,
+                                        size_t height, size_t depth = 1) {
+  const unsigned int max_levels = MaxMipmapLevels(width, height, depth);
+  if (num_levels == 0) {
+    return max_levels;
+  }
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (num_levels > max_levels) {
+    throw std::runtime_error("Too many mipmap levels (" +
+                             std::to_string(num_levels) + " > " +
+                             std::to_string(max_levels) + ").");
+  }
+#endif
+  return num_levels;
+}
+
+// Size of a dimension at the given mipmap level.
+__host__ __device__ inline size_t MipmapLevelSize(size_t size,
+                                                  unsigned int level) {
+  return (size >> level > 0) ? size >> level : 1;
+}
+
+//------------------------------------------------------------------------------
+
+// Taps of the one-dimensional downsampling filter: element x of the coarser
+// level reads elements 2x + MipmapTapOffset() + i, i = 0, ..., num_taps - 1,
+// of the finer one. All weights are multiples of 1/8, so that the products of
+// the weights along each axis are exact in float arithmetic.
+__host__ __device__ inline int MipmapNumTaps(const MipmapFilter filter) {
+  return (filter == MipmapFilter::kBox) ? 2 : 4;
+}
+
+__host__ __device__ inline int MipmapTapOffset(const MipmapFilter filter) {
+  return (filter == MipmapFilter::kBox) ? 0 : -1;
+}
+
+__host__ __device__ inline float MipmapTapWeight(const MipmapFilter filter,
+                                                 const int i) {
+  if (filter == MipmapFilter::kBox) {
+    return 0.5f;
+  }
+  return (i == 0 || i == 3) ? 0.125f : 0.375f;
+}
+
+// Index of a tap in a dimension of the given size, clamped to the edge.
+__host__ __device__ inline int MipmapTapIndex(const int x, const int offset,
+                                              const int size) {
+  const int i = 2 * x + offset;
+  return (i < 0) ? 0 : ((i >= size) ? size - 1 : i);
+}
+
+//------------------------------------------------------------------------------
+
+// Accumulates weighted elements channel by channel (see channels.h).
+template <typename T>
+class MipmapAccumulator {
+ public:
+  typedef typename ChannelTraits<T>::Component Component;
+  static const int kNumChannels = ChannelTraits<T>::kNumChannels;
+
+  __host__ __device__ MipmapAccumulator() {
+    for (int c = 0; c < kNumChannels; ++c) {
+      sum_[c] = 0.f;
+    }
+  }
+
+  __host__ __device__ inline void Add(const float weight, const T &value) {
+    const Component *components = reinterpret_cast<const Component *>(&value);
+    for (int c = 0; c < kNumChannels; ++c) {
+      sum_[c] += weight * static_cast<float>(components[c]);
+    }
+  }
+
+  __host__ __device__ inline T Result() const {
+    T result;
+    Component *components = reinterpret_cast<Component *>(&result);
+    for (int c = 0; c < kNumChannels; ++c) {
+      components[c] = RoundToComponent<Component>(sum_[c]);
+    }
+    return result;
+  }
+
+ private:
+  float sum_[kNumChannels];
+};
+
+//------------------------------------------------------------------------------
+
+//
+// element (x, y) of the next-coarser level of src; this is shared by the
+// kernels and by the host reference, so both produce the same values
+//
+LIBCUA_EXEC_CHECK_DISABLE
+template <typename SrcCls>
+__host__ __device__ inline typename SrcCls::Scalar MipmapDownsample2D(
+    const SrcCls &src, const int x, const int y, const MipmapFilter filter) {
+  const int w = src.Width(), h = src.Height();
+  const int num_taps = MipmapNumTaps(filter);
+  const int offset = MipmapTapOffset(filter);
+
+  MipmapAccumulator<typename SrcCls::Scalar> sum;
+  for (int j = 0; j < num_taps; ++j) {
+    const int src_y = MipmapTapIndex(y, offset + j, h);
+    const float weight_y = MipmapTapWeight(filter, j);
+    for (int i = 0; i < num_taps; ++i) {
+      const int src_x = MipmapTapIndex(x, offset + i, w);
+      sum.Add(weight_y * MipmapTapWeight(filter, i), src.get(src_x, src_y));
+    }
+  }
+
+  return sum.Result();
+}
+
+//
+// element (x, y, z) of the next-coarser level of src
+//
+LIBCUA_EXEC_CHECK_DISABLE
+template <typename SrcCls>
+__host__ __device__ inline typename SrcCls::Scalar MipmapDownsample3D(
+    const SrcCls &src, const int x, const int y, const int z,
+    const MipmapFilter filter) {
+  const int w = src.Width(), h = src.Height(), d = src.Depth();
+  const int num_taps = MipmapNumTaps(filter);
+  const int offset = MipmapTapOffset(filter);
+
+  MipmapAccumulator<typename SrcCls::Scalar> sum;
+  for (int k = 0; k < num_taps; ++k) {
+    const int src_z = MipmapTapIndex(z, offset + k, d);
+    const float weight_z = MipmapTapWeight(filter, k);
+    for (int j = 0; j < num_taps; ++j) {
+      const int src_y = MipmapTapIndex(y, offset + j, h);
+      const float weight_yz = weight_z * MipmapTapWeight(filter, j);
+      for (int i = 0; i < num_taps; ++i) {
+        const int src_x = MipmapTapIndex(x, offset + i, w);
+        sum.Add(weight_yz * MipmapTapWeight(filter, i),
+                src.get(src_x, src_y, src_z));
+      }
+    }
+  }
+
+  return sum.Result();
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T1, typename T2>
+inline void CheckMipmapLevelSize2D(const T1 &src, const T2 &dst) {
+  CheckCompatibleTypes(src, dst);
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (dst.Width() != MipmapLevelSize(src.Width(), 1) ||
+      dst.Height() != MipmapLevelSize(src.Height(), 1)) {
+    throw std::runtime_error("Array " + ArraySizeToString2D(dst) +
+                             " is not the next mipmap level of " +
+                             ArraySizeToString2D(src) + ".");
+  }
+#endif
+}
+
+template <typename T1, typename T2>
+inline void CheckMipmapLevelSize3D(const T1 &src, const T2 &dst) {
+  CheckCompatibleTypes(src, dst);
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (dst.Width() != MipmapLevelSize(src.Width(), 1) ||
+      dst.Height() != MipmapLevelSize(src.Height(), 1) ||
+      dst.Depth() != MipmapLevelSize(src.Depth(), 1)) {
+    throw std::runtime_error("Array " + ArraySizeToString3D(dst) +
+                             " is not the next mipmap level of " +
+                             ArraySizeToString3D(src) + ".");
+  }
+#endif
+}
+
+}  // namespace internal
+
+//------------------------------------------------------------------------------
+//
+// kernel definitions
+//
+//------------------------------------------------------------------------------
+
+namespace kernel {
+
+//
+// dst = next-coarser mipmap level of src
+//
+template <typename SrcCls, typename DstCls>
+__global__ void MipmapDownsample2D(const SrcCls src, DstCls dst,
+                                   const MipmapFilter filter) {
+  const typename DstCls::IndexType x = blockIdx.x * blockDim.x + threadIdx.x;
+  const typename DstCls::IndexType y = blockIdx.y * blockDim.y + threadIdx.y;
+
+  if (x < dst.Width() && y < dst.Height()) {
+    dst.set(x, y, internal::MipmapDownsample2D(src, x, y, filter));
+  }
+}
+
+template <typename SrcCls, typename DstCls>
+__global__ void MipmapDownsample3D(const SrcCls src, DstCls dst,
+                                   const MipmapFilter filter) {
+  const typename DstCls::IndexType x = blockIdx.x * blockDim.x + threadIdx.x;
+  const typename DstCls::IndexType y = blockIdx.y * blockDim.y + threadIdx.y;
+  const typename DstCls::IndexType z = blockIdx.z * blockDim.z + threadIdx.z;
+
+  if (x < dst.Width() && y < dst.Height() && z < dst.Depth()) {
+    dst.set(x, y, z, internal::MipmapDownsample3D(src, x, y, z, filter));
+  }
+}
+
+}  // namespace kernel
+
+//------------------------------------------------------------------------------
+//
+// host implementations
+//
+//------------------------------------------------------------------------------
+
+namespace host {
+
+/**
+ * Host reference for one level of mipmap generation, e.g., over
+ * CudaHostArray2D objects. This computes the same values as
+ * CudaMipmappedTexture2D::GenerateMipmaps() does on the device.
+ * @param src level l of the pyramid
+ * @param dst level l + 1 of the pyramid; its size must be half that of src,
+ *   rounded down (and at least one)
+ * @param filter downsampling filter
+ */
+template <typename SrcCls, typename DstCls>
+inline void MipmapDownsample2D(const SrcCls &src, DstCls &dst,
+                               const MipmapFilter filter) {
+  internal::CheckMipmapLevelSize2D(src, dst);
+  const size_t w = dst.Width();
+  internal::ParallelForRows(dst.Height(), w, [&](size_t y0, size_t y1) {
+    for (size_t y = y0; y < y1; ++y) {
+      for (size_t x = 0; x < w; ++x) {
+        dst.set(x, y, internal::MipmapDownsample2D(src, x, y, filter));
+      }
+    }
+  });
+}
+
+/**
+ * Host reference for one level of mipmap generation in 3D; see
+ * MipmapDownsample2D().
+ * @param src level l of the pyramid
+ * @param dst level l + 1 of the pyramid
+ * @param filter downsampling filter
+ */
+template <typename SrcCls, typename DstCls>
+inline void MipmapDownsample3D(const SrcCls &src, DstCls &dst,
+                               const MipmapFilter filter) {
+  internal::CheckMipmapLevelSize3D(src, dst);
+  const size_t w = dst.Width();
+  const size_t h = dst.Height();
+  internal::ParallelForRows(h * dst.Depth(), w, [&](size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; ++i) {
+      const size_t y = i % h, z = i / h;
+      for (size_t x = 0; x < w; ++x) {
+        dst.set(x, y, z, internal::MipmapDownsample3D(src, x, y, z, filter));
+      }
+    }
+  });
+}
+
+}  // namespace host
+
+}  // namespace cua
+
+#endif  // LIBCUA_MIPMAP_H_
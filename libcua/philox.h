@@ -0,0 +1,183 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_PHILOX_H_
+#define LIBCUA_PHILOX_H_
+
+namespace cua {
+
+//------------------------------------------------------------------------------
+//
+// Counter-based random number generation with Philox4x32-10 (Salmon et al.,
+// "Parallel Random Numbers: As Easy as 1, 2, 3", SC 2011). The generator is a
+// pure function of a 128-bit counter and a 64-bit key, so no per-thread state
+// has to be stored, initialized, or written back, and any element of the
+// random stream can be computed independently of all others.
+//
+// FillRandom(seed, counter, func) on the array classes assigns element (x, y)
+// (or (x, y, z), with row index z * height + y) the word (x % 4) of
+//
+//   Philox4x32_10({x / 4, row, lo(counter), hi(counter)}, {lo(seed), hi(seed)})
+//
+// so each GPU thread produces four values from one call. The result depends
+// only on (seed, counter) and the element position, never on the launch
+// configuration, and the host arrays produce bit-identical output whenever
+// func itself is exact (as are the functors below).
+//
+//------------------------------------------------------------------------------
+
+/**
+ * @struct PhiloxCounter
+ * @brief 128-bit counter, and output block, of the Philox4x32 generator.
+ */
+struct PhiloxCounter {
+  unsigned int x, y, z, w;
+};
+
+/**
+ * @struct PhiloxKey
+ * @brief 64-bit key of the Philox4x32 generator.
+ */
+struct PhiloxKey {
+  unsigned int x, y;
+};
+
+namespace internal {
+
+// multipliers and Weyl-sequence key increments of Philox4x32
+static const unsigned int kPhiloxM0 = 0xD2511F53u;
+static const unsigned int kPhiloxM1 = 0xCD9E8D57u;
+static const unsigned int kPhiloxW0 = 0x9E3779B9u;
+static const unsigned int kPhiloxW1 = 0xBB67AE85u;
+
+__host__ __device__ inline unsigned int MulHiLo(unsigned int a, unsigned int b,
+                                                unsigned int *hi) {
+#ifdef __CUDA_ARCH__
+  *hi = __umulhi(a, b);
+  return a * b;
+#else
+  const unsigned long long product = static_cast<unsigned long long>(a) * b;
+  *hi = static_cast<unsigned int>(product >> 32);
+  return static_cast<unsigned int>(product);
+#endif
+}
+
+__host__ __device__ inline PhiloxCounter PhiloxRound(const PhiloxCounter &ctr,
+                                                     const PhiloxKey &key) {
+  unsigned int hi0, hi1;
+  const unsigned int lo0 = MulHiLo(kPhiloxM0, ctr.x, &hi0);
+  const unsigned int lo1 = MulHiLo(kPhiloxM1, ctr.z, &hi1);
+  const PhiloxCounter result = {hi1 ^ ctr.y ^ key.x, lo1, hi0 ^ ctr.w ^ key.y,
+                                lo0};
+  return result;
+}
+
+__host__ __device__ inline PhiloxKey MakePhiloxKey(unsigned long long seed) {
+  const PhiloxKey key = {static_cast<unsigned int>(seed),
+                         static_cast<unsigned int>(seed >> 32)};
+  return key;
+}
+
+__host__ __device__ inline PhiloxCounter MakePhiloxCounter(
+    unsigned int x4, unsigned int row, unsigned long long counter) {
+  const PhiloxCounter ctr = {x4, row, static_cast<unsigned int>(counter),
+                             static_cast<unsigned int>(counter >> 32)};
+  return ctr;
+}
+
+__host__ __device__ inline unsigned int PhiloxWord(const PhiloxCounter &bits,
+                                                   unsigned int i) {
+  return (i == 0) ? bits.x : (i == 1) ? bits.y : (i == 2) ? bits.z : bits.w;
+}
+
+}  // namespace internal
+
+/**
+ * Philox4x32 with ten rounds, as in Random123 and cuRAND.
+ * @param counter 128-bit input block
+ * @param key 64-bit key
+ * @return 128 random bits
+ */
+__host__ __device__ inline PhiloxCounter Philox4x32_10(PhiloxCounter counter,
+                                                       PhiloxKey key) {
+  for (int i = 0; i < 9; ++i) {
+    counter = internal::PhiloxRound(counter, key);
+    key.x += internal::kPhiloxW0;
+    key.y += internal::kPhiloxW1;
+  }
+  return internal::PhiloxRound(counter, key);
+}
+
+//------------------------------------------------------------------------------
+//
+// functors mapping 32 random bits to a value, for FillRandom(seed, counter)
+//
+//------------------------------------------------------------------------------
+
+/**
+ * @struct RandomBits
+ * @brief The raw 32-bit random word.
+ */
+struct RandomBits {
+  __host__ __device__ inline unsigned int operator()(unsigned int bits) const {
+    return bits;
+  }
+};
+
+/**
+ * @struct UniformRandom
+ * @brief Uniform float in (0, 1], using the top 24 bits. The conversion is
+ * exact, so host and device results are identical.
+ */
+struct UniformRandom {
+  __host__ __device__ inline float operator()(unsigned int bits) const {
+    return static_cast<float>((bits >> 8) + 1) * (1.f / 16777216.f);
+  }
+};
+
+/**
+ * @struct UniformRandomDouble
+ * @brief Uniform double in (0, 1], using all 32 bits. The conversion is exact,
+ * so host and device results are identical.
+ */
+struct UniformRandomDouble {
+  __host__ __device__ inline double operator()(unsigned int bits) const {
+    return (static_cast<double>(bits) + 1.) * (1. / 4294967296.);
+  }
+};
+
+}  // namespace cua
+
+#endif  // LIBCUA_PHILOX_H_
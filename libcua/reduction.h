@@ -0,0 +1,528 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_REDUCTION_H_
+#define LIBCUA_REDUCTION_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>  // for shared_ptr
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "cachingAllocator.h"
+#include "cudaAsyncValue.h"
+#include "cudaEvent.h"
+#include "functional.h"
+#include "hostThreadPool.h"
+#include "stagingBufferPool.h"
+#include "util.h"
+
+namespace cua {
+
+/**
+ * @struct MinMaxValue
+ * @brief Minimum and maximum element of an array, as returned by MinMax().
+ */
+template <typename T>
+struct MinMaxValue {
+  T min;
+  T max;
+};
+
+namespace internal {
+
+//------------------------------------------------------------------------------
+//
+// reduction helpers
+//
+//------------------------------------------------------------------------------
+
+// Type in which sums are accumulated: 64-bit integers for integral types, so
+// that, e.g., the sum of an unsigned char array does not overflow, and the
+// scalar type itself otherwise.
+template <typename T, typename Enable = void>
+struct SumTraits {
+  typedef T type;
+};
+
+template <typename T>
+struct SumTraits<T, typename std::enable_if<std::is_integral<T>::value &&
+                                            std::is_signed<T>::value>::type> {
+  typedef long long type;
+};
+
+template <typename T>
+struct SumTraits<T, typename std::enable_if<std::is_integral<T>::value &&
+                                            !std::is_signed<T>::value>::type> {
+  typedef unsigned long long type;
+};
+
+// Identity elements for Minimum and Maximum.
+template <typename T>
+inline T HighestValue() {
+  return std::numeric_limits<T>::has_infinity
+             ? std::numeric_limits<T>::infinity()
+             : std::numeric_limits<T>::max();
+}
+
+template <typename T>
+inline T LowestValue() {
+  return std::numeric_limits<T>::has_infinity
+             ? -std::numeric_limits<T>::infinity()
+             : std::numeric_limits<T>::lowest();
+}
+
+//
+// per-element transforms, applied before reducing
+//
+
+struct Identity {
+  template <typename T>
+  __host__ __device__ inline T operator()(const T &value) const {
+    return value;
+  }
+};
+
+template <typename T>
+struct ConvertTo {
+  template <typename U>
+  __host__ __device__ inline T operator()(const U &value) const {
+    return static_cast<T>(value);
+  }
+};
+
+template <typename T>
+struct SquareAs {
+  template <typename U>
+  __host__ __device__ inline T operator()(const U &value) const {
+    const T converted = static_cast<T>(value);
+    return converted * converted;
+  }
+};
+
+struct MakeMinMax {
+  template <typename T>
+  __host__ __device__ inline MinMaxValue<T> operator()(const T &value) const {
+    MinMaxValue<T> result = {value, value};
+    return result;
+  }
+};
+
+//
+// binary operator for MinMax()
+//
+
+struct CombineMinMax {
+  template <typename T>
+  __host__ __device__ inline MinMaxValue<T> operator()(
+      const MinMaxValue<T> &a, const MinMaxValue<T> &b) const {
+    MinMaxValue<T> result = {Minimum()(a.min, b.min), Maximum()(a.max, b.max)};
+    return result;
+  }
+};
+
+//
+// finalizers, applied once to the fully reduced value
+//
+
+struct DivideBy {
+  double divisor;
+
+  template <typename T>
+  __host__ __device__ inline double operator()(const T &value) const {
+    return static_cast<double>(value) / divisor;
+  }
+};
+
+struct SquareRoot {
+  template <typename T>
+  __host__ __device__ inline double operator()(const T &value) const {
+    return sqrt(static_cast<double>(value));
+  }
+};
+
+//
+// readers that map a linear (row-major) index to an array element; the index
+// type may be wider than the array's own, e.g., for arrays with more than 2^32
+// elements
+//
+
+template <typename ArrayType,
+          typename IndexT = typename ArrayType::IndexType>
+class LinearReader2D {
+ public:
+  typedef IndexT IndexType;
+  typedef typename ArrayType::Scalar Scalar;
+
+  explicit LinearReader2D(const ArrayType &array) : array_(array) {}
+
+  LIBCUA_EXEC_CHECK_DISABLE
+  __host__ __device__ inline Scalar operator()(IndexType i) const {
+    return array_.get(i % array_.Width(), i / array_.Width());
+  }
+
+ private:
+  ArrayType array_;  // device view or shallow copy
+};
+
+template <typename ArrayType,
+          typename IndexT = typename ArrayType::IndexType>
+class LinearReader3D {
+ public:
+  typedef IndexT IndexType;
+  typedef typename ArrayType::Scalar Scalar;
+
+  explicit LinearReader3D(const ArrayType &array) : array_(array) {}
+
+  LIBCUA_EXEC_CHECK_DISABLE
+  __host__ __device__ inline Scalar operator()(IndexType i) const {
+    const IndexType yz = i / array_.Width();
+    return array_.get(i % array_.Width(), yz % array_.Height(),
+                      yz / array_.Height());
+  }
+
+ private:
+  ArrayType array_;  // device view or shallow copy
+};
+
+}  // namespace internal
+
+//------------------------------------------------------------------------------
+//
+// kernel definitions
+//
+//------------------------------------------------------------------------------
+
+namespace kernel {
+
+//
+// __shfl_down_sync for values of any (trivially copyable) type
+//
+template <typename T>
+__device__ inline T ShuffleDown(const T &value, unsigned int delta) {
+  const int kNumWords = (sizeof(T) + sizeof(int) - 1) / sizeof(int);
+  int words[kNumWords];
+  memcpy(words, &value, sizeof(T));
+  for (int i = 0; i < kNumWords; ++i) {
+    words[i] = __shfl_down_sync(0xffffffff, words[i], delta);
+  }
+  T result;
+  memcpy(&result, words, sizeof(T));
+  return result;
+}
+
+//
+// reduce across a warp; the result is valid in lane 0
+//
+template <typename T, class BinaryFunction>
+__device__ inline T WarpReduce(T value, BinaryFunction op) {
+  for (unsigned int delta = warpSize / 2; delta > 0; delta /= 2) {
+    value = op(value, ShuffleDown(value, delta));
+  }
+  return value;
+}
+
+//
+// reduce across a block whose size is a multiple of the warp size; the result
+// is valid in thread 0
+//
+template <typename T, class BinaryFunction>
+__device__ inline T BlockReduce(T value, BinaryFunction op, const T identity) {
+  __shared__ T warp_values[32];
+
+  const unsigned int lane = threadIdx.x % warpSize;
+  const unsigned int warp = threadIdx.x / warpSize;
+
+  value = WarpReduce(value, op);
+  if (lane == 0) {
+    warp_values[warp] = value;
+  }
+  __syncthreads();
+
+  if (warp == 0) {
+    value = (lane < blockDim.x / warpSize) ? warp_values[lane] : identity;
+    value = WarpReduce(value, op);
+  }
+
+  return value;
+}
+
+//
+// first pass: each block reduces a grid-strided subset of the elements and
+// writes one partial value
+//
+template <typename Reader, typename AccumulatorType, class Transform,
+          class BinaryFunction>
+__global__ void ReduceBlocks(const Reader reader,
+                             const typename Reader::IndexType size,
+                             Transform transform, BinaryFunction op,
+                             const AccumulatorType identity,
+                             AccumulatorType *block_values) {
+  typedef typename Reader::IndexType IndexType;
+
+  const IndexType stride = blockDim.x * gridDim.x;
+  AccumulatorType value = identity;
+  for (IndexType i = blockIdx.x * blockDim.x + threadIdx.x; i < size;
+       i += stride) {
+    value = op(value, transform(reader(i)));
+    // stop before i + stride can wrap around near the top of IndexType
+    if (size - i <= stride) {
+      break;
+    }
+  }
+
+  value = BlockReduce(value, op, identity);
+
+  if (threadIdx.x == 0) {
+    block_values[blockIdx.x] = value;
+  }
+}
+
+//
+// second pass: a single block reduces the partial values
+//
+template <typename AccumulatorType, typename ResultType, class BinaryFunction,
+          class Finalize>
+__global__ void ReduceFinal(const AccumulatorType *block_values,
+                            const unsigned int num_blocks, BinaryFunction op,
+                            Finalize finalize, const AccumulatorType identity,
+                            ResultType *result) {
+  AccumulatorType value = identity;
+  for (unsigned int i = threadIdx.x; i < num_blocks; i += blockDim.x) {
+    value = op(value, block_values[i]);
+  }
+
+  value = BlockReduce(value, op, identity);
+
+  if (threadIdx.x == 0) {
+    *result = finalize(value);
+  }
+}
+
+}  // namespace kernel
+
+//------------------------------------------------------------------------------
+//
+// host reference implementation
+//
+//------------------------------------------------------------------------------
+
+namespace host {
+
+//
+// Reduce elements [0, size) of the reader on the CPU thread pool. Partial
+// values are combined in a fixed order, so the result does not depend on the
+// number of threads.
+//
+template <typename Reader, typename AccumulatorType, class Transform,
+          class BinaryFunction>
+inline AccumulatorType Reduce(const Reader &reader, size_t size,
+                              Transform transform, BinaryFunction op,
+                              const AccumulatorType &identity) {
+  const size_t chunk_size = internal::kMinElementsPerTask;
+  const size_t num_chunks = (size + chunk_size - 1) / chunk_size;
+  std::vector<AccumulatorType> chunk_values(num_chunks, identity);
+
+  internal::HostThreadPool::Instance().ParallelFor(
+      num_chunks, [&](size_t chunk) {
+        const size_t begin = chunk * chunk_size;
+        const size_t end = std::min(begin + chunk_size, size);
+        AccumulatorType value = identity;
+        for (size_t i = begin; i < end; ++i) {
+          value = op(value, transform(reader(i)));
+        }
+        chunk_values[chunk] = value;
+      });
+
+  AccumulatorType value = identity;
+  for (const AccumulatorType &chunk_value : chunk_values) {
+    value = op(value, chunk_value);
+  }
+  return value;
+}
+
+}  // namespace host
+
+//------------------------------------------------------------------------------
+//
+// device reduction
+//
+//------------------------------------------------------------------------------
+
+namespace internal {
+
+// number of threads per block for reductions; a multiple of the warp size
+static const unsigned int kReductionBlockSize = 256;
+
+// maximum number of blocks (and partial values) of the first pass
+static const unsigned int kMaxReductionBlocks = 1024;
+
+//
+// Page-locked host slots that receive the results of ReduceAsync(). Calling
+// cudaHostAlloc() and cudaFreeHost() per reduction would be slow, and
+// cudaFreeHost() synchronizes the whole device, so slots are carved out of
+// larger page-locked chunks and never freed. A slot released by the last copy
+// of its CudaAsyncValue is kept with the value's event and handed out again
+// only once that event has completed, because the copy into the slot may still
+// be in flight.
+//
+class PinnedResultPool {
+ public:
+  // size (and alignment) of each slot
+  static const size_t kSlotBytes = 128;
+
+  // number of slots allocated together
+  static const size_t kSlotsPerChunk = 64;
+
+  // like the other pools, this object is never destroyed
+  static PinnedResultPool &Instance() {
+    static PinnedResultPool *pool = new PinnedResultPool();
+    return *pool;
+  }
+
+  // returns a slot whose previous result has been copied in, or nullptr if a
+  // new chunk could not be allocated
+  void *Acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < free_slots_.size(); ++i) {
+      if (free_slots_[i].event.Query()) {
+        void *ptr = free_slots_[i].ptr;
+        free_slots_[i] = free_slots_.back();
+        free_slots_.pop_back();
+        return ptr;
+      }
+    }
+
+    char *chunk = static_cast<char *>(
+        CudaPinnedMemoryBackend().AllocatePinned(kSlotBytes * kSlotsPerChunk));
+    if (chunk == nullptr) {
+      return nullptr;
+    }
+    for (size_t i = 1; i < kSlotsPerChunk; ++i) {
+      free_slots_.push_back({chunk + i * kSlotBytes, CudaEvent()});
+    }
+    return chunk;
+  }
+
+  // returns a slot to the pool; it is reused once the event has completed
+  void Release(void *ptr, const CudaEvent &event) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_slots_.push_back({ptr, event});
+  }
+
+ private:
+  struct Slot {
+    void *ptr;
+    CudaEvent event;  // last copy into the slot
+  };
+
+  PinnedResultPool() {}
+
+  std::mutex mutex_;
+  std::vector<Slot> free_slots_;
+};
+
+//
+// Queue a two-pass reduction of elements [0, size) of the reader on the given
+// stream. Each element is mapped through transform() and combined with op(),
+// which must be associative and commutative and have the given identity; the
+// final value is passed through finalize(). The result is copied back into
+// pinned host memory, so this call does not block.
+//
+template <typename ResultType, typename Reader, typename AccumulatorType,
+          class Transform, class BinaryFunction, class Finalize>
+inline CudaAsyncValue<ResultType> ReduceAsync(
+    const Reader &reader, typename Reader::IndexType size, Transform transform,
+    BinaryFunction op, Finalize finalize, const AccumulatorType &identity,
+    int device, cudaStream_t stream) {
+  const unsigned int num_blocks =
+      static_cast<unsigned int>(std::min<size_t>(
+          kMaxReductionBlocks,
+          std::max<size_t>(1, (size + kReductionBlockSize - 1) /
+                                  kReductionBlockSize)));
+
+  // scratch space: one partial value per block, followed by the result
+  const size_t kAlignment = 256;
+  const size_t result_offset =
+      (num_blocks * sizeof(AccumulatorType) + kAlignment - 1) / kAlignment *
+      kAlignment;
+  CachingAllocator<> &allocator = CachingAllocator<>::Instance();
+  char *scratch = static_cast<char *>(allocator.Allocate(
+      result_offset + sizeof(ResultType), device, stream));
+  AccumulatorType *block_values = reinterpret_cast<AccumulatorType *>(scratch);
+  ResultType *device_result =
+      reinterpret_cast<ResultType *>(scratch + result_offset);
+
+  static_assert(sizeof(ResultType) <= PinnedResultPool::kSlotBytes,
+                "reduction result type is too large");
+  ResultType *host_result =
+      static_cast<ResultType *>(PinnedResultPool::Instance().Acquire());
+  if (host_result == nullptr) {
+    allocator.Free(scratch);
+    throw std::runtime_error(
+        "Failed to allocate pinned memory for a reduction result.");
+  }
+
+  SetDevice(device);
+  kernel::ReduceBlocks<<<num_blocks, kReductionBlockSize, 0, stream>>>(
+      reader, size, transform, op, identity, block_values);
+  kernel::ReduceFinal<<<1, kReductionBlockSize, 0, stream>>>(
+      block_values, num_blocks, op, finalize, identity, device_result);
+  cudaMemcpyAsync(host_result, device_result, sizeof(ResultType),
+                  cudaMemcpyDeviceToHost, stream);
+  const CudaEvent event = CudaEvent::Record(stream);
+
+  // the scratch block is only reused by later work on the same stream
+  allocator.Free(scratch);
+
+  // the slot goes back to the pool with the last copy of the value, but is
+  // not reused before the event has completed
+  std::shared_ptr<ResultType> result(host_result, [event](ResultType *ptr) {
+    PinnedResultPool::Instance().Release(ptr, event);
+  });
+
+  return CudaAsyncValue<ResultType>(result, event);
+}
+
+}  // namespace internal
+
+}  // namespace cua
+
+#endif  // LIBCUA_REDUCTION_H_
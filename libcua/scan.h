@@ -0,0 +1,771 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_SCAN_H_
+#define LIBCUA_SCAN_H_
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "cachingAllocator.h"
+#include "convolution.h"
+#include "hostThreadPool.h"
+#include "launchConfig.h"
+#include "util.h"
+
+namespace cua {
+
+/**
+ * @enum ScanMode
+ * @brief Whether element i of a prefix sum includes input element i.
+ */
+enum class ScanMode {
+  kInclusive,  ///< out[i] = in[0] + ... + in[i]
+  kExclusive   ///< out[i] = in[0] + ... + in[i - 1], with out[0] = 0
+};
+
+/**
+ * Sum of the elements of an array over the box [x0, x1] x [y0, y1], with
+ * inclusive bounds, in constant time, given the inclusive summed-area table of
+ * the array; see CudaArray2DBase::SummedAreaTable(). Differences are taken in
+ * the scalar type of the table, so unsigned tables give exact results, as
+ * well.
+ * @param table summed-area table, e.g., a device view in a kernel
+ */
+LIBCUA_EXEC_CHECK_DISABLE
+template <typename TableType>
+__host__ __device__ inline typename TableType::Scalar SummedAreaBoxSum(
+    const TableType &table, const int x0, const int y0, const int x1,
+    const int y1) {
+  typename TableType::Scalar sum = table.get(x1, y1);
+  if (x0 > 0) {
+    sum -= table.get(x0 - 1, y1);
+  }
+  if (y0 > 0) {
+    sum -= table.get(x1, y0 - 1);
+    if (x0 > 0) {
+      sum += table.get(x0 - 1, y0 - 1);
+    }
+  }
+  return sum;
+}
+
+/**
+ * Sum of the elements of a volume over the box [x0, x1] x [y0, y1] x [z0, z1],
+ * with inclusive bounds, given the inclusive summed-volume table of the
+ * volume; see CudaArray3DBase::SummedAreaTable().
+ * @param table summed-volume table, e.g., a device view in a kernel
+ */
+LIBCUA_EXEC_CHECK_DISABLE
+template <typename TableType>
+__host__ __device__ inline typename TableType::Scalar SummedAreaBoxSum(
+    const TableType &table, const int x0, const int y0, const int z0,
+    const int x1, const int y1, const int z1) {
+  typename TableType::Scalar sum = table.get(x1, y1, z1);
+  if (x0 > 0) {
+    sum -= table.get(x0 - 1, y1, z1);
+  }
+  if (y0 > 0) {
+    sum -= table.get(x1, y0 - 1, z1);
+    if (x0 > 0) {
+      sum += table.get(x0 - 1, y0 - 1, z1);
+    }
+  }
+  if (z0 > 0) {
+    sum -= table.get(x1, y1, z0 - 1);
+    if (x0 > 0) {
+      sum += table.get(x0 - 1, y1, z0 - 1);
+    }
+    if (y0 > 0) {
+      sum += table.get(x1, y0 - 1, z0 - 1);
+      if (x0 > 0) {
+        sum -= table.get(x0 - 1, y0 - 1, z0 - 1);
+      }
+    }
+  }
+  return sum;
+}
+
+namespace internal {
+
+//------------------------------------------------------------------------------
+
+// axes of a scan, which are combined with |
+static const unsigned int kScanX = 1;
+static const unsigned int kScanY = 2;
+static const unsigned int kScanZ = 4;
+
+//
+// Tile shape of the scan kernels. Warps always span x. Along x and y, each
+// thread first scans kItems consecutive elements of a shared-memory tile on
+// its own, and the block then scans the per-thread totals, so that a tile of
+// kBlockX * kItems elements per line needs only a few barriers. The running
+// total of each line is carried from one tile to the next, so that every
+// element is read and written once. Lines that are too few to fill the device
+// are split into chunks of whole tiles; see ScanAxis().
+//
+struct ScanTile {
+  static const int kBlockX = 32;
+  static const int kBlockY = 8;
+  static const int kItems = 4;
+
+  // tile length along x of the x scan, and along y of the y scan
+  static const int kSizeX = kBlockX * kItems;
+  static const int kSizeY = kBlockY * kItems;
+
+  // one padding element per 32, against shared-memory bank conflicts
+  static const int kPaddedSizeX = kSizeX + kSizeX / 32;
+
+  __host__ __device__ static inline int Pad(int i) { return i + i / 32; }
+};
+
+// the lines of a scan along x or y are split into chunks if they alone give
+// fewer than this many blocks per multiprocessor
+static const unsigned int kScanBlocksPerMultiprocessor = 4;
+
+// minimum number of tiles in a chunk, so that the extra pass over the source
+// pays off
+static const int kMinScanChunkTiles = 4;
+
+// number of threads per block for scanning the chunk totals
+static const unsigned int kScanCarryBlockSize = 256;
+
+//
+// Number of chunks into which to split lines of the given length, given the
+// number of blocks that the lines alone occupy; 1 if these blocks already fill
+// the device or the lines are too short to split.
+//
+inline int NumScanChunks(const size_t num_line_blocks, const int length,
+                         const int tile_size, const int device) {
+  const size_t target_blocks =
+      kScanBlocksPerMultiprocessor * NumMultiprocessors(device);
+  const int max_chunks = length / (kMinScanChunkTiles * tile_size);
+  if (num_line_blocks >= target_blocks || max_chunks < 2) {
+    return 1;
+  }
+  return static_cast<int>(std::min<size_t>(
+      max_chunks, (target_blocks + num_line_blocks - 1) / num_line_blocks));
+}
+
+// Memory traffic of a scan per element: the first pass reads the source, and
+// any further passes update the output in place.
+inline size_t ScanBytesPerElement(const unsigned int axes,
+                                  const size_t src_scalar_size,
+                                  const size_t dst_scalar_size) {
+  const size_t num_passes = ((axes & kScanX) ? 1 : 0) +
+                            ((axes & kScanY) ? 1 : 0) +
+                            ((axes & kScanZ) ? 1 : 0);
+  return src_scalar_size + (2 * num_passes - 1) * dst_scalar_size;
+}
+
+template <typename SrcCls, typename DstCls>
+inline void CheckScanArrays(const SrcCls &src, const DstCls &dst,
+                            std::false_type) {
+  static_assert(std::is_arithmetic<typename DstCls::Scalar>::value,
+                "The output of a scan must have an arithmetic scalar type.");
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (src.Width() != dst.Width() || src.Height() != dst.Height()) {
+    throw std::runtime_error("Arrays have different sizes (" +
+                             ArraySizeToString2D(src) + " vs " +
+                             ArraySizeToString2D(dst) + ").");
+  }
+#endif
+}
+
+template <typename SrcCls, typename DstCls>
+inline void CheckScanArrays(const SrcCls &src, const DstCls &dst,
+                            std::true_type) {
+  static_assert(std::is_arithmetic<typename DstCls::Scalar>::value,
+                "The output of a scan must have an arithmetic scalar type.");
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (src.Width() != dst.Width() || src.Height() != dst.Height() ||
+      src.Depth() != dst.Depth()) {
+    throw std::runtime_error("Arrays have different sizes (" +
+                             ArraySizeToString3D(src) + " vs " +
+                             ArraySizeToString3D(dst) + ").");
+  }
+#endif
+}
+
+}  // namespace internal
+
+//------------------------------------------------------------------------------
+//
+// kernel definitions
+//
+//------------------------------------------------------------------------------
+
+namespace kernel {
+
+//
+// dst = prefix sums of src along x, one warp per line; src and dst present a
+// 3D interface (see internal::ConvolutionSlice) and may be the same array.
+// Block i along x scans elements [i * chunk_size, (i + 1) * chunk_size) of its
+// lines, starting from carries[line * gridDim.x + i] unless carries is null.
+//
+template <typename SrcCls, typename DstCls>
+__global__ void ScanX(const SrcCls src, DstCls dst, const bool exclusive,
+                      const int chunk_size,
+                      const typename DstCls::Scalar *carries) {
+  typedef internal::ScanTile Tile;
+  typedef typename DstCls::Scalar T;
+
+  __shared__ T tile[Tile::kBlockY][Tile::kPaddedSizeX];
+  __shared__ T totals[Tile::kBlockY][Tile::kBlockX];
+
+  const int w = src.Width(), h = src.Height();
+  const int tx = threadIdx.x;
+  const int y = blockIdx.y * Tile::kBlockY + threadIdx.y, z = blockIdx.z;
+  const bool active = (y < h);
+  const int x_begin = blockIdx.x * chunk_size;
+  const int x_end = min(w, x_begin + chunk_size);
+  T *line = tile[threadIdx.y];
+  T *line_totals = totals[threadIdx.y];
+
+  T carry = T();
+  if (active && carries != nullptr) {
+    carry = carries[(static_cast<size_t>(z) * h + y) * gridDim.x + blockIdx.x];
+  }
+
+  for (int x0 = x_begin; x0 < x_end; x0 += Tile::kSizeX) {
+    for (int k = 0; k < Tile::kItems; ++k) {
+      const int i = k * Tile::kBlockX + tx;
+      line[Tile::Pad(i)] = (active && x0 + i < x_end)
+                               ? static_cast<T>(src.get(x0 + i, y, z))
+                               : T();
+    }
+    __syncthreads();
+
+    // scan the items of this thread
+    T sum = T();
+    for (int k = 0; k < Tile::kItems; ++k) {
+      const int i = tx * Tile::kItems + k;
+      sum += line[Tile::Pad(i)];
+      line[Tile::Pad(i)] = sum;
+    }
+    line_totals[tx] = sum;
+    __syncthreads();
+
+    // scan the totals of the threads
+    for (int offset = 1; offset < Tile::kBlockX; offset *= 2) {
+      const T value = (tx >= offset) ? line_totals[tx - offset] : T();
+      __syncthreads();
+      line_totals[tx] += value;
+      __syncthreads();
+    }
+
+    const T prefix = carry + ((tx > 0) ? line_totals[tx - 1] : T());
+    for (int k = 0; k < Tile::kItems; ++k) {
+      line[Tile::Pad(tx * Tile::kItems + k)] += prefix;
+    }
+    __syncthreads();
+
+    for (int k = 0; k < Tile::kItems; ++k) {
+      const int i = k * Tile::kBlockX + tx;
+      if (active && x0 + i < x_end) {
+        dst.set(x0 + i, y, z,
+                exclusive ? ((i > 0) ? line[Tile::Pad(i - 1)] : carry)
+                          : line[Tile::Pad(i)]);
+      }
+    }
+    carry = line[Tile::Pad(Tile::kSizeX - 1)];
+    __syncthreads();
+  }
+}
+
+//
+// dst = prefix sums of src along y, for 32 columns per block; block j along y
+// scans rows [j * chunk_size, (j + 1) * chunk_size), as for ScanX
+//
+template <typename SrcCls, typename DstCls>
+__global__ void ScanY(const SrcCls src, DstCls dst, const bool exclusive,
+                      const int chunk_size,
+                      const typename DstCls::Scalar *carries) {
+  typedef internal::ScanTile Tile;
+  typedef typename DstCls::Scalar T;
+
+  __shared__ T tile[Tile::kSizeY][Tile::kBlockX + 1];
+  __shared__ T totals[Tile::kBlockY][Tile::kBlockX];
+
+  const int w = src.Width(), h = src.Height();
+  const int tx = threadIdx.x, ty = threadIdx.y;
+  const int x = blockIdx.x * Tile::kBlockX + tx, z = blockIdx.z;
+  const bool active = (x < w);
+  const int y_begin = blockIdx.y * chunk_size;
+  const int y_end = min(h, y_begin + chunk_size);
+
+  T carry = T();
+  if (active && carries != nullptr) {
+    carry = carries[(static_cast<size_t>(z) * w + x) * gridDim.y + blockIdx.y];
+  }
+
+  for (int y0 = y_begin; y0 < y_end; y0 += Tile::kSizeY) {
+    for (int k = 0; k < Tile::kItems; ++k) {
+      const int j = k * Tile::kBlockY + ty;
+      tile[j][tx] = (active && y0 + j < y_end)
+                        ? static_cast<T>(src.get(x, y0 + j, z))
+                        : T();
+    }
+    __syncthreads();
+
+    T sum = T();
+    for (int k = 0; k < Tile::kItems; ++k) {
+      const int j = ty * Tile::kItems + k;
+      sum += tile[j][tx];
+      tile[j][tx] = sum;
+    }
+    totals[ty][tx] = sum;
+    __syncthreads();
+
+    for (int offset = 1; offset < Tile::kBlockY; offset *= 2) {
+      const T value = (ty >= offset) ? totals[ty - offset][tx] : T();
+      __syncthreads();
+      totals[ty][tx] += value;
+      __syncthreads();
+    }
+
+    const T prefix = carry + ((ty > 0) ? totals[ty - 1][tx] : T());
+    for (int k = 0; k < Tile::kItems; ++k) {
+      tile[ty * Tile::kItems + k][tx] += prefix;
+    }
+    __syncthreads();
+
+    for (int k = 0; k < Tile::kItems; ++k) {
+      const int j = k * Tile::kBlockY + ty;
+      if (active && y0 + j < y_end) {
+        dst.set(x, y0 + j, z,
+                exclusive ? ((j > 0) ? tile[j - 1][tx] : carry) : tile[j][tx]);
+      }
+    }
+    carry = tile[Tile::kSizeY - 1][tx];
+    __syncthreads();
+  }
+}
+
+//
+// totals[line * gridDim.x + i] = sum of the chunk of each line that block i
+// along x covers in ScanX; the first pass of a chunked scan along x
+//
+template <typename SrcCls, typename T>
+__global__ void ScanChunkTotalsX(const SrcCls src, const int chunk_size,
+                                 T *totals) {
+  typedef internal::ScanTile Tile;
+
+  __shared__ T sums[Tile::kBlockY][Tile::kBlockX];
+
+  const int w = src.Width(), h = src.Height();
+  const int tx = threadIdx.x, ty = threadIdx.y;
+  const int y = blockIdx.y * Tile::kBlockY + ty, z = blockIdx.z;
+  const int x_begin = blockIdx.x * chunk_size;
+  const int x_end = min(w, x_begin + chunk_size);
+
+  T sum = T();
+  if (y < h) {
+    for (int x = x_begin + tx; x < x_end; x += Tile::kBlockX) {
+      sum += static_cast<T>(src.get(x, y, z));
+    }
+  }
+  sums[ty][tx] = sum;
+  __syncthreads();
+
+  for (int offset = Tile::kBlockX / 2; offset > 0; offset /= 2) {
+    if (tx < offset) {
+      sums[ty][tx] += sums[ty][tx + offset];
+    }
+    __syncthreads();
+  }
+
+  if (tx == 0 && y < h) {
+    totals[(static_cast<size_t>(z) * h + y) * gridDim.x + blockIdx.x] =
+        sums[ty][0];
+  }
+}
+
+//
+// totals[line * gridDim.y + j] = sum of the chunk of each column that block j
+// along y covers in ScanY
+//
+template <typename SrcCls, typename T>
+__global__ void ScanChunkTotalsY(const SrcCls src, const int chunk_size,
+                                 T *totals) {
+  typedef internal::ScanTile Tile;
+
+  __shared__ T sums[Tile::kBlockY][Tile::kBlockX];
+
+  const int w = src.Width(), h = src.Height();
+  const int tx = threadIdx.x, ty = threadIdx.y;
+  const int x = blockIdx.x * Tile::kBlockX + tx, z = blockIdx.z;
+  const int y_begin = blockIdx.y * chunk_size;
+  const int y_end = min(h, y_begin + chunk_size);
+
+  T sum = T();
+  if (x < w) {
+    for (int y = y_begin + ty; y < y_end; y += Tile::kBlockY) {
+      sum += static_cast<T>(src.get(x, y, z));
+    }
+  }
+  sums[ty][tx] = sum;
+  __syncthreads();
+
+  for (int offset = Tile::kBlockY / 2; offset > 0; offset /= 2) {
+    if (ty < offset) {
+      sums[ty][tx] += sums[ty + offset][tx];
+    }
+    __syncthreads();
+  }
+
+  if (ty == 0 && x < w) {
+    totals[(static_cast<size_t>(z) * w + x) * gridDim.y + blockIdx.y] =
+        sums[0][tx];
+  }
+}
+
+//
+// replace the num_chunks chunk totals of each line by their exclusive prefix
+// sums, i.e., the carry into each chunk
+//
+template <typename T>
+__global__ void ScanChunkCarries(T *totals, const size_t num_lines,
+                                 const int num_chunks) {
+  const size_t line = static_cast<size_t>(blockIdx.x) * blockDim.x +
+                      threadIdx.x;
+  if (line >= num_lines) {
+    return;
+  }
+
+  T *line_totals = totals + line * num_chunks;
+  T sum = T();
+  for (int i = 0; i < num_chunks; ++i) {
+    const T value = line_totals[i];
+    line_totals[i] = sum;
+    sum += value;
+  }
+}
+
+//
+// dst = prefix sums of src along z; each thread scans one line, and the lines
+// of a warp are adjacent along x
+//
+template <typename SrcCls, typename DstCls>
+__global__ void ScanZ(const SrcCls src, DstCls dst, const bool exclusive) {
+  typedef typename DstCls::Scalar T;
+
+  const int w = src.Width(), h = src.Height(), d = src.Depth();
+  const int x = blockIdx.x * blockDim.x + threadIdx.x;
+  const int y = blockIdx.y * blockDim.y + threadIdx.y;
+  if (x >= w || y >= h) {
+    return;
+  }
+
+  T sum = T();
+  for (int z = 0; z < d; ++z) {
+    const T value = static_cast<T>(src.get(x, y, z));
+    if (exclusive) {
+      dst.set(x, y, z, sum);
+    }
+    sum += value;
+    if (!exclusive) {
+      dst.set(x, y, z, sum);
+    }
+  }
+}
+
+}  // namespace kernel
+
+//------------------------------------------------------------------------------
+//
+// host implementations
+//
+//------------------------------------------------------------------------------
+
+namespace internal {
+
+//
+// Scans along one axis, for arrays with a 3D interface; src and dst may be
+// the same array. Along y and z, each task carries the running totals of a
+// band of lines in a buffer and walks the array row by row.
+//
+template <typename SrcCls, typename DstCls>
+inline void HostScanX(const SrcCls &src, DstCls &dst, const bool exclusive) {
+  typedef typename DstCls::Scalar T;
+  const int w = src.Width(), h = src.Height();
+
+  ParallelForRows(h * src.Depth(), w, [&](size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; ++i) {
+      const int y = i % h, z = i / h;
+      T sum = T();
+      for (int x = 0; x < w; ++x) {
+        const T value = static_cast<T>(src.get(x, y, z));
+        if (exclusive) {
+          dst.set(x, y, z, sum);
+        }
+        sum += value;
+        if (!exclusive) {
+          dst.set(x, y, z, sum);
+        }
+      }
+    }
+  });
+}
+
+template <int Axis, typename SrcCls, typename DstCls>
+inline void HostScanYZ(const SrcCls &src, DstCls &dst, const bool exclusive) {
+  typedef typename DstCls::Scalar T;
+  const int w = src.Width(), h = src.Height(), d = src.Depth();
+  // lines are scanned along the axis; tasks split the other axis
+  const int length = (Axis == 1) ? h : d;
+  const int other = (Axis == 1) ? d : h;
+  const size_t line_size = static_cast<size_t>(w) * length;
+
+  ParallelForRows(other, line_size, [&](size_t i0, size_t i1) {
+    std::vector<T> sums(w);
+    for (size_t i = i0; i < i1; ++i) {
+      std::fill(sums.begin(), sums.end(), T());
+      for (int j = 0; j < length; ++j) {
+        const int y = (Axis == 1) ? j : i, z = (Axis == 1) ? i : j;
+        for (int x = 0; x < w; ++x) {
+          const T value = static_cast<T>(src.get(x, y, z));
+          if (exclusive) {
+            dst.set(x, y, z, sums[x]);
+          }
+          sums[x] += value;
+          if (!exclusive) {
+            dst.set(x, y, z, sums[x]);
+          }
+        }
+      }
+    }
+  });
+}
+
+template <typename SrcCls, typename DstCls>
+inline void HostScanAxis(const unsigned int axis, const SrcCls &src,
+                         DstCls &dst, const bool exclusive) {
+  if (axis == kScanX) {
+    HostScanX(src, dst, exclusive);
+  } else if (axis == kScanY) {
+    HostScanYZ<1>(src, dst, exclusive);
+  } else {
+    HostScanYZ<2>(src, dst, exclusive);
+  }
+}
+
+//
+// scan src along the given axes, one axis after the other, into dst
+//
+template <typename SrcCls, typename DstCls>
+inline void HostScan(const SrcCls &src, DstCls &dst, const unsigned int axes,
+                     const ScanMode mode) {
+  const bool exclusive = (mode == ScanMode::kExclusive);
+  bool first = true;
+  for (unsigned int axis = kScanX; axis <= kScanZ; axis <<= 1) {
+    if (axes & axis) {
+      if (first) {
+        HostScanAxis(axis, src, dst, exclusive);
+      } else {
+        HostScanAxis(axis, dst, dst, exclusive);
+      }
+      first = false;
+    }
+  }
+}
+
+}  // namespace internal
+
+namespace host {
+
+/**
+ * Host implementation of the scans of CudaArray2DBase, e.g., for
+ * CudaHostArray2D objects; this is also a reference for testing the kernels.
+ * @param src source array
+ * @param dst destination array of the same size as src; this may be src itself
+ * @param axes internal::kScanX, internal::kScanY, or both
+ * @param mode inclusive or exclusive scan
+ */
+template <typename SrcCls, typename DstCls>
+inline void Scan2D(const SrcCls &src, DstCls &dst, const unsigned int axes,
+                   const ScanMode mode) {
+  internal::CheckScanArrays(src, dst, std::false_type());
+  internal::ConvolutionSlice<DstCls &> dst_slice(dst);
+  internal::HostScan(internal::ConvolutionSlice<const SrcCls &>(src), dst_slice,
+                     axes, mode);
+}
+
+/**
+ * Host implementation of the scans of CudaArray3DBase; see Scan2D().
+ * @param src source array
+ * @param dst destination array of the same size as src; this may be src itself
+ * @param axes any combination of internal::kScanX, kScanY, and kScanZ
+ * @param mode inclusive or exclusive scan
+ */
+template <typename SrcCls, typename DstCls>
+inline void Scan3D(const SrcCls &src, DstCls &dst, const unsigned int axes,
+                   const ScanMode mode) {
+  internal::CheckScanArrays(src, dst, std::true_type());
+  internal::HostScan(src, dst, axes, mode);
+}
+
+}  // namespace host
+
+//------------------------------------------------------------------------------
+//
+// device implementations
+//
+//------------------------------------------------------------------------------
+
+namespace internal {
+
+//
+// Queue a scan along one axis on the given stream. Along x and y, a block
+// scans up to 8 or 32 lines, respectively, so that short arrays with long
+// lines give only a few blocks; such lines are then split into chunks. A first
+// pass sums each chunk, the chunk totals of each line are scanned into the
+// carry of each chunk, and the chunks are then scanned in parallel, starting
+// from their carries. Along z, each thread scans one line.
+//
+template <typename SrcCls, typename DstCls>
+inline void ScanAxis(const unsigned int axis, const SrcCls &src,
+                     const DstCls &dst, const bool exclusive, int device,
+                     cudaStream_t stream) {
+  typedef ScanTile Tile;
+  typedef typename DstCls::Scalar T;
+  const int w = src.Width(), h = src.Height(), d = src.Depth();
+  const dim3 block_dim(Tile::kBlockX, Tile::kBlockY);
+  if (w == 0 || h == 0 || d == 0) {
+    return;
+  }
+
+  if (axis == kScanZ) {
+    const dim3 grid_dim((w + Tile::kBlockX - 1) / Tile::kBlockX,
+                        (h + Tile::kBlockY - 1) / Tile::kBlockY);
+    kernel::ScanZ<<<grid_dim, block_dim, 0, stream>>>(src, dst, exclusive);
+    return;
+  }
+
+  const bool along_x = (axis == kScanX);
+  const int length = along_x ? w : h;
+  const int tile_size = along_x ? Tile::kSizeX : Tile::kSizeY;
+  dim3 grid_dim = along_x
+                      ? dim3(1, (h + Tile::kBlockY - 1) / Tile::kBlockY, d)
+                      : dim3((w + Tile::kBlockX - 1) / Tile::kBlockX, 1, d);
+
+  // chunks consist of whole tiles
+  int num_chunks = NumScanChunks(grid_dim.x * grid_dim.y * grid_dim.z, length,
+                                 tile_size, device);
+  const int num_tiles = (length + tile_size - 1) / tile_size;
+  const int chunk_size = (num_tiles + num_chunks - 1) / num_chunks * tile_size;
+  num_chunks = (length + chunk_size - 1) / chunk_size;
+  if (along_x) {
+    grid_dim.x = num_chunks;
+  } else {
+    grid_dim.y = num_chunks;
+  }
+
+  CachingAllocator<> &allocator = CachingAllocator<>::Instance();
+  T *carries = nullptr;
+  if (num_chunks > 1) {
+    const size_t num_lines = static_cast<size_t>(along_x ? h : w) * d;
+    carries = static_cast<T *>(allocator.Allocate(
+        num_lines * num_chunks * sizeof(T), device, stream));
+    if (along_x) {
+      kernel::ScanChunkTotalsX<<<grid_dim, block_dim, 0, stream>>>(
+          src, chunk_size, carries);
+    } else {
+      kernel::ScanChunkTotalsY<<<grid_dim, block_dim, 0, stream>>>(
+          src, chunk_size, carries);
+    }
+    kernel::ScanChunkCarries<<<
+        (num_lines + kScanCarryBlockSize - 1) / kScanCarryBlockSize,
+        kScanCarryBlockSize, 0, stream>>>(carries, num_lines, num_chunks);
+  }
+
+  if (along_x) {
+    kernel::ScanX<<<grid_dim, block_dim, 0, stream>>>(src, dst, exclusive,
+                                                      chunk_size, carries);
+  } else {
+    kernel::ScanY<<<grid_dim, block_dim, 0, stream>>>(src, dst, exclusive,
+                                                      chunk_size, carries);
+  }
+
+  // the scratch block is only reused by later work on the same stream
+  allocator.Free(carries);
+}
+
+//
+// Queue a scan of src along the given axes into dst. The first pass reads src,
+// and any further passes scan dst in place, so that multi-axis scans, e.g.,
+// summed-area tables, accumulate in the scalar type of dst throughout.
+//
+template <typename SrcCls, typename DstCls>
+inline void Scan(const SrcCls &src, const DstCls &dst, const unsigned int axes,
+                 const ScanMode mode, int device, cudaStream_t stream) {
+  const bool exclusive = (mode == ScanMode::kExclusive);
+  bool first = true;
+  for (unsigned int axis = kScanX; axis <= kScanZ; axis <<= 1) {
+    if (axes & axis) {
+      if (first) {
+        ScanAxis(axis, src, dst, exclusive, device, stream);
+      } else {
+        ScanAxis(axis, dst, dst, exclusive, device, stream);
+      }
+      first = false;
+    }
+  }
+}
+
+template <typename SrcCls, typename DstCls>
+inline void Scan2D(const SrcCls &src, const DstCls &dst,
+                   const unsigned int axes, const ScanMode mode, int device,
+                   cudaStream_t stream) {
+  SetDevice(device);
+  Scan(ConvolutionSlice<SrcCls>(src), ConvolutionSlice<DstCls>(dst), axes,
+       mode, device, stream);
+}
+
+template <typename SrcCls, typename DstCls>
+inline void Scan3D(const SrcCls &src, const DstCls &dst,
+                   const unsigned int axes, const ScanMode mode, int device,
+                   cudaStream_t stream) {
+  SetDevice(device);
+  Scan(src, dst, axes, mode, device, stream);
+}
+
+}  // namespace internal
+
+}  // namespace cua
+
+#endif  // LIBCUA_SCAN_H_
@@ -0,0 +1,503 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_STAGING_BUFFER_POOL_H_
+#define LIBCUA_STAGING_BUFFER_POOL_H_
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace cua {
+
+namespace internal {
+
+/**
+ * @class CudaPinnedMemoryBackend
+ * @brief Default StagingBufferPool backend, which uses page-locked host memory
+ * and CUDA events.
+ *
+ * Tests substitute a host-only backend with the same interface.
+ */
+struct CudaPinnedMemoryBackend {
+  typedef cudaEvent_t Event;
+
+  /**
+   * @return a new page-locked allocation, or nullptr if the allocation failed
+   */
+  inline void *AllocatePinned(size_t size_in_bytes) const {
+    void *ptr = nullptr;
+    if (cudaHostAlloc(&ptr, size_in_bytes, cudaHostAllocPortable) !=
+        cudaSuccess) {
+      cudaGetLastError();  // clear the error
+      return nullptr;
+    }
+    return ptr;
+  }
+
+  inline void FreePinned(void *ptr) const { cudaFreeHost(ptr); }
+
+  /**
+   * @return true if the given host pointer already refers to page-locked
+   *   memory, in which case it can be passed to the copy functions directly
+   */
+  inline bool IsPinned(const void *ptr) const {
+    cudaPointerAttributes attributes;
+    if (cudaPointerGetAttributes(&attributes, ptr) != cudaSuccess) {
+      cudaGetLastError();  // pageable memory is an error before CUDA 11
+      return false;
+    }
+#if CUDART_VERSION >= 10000
+    return attributes.type == cudaMemoryTypeHost;
+#else
+    return attributes.memoryType == cudaMemoryTypeHost;
+#endif
+  }
+
+  inline Event CreateEvent() const {
+    Event event;
+    cudaEventCreateWithFlags(&event, cudaEventDisableTiming);
+    return event;
+  }
+
+  inline void DestroyEvent(Event event) const { cudaEventDestroy(event); }
+
+  inline void RecordEvent(Event event, cudaStream_t stream) const {
+    cudaEventRecord(event, stream);
+  }
+
+  inline void SynchronizeEvent(Event event) const {
+    cudaEventSynchronize(event);
+  }
+
+  inline void SynchronizeStream(cudaStream_t stream) const {
+    cudaStreamSynchronize(stream);
+  }
+};
+
+//------------------------------------------------------------------------------
+
+//
+// Split the rows [first_row, first_row + num_rows) of a stack of slices, each
+// rows_per_slice rows tall, into runs that do not cross a slice boundary, and
+// call func(y, z, num_rows_in_run, rows_before_run) for each run. This helps
+// copy functions for 3D objects, whose slices are not always equally spaced.
+//
+template <typename Function>
+inline void ForEachSliceRun(size_t first_row, size_t num_rows,
+                            size_t rows_per_slice, const Function &func) {
+  for (size_t i = 0; i < num_rows;) {
+    const size_t y = (first_row + i) % rows_per_slice;
+    const size_t z = (first_row + i) / rows_per_slice;
+    const size_t n = std::min(num_rows - i, rows_per_slice - y);
+    func(y, z, n, i);
+    i += n;
+  }
+}
+
+}  // namespace internal
+
+//------------------------------------------------------------------------------
+
+/**
+ * @class StagingBufferPool
+ * @brief Reusable page-locked buffers for host<->device copies of pageable
+ * memory.
+ *
+ * Copies from pageable host memory are staged by the driver through a small
+ * internal buffer and run well below the bandwidth of page-locked memory.
+ * Upload() and Download() instead split a transfer into chunks of whole rows
+ * and stream them through two page-locked buffers from this pool: while the GPU
+ * copies one chunk, the CPU fills (or drains) the other. Both functions return
+ * once the transfer has completed, matching the behavior of the synchronous
+ * cudaMemcpy functions they replace.
+ *
+ * Transfers smaller than kMinStagedBytes, and transfers whose host memory is
+ * already page-locked, are passed to the copy function in a single call.
+ *
+ * The array classes use `StagingBufferPool<>::Instance()` when copying from or
+ * to a raw host pointer. Buffers and their events are allocated on demand,
+ * shared between transfers, and kept until Trim() is called. All methods are
+ * thread-safe.
+ *
+ * @tparam Backend class providing page-locked allocation and event functions;
+ *   see internal::CudaPinnedMemoryBackend
+ */
+template <typename Backend = internal::CudaPinnedMemoryBackend>
+class StagingBufferPool {
+ public:
+  /// default size of each staging buffer
+  static const size_t kDefaultChunkBytes;
+
+  /// transfers smaller than this are not staged
+  static const size_t kMinStagedBytes;
+
+  //----------------------------------------------------------------------------
+
+  /**
+   * Constructor.
+   * @param chunk_bytes size of each staging buffer; rows larger than this are
+   *   staged one at a time in a correspondingly larger buffer
+   * @param backend object used for page-locked allocations and events
+   */
+  explicit StagingBufferPool(size_t chunk_bytes = kDefaultChunkBytes,
+                             const Backend &backend = Backend())
+      : backend_(backend),
+        chunk_bytes_(std::max<size_t>(chunk_bytes, 1)),
+        num_buffers_(0) {}
+
+  ~StagingBufferPool() { Trim(); }
+
+  StagingBufferPool(const StagingBufferPool &) = delete;
+  StagingBufferPool &operator=(const StagingBufferPool &) = delete;
+
+  /**
+   * @return the process-wide pool used by the array classes; like
+   *   CachingAllocator<>::Instance(), this object is never destroyed
+   */
+  static StagingBufferPool &Instance() {
+    static StagingBufferPool *pool = new StagingBufferPool();
+    return *pool;
+  }
+
+  //----------------------------------------------------------------------------
+
+  /**
+   * Copy densely packed rows of host memory to the device.
+   * @param host_data source rows, in pageable or page-locked memory
+   * @param row_bytes number of bytes in each row
+   * @param num_rows number of rows to copy
+   * @param stream stream on which to issue the copies
+   * @param copy_rows function with signature
+   *   `void copy_rows(const void *src, size_t first_row, size_t num_rows,
+   *                   cudaStream_t stream)`
+   *   that asynchronously copies num_rows densely packed rows from src to rows
+   *   [first_row, first_row + num_rows) of the destination
+   */
+  template <typename CopyRowsFunction>
+  void Upload(const void *host_data, size_t row_bytes, size_t num_rows,
+              cudaStream_t stream, const CopyRowsFunction &copy_rows);
+
+  /**
+   * Copy rows from the device to densely packed host memory.
+   * @param host_data destination rows, in pageable or page-locked memory
+   * @param row_bytes number of bytes in each row
+   * @param num_rows number of rows to copy
+   * @param stream stream on which to issue the copies
+   * @param copy_rows function with signature
+   *   `void copy_rows(void *dst, size_t first_row, size_t num_rows,
+   *                   cudaStream_t stream)`
+   *   that asynchronously copies rows [first_row, first_row + num_rows) of the
+   *   source to num_rows densely packed rows at dst
+   */
+  template <typename CopyRowsFunction>
+  void Download(void *host_data, size_t row_bytes, size_t num_rows,
+                cudaStream_t stream, const CopyRowsFunction &copy_rows);
+
+  /**
+   * Release all staging buffers and events that are not currently in use.
+   */
+  void Trim();
+
+  //----------------------------------------------------------------------------
+  // getters/setters
+
+  inline size_t ChunkBytes() const { return chunk_bytes_; }
+
+  /**
+   * @return the number of staging buffers currently held by the pool, in use
+   *   or not
+   */
+  inline size_t NumBuffers() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_buffers_;
+  }
+
+  //----------------------------------------------------------------------------
+  // private class methods and fields
+
+ private:
+  struct Buffer {
+    void *ptr;
+    size_t size_in_bytes;
+  };
+
+  // a leased staging buffer, with the event recorded after the last copy that
+  // uses it; on destruction, the lease waits for that copy and returns both to
+  // the pool, so that neither leaks if a transfer throws
+  struct Lease {
+    Lease(StagingBufferPool *pool, size_t buffer_bytes)
+        : pool(pool),
+          buffer(pool->AcquireBuffer_(buffer_bytes)),
+          event(pool->AcquireEvent_()),
+          pending(false),
+          first_row(0),
+          num_rows(0) {}
+
+    ~Lease() {
+      if (pending) {
+        pool->backend_.SynchronizeEvent(event);
+      }
+      pool->ReleaseEvent_(event);
+      pool->ReleaseBuffer_(buffer);
+    }
+
+    Lease(const Lease &) = delete;
+    Lease &operator=(const Lease &) = delete;
+
+    StagingBufferPool *const pool;
+    const Buffer buffer;
+    const typename Backend::Event event;
+    bool pending;  // whether a copy using the buffer is in flight
+    size_t first_row, num_rows;
+  };
+
+  // whether a transfer of the given size should go through the staging buffers
+  inline bool ShouldStage_(const void *host_data, size_t size_in_bytes) const {
+    return size_in_bytes >= kMinStagedBytes && !backend_.IsPinned(host_data);
+  }
+
+  Buffer AcquireBuffer_(size_t min_bytes);
+  void ReleaseBuffer_(const Buffer &buffer);
+
+  typename Backend::Event AcquireEvent_();
+  void ReleaseEvent_(typename Backend::Event event);
+
+  Backend backend_;
+  size_t chunk_bytes_;
+
+  mutable std::mutex mutex_;
+  std::vector<Buffer> free_buffers_;
+  std::vector<typename Backend::Event> free_events_;
+  size_t num_buffers_;
+};
+
+//------------------------------------------------------------------------------
+//
+// static member initialization
+//
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+const size_t StagingBufferPool<Backend>::kDefaultChunkBytes = 4 << 20;
+
+template <typename Backend>
+const size_t StagingBufferPool<Backend>::kMinStagedBytes = 256 << 10;
+
+//------------------------------------------------------------------------------
+//
+// public method implementations
+//
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+template <typename CopyRowsFunction>
+inline void StagingBufferPool<Backend>::Upload(
+    const void *host_data, size_t row_bytes, size_t num_rows,
+    cudaStream_t stream, const CopyRowsFunction &copy_rows) {
+  if (!ShouldStage_(host_data, row_bytes * num_rows)) {
+    copy_rows(host_data, 0, num_rows, stream);
+    backend_.SynchronizeStream(stream);
+    return;
+  }
+
+  const size_t rows_per_chunk = std::max<size_t>(chunk_bytes_ / row_bytes, 1);
+  const char *src = reinterpret_cast<const char *>(host_data);
+
+  // the leases wait for their last copies when they go out of scope
+  const size_t buffer_bytes = rows_per_chunk * row_bytes;
+  Lease leases[2] = {{this, buffer_bytes}, {this, buffer_bytes}};
+
+  for (size_t row = 0, i = 0; row < num_rows; row += rows_per_chunk, ++i) {
+    Lease &lease = leases[i % 2];
+    const size_t n = std::min(rows_per_chunk, num_rows - row);
+
+    // wait until the last copy out of this buffer has finished
+    if (lease.pending) {
+      backend_.SynchronizeEvent(lease.event);
+    }
+
+    std::memcpy(lease.buffer.ptr, src + row * row_bytes, n * row_bytes);
+    copy_rows(lease.buffer.ptr, row, n, stream);
+    backend_.RecordEvent(lease.event, stream);
+    lease.pending = true;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+template <typename CopyRowsFunction>
+inline void StagingBufferPool<Backend>::Download(
+    void *host_data, size_t row_bytes, size_t num_rows, cudaStream_t stream,
+    const CopyRowsFunction &copy_rows) {
+  if (!ShouldStage_(host_data, row_bytes * num_rows)) {
+    copy_rows(host_data, 0, num_rows, stream);
+    backend_.SynchronizeStream(stream);
+    return;
+  }
+
+  const size_t rows_per_chunk = std::max<size_t>(chunk_bytes_ / row_bytes, 1);
+  char *dst = reinterpret_cast<char *>(host_data);
+
+  const size_t buffer_bytes = rows_per_chunk * row_bytes;
+  Lease leases[2] = {{this, buffer_bytes}, {this, buffer_bytes}};
+
+  // copies the contents of a finished buffer to the output
+  auto drain = [&](Lease *lease) {
+    backend_.SynchronizeEvent(lease->event);
+    std::memcpy(dst + lease->first_row * row_bytes, lease->buffer.ptr,
+                lease->num_rows * row_bytes);
+    lease->pending = false;
+  };
+
+  for (size_t row = 0, i = 0; row < num_rows; row += rows_per_chunk, ++i) {
+    Lease &lease = leases[i % 2];
+
+    // drain the chunk issued two iterations ago; the previous chunk, in the
+    // other buffer, is still in flight
+    if (lease.pending) {
+      drain(&lease);
+    }
+
+    lease.first_row = row;
+    lease.num_rows = std::min(rows_per_chunk, num_rows - row);
+    copy_rows(lease.buffer.ptr, row, lease.num_rows, stream);
+    backend_.RecordEvent(lease.event, stream);
+    lease.pending = true;
+  }
+
+  for (Lease &lease : leases) {
+    if (lease.pending) {
+      drain(&lease);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+inline void StagingBufferPool<Backend>::Trim() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const Buffer &buffer : free_buffers_) {
+    backend_.FreePinned(buffer.ptr);
+  }
+  num_buffers_ -= free_buffers_.size();
+  free_buffers_.clear();
+
+  for (const typename Backend::Event event : free_events_) {
+    backend_.DestroyEvent(event);
+  }
+  free_events_.clear();
+}
+
+//------------------------------------------------------------------------------
+//
+// private method implementations
+//
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+inline typename StagingBufferPool<Backend>::Buffer
+StagingBufferPool<Backend>::AcquireBuffer_(size_t min_bytes) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = free_buffers_.begin(); it != free_buffers_.end(); ++it) {
+      if (it->size_in_bytes >= min_bytes) {
+        const Buffer buffer = *it;
+        free_buffers_.erase(it);
+        return buffer;
+      }
+    }
+  }
+
+  // all buffers are in use or too small; allocate a new one
+  const size_t size_in_bytes = std::max(min_bytes, chunk_bytes_);
+  Buffer buffer = {backend_.AllocatePinned(size_in_bytes), size_in_bytes};
+  if (buffer.ptr == nullptr) {
+    Trim();  // release unused buffers and try again
+    buffer.ptr = backend_.AllocatePinned(size_in_bytes);
+  }
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (buffer.ptr == nullptr) {
+    throw std::runtime_error(
+        "StagingBufferPool: failed to allocate page-locked memory.");
+  }
+#endif
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++num_buffers_;
+  return buffer;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+inline void StagingBufferPool<Backend>::ReleaseBuffer_(const Buffer &buffer) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  free_buffers_.push_back(buffer);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+inline typename Backend::Event StagingBufferPool<Backend>::AcquireEvent_() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!free_events_.empty()) {
+      const typename Backend::Event event = free_events_.back();
+      free_events_.pop_back();
+      return event;
+    }
+  }
+  return backend_.CreateEvent();
+}
+
+//------------------------------------------------------------------------------
+
+template <typename Backend>
+inline void StagingBufferPool<Backend>::ReleaseEvent_(
+    typename Backend::Event event) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  free_events_.push_back(event);
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace cua
+
+#endif  // LIBCUA_STAGING_BUFFER_POOL_H_
@@ -0,0 +1,569 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_STENCIL_H_
+#define LIBCUA_STENCIL_H_
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "convolution.h"
+#include "hostThreadPool.h"
+#include "util.h"
+
+namespace cua {
+
+/**
+ * @class StencilAccessor2D
+ * @brief Read access to the neighborhood of one element in a stencil
+ * operation; see CudaArray2DBase::ApplyStencil().
+ *
+ * The neighborhood is staged in a tile of shared memory (or of host memory,
+ * for host arrays), so reading it is cheap, and every element is loaded from
+ * the array only once per tile.
+ */
+template <typename T, unsigned int Radius>
+class StencilAccessor2D {
+ public:
+  typedef T Scalar;
+
+  static const int kRadius = Radius;
+
+  /**
+   * @param center tile element of the current array element
+   * @param pitch number of elements between consecutive rows of the tile
+   */
+  __host__ __device__ StencilAccessor2D(const T *center, int pitch)
+      : center_(center), pitch_(pitch) {}
+
+  /**
+   * @param dx x offset from the current element, at most Radius in magnitude
+   * @param dy y offset from the current element, at most Radius in magnitude
+   * @return the neighboring element; elements outside of the array follow the
+   *   border policy of the stencil operation
+   */
+  __host__ __device__ inline const T &operator()(int dx, int dy) const {
+    return center_[dy * pitch_ + dx];
+  }
+
+ private:
+  const T *center_;
+  int pitch_;
+};
+
+/**
+ * @class StencilAccessor3D
+ * @brief Read access to the neighborhood of one element in a 3D stencil
+ * operation; see StencilAccessor2D and CudaArray3DBase::ApplyStencil().
+ */
+template <typename T, unsigned int Radius>
+class StencilAccessor3D {
+ public:
+  typedef T Scalar;
+
+  static const int kRadius = Radius;
+
+  /**
+   * @param center tile element of the current array element
+   * @param pitch number of elements between consecutive rows of the tile
+   * @param slice_pitch number of elements between consecutive slices of the
+   *   tile
+   */
+  __host__ __device__ StencilAccessor3D(const T *center, int pitch,
+                                        int slice_pitch)
+      : center_(center), pitch_(pitch), slice_pitch_(slice_pitch) {}
+
+  __host__ __device__ inline const T &operator()(int dx, int dy,
+                                                 int dz) const {
+    return center_[dz * slice_pitch_ + dy * pitch_ + dx];
+  }
+
+ private:
+  const T *center_;
+  int pitch_, slice_pitch_;
+};
+
+namespace internal {
+
+//------------------------------------------------------------------------------
+
+//
+// Tile shapes of the stencil operations. A tile of kSizeX x kSizeY(x kSizeZ)
+// outputs reads kTileX x kTileY(x kTileZ) inputs, i.e., the outputs plus a
+// halo of Radius elements on every side. On the GPU, each tile is one block of
+// kBlockX x kBlockY threads, which loop over the rows (and slices) of the
+// tile; the host uses the same tiles.
+//
+template <unsigned int Radius>
+struct StencilTile2D {
+  static const int kBlockX = 32;
+  static const int kBlockY = 8;
+
+  static const int kSizeX = 32;
+  static const int kSizeY = 32;
+
+  static const int kTileX = kSizeX + 2 * static_cast<int>(Radius);
+  static const int kTileY = kSizeY + 2 * static_cast<int>(Radius);
+};
+
+template <unsigned int Radius>
+struct StencilTile3D {
+  static const int kBlockX = 32;
+  static const int kBlockY = 8;
+
+  static const int kSizeX = 32;
+  static const int kSizeY = 8;
+  static const int kSizeZ = 4;
+
+  static const int kTileX = kSizeX + 2 * static_cast<int>(Radius);
+  static const int kTileY = kSizeY + 2 * static_cast<int>(Radius);
+  static const int kTileZ = kSizeZ + 2 * static_cast<int>(Radius);
+};
+
+// largest static shared-memory allocation of a kernel
+static const size_t kMaxStencilTileBytes = 48 * 1024;
+
+//------------------------------------------------------------------------------
+
+//
+// Stage the tile with origin (x0, y0, z0), i.e., the position of its first
+// halo element, of a 2D or 3D array. Each thread (or the host, with begin = 0
+// and step = 1) loads elements begin, begin + step, ... along each axis.
+//
+LIBCUA_EXEC_CHECK_DISABLE
+template <typename SrcCls, typename T>
+__host__ __device__ inline void LoadStencilRow(
+    const SrcCls &src, const int x0, const int y, const int tile_x,
+    const int x_begin, const int x_step, const ConvolutionBorder border,
+    T *row) {
+  for (int i = x_begin; i < tile_x; i += x_step) {
+    const int x = ConvolutionIndex(x0 + i, src.Width(), border);
+    if (x >= 0 && y >= 0) {
+      row[i] = src.get(x, y);
+    } else {
+      row[i] = T();
+    }
+  }
+}
+
+LIBCUA_EXEC_CHECK_DISABLE
+template <typename SrcCls, typename T>
+__host__ __device__ inline void LoadStencilRow(
+    const SrcCls &src, const int x0, const int y, const int z,
+    const int tile_x, const int x_begin, const int x_step,
+    const ConvolutionBorder border, T *row) {
+  for (int i = x_begin; i < tile_x; i += x_step) {
+    const int x = ConvolutionIndex(x0 + i, src.Width(), border);
+    if (x >= 0 && y >= 0 && z >= 0) {
+      row[i] = src.get(x, y, z);
+    } else {
+      row[i] = T();
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+//
+// Storage behind an array, used to detect a stencil output that aliases its
+// source even through a shallow copy or a view: the byte range spanned by the
+// elements of arrays in linear memory, or the backing CUDA array of surfaces
+// and textures, which is treated as a one-byte range. Other arrays report an
+// empty range and are only compared by address.
+//
+struct ArrayStorage {
+  const char *begin;
+  const char *end;
+
+  inline bool Overlaps(const ArrayStorage &other) const {
+    return begin != nullptr && other.begin != nullptr && begin < other.end &&
+           other.begin < end;
+  }
+};
+
+template <typename T>
+inline auto StorageOf2D(const T &array, int)
+    -> decltype(array.ptr(), ArrayStorage()) {
+  if (array.Width() == 0 || array.Height() == 0) {
+    return {nullptr, nullptr};
+  }
+  return {reinterpret_cast<const char *>(array.ptr()),
+          reinterpret_cast<const char *>(
+              array.ptr(array.Width() - 1, array.Height() - 1) + 1)};
+}
+
+template <typename T>
+inline auto StorageOf3D(const T &array, int)
+    -> decltype(array.ptr(), ArrayStorage()) {
+  if (array.Width() == 0 || array.Height() == 0 || array.Depth() == 0) {
+    return {nullptr, nullptr};
+  }
+  return {reinterpret_cast<const char *>(array.ptr()),
+          reinterpret_cast<const char *>(
+              array.ptr(array.Width() - 1, array.Height() - 1,
+                        array.Depth() - 1) +
+              1)};
+}
+
+template <typename T>
+inline auto StorageOfCudaArray(const T &array, int)
+    -> decltype(array.DeviceArray(), ArrayStorage()) {
+  const char *begin = reinterpret_cast<const char *>(array.DeviceArray());
+  return {begin, begin + 1};
+}
+
+template <typename T>
+inline ArrayStorage StorageOfCudaArray(const T &, long) {
+  return {nullptr, nullptr};
+}
+
+template <typename T>
+inline ArrayStorage StorageOf2D(const T &array, long) {
+  return StorageOfCudaArray(array, 0);
+}
+
+template <typename T>
+inline ArrayStorage StorageOf3D(const T &array, long) {
+  return StorageOfCudaArray(array, 0);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T1, typename T2>
+inline void CheckStencilArrays2D(const T1 &src, const T2 &dst) {
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (static_cast<const void *>(&src) == static_cast<const void *>(&dst) ||
+      StorageOf2D(src, 0).Overlaps(StorageOf2D(dst, 0))) {
+    throw std::runtime_error(
+        "A stencil operation cannot write to memory of its source array.");
+  }
+  if (src.Width() != dst.Width() || src.Height() != dst.Height()) {
+    throw std::runtime_error("Arrays have different sizes (" +
+                             ArraySizeToString2D(src) + " vs " +
+                             ArraySizeToString2D(dst) + ").");
+  }
+#endif
+}
+
+template <typename T1, typename T2>
+inline void CheckStencilArrays3D(const T1 &src, const T2 &dst) {
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (static_cast<const void *>(&src) == static_cast<const void *>(&dst) ||
+      StorageOf3D(src, 0).Overlaps(StorageOf3D(dst, 0))) {
+    throw std::runtime_error(
+        "A stencil operation cannot write to memory of its source array.");
+  }
+  if (src.Width() != dst.Width() || src.Height() != dst.Height() ||
+      src.Depth() != dst.Depth()) {
+    throw std::runtime_error("Arrays have different sizes (" +
+                             ArraySizeToString3D(src) + " vs " +
+                             ArraySizeToString3D(dst) + ").");
+  }
+#endif
+}
+
+}  // namespace internal
+
+//------------------------------------------------------------------------------
+//
+// kernel definitions
+//
+//------------------------------------------------------------------------------
+
+namespace kernel {
+
+//
+// dst(x, y) = op(neighborhood of src(x, y), x, y)
+//
+template <unsigned int Radius, typename SrcCls, typename DstCls,
+          class Function>
+__global__ void ApplyStencil2D(const SrcCls src, DstCls dst, Function op,
+                               const ConvolutionBorder border) {
+  typedef typename SrcCls::Scalar Scalar;
+  typedef internal::StencilTile2D<Radius> Tile;
+  const int r = static_cast<int>(Radius);
+
+  __shared__ Scalar tile[Tile::kTileY][Tile::kTileX];
+
+  const int x0 = blockIdx.x * Tile::kSizeX;
+  const int y0 = blockIdx.y * Tile::kSizeY;
+
+  for (int j = threadIdx.y; j < Tile::kTileY; j += Tile::kBlockY) {
+    const int y = internal::ConvolutionIndex(y0 - r + j, src.Height(), border);
+    internal::LoadStencilRow(src, x0 - r, y, Tile::kTileX, threadIdx.x,
+                             Tile::kBlockX, border, tile[j]);
+  }
+
+  __syncthreads();
+
+  const typename SrcCls::IndexType x = x0 + threadIdx.x;
+  if (x >= src.Width()) {
+    return;
+  }
+
+  for (int j = threadIdx.y; j < Tile::kSizeY; j += Tile::kBlockY) {
+    const typename SrcCls::IndexType y = y0 + j;
+    if (y < src.Height()) {
+      const StencilAccessor2D<Scalar, Radius> neighborhood(
+          &tile[j + r][threadIdx.x + r], Tile::kTileX);
+      dst.set(x, y, op(neighborhood, x, y));
+    }
+  }
+}
+
+//
+// dst(x, y, z) = op(neighborhood of src(x, y, z), x, y, z)
+//
+template <unsigned int Radius, typename SrcCls, typename DstCls,
+          class Function>
+__global__ void ApplyStencil3D(const SrcCls src, DstCls dst, Function op,
+                               const ConvolutionBorder border) {
+  typedef typename SrcCls::Scalar Scalar;
+  typedef internal::StencilTile3D<Radius> Tile;
+  const int r = static_cast<int>(Radius);
+
+  __shared__ Scalar tile[Tile::kTileZ][Tile::kTileY][Tile::kTileX];
+
+  const int x0 = blockIdx.x * Tile::kSizeX;
+  const int y0 = blockIdx.y * Tile::kSizeY;
+  const int z0 = blockIdx.z * Tile::kSizeZ;
+
+  // each row of the block loads whole rows of the tile
+  for (int jk = threadIdx.y; jk < Tile::kTileY * Tile::kTileZ;
+       jk += Tile::kBlockY) {
+    const int j = jk % Tile::kTileY, k = jk / Tile::kTileY;
+    const int y = internal::ConvolutionIndex(y0 - r + j, src.Height(), border);
+    const int z = internal::ConvolutionIndex(z0 - r + k, src.Depth(), border);
+    internal::LoadStencilRow(src, x0 - r, y, z, Tile::kTileX, threadIdx.x,
+                             Tile::kBlockX, border, tile[k][j]);
+  }
+
+  __syncthreads();
+
+  const typename SrcCls::IndexType x = x0 + threadIdx.x;
+  if (x >= src.Width()) {
+    return;
+  }
+
+  for (int k = 0; k < Tile::kSizeZ; ++k) {
+    const typename SrcCls::IndexType z = z0 + k;
+    for (int j = threadIdx.y; j < Tile::kSizeY; j += Tile::kBlockY) {
+      const typename SrcCls::IndexType y = y0 + j;
+      if (y < src.Height() && z < src.Depth()) {
+        const StencilAccessor3D<Scalar, Radius> neighborhood(
+            &tile[k + r][j + r][threadIdx.x + r], Tile::kTileX,
+            Tile::kTileX * Tile::kTileY);
+        dst.set(x, y, z, op(neighborhood, x, y, z));
+      }
+    }
+  }
+}
+
+}  // namespace kernel
+
+//------------------------------------------------------------------------------
+//
+// host implementations
+//
+//------------------------------------------------------------------------------
+
+namespace host {
+
+/**
+ * Host implementation of CudaArray2DBase::ApplyStencil(), e.g., for
+ * CudaHostArray2D objects. The tiles are the same as on the GPU: each task of
+ * the thread pool stages one tile, with its halo, and then calls op for every
+ * element of the tile.
+ * @param src source array
+ * @param dst destination array of the same size; this must not be src
+ * @param op `__host__` function mapping
+ *   `(const StencilAccessor2D<Scalar, Radius> &, x, y) -> dst Scalar`
+ * @param border handling of elements outside of src
+ */
+template <unsigned int Radius, typename SrcCls, typename DstCls,
+          class Function>
+inline void ApplyStencil2D(const SrcCls &src, DstCls &dst, Function op,
+                           ConvolutionBorder border) {
+  typedef typename SrcCls::Scalar Scalar;
+  typedef internal::StencilTile2D<Radius> Tile;
+  const int r = static_cast<int>(Radius);
+  internal::CheckStencilArrays2D(src, dst);
+  border = internal::ResolveConvolutionBorder(src, border);
+
+  const int w = src.Width(), h = src.Height();
+  const int num_tiles_x = (w + Tile::kSizeX - 1) / Tile::kSizeX;
+  const int num_tiles_y = (h + Tile::kSizeY - 1) / Tile::kSizeY;
+
+  internal::HostThreadPool::Instance().ParallelFor(
+      num_tiles_x * num_tiles_y, [&](size_t task) {
+        std::vector<Scalar> tile(Tile::kTileX * Tile::kTileY);
+        const int x0 = (task % num_tiles_x) * Tile::kSizeX;
+        const int y0 = (task / num_tiles_x) * Tile::kSizeY;
+        for (int j = 0; j < Tile::kTileY; ++j) {
+          const int y = internal::ConvolutionIndex(y0 - r + j, h, border);
+          internal::LoadStencilRow(src, x0 - r, y, Tile::kTileX, 0, 1, border,
+                                   &tile[j * Tile::kTileX]);
+        }
+
+        const int x1 = std::min(x0 + Tile::kSizeX, w);
+        const int y1 = std::min(y0 + Tile::kSizeY, h);
+        for (int y = y0; y < y1; ++y) {
+          for (int x = x0; x < x1; ++x) {
+            const StencilAccessor2D<Scalar, Radius> neighborhood(
+                &tile[(y - y0 + r) * Tile::kTileX + x - x0 + r], Tile::kTileX);
+            dst.set(x, y, op(neighborhood, x, y));
+          }
+        }
+      });
+}
+
+/**
+ * Host implementation of CudaArray3DBase::ApplyStencil(); see ApplyStencil2D().
+ * @param src source array
+ * @param dst destination array of the same size; this must not be src
+ * @param op `__host__` function mapping
+ *   `(const StencilAccessor3D<Scalar, Radius> &, x, y, z) -> dst Scalar`
+ * @param border handling of elements outside of src
+ */
+template <unsigned int Radius, typename SrcCls, typename DstCls,
+          class Function>
+inline void ApplyStencil3D(const SrcCls &src, DstCls &dst, Function op,
+                           ConvolutionBorder border) {
+  typedef typename SrcCls::Scalar Scalar;
+  typedef internal::StencilTile3D<Radius> Tile;
+  const int r = static_cast<int>(Radius);
+  internal::CheckStencilArrays3D(src, dst);
+  border = internal::ResolveConvolutionBorder(src, border);
+
+  const int w = src.Width(), h = src.Height(), d = src.Depth();
+  const int num_tiles_x = (w + Tile::kSizeX - 1) / Tile::kSizeX;
+  const int num_tiles_y = (h + Tile::kSizeY - 1) / Tile::kSizeY;
+  const int num_tiles_z = (d + Tile::kSizeZ - 1) / Tile::kSizeZ;
+  const int slice_pitch = Tile::kTileX * Tile::kTileY;
+
+  internal::HostThreadPool::Instance().ParallelFor(
+      num_tiles_x * num_tiles_y * num_tiles_z, [&](size_t task) {
+        std::vector<Scalar> tile(slice_pitch * Tile::kTileZ);
+        const int x0 = (task % num_tiles_x) * Tile::kSizeX;
+        const int y0 = (task / num_tiles_x % num_tiles_y) * Tile::kSizeY;
+        const int z0 = (task / num_tiles_x / num_tiles_y) * Tile::kSizeZ;
+        for (int k = 0; k < Tile::kTileZ; ++k) {
+          const int z = internal::ConvolutionIndex(z0 - r + k, d, border);
+          for (int j = 0; j < Tile::kTileY; ++j) {
+            const int y = internal::ConvolutionIndex(y0 - r + j, h, border);
+            internal::LoadStencilRow(src, x0 - r, y, z, Tile::kTileX, 0, 1,
+                                     border,
+                                     &tile[k * slice_pitch + j * Tile::kTileX]);
+          }
+        }
+
+        const int x1 = std::min(x0 + Tile::kSizeX, w);
+        const int y1 = std::min(y0 + Tile::kSizeY, h);
+        const int z1 = std::min(z0 + Tile::kSizeZ, d);
+        for (int z = z0; z < z1; ++z) {
+          for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+              const StencilAccessor3D<Scalar, Radius> neighborhood(
+                  &tile[(z - z0 + r) * slice_pitch +
+                        (y - y0 + r) * Tile::kTileX + x - x0 + r],
+                  Tile::kTileX, slice_pitch);
+              dst.set(x, y, z, op(neighborhood, x, y, z));
+            }
+          }
+        }
+      });
+}
+
+}  // namespace host
+
+//------------------------------------------------------------------------------
+//
+// device implementations
+//
+//------------------------------------------------------------------------------
+
+namespace internal {
+
+//
+// Queue a stencil operation on the given stream. The border policy must be
+// resolved.
+//
+template <unsigned int Radius, typename SrcCls, typename DstCls,
+          class Function>
+inline void ApplyStencil2D(const SrcCls &src, const DstCls &dst, Function op,
+                           const ConvolutionBorder border, int device,
+                           cudaStream_t stream) {
+  typedef StencilTile2D<Radius> Tile;
+  static_assert(sizeof(typename SrcCls::Scalar) * Tile::kTileX *
+                        Tile::kTileY <=
+                    kMaxStencilTileBytes,
+                "The stencil tile does not fit into shared memory; use a "
+                "smaller radius.");
+
+  SetDevice(device);
+  const dim3 block_dim(Tile::kBlockX, Tile::kBlockY);
+  const dim3 grid_dim((src.Width() + Tile::kSizeX - 1) / Tile::kSizeX,
+                      (src.Height() + Tile::kSizeY - 1) / Tile::kSizeY);
+  kernel::ApplyStencil2D<Radius><<<grid_dim, block_dim, 0, stream>>>(
+      src, dst, op, border);
+}
+
+template <unsigned int Radius, typename SrcCls, typename DstCls,
+          class Function>
+inline void ApplyStencil3D(const SrcCls &src, const DstCls &dst, Function op,
+                           const ConvolutionBorder border, int device,
+                           cudaStream_t stream) {
+  typedef StencilTile3D<Radius> Tile;
+  static_assert(sizeof(typename SrcCls::Scalar) * Tile::kTileX *
+                        Tile::kTileY * Tile::kTileZ <=
+                    kMaxStencilTileBytes,
+                "The stencil tile does not fit into shared memory; use a "
+                "smaller radius.");
+
+  SetDevice(device);
+  const dim3 block_dim(Tile::kBlockX, Tile::kBlockY);
+  const dim3 grid_dim((src.Width() + Tile::kSizeX - 1) / Tile::kSizeX,
+                      (src.Height() + Tile::kSizeY - 1) / Tile::kSizeY,
+                      (src.Depth() + Tile::kSizeZ - 1) / Tile::kSizeZ);
+  kernel::ApplyStencil3D<Radius><<<grid_dim, block_dim, 0, stream>>>(
+      src, dst, op, border);
+}
+
+}  // namespace internal
+
+}  // namespace cua
+
+#endif  // LIBCUA_STENCIL_H_
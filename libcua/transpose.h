@@ -0,0 +1,368 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_TRANSPOSE_H_
+#define LIBCUA_TRANSPOSE_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "cachingAllocator.h"
+#include "launchConfig.h"
+#include "util.h"
+
+//
+// In-place transposition of a densely stored, row-major m x n matrix, i.e., of
+// a buffer of m * n elements that afterwards holds the row-major n x m
+// transpose. Following B. Catanzaro, A. Keller, and M. Garland, "A
+// Decomposition for In-place Matrix Transposition," PPoPP 2014, the
+// permutation is split into steps that each only move elements within single
+// columns or within single rows, with c = gcd(m, n), a = m / c, and b = n / c:
+//
+//   1. if c > 1, rotate column j up by floor(j / b)
+//   2. move element j of row i to column ((i + floor(j / b)) mod m + j m) mod n
+//   3. rotate column j up by j
+//   4. replace row i with row (i n - floor(i / a)) mod m
+//
+// Column rotations follow the cycles of the rotation in place. So that the
+// threads of a warp access neighboring columns, each group of 32 columns is
+// first rotated by the amount of its first column, and the remaining (< 32)
+// difference is then shifted in with a sliding window in shared memory. Rows
+// are shuffled through one scratch row per block, and the row permutation of
+// step 4 follows its cycles in place, one column per thread.
+//
+
+namespace cua {
+
+namespace internal {
+
+//------------------------------------------------------------------------------
+//
+// in-place transposition helpers
+//
+//------------------------------------------------------------------------------
+
+// number of columns that are rotated together, and the number of rows in the
+// shared-memory window that shifts them
+static const unsigned int kTransposeInPlaceGroupSize = 32;
+
+// number of thread rows per block of the column kernels
+static const unsigned int kTransposeInPlaceBlockRows = 8;
+
+// number of threads per block of the row shuffle
+static const unsigned int kTransposeInPlaceRowBlockSize = 256;
+
+// row shuffle blocks per multiprocessor; each block needs a scratch row
+static const unsigned int kTransposeInPlaceRowBlocksPerMultiprocessor = 2;
+
+// largest static shared-memory allocation of a kernel
+static const size_t kMaxTransposeInPlaceSharedBytes = 48 * 1024;
+
+__host__ __device__ inline size_t GreatestCommonDivisor(size_t a, size_t b) {
+  while (b != 0) {
+    const size_t r = a % b;
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+// (i + k) mod m, for i, k < m
+__host__ __device__ inline size_t AddModulo(size_t i, size_t k, size_t m) {
+  return (i >= m - k) ? i - (m - k) : i + k;
+}
+
+// row of the m x n matrix that is moved into row i in step 4
+__host__ __device__ inline size_t TransposeInPlaceRowSource(size_t i, size_t m,
+                                                            size_t n,
+                                                            size_t a) {
+  return (i * n - i / a) % m;
+}
+
+}  // namespace internal
+
+//------------------------------------------------------------------------------
+//
+// kernel definitions
+//
+//------------------------------------------------------------------------------
+
+namespace kernel {
+
+//
+// Rotate each group of columns up by floor(j0 / divisor) rows, where j0 is the
+// first column of the group, by following the cycles of the rotation. The
+// rows of the block take turns over the cycles.
+//
+template <typename T>
+__global__ void TransposeInPlaceRotateColumns(T *data, const size_t m,
+                                              const size_t n,
+                                              const size_t divisor) {
+  const size_t j0 = blockIdx.x * internal::kTransposeInPlaceGroupSize;
+  const size_t j = j0 + threadIdx.x;
+  const size_t k = (j0 / divisor) % m;
+  if (j >= n || k == 0) {
+    return;
+  }
+
+  const size_t num_cycles = internal::GreatestCommonDivisor(k, m);
+  for (size_t t = threadIdx.y; t < num_cycles; t += blockDim.y) {
+    const T first = data[t * n + j];
+    size_t i = t;
+    for (size_t next = internal::AddModulo(t, k, m); next != t;
+         next = internal::AddModulo(next, k, m)) {
+      data[i * n + j] = data[next * n + j];
+      i = next;
+    }
+    data[i * n + j] = first;
+  }
+}
+
+//
+// Rotate column j of each group of columns up by floor(j / divisor) -
+// floor(j0 / divisor) < 32 rows, i.e., finish the rotation started by
+// TransposeInPlaceRotateColumns. The block slides a window of two tiles down
+// the columns; the first tile is kept for the rows that wrap around.
+//
+template <typename T>
+__global__ void TransposeInPlaceShiftColumns(T *data, const size_t m,
+                                             const size_t n,
+                                             const size_t divisor) {
+  const unsigned int kGroupSize = internal::kTransposeInPlaceGroupSize;
+  __shared__ T head[kGroupSize][kGroupSize];
+  __shared__ T window[2][kGroupSize][kGroupSize];
+
+  const size_t j0 = blockIdx.x * kGroupSize;
+  const size_t j = j0 + threadIdx.x;
+  const size_t last = (j0 + kGroupSize < n) ? j0 + kGroupSize - 1 : n - 1;
+  if (last / divisor == j0 / divisor) {
+    return;  // nothing left to shift in this group
+  }
+  const bool valid = (j < n);
+  const size_t shift = valid ? (j / divisor - j0 / divisor) % m : 0;
+
+  for (unsigned int y = threadIdx.y; y < kGroupSize && y < m;
+       y += blockDim.y) {
+    if (valid) {
+      head[y][threadIdx.x] = window[0][y][threadIdx.x] = data[y * n + j];
+    }
+  }
+
+  unsigned int current = 0;
+  for (size_t i0 = 0; i0 < m; i0 += kGroupSize) {
+    for (unsigned int y = threadIdx.y; y < kGroupSize; y += blockDim.y) {
+      const size_t i = i0 + kGroupSize + y;
+      if (valid && i < m) {
+        window[current ^ 1][y][threadIdx.x] = data[i * n + j];
+      }
+    }
+
+    __syncthreads();
+
+    for (unsigned int y = threadIdx.y; y < kGroupSize; y += blockDim.y) {
+      const size_t i = i0 + y;
+      if (valid && i < m) {
+        const size_t source = i + shift;
+        if (source >= m) {
+          data[i * n + j] = head[source - m][threadIdx.x];
+        } else if (source < i0 + kGroupSize) {
+          data[i * n + j] = window[current][source - i0][threadIdx.x];
+        } else {
+          data[i * n + j] =
+              window[current ^ 1][source - i0 - kGroupSize][threadIdx.x];
+        }
+      }
+    }
+
+    __syncthreads();
+
+    current ^= 1;
+  }
+}
+
+//
+// Move element j of row i to column ((i + floor(j / b)) mod m + j m) mod n.
+// Each block scatters its rows into its own scratch row and copies them back.
+//
+template <typename T>
+__global__ void TransposeInPlaceShuffleRows(T *data, T *scratch,
+                                            const size_t m, const size_t n,
+                                            const size_t b) {
+  T *scratch_row = scratch + blockIdx.x * n;
+  for (size_t i = blockIdx.x; i < m; i += gridDim.x) {
+    T *row = data + i * n;
+    for (size_t j = threadIdx.x; j < n; j += blockDim.x) {
+      scratch_row[((i + j / b) % m + j * m) % n] = row[j];
+    }
+
+    __syncthreads();
+
+    for (size_t j = threadIdx.x; j < n; j += blockDim.x) {
+      row[j] = scratch_row[j];
+    }
+
+    __syncthreads();
+  }
+}
+
+//
+// Replace each row i with row TransposeInPlaceRowSource(i) by following the
+// cycles of the permutation, which are given by one of their rows.
+//
+template <typename T>
+__global__ void TransposeInPlacePermuteRows(T *data, const size_t *cycles,
+                                            const size_t num_cycles,
+                                            const size_t m, const size_t n,
+                                            const size_t a) {
+  const size_t j = blockIdx.x * blockDim.x + threadIdx.x;
+  if (j >= n) {
+    return;
+  }
+
+  for (size_t c = blockIdx.y * blockDim.y + threadIdx.y; c < num_cycles;
+       c += gridDim.y * blockDim.y) {
+    const size_t start = cycles[c];
+    const T first = data[start * n + j];
+    size_t i = start;
+    for (size_t next = internal::TransposeInPlaceRowSource(start, m, n, a);
+         next != start;
+         next = internal::TransposeInPlaceRowSource(next, m, n, a)) {
+      data[i * n + j] = data[next * n + j];
+      i = next;
+    }
+    data[i * n + j] = first;
+  }
+}
+
+}  // namespace kernel
+
+//------------------------------------------------------------------------------
+//
+// device implementation
+//
+//------------------------------------------------------------------------------
+
+namespace internal {
+
+//
+// Transpose the row-major num_rows x num_cols matrix stored densely at data in
+// place, on the given stream. Besides a few scratch rows, no memory is needed.
+//
+template <typename T>
+inline void TransposeInPlace(T *data, size_t num_rows, size_t num_cols,
+                             int device, cudaStream_t stream) {
+  // TransposeInPlaceShiftColumns keeps three tiles in shared memory
+  static_assert(3 * sizeof(T) * kTransposeInPlaceGroupSize *
+                        kTransposeInPlaceGroupSize <=
+                    kMaxTransposeInPlaceSharedBytes,
+                "The element type is too large for the shared-memory window "
+                "of the in-place transposition.");
+
+  const size_t m = num_rows, n = num_cols;
+  const size_t c = GreatestCommonDivisor(m, n);
+  const size_t a = m / c, b = n / c;
+
+  // the non-trivial cycles of the row permutation, each given by its first row
+  std::vector<size_t> cycles;
+  std::vector<bool> visited(m, false);
+  for (size_t i = 0; i < m; ++i) {
+    if (visited[i]) {
+      continue;
+    }
+    visited[i] = true;
+    size_t next = TransposeInPlaceRowSource(i, m, n, a);
+    if (next != i) {
+      cycles.push_back(i);
+      for (; next != i; next = TransposeInPlaceRowSource(next, m, n, a)) {
+        visited[next] = true;
+      }
+    }
+  }
+
+  SetDevice(device);
+  const unsigned int num_row_blocks = static_cast<unsigned int>(
+      std::min<size_t>(m, kTransposeInPlaceRowBlocksPerMultiprocessor *
+                              NumMultiprocessors(device)));
+
+  CachingAllocator<> &allocator = CachingAllocator<>::Instance();
+  T *scratch_rows = static_cast<T *>(
+      allocator.Allocate(num_row_blocks * n * sizeof(T), device, stream));
+  size_t *device_cycles = nullptr;
+  if (!cycles.empty()) {
+    device_cycles = static_cast<size_t *>(
+        allocator.Allocate(cycles.size() * sizeof(size_t), device, stream));
+    cudaMemcpyAsync(device_cycles, cycles.data(),
+                    cycles.size() * sizeof(size_t), cudaMemcpyHostToDevice,
+                    stream);
+  }
+
+  const dim3 block_dim(kTransposeInPlaceGroupSize, kTransposeInPlaceBlockRows);
+  const dim3 grid_dim(static_cast<unsigned int>(
+      (n + kTransposeInPlaceGroupSize - 1) / kTransposeInPlaceGroupSize));
+
+  if (c > 1) {
+    kernel::TransposeInPlaceRotateColumns<<<grid_dim, block_dim, 0, stream>>>(
+        data, m, n, b);
+    kernel::TransposeInPlaceShiftColumns<<<grid_dim, block_dim, 0, stream>>>(
+        data, m, n, b);
+  }
+  kernel::TransposeInPlaceShuffleRows<<<num_row_blocks,
+                                        kTransposeInPlaceRowBlockSize, 0,
+                                        stream>>>(data, scratch_rows, m, n, b);
+  kernel::TransposeInPlaceRotateColumns<<<grid_dim, block_dim, 0, stream>>>(
+      data, m, n, 1);
+  kernel::TransposeInPlaceShiftColumns<<<grid_dim, block_dim, 0, stream>>>(
+      data, m, n, 1);
+  if (!cycles.empty()) {
+    const dim3 cycle_grid_dim(
+        grid_dim.x,
+        static_cast<unsigned int>(std::min<size_t>(
+            (cycles.size() + kTransposeInPlaceBlockRows - 1) /
+                kTransposeInPlaceBlockRows,
+            65535)));
+    kernel::TransposeInPlacePermuteRows<<<cycle_grid_dim, block_dim, 0,
+                                          stream>>>(
+        data, device_cycles, cycles.size(), m, n, a);
+  }
+
+  allocator.Free(scratch_rows);
+  allocator.Free(device_cycles);
+}
+
+}  // namespace internal
+
+}  // namespace cua
+
+#endif  // LIBCUA_TRANSPOSE_H_
@@ -36,6 +36,34 @@
 #ifndef LIBCUA_TYPES_H_
 #define LIBCUA_TYPES_H_
 
+#include <cstddef>
+#include <limits>
+
+//
+// Array dimensions and coordinates are 32-bit by default. Element counts
+// (Size()) and byte offsets are always computed in 64 bits, so an array may
+// hold more than 2^32 elements in total as long as each of its dimensions, and
+// the number of rows (height * depth) of a 3D array, fits in 32 bits. Define
+// LIBCUA_ENABLE_64BIT_INDEXING before including any libcua header to make the
+// size and index types of all array classes 64-bit.
+//
+// Kernels that index elements linearly (e.g., reductions) choose between
+// 32-bit and 64-bit indices at launch time based on the actual array size, so
+// small arrays keep 32-bit index arithmetic in either mode.
+//
+
+#ifdef LIBCUA_ENABLE_64BIT_INDEXING
+
+#ifndef LIBCUA_DEFAULT_SIZE_TYPE
+#define LIBCUA_DEFAULT_SIZE_TYPE unsigned long long
+#endif  // LIBCUA_DEFAULT_SIZE_TYPE
+
+#ifndef LIBCUA_DEFAULT_INDEX_TYPE
+#define LIBCUA_DEFAULT_INDEX_TYPE unsigned long long
+#endif  // LIBCUA_DEFAULT_INDEX_TYPE
+
+#endif  // LIBCUA_ENABLE_64BIT_INDEXING
+
 #ifndef LIBCUA_DEFAULT_SIZE_TYPE
 #define LIBCUA_DEFAULT_SIZE_TYPE unsigned int
 #endif  // LIBCUA_DEFAULT_SIZE_TYPE
@@ -44,4 +72,86 @@
 #define LIBCUA_DEFAULT_INDEX_TYPE unsigned int
 #endif  // LIBCUA_DEFAULT_INDEX_TYPE
 
+namespace cua {
+
+/**
+ * Kind of memory backing a host array (see CudaHostArray2D/CudaHostArray3D).
+ * Page-locked memory requires a CUDA driver but allows for faster transfers to
+ * and from the GPU; pageable memory works on machines without a GPU.
+ */
+enum class HostMemoryType { kPageable, kPinned };
+
+/**
+ * Reordering of the axes of a 3D array (see CudaArray3DBase::Permute). Each
+ * name lists the axes of the source array that become the x, y, and z axes of
+ * the result. For example, kZXY moves element (x, y, z) to (z, x, y), so that a
+ * width x height x depth array becomes a depth x width x height array.
+ */
+enum class AxisPermutation { kXYZ, kXZY, kYXZ, kYZX, kZXY, kZYX };
+
+/**
+ * Axis of a 3D array, e.g., the axis of a rotation (see
+ * CudaArray3DBase::Rot90_CW).
+ */
+enum class Axis { kX, kY, kZ };
+
+namespace internal {
+
+/**
+ * @return true if linear indices [0, num_elements) do not all fit in 32 bits
+ */
+inline bool Needs64BitIndexing(size_t num_elements) {
+  return num_elements > std::numeric_limits<unsigned int>::max();
+}
+
+/**
+ * @param permutation reordering of the axes of a 3D array
+ * @param axis axis of the permuted array (0 = x, 1 = y, 2 = z)
+ * @return the axis of the source array that becomes the given axis
+ */
+inline int PermutedAxis(AxisPermutation permutation, int axis) {
+  static const int kAxes[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2},
+                                  {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+  return kAxes[static_cast<int>(permutation)][axis];
+}
+
+// Flips of the axes of a 3D array, as a bit mask. A rotation about an axis
+// swaps the other two axes and then flips one of them.
+static const int kFlipX = 1;
+static const int kFlipY = 2;
+static const int kFlipZ = 4;
+
+/**
+ * @return the axis permutation of a 90-degree rotation about the given axis
+ */
+inline AxisPermutation Rot90Permutation(Axis axis) {
+  static const AxisPermutation kPermutations[3] = {
+      AxisPermutation::kXZY, AxisPermutation::kZYX, AxisPermutation::kYXZ};
+  return kPermutations[static_cast<int>(axis)];
+}
+
+/**
+ * 90-degree rotations about each axis turn the plane of the other two axes,
+ * taken in cyclic order (y-z, z-x, x-y), like the 2D rotations turn the x-y
+ * plane of an image. For example, a clockwise rotation about z maps (x, y, z)
+ * to (height - 1 - y, x, z).
+ * @return the flips (see kFlipX) that follow Rot90Permutation(axis)
+ */
+inline int Rot90Flips(Axis axis, bool clockwise) {
+  static const int kFlips[3][2] = {
+      {kFlipZ, kFlipY}, {kFlipX, kFlipZ}, {kFlipY, kFlipX}};
+  return kFlips[static_cast<int>(axis)][clockwise ? 1 : 0];
+}
+
+/**
+ * @return the flips (see kFlipX) of a 180-degree rotation about the given axis
+ */
+inline int Rot180Flips(Axis axis) {
+  return (kFlipX | kFlipY | kFlipZ) & ~(1 << static_cast<int>(axis));
+}
+
+}  // namespace internal
+
+}  // namespace cua
+
 #endif  // LIBCUA_TYPES_H_
@@ -39,12 +39,65 @@
 #include <string>
 #include <type_traits>
 
+#include "types.h"
+
+// Generic __host__ __device__ wrappers (e.g., array expressions) may call get()
+// on arrays whose accessors are __device__-only. Placed before such a function
+// template, this silences nvcc's warnings for the combinations that are never
+// actually called.
+#ifdef __CUDACC__
+#define LIBCUA_EXEC_CHECK_DISABLE _Pragma("nv_exec_check_disable")
+#else
+#define LIBCUA_EXEC_CHECK_DISABLE
+#endif
+
 namespace cua {
 
+template <typename Derived>
+struct CudaArrayTraits;  // forward declaration
+
 namespace internal {
 
 //------------------------------------------------------------------------------
 
+// Maps any well-formed type to void; used for detecting optional typedefs.
+template <typename T>
+struct VoidType {
+  typedef void type;
+};
+
+// Inherits from std::true_type if the CudaArrayTraits of the given array type
+// declare `typedef std::true_type IsHost`, i.e., if the array lives in host
+// memory and its operations are run on the CPU rather than on the GPU.
+template <typename Derived, typename Enable = void>
+struct IsHostArray : std::false_type {};
+
+template <typename Derived>
+struct IsHostArray<Derived, typename VoidType<typename CudaArrayTraits<
+                                Derived>::IsHost>::type>
+    : CudaArrayTraits<Derived>::IsHost {};
+
+// DeviceViewOf<Derived>::type is the type passed to kernels in place of an
+// array: the device view named by `typedef ... DeviceView` in the array's
+// CudaArrayTraits (see deviceView.h), or the array type itself if there is no
+// such typedef. Get() returns the corresponding kernel argument.
+template <typename Derived, typename Enable = void>
+struct DeviceViewOf {
+  typedef Derived type;
+
+  static inline const Derived &Get(const Derived &array) { return array; }
+};
+
+template <typename Derived>
+struct DeviceViewOf<Derived, typename VoidType<typename CudaArrayTraits<
+                                 Derived>::DeviceView>::type> {
+  typedef typename CudaArrayTraits<Derived>::DeviceView type;
+
+  static inline type Get(const Derived &array) { return array.DeviceView(); }
+};
+
+//------------------------------------------------------------------------------
+
 // Return either the input argument, if it is not -1, or the current GPU.
 inline int GetDevice(int device = -1) {
   if (device == -1) {
@@ -137,6 +190,22 @@ inline void CheckFlippedSizeEqual2D(const T1 &array1, const T2 &array2) {
 #endif
 }
 
+template <typename T1, typename T2>
+inline void CheckPermutedSizeEqual3D(const T1 &array1, const T2 &array2,
+                                     AxisPermutation permutation) {
+  CheckCompatibleTypes(array1, array2);
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  const size_t sizes[3] = {array1.Width(), array1.Height(), array1.Depth()};
+  if (array2.Width() != sizes[PermutedAxis(permutation, 0)] ||
+      array2.Height() != sizes[PermutedAxis(permutation, 1)] ||
+      array2.Depth() != sizes[PermutedAxis(permutation, 2)]) {
+    throw std::runtime_error("Arrays have incompatible sizes (" +
+                             ArraySizeToString3D(array1) + " vs " +
+                             ArraySizeToString3D(array2) + ").");
+  }
+#endif
+}
+
 template <typename T1, typename T2>
 inline void CheckSizeEqual3D(const T1 &array1, const T2 &array2) {
   CheckCompatibleTypes(array1, array2);
@@ -0,0 +1,519 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LIBCUA_ZIP_H_
+#define LIBCUA_ZIP_H_
+
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+
+#include "hostThreadPool.h"
+#include "instrumentation.h"
+#include "launchConfig.h"
+#include "types.h"
+#include "util.h"
+
+namespace cua {
+
+template <typename Derived>
+class CudaArray3DBase;  // forward declaration
+
+namespace internal {
+
+//------------------------------------------------------------------------------
+//
+// type traits and helpers
+//
+//------------------------------------------------------------------------------
+
+// Compile-time sequence of indices 0, ..., N - 1 (std::index_sequence is only
+// available in C++14).
+template <size_t... I>
+struct IndexSequence {};
+
+template <size_t N, size_t... I>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...> {};
+
+template <size_t... I>
+struct MakeIndexSequence<0, I...> {
+  typedef IndexSequence<I...> type;
+};
+
+// True for arrays derived from CudaArray3DBase.
+template <typename T>
+struct IsArray3D : std::is_base_of<CudaArray3DBase<T>, T> {};
+
+// True if the CudaArrayTraits of the given array type declare `Mutable`.
+template <typename T, typename Enable = void>
+struct IsMutableArray : std::false_type {};
+
+template <typename T>
+struct IsMutableArray<
+    T, typename VoidType<typename CudaArrayTraits<T>::Mutable>::type>
+    : std::true_type {};
+
+// Total size, in bytes, of one element of each of the given arrays.
+template <typename... Arrays>
+struct ZipElementBytes;
+
+template <>
+struct ZipElementBytes<> : std::integral_constant<size_t, 0> {};
+
+template <typename First, typename... Rest>
+struct ZipElementBytes<First, Rest...>
+    : std::integral_constant<
+          size_t, sizeof(typename CudaArrayTraits<First>::Scalar) +
+                      ZipElementBytes<Rest...>::value> {};
+
+//------------------------------------------------------------------------------
+
+/**
+ * Minimal tuple that can be passed to, and used in, kernels.
+ */
+template <typename... T>
+struct ZipPack;
+
+template <>
+struct ZipPack<> {};
+
+template <typename First, typename... Rest>
+struct ZipPack<First, Rest...> {
+  __host__ __device__ ZipPack() {}
+
+  __host__ __device__ explicit ZipPack(const First &first_,
+                                       const Rest &... rest_)
+      : first(first_), rest(rest_...) {}
+
+  First first;
+  ZipPack<Rest...> rest;
+};
+
+template <size_t I, typename Pack>
+struct ZipPackElement;
+
+template <typename First, typename... Rest>
+struct ZipPackElement<0, ZipPack<First, Rest...>> {
+  typedef First type;
+
+  __host__ __device__ static inline type &Get(ZipPack<First, Rest...> &pack) {
+    return pack.first;
+  }
+};
+
+template <size_t I, typename First, typename... Rest>
+struct ZipPackElement<I, ZipPack<First, Rest...>> {
+  typedef ZipPackElement<I - 1, ZipPack<Rest...>> Next;
+  typedef typename Next::type type;
+
+  __host__ __device__ static inline type &Get(ZipPack<First, Rest...> &pack) {
+    return Next::Get(pack.rest);
+  }
+};
+
+template <size_t I, typename Pack>
+__host__ __device__ inline typename ZipPackElement<I, Pack>::type &ZipGet(
+    Pack &pack) {
+  return ZipPackElement<I, Pack>::Get(pack);
+}
+
+//------------------------------------------------------------------------------
+
+/**
+ * Element function for the single-output form of Zip():
+ * `output(x, y[, z]) = op(inputs(x, y[, z])...)`.
+ */
+template <class Function, typename OutputView, typename... InputViews>
+class ZipMapOp {
+ public:
+  ZipMapOp(Function op, const OutputView &output,
+           const InputViews &... inputs)
+      : op_(op), output_(output), inputs_(inputs...) {}
+
+  LIBCUA_EXEC_CHECK_DISABLE
+  template <typename... Index>
+  __host__ __device__ inline void operator()(Index... index) {
+    Apply_(typename MakeIndexSequence<sizeof...(InputViews)>::type(),
+           index...);
+  }
+
+ private:
+  LIBCUA_EXEC_CHECK_DISABLE
+  template <size_t... I, typename... Index>
+  __host__ __device__ inline void Apply_(IndexSequence<I...>,
+                                         Index... index) {
+    output_.set(index..., op_(ZipGet<I>(inputs_).get(index...)...));
+  }
+
+  Function op_;
+  OutputView output_;
+  ZipPack<InputViews...> inputs_;
+};
+
+/**
+ * Element function for the multi-output form of Zip(): calls
+ * `op(inputs(x, y[, z])..., values...)`, where `values` are references to one
+ * value per output, and then stores each value in its output.
+ */
+template <class Function, typename OutputPack, typename InputPack>
+class ZipOp;
+
+template <class Function, typename... OutputViews, typename... InputViews>
+class ZipOp<Function, ZipPack<OutputViews...>, ZipPack<InputViews...>> {
+ public:
+  ZipOp(Function op, const ZipPack<OutputViews...> &outputs,
+        const ZipPack<InputViews...> &inputs)
+      : op_(op), outputs_(outputs), inputs_(inputs) {}
+
+  LIBCUA_EXEC_CHECK_DISABLE
+  template <typename... Index>
+  __host__ __device__ inline void operator()(Index... index) {
+    Apply_(typename MakeIndexSequence<sizeof...(InputViews)>::type(),
+           typename MakeIndexSequence<sizeof...(OutputViews)>::type(),
+           index...);
+  }
+
+ private:
+  LIBCUA_EXEC_CHECK_DISABLE
+  template <size_t... I, size_t... O, typename... Index>
+  __host__ __device__ inline void Apply_(IndexSequence<I...>,
+                                         IndexSequence<O...>,
+                                         Index... index) {
+    ZipPack<typename OutputViews::Scalar...> values;
+    op_(ZipGet<I>(inputs_).get(index...)..., ZipGet<O>(values)...);
+    const int unused[] = {
+        (ZipGet<O>(outputs_).set(index..., ZipGet<O>(values)), 0)...};
+    (void)unused;
+  }
+
+  Function op_;
+  ZipPack<OutputViews...> outputs_;
+  ZipPack<InputViews...> inputs_;
+};
+
+//------------------------------------------------------------------------------
+
+// Unlike CheckSizeEqual2D/3D, the operands of Zip() may have different scalar
+// types.
+template <typename T1, typename T2>
+inline void CheckZipOperand(const T1 &output, const T2 &operand,
+                            std::false_type) {
+  CheckSameDevice(output, operand);
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (output.Width() != operand.Width() ||
+      output.Height() != operand.Height()) {
+    throw std::runtime_error("Arrays have different sizes (" +
+                             ArraySizeToString2D(output) + " vs " +
+                             ArraySizeToString2D(operand) + ").");
+  }
+#endif
+}
+
+template <typename T1, typename T2>
+inline void CheckZipOperand(const T1 &output, const T2 &operand,
+                            std::true_type) {
+  CheckSameDevice(output, operand);
+#ifndef LIBCUA_IGNORE_RUNTIME_EXCEPTIONS
+  if (output.Width() != operand.Width() ||
+      output.Height() != operand.Height() ||
+      output.Depth() != operand.Depth()) {
+    throw std::runtime_error("Arrays have different sizes (" +
+                             ArraySizeToString3D(output) + " vs " +
+                             ArraySizeToString3D(operand) + ").");
+  }
+#endif
+}
+
+template <typename OutputArray>
+inline void CheckZipOperands(const OutputArray &) {}
+
+template <typename OutputArray, typename First, typename... Rest>
+inline void CheckZipOperands(const OutputArray &output, const First &first,
+                             const Rest &... rest) {
+  static_assert(IsArray3D<First>::value == IsArray3D<OutputArray>::value,
+                "Zip() cannot mix 2D and 3D arrays.");
+  static_assert(IsHostArray<First>::value == IsHostArray<OutputArray>::value,
+                "Zip() cannot mix host and device arrays.");
+  CheckZipOperand(output, first, IsArray3D<OutputArray>());
+  CheckZipOperands(output, rest...);
+}
+
+template <typename... Outputs>
+struct CheckZipOutputsMutable;
+
+template <>
+struct CheckZipOutputsMutable<> : std::true_type {};
+
+template <typename First, typename... Rest>
+struct CheckZipOutputsMutable<First, Rest...>
+    : std::integral_constant<bool, IsMutableArray<First>::value &&
+                                       CheckZipOutputsMutable<Rest...>::value> {
+};
+
+}  // namespace internal
+
+//------------------------------------------------------------------------------
+//
+// kernel definitions
+//
+//------------------------------------------------------------------------------
+
+namespace kernel {
+
+//
+// f(x, y) for all elements; f reads the inputs and writes the outputs
+//
+template <class ZipFunction, typename SizeType>
+__global__ void Zip2D(ZipFunction f, const SizeType width,
+                      const SizeType height) {
+  typedef LIBCUA_DEFAULT_INDEX_TYPE IndexType;
+
+  for (IndexType y = blockIdx.y * blockDim.y + threadIdx.y; y < height;
+       y += gridDim.y * blockDim.y) {
+    for (IndexType x = blockIdx.x * blockDim.x + threadIdx.x; x < width;
+         x += gridDim.x * blockDim.x) {
+      f(x, y);
+    }
+  }
+}
+
+//
+// f(x, y, z) for all elements
+//
+template <class ZipFunction, typename SizeType>
+__global__ void Zip3D(ZipFunction f, const SizeType width,
+                      const SizeType height, const SizeType depth) {
+  typedef LIBCUA_DEFAULT_INDEX_TYPE IndexType;
+
+  for (IndexType z = blockIdx.z * blockDim.z + threadIdx.z; z < depth;
+       z += gridDim.z * blockDim.z) {
+    for (IndexType y = blockIdx.y * blockDim.y + threadIdx.y; y < height;
+         y += gridDim.y * blockDim.y) {
+      for (IndexType x = blockIdx.x * blockDim.x + threadIdx.x; x < width;
+           x += gridDim.x * blockDim.x) {
+        f(x, y, z);
+      }
+    }
+  }
+}
+
+}  // namespace kernel
+
+//------------------------------------------------------------------------------
+//
+// host implementations
+//
+//------------------------------------------------------------------------------
+
+namespace host {
+
+template <class ZipFunction>
+inline void Zip2D(ZipFunction f, const size_t width, const size_t height) {
+  internal::ParallelForRows(height, width, [&](size_t y0, size_t y1) {
+    for (size_t y = y0; y < y1; ++y) {
+      for (size_t x = 0; x < width; ++x) {
+        f(x, y);
+      }
+    }
+  });
+}
+
+template <class ZipFunction>
+inline void Zip3D(ZipFunction f, const size_t width, const size_t height,
+                  const size_t depth) {
+  internal::ParallelForRows(height * depth, width, [&](size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; ++i) {
+      const size_t y = i % height, z = i / height;
+      for (size_t x = 0; x < width; ++x) {
+        f(x, y, z);
+      }
+    }
+  });
+}
+
+}  // namespace host
+
+//------------------------------------------------------------------------------
+//
+// device implementations
+//
+//------------------------------------------------------------------------------
+
+namespace internal {
+
+//
+// Run an element function of Zip() over all elements of the given output
+// array, using its device, stream, block dimensions, and launch mode.
+//
+template <class ZipFunction, typename OutputArray>
+inline void RunZip(ZipFunction f, const OutputArray &output, std::false_type,
+                   std::false_type) {
+  typedef typename OutputArray::SizeType SizeType;
+  const dim3 block_dim = output.BlockDim();
+  const dim3 num_tiles((output.Width() + block_dim.x - 1) / block_dim.x,
+                       (output.Height() + block_dim.y - 1) / block_dim.y);
+  const dim3 grid_dim =
+      GridStrideGridDim(kernel::Zip2D<ZipFunction, SizeType>, num_tiles,
+                        block_dim, 0, output.Device(), output.GetLaunchMode());
+
+  SetDevice(output.Device());
+  kernel::Zip2D<<<grid_dim, block_dim, 0, output.Stream()>>>(
+      f, output.Width(), output.Height());
+}
+
+template <class ZipFunction, typename OutputArray>
+inline void RunZip(ZipFunction f, const OutputArray &output, std::true_type,
+                   std::false_type) {
+  typedef typename OutputArray::SizeType SizeType;
+  const dim3 block_dim = output.BlockDim();
+  const dim3 num_tiles((output.Width() + block_dim.x - 1) / block_dim.x,
+                       (output.Height() + block_dim.y - 1) / block_dim.y,
+                       (output.Depth() + block_dim.z - 1) / block_dim.z);
+  const dim3 grid_dim =
+      GridStrideGridDim(kernel::Zip3D<ZipFunction, SizeType>, num_tiles,
+                        block_dim, 0, output.Device(), output.GetLaunchMode());
+
+  SetDevice(output.Device());
+  kernel::Zip3D<<<grid_dim, block_dim, 0, output.Stream()>>>(
+      f, output.Width(), output.Height(), output.Depth());
+}
+
+template <class ZipFunction, typename OutputArray>
+inline void RunZip(ZipFunction f, const OutputArray &output, std::false_type,
+                   std::true_type) {
+  host::Zip2D(f, output.Width(), output.Height());
+}
+
+template <class ZipFunction, typename OutputArray>
+inline void RunZip(ZipFunction f, const OutputArray &output, std::true_type,
+                   std::true_type) {
+  host::Zip3D(f, output.Width(), output.Height(), output.Depth());
+}
+
+//------------------------------------------------------------------------------
+
+//
+// Single-output Zip(); see CudaArray2DBase::Zip().
+//
+template <class Function, typename OutputArray, typename... Inputs>
+inline void ZipInto(Function op, const OutputArray &output,
+                    const Inputs &... inputs) {
+  CheckZipOperands(output, inputs...);
+
+  RunZip(ZipMapOp<Function, typename DeviceViewOf<OutputArray>::type,
+                  typename DeviceViewOf<Inputs>::type...>(
+             op, DeviceViewOf<OutputArray>::Get(output),
+             DeviceViewOf<Inputs>::Get(inputs)...),
+         output, IsArray3D<OutputArray>(), IsHostArray<OutputArray>());
+}
+
+//
+// Multi-output Zip(); see cua::Zip().
+//
+template <class Function, typename... Outputs, size_t... O,
+          typename... Inputs>
+inline void ZipInto(Function op, const std::tuple<Outputs &...> &outputs,
+                    IndexSequence<O...>, const Inputs &... inputs) {
+  typedef typename std::tuple_element<0, std::tuple<Outputs...>>::type
+      FirstOutput;
+  static_assert(CheckZipOutputsMutable<Outputs...>::value,
+                "The outputs of Zip() must be writable.");
+
+  const FirstOutput &first = std::get<0>(outputs);
+  CheckZipOperands(first, std::get<O>(outputs)..., inputs...);
+
+  LIBCUA_INSTRUMENT(
+      "Zip", first.Size() * (ZipElementBytes<Outputs..., Inputs...>::value),
+      first.Device(), first.Stream(), IsHostArray<FirstOutput>::value);
+
+  typedef ZipPack<typename DeviceViewOf<Outputs>::type...> OutputPack;
+  typedef ZipPack<typename DeviceViewOf<Inputs>::type...> InputPack;
+  const OutputPack output_views(
+      DeviceViewOf<Outputs>::Get(std::get<O>(outputs))...);
+  const InputPack input_views(DeviceViewOf<Inputs>::Get(inputs)...);
+  RunZip(ZipOp<Function, OutputPack, InputPack>(op, output_views, input_views),
+         first, IsArray3D<FirstOutput>(), IsHostArray<FirstOutput>());
+}
+
+}  // namespace internal
+
+//------------------------------------------------------------------------------
+//
+// public API
+//
+//------------------------------------------------------------------------------
+
+/**
+ * Compute several output arrays from several input arrays in a single pass.
+ * For every element, `op` receives the values of all inputs, followed by
+ * references to one value per output, which it must set:
+ *
+ *     // CudaArray2D<float> a; CudaTexture2D<float2> b; CudaSurface2D<uchar4> c
+ *     // CudaArray2D<float> magnitude, angle
+ *     cua::Zip(
+ *         [] __device__(float a, float2 b, uchar4 c, float &mag, float &ang) {
+ *           mag = a * hypotf(b.x, b.y);
+ *           ang = atan2f(b.y, b.x) + c.w;
+ *         },
+ *         std::tie(magnitude, angle), a, b, c);
+ *
+ * The inputs can be any mix of array kinds and scalar types, and an array may
+ * appear both as an input and as an output. Sizes and devices are checked
+ * once, against the first output, before the launch; the kernel then reads
+ * every input element and writes every output element exactly once. The
+ * launch uses the stream, block dimensions, and launch mode of the first
+ * output. Host arrays are processed on the CPU thread pool instead, in which
+ * case `op` must be callable on the host.
+ *
+ * For a single output, CudaArray2DBase::Zip() and CudaArray3DBase::Zip() take
+ * a function that returns the output value instead.
+ *
+ * @param op `__device__` function `(inputs..., outputs &...) -> void`
+ * @param outputs the output arrays, e.g. `std::tie(out1, out2)`
+ * @param inputs the input arrays
+ */
+template <class Function, typename... Outputs, typename... Inputs>
+inline void Zip(Function op, const std::tuple<Outputs &...> &outputs,
+                const Inputs &... inputs) {
+  static_assert(sizeof...(Outputs) > 0, "Zip() needs at least one output.");
+  internal::ZipInto(
+      op, outputs,
+      typename internal::MakeIndexSequence<sizeof...(Outputs)>::type(),
+      inputs...);
+}
+
+}  // namespace cua
+
+#endif  // LIBCUA_ZIP_H_
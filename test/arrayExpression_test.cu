@@ -0,0 +1,198 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cudaArray2D.h"
+#include "cudaArray3D.h"
+#include "cudaHostArray2D.h"
+#include "cudaHostArray3D.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "util.h"
+
+namespace {
+
+//------------------------------------------------------------------------------
+
+template <typename ArrayType, typename HostFunction>
+void Check2D(const ArrayType &array, const HostFunction &host_function) {
+  CUDA_CHECK_ERROR
+  std::vector<float> result(array.Size());
+  array.CopyTo(result.data());
+  CUDA_CHECK_ERROR
+  for (size_t y = 0; y < array.Height(); ++y) {
+    for (size_t x = 0; x < array.Width(); ++x) {
+      EXPECT_FLOAT_EQ(result[y * array.Width() + x], host_function(x, y))
+          << "Coordinate: " << x << " " << y;
+    }
+  }
+}
+
+template <typename ArrayType, typename HostFunction>
+void Check3D(const ArrayType &array, const HostFunction &host_function) {
+  CUDA_CHECK_ERROR
+  std::vector<float> result(array.Size());
+  array.CopyTo(result.data());
+  CUDA_CHECK_ERROR
+  for (size_t z = 0; z < array.Depth(); ++z) {
+    for (size_t y = 0; y < array.Height(); ++y) {
+      for (size_t x = 0; x < array.Width(); ++x) {
+        const size_t i = (z * array.Height() + y) * array.Width() + x;
+        EXPECT_FLOAT_EQ(result[i], host_function(x, y, z))
+            << "Coordinate: " << x << " " << y << " " << z;
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+//
+// Typed tests over device and host arrays; the expressions are the same, only
+// the evaluator differs.
+//
+//------------------------------------------------------------------------------
+
+template <typename ArrayTypes>
+class ArrayExpressionTest : public ::testing::Test {
+ public:
+  typedef typename ArrayTypes::first_type Array2DType;
+  typedef typename ArrayTypes::second_type Array3DType;
+
+  ArrayExpressionTest()
+      : a_(37, 23), b_(37, 23), c_(37, 23), out_(37, 23),
+        a3_(17, 11, 5), b3_(17, 11, 5), out3_(17, 11, 5) {
+    Upload2D(&a_, [](size_t x, size_t y) { return x + 0.25f; });
+    Upload2D(&b_, [](size_t x, size_t y) { return y + 1.f; });
+    Upload2D(&c_, [](size_t x, size_t y) { return 2.f; });
+    Upload3D(&a3_, [](size_t x, size_t y, size_t z) { return x + 10.f * z; });
+    Upload3D(&b3_, [](size_t x, size_t y, size_t z) { return y + 1.f; });
+  }
+
+  template <typename HostFunction>
+  static void Upload2D(Array2DType *array, const HostFunction &host_function) {
+    std::vector<float> data(array->Size());
+    for (size_t y = 0; y < array->Height(); ++y) {
+      for (size_t x = 0; x < array->Width(); ++x) {
+        data[y * array->Width() + x] = host_function(x, y);
+      }
+    }
+    *array = data.data();
+  }
+
+  template <typename HostFunction>
+  static void Upload3D(Array3DType *array, const HostFunction &host_function) {
+    std::vector<float> data(array->Size());
+    for (size_t z = 0; z < array->Depth(); ++z) {
+      for (size_t y = 0; y < array->Height(); ++y) {
+        for (size_t x = 0; x < array->Width(); ++x) {
+          data[(z * array->Height() + y) * array->Width() + x] =
+              host_function(x, y, z);
+        }
+      }
+    }
+    *array = data.data();
+  }
+
+ protected:
+  Array2DType a_, b_, c_, out_;
+  Array3DType a3_, b3_, out3_;
+};
+
+typedef ::testing::Types<
+    std::pair<cua::CudaArray2D<float>, cua::CudaArray3D<float>>,
+    std::pair<cua::CudaHostArray2D<float>, cua::CudaHostArray3D<float>>>
+    Types;
+
+TYPED_TEST_SUITE(ArrayExpressionTest, Types);
+
+TYPED_TEST(ArrayExpressionTest, TestFusedExpression2D) {
+  this->out_ = this->a_ * 0.5f + this->b_ * this->c_ - 1;
+  Check2D(this->out_, [](size_t x, size_t y) {
+    return (x + 0.25f) * 0.5f + (y + 1.f) * 2.f - 1.f;
+  });
+}
+
+TYPED_TEST(ArrayExpressionTest, TestScalarOnLeftAndNegation2D) {
+  this->out_ = 2 / -this->b_ + 1.f;
+  Check2D(this->out_,
+          [](size_t x, size_t y) { return 2.f / -(y + 1.f) + 1.f; });
+}
+
+TYPED_TEST(ArrayExpressionTest, TestCompoundAssignment2D) {
+  this->out_.Fill(1.f);
+  this->out_ += this->a_;
+  this->out_ *= this->b_ - this->c_;
+  this->out_ -= this->c_;
+  this->out_ /= this->c_;
+  Check2D(this->out_, [](size_t x, size_t y) {
+    return ((1.f + x + 0.25f) * (y + 1.f - 2.f) - 2.f) / 2.f;
+  });
+}
+
+TYPED_TEST(ArrayExpressionTest, TestAliasedOutput2D) {
+  this->out_.Fill(3.f);
+  this->out_ = this->out_ * this->out_ + this->a_;
+  Check2D(this->out_, [](size_t x, size_t y) { return 9.f + x + 0.25f; });
+}
+
+TYPED_TEST(ArrayExpressionTest, TestView2D) {
+  auto view = this->out_.View(3, 2, 5, 4);
+  view = this->a_.View(1, 1, 5, 4) + this->b_.View(0, 0, 5, 4);
+  Check2D(view, [](size_t x, size_t y) { return x + 1.25f + y + 1.f; });
+}
+
+TYPED_TEST(ArrayExpressionTest, TestSizeMismatch2D) {
+  typename TestFixture::Array2DType other(36, 23);
+  EXPECT_THROW(this->out_ = this->a_ + other, std::runtime_error);
+}
+
+TYPED_TEST(ArrayExpressionTest, TestFusedExpression3D) {
+  this->out3_ = (this->a3_ - this->b3_) * 2.f + this->b3_ / 4;
+  Check3D(this->out3_, [](size_t x, size_t y, size_t z) {
+    return (x + 10.f * z - (y + 1.f)) * 2.f + (y + 1.f) / 4.f;
+  });
+}
+
+TYPED_TEST(ArrayExpressionTest, TestCompoundAssignment3D) {
+  this->out3_.Fill(2.f);
+  this->out3_ += this->a3_ * this->b3_;
+  Check3D(this->out3_, [](size_t x, size_t y, size_t z) {
+    return 2.f + (x + 10.f * z) * (y + 1.f);
+  });
+}
+
+}  // namespace
@@ -0,0 +1,203 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "blockDimTuner.h"
+#include "cudaArray2D.h"
+#include "cudaArray3D.h"
+#include "cudaSurface2D.h"
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+//------------------------------------------------------------------------------
+
+// Reports a fixed device name and a made-up run time for each block shape
+// without launching anything, so the tuner can be tested without a GPU.
+struct MockBackend {
+  struct State {
+    State() : device_name("Mock Device"), num_timings(0) {}
+
+    std::string device_name;
+    size_t num_timings;
+  };
+
+  explicit MockBackend(State *state) : state(state) {}
+
+  std::string DeviceName(int device) const { return state->device_name; }
+
+  // fastest for 64x4 blocks
+  double Time(const std::function<void(const dim3 &)> &launch,
+              const dim3 &block_dim, int device, cudaStream_t stream) const {
+    ++state->num_timings;
+    const double dx = static_cast<double>(block_dim.x) - 64.;
+    const double dy = static_cast<double>(block_dim.y) - 4.;
+    return 1. + dx * dx + dy * dy + block_dim.z;
+  }
+
+  State *state;
+};
+
+typedef cua::BlockDimTuner<MockBackend> Tuner;
+
+const char kCachePath[] = "blockDimTuner_test_cache.txt";
+
+const std::function<void(const dim3 &)> kNoLaunch = [](const dim3 &) {};
+
+//------------------------------------------------------------------------------
+
+class BlockDimTunerTest : public ::testing::Test {
+ public:
+  BlockDimTunerTest() { std::remove(kCachePath); }
+
+  ~BlockDimTunerTest() { std::remove(kCachePath); }
+
+ protected:
+  std::unique_ptr<Tuner> NewTuner(const std::string &cache_path = kCachePath) {
+    return std::unique_ptr<Tuner>(
+        new Tuner(cache_path, MockBackend(&state_)));
+  }
+
+  dim3 Tune(Tuner *tuner, const std::string &shape_class = "w5h5d0") {
+    return tuner->Tune("Kernel", "float", shape_class,
+                       cua::internal::BlockDimCandidates2D(), kNoLaunch, 0);
+  }
+
+  MockBackend::State state_;
+};
+
+//------------------------------------------------------------------------------
+
+TEST_F(BlockDimTunerTest, TestSelectsFastestCandidate) {
+  std::unique_ptr<Tuner> tuner = NewTuner();
+  const dim3 block_dim = Tune(tuner.get());
+  EXPECT_EQ(block_dim.x, 64);
+  EXPECT_EQ(block_dim.y, 4);
+  EXPECT_EQ(block_dim.z, 1);
+  EXPECT_EQ(state_.num_timings, cua::internal::BlockDimCandidates2D().size());
+
+  // known results are not benchmarked again
+  Tune(tuner.get());
+  EXPECT_EQ(state_.num_timings, cua::internal::BlockDimCandidates2D().size());
+  EXPECT_EQ(tuner->NumEntries(), 1);
+}
+
+TEST_F(BlockDimTunerTest, TestKeying) {
+  std::unique_ptr<Tuner> tuner = NewTuner();
+  Tune(tuner.get(), "w5h5d0");
+  Tune(tuner.get(), "w6h5d0");
+  tuner->Tune("OtherKernel", "float", "w5h5d0",
+              cua::internal::BlockDimCandidates2D(), kNoLaunch, 0);
+  tuner->Tune("Kernel", "uchar4", "w5h5d0",
+              cua::internal::BlockDimCandidates2D(), kNoLaunch, 0);
+  EXPECT_EQ(tuner->NumEntries(), 4);
+
+  dim3 block_dim;
+  EXPECT_TRUE(
+      tuner->Lookup("Mock Device", "Kernel", "float", "w5h5d0", &block_dim));
+  EXPECT_FALSE(
+      tuner->Lookup("Other Device", "Kernel", "float", "w5h5d0", &block_dim));
+}
+
+TEST_F(BlockDimTunerTest, TestPersistence) {
+  Tune(NewTuner().get());
+  const size_t num_timings = state_.num_timings;
+
+  // a new tuner with the same cache file reuses the result...
+  std::unique_ptr<Tuner> tuner = NewTuner();
+  const dim3 block_dim = Tune(tuner.get());
+  EXPECT_EQ(block_dim.x, 64);
+  EXPECT_EQ(block_dim.y, 4);
+  EXPECT_EQ(state_.num_timings, num_timings);
+
+  // ...but only on a device with the same name
+  state_.device_name = "Other Device";
+  std::unique_ptr<Tuner> other_tuner = NewTuner();
+  Tune(other_tuner.get());
+  EXPECT_EQ(state_.num_timings, 2 * num_timings);
+  EXPECT_EQ(other_tuner->NumEntries(), 2);
+}
+
+TEST_F(BlockDimTunerTest, TestMalformedCacheLinesAreIgnored) {
+  {
+    std::ofstream file(kCachePath);
+    file << "garbage\n"
+         << "Mock Device\tKernel\tfloat\tw5h5d0\t0 4 1\n"
+         << "Mock Device\tKernel\tfloat\tw6h6d0\t128 2 1\n";
+  }
+
+  std::unique_ptr<Tuner> tuner = NewTuner();
+  EXPECT_EQ(tuner->NumEntries(), 1);
+
+  const dim3 block_dim = Tune(tuner.get(), "w6h6d0");
+  EXPECT_EQ(block_dim.x, 128);
+  EXPECT_EQ(block_dim.y, 2);
+  EXPECT_EQ(state_.num_timings, 0);
+}
+
+TEST_F(BlockDimTunerTest, TestInMemoryOnly) {
+  std::unique_ptr<Tuner> tuner = NewTuner("");
+  Tune(tuner.get());
+  EXPECT_EQ(tuner->NumEntries(), 1);
+  EXPECT_FALSE(std::ifstream(kCachePath).good());
+
+  tuner->Clear();
+  EXPECT_EQ(tuner->NumEntries(), 0);
+}
+
+TEST(ShapeClassTest, TestBuckets) {
+  EXPECT_EQ(cua::internal::ShapeClass(1, 3), "w0h0d0");
+  EXPECT_EQ(cua::internal::ShapeClass(1000, 1000), "w4h4d0");
+  EXPECT_EQ(cua::internal::ShapeClass(1920, 1080), "w5h5d0");
+  EXPECT_EQ(cua::internal::ShapeClass(1024, 1024, 64), "w5h5d3");
+}
+
+TEST(TuningTypeNameTest, TestStableNames) {
+  EXPECT_EQ(cua::internal::TuningTypeName<cua::CudaArray2D<float>>(),
+            "linear4");
+  EXPECT_EQ(cua::internal::TuningTypeName<cua::CudaArray3D<double>>(),
+            "linear8");
+  EXPECT_EQ(cua::internal::TuningTypeName<cua::CudaSurface2D<uchar4>>(),
+            "cudaArray4");
+}
+
+}  // namespace
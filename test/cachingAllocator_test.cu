@@ -0,0 +1,274 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cachingAllocator.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+//------------------------------------------------------------------------------
+
+// Hands out fake, never-dereferenced addresses and records every call, so the
+// caching logic can be tested without a GPU. Events are indices into a list of
+// completion flags that the tests set by hand.
+struct MockBackend {
+  typedef size_t Event;
+
+  struct State {
+    State()
+        : next_address(0x1000),
+          num_mallocs(0),
+          num_frees(0),
+          live_bytes(0),
+          capacity(0),
+          num_live_events(0) {}
+
+    uintptr_t next_address;
+    size_t num_mallocs, num_frees;
+    size_t live_bytes;
+    size_t capacity;  // if nonzero, the simulated device memory size
+    std::map<void *, std::pair<int, size_t>> live;  // ptr -> (device, size)
+    std::vector<cudaStream_t> event_streams;
+    std::vector<bool> event_done;
+    size_t num_live_events;
+  };
+
+  explicit MockBackend(State *state) : state(state) {}
+
+  void *Malloc(size_t size_in_bytes, int device) const {
+    if (state->capacity > 0 &&
+        state->live_bytes + size_in_bytes > state->capacity) {
+      return nullptr;
+    }
+    void *ptr = reinterpret_cast<void *>(state->next_address);
+    state->next_address += size_in_bytes;
+    state->live[ptr] = std::make_pair(device, size_in_bytes);
+    state->live_bytes += size_in_bytes;
+    ++state->num_mallocs;
+    return ptr;
+  }
+
+  void Free(void *ptr, int device) const {
+    ASSERT_EQ(state->live.count(ptr), 1);
+    EXPECT_EQ(state->live[ptr].first, device);
+    state->live_bytes -= state->live[ptr].second;
+    state->live.erase(ptr);
+    ++state->num_frees;
+  }
+
+  size_t PitchAlignment(int device) const { return 256; }
+
+  Event RecordEvent(cudaStream_t stream, int device) const {
+    state->event_streams.push_back(stream);
+    state->event_done.push_back(false);
+    ++state->num_live_events;
+    return state->event_done.size() - 1;
+  }
+
+  bool QueryEvent(Event event) const { return state->event_done[event]; }
+
+  void DestroyEvent(Event event) const { --state->num_live_events; }
+
+  State *state;
+};
+
+typedef cua::CachingAllocator<MockBackend> Allocator;
+
+const cudaStream_t kStream0 = 0;
+const cudaStream_t kStream1 = reinterpret_cast<cudaStream_t>(1);
+
+//------------------------------------------------------------------------------
+
+class CachingAllocatorTest : public ::testing::Test {
+ public:
+  CachingAllocatorTest() : allocator_(new Allocator(MockBackend(&state_))) {}
+
+ protected:
+  MockBackend::State state_;
+  std::unique_ptr<Allocator> allocator_;
+};
+
+//------------------------------------------------------------------------------
+
+TEST(CachingAllocatorBinTest, TestBinSize) {
+  EXPECT_EQ(Allocator::BinSize(0), Allocator::kMinBlockBytes);
+  EXPECT_EQ(Allocator::BinSize(1), Allocator::kMinBlockBytes);
+  EXPECT_EQ(Allocator::BinSize(512), 512);
+  EXPECT_EQ(Allocator::BinSize(513), 1024);
+  EXPECT_EQ(Allocator::BinSize(1 << 20), 1 << 20);
+  EXPECT_EQ(Allocator::BinSize((1 << 20) + 1), 2 << 20);
+  EXPECT_EQ(Allocator::BinSize((5 << 20) + 7), 6 << 20);
+}
+
+TEST_F(CachingAllocatorTest, TestReuseWithinBin) {
+  void *ptr = allocator_->Allocate(1000, 0, kStream0);
+  allocator_->Free(ptr);
+  EXPECT_EQ(allocator_->CachedBytes(), 1024);
+  EXPECT_EQ(allocator_->AllocatedBytes(), 0);
+
+  // same bin: reused without calling the backend
+  EXPECT_EQ(allocator_->Allocate(600, 0, kStream0), ptr);
+  EXPECT_EQ(state_.num_mallocs, 1);
+  EXPECT_EQ(allocator_->CachedBytes(), 0);
+  EXPECT_EQ(allocator_->AllocatedBytes(), 1024);
+}
+
+TEST_F(CachingAllocatorTest, TestNoReuseAcrossBinsDevicesOrStreams) {
+  allocator_->Free(allocator_->Allocate(1000, 0, kStream0));
+
+  allocator_->Allocate(2000, 0, kStream0);  // different bin
+  allocator_->Allocate(1000, 1, kStream0);  // different device
+  allocator_->Allocate(1000, 0, kStream1);  // different stream
+  EXPECT_EQ(state_.num_mallocs, 4);
+  EXPECT_EQ(allocator_->CachedBytes(), 1024);
+}
+
+TEST_F(CachingAllocatorTest, TestNoReuseWhileInUseOnOtherStream) {
+  const cudaStream_t kStream2 = reinterpret_cast<cudaStream_t>(2);
+
+  void *ptr = allocator_->Allocate(1000, 0, kStream0);
+  allocator_->RecordStream(ptr, kStream0);  // own stream: no event needed
+  allocator_->RecordStream(ptr, kStream1);
+  allocator_->RecordStream(ptr, kStream2);
+  allocator_->RecordStream(ptr, kStream1);
+  allocator_->Free(ptr);
+  ASSERT_EQ(state_.event_streams.size(), 2);
+  EXPECT_EQ(state_.event_streams[0], kStream1);
+  EXPECT_EQ(state_.event_streams[1], kStream2);
+
+  // the block is still in use on the other streams
+  void *other = allocator_->Allocate(1000, 0, kStream0);
+  EXPECT_NE(other, ptr);
+  state_.event_done[0] = true;
+  allocator_->Free(other);  // cached without events: reusable right away
+  EXPECT_EQ(allocator_->Allocate(1000, 0, kStream0), other);
+  EXPECT_EQ(state_.num_mallocs, 2);
+
+  // ready once all of its events have completed
+  state_.event_done[1] = true;
+  EXPECT_EQ(allocator_->Allocate(1000, 0, kStream0), ptr);
+  EXPECT_EQ(state_.num_live_events, 0);
+
+  // events of blocks released to the backend are destroyed as well
+  allocator_->RecordStream(ptr, kStream1);
+  allocator_->Free(ptr);
+  EXPECT_EQ(state_.num_live_events, 1);
+  allocator_->Trim();
+  EXPECT_EQ(state_.num_live_events, 0);
+}
+
+TEST_F(CachingAllocatorTest, TestPitchedAllocation) {
+  size_t pitch = 0;
+  allocator_->AllocatePitched(100 * sizeof(float), 30, 0, kStream0, &pitch);
+  EXPECT_EQ(pitch, 512);
+  EXPECT_EQ(allocator_->AllocatedBytes(), Allocator::BinSize(512 * 30));
+}
+
+TEST_F(CachingAllocatorTest, TestTrim) {
+  void *a = allocator_->Allocate(1000, 0, kStream0);
+  void *b = allocator_->Allocate(1000, 1, kStream0);
+  void *c = allocator_->Allocate(1000, 1, kStream0);
+  allocator_->Free(a);
+  allocator_->Free(b);
+
+  allocator_->Trim(1);
+  EXPECT_EQ(state_.num_frees, 1);
+  EXPECT_EQ(allocator_->CachedBytes(), 1024);
+
+  allocator_->Trim();
+  EXPECT_EQ(state_.num_frees, 2);
+  EXPECT_EQ(allocator_->CachedBytes(), 0);
+  EXPECT_EQ(state_.live.size(), 1);  // c is still in use
+
+  allocator_->Free(c);
+  allocator_.reset();  // the destructor releases everything that is cached
+  EXPECT_TRUE(state_.live.empty());
+}
+
+TEST_F(CachingAllocatorTest, TestMaxCachedBytes) {
+  allocator_->SetMaxCachedBytes(2048);
+
+  void *a = allocator_->Allocate(1024, 0, kStream0);
+  void *b = allocator_->Allocate(1024, 0, kStream0);
+  void *c = allocator_->Allocate(1024, 0, kStream0);
+  void *d = allocator_->Allocate(4096, 0, kStream0);
+  allocator_->Free(a);
+  allocator_->Free(b);
+  EXPECT_EQ(allocator_->CachedBytes(), 2048);
+
+  allocator_->Free(c);  // evicts a cached block to stay under the cap
+  EXPECT_EQ(allocator_->CachedBytes(), 2048);
+  EXPECT_EQ(state_.num_frees, 1);
+
+  allocator_->Free(d);  // larger than the cap: returned to the backend
+  EXPECT_EQ(allocator_->CachedBytes(), 2048);
+  EXPECT_EQ(state_.num_frees, 2);
+
+  allocator_->SetMaxCachedBytes(0);  // disables caching
+  EXPECT_EQ(allocator_->CachedBytes(), 0);
+  allocator_->Free(allocator_->Allocate(1024, 0, kStream0));
+  EXPECT_EQ(allocator_->CachedBytes(), 0);
+  EXPECT_TRUE(state_.live.empty());
+}
+
+TEST_F(CachingAllocatorTest, TestTrimAndRetryOnFailure) {
+  state_.capacity = 8 << 20;
+  allocator_->Free(allocator_->Allocate(6 << 20, 0, kStream0));
+  EXPECT_EQ(allocator_->CachedBytes(), 6 << 20);
+
+  // the first attempt fails, so the cache is released and the request retried
+  allocator_->Allocate(4 << 20, 0, kStream0);
+  EXPECT_EQ(state_.num_mallocs, 2);
+  EXPECT_EQ(state_.num_frees, 1);
+  EXPECT_EQ(allocator_->CachedBytes(), 0);
+
+  EXPECT_THROW(allocator_->Allocate(6 << 20, 0, kStream0), std::runtime_error);
+}
+
+TEST_F(CachingAllocatorTest, TestFreeUnknownPointer) {
+  allocator_->Free(nullptr);
+  int value;
+  EXPECT_THROW(allocator_->Free(&value), std::runtime_error);
+  EXPECT_THROW(allocator_->RecordStream(&value, kStream1), std::runtime_error);
+}
+
+}  // namespace
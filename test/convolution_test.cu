@@ -0,0 +1,443 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cudaArray2D.h"
+#include "cudaArray3D.h"
+#include "cudaHostArray2D.h"
+#include "cudaHostArray3D.h"
+#include "cudaSurface2D.h"
+#include "cudaTexture2D.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "util.h"
+
+namespace {
+
+// more than one tile along every axis of the convolution kernels
+const size_t kWidth = 150;
+const size_t kHeight = 45;
+const size_t kDepth3D = 35;
+const size_t kWidth3D = 40;
+const size_t kHeight3D = 37;
+
+const float kTolerance = 1e-4f;
+
+const cua::ConvolutionBorder kBorders[] = {
+    cua::ConvolutionBorder::kClamp, cua::ConvolutionBorder::kZero,
+    cua::ConvolutionBorder::kMirror, cua::ConvolutionBorder::kWrap};
+
+// asymmetric taps, so that mixing up the tap order is detected
+template <unsigned int Radius>
+inline cua::ConvolutionTaps<Radius> SkewedTaps() {
+  cua::ConvolutionTaps<Radius> taps = cua::GaussianTaps<Radius>(1.5f);
+  for (unsigned int k = 0; k < taps.kNumTaps; ++k) {
+    taps.value[k] *= 1.f + 0.1f * k;
+  }
+  return taps;
+}
+
+//------------------------------------------------------------------------------
+
+// direct, non-separable convolution in double precision
+template <unsigned int RadiusX, unsigned int RadiusY, unsigned int RadiusZ>
+std::vector<float> DirectConvolve(const std::vector<float> &data, int width,
+                                  int height, int depth,
+                                  const cua::ConvolutionTaps<RadiusX> &taps_x,
+                                  const cua::ConvolutionTaps<RadiusY> &taps_y,
+                                  const cua::ConvolutionTaps<RadiusZ> &taps_z,
+                                  cua::ConvolutionBorder border) {
+  using cua::internal::ConvolutionIndex;
+  std::vector<float> result(data.size());
+  for (int z = 0; z < depth; ++z) {
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        double sum = 0.;
+        for (int k = 0; k < static_cast<int>(taps_z.kNumTaps); ++k) {
+          const int src_z = ConvolutionIndex(z + k - RadiusZ, depth, border);
+          for (int j = 0; j < static_cast<int>(taps_y.kNumTaps); ++j) {
+            const int src_y = ConvolutionIndex(y + j - RadiusY, height, border);
+            for (int i = 0; i < static_cast<int>(taps_x.kNumTaps); ++i) {
+              const int src_x =
+                  ConvolutionIndex(x + i - RadiusX, width, border);
+              if (src_x >= 0 && src_y >= 0 && src_z >= 0) {
+                sum += static_cast<double>(taps_z.value[k]) * taps_y.value[j] *
+                       taps_x.value[i] *
+                       data[(src_z * height + src_y) * width + src_x];
+              }
+            }
+          }
+        }
+        result[(z * height + y) * width + x] = static_cast<float>(sum);
+      }
+    }
+  }
+  return result;
+}
+
+template <unsigned int RadiusX, unsigned int RadiusY>
+std::vector<float> DirectConvolve(const std::vector<float> &data, int width,
+                                  int height,
+                                  const cua::ConvolutionTaps<RadiusX> &taps_x,
+                                  const cua::ConvolutionTaps<RadiusY> &taps_y,
+                                  cua::ConvolutionBorder border) {
+  const cua::ConvolutionTaps<0> identity = {{1.f}};
+  return DirectConvolve(data, width, height, 1, taps_x, taps_y, identity,
+                        border);
+}
+
+inline void ExpectNear(const std::vector<float> &result,
+                       const std::vector<float> &expected) {
+  ASSERT_EQ(result.size(), expected.size());
+  for (size_t i = 0; i < result.size(); ++i) {
+    ASSERT_NEAR(result[i], expected[i], kTolerance) << "at index " << i;
+  }
+}
+
+//------------------------------------------------------------------------------
+//
+// border handling and host reference
+//
+//------------------------------------------------------------------------------
+
+TEST(ConvolutionTest, TestBorderIndex) {
+  using cua::ConvolutionBorder;
+  using cua::internal::ConvolutionIndex;
+
+  EXPECT_EQ(ConvolutionIndex(2, 4, ConvolutionBorder::kZero), 2);
+  EXPECT_EQ(ConvolutionIndex(-1, 4, ConvolutionBorder::kZero), -1);
+  EXPECT_EQ(ConvolutionIndex(4, 4, ConvolutionBorder::kZero), -1);
+
+  EXPECT_EQ(ConvolutionIndex(-3, 4, ConvolutionBorder::kClamp), 0);
+  EXPECT_EQ(ConvolutionIndex(6, 4, ConvolutionBorder::kClamp), 3);
+
+  EXPECT_EQ(ConvolutionIndex(-1, 4, ConvolutionBorder::kMirror), 1);
+  EXPECT_EQ(ConvolutionIndex(-3, 4, ConvolutionBorder::kMirror), 3);
+  EXPECT_EQ(ConvolutionIndex(-4, 4, ConvolutionBorder::kMirror), 2);
+  EXPECT_EQ(ConvolutionIndex(4, 4, ConvolutionBorder::kMirror), 2);
+  EXPECT_EQ(ConvolutionIndex(7, 4, ConvolutionBorder::kMirror), 1);
+  EXPECT_EQ(ConvolutionIndex(-2, 1, ConvolutionBorder::kMirror), 0);
+
+  EXPECT_EQ(ConvolutionIndex(-1, 4, ConvolutionBorder::kWrap), 3);
+  EXPECT_EQ(ConvolutionIndex(-5, 4, ConvolutionBorder::kWrap), 3);
+  EXPECT_EQ(ConvolutionIndex(5, 4, ConvolutionBorder::kWrap), 1);
+}
+
+TEST(ConvolutionTest, TestTaps) {
+  const cua::ConvolutionTaps<3> gaussian = cua::GaussianTaps<3>(1.f);
+  float sum = 0.f;
+  for (unsigned int k = 0; k < gaussian.kNumTaps; ++k) {
+    sum += gaussian.value[k];
+    EXPECT_FLOAT_EQ(gaussian.value[k], gaussian.value[6 - k]);
+  }
+  EXPECT_NEAR(sum, 1.f, 1e-6f);
+  EXPECT_NEAR(gaussian.value[3] / gaussian.value[4], std::exp(0.5f), 1e-5f);
+
+  const cua::ConvolutionTaps<2> box = cua::BoxTaps<2>();
+  for (unsigned int k = 0; k < box.kNumTaps; ++k) {
+    EXPECT_FLOAT_EQ(box.value[k], 0.2f);
+  }
+}
+
+TEST(ConvolutionTest, TestHostReference2D) {
+  const std::vector<float> data = Values(kWidth * kHeight);
+  cua::CudaHostArray2D<float> array(kWidth, kHeight);
+  cua::CudaHostArray2D<float> result_array(kWidth, kHeight);
+  array = data.data();
+
+  const cua::ConvolutionTaps<2> taps_x = SkewedTaps<2>();
+  const cua::ConvolutionTaps<1> taps_y = {{-0.5f, 0.f, 1.f}};
+  for (const cua::ConvolutionBorder border : kBorders) {
+    array.SeparableConvolve(taps_x, taps_y, &result_array, border);
+
+    std::vector<float> result(kWidth * kHeight);
+    result_array.CopyTo(result.data());
+    ExpectNear(result, DirectConvolve(data, kWidth, kHeight, taps_x, taps_y,
+                                      border));
+  }
+}
+
+TEST(ConvolutionTest, TestHostReference3D) {
+  const std::vector<float> data = Values(kWidth3D * kHeight3D * kDepth3D);
+  cua::CudaHostArray3D<float> array(kWidth3D, kHeight3D, kDepth3D);
+  cua::CudaHostArray3D<float> result_array(kWidth3D, kHeight3D, kDepth3D);
+  array = data.data();
+
+  const cua::ConvolutionTaps<1> taps_x = SkewedTaps<1>();
+  const cua::ConvolutionTaps<2> taps_y = SkewedTaps<2>();
+  const cua::ConvolutionTaps<3> taps_z = SkewedTaps<3>();
+  for (const cua::ConvolutionBorder border : kBorders) {
+    array.SeparableConvolve(taps_x, taps_y, taps_z, &result_array, border);
+
+    std::vector<float> result(data.size());
+    result_array.CopyTo(result.data());
+    ExpectNear(result, DirectConvolve(data, kWidth3D, kHeight3D, kDepth3D,
+                                      taps_x, taps_y, taps_z, border));
+  }
+}
+
+//------------------------------------------------------------------------------
+//
+// 2D tests over all readable device array kinds, against the host reference
+//
+//------------------------------------------------------------------------------
+
+template <typename CudaArrayType>
+class Convolution2DTest : public ::testing::Test {
+ public:
+  Convolution2DTest()
+      : array_(kWidth, kHeight),
+        host_array_(kWidth, kHeight),
+        data_(Values(kWidth * kHeight)) {
+    array_ = data_.data();
+    host_array_ = data_.data();
+  }
+
+ protected:
+  // compare array_ convolved into a CudaArray2D with the host reference
+  template <unsigned int RadiusX, unsigned int RadiusY>
+  void CheckConvolve(const cua::ConvolutionTaps<RadiusX> &taps_x,
+                     const cua::ConvolutionTaps<RadiusY> &taps_y,
+                     cua::ConvolutionBorder border) {
+    cua::CudaArray2D<float> result_array(kWidth, kHeight);
+    array_.SeparableConvolve(taps_x, taps_y, &result_array, border);
+    std::vector<float> result(kWidth * kHeight);
+    result_array.CopyTo(result.data());
+
+    cua::CudaHostArray2D<float> expected_array(kWidth, kHeight);
+    cua::host::SeparableConvolve2D(host_array_, expected_array, taps_x, taps_y,
+                                   border);
+    std::vector<float> expected(kWidth * kHeight);
+    expected_array.CopyTo(expected.data());
+
+    ExpectNear(result, expected);
+  }
+
+  CudaArrayType array_;
+  cua::CudaHostArray2D<float> host_array_;
+  std::vector<float> data_;
+};
+
+typedef ::testing::Types<cua::CudaArray2D<float>, cua::CudaSurface2D<float>,
+                         cua::CudaTexture2D<float>>
+    Types2D;
+
+TYPED_TEST_SUITE(Convolution2DTest, Types2D);
+
+TYPED_TEST(Convolution2DTest, TestBorders) {
+  for (const cua::ConvolutionBorder border : kBorders) {
+    this->CheckConvolve(SkewedTaps<3>(), SkewedTaps<2>(), border);
+  }
+  CUDA_CHECK_ERROR
+}
+
+TYPED_TEST(Convolution2DTest, TestRadii) {
+  const cua::ConvolutionTaps<0> identity = {{1.f}};
+  this->CheckConvolve(identity, identity, cua::ConvolutionBorder::kClamp);
+  this->CheckConvolve(SkewedTaps<1>(), identity,
+                      cua::ConvolutionBorder::kMirror);
+  this->CheckConvolve(identity, SkewedTaps<1>(), cua::ConvolutionBorder::kWrap);
+  this->CheckConvolve(SkewedTaps<cua::kMaxConvolutionRadius>(),
+                      SkewedTaps<cua::kMaxConvolutionRadius>(),
+                      cua::ConvolutionBorder::kClamp);
+  CUDA_CHECK_ERROR
+}
+
+TYPED_TEST(Convolution2DTest, TestSizeMismatch) {
+  cua::CudaArray2D<float> result_array(kWidth, kHeight + 1);
+  EXPECT_THROW(this->array_.SeparableConvolve(cua::BoxTaps<1>(), &result_array),
+               std::runtime_error);
+}
+
+//------------------------------------------------------------------------------
+//
+// border policy of the source array, output types, and in-place convolution
+//
+//------------------------------------------------------------------------------
+
+TEST(ConvolutionTest, TestBorderFromArray) {
+  const std::vector<float> data = Values(kWidth * kHeight);
+  const cua::ConvolutionTaps<2> taps = SkewedTaps<2>();
+
+  cua::CudaSurface2D<float> zero_surface(kWidth, kHeight);
+  cua::CudaSurface2D<float> clamp_surface(kWidth, kHeight,
+                                          cua::CudaSurface2D<float>::kBlockDim,
+                                          0, cudaBoundaryModeClamp);
+  cua::CudaArray2D<float> array(kWidth, kHeight);
+  zero_surface = data.data();
+  clamp_surface = data.data();
+  array = data.data();
+
+  std::vector<float> result(kWidth * kHeight);
+  cua::CudaArray2D<float> result_array(kWidth, kHeight);
+
+  zero_surface.SeparableConvolve(taps, &result_array);
+  result_array.CopyTo(result.data());
+  ExpectNear(result, DirectConvolve(data, kWidth, kHeight, taps, taps,
+                                    cua::ConvolutionBorder::kZero));
+
+  clamp_surface.SeparableConvolve(taps, &result_array);
+  result_array.CopyTo(result.data());
+  ExpectNear(result, DirectConvolve(data, kWidth, kHeight, taps, taps,
+                                    cua::ConvolutionBorder::kClamp));
+
+  array.SeparableConvolve(taps, &result_array);
+  result_array.CopyTo(result.data());
+  ExpectNear(result, DirectConvolve(data, kWidth, kHeight, taps, taps,
+                                    cua::ConvolutionBorder::kClamp));
+  CUDA_CHECK_ERROR
+}
+
+TEST(ConvolutionTest, TestInPlace) {
+  const std::vector<float> data = Values(kWidth * kHeight);
+  const cua::ConvolutionTaps<4> taps = SkewedTaps<4>();
+
+  cua::CudaArray2D<float> array(kWidth, kHeight);
+  array = data.data();
+  array.SeparableConvolve(taps, &array, cua::ConvolutionBorder::kMirror);
+
+  std::vector<float> result(kWidth * kHeight);
+  array.CopyTo(result.data());
+  ExpectNear(result, DirectConvolve(data, kWidth, kHeight, taps, taps,
+                                    cua::ConvolutionBorder::kMirror));
+  CUDA_CHECK_ERROR
+}
+
+TEST(ConvolutionTest, TestChannels) {
+  std::vector<uchar4> data(kWidth * kHeight);
+  std::vector<float> channels[4];
+  for (size_t i = 0; i < data.size(); ++i) {
+    const unsigned char x = i % 256, y = (i * 7) % 256, z = (i * 31) % 256;
+    data[i] = make_uchar4(x, y, z, 255 - x);
+    channels[0].push_back(x);
+    channels[1].push_back(y);
+    channels[2].push_back(z);
+    channels[3].push_back(255 - x);
+  }
+
+  cua::CudaArray2D<uchar4> array(kWidth, kHeight);
+  cua::CudaArray2D<uchar4> result_array(kWidth, kHeight);
+  array = data.data();
+
+  const cua::ConvolutionTaps<2> taps = cua::GaussianTaps<2>(1.f);
+  array.SeparableConvolve(taps, &result_array);
+  std::vector<uchar4> result(data.size());
+  result_array.CopyTo(result.data());
+
+  // integer results are rounded to the nearest value
+  std::vector<float> expected[4];
+  for (int c = 0; c < 4; ++c) {
+    expected[c] = DirectConvolve(channels[c], kWidth, kHeight, taps, taps,
+                                 cua::ConvolutionBorder::kClamp);
+  }
+  for (size_t i = 0; i < result.size(); ++i) {
+    ASSERT_NEAR(result[i].x, expected[0][i], 0.5f + kTolerance);
+    ASSERT_NEAR(result[i].y, expected[1][i], 0.5f + kTolerance);
+    ASSERT_NEAR(result[i].z, expected[2][i], 0.5f + kTolerance);
+    ASSERT_NEAR(result[i].w, expected[3][i], 0.5f + kTolerance);
+  }
+  CUDA_CHECK_ERROR
+}
+
+TEST(ConvolutionTest, TestFloatOutput) {
+  std::vector<unsigned char> data(kWidth * kHeight);
+  std::vector<float> float_data(data.size());
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = (i * 7919) % 256;
+    float_data[i] = data[i];
+  }
+
+  cua::CudaArray2D<unsigned char> array(kWidth, kHeight);
+  cua::CudaArray2D<float> result_array(kWidth, kHeight);
+  array = data.data();
+
+  // central differences along x; negative values survive in the float output
+  const cua::ConvolutionTaps<1> derivative = {{-0.5f, 0.f, 0.5f}};
+  const cua::ConvolutionTaps<0> identity = {{1.f}};
+  array.SeparableConvolve(derivative, identity, &result_array);
+
+  std::vector<float> result(data.size());
+  result_array.CopyTo(result.data());
+  ExpectNear(result, DirectConvolve(float_data, kWidth, kHeight, derivative,
+                                    identity, cua::ConvolutionBorder::kClamp));
+  CUDA_CHECK_ERROR
+}
+
+//------------------------------------------------------------------------------
+//
+// 3D
+//
+//------------------------------------------------------------------------------
+
+TEST(ConvolutionTest, TestConvolve3D) {
+  const std::vector<float> data = Values(kWidth3D * kHeight3D * kDepth3D);
+  cua::CudaArray3D<float> array(kWidth3D, kHeight3D, kDepth3D);
+  cua::CudaArray3D<float> result_array(kWidth3D, kHeight3D, kDepth3D);
+  cua::CudaHostArray3D<float> host_array(kWidth3D, kHeight3D, kDepth3D);
+  cua::CudaHostArray3D<float> expected_array(kWidth3D, kHeight3D, kDepth3D);
+  array = data.data();
+  host_array = data.data();
+
+  const cua::ConvolutionTaps<2> taps_x = SkewedTaps<2>();
+  const cua::ConvolutionTaps<1> taps_y = SkewedTaps<1>();
+  const cua::ConvolutionTaps<3> taps_z = SkewedTaps<3>();
+  for (const cua::ConvolutionBorder border : kBorders) {
+    array.SeparableConvolve(taps_x, taps_y, taps_z, &result_array, border);
+    host_array.SeparableConvolve(taps_x, taps_y, taps_z, &expected_array,
+                                 border);
+
+    std::vector<float> result(data.size()), expected(data.size());
+    result_array.CopyTo(result.data());
+    expected_array.CopyTo(expected.data());
+    ExpectNear(result, expected);
+  }
+
+  // in place, with the same taps along each axis
+  const cua::ConvolutionTaps<2> taps = SkewedTaps<2>();
+  array = data.data();
+  array.SeparableConvolve(taps, &array);
+  std::vector<float> result(data.size());
+  array.CopyTo(result.data());
+  ExpectNear(result,
+             DirectConvolve(data, kWidth3D, kHeight3D, kDepth3D, taps, taps,
+                            taps, cua::ConvolutionBorder::kClamp));
+  CUDA_CHECK_ERROR
+}
+
+}  // namespace
@@ -99,6 +99,26 @@ class CudaArray2DBaseTest
 
   //----------------------------------------------------------------------------
 
+  void CheckAsyncRoundTrip() {
+    std::vector<Scalar> data(array_.Size());
+    for (IndexType i = 0; i < array_.Size(); ++i) {
+      data[i] = AsScalar(i);
+    }
+    array_.AssignAsync(data.data());
+
+    std::vector<Scalar> result(array_.Size());
+    cua::CudaEvent event = array_.CopyToAsync(result.data());
+    event.Synchronize();
+    CUDA_CHECK_ERROR
+    EXPECT_TRUE(event.Query());
+
+    for (IndexType i = 0; i < array_.Size(); ++i) {
+      EXPECT_EQ(result[i], data[i]) << "Index: " << i;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+
   void CheckView() {
     ASSERT_GT(array_.Height(), 1);
 
@@ -278,6 +298,58 @@ class CudaArray2DBaseTest
     DownloadAndCheck([=](IndexType x, IndexType y) { return value + value; });
   }
 
+  //----------------------------------------------------------------------------
+
+  void CheckLaunchModes() {
+    // non-square, so that each grid dimension must come from its own extent
+    CudaArrayType array(37, 301);
+    array.SetBlockDim(dim3(8, 4));
+    EXPECT_EQ(array.GridDim().x, 5);
+    EXPECT_EQ(array.GridDim().y, 76);
+
+    const SizeType width = array.Width();
+    const cua::LaunchMode modes[] = {cua::LaunchMode::kOneThreadPerElement,
+                                     cua::LaunchMode::kOccupancy,
+                                     cua::LaunchMode::kPersistent};
+    for (const cua::LaunchMode mode : modes) {
+      array.SetLaunchMode(mode);
+      array.Fill(AsScalar(0));
+      array.ApplyOp([=] __device__(IndexType x, IndexType y) {
+        return AsScalar(y * width + x);
+      });
+      array += AsScalar(1);
+      DownloadAndCheck(array, [=](IndexType x, IndexType y) {
+        return AsScalar(y * width + x + 1);
+      });
+    }
+  }
+
+  //----------------------------------------------------------------------------
+
+  void CheckApplyOpSharedMemory() {
+    // more blocks than a persistent launch would use, so a grid-stride launch
+    // would hand several elements to the same thread
+    CudaArrayType array(37, 301);
+    array.SetBlockDim(dim3(8, 4));
+    array.SetLaunchMode(cua::LaunchMode::kPersistent);
+
+    const SizeType width = array.Width();
+    array.ApplyOp(
+        [=] __device__(IndexType x, IndexType y) {
+          extern __shared__ IndexType thread_values[];
+          const unsigned int i = threadIdx.y * blockDim.x + threadIdx.x;
+          thread_values[i] = y * width + x + 1;
+          const bool is_own_element =
+              (x == blockIdx.x * blockDim.x + threadIdx.x &&
+               y == blockIdx.y * blockDim.y + threadIdx.y);
+          return AsScalar(is_own_element ? thread_values[i] : 0);
+        },
+        8 * 4 * sizeof(IndexType));
+    DownloadAndCheck(array, [=](IndexType x, IndexType y) {
+      return AsScalar(y * width + x + 1);
+    });
+  }
+
   //----------------------------------------------------------------------------
   
   template <typename OtherType>
@@ -313,6 +385,30 @@ class CudaArray2DBaseTest
 
   //----------------------------------------------------------------------------
 
+  void CheckInPlaceRotations() {
+    // several tiles, the last of which is partial
+    const SizeType n = 70;
+    CudaArrayType array(n, n);
+    array.ApplyOp([=] __device__(IndexType x, IndexType y) {
+      return AsScalar(y * n + x);
+    });
+
+    array.TransposeInPlace();
+    DownloadAndCheck(array, [=](IndexType x, IndexType y) {
+      return AsScalar(x * n + y);
+    });
+
+    array.Rot90_CWInPlace();
+    DownloadAndCheck(array, [=](IndexType x, IndexType y) {
+      return AsScalar(y * n + n - 1 - x);
+    });
+
+    array.Rot90_CCWInPlace();
+    DownloadAndCheck(array, [=](IndexType x, IndexType y) {
+      return AsScalar(x * n + y);
+    });
+  }
+
  private:
   CudaArrayType array_;
 };
@@ -327,6 +423,10 @@ TYPED_TEST_SUITE_P(CudaArray2DBaseTest);
 
 TYPED_TEST_P(CudaArray2DBaseTest, TestUpload) { this->CheckUpload(); }
 
+TYPED_TEST_P(CudaArray2DBaseTest, TestAsyncRoundTrip) {
+  this->CheckAsyncRoundTrip();
+}
+
 TYPED_TEST_P(CudaArray2DBaseTest, TestView) { this->CheckView(); }
 
 TYPED_TEST_P(CudaArray2DBaseTest, TestViewDownload) {
@@ -371,6 +471,14 @@ TYPED_TEST_P(CudaArray2DBaseTest, TestApplyOpUpdate) {
   this->CheckApplyOpUpdate(this->AsScalar(3));
 }
 
+TYPED_TEST_P(CudaArray2DBaseTest, TestLaunchModes) {
+  this->CheckLaunchModes();
+}
+
+TYPED_TEST_P(CudaArray2DBaseTest, TestApplyOpSharedMemory) {
+  this->CheckApplyOpSharedMemory();
+}
+
 TYPED_TEST_P(CudaArray2DBaseTest, TestCopyToArray) {
   this->CheckCopyToArray();
 }
@@ -383,12 +491,19 @@ TYPED_TEST_P(CudaArray2DBaseTest, TestCopyToTexture) {
   this->CheckCopyToTexture();
 }
 
-REGISTER_TYPED_TEST_SUITE_P(CudaArray2DBaseTest, TestUpload, TestView,
-                            TestViewDownload, TestViewUpload, TestNestedViews,
-                            TestFill, TestInPlaceAdd, TestInPlaceSubtract,
+TYPED_TEST_P(CudaArray2DBaseTest, TestInPlaceRotations) {
+  this->CheckInPlaceRotations();
+}
+
+REGISTER_TYPED_TEST_SUITE_P(CudaArray2DBaseTest, TestUpload,
+                            TestAsyncRoundTrip, TestView, TestViewDownload,
+                            TestViewUpload, TestNestedViews, TestFill,
+                            TestInPlaceAdd, TestInPlaceSubtract,
                             TestInPlaceMultiply, TestInPlaceDivide,
                             TestApplyOpConstant, TestApplyOpLinear,
-                            TestApplyOpUpdate, TestCopyToArray,
-                            TestCopyToSurface, TestCopyToTexture);
+                            TestApplyOpUpdate, TestLaunchModes,
+                            TestApplyOpSharedMemory, TestCopyToArray,
+                            TestCopyToSurface, TestCopyToTexture,
+                            TestInPlaceRotations);
 
 #endif  // CUDA_ARRAY2D_BASE_TEST_H_
@@ -35,6 +35,9 @@
 
 #include "cudaArray2D.h"
 
+#include <string>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 #include "cudaArray2DBase_test.h"
@@ -52,4 +55,101 @@ typedef ::testing::Types<
 
 INSTANTIATE_TYPED_TEST_SUITE_P(CudaArray2DTest, CudaArray2DBaseTest, Types);
 
+//------------------------------------------------------------------------------
+
+template <typename T, typename HostFunction>
+void CheckArray(const cua::CudaArray2D<T> &array,
+                const HostFunction &host_function) {
+  std::vector<T> result(array.Size());
+  array.CopyTo(result.data());
+  CUDA_CHECK_ERROR
+  for (size_t y = 0; y < array.Height(); ++y) {
+    for (size_t x = 0; x < array.Width(); ++x) {
+      EXPECT_EQ(result[y * array.Width() + x], host_function(x, y))
+          << "Coordinate: " << x << " " << y;
+    }
+  }
+}
+
+// rectangular arrays are transposed by permuting the pitched rows in place
+template <typename T>
+void CheckRectangularInPlaceRotations(size_t w, size_t h) {
+  SCOPED_TRACE(std::to_string(w) + " x " + std::to_string(h));
+  typedef PrimitiveConverter<T> Converter;
+  cua::CudaArray2D<T> array(w, h);
+  array.ApplyOp([=] __device__(unsigned int x, unsigned int y) {
+    return Converter::AsScalar((y * w + x) % 251);
+  });
+
+  array.TransposeInPlace();
+  ASSERT_EQ(array.Width(), h);
+  ASSERT_EQ(array.Height(), w);
+  CheckArray(array, [=](size_t x, size_t y) {
+    return Converter::AsScalar((x * w + y) % 251);
+  });
+
+  array.Rot90_CWInPlace();
+  CheckArray(array, [=](size_t x, size_t y) {
+    return Converter::AsScalar((y * w + w - 1 - x) % 251);
+  });
+
+  array.Rot90_CCWInPlace();
+  CheckArray(array, [=](size_t x, size_t y) {
+    return Converter::AsScalar((x * w + y) % 251);
+  });
+}
+
+TEST(CudaArray2DTest, TestRectangularInPlaceRotations) {
+  // sizes with and without common factors, and single rows and columns
+  const size_t sizes[][2] = {{45, 38}, {64, 96}, {100, 7}, {1, 33}, {70, 1}};
+  for (const auto &size : sizes) {
+    CheckRectangularInPlaceRotations<float>(size[0], size[1]);
+    CheckRectangularInPlaceRotations<unsigned char>(size[0], size[1]);
+    // 16-byte elements fill the 48 KB of shared memory of the column shift
+    CheckRectangularInPlaceRotations<float4>(size[0], size[1]);
+  }
+}
+
+TEST(CudaArray2DTest, TestRectangularViewTransposeInPlace) {
+  cua::CudaArray2D<float> array(10, 10);
+  auto view = array.View(1, 2, 5, 3);
+  EXPECT_THROW(view.TransposeInPlace(), std::runtime_error);
+
+  // views at the origin that are narrower or shorter than the array
+  auto narrow = array.View(0, 0, 5, 10);
+  EXPECT_THROW(narrow.TransposeInPlace(), std::runtime_error);
+  auto short_view = array.View(0, 0, 10, 3);
+  EXPECT_THROW(short_view.TransposeInPlace(), std::runtime_error);
+  auto corner = array.View(0, 0, 5, 3);
+  EXPECT_THROW(corner.TransposeInPlace(), std::runtime_error);
+
+  // a view of the whole array is transposed like the array itself
+  cua::CudaArray2D<float> rectangle(12, 10);
+  auto full = rectangle.View(0, 0, 12, 10);
+  EXPECT_NO_THROW(full.TransposeInPlace());
+  EXPECT_EQ(full.Width(), 10);
+  EXPECT_EQ(full.Height(), 12);
+}
+
+TEST(CudaArray2DTest, TestFreeAfterPeerCopyToAsync) {
+  int num_devices = 0;
+  cudaGetDeviceCount(&num_devices);
+  if (num_devices < 2) {
+    return;  // needs a second GPU
+  }
+
+  const size_t w = 2048, h = 2048;  // large enough to still be copying below
+  cua::CudaArray2D<float> src(w, h, 0);
+  src.Fill(1.f);
+  {
+    cua::CudaArray2D<float> dst(w, h, 1);
+    src.CopyToAsync(&dst);
+  }  // dst is released before the copy has finished
+
+  // if this reused dst's memory too early, the copy would overwrite it
+  cua::CudaArray2D<float> reused(w, h, 1);
+  reused.Fill(2.f);
+  CheckArray(reused, [](size_t, size_t) { return 2.f; });
+}
+
 }  // namespace
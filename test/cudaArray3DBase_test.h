@@ -105,6 +105,26 @@ class CudaArray3DBaseTest
 
   //----------------------------------------------------------------------------
 
+  void CheckAsyncRoundTrip() {
+    std::vector<Scalar> data(array_.Size());
+    for (IndexType i = 0; i < array_.Size(); ++i) {
+      data[i] = AsScalar(i);
+    }
+    array_.AssignAsync(data.data());
+
+    std::vector<Scalar> result(array_.Size());
+    cua::CudaEvent event = array_.CopyToAsync(result.data());
+    event.Synchronize();
+    CUDA_CHECK_ERROR
+    EXPECT_TRUE(event.Query());
+
+    for (IndexType i = 0; i < array_.Size(); ++i) {
+      EXPECT_EQ(result[i], data[i]) << "Index: " << i;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+
   void CheckView() {
     ASSERT_GT(array_.Height(), 1);
     ASSERT_GT(array_.Depth(), 1);
@@ -311,6 +331,64 @@ class CudaArray3DBaseTest
 
   //----------------------------------------------------------------------------
 
+  void CheckLaunchModes() {
+    // non-cubic, so that each grid dimension must come from its own extent
+    CudaArrayType array(37, 19, 11);
+    array.SetBlockDim(dim3(8, 4, 2));
+    EXPECT_EQ(array.GridDim().x, 5);
+    EXPECT_EQ(array.GridDim().y, 5);
+    EXPECT_EQ(array.GridDim().z, 6);
+
+    const SizeType width = array.Width();
+    const SizeType height = array.Height();
+    const cua::LaunchMode modes[] = {cua::LaunchMode::kOneThreadPerElement,
+                                     cua::LaunchMode::kOccupancy,
+                                     cua::LaunchMode::kPersistent};
+    for (const cua::LaunchMode mode : modes) {
+      array.SetLaunchMode(mode);
+      array.Fill(AsScalar(0));
+      array.ApplyOp([=] __device__(IndexType x, IndexType y, IndexType z) {
+        return AsScalar((z * height + y) * width + x);
+      });
+      array += AsScalar(1);
+      DownloadAndCheck(array, [=](IndexType x, IndexType y, IndexType z) {
+        return AsScalar((z * height + y) * width + x + 1);
+      });
+    }
+  }
+
+  //----------------------------------------------------------------------------
+
+  void CheckApplyOpSharedMemory() {
+    // more blocks than a persistent launch would use, so a grid-stride launch
+    // would hand several elements to the same thread
+    CudaArrayType array(37, 19, 11);
+    array.SetBlockDim(dim3(8, 4, 2));
+    array.SetLaunchMode(cua::LaunchMode::kPersistent);
+
+    const SizeType width = array.Width();
+    const SizeType height = array.Height();
+    array.ApplyOp(
+        [=] __device__(IndexType x, IndexType y, IndexType z) {
+          extern __shared__ IndexType thread_values[];
+          const unsigned int i =
+              (threadIdx.z * blockDim.y + threadIdx.y) * blockDim.x +
+              threadIdx.x;
+          thread_values[i] = (z * height + y) * width + x + 1;
+          const bool is_own_element =
+              (x == blockIdx.x * blockDim.x + threadIdx.x &&
+               y == blockIdx.y * blockDim.y + threadIdx.y &&
+               z == blockIdx.z * blockDim.z + threadIdx.z);
+          return AsScalar(is_own_element ? thread_values[i] : 0);
+        },
+        8 * 4 * 2 * sizeof(IndexType));
+    DownloadAndCheck(array, [=](IndexType x, IndexType y, IndexType z) {
+      return AsScalar((z * height + y) * width + x + 1);
+    });
+  }
+
+  //----------------------------------------------------------------------------
+
   template <typename OtherType>
   void CheckCopyTo() {
     const SizeType width = array_.Width();
@@ -357,6 +435,102 @@ class CudaArray3DBaseTest
 
   //----------------------------------------------------------------------------
 
+  void CheckPermute() {
+    // not a cube, and not a multiple of the tile size along x or y
+    const SizeType width = 37, height = 20, depth = 5;
+    const SizeType sizes[3] = {width, height, depth};
+    CudaArrayType array(width, height, depth);
+    array.ApplyOp([=] __device__(IndexType x, IndexType y, IndexType z) {
+      return AsScalar((z * height + y) * width + x);
+    });
+
+    const cua::AxisPermutation permutations[] = {
+        cua::AxisPermutation::kXYZ, cua::AxisPermutation::kXZY,
+        cua::AxisPermutation::kYXZ, cua::AxisPermutation::kYZX,
+        cua::AxisPermutation::kZXY, cua::AxisPermutation::kZYX};
+    for (const cua::AxisPermutation permutation : permutations) {
+      const int axes[3] = {cua::internal::PermutedAxis(permutation, 0),
+                           cua::internal::PermutedAxis(permutation, 1),
+                           cua::internal::PermutedAxis(permutation, 2)};
+      const CudaArrayType permuted = array.Permute(permutation);
+      ASSERT_EQ(permuted.Width(), sizes[axes[0]]);
+      ASSERT_EQ(permuted.Height(), sizes[axes[1]]);
+      ASSERT_EQ(permuted.Depth(), sizes[axes[2]]);
+
+      DownloadAndCheck(permuted, [=](IndexType x, IndexType y, IndexType z) {
+        IndexType coords[3];  // in the original array
+        coords[axes[0]] = x;
+        coords[axes[1]] = y;
+        coords[axes[2]] = z;
+        return AsScalar((coords[2] * height + coords[1]) * width + coords[0]);
+      });
+    }
+  }
+
+  //----------------------------------------------------------------------------
+
+  void CheckFlipsAndRotations() {
+    const SizeType width = 37, height = 20, depth = 5;
+    CudaArrayType array(width, height, depth);
+    array.ApplyOp([=] __device__(IndexType x, IndexType y, IndexType z) {
+      return AsScalar((z * height + y) * width + x);
+    });
+    // value of the original array at (x, y, z)
+    const auto value = [=](IndexType x, IndexType y, IndexType z) {
+      return AsScalar((z * height + y) * width + x);
+    };
+
+    DownloadAndCheck(array.FlipX(), [=](IndexType x, IndexType y, IndexType z) {
+      return value(width - 1 - x, y, z);
+    });
+    DownloadAndCheck(array.FlipY(), [=](IndexType x, IndexType y, IndexType z) {
+      return value(x, height - 1 - y, z);
+    });
+    DownloadAndCheck(array.FlipZ(), [=](IndexType x, IndexType y, IndexType z) {
+      return value(x, y, depth - 1 - z);
+    });
+
+    DownloadAndCheck(array.Rot180(cua::Axis::kX),
+                     [=](IndexType x, IndexType y, IndexType z) {
+                       return value(x, height - 1 - y, depth - 1 - z);
+                     });
+    DownloadAndCheck(array.Rot180(cua::Axis::kY),
+                     [=](IndexType x, IndexType y, IndexType z) {
+                       return value(width - 1 - x, y, depth - 1 - z);
+                     });
+    DownloadAndCheck(array.Rot180(cua::Axis::kZ),
+                     [=](IndexType x, IndexType y, IndexType z) {
+                       return value(width - 1 - x, height - 1 - y, z);
+                     });
+
+    DownloadAndCheck(array.Rot90_CW(cua::Axis::kX),
+                     [=](IndexType x, IndexType y, IndexType z) {
+                       return value(x, z, depth - 1 - y);
+                     });
+    DownloadAndCheck(array.Rot90_CCW(cua::Axis::kX),
+                     [=](IndexType x, IndexType y, IndexType z) {
+                       return value(x, height - 1 - z, y);
+                     });
+    DownloadAndCheck(array.Rot90_CW(cua::Axis::kY),
+                     [=](IndexType x, IndexType y, IndexType z) {
+                       return value(width - 1 - z, y, x);
+                     });
+    DownloadAndCheck(array.Rot90_CCW(cua::Axis::kY),
+                     [=](IndexType x, IndexType y, IndexType z) {
+                       return value(z, y, depth - 1 - x);
+                     });
+    DownloadAndCheck(array.Rot90_CW(cua::Axis::kZ),
+                     [=](IndexType x, IndexType y, IndexType z) {
+                       return value(y, height - 1 - x, z);
+                     });
+    DownloadAndCheck(array.Rot90_CCW(cua::Axis::kZ),
+                     [=](IndexType x, IndexType y, IndexType z) {
+                       return value(width - 1 - y, x, z);
+                     });
+  }
+
+  //----------------------------------------------------------------------------
+
   /*
   template <typename OtherType,
             typename std::enable_if<std::is_same<
@@ -411,6 +585,10 @@ TYPED_TEST_SUITE_P(CudaArray3DBaseTest);
 
 TYPED_TEST_P(CudaArray3DBaseTest, TestUpload) { this->CheckUpload(); }
 
+TYPED_TEST_P(CudaArray3DBaseTest, TestAsyncRoundTrip) {
+  this->CheckAsyncRoundTrip();
+}
+
 TYPED_TEST_P(CudaArray3DBaseTest, TestView) { this->CheckView(); }
 
 TYPED_TEST_P(CudaArray3DBaseTest, TestViewDownload) {
@@ -455,6 +633,14 @@ TYPED_TEST_P(CudaArray3DBaseTest, TestApplyOpUpdate) {
   this->CheckApplyOpUpdate(this->AsScalar(3));
 }
 
+TYPED_TEST_P(CudaArray3DBaseTest, TestLaunchModes) {
+  this->CheckLaunchModes();
+}
+
+TYPED_TEST_P(CudaArray3DBaseTest, TestApplyOpSharedMemory) {
+  this->CheckApplyOpSharedMemory();
+}
+
 TYPED_TEST_P(CudaArray3DBaseTest, TestCopyToArray) {
   this->CheckCopyToArray();
 }
@@ -475,13 +661,22 @@ TYPED_TEST_P(CudaArray3DBaseTest, TestCopyToTexture2DArray) {
   this->CheckCopyToTexture2DArray();
 }
 
-REGISTER_TYPED_TEST_SUITE_P(CudaArray3DBaseTest, TestUpload, TestView,
-                            TestViewDownload, TestViewUpload, TestNestedViews,
-                            TestFill, TestInPlaceAdd, TestInPlaceSubtract,
+TYPED_TEST_P(CudaArray3DBaseTest, TestPermute) { this->CheckPermute(); }
+
+TYPED_TEST_P(CudaArray3DBaseTest, TestFlipsAndRotations) {
+  this->CheckFlipsAndRotations();
+}
+
+REGISTER_TYPED_TEST_SUITE_P(CudaArray3DBaseTest, TestUpload,
+                            TestAsyncRoundTrip, TestView, TestViewDownload,
+                            TestViewUpload, TestNestedViews, TestFill,
+                            TestInPlaceAdd, TestInPlaceSubtract,
                             TestInPlaceMultiply, TestInPlaceDivide,
                             TestApplyOpConstant, TestApplyOpLinear,
-                            TestApplyOpUpdate, TestCopyToArray,
+                            TestApplyOpUpdate, TestLaunchModes,
+                            TestApplyOpSharedMemory, TestCopyToArray,
                             TestCopyToSurface3D, TestCopyToSurface2DArray,
-                            TestCopyToTexture3D, TestCopyToTexture2DArray);
+                            TestCopyToTexture3D, TestCopyToTexture2DArray,
+                            TestPermute, TestFlipsAndRotations);
 
 #endif  // CUDA_ARRAY3D_BASE_TEST_H_
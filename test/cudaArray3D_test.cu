@@ -35,6 +35,8 @@
 
 #include "cudaArray3D.h"
 
+#include <vector>
+
 #include "gtest/gtest.h"
 
 #include "cudaArray3DBase_test.h"
@@ -52,4 +54,32 @@ typedef ::testing::Types<
 
 INSTANTIATE_TYPED_TEST_SUITE_P(CudaArray3DTest, CudaArray3DBaseTest, Types);
 
+//------------------------------------------------------------------------------
+
+TEST(CudaArray3DTest, TestFreeAfterPeerCopyToAsync) {
+  int num_devices = 0;
+  cudaGetDeviceCount(&num_devices);
+  if (num_devices < 2) {
+    return;  // needs a second GPU
+  }
+
+  const size_t w = 256, h = 256, d = 64;
+  cua::CudaArray3D<float> src(w, h, d, 0);
+  src.Fill(1.f);
+  {
+    cua::CudaArray3D<float> dst(w, h, d, 1);
+    src.CopyToAsync(&dst);
+  }  // dst is released before the copy has finished
+
+  // if this reused dst's memory too early, the copy would overwrite it
+  cua::CudaArray3D<float> reused(w, h, d, 1);
+  reused.Fill(2.f);
+  std::vector<float> result(reused.Size());
+  reused.CopyTo(result.data());
+  for (size_t i = 0; i < result.size(); ++i) {
+    ASSERT_EQ(result[i], 2.f) << "Index: " << i;
+  }
+  CUDA_CHECK_ERROR
+}
+
 }  // namespace
@@ -0,0 +1,351 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cudaHostArray2D.h"
+#include "cudaHostArray3D.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "util.h"
+
+namespace {
+
+typedef cua::CudaHostArray2D<float> HostArray2D;
+typedef cua::CudaHostArray3D<float> HostArray3D;
+
+//------------------------------------------------------------------------------
+
+template <typename ArrayType, typename HostFunction>
+void Check2D(const ArrayType &array, const HostFunction &host_function) {
+  std::vector<typename ArrayType::Scalar> result(array.Size());
+  array.CopyTo(result.data());
+  for (size_t y = 0; y < array.Height(); ++y) {
+    for (size_t x = 0; x < array.Width(); ++x) {
+      EXPECT_EQ(result[y * array.Width() + x], host_function(x, y))
+          << "Coordinate: " << x << " " << y;
+    }
+  }
+}
+
+template <typename ArrayType, typename HostFunction>
+void Check3D(const ArrayType &array, const HostFunction &host_function) {
+  std::vector<typename ArrayType::Scalar> result(array.Size());
+  array.CopyTo(result.data());
+  for (size_t z = 0; z < array.Depth(); ++z) {
+    for (size_t y = 0; y < array.Height(); ++y) {
+      for (size_t x = 0; x < array.Width(); ++x) {
+        const size_t i = (z * array.Height() + y) * array.Width() + x;
+        EXPECT_EQ(result[i], host_function(x, y, z))
+            << "Coordinate: " << x << " " << y << " " << z;
+      }
+    }
+  }
+}
+
+// value stored at (x, y) by FillLinear2D
+inline float Linear2D(size_t x, size_t y) { return y * 1000.f + x; }
+
+void FillLinear2D(HostArray2D *array) {
+  array->ApplyOp([] __host__ __device__(unsigned int x, unsigned int y) {
+    return y * 1000.f + x;
+  });
+}
+
+//------------------------------------------------------------------------------
+//
+// 2D tests
+//
+//------------------------------------------------------------------------------
+
+TEST(CudaHostArray2DTest, TestUpload) {
+  HostArray2D array(37, 23);
+  std::vector<float> data(array.Size());
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<float>(i);
+  }
+  array = data.data();
+  Check2D(array, [](size_t x, size_t y) { return y * 37.f + x; });
+}
+
+TEST(CudaHostArray2DTest, TestFillAndArithmetic) {
+  // large enough to be split across several threads
+  HostArray2D array(517, 301);
+  array.Fill(3.f);
+  Check2D(array, [](size_t, size_t) { return 3.f; });
+  array += 2.f;
+  Check2D(array, [](size_t, size_t) { return 5.f; });
+  array -= 1.f;
+  Check2D(array, [](size_t, size_t) { return 4.f; });
+  array *= 3.f;
+  Check2D(array, [](size_t, size_t) { return 12.f; });
+  array /= 4.f;
+  Check2D(array, [](size_t, size_t) { return 3.f; });
+}
+
+TEST(CudaHostArray2DTest, TestGetSetValue) {
+  HostArray2D array(5, 4);
+  array.Fill(0.f);
+  array.SetValue(3, 2, 7.f);
+  EXPECT_EQ(array.GetValue(3, 2), 7.f);
+  EXPECT_EQ(array.GetValue(2, 3), 0.f);
+}
+
+TEST(CudaHostArray2DTest, TestViews) {
+  HostArray2D array(11, 9);
+  array.Fill(1.f);
+  auto view = array.View(1, 1, 9, 7);
+  view.Fill(2.f);
+  view.View(1, 1, 7, 5).Fill(3.f);
+  Check2D(array, [](size_t x, size_t y) {
+    if (x > 1 && x < 9 && y > 1 && y < 7) return 3.f;
+    if (x > 0 && x < 10 && y > 0 && y < 8) return 2.f;
+    return 1.f;
+  });
+}
+
+TEST(CudaHostArray2DTest, TestCopyTo) {
+  HostArray2D array(29, 17, cua::HostMemoryType::kPageable);
+  FillLinear2D(&array);
+  HostArray2D other = array.Copy();
+  array.Fill(0.f);
+  Check2D(other, Linear2D);
+}
+
+TEST(CudaHostArray2DTest, TestFlipsAndRotations) {
+  const size_t w = 45, h = 38;  // not multiples of the tile size
+  HostArray2D array(w, h);
+  FillLinear2D(&array);
+
+  HostArray2D same(w, h), flipped(h, w);
+
+  array.FlipLR(&same);
+  Check2D(same, [=](size_t x, size_t y) { return Linear2D(w - 1 - x, y); });
+  array.FlipUD(&same);
+  Check2D(same, [=](size_t x, size_t y) { return Linear2D(x, h - 1 - y); });
+  array.Rot180(&same);
+  Check2D(same,
+          [=](size_t x, size_t y) { return Linear2D(w - 1 - x, h - 1 - y); });
+  array.Transpose(&flipped);
+  Check2D(flipped, [=](size_t x, size_t y) { return Linear2D(y, x); });
+  array.Rot90_CW(&flipped);
+  Check2D(flipped, [=](size_t x, size_t y) { return Linear2D(y, h - 1 - x); });
+  array.Rot90_CCW(&flipped);
+  Check2D(flipped, [=](size_t x, size_t y) { return Linear2D(w - 1 - y, x); });
+}
+
+TEST(CudaHostArray2DTest, TestInPlaceRotations) {
+  const size_t n = 45;  // not a multiple of the tile size
+  HostArray2D array(n, n);
+  FillLinear2D(&array);
+
+  array.TransposeInPlace();
+  Check2D(array, [=](size_t x, size_t y) { return Linear2D(y, x); });
+  array.Rot90_CWInPlace();
+  Check2D(array, [=](size_t x, size_t y) { return Linear2D(n - 1 - x, y); });
+  array.Rot90_CCWInPlace();
+  Check2D(array, [=](size_t x, size_t y) { return Linear2D(y, x); });
+
+  HostArray2D rectangular(n, n - 1);
+  EXPECT_THROW(rectangular.TransposeInPlace(), std::runtime_error);
+}
+
+TEST(CudaHostArray2DTest, TestVectorType) {
+  const size_t w = 37, h = 23;
+  const auto value = [=](size_t x, size_t y) {
+    return make_uchar4(x, y, x + y, 255);
+  };
+  cua::CudaHostArray2D<uchar4> array(w, h);
+  std::vector<uchar4> data(array.Size());
+  for (size_t y = 0; y < h; ++y) {
+    for (size_t x = 0; x < w; ++x) {
+      data[y * w + x] = value(x, y);
+    }
+  }
+  array = data.data();
+  Check2D(array, value);
+
+  cua::CudaHostArray2D<uchar4> flipped(w, h);
+  array.FlipLR(&flipped);
+  Check2D(flipped, [=](size_t x, size_t y) { return value(w - 1 - x, y); });
+
+  array.View(1, 1, w - 2, h - 2).Fill(make_uchar4(0, 0, 0, 0));
+  Check2D(array, [=](size_t x, size_t y) {
+    return (x > 0 && x < w - 1 && y > 0 && y < h - 1) ? make_uchar4(0, 0, 0, 0)
+                                                      : value(x, y);
+  });
+}
+
+//------------------------------------------------------------------------------
+//
+// 3D tests
+//
+//------------------------------------------------------------------------------
+
+TEST(CudaHostArray3DTest, TestUploadAndCopy) {
+  HostArray3D array(13, 7, 5);
+  std::vector<float> data(array.Size());
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<float>(i);
+  }
+  array = data.data();
+
+  HostArray3D other = array.Copy();
+  array.Fill(0.f);
+  Check3D(other, [](size_t x, size_t y, size_t z) {
+    return (z * 7.f + y) * 13.f + x;
+  });
+}
+
+TEST(CudaHostArray3DTest, TestApplyOpAndArithmetic) {
+  HostArray3D array(64, 33, 17);
+  array.ApplyOp([] __host__ __device__(unsigned int x, unsigned int y,
+                                       unsigned int z) {
+    return static_cast<float>(x + y + z);
+  });
+  array *= 2.f;
+  array += 1.f;
+  Check3D(array, [](size_t x, size_t y, size_t z) {
+    return 2.f * (x + y + z) + 1.f;
+  });
+}
+
+TEST(CudaHostArray3DTest, TestIntegralType) {
+  const size_t w = 19, h = 11, d = 5;
+  cua::CudaHostArray3D<int> array(w, h, d);
+  array.ApplyOp([=] __host__ __device__(unsigned int x, unsigned int y,
+                                        unsigned int z) {
+    return static_cast<int>((z * h + y) * w + x) - 100;
+  });
+  array *= 3;
+  array -= 1;
+  const auto value = [=](size_t x, size_t y, size_t z) {
+    return 3 * (static_cast<int>((z * h + y) * w + x) - 100) - 1;
+  };
+  Check3D(array, value);
+  Check3D(array.FlipY(), [=](size_t x, size_t y, size_t z) {
+    return value(x, h - 1 - y, z);
+  });
+}
+
+TEST(CudaHostArray3DTest, TestViews) {
+  HostArray3D array(6, 5, 4);
+  array.Fill(1.f);
+  array.View(1, 1, 1, 4, 3, 2).Fill(2.f);
+  Check3D(array, [](size_t x, size_t y, size_t z) {
+    return (x > 0 && x < 5 && y > 0 && y < 4 && z > 0 && z < 3) ? 2.f : 1.f;
+  });
+}
+
+TEST(CudaHostArray3DTest, TestPermute) {
+  const size_t w = 45, h = 38, d = 7;  // more than one tile along x and y
+  HostArray3D array(w, h, d);
+  array.ApplyOp([=] __host__ __device__(unsigned int x, unsigned int y,
+                                        unsigned int z) {
+    return static_cast<float>((z * h + y) * w + x);
+  });
+
+  const cua::AxisPermutation permutations[] = {
+      cua::AxisPermutation::kXYZ, cua::AxisPermutation::kXZY,
+      cua::AxisPermutation::kYXZ, cua::AxisPermutation::kYZX,
+      cua::AxisPermutation::kZXY, cua::AxisPermutation::kZYX};
+  for (const cua::AxisPermutation permutation : permutations) {
+    const int axes[3] = {cua::internal::PermutedAxis(permutation, 0),
+                         cua::internal::PermutedAxis(permutation, 1),
+                         cua::internal::PermutedAxis(permutation, 2)};
+    Check3D(array.Permute(permutation), [=](size_t x, size_t y, size_t z) {
+      size_t coords[3];  // in the original array
+      coords[axes[0]] = x;
+      coords[axes[1]] = y;
+      coords[axes[2]] = z;
+      return static_cast<float>((coords[2] * h + coords[1]) * w + coords[0]);
+    });
+  }
+
+  HostArray3D same_size(w, h, d);
+  EXPECT_THROW(array.Permute(cua::AxisPermutation::kZXY, &same_size),
+               std::runtime_error);
+}
+
+TEST(CudaHostArray3DTest, TestFlipsAndRotations) {
+  const size_t w = 45, h = 38, d = 7;
+  HostArray3D array(w, h, d);
+  array.ApplyOp([=] __host__ __device__(unsigned int x, unsigned int y,
+                                        unsigned int z) {
+    return static_cast<float>((z * h + y) * w + x);
+  });
+  const auto value = [=](size_t x, size_t y, size_t z) {
+    return static_cast<float>((z * h + y) * w + x);
+  };
+
+  Check3D(array.FlipX(), [=](size_t x, size_t y, size_t z) {
+    return value(w - 1 - x, y, z);
+  });
+  Check3D(array.FlipZ(), [=](size_t x, size_t y, size_t z) {
+    return value(x, y, d - 1 - z);
+  });
+  Check3D(array.Rot180(cua::Axis::kY), [=](size_t x, size_t y, size_t z) {
+    return value(w - 1 - x, y, d - 1 - z);
+  });
+  Check3D(array.Rot90_CW(cua::Axis::kX), [=](size_t x, size_t y, size_t z) {
+    return value(x, z, d - 1 - y);
+  });
+  Check3D(array.Rot90_CCW(cua::Axis::kY), [=](size_t x, size_t y, size_t z) {
+    return value(z, y, d - 1 - x);
+  });
+  Check3D(array.Rot90_CW(cua::Axis::kZ), [=](size_t x, size_t y, size_t z) {
+    return value(y, h - 1 - x, z);
+  });
+
+  // rotating back restores the array
+  HostArray3D rotated = array.Rot90_CW(cua::Axis::kY);
+  HostArray3D restored(w, h, d);
+  rotated.Rot90_CCW(cua::Axis::kY, &restored);
+  Check3D(restored, value);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(HostThreadPoolTest, TestParallelForCoversAllTasks) {
+  cua::internal::HostThreadPool pool(4);
+  std::vector<int> counts(1000, 0);
+  pool.ParallelFor(counts.size(), [&](size_t i) { ++counts[i]; });
+  for (size_t i = 0; i < counts.size(); ++i) {
+    EXPECT_EQ(counts[i], 1) << "Task: " << i;
+  }
+}
+
+}  // namespace
@@ -0,0 +1,291 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <vector>
+
+#include "cudaArray2D.h"
+#include "cudaHostArray2D.h"
+#include "cudaMipmappedTexture2D.h"
+#include "mipmap.h"
+
+#include "gtest/gtest.h"
+
+#include "util.h"
+
+namespace {
+
+template <typename CudaTextureType>
+class CudaMipmappedTexture2DTest
+    : public ::testing::Test,
+      public PrimitiveConverter<typename CudaTextureType::Scalar> {
+ public:
+  typedef typename CudaTextureType::Scalar Scalar;
+  using PrimitiveConverter<Scalar>::AsScalar;
+
+  //----------------------------------------------------------------------------
+
+  // odd extents, so that some levels round down
+  CudaMipmappedTexture2DTest(size_t width = 37, size_t height = 20)
+      : texture_(width, height) {}
+
+  //----------------------------------------------------------------------------
+
+  static void CheckEqual(const std::vector<Scalar>& result,
+                         const std::vector<Scalar>& expected, size_t width,
+                         unsigned int level) {
+    ASSERT_EQ(result.size(), expected.size());
+    for (size_t i = 0; i < result.size(); ++i) {
+      EXPECT_EQ(result[i], expected[i])
+          << "Level: " << level << " Coordinate: " << i % width << " "
+          << i / width;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+
+  std::vector<Scalar> LevelData(unsigned int level) const {
+    const size_t width = texture_.LevelWidth(level);
+    const size_t height = texture_.LevelHeight(level);
+    std::vector<Scalar> data(width * height);
+    for (size_t y = 0; y < height; ++y) {
+      for (size_t x = 0; x < width; ++x) {
+        data[y * width + x] = AsScalar((7 * x + 13 * y + 31 * level) % 200);
+      }
+    }
+    return data;
+  }
+
+  std::vector<Scalar> DownloadLevel(unsigned int level) const {
+    CUDA_CHECK_ERROR
+    std::vector<Scalar> result(texture_.LevelWidth(level) *
+                               texture_.LevelHeight(level));
+    texture_.CopyLevelTo(level, result.data());
+    CUDA_CHECK_ERROR
+    return result;
+  }
+
+  //----------------------------------------------------------------------------
+
+  void CheckLevelSizes() {
+    // 37x20 -> 18x10 -> 9x5 -> 4x2 -> 2x1 -> 1x1
+    ASSERT_EQ(texture_.NumLevels(), 6u);
+    const size_t widths[] = {37, 18, 9, 4, 2, 1};
+    const size_t heights[] = {20, 10, 5, 2, 1, 1};
+    for (unsigned int level = 0; level < texture_.NumLevels(); ++level) {
+      EXPECT_EQ(texture_.LevelWidth(level), widths[level]);
+      EXPECT_EQ(texture_.LevelHeight(level), heights[level]);
+    }
+
+    CudaTextureType truncated(37, 20, -1, 3);
+    EXPECT_EQ(truncated.NumLevels(), 3u);
+  }
+
+  //----------------------------------------------------------------------------
+
+  void CheckAssignLevels() {
+    for (unsigned int level = 0; level < texture_.NumLevels(); ++level) {
+      texture_.AssignLevel(level, LevelData(level).data());
+    }
+    for (unsigned int level = 0; level < texture_.NumLevels(); ++level) {
+      CheckEqual(DownloadLevel(level), LevelData(level),
+                 texture_.LevelWidth(level), level);
+    }
+
+    // level 0 is also the array itself
+    cua::CudaArray2D<Scalar> array(texture_.Width(), texture_.Height());
+    texture_.CopyTo(&array);
+    std::vector<Scalar> result(array.Size());
+    array.CopyTo(result.data());
+    CheckEqual(result, LevelData(0), texture_.Width(), 0);
+  }
+
+  //----------------------------------------------------------------------------
+
+  void CheckGenerateMipmaps(const cua::MipmapFilter filter) {
+    texture_ = LevelData(0).data();
+    texture_.GenerateMipmaps(filter);
+
+    // host reference pyramid
+    cua::CudaHostArray2D<Scalar> reference(texture_.Width(),
+                                           texture_.Height());
+    reference = LevelData(0).data();
+    for (unsigned int level = 1; level < texture_.NumLevels(); ++level) {
+      cua::CudaHostArray2D<Scalar> next(texture_.LevelWidth(level),
+                                        texture_.LevelHeight(level));
+      cua::host::MipmapDownsample2D(reference, next, filter);
+      reference = next;
+
+      std::vector<Scalar> expected(reference.Size());
+      reference.CopyTo(expected.data());
+      CheckEqual(DownloadLevel(level), expected, reference.Width(), level);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+
+  void CheckLod() {
+    for (unsigned int level = 0; level < texture_.NumLevels(); ++level) {
+      texture_.AssignLevel(level, LevelData(level).data());
+    }
+
+    const auto view = texture_.DeviceView();
+    for (unsigned int level = 0; level < texture_.NumLevels(); ++level) {
+      // sample at the element centers of the level, in level-0 coordinates
+      const float scale_x = static_cast<float>(texture_.Width()) /
+                            texture_.LevelWidth(level);
+      const float scale_y = static_cast<float>(texture_.Height()) /
+                            texture_.LevelHeight(level);
+      const float lod = level;
+
+      cua::CudaArray2D<Scalar> result(texture_.LevelWidth(level),
+                                      texture_.LevelHeight(level));
+      result.ApplyOp([=] __device__(size_t x, size_t y) {
+        return view.lod((x + 0.5f) * scale_x, (y + 0.5f) * scale_y, lod);
+      });
+
+      std::vector<Scalar> values(result.Size());
+      result.CopyTo(values.data());
+      CheckEqual(values, LevelData(level), result.Width(), level);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+
+  void CheckGrad() {
+    // power-of-two extents, so that the footprint of a level-l element is
+    // exactly 2^l elements of level 0 along both axes
+    CudaTextureType texture(32, 32);
+    for (unsigned int level = 0; level < texture.NumLevels(); ++level) {
+      std::vector<Scalar> data(texture.LevelWidth(level) *
+                               texture.LevelHeight(level));
+      for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = AsScalar((i + 31 * level) % 200);
+      }
+      texture.AssignLevel(level, data.data());
+    }
+
+    const auto view = texture.DeviceView();
+    for (unsigned int level = 0; level < texture.NumLevels(); ++level) {
+      const float scale = static_cast<float>(1 << level);
+      const float2 dx = make_float2(scale, 0.f);
+      const float2 dy = make_float2(0.f, scale);
+
+      cua::CudaArray2D<Scalar> result(texture.LevelWidth(level),
+                                      texture.LevelHeight(level));
+      result.ApplyOp([=] __device__(size_t x, size_t y) {
+        return view.grad((x + 0.5f) * scale, (y + 0.5f) * scale, dx, dy);
+      });
+
+      std::vector<Scalar> expected(result.Size());
+      texture.CopyLevelTo(level, expected.data());
+      std::vector<Scalar> values(result.Size());
+      result.CopyTo(values.data());
+      CheckEqual(values, expected, result.Width(), level);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+
+ private:
+  CudaTextureType texture_;
+};
+
+//------------------------------------------------------------------------------
+//
+// Test suite definition.
+//
+//------------------------------------------------------------------------------
+
+TYPED_TEST_SUITE_P(CudaMipmappedTexture2DTest);
+
+TYPED_TEST_P(CudaMipmappedTexture2DTest, TestLevelSizes) {
+  this->CheckLevelSizes();
+}
+
+TYPED_TEST_P(CudaMipmappedTexture2DTest, TestAssignLevels) {
+  this->CheckAssignLevels();
+}
+
+TYPED_TEST_P(CudaMipmappedTexture2DTest, TestGenerateBox) {
+  this->CheckGenerateMipmaps(cua::MipmapFilter::kBox);
+}
+
+TYPED_TEST_P(CudaMipmappedTexture2DTest, TestGenerateGaussian) {
+  this->CheckGenerateMipmaps(cua::MipmapFilter::kGaussian);
+}
+
+TYPED_TEST_P(CudaMipmappedTexture2DTest, TestLod) { this->CheckLod(); }
+
+TYPED_TEST_P(CudaMipmappedTexture2DTest, TestGrad) { this->CheckGrad(); }
+
+REGISTER_TYPED_TEST_SUITE_P(CudaMipmappedTexture2DTest, TestLevelSizes,
+                            TestAssignLevels, TestGenerateBox,
+                            TestGenerateGaussian, TestLod, TestGrad);
+
+typedef ::testing::Types<cua::CudaMipmappedTexture2D<float>,
+                         cua::CudaMipmappedTexture2D<float2>,
+                         cua::CudaMipmappedTexture2D<float4>,
+                         cua::CudaMipmappedTexture2D<unsigned char>,
+                         cua::CudaMipmappedTexture2D<uchar4>,
+                         cua::CudaMipmappedTexture2D<unsigned int>,
+                         cua::CudaMipmappedTexture2D<uint4> >
+    Types;
+
+INSTANTIATE_TYPED_TEST_SUITE_P(CudaMipmappedTexture2DTest,
+                               CudaMipmappedTexture2DTest, Types);
+
+//------------------------------------------------------------------------------
+
+TEST(MipmapDownsampleTest, TestHostReference) {
+  // src(x, y) = x + 8 * y
+  cua::CudaHostArray2D<float> src(8, 4);
+  src.ApplyOp([](size_t x, size_t y) { return static_cast<float>(x + 8 * y); });
+  cua::CudaHostArray2D<float> dst(4, 2);
+
+  // the box filter averages each 2x2 block
+  cua::host::MipmapDownsample2D(src, dst, cua::MipmapFilter::kBox);
+  EXPECT_EQ(dst.get(0, 0), 4.5f);   // (0 + 1 + 8 + 9) / 4
+  EXPECT_EQ(dst.get(3, 1), 26.5f);  // 6.5 + 8 * 2.5
+
+  // the binomial filter preserves linear functions away from the border;
+  // reads past the border are clamped to the edge
+  cua::host::MipmapDownsample2D(src, dst, cua::MipmapFilter::kGaussian);
+  EXPECT_EQ(dst.get(1, 0), 7.5f);   // 2.5 + 8 * (0 + 0 + 3 + 2) / 8
+  EXPECT_EQ(dst.get(2, 1), 23.5f);  // 4.5 + 8 * (1 + 6 + 9 + 3) / 8
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace
@@ -0,0 +1,282 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <vector>
+
+#include "cudaArray3D.h"
+#include "cudaHostArray3D.h"
+#include "cudaMipmappedTexture3D.h"
+#include "mipmap.h"
+
+#include "gtest/gtest.h"
+
+#include "util.h"
+
+namespace {
+
+template <typename CudaTextureType>
+class CudaMipmappedTexture3DTest
+    : public ::testing::Test,
+      public PrimitiveConverter<typename CudaTextureType::Scalar> {
+ public:
+  typedef typename CudaTextureType::Scalar Scalar;
+  using PrimitiveConverter<Scalar>::AsScalar;
+
+  //----------------------------------------------------------------------------
+
+  // odd extents, so that some levels round down
+  CudaMipmappedTexture3DTest(size_t width = 13, size_t height = 10,
+                             size_t depth = 6)
+      : texture_(width, height, depth) {}
+
+  //----------------------------------------------------------------------------
+
+  static void CheckEqual(const std::vector<Scalar>& result,
+                         const std::vector<Scalar>& expected,
+                         unsigned int level) {
+    ASSERT_EQ(result.size(), expected.size());
+    for (size_t i = 0; i < result.size(); ++i) {
+      EXPECT_EQ(result[i], expected[i]) << "Level: " << level << " Index: "
+                                        << i;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+
+  static size_t LevelSize(const CudaTextureType& texture, unsigned int level) {
+    return texture.LevelWidth(level) * texture.LevelHeight(level) *
+           texture.LevelDepth(level);
+  }
+
+  std::vector<Scalar> LevelData(unsigned int level) const {
+    const size_t width = texture_.LevelWidth(level);
+    const size_t height = texture_.LevelHeight(level);
+    std::vector<Scalar> data(LevelSize(texture_, level));
+    for (size_t i = 0; i < data.size(); ++i) {
+      const size_t x = i % width, y = (i / width) % height,
+                   z = i / (width * height);
+      data[i] = AsScalar((7 * x + 13 * y + 5 * z + 31 * level) % 200);
+    }
+    return data;
+  }
+
+  std::vector<Scalar> DownloadLevel(const CudaTextureType& texture,
+                                    unsigned int level) const {
+    CUDA_CHECK_ERROR
+    std::vector<Scalar> result(LevelSize(texture, level));
+    texture.CopyLevelTo(level, result.data());
+    CUDA_CHECK_ERROR
+    return result;
+  }
+
+  //----------------------------------------------------------------------------
+
+  void CheckLevelSizes() {
+    // 13x10x6 -> 6x5x3 -> 3x2x1 -> 1x1x1
+    ASSERT_EQ(texture_.NumLevels(), 4u);
+    const size_t widths[] = {13, 6, 3, 1};
+    const size_t heights[] = {10, 5, 2, 1};
+    const size_t depths[] = {6, 3, 1, 1};
+    for (unsigned int level = 0; level < texture_.NumLevels(); ++level) {
+      EXPECT_EQ(texture_.LevelWidth(level), widths[level]);
+      EXPECT_EQ(texture_.LevelHeight(level), heights[level]);
+      EXPECT_EQ(texture_.LevelDepth(level), depths[level]);
+    }
+
+    CudaTextureType truncated(13, 10, 6, -1, 2);
+    EXPECT_EQ(truncated.NumLevels(), 2u);
+  }
+
+  //----------------------------------------------------------------------------
+
+  void CheckAssignLevels() {
+    for (unsigned int level = 0; level < texture_.NumLevels(); ++level) {
+      texture_.AssignLevel(level, LevelData(level).data());
+    }
+    for (unsigned int level = 0; level < texture_.NumLevels(); ++level) {
+      CheckEqual(DownloadLevel(texture_, level), LevelData(level), level);
+    }
+
+    // level 0 is also the array itself
+    cua::CudaArray3D<Scalar> array(texture_.Width(), texture_.Height(),
+                                   texture_.Depth());
+    texture_.CopyTo(&array);
+    std::vector<Scalar> result(array.Size());
+    array.CopyTo(result.data());
+    CheckEqual(result, LevelData(0), 0);
+  }
+
+  //----------------------------------------------------------------------------
+
+  void CheckGenerateMipmaps(const cua::MipmapFilter filter) {
+    texture_ = LevelData(0).data();
+    texture_.GenerateMipmaps(filter);
+
+    // host reference pyramid
+    cua::CudaHostArray3D<Scalar> reference(texture_.Width(), texture_.Height(),
+                                           texture_.Depth());
+    reference = LevelData(0).data();
+    for (unsigned int level = 1; level < texture_.NumLevels(); ++level) {
+      cua::CudaHostArray3D<Scalar> next(texture_.LevelWidth(level),
+                                        texture_.LevelHeight(level),
+                                        texture_.LevelDepth(level));
+      cua::host::MipmapDownsample3D(reference, next, filter);
+      reference = next;
+
+      std::vector<Scalar> expected(reference.Size());
+      reference.CopyTo(expected.data());
+      CheckEqual(DownloadLevel(texture_, level), expected, level);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+
+  void CheckLod() {
+    for (unsigned int level = 0; level < texture_.NumLevels(); ++level) {
+      texture_.AssignLevel(level, LevelData(level).data());
+    }
+
+    const auto view = texture_.DeviceView();
+    for (unsigned int level = 0; level < texture_.NumLevels(); ++level) {
+      // sample at the element centers of the level, in level-0 coordinates
+      const float scale_x = static_cast<float>(texture_.Width()) /
+                            texture_.LevelWidth(level);
+      const float scale_y = static_cast<float>(texture_.Height()) /
+                            texture_.LevelHeight(level);
+      const float scale_z = static_cast<float>(texture_.Depth()) /
+                            texture_.LevelDepth(level);
+      const float lod = level;
+
+      cua::CudaArray3D<Scalar> result(texture_.LevelWidth(level),
+                                      texture_.LevelHeight(level),
+                                      texture_.LevelDepth(level));
+      result.ApplyOp([=] __device__(size_t x, size_t y, size_t z) {
+        return view.lod((x + 0.5f) * scale_x, (y + 0.5f) * scale_y,
+                        (z + 0.5f) * scale_z, lod);
+      });
+
+      std::vector<Scalar> values(result.Size());
+      result.CopyTo(values.data());
+      CheckEqual(values, LevelData(level), level);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+
+  void CheckGrad() {
+    // power-of-two extents, so that the footprint of a level-l element is
+    // exactly 2^l elements of level 0 along all axes
+    CudaTextureType texture(16, 16, 16);
+    for (unsigned int level = 0; level < texture.NumLevels(); ++level) {
+      std::vector<Scalar> data(LevelSize(texture, level));
+      for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = AsScalar((i + 31 * level) % 200);
+      }
+      texture.AssignLevel(level, data.data());
+    }
+
+    const auto view = texture.DeviceView();
+    for (unsigned int level = 0; level < texture.NumLevels(); ++level) {
+      const float scale = static_cast<float>(1 << level);
+      const float4 dx = make_float4(scale, 0.f, 0.f, 0.f);
+      const float4 dy = make_float4(0.f, scale, 0.f, 0.f);
+
+      cua::CudaArray3D<Scalar> result(texture.LevelWidth(level),
+                                      texture.LevelHeight(level),
+                                      texture.LevelDepth(level));
+      result.ApplyOp([=] __device__(size_t x, size_t y, size_t z) {
+        return view.grad((x + 0.5f) * scale, (y + 0.5f) * scale,
+                         (z + 0.5f) * scale, dx, dy);
+      });
+
+      std::vector<Scalar> values(result.Size());
+      result.CopyTo(values.data());
+      CheckEqual(values, DownloadLevel(texture, level), level);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+
+ private:
+  CudaTextureType texture_;
+};
+
+//------------------------------------------------------------------------------
+//
+// Test suite definition.
+//
+//------------------------------------------------------------------------------
+
+TYPED_TEST_SUITE_P(CudaMipmappedTexture3DTest);
+
+TYPED_TEST_P(CudaMipmappedTexture3DTest, TestLevelSizes) {
+  this->CheckLevelSizes();
+}
+
+TYPED_TEST_P(CudaMipmappedTexture3DTest, TestAssignLevels) {
+  this->CheckAssignLevels();
+}
+
+TYPED_TEST_P(CudaMipmappedTexture3DTest, TestGenerateBox) {
+  this->CheckGenerateMipmaps(cua::MipmapFilter::kBox);
+}
+
+TYPED_TEST_P(CudaMipmappedTexture3DTest, TestGenerateGaussian) {
+  this->CheckGenerateMipmaps(cua::MipmapFilter::kGaussian);
+}
+
+TYPED_TEST_P(CudaMipmappedTexture3DTest, TestLod) { this->CheckLod(); }
+
+TYPED_TEST_P(CudaMipmappedTexture3DTest, TestGrad) { this->CheckGrad(); }
+
+REGISTER_TYPED_TEST_SUITE_P(CudaMipmappedTexture3DTest, TestLevelSizes,
+                            TestAssignLevels, TestGenerateBox,
+                            TestGenerateGaussian, TestLod, TestGrad);
+
+typedef ::testing::Types<cua::CudaMipmappedTexture3D<float>,
+                         cua::CudaMipmappedTexture3D<float2>,
+                         cua::CudaMipmappedTexture3D<float4>,
+                         cua::CudaMipmappedTexture3D<unsigned char>,
+                         cua::CudaMipmappedTexture3D<uchar4>,
+                         cua::CudaMipmappedTexture3D<unsigned int>,
+                         cua::CudaMipmappedTexture3D<uint4> >
+    Types;
+
+INSTANTIATE_TYPED_TEST_SUITE_P(CudaMipmappedTexture3DTest,
+                               CudaMipmappedTexture3DTest, Types);
+
+//------------------------------------------------------------------------------
+
+}  // namespace
@@ -0,0 +1,218 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "cudaArray2D.h"
+#include "cudaPitchedTexture2D.h"
+
+#include "gtest/gtest.h"
+
+#include "util.h"
+
+namespace {
+
+template <typename CudaTextureType>
+class CudaPitchedTexture2DTest
+    : public ::testing::Test,
+      public PrimitiveConverter<typename CudaTextureType::Scalar> {
+ public:
+  typedef typename CudaTextureType::Scalar Scalar;
+  using PrimitiveConverter<Scalar>::AsScalar;
+
+  //----------------------------------------------------------------------------
+
+  CudaPitchedTexture2DTest(size_t width = 37, size_t height = 10)
+      : array_(width, height) {}
+
+  //----------------------------------------------------------------------------
+
+  template <typename CudaArrayType, typename HostFunction>
+  static void DownloadAndCheck(const CudaArrayType& array,
+                               const HostFunction& host_function) {
+    CUDA_CHECK_ERROR
+    std::vector<Scalar> result(array.Size());
+    array.CopyTo(result.data());
+    CUDA_CHECK_ERROR
+
+    for (size_t y = 0; y < array.Height(); ++y) {
+      for (size_t x = 0; x < array.Width(); ++x) {
+        const size_t i = y * array.Width() + x;
+        EXPECT_EQ(result[i], host_function(x, y)) << "Coordinate: " << x << " "
+                                                  << y;
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+
+  void Upload(size_t offset) {
+    std::vector<Scalar> data(array_.Size());
+    for (size_t i = 0; i < array_.Size(); ++i) {
+      data[i] = AsScalar(i + offset);
+    }
+    array_ = data.data();
+  }
+
+  //----------------------------------------------------------------------------
+
+  void CheckCopyTo() {
+    Upload(0);
+    CudaTextureType texture(array_);
+    EXPECT_EQ(texture.Width(), array_.Width());
+    EXPECT_EQ(texture.Height(), array_.Height());
+
+    const size_t width = array_.Width();
+    DownloadAndCheck(
+        texture, [=](size_t x, size_t y) { return AsScalar(y * width + x); });
+  }
+
+  //----------------------------------------------------------------------------
+
+  void CheckGet() {
+    Upload(0);
+    CudaTextureType texture(array_);
+
+    // the texture reads the array's memory directly, so later updates to the
+    // array are visible without re-binding
+    Upload(1);
+
+    cua::CudaArray2D<Scalar> result(array_.Width(), array_.Height());
+    const auto view = texture.DeviceView();
+    result.ApplyOp(
+        [=] __device__(size_t x, size_t y) { return view.get(x, y); });
+
+    const size_t width = array_.Width();
+    DownloadAndCheck(result, [=](size_t x, size_t y) {
+      return AsScalar(y * width + x + 1);
+    });
+  }
+
+  //----------------------------------------------------------------------------
+
+  void CheckLifetime() {
+    Upload(0);
+    CudaTextureType texture(array_);
+
+    // the texture keeps the underlying memory alive after the array is gone
+    array_ = array_.EmptyCopy();
+    Upload(1);
+
+    CudaTextureType moved(std::move(texture));
+    cua::CudaArray2D<Scalar> result(array_.Width(), array_.Height());
+    moved.CopyTo(&result);
+
+    const size_t width = array_.Width();
+    DownloadAndCheck(
+        result, [=](size_t x, size_t y) { return AsScalar(y * width + x); });
+  }
+
+  //----------------------------------------------------------------------------
+
+ private:
+  cua::CudaArray2D<Scalar> array_;
+};
+
+//------------------------------------------------------------------------------
+//
+// Test suite definition.
+//
+//------------------------------------------------------------------------------
+
+TYPED_TEST_SUITE_P(CudaPitchedTexture2DTest);
+
+TYPED_TEST_P(CudaPitchedTexture2DTest, TestCopyTo) { this->CheckCopyTo(); }
+
+TYPED_TEST_P(CudaPitchedTexture2DTest, TestGet) { this->CheckGet(); }
+
+TYPED_TEST_P(CudaPitchedTexture2DTest, TestLifetime) { this->CheckLifetime(); }
+
+REGISTER_TYPED_TEST_SUITE_P(CudaPitchedTexture2DTest, TestCopyTo, TestGet,
+                            TestLifetime);
+
+typedef ::testing::Types<cua::CudaPitchedTexture2D<float>,
+                         cua::CudaPitchedTexture2D<float2>,
+                         cua::CudaPitchedTexture2D<float4>,
+                         cua::CudaPitchedTexture2D<unsigned char>,
+                         cua::CudaPitchedTexture2D<uchar4>,
+                         cua::CudaPitchedTexture2D<unsigned int>,
+                         cua::CudaPitchedTexture2D<uint4> >
+    Types;
+
+INSTANTIATE_TYPED_TEST_SUITE_P(CudaPitchedTexture2DTest,
+                               CudaPitchedTexture2DTest, Types);
+
+//------------------------------------------------------------------------------
+
+TEST(CudaPitchedTexture2DPitchTest, TestViews) {
+  int alignment = 0;
+  cudaDeviceGetAttribute(&alignment, cudaDevAttrTextureAlignment, 0);
+  ASSERT_GT(alignment, 0);
+
+  // the first row at x = 0 whose address satisfies the texture alignment
+  cua::CudaArray2D<float> array(8, 1024);
+  const size_t pitch = array.Pitch();
+  size_t aligned_y = 1;
+  while (aligned_y * pitch % alignment != 0) {
+    ++aligned_y;
+  }
+  ASSERT_LT(aligned_y, array.Height());
+
+  EXPECT_NO_THROW(cua::CudaPitchedTexture2D<float> texture(
+      array.View(0, aligned_y, 8, array.Height() - aligned_y)));
+  if (aligned_y > 1) {
+    // rows in between start on an address that is only pitch-aligned
+    EXPECT_THROW(cua::CudaPitchedTexture2D<float> texture(
+                     array.View(0, 1, 8, array.Height() - 1)),
+                 std::runtime_error);
+  }
+}
+
+TEST(CudaPitchedTexture2DPitchTest, TestTransposedInPlace) {
+  // a non-square in-place transpose packs the rows densely; 38 floats per row
+  // are not a multiple of any texture pitch alignment
+  cua::CudaArray2D<float> array(45, 38);
+  array.TransposeInPlace();
+  ASSERT_EQ(array.Pitch(), 38 * sizeof(float));
+  EXPECT_THROW(cua::CudaPitchedTexture2D<float> texture(array),
+               std::runtime_error);
+
+  // Transpose() allocates a new array with an aligned pitch
+  array = array.Transpose();
+  EXPECT_NO_THROW(cua::CudaPitchedTexture2D<float> texture(array));
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace
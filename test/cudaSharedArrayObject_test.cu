@@ -0,0 +1,244 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "cudaSharedArrayObject.h"
+#include "cudaSurface2D.h"
+#include "cudaSurface3D.h"
+#include "cudaTexture2D.h"
+#include "cudaTexture3D.h"
+
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "util.h"
+
+namespace {
+
+//------------------------------------------------------------------------------
+//
+// host-only shared object whose "destruction" is simply counted
+//
+//------------------------------------------------------------------------------
+
+std::atomic<int> g_num_destroyed(0);
+
+cudaError_t CountDestroy(unsigned long long) {
+  ++g_num_destroyed;
+  return cudaSuccess;
+}
+
+class CountedObject
+    : public cua::CudaSharedArrayObject<float, unsigned long long,
+                                        CountDestroy> {
+ public:
+  explicit CountedObject(unsigned long long id) { this->cuda_api_obj = id; }
+
+  unsigned long long Id() const { return this->cuda_api_obj; }
+};
+
+class CudaSharedArrayObjectTest : public ::testing::Test {
+ protected:
+  void SetUp() override { g_num_destroyed = 0; }
+};
+
+//------------------------------------------------------------------------------
+//
+// reference counting
+//
+//------------------------------------------------------------------------------
+
+TEST_F(CudaSharedArrayObjectTest, TestCopy) {
+  {
+    CountedObject a(1);
+    EXPECT_EQ(a.UseCount(), 1);
+    {
+      CountedObject b(a);
+      EXPECT_EQ(a.UseCount(), 2);
+      EXPECT_EQ(b.Id(), 1);
+    }
+    EXPECT_EQ(a.UseCount(), 1);
+    EXPECT_EQ(g_num_destroyed, 0);
+  }
+  EXPECT_EQ(g_num_destroyed, 1);
+}
+
+TEST_F(CudaSharedArrayObjectTest, TestAssign) {
+  {
+    CountedObject a(1);
+    CountedObject b(2);
+    b = a;
+    EXPECT_EQ(g_num_destroyed, 1);  // b's original object
+    EXPECT_EQ(a.UseCount(), 2);
+    EXPECT_EQ(b.Id(), 1);
+
+    // self-assignment must not release the object
+    CountedObject &a_ref = a;
+    a = a_ref;
+    EXPECT_EQ(a.UseCount(), 2);
+
+    // assigning an instance that already shares the object is a no-op
+    b = a;
+    EXPECT_EQ(a.UseCount(), 2);
+    EXPECT_EQ(g_num_destroyed, 1);
+  }
+  EXPECT_EQ(g_num_destroyed, 2);
+}
+
+TEST_F(CudaSharedArrayObjectTest, TestMove) {
+  {
+    CountedObject a(1);
+    CountedObject b(std::move(a));
+    EXPECT_EQ(a.UseCount(), 0);
+    EXPECT_EQ(b.UseCount(), 1);
+    EXPECT_EQ(b.Id(), 1);
+
+    CountedObject c(2);
+    c = std::move(b);
+    EXPECT_EQ(g_num_destroyed, 1);  // c's original object
+    EXPECT_EQ(b.UseCount(), 0);
+    EXPECT_EQ(c.UseCount(), 1);
+    EXPECT_EQ(c.Id(), 1);
+
+    // a moved-from instance can be reassigned
+    a = c;
+    EXPECT_EQ(c.UseCount(), 2);
+  }
+  EXPECT_EQ(g_num_destroyed, 2);
+}
+
+TEST_F(CudaSharedArrayObjectTest, TestConcurrentCopies) {
+  const int kNumThreads = 8;
+  const int kNumIterations = 10000;
+
+  {
+    CountedObject a(1);
+    CountedObject b(2);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kNumThreads; ++i) {
+      threads.emplace_back([&a, &b, i]() {
+        CountedObject local(a);
+        for (int j = 0; j < kNumIterations; ++j) {
+          CountedObject copy((j % 2 == 0) ? a : b);
+          local = copy;
+          CountedObject moved(std::move(copy));
+          local = (i % 2 == 0) ? b : a;
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    EXPECT_EQ(a.UseCount(), 1);
+    EXPECT_EQ(b.UseCount(), 1);
+    EXPECT_EQ(g_num_destroyed, 0);
+  }
+  EXPECT_EQ(g_num_destroyed, 2);
+}
+
+//------------------------------------------------------------------------------
+//
+// moving arrays
+//
+//------------------------------------------------------------------------------
+
+template <typename ArrayType>
+void CheckMove2D(const ArrayType &array) {
+  ArrayType copy(array);
+  ArrayType moved(std::move(copy));
+  EXPECT_EQ(moved.Width(), array.Width());
+  EXPECT_EQ(moved.Height(), array.Height());
+
+  ArrayType assigned(1, 1);
+  assigned = std::move(moved);
+  EXPECT_EQ(assigned.Width(), array.Width());
+
+  std::vector<float> result(array.Size());
+  assigned.CopyTo(result.data());
+  for (size_t i = 0; i < result.size(); ++i) {
+    EXPECT_EQ(result[i], 3.f);
+  }
+}
+
+template <typename ArrayType>
+void CheckMove3D(const ArrayType &array) {
+  ArrayType copy(array);
+  ArrayType moved(std::move(copy));
+  EXPECT_EQ(moved.Depth(), array.Depth());
+
+  ArrayType assigned(1, 1, 1);
+  assigned = std::move(moved);
+  EXPECT_EQ(assigned.Depth(), array.Depth());
+
+  std::vector<float> result(array.Size());
+  assigned.CopyTo(result.data());
+  for (size_t i = 0; i < result.size(); ++i) {
+    EXPECT_EQ(result[i], 3.f);
+  }
+}
+
+TEST(CudaSharedArrayObjectMoveTest, TestMoveSurface2D) {
+  cua::CudaSurface2D<float> array(17, 9);
+  array.Fill(3.f);
+  CheckMove2D(array);
+}
+
+TEST(CudaSharedArrayObjectMoveTest, TestMoveTexture2D) {
+  std::vector<float> data(17 * 9, 3.f);
+  cua::CudaTexture2D<float> array(17, 9);
+  array = data.data();
+  CheckMove2D(array);
+}
+
+TEST(CudaSharedArrayObjectMoveTest, TestMoveSurface3D) {
+  cua::CudaSurface3D<float> array(17, 9, 4);
+  array.Fill(3.f);
+  CheckMove3D(array);
+}
+
+TEST(CudaSharedArrayObjectMoveTest, TestMoveTexture3D) {
+  std::vector<float> data(17 * 9 * 4, 3.f);
+  cua::CudaTexture3D<float> array(17, 9, 4);
+  array = data.data();
+  CheckMove3D(array);
+}
+
+}  // namespace
@@ -0,0 +1,136 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "cudaArray2D.h"
+#include "cudaSurfaceTexture2D.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "cudaArray2DBase_test.h"
+
+namespace {
+
+typedef ::testing::Types<
+    cua::CudaSurfaceTexture2D<float>, cua::CudaSurfaceTexture2D<float2>,
+    cua::CudaSurfaceTexture2D<float4>, cua::CudaSurfaceTexture2D<unsigned char>,
+    cua::CudaSurfaceTexture2D<uchar2>, cua::CudaSurfaceTexture2D<uchar4>,
+    cua::CudaSurfaceTexture2D<unsigned int>, cua::CudaSurfaceTexture2D<uint2>,
+    cua::CudaSurfaceTexture2D<uint4> >
+    Types;
+
+INSTANTIATE_TYPED_TEST_SUITE_P(CudaSurfaceTexture2DTest, CudaArray2DBaseTest,
+                               Types);
+
+//------------------------------------------------------------------------------
+//
+// writes through the surface are sampled through the texture
+//
+//------------------------------------------------------------------------------
+
+const size_t kWidth = 37;
+const size_t kHeight = 23;
+
+TEST(CudaSurfaceTexture2DAliasTest, TestWriteThenSample) {
+  cua::CudaSurfaceTexture2D<float> surface_texture(kWidth, kHeight);
+  surface_texture.ApplyOp([] __device__(size_t x, size_t y) {
+    return static_cast<float>(y * kWidth + x);
+  });
+
+  cua::CudaArray2D<float> result(kWidth, kHeight);
+  const auto view = surface_texture.DeviceView();
+  result.ApplyOp([=] __device__(size_t x, size_t y) {
+    return view.interp(x + 0.5f, y + 0.5f);
+  });
+
+  std::vector<float> host(kWidth * kHeight);
+  result.CopyTo(host.data());
+  CUDA_CHECK_ERROR
+  for (size_t i = 0; i < host.size(); ++i) {
+    EXPECT_EQ(host[i], static_cast<float>(i));
+  }
+}
+
+TEST(CudaSurfaceTexture2DAliasTest, TestSampleView) {
+  cua::CudaSurfaceTexture2D<float> surface_texture(kWidth, kHeight);
+  surface_texture.ApplyOp([] __device__(size_t x, size_t y) {
+    return static_cast<float>(y * kWidth + x);
+  });
+
+  // texture coordinates in a view are relative to the view
+  const auto view = surface_texture.View(1, 2, kWidth - 3, kHeight - 4);
+  cua::CudaArray2D<float> result(view.Width(), view.Height());
+  const auto device_view = view.DeviceView();
+  result.ApplyOp([=] __device__(size_t x, size_t y) {
+    return device_view.interp(x + 0.5f, y + 0.5f);
+  });
+
+  std::vector<float> host(result.Size());
+  result.CopyTo(host.data());
+  CUDA_CHECK_ERROR
+  for (size_t y = 0; y < result.Height(); ++y) {
+    for (size_t x = 0; x < result.Width(); ++x) {
+      EXPECT_EQ(host[y * result.Width() + x],
+                static_cast<float>((y + 2) * kWidth + x + 1));
+    }
+  }
+}
+
+TEST(CudaSurfaceTexture2DAliasTest, TestSharedLifetime) {
+  std::vector<float> data(kWidth * kHeight, 2.f);
+  cua::CudaSurfaceTexture2D<float> copy(1, 1);
+  {
+    cua::CudaSurfaceTexture2D<float> surface_texture(kWidth, kHeight);
+    surface_texture = data.data();
+    copy = surface_texture;
+  }
+
+  cua::CudaArray2D<float> result(kWidth, kHeight);
+  const auto view = copy.DeviceView();
+  result.ApplyOp([=] __device__(size_t x, size_t y) {
+    return view.interp(x + 0.5f, y + 0.5f) + view.get(x, y);
+  });
+
+  std::vector<float> host(kWidth * kHeight);
+  result.CopyTo(host.data());
+  CUDA_CHECK_ERROR
+  for (size_t i = 0; i < host.size(); ++i) {
+    EXPECT_EQ(host[i], 4.f);
+  }
+}
+
+}  // namespace
@@ -0,0 +1,263 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cudaArray2D.h"
+#include "cudaArray3D.h"
+#include "cudaSurface2D.h"
+#include "cudaSurface3D.h"
+#include "cudaTexture2D.h"
+#include "cudaTexture3D.h"
+
+#include <type_traits>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "util.h"
+
+namespace {
+
+const size_t kWidth = 37;
+const size_t kHeight = 23;
+const size_t kDepth = 5;
+
+//------------------------------------------------------------------------------
+//
+// user kernels that only see device views
+//
+//------------------------------------------------------------------------------
+
+template <typename View>
+__global__ void WriteIndex2D(View view) {
+  const unsigned int x = blockIdx.x * blockDim.x + threadIdx.x;
+  const unsigned int y = blockIdx.y * blockDim.y + threadIdx.y;
+  if (x < view.Width() && y < view.Height()) {
+    view.set(x, y, static_cast<float>(y * view.Width() + x));
+  }
+}
+
+template <typename View>
+__global__ void WriteIndex3D(View view) {
+  const unsigned int x = blockIdx.x * blockDim.x + threadIdx.x;
+  const unsigned int y = blockIdx.y * blockDim.y + threadIdx.y;
+  const unsigned int z = blockIdx.z * blockDim.z + threadIdx.z;
+  if (x < view.Width() && y < view.Height() && z < view.Depth()) {
+    view.set(x, y, z,
+             static_cast<float>((z * view.Height() + y) * view.Width() + x));
+  }
+}
+
+template <typename SrcView, typename DstView>
+__global__ void Copy2D(const SrcView src, DstView dst) {
+  const unsigned int x = blockIdx.x * blockDim.x + threadIdx.x;
+  const unsigned int y = blockIdx.y * blockDim.y + threadIdx.y;
+  if (x < src.Width() && y < src.Height()) {
+    dst.set(x, y, src.get(x, y));
+  }
+}
+
+template <typename SrcView, typename DstView>
+__global__ void Copy3D(const SrcView src, DstView dst) {
+  const unsigned int x = blockIdx.x * blockDim.x + threadIdx.x;
+  const unsigned int y = blockIdx.y * blockDim.y + threadIdx.y;
+  const unsigned int z = blockIdx.z * blockDim.z + threadIdx.z;
+  if (x < src.Width() && y < src.Height() && z < src.Depth()) {
+    dst.set(x, y, z, src.get(x, y, z));
+  }
+}
+
+const dim3 kBlockDim2D(16, 16);
+const dim3 kGridDim2D((kWidth + 15) / 16, (kHeight + 15) / 16);
+const dim3 kBlockDim3D(8, 8, 4);
+const dim3 kGridDim3D((kWidth + 7) / 8, (kHeight + 7) / 8, (kDepth + 3) / 4);
+
+std::vector<float> Indices(size_t size) {
+  std::vector<float> result(size);
+  for (size_t i = 0; i < size; ++i) {
+    result[i] = static_cast<float>(i);
+  }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+//
+// tests
+//
+//------------------------------------------------------------------------------
+
+TEST(DeviceViewTest, TestTriviallyCopyable) {
+  EXPECT_TRUE(std::is_trivially_copyable<
+              cua::CudaArray2DDeviceView<float>>::value);
+  EXPECT_TRUE(std::is_trivially_copyable<
+              cua::CudaArray3DDeviceView<float>>::value);
+  EXPECT_TRUE(std::is_trivially_copyable<
+              cua::CudaSurface2DDeviceView<float>>::value);
+  EXPECT_TRUE((std::is_trivially_copyable<
+               cua::CudaSurface3DDeviceView<float, std::true_type>>::value));
+  EXPECT_TRUE(std::is_trivially_copyable<
+              cua::CudaTexture2DDeviceView<float>>::value);
+  EXPECT_TRUE((std::is_trivially_copyable<
+               cua::CudaTexture3DDeviceView<float, std::false_type>>::value));
+
+  // views are what the library's kernels receive
+  EXPECT_TRUE((std::is_same<cua::CudaArray2D<float>::DeviceViewType,
+                            cua::CudaArray2DDeviceView<float>>::value));
+  EXPECT_TRUE((std::is_same<
+               cua::CudaSurface2DArray<float>::DeviceViewType,
+               cua::CudaSurface3DDeviceView<float, std::true_type>>::value));
+
+  EXPECT_LT(sizeof(cua::CudaArray2DDeviceView<float>),
+            sizeof(cua::CudaArray2D<float>));
+  EXPECT_LT(sizeof(cua::CudaSurface3DDeviceView<float, std::false_type>),
+            sizeof(cua::CudaSurface3D<float>));
+}
+
+TEST(DeviceViewTest, TestArray2D) {
+  cua::CudaArray2D<float> array(kWidth, kHeight);
+  const cua::CudaArray2DDeviceView<float> view = array.DeviceView();
+  EXPECT_EQ(view.Width(), kWidth);
+  EXPECT_EQ(view.Height(), kHeight);
+  EXPECT_EQ(view.Pitch(), array.Pitch());
+  EXPECT_EQ(view.ptr(3, 2), array.ptr(3, 2));
+
+  WriteIndex2D<<<kGridDim2D, kBlockDim2D>>>(view);
+  CUDA_CHECK_ERROR
+
+  std::vector<float> result(kWidth * kHeight);
+  array.CopyTo(result.data());
+  EXPECT_EQ(result, Indices(kWidth * kHeight));
+}
+
+TEST(DeviceViewTest, TestArray2DSubView) {
+  cua::CudaArray2D<float> array(kWidth, kHeight);
+  array.Fill(-1.f);
+
+  const size_t x0 = 3, y0 = 2, width = 11, height = 7;
+  WriteIndex2D<<<kGridDim2D, kBlockDim2D>>>(
+      array.View(x0, y0, width, height).DeviceView());
+  CUDA_CHECK_ERROR
+
+  std::vector<float> result(kWidth * kHeight);
+  array.CopyTo(result.data());
+  for (size_t y = 0; y < kHeight; ++y) {
+    for (size_t x = 0; x < kWidth; ++x) {
+      const bool inside =
+          (x >= x0 && x < x0 + width && y >= y0 && y < y0 + height);
+      const float expected =
+          inside ? static_cast<float>((y - y0) * width + (x - x0)) : -1.f;
+      EXPECT_EQ(result[y * kWidth + x], expected) << x << " " << y;
+    }
+  }
+}
+
+TEST(DeviceViewTest, TestCapturedView) {
+  cua::CudaArray2D<float> array(kWidth, kHeight);
+  array = Indices(kWidth * kHeight).data();
+
+  // views can be captured by value in device lambdas, e.g., to read another
+  // array inside ApplyOp()
+  const cua::CudaArray2DDeviceView<float> src = array.DeviceView();
+  cua::CudaArray2D<float> doubled = array.EmptyCopy();
+  doubled.ApplyOp([src] __device__(unsigned int x, unsigned int y) {
+    return 2.f * src.get(x, y);
+  });
+  CUDA_CHECK_ERROR
+
+  std::vector<float> result(kWidth * kHeight);
+  doubled.CopyTo(result.data());
+  for (size_t i = 0; i < result.size(); ++i) {
+    EXPECT_EQ(result[i], 2.f * i);
+  }
+}
+
+TEST(DeviceViewTest, TestArray3D) {
+  cua::CudaArray3D<float> array(kWidth, kHeight, kDepth);
+  WriteIndex3D<<<kGridDim3D, kBlockDim3D>>>(array.DeviceView());
+  CUDA_CHECK_ERROR
+
+  std::vector<float> result(kWidth * kHeight * kDepth);
+  array.CopyTo(result.data());
+  EXPECT_EQ(result, Indices(kWidth * kHeight * kDepth));
+}
+
+TEST(DeviceViewTest, TestSurface2D) {
+  cua::CudaSurface2D<float> surface(kWidth, kHeight);
+  WriteIndex2D<<<kGridDim2D, kBlockDim2D>>>(surface.DeviceView());
+  CUDA_CHECK_ERROR
+
+  std::vector<float> result(kWidth * kHeight);
+  surface.CopyTo(result.data());
+  EXPECT_EQ(result, Indices(kWidth * kHeight));
+}
+
+TEST(DeviceViewTest, TestSurface3D) {
+  cua::CudaSurface3D<float> surface(kWidth, kHeight, kDepth);
+  WriteIndex3D<<<kGridDim3D, kBlockDim3D>>>(surface.DeviceView());
+  CUDA_CHECK_ERROR
+
+  std::vector<float> result(kWidth * kHeight * kDepth);
+  surface.CopyTo(result.data());
+  EXPECT_EQ(result, Indices(kWidth * kHeight * kDepth));
+}
+
+TEST(DeviceViewTest, TestTexture2D) {
+  cua::CudaTexture2D<float> texture(kWidth, kHeight);
+  texture = Indices(kWidth * kHeight).data();
+
+  cua::CudaArray2D<float> array(kWidth, kHeight);
+  Copy2D<<<kGridDim2D, kBlockDim2D>>>(texture.DeviceView(),
+                                      array.DeviceView());
+  CUDA_CHECK_ERROR
+
+  std::vector<float> result(kWidth * kHeight);
+  array.CopyTo(result.data());
+  EXPECT_EQ(result, Indices(kWidth * kHeight));
+}
+
+TEST(DeviceViewTest, TestTexture3D) {
+  cua::CudaTexture3D<float> texture(kWidth, kHeight, kDepth);
+  texture = Indices(kWidth * kHeight * kDepth).data();
+
+  cua::CudaArray3D<float> array(kWidth, kHeight, kDepth);
+  Copy3D<<<kGridDim3D, kBlockDim3D>>>(texture.DeviceView(),
+                                      array.DeviceView());
+  CUDA_CHECK_ERROR
+
+  std::vector<float> result(kWidth * kHeight * kDepth);
+  array.CopyTo(result.data());
+  EXPECT_EQ(result, Indices(kWidth * kHeight * kDepth));
+}
+
+}  // namespace
@@ -0,0 +1,212 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "cudaArray2D.h"
+#include "cudaArray3D.h"
+#include "cudaHostArray2D.h"
+#include "cudaHostArray3D.h"
+#include "cudaSurface2D.h"
+
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "util.h"
+
+namespace {
+
+const size_t kWidth = 37;
+const size_t kHeight = 23;
+const size_t kDepth = 11;
+
+// more than one block of the gather/scatter kernel
+const size_t kNumValues = 700;
+
+//------------------------------------------------------------------------------
+//
+// 2D tests over all mutable array kinds
+//
+//------------------------------------------------------------------------------
+
+template <typename CudaArrayType>
+class GatherScatter2DTest : public ::testing::Test {
+ public:
+  typedef typename CudaArrayType::Coordinate Coordinate;
+
+  GatherScatter2DTest()
+      : array_(kWidth, kHeight), coordinates_(kNumValues), values_(kNumValues) {
+    array_.Fill(-1.f);
+
+    // distinct coordinates, visited in a scattered order
+    for (size_t i = 0; i < kNumValues; ++i) {
+      const size_t index = (i * 101) % (kWidth * kHeight);
+      coordinates_[i].x = index % kWidth;
+      coordinates_[i].y = index / kWidth;
+      values_[i] = static_cast<float>(i);
+    }
+  }
+
+ protected:
+  CudaArrayType array_;
+  std::vector<Coordinate> coordinates_;
+  std::vector<float> values_;
+};
+
+typedef ::testing::Types<cua::CudaArray2D<float>, cua::CudaSurface2D<float>,
+                         cua::CudaHostArray2D<float>>
+    Types2D;
+
+TYPED_TEST_SUITE(GatherScatter2DTest, Types2D);
+
+TYPED_TEST(GatherScatter2DTest, TestSetValues) {
+  this->array_.SetValues(this->coordinates_.data(), this->values_.data(),
+                         kNumValues);
+
+  std::vector<float> result(kWidth * kHeight);
+  this->array_.CopyTo(result.data());
+
+  std::vector<float> expected(kWidth * kHeight, -1.f);
+  for (size_t i = 0; i < kNumValues; ++i) {
+    expected[this->coordinates_[i].y * kWidth + this->coordinates_[i].x] =
+        this->values_[i];
+  }
+  EXPECT_EQ(result, expected);
+  CUDA_CHECK_ERROR
+}
+
+TYPED_TEST(GatherScatter2DTest, TestGetValues) {
+  std::vector<float> data(kWidth * kHeight);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<float>(i);
+  }
+  this->array_ = data.data();
+
+  std::vector<float> result(kNumValues);
+  this->array_.GetValues(this->coordinates_.data(), kNumValues, result.data());
+  for (size_t i = 0; i < kNumValues; ++i) {
+    EXPECT_EQ(result[i], data[this->coordinates_[i].y * kWidth +
+                              this->coordinates_[i].x]);
+  }
+
+  EXPECT_EQ(this->array_.GetValue(3, 2), data[2 * kWidth + 3]);
+  CUDA_CHECK_ERROR
+}
+
+TYPED_TEST(GatherScatter2DTest, TestAsyncRoundTrip) {
+  std::vector<float> result(kNumValues);
+  this->array_.SetValuesAsync(this->coordinates_.data(), this->values_.data(),
+                              kNumValues);
+  cua::CudaEvent event = this->array_.GetValuesAsync(
+      this->coordinates_.data(), kNumValues, result.data());
+  event.Synchronize();
+  EXPECT_TRUE(event.Query());
+  EXPECT_EQ(result, this->values_);
+  CUDA_CHECK_ERROR
+}
+
+TYPED_TEST(GatherScatter2DTest, TestOutOfBounds) {
+  this->coordinates_.back().x = kWidth;
+  std::vector<float> result(kNumValues);
+  EXPECT_THROW(this->array_.GetValues(this->coordinates_.data(), kNumValues,
+                                      result.data()),
+               std::runtime_error);
+}
+
+//------------------------------------------------------------------------------
+//
+// 3D tests
+//
+//------------------------------------------------------------------------------
+
+template <typename CudaArrayType>
+class GatherScatter3DTest : public ::testing::Test {
+ public:
+  typedef typename CudaArrayType::Coordinate Coordinate;
+
+  GatherScatter3DTest()
+      : array_(kWidth, kHeight, kDepth),
+        coordinates_(kNumValues),
+        values_(kNumValues) {
+    array_.Fill(-1.f);
+
+    for (size_t i = 0; i < kNumValues; ++i) {
+      const size_t index = (i * 101) % (kWidth * kHeight * kDepth);
+      coordinates_[i].x = index % kWidth;
+      coordinates_[i].y = (index / kWidth) % kHeight;
+      coordinates_[i].z = index / (kWidth * kHeight);
+      values_[i] = static_cast<float>(i);
+    }
+  }
+
+ protected:
+  CudaArrayType array_;
+  std::vector<Coordinate> coordinates_;
+  std::vector<float> values_;
+};
+
+typedef ::testing::Types<cua::CudaArray3D<float>, cua::CudaHostArray3D<float>>
+    Types3D;
+
+TYPED_TEST_SUITE(GatherScatter3DTest, Types3D);
+
+TYPED_TEST(GatherScatter3DTest, TestRoundTrip) {
+  this->array_.SetValues(this->coordinates_.data(), this->values_.data(),
+                         kNumValues);
+
+  std::vector<float> result(kNumValues);
+  this->array_.GetValues(this->coordinates_.data(), kNumValues, result.data());
+  EXPECT_EQ(result, this->values_);
+
+  std::vector<float> data(kWidth * kHeight * kDepth);
+  this->array_.CopyTo(data.data());
+  size_t num_set = 0;
+  for (const float value : data) {
+    num_set += (value != -1.f);
+  }
+  EXPECT_EQ(num_set, kNumValues);
+  CUDA_CHECK_ERROR
+}
+
+TYPED_TEST(GatherScatter3DTest, TestGetSetValue) {
+  this->array_.SetValue(5, 4, 3, 7.f);
+  EXPECT_EQ(this->array_.GetValue(5, 4, 3), 7.f);
+  EXPECT_EQ(this->array_.GetValue(3, 4, 5), -1.f);
+  EXPECT_THROW(this->array_.GetValue(0, 0, kDepth), std::runtime_error);
+  CUDA_CHECK_ERROR
+}
+
+}  // namespace
@@ -0,0 +1,256 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cudaArray2D.h"
+#include "cudaArray3D.h"
+#include "cudaHostArray2D.h"
+#include "cudaHostArray3D.h"
+#include "cudaTexture2D.h"
+#include "histogram.h"
+
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "util.h"
+
+namespace {
+
+// several grid-stride iterations per thread, with a partial last block
+const size_t kWidth = 1001;
+const size_t kHeight = 600;
+const size_t kWidth3D = 150;
+const size_t kHeight3D = 37;
+const size_t kDepth3D = 9;
+
+// every third element is selected
+std::vector<unsigned char> MaskValues(size_t size) {
+  std::vector<unsigned char> mask(size);
+  for (size_t i = 0; i < size; ++i) {
+    mask[i] = (i % 3 == 0) ? 1 : 0;
+  }
+  return mask;
+}
+
+//
+// reference histogram of single-channel data, counting element i only if
+// mask is empty or mask[i] is nonzero
+//
+template <typename T>
+std::vector<unsigned long long> ReferenceHistogram(
+    const std::vector<T> &data, const cua::HistogramBins &bins,
+    const std::vector<unsigned char> &mask = std::vector<unsigned char>()) {
+  std::vector<unsigned long long> counts(bins.num_bins, 0);
+  const float scale = bins.num_bins / (bins.upper - bins.lower);
+  for (size_t i = 0; i < data.size(); ++i) {
+    if (!mask.empty() && !mask[i]) {
+      continue;
+    }
+    const float bin = (static_cast<float>(data[i]) - bins.lower) * scale;
+    if (bin >= 0.f && bin < bins.num_bins) {
+      ++counts[static_cast<size_t>(bin)];
+    }
+  }
+  return counts;
+}
+
+void ExpectCountsEqual(const std::vector<unsigned long long> &counts,
+                       const std::vector<unsigned long long> &expected) {
+  ASSERT_EQ(counts.size(), expected.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(counts[i], expected[i]) << "Bin: " << i;
+  }
+}
+
+//------------------------------------------------------------------------------
+//
+// 2D tests
+//
+//------------------------------------------------------------------------------
+
+template <typename ArrayType>
+void CheckHistogram2D(const cua::HistogramBins &bins) {
+  typedef typename ArrayType::Scalar T;
+  const std::vector<T> data = Values<T>(kWidth * kHeight);
+  ArrayType array(kWidth, kHeight);
+  array = data.data();
+
+  ExpectCountsEqual(array.Histogram(bins), ReferenceHistogram(data, bins));
+}
+
+TEST(HistogramTest, TestBytes2D) {
+  CheckHistogram2D<cua::CudaArray2D<unsigned char>>(
+      cua::HistogramBins(256, 0.f, 256.f));
+  CUDA_CHECK_ERROR
+}
+
+TEST(HistogramTest, TestFloat2D) {
+  // values lie in [-5, 5), so the outer ones are not counted
+  CheckHistogram2D<cua::CudaArray2D<float>>(
+      cua::HistogramBins(50, -4.f, 4.f));
+  CUDA_CHECK_ERROR
+}
+
+TEST(HistogramTest, TestTexture2D) {
+  CheckHistogram2D<cua::CudaTexture2D<float>>(
+      cua::HistogramBins(50, -4.f, 4.f));
+  CUDA_CHECK_ERROR
+}
+
+TEST(HistogramTest, TestHost2D) {
+  CheckHistogram2D<cua::CudaHostArray2D<unsigned char>>(
+      cua::HistogramBins(256, 0.f, 256.f));
+  CheckHistogram2D<cua::CudaHostArray2D<float>>(
+      cua::HistogramBins(50, -4.f, 4.f));
+}
+
+TEST(HistogramTest, TestManyBins) {
+  // too many bins for shared memory; counted in global memory instead
+  CheckHistogram2D<cua::CudaArray2D<float>>(
+      cua::HistogramBins(20000, -5.f, 5.f));
+  CUDA_CHECK_ERROR
+}
+
+TEST(HistogramTest, TestChannels2D) {
+  std::vector<uchar4> data(kWidth * kHeight);
+  std::vector<unsigned char> channels[4];
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = make_uchar4(ByteValue(i), ByteValue(3 * i), i % 7, 255);
+    channels[0].push_back(data[i].x);
+    channels[1].push_back(data[i].y);
+    channels[2].push_back(data[i].z);
+    channels[3].push_back(data[i].w);
+  }
+  cua::CudaArray2D<uchar4> array(kWidth, kHeight);
+  array = data.data();
+
+  const cua::HistogramBins bins(64, 0.f, 256.f);
+  std::vector<unsigned long long> expected;
+  for (const std::vector<unsigned char> &channel : channels) {
+    const std::vector<unsigned long long> channel_counts =
+        ReferenceHistogram(channel, bins);
+    expected.insert(expected.end(), channel_counts.begin(),
+                    channel_counts.end());
+  }
+  ExpectCountsEqual(array.Histogram(bins), expected);
+  CUDA_CHECK_ERROR
+}
+
+TEST(HistogramTest, TestMask2D) {
+  const std::vector<float> data = Values<float>(kWidth * kHeight);
+  const std::vector<unsigned char> mask_data = MaskValues(data.size());
+  cua::CudaArray2D<float> array(kWidth, kHeight);
+  cua::CudaArray2D<unsigned char> mask(kWidth, kHeight);
+  array = data.data();
+  mask = mask_data.data();
+
+  const cua::HistogramBins bins(100, -5.f, 5.f);
+  ExpectCountsEqual(array.Histogram(bins, mask),
+                    ReferenceHistogram(data, bins, mask_data));
+  CUDA_CHECK_ERROR
+}
+
+TEST(HistogramTest, TestHostMask2D) {
+  const std::vector<float> data = Values<float>(kWidth * kHeight);
+  const std::vector<unsigned char> mask_data = MaskValues(data.size());
+  cua::CudaHostArray2D<float> array(kWidth, kHeight);
+  cua::CudaHostArray2D<unsigned char> mask(kWidth, kHeight);
+  array = data.data();
+  mask = mask_data.data();
+
+  const cua::HistogramBins bins(100, -5.f, 5.f);
+  ExpectCountsEqual(array.Histogram(bins, mask),
+                    ReferenceHistogram(data, bins, mask_data));
+}
+
+TEST(HistogramTest, TestInvalidArguments) {
+  cua::CudaArray2D<float> array(kWidth, kHeight);
+  cua::CudaArray2D<unsigned char> mask(kWidth + 1, kHeight);
+  const cua::HistogramBins bins(16, 0.f, 1.f);
+  EXPECT_THROW(array.Histogram(bins, mask), std::runtime_error);
+  EXPECT_THROW(array.Histogram(cua::HistogramBins(0, 0.f, 1.f)),
+               std::runtime_error);
+  EXPECT_THROW(array.Histogram(cua::HistogramBins(16, 1.f, 1.f)),
+               std::runtime_error);
+
+  cua::CudaArray3D<float> volume(kWidth3D, kHeight3D, kDepth3D);
+  cua::CudaArray3D<unsigned char> volume_mask(kWidth3D, kHeight3D,
+                                              kDepth3D + 1);
+  EXPECT_THROW(volume.Histogram(bins, volume_mask), std::runtime_error);
+}
+
+//------------------------------------------------------------------------------
+//
+// 3D tests
+//
+//------------------------------------------------------------------------------
+
+template <typename ArrayType, typename MaskType>
+void CheckHistogram3D(const cua::HistogramBins &bins) {
+  typedef typename ArrayType::Scalar T;
+  const size_t size = kWidth3D * kHeight3D * kDepth3D;
+  const std::vector<T> data = Values<T>(size);
+  const std::vector<unsigned char> mask_data = MaskValues(size);
+  ArrayType array(kWidth3D, kHeight3D, kDepth3D);
+  MaskType mask(kWidth3D, kHeight3D, kDepth3D);
+  array = data.data();
+  mask = mask_data.data();
+
+  ExpectCountsEqual(array.Histogram(bins), ReferenceHistogram(data, bins));
+  ExpectCountsEqual(array.Histogram(bins, mask),
+                    ReferenceHistogram(data, bins, mask_data));
+}
+
+TEST(HistogramTest, TestBytes3D) {
+  CheckHistogram3D<cua::CudaArray3D<unsigned char>,
+                   cua::CudaArray3D<unsigned char>>(
+      cua::HistogramBins(256, 0.f, 256.f));
+  CUDA_CHECK_ERROR
+}
+
+TEST(HistogramTest, TestFloat3D) {
+  CheckHistogram3D<cua::CudaArray3D<float>, cua::CudaArray3D<unsigned char>>(
+      cua::HistogramBins(37, -3.f, 3.5f));
+  CUDA_CHECK_ERROR
+}
+
+TEST(HistogramTest, TestHost3D) {
+  CheckHistogram3D<cua::CudaHostArray3D<float>,
+                   cua::CudaHostArray3D<unsigned char>>(
+      cua::HistogramBins(37, -3.f, 3.5f));
+}
+
+}  // namespace
@@ -0,0 +1,169 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#define LIBCUA_ENABLE_INSTRUMENTATION
+
+#include "cudaArray2D.h"
+#include "cudaHostArray2D.h"
+#include "instrumentation.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "util.h"
+
+namespace {
+
+const size_t kWidth = 37;
+const size_t kHeight = 23;
+
+//------------------------------------------------------------------------------
+
+class InstrumentationTest : public ::testing::Test {
+ public:
+  InstrumentationTest()
+      : registry_(cua::InstrumentationRegistry::Instance()) {
+    registry_.Reset();
+  }
+
+  ~InstrumentationTest() { registry_.Reset(); }
+
+ protected:
+  cua::InstrumentationRegistry &registry_;
+};
+
+//------------------------------------------------------------------------------
+
+TEST_F(InstrumentationTest, TestRecord) {
+  registry_.Record("Op", 1., 1000);
+  registry_.Record("Op", 3., 3000);
+
+  const cua::OperationStats stats = registry_.Stats("Op");
+  EXPECT_EQ(stats.count, 2);
+  EXPECT_EQ(stats.bytes, 4000);
+  EXPECT_DOUBLE_EQ(stats.MeanMs(), 2.);
+  EXPECT_DOUBLE_EQ(stats.min_ms, 1.);
+  EXPECT_DOUBLE_EQ(stats.max_ms, 3.);
+  EXPECT_DOUBLE_EQ(stats.GigabytesPerSecond(), 4000. / 4e6);
+
+  // 1ms falls in [512, 1024) us, 3ms falls in [2048, 4096) us
+  EXPECT_EQ(stats.histogram[9], 1);
+  EXPECT_EQ(stats.histogram[11], 1);
+
+  EXPECT_EQ(registry_.Stats("Unknown").count, 0);
+
+  registry_.Reset();
+  EXPECT_TRUE(registry_.Stats().empty());
+}
+
+TEST_F(InstrumentationTest, TestHostArray) {
+  cua::CudaHostArray2D<float> array(kWidth, kHeight);
+  cua::CudaHostArray2D<float> transposed(kHeight, kWidth);
+
+  array.Fill(1.f);
+  array.Fill(2.f);
+  array.Transpose(&transposed);
+
+  const cua::OperationStats fill = registry_.Stats("CudaArray2DBase::Fill");
+  EXPECT_EQ(fill.count, 2);
+  EXPECT_EQ(fill.bytes, 2 * kWidth * kHeight * sizeof(float));
+
+  const cua::OperationStats transpose =
+      registry_.Stats("CudaArray2DBase::Transpose");
+  EXPECT_EQ(transpose.count, 1);
+  EXPECT_EQ(transpose.bytes, 2 * kWidth * kHeight * sizeof(float));
+}
+
+TEST_F(InstrumentationTest, TestDeviceArray) {
+  std::vector<float> data(kWidth * kHeight, 1.f);
+
+  cua::CudaArray2D<float> array(kWidth, kHeight);
+  array = data.data();
+  array.Fill(3.f);
+  array.CopyTo(data.data());
+
+  EXPECT_EQ(registry_.Stats("CudaArray2D::Upload").count, 1);
+  EXPECT_EQ(registry_.Stats("CudaArray2DBase::Fill").count, 1);
+  EXPECT_EQ(registry_.Stats("CudaArray2D::Download").count, 1);
+
+  const cua::OperationStats fill = registry_.Stats("CudaArray2DBase::Fill");
+  EXPECT_GE(fill.min_ms, 0.);
+  EXPECT_LE(fill.min_ms, fill.max_ms);
+  CUDA_CHECK_ERROR
+}
+
+TEST_F(InstrumentationTest, TestEventsAreReused) {
+  cudaEvent_t start, stop;
+  registry_.AcquireEvents(0, &start, &stop);
+  cudaEventRecord(start);
+  cudaEventRecord(stop);
+  registry_.RecordEvents("Op", 0, start, stop, 1000);
+  EXPECT_EQ(registry_.Stats("Op").count, 1);
+
+  // the resolved pair is handed out again
+  cudaEvent_t next_start, next_stop;
+  registry_.AcquireEvents(0, &next_start, &next_stop);
+  EXPECT_EQ(next_start, start);
+  EXPECT_EQ(next_stop, stop);
+  registry_.RecordEvents("Op", 0, next_start, next_stop, 1000);
+  CUDA_CHECK_ERROR
+}
+
+TEST_F(InstrumentationTest, TestScalarOps) {
+  cua::CudaHostArray2D<float> array(kWidth, kHeight);
+  array.Fill(1.f);
+  array += 1.f;
+  array *= 2.f;
+
+  const cua::OperationStats scalar_ops =
+      registry_.Stats("CudaArray2DBase::ApplyScalarOp");
+  EXPECT_EQ(scalar_ops.count, 2);
+  EXPECT_EQ(scalar_ops.bytes, 4 * kWidth * kHeight * sizeof(float));
+}
+
+TEST_F(InstrumentationTest, TestJson) {
+  cua::CudaHostArray2D<float> array(kWidth, kHeight);
+  array.Fill(1.f);
+
+  const std::string json = registry_.ToJson();
+  EXPECT_NE(json.find("\"operations\""), std::string::npos);
+  EXPECT_NE(json.find("\"CudaArray2DBase::Fill\""), std::string::npos);
+  EXPECT_NE(json.find("\"histogram_log2_us\""), std::string::npos);
+}
+
+}  // namespace
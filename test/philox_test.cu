@@ -0,0 +1,181 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "cudaArray2D.h"
+#include "cudaArray3D.h"
+#include "cudaHostArray2D.h"
+#include "cudaHostArray3D.h"
+#include "cudaSurface2D.h"
+#include "philox.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "util.h"
+
+namespace {
+
+// not a multiple of four, so that the last group of each row is partial
+const size_t kWidth = 101;
+const size_t kHeight = 37;
+const size_t kDepth = 13;
+
+const unsigned long long kSeed = 0x0123456789abcdefull;
+
+//------------------------------------------------------------------------------
+//
+// the generator itself
+//
+//------------------------------------------------------------------------------
+
+TEST(PhiloxTest, TestKnownAnswers) {
+  // test vectors from the Random123 distribution
+  const cua::PhiloxCounter result1 = cua::Philox4x32_10({0, 0, 0, 0}, {0, 0});
+  EXPECT_EQ(result1.x, 0x6627e8d5u);
+  EXPECT_EQ(result1.y, 0xe169c58du);
+  EXPECT_EQ(result1.z, 0xbc57ac4cu);
+  EXPECT_EQ(result1.w, 0x9b00dbd8u);
+
+  const cua::PhiloxCounter result2 = cua::Philox4x32_10(
+      {0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u},
+      {0xa4093822u, 0x299f31d0u});
+  EXPECT_EQ(result2.x, 0xd16cfe09u);
+  EXPECT_EQ(result2.y, 0x94fdccebu);
+  EXPECT_EQ(result2.z, 0x5001e420u);
+  EXPECT_EQ(result2.w, 0x24126ea1u);
+}
+
+TEST(PhiloxTest, TestUniformRange) {
+  EXPECT_GT(cua::UniformRandom()(0u), 0.f);
+  EXPECT_EQ(cua::UniformRandom()(0xffffffffu), 1.f);
+  EXPECT_GT(cua::UniformRandomDouble()(0u), 0.);
+  EXPECT_EQ(cua::UniformRandomDouble()(0xffffffffu), 1.);
+}
+
+//------------------------------------------------------------------------------
+//
+// device fills against the host reference
+//
+//------------------------------------------------------------------------------
+
+template <typename CudaArrayType>
+class Philox2DTest : public ::testing::Test {
+ public:
+  Philox2DTest() : array_(kWidth, kHeight), host_array_(kWidth, kHeight) {}
+
+ protected:
+  // the device result must match the host result bit for bit
+  void CheckMatchesHost(unsigned long long counter) {
+    array_.FillRandom(kSeed, counter);
+    host_array_.FillRandom(kSeed, counter);
+
+    std::vector<float> result(kWidth * kHeight), expected(kWidth * kHeight);
+    array_.CopyTo(result.data());
+    host_array_.CopyTo(expected.data());
+    EXPECT_EQ(result, expected);
+    CUDA_CHECK_ERROR
+  }
+
+  CudaArrayType array_;
+  cua::CudaHostArray2D<float> host_array_;
+};
+
+typedef ::testing::Types<cua::CudaArray2D<float>, cua::CudaSurface2D<float>>
+    Types2D;
+
+TYPED_TEST_SUITE(Philox2DTest, Types2D);
+
+TYPED_TEST(Philox2DTest, TestMatchesHost) {
+  this->CheckMatchesHost(0);
+  this->CheckMatchesHost(1);
+}
+
+TYPED_TEST(Philox2DTest, TestIndependentOfBlockDim) {
+  this->array_.SetBlockDim(dim3(7, 3));
+  this->CheckMatchesHost(5);
+}
+
+TYPED_TEST(Philox2DTest, TestCounterChangesValues) {
+  std::vector<float> result1(kWidth * kHeight), result2(kWidth * kHeight);
+  this->array_.FillRandom(kSeed, 0);
+  this->array_.CopyTo(result1.data());
+  this->array_.FillRandom(kSeed, 1);
+  this->array_.CopyTo(result2.data());
+
+  size_t num_equal = 0;
+  for (size_t i = 0; i < result1.size(); ++i) {
+    num_equal += (result1[i] == result2[i]);
+    EXPECT_GT(result1[i], 0.f);
+    EXPECT_LE(result1[i], 1.f);
+  }
+  EXPECT_LT(num_equal, 10);
+  CUDA_CHECK_ERROR
+}
+
+TEST(PhiloxTest, TestRandomBits2D) {
+  cua::CudaArray2D<unsigned int> array(kWidth, kHeight);
+  cua::CudaHostArray2D<unsigned int> host_array(kWidth, kHeight);
+  array.FillRandom(kSeed, 3, cua::RandomBits());
+  host_array.FillRandom(kSeed, 3, cua::RandomBits());
+
+  std::vector<unsigned int> result(kWidth * kHeight);
+  array.CopyTo(result.data());
+
+  // element (x, y) holds word x % 4 of the block for counter (x / 4, y)
+  const cua::PhiloxCounter bits =
+      cua::Philox4x32_10(cua::internal::MakePhiloxCounter(2, 5, 3),
+                         cua::internal::MakePhiloxKey(kSeed));
+  EXPECT_EQ(result[5 * kWidth + 8], bits.x);
+  EXPECT_EQ(result[5 * kWidth + 11], bits.w);
+  EXPECT_EQ(host_array.GetValue(9, 5), bits.y);
+  CUDA_CHECK_ERROR
+}
+
+TEST(PhiloxTest, TestMatchesHost3D) {
+  cua::CudaArray3D<double> array(kWidth, kHeight, kDepth);
+  cua::CudaHostArray3D<double> host_array(kWidth, kHeight, kDepth);
+  array.FillRandom(kSeed, 7, cua::UniformRandomDouble());
+  host_array.FillRandom(kSeed, 7, cua::UniformRandomDouble());
+
+  std::vector<double> result(array.Size()), expected(array.Size());
+  array.CopyTo(result.data());
+  host_array.CopyTo(expected.data());
+  EXPECT_EQ(result, expected);
+  CUDA_CHECK_ERROR
+}
+
+}  // namespace
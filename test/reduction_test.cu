@@ -0,0 +1,195 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cudaArray2D.h"
+#include "cudaArray3D.h"
+#include "cudaHostArray2D.h"
+#include "cudaHostArray3D.h"
+#include "cudaSurface2D.h"
+#include "cudaTexture2D.h"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "util.h"
+
+namespace {
+
+// large enough that the first pass uses many blocks and the host reference
+// uses several chunks
+const size_t kWidth = 613;
+const size_t kHeight = 419;
+
+//------------------------------------------------------------------------------
+//
+// 2D tests over all array kinds
+//
+//------------------------------------------------------------------------------
+
+template <typename CudaArrayType>
+class Reduction2DTest : public ::testing::Test {
+ public:
+  Reduction2DTest() : array_(kWidth, kHeight), data_(kWidth * kHeight) {
+    for (size_t i = 0; i < data_.size(); ++i) {
+      data_[i] = Value(i);
+    }
+    array_ = data_.data();
+  }
+
+ protected:
+  CudaArrayType array_;
+  std::vector<float> data_;
+};
+
+typedef ::testing::Types<cua::CudaArray2D<float>, cua::CudaSurface2D<float>,
+                         cua::CudaTexture2D<float>,
+                         cua::CudaHostArray2D<float>>
+    Types2D;
+
+TYPED_TEST_SUITE(Reduction2DTest, Types2D);
+
+TYPED_TEST(Reduction2DTest, TestMinMax) {
+  const float min = *std::min_element(this->data_.begin(), this->data_.end());
+  const float max = *std::max_element(this->data_.begin(), this->data_.end());
+
+  EXPECT_EQ(this->array_.Min(), min);
+  EXPECT_EQ(this->array_.Max(), max);
+
+  const cua::MinMaxValue<float> min_max = this->array_.MinMax();
+  EXPECT_EQ(min_max.min, min);
+  EXPECT_EQ(min_max.max, max);
+  CUDA_CHECK_ERROR
+}
+
+TYPED_TEST(Reduction2DTest, TestSumMeanNorm) {
+  double sum = 0., sum_of_squares = 0.;
+  for (const float value : this->data_) {
+    sum += value;
+    sum_of_squares += value * value;
+  }
+
+  const double tolerance = 1e-4 * sum_of_squares;
+  EXPECT_NEAR(this->array_.Sum(), sum, tolerance);
+  EXPECT_NEAR(this->array_.Mean(), sum / this->data_.size(),
+              tolerance / this->data_.size());
+  EXPECT_NEAR(this->array_.Norm(), std::sqrt(sum_of_squares),
+              1e-4 * std::sqrt(sum_of_squares));
+  CUDA_CHECK_ERROR
+}
+
+TYPED_TEST(Reduction2DTest, TestUserOperator) {
+  // the maximum via a user-defined reduction
+  const float max = *std::max_element(this->data_.begin(), this->data_.end());
+  EXPECT_EQ(this->array_.Reduce(cua::Maximum(), -1e9f), max);
+  CUDA_CHECK_ERROR
+}
+
+TYPED_TEST(Reduction2DTest, TestAsync) {
+  const float min = *std::min_element(this->data_.begin(), this->data_.end());
+  cua::CudaAsyncValue<float> result = this->array_.MinAsync();
+  EXPECT_EQ(result.Get(), min);
+  EXPECT_TRUE(result.Ready());
+  CUDA_CHECK_ERROR
+}
+
+//------------------------------------------------------------------------------
+//
+// device results against the host reference implementation
+//
+//------------------------------------------------------------------------------
+
+TEST(ReductionTest, TestIntegralSumDoesNotOverflow) {
+  cua::CudaArray2D<unsigned char> array(kWidth, kHeight);
+  cua::CudaHostArray2D<unsigned char> host_array(kWidth, kHeight);
+  array.Fill(255);
+  host_array.Fill(255);
+
+  const unsigned long long expected = 255ull * kWidth * kHeight;
+  EXPECT_EQ(array.Sum(), expected);
+  EXPECT_EQ(host_array.Sum(), expected);
+  CUDA_CHECK_ERROR
+}
+
+TEST(ReductionTest, TestWideLinearIndices) {
+  EXPECT_FALSE(cua::internal::Needs64BitIndexing(0xffffffffull));
+  EXPECT_TRUE(cua::internal::Needs64BitIndexing(0x100000000ull));
+
+  typedef cua::CudaHostArray2D<float> ArrayType;
+  ArrayType array(kWidth, kHeight);
+  static_assert(std::is_same<decltype(array.Size()), size_t>::value,
+                "Size() must be 64-bit");
+
+  std::vector<float> data(kWidth * kHeight);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<float>(i);
+  }
+  array = data.data();
+
+  // the reader used for arrays with more than 2^32 elements visits the same
+  // elements as the 32-bit one
+  const cua::internal::LinearReader2D<ArrayType, unsigned int> narrow(array);
+  const cua::internal::LinearReader2D<ArrayType, unsigned long long> wide(
+      array);
+  for (size_t i = 0; i < data.size(); i += 97) {
+    EXPECT_EQ(narrow(i), data[i]);
+    EXPECT_EQ(wide(i), data[i]);
+  }
+}
+
+TEST(ReductionTest, TestDeviceMatchesHost3D) {
+  cua::CudaArray3D<unsigned int> array(67, 43, 29);
+  cua::CudaHostArray3D<unsigned int> host_array(67, 43, 29);
+  std::vector<unsigned int> data(array.Size());
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<unsigned int>((i * 2654435761u) % 100003);
+  }
+  array = data.data();
+  host_array = data.data();
+
+  // integer reductions are exact, so the results must be identical
+  EXPECT_EQ(array.Sum(), host_array.Sum());
+  EXPECT_EQ(array.Min(), host_array.Min());
+  EXPECT_EQ(array.Max(), host_array.Max());
+  EXPECT_EQ(array.Norm(), host_array.Norm());
+  EXPECT_EQ(array.Mean(), host_array.Mean());
+  EXPECT_EQ(array.Reduce(cua::Plus(), 0u), host_array.Reduce(cua::Plus(), 0u));
+  CUDA_CHECK_ERROR
+}
+
+}  // namespace
@@ -0,0 +1,339 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cudaArray2D.h"
+#include "cudaArray3D.h"
+#include "cudaHostArray2D.h"
+#include "cudaHostArray3D.h"
+#include "cudaTexture2D.h"
+#include "scan.h"
+
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "util.h"
+
+namespace {
+
+// more than one tile along every axis, with partial tiles at the far edges
+const size_t kWidth = 300;
+const size_t kHeight = 75;
+const size_t kWidth3D = 150;
+const size_t kHeight3D = 37;
+const size_t kDepth3D = 9;
+
+//
+// reference scans of a w x h x d volume along the given axes
+//
+template <typename Accumulator, typename T>
+std::vector<Accumulator> ReferenceScan(const std::vector<T> &data, size_t w,
+                                       size_t h, size_t d, unsigned int axes,
+                                       cua::ScanMode mode) {
+  std::vector<Accumulator> result(data.begin(), data.end());
+  const size_t strides[3] = {1, w, w * h};
+  const size_t sizes[3] = {w, h, d};
+  for (int axis = 0; axis < 3; ++axis) {
+    if (!(axes & (1u << axis))) {
+      continue;
+    }
+    for (size_t i = 0; i < result.size(); ++i) {
+      // start of each line along the axis
+      if ((i / strides[axis]) % sizes[axis] != 0) {
+        continue;
+      }
+      Accumulator sum = Accumulator();
+      for (size_t j = 0; j < sizes[axis]; ++j) {
+        Accumulator &element = result[i + j * strides[axis]];
+        const Accumulator value = element;
+        element = (mode == cua::ScanMode::kInclusive) ? sum + value : sum;
+        sum += value;
+      }
+    }
+  }
+  return result;
+}
+
+template <typename ArrayType>
+void ExpectScanEqual(const ArrayType &array,
+                     const std::vector<typename ArrayType::Scalar> &expected,
+                     double tolerance) {
+  std::vector<typename ArrayType::Scalar> result(expected.size());
+  array.CopyTo(result.data());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_NEAR(result[i], expected[i], tolerance) << "Index: " << i;
+  }
+}
+
+// host table for SummedAreaBoxSum()
+template <typename T>
+struct HostTable {
+  typedef T Scalar;
+
+  T get(int x, int y) const { return data[y * width + x]; }
+  T get(int x, int y, int z) const {
+    return data[(z * height + y) * width + x];
+  }
+
+  std::vector<T> data;
+  int width, height;
+};
+
+const cua::ScanMode kModes[] = {cua::ScanMode::kInclusive,
+                                cua::ScanMode::kExclusive};
+
+//------------------------------------------------------------------------------
+//
+// 2D tests
+//
+//------------------------------------------------------------------------------
+
+template <typename SrcType, typename DstType>
+void CheckScans2D(double tolerance, size_t width = kWidth,
+                  size_t height = kHeight) {
+  typedef typename SrcType::Scalar T;
+  typedef typename DstType::Scalar Accumulator;
+  const std::vector<T> data = Values<T>(width * height);
+  SrcType array(width, height);
+  DstType output(width, height);
+  array = data.data();
+
+  for (const cua::ScanMode mode : kModes) {
+    array.ScanX(&output, mode);
+    ExpectScanEqual(output, ReferenceScan<Accumulator>(data, width, height, 1,
+                                                       1, mode),
+                    tolerance);
+    array.ScanY(&output, mode);
+    ExpectScanEqual(output, ReferenceScan<Accumulator>(data, width, height, 1,
+                                                       2, mode),
+                    tolerance);
+    array.ScanXY(&output, mode);
+    ExpectScanEqual(output, ReferenceScan<Accumulator>(data, width, height, 1,
+                                                       3, mode),
+                    tolerance);
+  }
+}
+
+TEST(ScanTest, TestBytes2D) {
+  CheckScans2D<cua::CudaArray2D<unsigned char>,
+               cua::CudaArray2D<unsigned int>>(0);
+  CUDA_CHECK_ERROR
+}
+
+TEST(ScanTest, TestFloat2D) {
+  CheckScans2D<cua::CudaArray2D<float>, cua::CudaArray2D<double>>(1e-9);
+  CUDA_CHECK_ERROR
+}
+
+TEST(ScanTest, TestLongLines2D) {
+  // too few lines to fill any device, so the lines are split into chunks,
+  // the last of which is partial
+  CheckScans2D<cua::CudaArray2D<unsigned char>,
+               cua::CudaArray2D<unsigned int>>(0, 20000 + 77, 3);
+  CheckScans2D<cua::CudaArray2D<unsigned char>,
+               cua::CudaArray2D<unsigned int>>(0, 5, 4000 + 7);
+  CheckScans2D<cua::CudaArray2D<float>, cua::CudaArray2D<double>>(1e-6, 7000,
+                                                                 2);
+  CUDA_CHECK_ERROR
+}
+
+TEST(ScanTest, TestTexture2D) {
+  CheckScans2D<cua::CudaTexture2D<float>, cua::CudaArray2D<double>>(1e-9);
+  CUDA_CHECK_ERROR
+}
+
+TEST(ScanTest, TestHost2D) {
+  CheckScans2D<cua::CudaHostArray2D<unsigned char>,
+               cua::CudaHostArray2D<unsigned int>>(0);
+}
+
+TEST(ScanTest, TestInPlace2D) {
+  const std::vector<float> data = Values<float>(kWidth * kHeight);
+  cua::CudaArray2D<float> array(kWidth, kHeight);
+  array = data.data();
+
+  array.ScanXY(&array, cua::ScanMode::kExclusive);
+  ExpectScanEqual(array, ReferenceScan<float>(data, kWidth, kHeight, 1, 3,
+                                              cua::ScanMode::kExclusive),
+                  1e-1);
+  CUDA_CHECK_ERROR
+}
+
+TEST(ScanTest, TestSummedAreaTable2D) {
+  const std::vector<unsigned char> data =
+      Values<unsigned char>(kWidth * kHeight);
+  cua::CudaArray2D<unsigned char> array(kWidth, kHeight);
+  cua::CudaArray2D<unsigned int> table(kWidth, kHeight);
+  cua::CudaArray2D<unsigned int> box_sums(kWidth, kHeight);
+  array = data.data();
+  array.SummedAreaTable(&table);
+
+  // 7x5 box sums, clamped to the array
+  const auto table_view = table.DeviceView();
+  box_sums.ApplyOp([table_view] __device__(size_t x, size_t y) {
+    const int w = table_view.Width(), h = table_view.Height();
+    const int i = x, j = y;
+    return cua::SummedAreaBoxSum(
+        table_view, (i < 3) ? 0 : i - 3, (j < 2) ? 0 : j - 2,
+        (i + 3 < w) ? i + 3 : w - 1, (j + 2 < h) ? j + 2 : h - 1);
+  });
+
+  std::vector<unsigned int> result(data.size());
+  box_sums.CopyTo(result.data());
+  for (int y = 0; y < static_cast<int>(kHeight); ++y) {
+    for (int x = 0; x < static_cast<int>(kWidth); ++x) {
+      unsigned int expected = 0;
+      for (int j = std::max(y - 2, 0); j <= std::min<int>(y + 2, kHeight - 1);
+           ++j) {
+        for (int i = std::max(x - 3, 0); i <= std::min<int>(x + 3, kWidth - 1);
+             ++i) {
+          expected += data[j * kWidth + i];
+        }
+      }
+      ASSERT_EQ(result[y * kWidth + x], expected)
+          << "Coordinate: " << x << " " << y;
+    }
+  }
+  CUDA_CHECK_ERROR
+}
+
+TEST(ScanTest, TestInvalidSize) {
+  cua::CudaArray2D<float> array(kWidth, kHeight);
+  cua::CudaArray2D<double> output(kWidth, kHeight + 1);
+  EXPECT_THROW(array.ScanX(&output), std::runtime_error);
+
+  cua::CudaArray3D<float> volume(kWidth3D, kHeight3D, kDepth3D);
+  cua::CudaArray3D<double> volume_output(kWidth3D, kHeight3D, kDepth3D - 1);
+  EXPECT_THROW(volume.SummedAreaTable(&volume_output), std::runtime_error);
+}
+
+//------------------------------------------------------------------------------
+//
+// 3D tests
+//
+//------------------------------------------------------------------------------
+
+template <typename SrcType, typename DstType>
+void CheckScans3D(double tolerance, size_t width = kWidth3D,
+                  size_t height = kHeight3D, size_t depth = kDepth3D) {
+  typedef typename SrcType::Scalar T;
+  typedef typename DstType::Scalar Accumulator;
+  const std::vector<T> data = Values<T>(width * height * depth);
+  SrcType array(width, height, depth);
+  DstType output(width, height, depth);
+  array = data.data();
+
+  for (const cua::ScanMode mode : kModes) {
+    for (unsigned int axes = 1; axes <= 7; axes *= 2) {
+      if (axes == 1) {
+        array.ScanX(&output, mode);
+      } else if (axes == 2) {
+        array.ScanY(&output, mode);
+      } else {
+        array.ScanZ(&output, mode);
+      }
+      ExpectScanEqual(output, ReferenceScan<Accumulator>(data, width, height,
+                                                         depth, axes, mode),
+                      tolerance);
+    }
+    array.ScanXYZ(&output, mode);
+    ExpectScanEqual(output, ReferenceScan<Accumulator>(data, width, height,
+                                                       depth, 7, mode),
+                    tolerance);
+  }
+}
+
+TEST(ScanTest, TestBytes3D) {
+  CheckScans3D<cua::CudaArray3D<unsigned char>,
+               cua::CudaArray3D<unsigned int>>(0);
+  CUDA_CHECK_ERROR
+}
+
+TEST(ScanTest, TestFloat3D) {
+  CheckScans3D<cua::CudaArray3D<float>, cua::CudaArray3D<double>>(1e-8);
+  CUDA_CHECK_ERROR
+}
+
+TEST(ScanTest, TestLongLines3D) {
+  CheckScans3D<cua::CudaArray3D<unsigned char>,
+               cua::CudaArray3D<unsigned int>>(0, 3000, 2, 3);
+  CheckScans3D<cua::CudaArray3D<unsigned char>,
+               cua::CudaArray3D<unsigned int>>(0, 3, 2000, 2);
+  CUDA_CHECK_ERROR
+}
+
+TEST(ScanTest, TestHost3D) {
+  CheckScans3D<cua::CudaHostArray3D<unsigned char>,
+               cua::CudaHostArray3D<unsigned int>>(0);
+}
+
+TEST(ScanTest, TestSummedAreaTable3D) {
+  const size_t size = kWidth3D * kHeight3D * kDepth3D;
+  const std::vector<unsigned char> data = Values<unsigned char>(size);
+  cua::CudaArray3D<unsigned char> array(kWidth3D, kHeight3D, kDepth3D);
+  cua::CudaArray3D<unsigned int> table(kWidth3D, kHeight3D, kDepth3D);
+  array = data.data();
+  array.SummedAreaTable(&table);
+
+  HostTable<unsigned int> host_table;
+  host_table.data.resize(size);
+  host_table.width = kWidth3D;
+  host_table.height = kHeight3D;
+  table.CopyTo(host_table.data.data());
+
+  const int boxes[][6] = {{0, 0, 0, 149, 36, 8},
+                          {0, 0, 0, 0, 0, 0},
+                          {3, 5, 2, 3, 5, 2},
+                          {10, 0, 1, 140, 20, 8},
+                          {0, 7, 0, 31, 36, 4},
+                          {17, 11, 3, 99, 30, 7}};
+  for (const auto &box : boxes) {
+    unsigned int expected = 0;
+    for (int z = box[2]; z <= box[5]; ++z) {
+      for (int y = box[1]; y <= box[4]; ++y) {
+        for (int x = box[0]; x <= box[3]; ++x) {
+          expected += data[(z * kHeight3D + y) * kWidth3D + x];
+        }
+      }
+    }
+    EXPECT_EQ(cua::SummedAreaBoxSum(host_table, box[0], box[1], box[2],
+                                    box[3], box[4], box[5]),
+              expected);
+  }
+  CUDA_CHECK_ERROR
+}
+
+}  // namespace
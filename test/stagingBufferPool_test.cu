@@ -0,0 +1,243 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "stagingBufferPool.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+//------------------------------------------------------------------------------
+
+// Host-only backend. "Pinned" buffers come from malloc, and "device" copies are
+// queued instead of run immediately; they only execute when an event recorded
+// after them is synchronized. If the pool reused a staging buffer before its
+// copy had finished, the queued copy would see the wrong data.
+struct MockBackend {
+  typedef size_t Event;
+
+  struct State {
+    State()
+        : num_executed(0),
+          num_allocations(0),
+          num_direct_syncs(0),
+          num_live_events(0),
+          max_allocations(-1),
+          pinned_ptr(nullptr) {}
+
+    std::vector<std::function<void()>> queue;  // pending copies
+    size_t num_executed;                       // copies run so far
+    std::vector<size_t> events;                // queue position per event
+    size_t num_allocations;
+    size_t num_direct_syncs;
+    size_t num_live_events;
+    size_t max_allocations;  // later allocations fail
+    const void *pinned_ptr;  // memory to report as page-locked
+  };
+
+  explicit MockBackend(State *state) : state(state) {}
+
+  void *AllocatePinned(size_t size_in_bytes) const {
+    if (state->num_allocations == state->max_allocations) {
+      return nullptr;
+    }
+    ++state->num_allocations;
+    return std::malloc(size_in_bytes);
+  }
+
+  void FreePinned(void *ptr) const { std::free(ptr); }
+
+  bool IsPinned(const void *ptr) const { return ptr == state->pinned_ptr; }
+
+  Event CreateEvent() const {
+    ++state->num_live_events;
+    state->events.push_back(0);
+    return state->events.size() - 1;
+  }
+
+  void DestroyEvent(Event event) const { --state->num_live_events; }
+
+  void RecordEvent(Event event, cudaStream_t stream) const {
+    state->events[event] = state->queue.size();
+  }
+
+  void SynchronizeEvent(Event event) const { Run(state->events[event]); }
+
+  void SynchronizeStream(cudaStream_t stream) const {
+    ++state->num_direct_syncs;
+    Run(state->queue.size());
+  }
+
+  void Run(size_t end) const {
+    for (; state->num_executed < end; ++state->num_executed) {
+      state->queue[state->num_executed]();
+    }
+  }
+
+  State *state;
+};
+
+typedef cua::StagingBufferPool<MockBackend> Pool;
+
+const cudaStream_t kStream = 0;
+
+//------------------------------------------------------------------------------
+
+class StagingBufferPoolTest : public ::testing::Test {
+ public:
+  StagingBufferPoolTest() : pool_(kChunkBytes, MockBackend(&state_)) {}
+
+ protected:
+  static const size_t kChunkBytes = 1000;
+
+  // Upload from a host vector to a simulated device buffer and back, and check
+  // that the data round-trips.
+  void CheckRoundTrip(size_t row_bytes, size_t num_rows) {
+    const size_t size_in_bytes = row_bytes * num_rows;
+    std::vector<char> src(size_in_bytes), device(size_in_bytes),
+        dst(size_in_bytes);
+    for (size_t i = 0; i < size_in_bytes; ++i) {
+      src[i] = static_cast<char>(i * 7 + 3);
+    }
+
+    MockBackend::State *state = &state_;
+    pool_.Upload(src.data(), row_bytes, num_rows, kStream,
+                 [&](const void *staging, size_t first_row, size_t n,
+                     cudaStream_t stream) {
+                   char *out = device.data() + first_row * row_bytes;
+                   const char *in = reinterpret_cast<const char *>(staging);
+                   state->queue.push_back([=] {
+                     std::memcpy(out, in, n * row_bytes);
+                   });
+                 });
+    EXPECT_EQ(device, src);
+
+    pool_.Download(dst.data(), row_bytes, num_rows, kStream,
+                   [&](void *staging, size_t first_row, size_t n,
+                       cudaStream_t stream) {
+                     const char *in = device.data() + first_row * row_bytes;
+                     char *out = reinterpret_cast<char *>(staging);
+                     state->queue.push_back([=] {
+                       std::memcpy(out, in, n * row_bytes);
+                     });
+                   });
+    EXPECT_EQ(dst, src);
+  }
+
+  MockBackend::State state_;
+  Pool pool_;
+};
+
+const size_t StagingBufferPoolTest::kChunkBytes;
+
+//------------------------------------------------------------------------------
+
+TEST_F(StagingBufferPoolTest, TestChunkedRoundTrip) {
+  // several chunks per transfer, with a partial last chunk
+  CheckRoundTrip(300, Pool::kMinStagedBytes / 300 + 17);
+  EXPECT_EQ(state_.num_allocations, 2);  // double-buffered
+  EXPECT_EQ(state_.num_direct_syncs, 0);
+}
+
+TEST_F(StagingBufferPoolTest, TestRowsLargerThanChunk) {
+  CheckRoundTrip(3 * kChunkBytes + 1, Pool::kMinStagedBytes / kChunkBytes);
+}
+
+TEST_F(StagingBufferPoolTest, TestBuffersAreReused) {
+  CheckRoundTrip(100, Pool::kMinStagedBytes / 100 + 1);
+  CheckRoundTrip(100, Pool::kMinStagedBytes / 100 + 1);
+  EXPECT_EQ(state_.num_allocations, 2);
+  EXPECT_EQ(pool_.NumBuffers(), 2);
+  EXPECT_EQ(state_.events.size(), 2);  // events are pooled, as well
+
+  pool_.Trim();
+  EXPECT_EQ(pool_.NumBuffers(), 0);
+  EXPECT_EQ(state_.num_live_events, 0);
+}
+
+TEST_F(StagingBufferPoolTest, TestFailedAllocationReleasesLeases) {
+  state_.max_allocations = 1;  // the second staging buffer cannot be allocated
+  std::vector<char> src(Pool::kMinStagedBytes);
+  EXPECT_THROW(pool_.Upload(src.data(), 1024, src.size() / 1024, kStream,
+                            [](const void *, size_t, size_t, cudaStream_t) {}),
+               std::runtime_error);
+
+  // the first buffer went back to the pool, and can be released
+  EXPECT_EQ(pool_.NumBuffers(), 1);
+  pool_.Trim();
+  EXPECT_EQ(pool_.NumBuffers(), 0);
+  EXPECT_EQ(state_.num_live_events, 0);
+}
+
+TEST_F(StagingBufferPoolTest, TestSmallTransfersAreNotStaged) {
+  CheckRoundTrip(10, 10);
+  EXPECT_EQ(state_.num_allocations, 0);
+  EXPECT_EQ(state_.num_direct_syncs, 2);
+}
+
+TEST_F(StagingBufferPoolTest, TestPinnedTransfersAreNotStaged) {
+  std::vector<char> src(Pool::kMinStagedBytes);
+  state_.pinned_ptr = src.data();
+
+  const void *copied_from = nullptr;
+  pool_.Upload(src.data(), src.size(), 1, kStream,
+               [&](const void *ptr, size_t, size_t, cudaStream_t) {
+                 copied_from = ptr;
+               });
+  EXPECT_EQ(copied_from, src.data());
+  EXPECT_EQ(state_.num_allocations, 0);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(ForEachSliceRunTest, TestRunsStopAtSliceBoundaries) {
+  std::vector<std::vector<size_t>> runs;
+  cua::internal::ForEachSliceRun(
+      3, 9, 4, [&](size_t y, size_t z, size_t n, size_t offset) {
+        runs.push_back({y, z, n, offset});
+      });
+
+  const std::vector<std::vector<size_t>> expected = {
+      {3, 0, 1, 0}, {0, 1, 4, 1}, {0, 2, 4, 5}};
+  EXPECT_EQ(runs, expected);
+}
+
+}  // namespace
@@ -0,0 +1,442 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cudaArray2D.h"
+#include "cudaArray3D.h"
+#include "cudaHostArray2D.h"
+#include "cudaHostArray3D.h"
+#include "cudaSurface2D.h"
+#include "cudaTexture2D.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "util.h"
+
+namespace {
+
+// more than one tile along every axis, with partial tiles at the far edges
+const size_t kWidth = 75;
+const size_t kHeight = 70;
+const size_t kWidth3D = 40;
+const size_t kHeight3D = 19;
+const size_t kDepth3D = 10;
+
+const float kTolerance = 1e-4f;
+
+const cua::ConvolutionBorder kBorders[] = {
+    cua::ConvolutionBorder::kClamp, cua::ConvolutionBorder::kZero,
+    cua::ConvolutionBorder::kMirror, cua::ConvolutionBorder::kWrap};
+
+// element (x, y, z) of a w x h x d array under the given border policy
+inline float At(const std::vector<float> &data, int w, int h, int d, int x,
+                int y, int z, cua::ConvolutionBorder border) {
+  using cua::internal::ConvolutionIndex;
+  x = ConvolutionIndex(x, w, border);
+  y = ConvolutionIndex(y, h, border);
+  z = ConvolutionIndex(z, d, border);
+  return (x >= 0 && y >= 0 && z >= 0) ? data[(z * h + y) * w + x] : 0.f;
+}
+
+//------------------------------------------------------------------------------
+//
+// stencil operations; the coordinate terms detect mixed-up coordinates
+//
+//------------------------------------------------------------------------------
+
+template <typename SrcType, typename DstType>
+void ApplyLaplacian2D(const SrcType &src, DstType *dst,
+                      cua::ConvolutionBorder border) {
+  src.template ApplyStencil<1>(
+      [] __host__ __device__(const cua::StencilAccessor2D<float, 1> &a,
+                             unsigned int x, unsigned int y) {
+        return a(-1, 0) + a(1, 0) + a(0, -1) + a(0, 1) - 4.f * a(0, 0) +
+               0.001f * x + 0.01f * y;
+      },
+      dst, border);
+}
+
+inline float Laplacian2D(const std::vector<float> &data, int x, int y,
+                         cua::ConvolutionBorder border) {
+  const auto at = [&](int i, int j) {
+    return At(data, kWidth, kHeight, 1, i, j, 0, border);
+  };
+  return at(x - 1, y) + at(x + 1, y) + at(x, y - 1) + at(x, y + 1) -
+         4.f * at(x, y) + 0.001f * x + 0.01f * y;
+}
+
+// weighted 5x5 sum
+template <typename SrcType, typename DstType>
+void ApplyWeightedSum2D(const SrcType &src, DstType *dst,
+                        cua::ConvolutionBorder border) {
+  src.template ApplyStencil<2>(
+      [] __host__ __device__(const cua::StencilAccessor2D<float, 2> &a,
+                             unsigned int, unsigned int) {
+        float sum = 0.f;
+        for (int dy = -2; dy <= 2; ++dy) {
+          for (int dx = -2; dx <= 2; ++dx) {
+            sum += (dx + 3 * dy + 10) * a(dx, dy);
+          }
+        }
+        return sum;
+      },
+      dst, border);
+}
+
+inline float WeightedSum2D(const std::vector<float> &data, int x, int y,
+                           cua::ConvolutionBorder border) {
+  float sum = 0.f;
+  for (int dy = -2; dy <= 2; ++dy) {
+    for (int dx = -2; dx <= 2; ++dx) {
+      sum += (dx + 3 * dy + 10) *
+             At(data, kWidth, kHeight, 1, x + dx, y + dy, 0, border);
+    }
+  }
+  return sum;
+}
+
+template <typename SrcType, typename DstType>
+void ApplyLaplacian3D(const SrcType &src, DstType *dst,
+                      cua::ConvolutionBorder border) {
+  src.template ApplyStencil<1>(
+      [] __host__ __device__(const cua::StencilAccessor3D<float, 1> &a,
+                             unsigned int x, unsigned int y, unsigned int z) {
+        return a(-1, 0, 0) + a(1, 0, 0) + a(0, -1, 0) + a(0, 1, 0) +
+               a(0, 0, -1) + a(0, 0, 1) - 6.f * a(0, 0, 0) + 0.001f * x +
+               0.01f * y + 0.1f * z;
+      },
+      dst, border);
+}
+
+inline float Laplacian3D(const std::vector<float> &data, int x, int y, int z,
+                         cua::ConvolutionBorder border) {
+  const auto at = [&](int i, int j, int k) {
+    return At(data, kWidth3D, kHeight3D, kDepth3D, i, j, k, border);
+  };
+  return at(x - 1, y, z) + at(x + 1, y, z) + at(x, y - 1, z) +
+         at(x, y + 1, z) + at(x, y, z - 1) + at(x, y, z + 1) -
+         6.f * at(x, y, z) + 0.001f * x + 0.01f * y + 0.1f * z;
+}
+
+// 7x7x7 box sum
+template <typename SrcType, typename DstType>
+void ApplyBoxSum3D(const SrcType &src, DstType *dst,
+                   cua::ConvolutionBorder border) {
+  src.template ApplyStencil<3>(
+      [] __host__ __device__(const cua::StencilAccessor3D<float, 3> &a,
+                             unsigned int, unsigned int, unsigned int) {
+        float sum = 0.f;
+        for (int dz = -3; dz <= 3; ++dz) {
+          for (int dy = -3; dy <= 3; ++dy) {
+            for (int dx = -3; dx <= 3; ++dx) {
+              sum += a(dx, dy, dz);
+            }
+          }
+        }
+        return sum;
+      },
+      dst, border);
+}
+
+inline float BoxSum3D(const std::vector<float> &data, int x, int y, int z,
+                      cua::ConvolutionBorder border) {
+  float sum = 0.f;
+  for (int dz = -3; dz <= 3; ++dz) {
+    for (int dy = -3; dy <= 3; ++dy) {
+      for (int dx = -3; dx <= 3; ++dx) {
+        sum += At(data, kWidth3D, kHeight3D, kDepth3D, x + dx, y + dy, z + dz,
+                  border);
+      }
+    }
+  }
+  return sum;
+}
+
+//------------------------------------------------------------------------------
+//
+// 2D tests over all readable array kinds
+//
+//------------------------------------------------------------------------------
+
+// output array type for each source array type
+template <typename CudaArrayType>
+struct Output2D {
+  typedef cua::CudaArray2D<float> type;
+};
+
+template <>
+struct Output2D<cua::CudaHostArray2D<float>> {
+  typedef cua::CudaHostArray2D<float> type;
+};
+
+template <typename CudaArrayType>
+class Stencil2DTest : public ::testing::Test {
+ public:
+  typedef typename Output2D<CudaArrayType>::type OutputType;
+  typedef std::function<float(const std::vector<float> &, int, int,
+                              cua::ConvolutionBorder)>
+      Reference;
+
+  Stencil2DTest()
+      : array_(kWidth, kHeight),
+        output_(kWidth, kHeight),
+        data_(Values(kWidth * kHeight)) {
+    array_ = data_.data();
+  }
+
+  void CheckOutput(const Reference &reference, cua::ConvolutionBorder border,
+                   float tolerance = kTolerance) {
+    std::vector<float> result(kWidth * kHeight);
+    output_.CopyTo(result.data());
+    for (size_t y = 0; y < kHeight; ++y) {
+      for (size_t x = 0; x < kWidth; ++x) {
+        ASSERT_NEAR(result[y * kWidth + x], reference(data_, x, y, border),
+                    tolerance)
+            << "Coordinate: " << x << " " << y;
+      }
+    }
+  }
+
+ protected:
+  CudaArrayType array_;
+  OutputType output_;
+  std::vector<float> data_;
+};
+
+typedef ::testing::Types<cua::CudaArray2D<float>, cua::CudaSurface2D<float>,
+                         cua::CudaTexture2D<float>,
+                         cua::CudaHostArray2D<float>>
+    Types2D;
+
+TYPED_TEST_SUITE(Stencil2DTest, Types2D);
+
+TYPED_TEST(Stencil2DTest, TestLaplacian) {
+  for (const cua::ConvolutionBorder border : kBorders) {
+    ApplyLaplacian2D(this->array_, &this->output_, border);
+    this->CheckOutput(Laplacian2D, border);
+  }
+  CUDA_CHECK_ERROR
+}
+
+TYPED_TEST(Stencil2DTest, TestWeightedSum) {
+  for (const cua::ConvolutionBorder border : kBorders) {
+    ApplyWeightedSum2D(this->array_, &this->output_, border);
+    // sums of 25 terms, with magnitudes in the thousands
+    this->CheckOutput(WeightedSum2D, border, 1e-2f);
+  }
+  CUDA_CHECK_ERROR
+}
+
+TYPED_TEST(Stencil2DTest, TestInvalidOutput) {
+  typename TestFixture::OutputType small_output(kWidth, kHeight - 1);
+  EXPECT_THROW(ApplyLaplacian2D(this->array_, &small_output,
+                                cua::ConvolutionBorder::kClamp),
+               std::runtime_error);
+}
+
+TEST(StencilTest, TestSourceAsOutput) {
+  cua::CudaArray2D<float> array(kWidth, kHeight);
+  EXPECT_THROW(ApplyLaplacian2D(array, &array, cua::ConvolutionBorder::kClamp),
+               std::runtime_error);
+}
+
+TEST(StencilTest, TestAliasedOutput) {
+  // a shallow copy shares the memory of the source
+  cua::CudaArray2D<float> array(kWidth, kHeight);
+  cua::CudaArray2D<float> copy = array;
+  EXPECT_THROW(ApplyLaplacian2D(array, &copy, cua::ConvolutionBorder::kClamp),
+               std::runtime_error);
+
+  cua::CudaHostArray2D<float> host_array(kWidth, kHeight);
+  cua::CudaHostArray2D<float> host_copy = host_array;
+  EXPECT_THROW(ApplyLaplacian2D(host_array, &host_copy,
+                                cua::ConvolutionBorder::kClamp),
+               std::runtime_error);
+
+  cua::CudaSurface2D<float> surface(kWidth, kHeight);
+  cua::CudaSurface2D<float> surface_copy = surface;
+  EXPECT_THROW(ApplyLaplacian2D(surface, &surface_copy,
+                                cua::ConvolutionBorder::kClamp),
+               std::runtime_error);
+
+  // overlapping views are rejected, disjoint ones are not
+  cua::CudaArray2D<float> tall(kWidth + 1, 2 * kHeight);
+  auto src = tall.View(0, 0, kWidth, kHeight);
+  auto shifted = tall.View(1, 0, kWidth, kHeight);
+  auto below = tall.View(0, kHeight, kWidth, kHeight);
+  EXPECT_THROW(ApplyLaplacian2D(src, &shifted, cua::ConvolutionBorder::kClamp),
+               std::runtime_error);
+  EXPECT_NO_THROW(
+      ApplyLaplacian2D(src, &below, cua::ConvolutionBorder::kClamp));
+
+  cua::CudaArray3D<float> volume(kWidth, kHeight, 4);
+  cua::CudaArray3D<float> volume_copy = volume;
+  EXPECT_THROW(ApplyLaplacian3D(volume, &volume_copy,
+                                cua::ConvolutionBorder::kClamp),
+               std::runtime_error);
+}
+
+TEST(StencilTest, TestBorderFromArray) {
+  const std::vector<float> data = Values(kWidth * kHeight);
+  cua::CudaSurface2D<float> surface(kWidth, kHeight);  // zero boundary mode
+  cua::CudaArray2D<float> array(kWidth, kHeight);
+  cua::CudaArray2D<float> output(kWidth, kHeight);
+  surface = data.data();
+  array = data.data();
+
+  std::vector<float> result(kWidth * kHeight);
+  for (int i = 0; i < 2; ++i) {
+    const cua::ConvolutionBorder border =
+        (i == 0) ? cua::ConvolutionBorder::kZero
+                 : cua::ConvolutionBorder::kClamp;
+    if (i == 0) {
+      ApplyLaplacian2D(surface, &output, cua::ConvolutionBorder::kFromArray);
+    } else {
+      ApplyLaplacian2D(array, &output, cua::ConvolutionBorder::kFromArray);
+    }
+    output.CopyTo(result.data());
+    for (size_t y = 0; y < kHeight; ++y) {
+      for (size_t x = 0; x < kWidth; ++x) {
+        ASSERT_NEAR(result[y * kWidth + x], Laplacian2D(data, x, y, border),
+                    kTolerance);
+      }
+    }
+  }
+  CUDA_CHECK_ERROR
+}
+
+// grayscale erosion with a 5x5 structuring element, from uchar to uchar
+void Erode(const cua::CudaArray2D<unsigned char> &src,
+           cua::CudaArray2D<unsigned char> *dst) {
+  src.ApplyStencil<2>(
+      [] __device__(const cua::StencilAccessor2D<unsigned char, 2> &a,
+                    unsigned int, unsigned int) {
+        unsigned char value = a(0, 0);
+        for (int dy = -2; dy <= 2; ++dy) {
+          for (int dx = -2; dx <= 2; ++dx) {
+            value = (a(dx, dy) < value) ? a(dx, dy) : value;
+          }
+        }
+        return value;
+      },
+      dst);
+}
+
+TEST(StencilTest, TestErosion) {
+  std::vector<unsigned char> data(kWidth * kHeight);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = (i * 7919) % 256;
+  }
+  cua::CudaArray2D<unsigned char> array(kWidth, kHeight);
+  cua::CudaArray2D<unsigned char> output(kWidth, kHeight);
+  array = data.data();
+  Erode(array, &output);
+
+  std::vector<unsigned char> result(data.size());
+  output.CopyTo(result.data());
+  for (int y = 0; y < static_cast<int>(kHeight); ++y) {
+    for (int x = 0; x < static_cast<int>(kWidth); ++x) {
+      unsigned char expected = 255;
+      for (int j = std::max(y - 2, 0); j <= std::min<int>(y + 2, kHeight - 1);
+           ++j) {
+        for (int i = std::max(x - 2, 0); i <= std::min<int>(x + 2, kWidth - 1);
+             ++i) {
+          expected = std::min(expected, data[j * kWidth + i]);
+        }
+      }
+      ASSERT_EQ(result[y * kWidth + x], expected)
+          << "Coordinate: " << x << " " << y;
+    }
+  }
+  CUDA_CHECK_ERROR
+}
+
+//------------------------------------------------------------------------------
+//
+// 3D tests
+//
+//------------------------------------------------------------------------------
+
+template <typename SrcType, typename DstType>
+void Check3D(cua::ConvolutionBorder border) {
+  const std::vector<float> data = Values(kWidth3D * kHeight3D * kDepth3D);
+  SrcType array(kWidth3D, kHeight3D, kDepth3D);
+  DstType output(kWidth3D, kHeight3D, kDepth3D);
+  array = data.data();
+  std::vector<float> result(data.size());
+
+  ApplyLaplacian3D(array, &output, border);
+  output.CopyTo(result.data());
+  for (size_t z = 0; z < kDepth3D; ++z) {
+    for (size_t y = 0; y < kHeight3D; ++y) {
+      for (size_t x = 0; x < kWidth3D; ++x) {
+        ASSERT_NEAR(result[(z * kHeight3D + y) * kWidth3D + x],
+                    Laplacian3D(data, x, y, z, border), kTolerance)
+            << "Coordinate: " << x << " " << y << " " << z;
+      }
+    }
+  }
+
+  ApplyBoxSum3D(array, &output, border);
+  output.CopyTo(result.data());
+  for (size_t z = 0; z < kDepth3D; ++z) {
+    for (size_t y = 0; y < kHeight3D; ++y) {
+      for (size_t x = 0; x < kWidth3D; ++x) {
+        ASSERT_NEAR(result[(z * kHeight3D + y) * kWidth3D + x],
+                    BoxSum3D(data, x, y, z, border), 1e-2f)
+            << "Coordinate: " << x << " " << y << " " << z;
+      }
+    }
+  }
+}
+
+TEST(StencilTest, TestDevice3D) {
+  for (const cua::ConvolutionBorder border : kBorders) {
+    Check3D<cua::CudaArray3D<float>, cua::CudaArray3D<float>>(border);
+  }
+  CUDA_CHECK_ERROR
+}
+
+TEST(StencilTest, TestHost3D) {
+  for (const cua::ConvolutionBorder border : kBorders) {
+    Check3D<cua::CudaHostArray3D<float>, cua::CudaHostArray3D<float>>(border);
+  }
+}
+
+}  // namespace
@@ -36,6 +36,9 @@
 #ifndef TEST_UTIL_H_
 #define TEST_UTIL_H_
 
+#include <type_traits>
+#include <vector>
+
 //------------------------------------------------------------------------------
 // Error-checking macro.
 
@@ -201,6 +204,32 @@ DEFINE_FOR_ALL_TYPES
 #undef DEFINE_FOR_ALL_DIMS
 #undef DEFINE_FOR_ALL_TYPES
 
+//------------------------------------------------------------------------------
+// Deterministic, irregular test data.
+
+// values in [-5, 5) with two decimals
+inline float Value(size_t i) {
+  return static_cast<float>((i * 7919) % 1001) * 0.01f - 5.f;
+}
+
+// values covering the full byte range
+inline unsigned char ByteValue(size_t i) {
+  return static_cast<unsigned char>((i * 7919) % 256);
+}
+
+// Value(offset), Value(offset + 1), ... for floating-point T; ByteValue()
+// otherwise
+template <typename T = float>
+std::vector<T> Values(size_t size, size_t offset = 0) {
+  std::vector<T> data(size);
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = std::is_floating_point<T>::value
+                  ? static_cast<T>(Value(i + offset))
+                  : static_cast<T>(ByteValue(i + offset));
+  }
+  return data;
+}
+
 //------------------------------------------------------------------------------
 
 template <typename Scalar>
@@ -0,0 +1,312 @@
+// libcua: header-only library for interfacing with CUDA array-type objects
+// Author: True Price <jtprice at cs.unc.edu>
+//
+// BSD License
+// Copyright (C) 2017-2019  The University of North Carolina at Chapel Hill
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name of the original author nor the names of contributors may
+//   be used to endorse or promote products derived from this software without
+//   specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cudaArray2D.h"
+#include "cudaArray3D.h"
+#include "cudaHostArray2D.h"
+#include "cudaHostArray3D.h"
+#include "cudaSurface2D.h"
+#include "cudaSurface3D.h"
+#include "cudaTexture2D.h"
+#include "cudaTexture3D.h"
+#include "zip.h"
+
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "util.h"
+
+namespace {
+
+const size_t kWidth = 75;
+const size_t kHeight = 70;
+const size_t kWidth3D = 40;
+const size_t kHeight3D = 19;
+const size_t kDepth3D = 10;
+
+inline std::vector<float2> Values2(size_t size) {
+  std::vector<float2> data(size);
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = make_float2(Value(i + 1), Value(i + 2));
+  }
+  return data;
+}
+
+inline std::vector<uchar4> Values4(size_t size) {
+  std::vector<uchar4> data(size);
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = make_uchar4(i % 256, (i * 31) % 256, (i * 7) % 256, i % 3);
+  }
+  return data;
+}
+
+//------------------------------------------------------------------------------
+//
+// element functions; the host references below use the same functions
+//
+//------------------------------------------------------------------------------
+
+struct WeightedSum {
+  __host__ __device__ float operator()(float a, float2 b, float c,
+                                       uchar4 d) const {
+    return a * b.x - b.y + 0.5f * c + d.w;
+  }
+};
+
+struct PolarAndSum {
+  __host__ __device__ void operator()(float2 b, float a, float &magnitude,
+                                      float &sum, float2 &scaled) const {
+    magnitude = b.x * b.x + b.y * b.y;
+    sum = a + b.x + b.y;
+    scaled = make_float2(a * b.x, a * b.y);
+  }
+};
+
+//------------------------------------------------------------------------------
+//
+// 2D tests
+//
+//------------------------------------------------------------------------------
+
+TEST(ZipTest, TestMixedInputs2D) {
+  const size_t size = kWidth * kHeight;
+  const std::vector<float> a_data = Values(size), c_data = Values(size, 3);
+  const std::vector<float2> b_data = Values2(size);
+  const std::vector<uchar4> d_data = Values4(size);
+
+  cua::CudaArray2D<float> a(kWidth, kHeight);
+  cua::CudaArray2D<float2> b(kWidth, kHeight);
+  cua::CudaTexture2D<float> c(kWidth, kHeight);
+  cua::CudaSurface2D<uchar4> d(kWidth, kHeight);
+  cua::CudaArray2D<float> out(kWidth, kHeight);
+  a = a_data.data();
+  b = b_data.data();
+  c = c_data.data();
+  d = d_data.data();
+
+  out.Zip(WeightedSum(), a, b, c, d);
+
+  std::vector<float> result(size);
+  out.CopyTo(result.data());
+  for (size_t i = 0; i < size; ++i) {
+    ASSERT_FLOAT_EQ(result[i], WeightedSum()(a_data[i], b_data[i], c_data[i],
+                                             d_data[i]))
+        << "Index: " << i;
+  }
+  CUDA_CHECK_ERROR
+}
+
+TEST(ZipTest, TestMultipleOutputs2D) {
+  const size_t size = kWidth * kHeight;
+  const std::vector<float> a_data = Values(size);
+  const std::vector<float2> b_data = Values2(size);
+
+  cua::CudaArray2D<float> a(kWidth, kHeight);
+  cua::CudaSurface2D<float2> b(kWidth, kHeight);
+  cua::CudaArray2D<float> magnitude(kWidth, kHeight);
+  cua::CudaSurface2D<float> sum(kWidth, kHeight);
+  cua::CudaArray2D<float2> scaled(kWidth, kHeight);
+  a = a_data.data();
+  b = b_data.data();
+
+  cua::Zip(PolarAndSum(), std::tie(magnitude, sum, scaled), b, a);
+
+  std::vector<float> magnitude_result(size), sum_result(size);
+  std::vector<float2> scaled_result(size);
+  magnitude.CopyTo(magnitude_result.data());
+  sum.CopyTo(sum_result.data());
+  scaled.CopyTo(scaled_result.data());
+  for (size_t i = 0; i < size; ++i) {
+    float expected_magnitude, expected_sum;
+    float2 expected_scaled;
+    PolarAndSum()(b_data[i], a_data[i], expected_magnitude, expected_sum,
+                  expected_scaled);
+    ASSERT_FLOAT_EQ(magnitude_result[i], expected_magnitude) << "Index: " << i;
+    ASSERT_FLOAT_EQ(sum_result[i], expected_sum) << "Index: " << i;
+    ASSERT_FLOAT_EQ(scaled_result[i].x, expected_scaled.x) << "Index: " << i;
+    ASSERT_FLOAT_EQ(scaled_result[i].y, expected_scaled.y) << "Index: " << i;
+  }
+  CUDA_CHECK_ERROR
+}
+
+TEST(ZipTest, TestInPlace2D) {
+  const size_t size = kWidth * kHeight;
+  const std::vector<float> a_data = Values(size), b_data = Values(size, 5);
+
+  cua::CudaArray2D<float> a(kWidth, kHeight);
+  cua::CudaArray2D<float> b(kWidth, kHeight);
+  a = a_data.data();
+  b = b_data.data();
+
+  a.Zip([] __device__(float a, float b) { return a * b + 1.f; }, a, b);
+
+  std::vector<float> result(size);
+  a.CopyTo(result.data());
+  for (size_t i = 0; i < size; ++i) {
+    ASSERT_FLOAT_EQ(result[i], a_data[i] * b_data[i] + 1.f) << "Index: " << i;
+  }
+  CUDA_CHECK_ERROR
+}
+
+TEST(ZipTest, TestHost2D) {
+  const size_t size = kWidth * kHeight;
+  const std::vector<float> a_data = Values(size);
+  const std::vector<float2> b_data = Values2(size);
+
+  cua::CudaHostArray2D<float> a(kWidth, kHeight);
+  cua::CudaHostArray2D<float2> b(kWidth, kHeight);
+  cua::CudaHostArray2D<float> magnitude(kWidth, kHeight);
+  cua::CudaHostArray2D<float> sum(kWidth, kHeight);
+  cua::CudaHostArray2D<float2> scaled(kWidth, kHeight);
+  a = a_data.data();
+  b = b_data.data();
+
+  cua::Zip(PolarAndSum(), std::tie(magnitude, sum, scaled), b, a);
+  a.Zip([] __host__ __device__(float a, float2 b) { return a - b.y; }, a, b);
+
+  std::vector<float> a_result(size), sum_result(size);
+  a.CopyTo(a_result.data());
+  sum.CopyTo(sum_result.data());
+  for (size_t i = 0; i < size; ++i) {
+    ASSERT_FLOAT_EQ(a_result[i], a_data[i] - b_data[i].y) << "Index: " << i;
+    ASSERT_FLOAT_EQ(sum_result[i], a_data[i] + b_data[i].x + b_data[i].y)
+        << "Index: " << i;
+  }
+}
+
+TEST(ZipTest, TestInvalidSize2D) {
+  cua::CudaArray2D<float> a(kWidth, kHeight);
+  cua::CudaTexture2D<float> b(kWidth, kHeight - 1);
+  cua::CudaArray2D<float> out(kWidth, kHeight);
+  cua::CudaArray2D<float> small_out(kWidth - 1, kHeight);
+
+  const auto add = [] __device__(float a, float b) { return a + b; };
+  EXPECT_THROW(out.Zip(add, a, b), std::runtime_error);
+  EXPECT_THROW(
+      cua::Zip([] __device__(float a, float &x, float &y) { x = y = a; },
+               std::tie(out, small_out), a),
+      std::runtime_error);
+}
+
+//------------------------------------------------------------------------------
+//
+// 3D tests
+//
+//------------------------------------------------------------------------------
+
+TEST(ZipTest, TestMixedInputs3D) {
+  const size_t size = kWidth3D * kHeight3D * kDepth3D;
+  const std::vector<float> a_data = Values(size), c_data = Values(size, 3);
+  const std::vector<float2> b_data = Values2(size);
+  const std::vector<uchar4> d_data = Values4(size);
+
+  cua::CudaArray3D<float> a(kWidth3D, kHeight3D, kDepth3D);
+  cua::CudaArray3D<float2> b(kWidth3D, kHeight3D, kDepth3D);
+  cua::CudaTexture3D<float> c(kWidth3D, kHeight3D, kDepth3D);
+  cua::CudaSurface3D<uchar4> d(kWidth3D, kHeight3D, kDepth3D);
+  cua::CudaArray3D<float> out(kWidth3D, kHeight3D, kDepth3D);
+  a = a_data.data();
+  b = b_data.data();
+  c = c_data.data();
+  d = d_data.data();
+
+  out.Zip(WeightedSum(), a, b, c, d);
+
+  std::vector<float> result(size);
+  out.CopyTo(result.data());
+  for (size_t i = 0; i < size; ++i) {
+    ASSERT_FLOAT_EQ(result[i], WeightedSum()(a_data[i], b_data[i], c_data[i],
+                                             d_data[i]))
+        << "Index: " << i;
+  }
+  CUDA_CHECK_ERROR
+}
+
+template <typename Array3DType, typename Vector3DType>
+void CheckMultipleOutputs3D() {
+  const size_t size = kWidth3D * kHeight3D * kDepth3D;
+  const std::vector<float> a_data = Values(size);
+  const std::vector<float2> b_data = Values2(size);
+
+  Array3DType a(kWidth3D, kHeight3D, kDepth3D);
+  Vector3DType b(kWidth3D, kHeight3D, kDepth3D);
+  Array3DType magnitude(kWidth3D, kHeight3D, kDepth3D);
+  Array3DType sum(kWidth3D, kHeight3D, kDepth3D);
+  Vector3DType scaled(kWidth3D, kHeight3D, kDepth3D);
+  a = a_data.data();
+  b = b_data.data();
+
+  cua::Zip(PolarAndSum(), std::tie(magnitude, sum, scaled), b, a);
+
+  std::vector<float> magnitude_result(size), sum_result(size);
+  std::vector<float2> scaled_result(size);
+  magnitude.CopyTo(magnitude_result.data());
+  sum.CopyTo(sum_result.data());
+  scaled.CopyTo(scaled_result.data());
+  for (size_t i = 0; i < size; ++i) {
+    float expected_magnitude, expected_sum;
+    float2 expected_scaled;
+    PolarAndSum()(b_data[i], a_data[i], expected_magnitude, expected_sum,
+                  expected_scaled);
+    ASSERT_FLOAT_EQ(magnitude_result[i], expected_magnitude) << "Index: " << i;
+    ASSERT_FLOAT_EQ(sum_result[i], expected_sum) << "Index: " << i;
+    ASSERT_FLOAT_EQ(scaled_result[i].x, expected_scaled.x) << "Index: " << i;
+    ASSERT_FLOAT_EQ(scaled_result[i].y, expected_scaled.y) << "Index: " << i;
+  }
+}
+
+TEST(ZipTest, TestMultipleOutputs3D) {
+  CheckMultipleOutputs3D<cua::CudaArray3D<float>, cua::CudaArray3D<float2>>();
+  CUDA_CHECK_ERROR
+}
+
+TEST(ZipTest, TestHost3D) {
+  CheckMultipleOutputs3D<cua::CudaHostArray3D<float>,
+                         cua::CudaHostArray3D<float2>>();
+}
+
+TEST(ZipTest, TestInvalidSize3D) {
+  cua::CudaArray3D<float> a(kWidth3D, kHeight3D, kDepth3D);
+  cua::CudaArray3D<float> b(kWidth3D, kHeight3D, kDepth3D - 1);
+  cua::CudaArray3D<float> out(kWidth3D, kHeight3D, kDepth3D);
+
+  EXPECT_THROW(out.Zip([] __device__(float a, float b) { return a + b; }, a, b),
+               std::runtime_error);
+}
+
+}  // namespace